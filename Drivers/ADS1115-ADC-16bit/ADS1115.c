@@ -1,4 +1,12 @@
 #include "ADS1115.h"
+#include <string.h>
+#ifdef DRIVER_TRACE
+#include "DriverTrace.h"
+#else
+#define DRIVER_TRACE_API(handle)
+#define DRIVER_TRACE_TXN_BEGIN()
+#define DRIVER_TRACE_TXN_END(device, reg, len, op, status)
+#endif
 /**
  ******************************************************************************
  * @file    ADS1115.h
@@ -20,6 +28,156 @@
  ******************************************************************************
  */
 
+#if defined(ADS1115_COMPACT_HANDLE) && !defined(DRIVERS_DCACHE)
+#ifdef USE_I2CBUS
+#define ADS1115_HANDLE_PTRS 3 // i2c_handle, bus_client and cal
+#else
+#define ADS1115_HANDLE_PTRS 2
+#endif
+// Size report: handle pointers plus 22 payload bytes, rounded up to pointer alignment
+_Static_assert(sizeof(ADS1115_Handle_t) <= (ADS1115_HANDLE_PTRS * sizeof(void*) + 22 + sizeof(void*) - 1) / sizeof(void*) * sizeof(void*),
+               "ADS1115 compact handle grew");
+#endif
+_Static_assert(sizeof(ADS1115_Frame_t) == 3, "ADS1115 register frame is not packed");
+
+ /* ========================== I/O Helpers ============================ */
+
+static HAL_StatusTypeDef ADS1115_Transmit(ADS1115_Handle_t* hads1115, uint8_t* data, uint16_t size)
+{
+    HAL_StatusTypeDef status;
+    DRIVER_TRACE_TXN_BEGIN();
+#ifdef USE_I2CBUS
+    status = I2CBus_Transmit(hads1115->bus_client, hads1115->I2C_address, data, size);
+#else
+    DmaCache_Clean(data, size);
+    status = HAL_I2C_Master_Transmit_DMA(hads1115->i2c_handle, hads1115->I2C_address, data, size);
+#endif
+    DRIVER_TRACE_TXN_END(hads1115->I2C_address, DRIVER_TRACE_NO_REG, size, DRIVER_TRACE_OP_TRANSMIT, status);
+    return status;
+}
+
+static HAL_StatusTypeDef ADS1115_Receive(ADS1115_Handle_t* hads1115, uint8_t* data, uint16_t size)
+{
+    HAL_StatusTypeDef status;
+    DRIVER_TRACE_TXN_BEGIN();
+#ifdef USE_I2CBUS
+    status = I2CBus_Receive(hads1115->bus_client, hads1115->I2C_address, data, size);
+#else
+#ifdef DRIVERS_DCACHE
+    DmaCache_RxStart(&hads1115->dmaRx, data, size);
+#endif
+    status = HAL_I2C_Master_Receive_DMA(hads1115->i2c_handle, hads1115->I2C_address, data, size);
+#endif
+    DRIVER_TRACE_TXN_END(hads1115->I2C_address, DRIVER_TRACE_NO_REG, size, DRIVER_TRACE_OP_RECEIVE, status);
+    return status;
+}
+
+ // Register access for RegCore, through the register's frame in the mirror.
+ // A read sets the pointer register, then receives the value in a second transfer.
+static HAL_StatusTypeDef ADS1115_ReadRegs(void* dev, uint8_t reg, uint8_t* data, uint16_t size)
+{
+    ADS1115_Handle_t* hads1115 = (ADS1115_Handle_t*)dev;
+    HAL_StatusTypeDef status;
+    hads1115->Reg[reg].ptr = reg;
+    status = ADS1115_Transmit(hads1115, &hads1115->Reg[reg].ptr, 1);
+    if(status != HAL_OK) return status;
+    return ADS1115_Receive(hads1115, data, size);
+}
+
+ // A write is one transaction: the chip takes the first byte after its address
+ // as the pointer, so the value cannot follow in a transfer of its own
+static HAL_StatusTypeDef ADS1115_WriteRegs(void* dev, uint8_t reg, uint8_t* data, uint16_t size)
+{
+    ADS1115_Handle_t* hads1115 = (ADS1115_Handle_t*)dev;
+    (void)data; // Always Reg[reg].value
+    hads1115->Reg[reg].ptr = reg;
+    return ADS1115_Transmit(hads1115, &hads1115->Reg[reg].ptr, (uint16_t)(1 + size));
+}
+
+ /* ========================== Register Table ============================ */
+
+// Reg[] index and pointer register value are the same; every register is 16 bits, MSB first
+#define ADS1115_VALUE(reg) (uint8_t)(offsetof(ADS1115_Frame_t, value) + (reg) * sizeof(ADS1115_Frame_t))
+
+static const RegCore_Reg_t ads1115Regs[] = {
+    [ADS1115_REG_CONVERSION] = {ADS1115_REG_CONVERSION, ADS1115_VALUE(0), 2, REGCORE_BIG_ENDIAN | REGCORE_VOLATILE | REGCORE_READ_ONLY, 0},
+    [ADS1115_REG_CONFIG]     = {ADS1115_REG_CONFIG,     ADS1115_VALUE(1), 2, REGCORE_BIG_ENDIAN, ADS1115_OS_MASK}, // OS reads back as the conversion status
+    [ADS1115_REG_LO_THRESH]  = {ADS1115_REG_LO_THRESH,  ADS1115_VALUE(2), 2, REGCORE_BIG_ENDIAN, 0},
+    [ADS1115_REG_HI_THRESH]  = {ADS1115_REG_HI_THRESH,  ADS1115_VALUE(3), 2, REGCORE_BIG_ENDIAN, 0},
+};
+
+enum {
+    ADS1115_FIELD_OS,
+    ADS1115_FIELD_MUX,
+    ADS1115_FIELD_PGA,
+    ADS1115_FIELD_MODE,
+    ADS1115_FIELD_DR,
+    ADS1115_FIELD_COMP,      // All five comparator bits
+    ADS1115_FIELD_COMP_MODE,
+    ADS1115_FIELD_COMP_POL,
+    ADS1115_FIELD_COMP_LAT,
+    ADS1115_FIELD_COMP_QUE,
+};
+
+static const RegCore_Field_t ads1115Fields[] = {
+    [ADS1115_FIELD_OS]        = {ADS1115_REG_CONFIG, 15, 0x8000},
+    [ADS1115_FIELD_MUX]       = {ADS1115_REG_CONFIG, 12, 0x7000},
+    [ADS1115_FIELD_PGA]       = {ADS1115_REG_CONFIG, 9,  0x0E00},
+    [ADS1115_FIELD_MODE]      = {ADS1115_REG_CONFIG, 8,  0x0100},
+    [ADS1115_FIELD_DR]        = {ADS1115_REG_CONFIG, 5,  0x00E0},
+    [ADS1115_FIELD_COMP]      = {ADS1115_REG_CONFIG, 0,  0x001F},
+    [ADS1115_FIELD_COMP_MODE] = {ADS1115_REG_CONFIG, 4,  0x0010},
+    [ADS1115_FIELD_COMP_POL]  = {ADS1115_REG_CONFIG, 3,  0x0008},
+    [ADS1115_FIELD_COMP_LAT]  = {ADS1115_REG_CONFIG, 2,  0x0004},
+    [ADS1115_FIELD_COMP_QUE]  = {ADS1115_REG_CONFIG, 0,  0x0003},
+};
+
+static const RegCore_Desc_t ads1115Desc = {
+    .regs = ads1115Regs,
+    .fields = ads1115Fields,
+    .read = ADS1115_ReadRegs,
+    .write = ADS1115_WriteRegs,
+    .mirror = offsetof(ADS1115_Handle_t, Reg),
+    .state = offsetof(ADS1115_Handle_t, regState),
+    .count = sizeof(ads1115Regs) / sizeof(ads1115Regs[0]),
+    .flags = 0, // No auto-increment: one register per transaction
+};
+
+// Fletcher-16 of a calibration blob
+static uint16_t ADS1115_CalChecksum(const uint8_t* data, uint16_t len)
+{
+    uint16_t sum1 = 0, sum2 = 0;
+    for (uint16_t i = 0; i < len; i++) {
+        sum1 = (uint16_t)((sum1 + data[i]) % 255);
+        sum2 = (uint16_t)((sum2 + sum1) % 255);
+    }
+    return (uint16_t)(sum2 << 8 | sum1);
+}
+
+static void ADS1115_PutU32(uint8_t* p, uint32_t value)
+{
+    p[0] = (uint8_t)value;
+    p[1] = (uint8_t)(value >> 8);
+    p[2] = (uint8_t)(value >> 16);
+    p[3] = (uint8_t)(value >> 24);
+}
+
+static uint32_t ADS1115_GetU32(const uint8_t* p)
+{
+    return (uint32_t)p[0] | (uint32_t)p[1] << 8 | (uint32_t)p[2] << 16 | (uint32_t)p[3] << 24;
+}
+
+static int64_t ADS1115_DivRound(int64_t num, int64_t den)
+{
+    return ((num < 0) == (den < 0)) ? (num + den / 2) / den : (num - den / 2) / den;
+}
+
+// Comparator setters take their *_MASK defines, the bits already in place
+static HAL_StatusTypeDef ADS1115_UpdateConfig(ADS1115_Handle_t* hads1115, uint8_t field, uint16_t bits)
+{
+    return RegCore_Update(&ads1115Desc, hads1115, ADS1115_REG_CONFIG, ads1115Fields[field].mask, bits);
+}
+
  /* ========================== Function Definitions ============================ */
 
 /**
@@ -30,19 +188,38 @@
  * @param pga Programmable gain amplifier setting
  * @param sampleRate Data rate configuration
  * @return HAL_StatusTypeDef HAL_OK on success, error code otherwise
+ * @details Starts a fresh register mirror, the threshold registers are read
+ *          again the first time they are needed. Calibration is off until
+ *          ADS1115_SetCalibration().
  */
 HAL_StatusTypeDef ADS1115_Init(ADS1115_Handle_t* hads1115,uint16_t mode,sChannel_t channel, uint16_t pga, uint16_t sampleRate)
 {     
-    HAL_StatusTypeDef status;
+    DRIVER_TRACE_API(hads1115);
     memset(hads1115->Reg,0,sizeof(hads1115->Reg)); // Clear register buffer
-    hads1115->ptr_reg = ADS1115_REG_CONFIG;
+    RegCore_Invalidate(&ads1115Desc, hads1115);
+    hads1115->cal = NULL;
+    hads1115->channel = channel;
     uint16_t channel_config = 0;
     channel_config = (uint16_t)channel << 12;
-    hads1115->Reg[ADS1115_REG_CONFIG] = channel_config | pga | mode | sampleRate | ADS1115_COMP_QUE_DISABLE_MASK;
-    status = HAL_I2C_Master_Transmit_DMA(hads1115->i2c_handle, hads1115->I2C_address, &hads1115->ptr_reg, 1);
-    if(status != HAL_OK) return status;
-    status = HAL_I2C_Master_Transmit_DMA(hads1115->i2c_handle, hads1115->I2C_address, (uint8_t*)&hads1115->Reg[ADS1115_REG_CONFIG], 2);
-    return status;   
+    RegCore_Stage(&ads1115Desc, hads1115, ADS1115_REG_CONFIG, channel_config | pga | mode | sampleRate | ADS1115_COMP_QUE_DISABLE_MASK);
+    return RegCore_Flush(&ads1115Desc, hads1115);
+}
+
+/**
+ * @brief Write a complete configuration register word
+ * @param hads1115 Pointer to ADS1115 handle structure
+ * @param config Register word, normally a constant built with ADS1115_CONFIG()
+ * @return HAL_StatusTypeDef HAL_OK on success, error code otherwise
+ * @details The word is not assembled or checked at run time and the other
+ *          register mirrors are kept. Nothing is sent when the mirror already
+ *          holds the word.
+ */
+HAL_StatusTypeDef ADS1115_WriteConfig(ADS1115_Handle_t* hads1115, uint16_t config)
+{
+    DRIVER_TRACE_API(hads1115);
+    hads1115->channel = (sChannel_t)((config >> 12) & 0x07);
+    RegCore_Stage(&ads1115Desc, hads1115, ADS1115_REG_CONFIG, config);
+    return RegCore_Flush(&ads1115Desc, hads1115);
 }
 
 /**
@@ -53,28 +230,34 @@ HAL_StatusTypeDef ADS1115_Init(ADS1115_Handle_t* hads1115,uint16_t mode,sChannel
  */
 HAL_StatusTypeDef ADS1115_ReadConfigReg(ADS1115_Handle_t* hads1115)
 {
-    HAL_StatusTypeDef status;
-    hads1115->ptr_reg = ADS1115_REG_CONFIG;
-    status = HAL_I2C_Master_Transmit_DMA(hads1115->i2c_handle, hads1115->I2C_address, &hads1115->ptr_reg, 1);
-    if(status != HAL_OK) return status;
-    status = HAL_I2C_Master_Receive_DMA(hads1115->i2c_handle, hads1115->I2C_address, (uint8_t*)&hads1115->Reg[ADS1115_REG_CONFIG], 2);
-    return status;
+    DRIVER_TRACE_API(hads1115);
+    return RegCore_Load(&ads1115Desc, hads1115, ADS1115_REG_CONFIG, 1);
 }
 
 /**
  * @brief Read the conversion register containing ADC result
  * @param hads1115 Pointer to ADS1115 handle structure
  * @return HAL_StatusTypeDef HAL_OK on success, error code otherwise
- * @details Reads the latest conversion result from the ADC's conversion register using DMA
+ * @details Reads the latest conversion result from the ADC's conversion register using DMA.
+ *          The result is left MSB first in Reg[], decode it with ADS1115_REG_VALUE().
  */
 HAL_StatusTypeDef ADS1115_ReadConversionReg(ADS1115_Handle_t* hads1115)
 {
-    HAL_StatusTypeDef status;
-    hads1115->ptr_reg = ADS1115_REG_CONVERSION;
-    status = HAL_I2C_Master_Transmit_DMA(hads1115->i2c_handle, hads1115->I2C_address, &hads1115->ptr_reg, 1);
-    if(status != HAL_OK) return status;
-    status = HAL_I2C_Master_Receive_DMA(hads1115->i2c_handle, hads1115->I2C_address, (uint8_t*)&hads1115->Reg[ADS1115_REG_CONVERSION], 2);
-    return status;
+    DRIVER_TRACE_API(hads1115);
+    return RegCore_Load(&ads1115Desc, hads1115, ADS1115_REG_CONVERSION, 1);
+}
+
+/**
+ * @brief Take register values read outside the driver into the mirror
+ * @param hads1115 Pointer to ADS1115 handle structure
+ * @param first First register address
+ * @param regs Register bytes as read from the chip, MSB first
+ * @param count Number of registers
+ * @details For callers that read the chip themselves, e.g. asynchronously at boot.
+ */
+void ADS1115_LoadRegs(ADS1115_Handle_t* hads1115, uint8_t first, const uint8_t* regs, uint8_t count)
+{
+    RegCore_Merge(&ads1115Desc, hads1115, first, regs, count);
 }
 
 /**
@@ -87,15 +270,10 @@ HAL_StatusTypeDef ADS1115_ReadConversionReg(ADS1115_Handle_t* hads1115)
  */
 HAL_StatusTypeDef ADS1115_SetChannel(ADS1115_Handle_t* hads1115, sChannel_t channel)
 {
+    DRIVER_TRACE_API(hads1115);
     HAL_StatusTypeDef status;
-    ADS1115_ReadConfigReg(hads1115);
-    if(status != HAL_OK) return status;
-    hads1115->Reg[ADS1115_REG_CONFIG] &= ~0x7000; // Clear MUX bits
-    hads1115->Reg[ADS1115_REG_CONFIG] |= (uint16_t)channel << 12; // Set new channel
-    hads1115->ptr_reg = ADS1115_REG_CONFIG;
-    status = HAL_I2C_Master_Transmit_DMA(hads1115->i2c_handle, hads1115->I2C_address, &hads1115->ptr_reg, 1);
-    if(status != HAL_OK) return status;
-    status = HAL_I2C_Master_Transmit_DMA(hads1115->i2c_handle, hads1115->I2C_address, (uint8_t*)&hads1115->Reg[ADS1115_REG_CONFIG], 2);
+    hads1115->channel = channel;
+    status = RegCore_SetField(&ads1115Desc, hads1115, ADS1115_FIELD_MUX, (uint16_t)channel);
     if(status != HAL_OK) return status;
     
     // Add delay for the slowest possible conversion (8 SPS = 125ms)
@@ -113,16 +291,8 @@ HAL_StatusTypeDef ADS1115_SetChannel(ADS1115_Handle_t* hads1115, sChannel_t chan
  */
 HAL_StatusTypeDef ADS1115_SetSampleRate(ADS1115_Handle_t* hads1115, sSampleRate_t rate)
 {
-    HAL_StatusTypeDef status;
-    ADS1115_ReadConfigReg(hads1115);
-    if(status != HAL_OK) return status;
-    hads1115->Reg[ADS1115_REG_CONFIG] &= ~0x00E0; // Clear sample rate bits
-    hads1115->Reg[ADS1115_REG_CONFIG] |= (uint16_t)rate << 5; // Set new sample rate
-    hads1115->ptr_reg = ADS1115_REG_CONFIG;
-    status = HAL_I2C_Master_Transmit_DMA(hads1115->i2c_handle, hads1115->I2C_address, &hads1115->ptr_reg, 1);
-    if(status != HAL_OK) return status;
-    status = HAL_I2C_Master_Transmit_DMA(hads1115->i2c_handle, hads1115->I2C_address, (uint8_t*)&hads1115->Reg[ADS1115_REG_CONFIG], 2);
-    return status;
+    DRIVER_TRACE_API(hads1115);
+    return RegCore_SetField(&ads1115Desc, hads1115, ADS1115_FIELD_DR, (uint16_t)rate);
 }
 
 /**
@@ -133,15 +303,8 @@ HAL_StatusTypeDef ADS1115_SetSampleRate(ADS1115_Handle_t* hads1115, sSampleRate_
  */
 HAL_StatusTypeDef ADS1115_SetSSMode(ADS1115_Handle_t* hads1115)
 {
-    HAL_StatusTypeDef status;
-    ADS1115_ReadConfigReg(hads1115);
-    if(status != HAL_OK) return status;
-    hads1115->Reg[ADS1115_REG_CONFIG] |= 0x0100; // Set to single-shot mode
-    hads1115->ptr_reg = ADS1115_REG_CONFIG;
-    status = HAL_I2C_Master_Transmit_DMA(hads1115->i2c_handle, hads1115->I2C_address, &hads1115->ptr_reg, 1);
-    if(status != HAL_OK) return status;
-    status = HAL_I2C_Master_Transmit_DMA(hads1115->i2c_handle, hads1115->I2C_address, (uint8_t*)&hads1115->Reg[ADS1115_REG_CONFIG], 2);
-    return status;
+    DRIVER_TRACE_API(hads1115);
+    return RegCore_SetField(&ads1115Desc, hads1115, ADS1115_FIELD_MODE, 1);
 }
 
 /**
@@ -152,15 +315,40 @@ HAL_StatusTypeDef ADS1115_SetSSMode(ADS1115_Handle_t* hads1115)
  */
 HAL_StatusTypeDef ADS1115_StartSSConv(ADS1115_Handle_t* hads1115)
 {
-    HAL_StatusTypeDef status;
-    ADS1115_ReadConfigReg(hads1115);
-    if(status != HAL_OK) return status;
-    hads1115->Reg[ADS1115_REG_CONFIG] |= ADS1115_OS_MASK; // Start single-shot conversion
-    hads1115->ptr_reg = ADS1115_REG_CONFIG;
-    status = HAL_I2C_Master_Transmit_DMA(hads1115->i2c_handle, hads1115->I2C_address, &hads1115->ptr_reg, 1);
-    if(status != HAL_OK) return status;
-    status = HAL_I2C_Master_Transmit_DMA(hads1115->i2c_handle, hads1115->I2C_address, (uint8_t*)&hads1115->Reg[ADS1115_REG_CONFIG], 2);
-    return status;
+    DRIVER_TRACE_API(hads1115);
+    return RegCore_SetField(&ads1115Desc, hads1115, ADS1115_FIELD_OS, 1);
+}
+
+/**
+ * @brief Select an input and start a single-shot conversion
+ * @param hads1115 Pointer to ADS1115 handle structure
+ * @param channel Input channel selection from sChannel_t enum
+ * @return HAL_StatusTypeDef HAL_OK on success, error code otherwise
+ * @details Builds the configuration from the register mirror, which is only
+ *          read from the chip the first time, and does not wait, so inputs can
+ *          be scanned without idling the bus. The result is ready
+ *          ADS1115_ConversionTimeUs() later.
+ */
+HAL_StatusTypeDef ADS1115_StartConversion(ADS1115_Handle_t* hads1115, sChannel_t channel)
+{
+    DRIVER_TRACE_API(hads1115);
+    hads1115->channel = channel;
+    return RegCore_Update(&ads1115Desc, hads1115, ADS1115_REG_CONFIG, 0x7000 | ADS1115_OS_MASK | ADS1115_MODE_SINGLESHOT_MASK,
+                          ((uint16_t)channel << 12) | ADS1115_OS_MASK | ADS1115_MODE_SINGLESHOT_MASK);
+}
+
+/**
+ * @brief Worst-case duration of one conversion at the configured data rate
+ * @param hads1115 Pointer to ADS1115 handle structure
+ * @return uint32_t Microseconds from the start of a single-shot conversion to its result
+ * @details One data period stretched by the oscillator tolerance, plus the wake-up time.
+ *          ADS1115_CONV_US() is the compile-time equivalent.
+ */
+uint32_t ADS1115_ConversionTimeUs(const ADS1115_Handle_t* hads1115)
+{
+    static const uint16_t sps[8] = {8, 16, 32, 64, 128, 250, 475, 860};
+    uint32_t rate = sps[RegCore_GetField(&ads1115Desc, hads1115, ADS1115_FIELD_DR)];
+    return (1000000u * (100u + ADS1115_OSC_TOLERANCE_PCT) / 100u + rate - 1u) / rate + ADS1115_WAKEUP_US;
 }
 
 /**
@@ -170,23 +358,15 @@ HAL_StatusTypeDef ADS1115_StartSSConv(ADS1115_Handle_t* hads1115)
  * @param hi_thresh High threshold value
  * @return HAL_StatusTypeDef HAL_OK on success, error code otherwise
  * @details Programs both the high and low threshold registers used by the 
- *          ADS1115's built-in comparator function
+ *          ADS1115's built-in comparator function. A register that already
+ *          holds its value is not written again.
  */
 HAL_StatusTypeDef ADS1115_SetThresholds(ADS1115_Handle_t* hads1115, uint16_t lo_thresh, uint16_t hi_thresh)
 {
-    HAL_StatusTypeDef status;
-    hads1115->Reg[ADS1115_REG_LO_THRESH] = lo_thresh;
-    hads1115->Reg[ADS1115_REG_HI_THRESH] = hi_thresh;
-    hads1115->ptr_reg = ADS1115_REG_LO_THRESH;
-    status = HAL_I2C_Master_Transmit_DMA(hads1115->i2c_handle, hads1115->I2C_address, &hads1115->ptr_reg, 1);
-    if(status != HAL_OK) return status;
-    status = HAL_I2C_Master_Transmit_DMA(hads1115->i2c_handle, hads1115->I2C_address, (uint8_t*)&hads1115->Reg[ADS1115_REG_LO_THRESH], 2);
-    if(status != HAL_OK) return status;
-    hads1115->ptr_reg = ADS1115_REG_HI_THRESH;
-    status = HAL_I2C_Master_Transmit_DMA(hads1115->i2c_handle, hads1115->I2C_address, &hads1115->ptr_reg, 1);
-    if(status != HAL_OK) return status;
-    status = HAL_I2C_Master_Transmit_DMA(hads1115->i2c_handle, hads1115->I2C_address, (uint8_t*)&hads1115->Reg[ADS1115_REG_HI_THRESH], 2);
-    return status;
+    DRIVER_TRACE_API(hads1115);
+    RegCore_Stage(&ads1115Desc, hads1115, ADS1115_REG_LO_THRESH, lo_thresh);
+    RegCore_Stage(&ads1115Desc, hads1115, ADS1115_REG_HI_THRESH, hi_thresh);
+    return RegCore_Flush(&ads1115Desc, hads1115);
 }
 
 /**
@@ -202,16 +382,8 @@ HAL_StatusTypeDef ADS1115_SetThresholds(ADS1115_Handle_t* hads1115, uint16_t lo_
  */
 HAL_StatusTypeDef ADS1115_Comp_Init(ADS1115_Handle_t* hads1115, uint16_t mode, uint16_t pol, uint16_t lat, uint16_t que)
 {
-    HAL_StatusTypeDef status;
-    ADS1115_ReadConfigReg(hads1115);
-    if(status != HAL_OK) return status;
-    hads1115->Reg[ADS1115_REG_CONFIG] &= ~0x001F; // Clear comparator bits
-    hads1115->Reg[ADS1115_REG_CONFIG] |= mode | pol | lat | que; // Set comparator configuration
-    hads1115->ptr_reg = ADS1115_REG_CONFIG;
-    status = HAL_I2C_Master_Transmit_DMA(hads1115->i2c_handle, hads1115->I2C_address, &hads1115->ptr_reg, 1);
-    if(status != HAL_OK) return status;
-    status = HAL_I2C_Master_Transmit_DMA(hads1115->i2c_handle, hads1115->I2C_address, (uint8_t*)&hads1115->Reg[ADS1115_REG_CONFIG], 2);
-    return status;
+    DRIVER_TRACE_API(hads1115);
+    return ADS1115_UpdateConfig(hads1115, ADS1115_FIELD_COMP, mode | pol | lat | que);
 }
 
 /**
@@ -224,16 +396,8 @@ HAL_StatusTypeDef ADS1115_Comp_Init(ADS1115_Handle_t* hads1115, uint16_t mode, u
  */
 HAL_StatusTypeDef ADS1115_Comp_SetMode(ADS1115_Handle_t* hads1115, uint16_t mode)
 {
-    HAL_StatusTypeDef status;
-    ADS1115_ReadConfigReg(hads1115);
-    if(status != HAL_OK) return status;
-    hads1115->Reg[ADS1115_REG_CONFIG] &= ~0x0010; // Clear mode bit
-    hads1115->Reg[ADS1115_REG_CONFIG] |= mode; // Set new mode
-    hads1115->ptr_reg = ADS1115_REG_CONFIG;
-    status = HAL_I2C_Master_Transmit_DMA(hads1115->i2c_handle, hads1115->I2C_address, &hads1115->ptr_reg, 1);
-    if(status != HAL_OK) return status;
-    status = HAL_I2C_Master_Transmit_DMA(hads1115->i2c_handle, hads1115->I2C_address, (uint8_t*)&hads1115->Reg[ADS1115_REG_CONFIG], 2);
-    return status;
+    DRIVER_TRACE_API(hads1115);
+    return ADS1115_UpdateConfig(hads1115, ADS1115_FIELD_COMP_MODE, mode);
 }
 
 /**
@@ -246,16 +410,8 @@ HAL_StatusTypeDef ADS1115_Comp_SetMode(ADS1115_Handle_t* hads1115, uint16_t mode
  */
 HAL_StatusTypeDef ADS1115_Comp_SetPol(ADS1115_Handle_t* hads1115, uint16_t pol)
 {
-    HAL_StatusTypeDef status;
-    ADS1115_ReadConfigReg(hads1115);
-    if(status != HAL_OK) return status;
-    hads1115->Reg[ADS1115_REG_CONFIG] &= ~0x0008; // Clear polarity bit
-    hads1115->Reg[ADS1115_REG_CONFIG] |= pol; // Set new polarity
-    hads1115->ptr_reg = ADS1115_REG_CONFIG;
-    status = HAL_I2C_Master_Transmit_DMA(hads1115->i2c_handle, hads1115->I2C_address, &hads1115->ptr_reg, 1);
-    if(status != HAL_OK) return status;
-    status = HAL_I2C_Master_Transmit_DMA(hads1115->i2c_handle, hads1115->I2C_address, (uint8_t*)&hads1115->Reg[ADS1115_REG_CONFIG], 2);
-    return status;
+    DRIVER_TRACE_API(hads1115);
+    return ADS1115_UpdateConfig(hads1115, ADS1115_FIELD_COMP_POL, pol);
 }
 
 /**
@@ -268,16 +424,8 @@ HAL_StatusTypeDef ADS1115_Comp_SetPol(ADS1115_Handle_t* hads1115, uint16_t pol)
  */
 HAL_StatusTypeDef ADS1115_Comp_SetLat(ADS1115_Handle_t* hads1115, uint16_t lat)
 {
-    HAL_StatusTypeDef status;
-    ADS1115_ReadConfigReg(hads1115);
-    if(status != HAL_OK) return status;
-    hads1115->Reg[ADS1115_REG_CONFIG] &= ~0x0004; // Clear latching bit
-    hads1115->Reg[ADS1115_REG_CONFIG] |= lat; // Set new latching mode
-    hads1115->ptr_reg = ADS1115_REG_CONFIG;
-    status = HAL_I2C_Master_Transmit_DMA(hads1115->i2c_handle, hads1115->I2C_address, &hads1115->ptr_reg, 1);
-    if(status != HAL_OK) return status;
-    status = HAL_I2C_Master_Transmit_DMA(hads1115->i2c_handle, hads1115->I2C_address, (uint8_t*)&hads1115->Reg[ADS1115_REG_CONFIG], 2);
-    return status;
+    DRIVER_TRACE_API(hads1115);
+    return ADS1115_UpdateConfig(hads1115, ADS1115_FIELD_COMP_LAT, lat);
 }
 
 /**
@@ -290,15 +438,200 @@ HAL_StatusTypeDef ADS1115_Comp_SetLat(ADS1115_Handle_t* hads1115, uint16_t lat)
  */
 HAL_StatusTypeDef ADS1115_Comp_SetQue(ADS1115_Handle_t* hads1115, uint16_t que)
 {
-    HAL_StatusTypeDef status;
-    ADS1115_ReadConfigReg(hads1115);
-    if(status != HAL_OK) return status;
-    hads1115->Reg[ADS1115_REG_CONFIG] &= ~0x0003; // Clear queue bits
-    hads1115->Reg[ADS1115_REG_CONFIG] |= que; // Set new queue configuration
-    hads1115->ptr_reg = ADS1115_REG_CONFIG;
-    status = HAL_I2C_Master_Transmit_DMA(hads1115->i2c_handle, hads1115->I2C_address, &hads1115->ptr_reg, 1);
+    DRIVER_TRACE_API(hads1115);
+    return ADS1115_UpdateConfig(hads1115, ADS1115_FIELD_COMP_QUE, que);
+}
+
+/**
+ * @brief Select the calibration table applied to conversion results
+ * @param hads1115 Pointer to ADS1115 handle structure
+ * @param cal Table, kept by reference; NULL to turn correction off
+ * @details Call after ADS1115_Init(), which turns correction off.
+ */
+void ADS1115_SetCalibration(ADS1115_Handle_t* hads1115, const ADS1115_CalTable_t* cal)
+{
+    hads1115->cal = cal;
+}
+
+/**
+ * @brief Corrected conversion result from the register mirror
+ * @param hads1115 Pointer to ADS1115 handle structure
+ * @return int16_t Conversion register, corrected for the input and PGA of the
+ *         configuration mirror when a calibration table is set
+ * @details No bus access: call it after ADS1115_ReadConversionReg() or a
+ *          result taken in with ADS1115_LoadRegs(). The configuration mirror
+ *          is that of the last conversion started, so read each result before
+ *          starting the next conversion on another input.
+ */
+int16_t ADS1115_GetSample(const ADS1115_Handle_t* hads1115)
+{
+    int16_t raw = (int16_t)ADS1115_REG_VALUE(hads1115, ADS1115_REG_CONVERSION);
+    uint16_t config;
+    uint8_t pga;
+
+    if (hads1115->cal == NULL) {
+        return raw;
+    }
+    config = ADS1115_REG_VALUE(hads1115, ADS1115_REG_CONFIG);
+    pga = (uint8_t)((config >> 9) & 0x07);
+    if (pga > PGA_0_256V) pga = PGA_0_256V;
+    return ADS1115_CalApply(&hads1115->cal->coef[(config >> 12) & 0x07][pga], raw);
+}
+
+/**
+ * @brief Read the conversion register and correct it
+ * @param hads1115 Pointer to ADS1115 handle structure
+ * @param sample Receives the result of ADS1115_GetSample(), unchanged on error
+ * @return HAL_StatusTypeDef HAL_OK on success, error code otherwise
+ * @details Needs a read that has completed on return, as through the bus
+ *          manager. With the plain HAL DMA calls the result arrives later:
+ *          call ADS1115_GetSample() from the receive complete callback.
+ */
+HAL_StatusTypeDef ADS1115_ReadSample(ADS1115_Handle_t* hads1115, int16_t* sample)
+{
+    DRIVER_TRACE_API(hads1115);
+    HAL_StatusTypeDef status = RegCore_Load(&ads1115Desc, hads1115, ADS1115_REG_CONVERSION, 1);
     if(status != HAL_OK) return status;
-    status = HAL_I2C_Master_Transmit_DMA(hads1115->i2c_handle, hads1115->I2C_address, (uint8_t*)&hads1115->Reg[ADS1115_REG_CONFIG], 2);
-    return status;
+    *sample = ADS1115_GetSample(hads1115);
+    return HAL_OK;
+}
+
+/**
+ * @brief Correct one raw result
+ * @param coef Gain and bias of the input and PGA it was taken with
+ * @param raw Conversion register value
+ * @return int16_t (raw * gain + bias) rounded and saturated to 16 bits
+ */
+int16_t ADS1115_CalApply(const ADS1115_CalCoef_t* coef, int16_t raw)
+{
+    int64_t value = ((int64_t)raw * coef->gain + coef->bias + (1 << 15)) >> 16;
+    if (value > INT16_MAX) return INT16_MAX;
+    if (value < INT16_MIN) return INT16_MIN;
+    return (int16_t)value;
+}
+
+/**
+ * @brief Set every entry of a calibration table to no correction
+ */
+void ADS1115_CalReset(ADS1115_CalTable_t* cal)
+{
+    for (uint8_t mux = 0; mux < ADS1115_CAL_INPUTS; mux++) {
+        for (uint8_t pga = 0; pga < ADS1115_CAL_PGAS; pga++) {
+            cal->coef[mux][pga].bias = 0;
+            cal->coef[mux][pga].gain = ADS1115_CAL_UNITY;
+        }
+    }
+}
+
+/**
+ * @brief Derive gain and bias from two measured points
+ * @param coef Receives the coefficients, unchanged on error
+ * @param sumLo Sum of count results at the low point, e.g. with the input shorted
+ * @param idealLo Result the low point should give, e.g. 0
+ * @param sumHi Sum of count results at the high point, e.g. on a reference
+ * @param idealHi Result the high point should give, see ADS1115_FROM_UV()
+ * @param count Results summed per point, 1 for single readings
+ * @return HAL_StatusTypeDef HAL_ERROR if the points coincide, count is 0,
+ *         the gain is not positive or the bias exceeds +/-32768 counts
+ * @details Averaging keeps noise out of the coefficients, and the sums keep
+ *          the fraction of a count the averages carry.
+ */
+HAL_StatusTypeDef ADS1115_CalFromPoints(ADS1115_CalCoef_t* coef, int32_t sumLo, int32_t idealLo, int32_t sumHi, int32_t idealHi, uint16_t count)
+{
+    int64_t gain, bias;
+
+    if (count == 0 || sumHi == sumLo) {
+        return HAL_ERROR;
+    }
+    gain = ADS1115_DivRound(((int64_t)idealHi - idealLo) * count * ADS1115_CAL_UNITY, (int64_t)sumHi - sumLo);
+    if (gain <= 0 || gain > UINT32_MAX) {
+        return HAL_ERROR;
+    }
+    bias = (int64_t)idealLo * ADS1115_CAL_UNITY - ADS1115_DivRound((int64_t)sumLo * gain, count);
+    if (bias < INT32_MIN || bias > INT32_MAX) {
+        return HAL_ERROR;
+    }
+    coef->bias = (int32_t)bias;
+    coef->gain = (uint32_t)gain;
+    return HAL_OK;
+}
+
+/**
+ * @brief Serialize a calibration table, e.g. for flash or EEPROM
+ * @param cal Table
+ * @param buf Receives the blob, ADS1115_CAL_BLOB_MAX bytes always suffice
+ * @param size Size of buf
+ * @return uint16_t Length of the blob, 0 if buf is too small
+ * @details Only entries that correct something are stored: 6 bytes for a
+ *          table at unity, 9 more per calibrated input and PGA.
+ */
+uint16_t ADS1115_CalSave(const ADS1115_CalTable_t* cal, uint8_t* buf, uint16_t size)
+{
+    uint16_t len = 4;
+    uint16_t sum;
+
+    if (size < 6) {
+        return 0;
+    }
+    for (uint8_t mux = 0; mux < ADS1115_CAL_INPUTS; mux++) {
+        for (uint8_t pga = 0; pga < ADS1115_CAL_PGAS; pga++) {
+            const ADS1115_CalCoef_t* coef = &cal->coef[mux][pga];
+            if (coef->bias == 0 && coef->gain == ADS1115_CAL_UNITY) {
+                continue;
+            }
+            if (len + ADS1115_CAL_ENTRY_LEN + 2 > size) {
+                return 0;
+            }
+            buf[len++] = (uint8_t)(mux << 3 | pga);
+            ADS1115_PutU32(&buf[len], (uint32_t)coef->bias);
+            ADS1115_PutU32(&buf[len + 4], coef->gain);
+            len += 8;
+        }
+    }
+    buf[0] = 'A';
+    buf[1] = 'C';
+    buf[2] = ADS1115_CAL_VERSION;
+    buf[3] = (uint8_t)((len - 4) / ADS1115_CAL_ENTRY_LEN);
+    sum = ADS1115_CalChecksum(buf, len);
+    buf[len++] = (uint8_t)(sum & 0xFF);
+    buf[len++] = (uint8_t)(sum >> 8);
+    return len;
 }
 
+/**
+ * @brief Restore a calibration table saved with ADS1115_CalSave()
+ * @param cal Receives the table, unchanged on error
+ * @param buf Blob
+ * @param len Length of the blob
+ * @return HAL_StatusTypeDef HAL_ERROR if the blob is truncated, corrupt or of
+ *         another version
+ * @details Entries missing from the blob are set to no correction.
+ */
+HAL_StatusTypeDef ADS1115_CalLoad(ADS1115_CalTable_t* cal, const uint8_t* buf, uint16_t len)
+{
+    uint16_t entries;
+
+    if (len < 6 || buf[0] != 'A' || buf[1] != 'C' || buf[2] != ADS1115_CAL_VERSION) {
+        return HAL_ERROR;
+    }
+    entries = buf[3];
+    if (len != 4 + entries * ADS1115_CAL_ENTRY_LEN + 2 ||
+        ADS1115_CalChecksum(buf, (uint16_t)(len - 2)) != (uint16_t)(buf[len - 2] | buf[len - 1] << 8)) {
+        return HAL_ERROR;
+    }
+    for (uint16_t i = 0; i < entries; i++) {
+        uint8_t key = buf[4 + i * ADS1115_CAL_ENTRY_LEN];
+        if ((key >> 3) >= ADS1115_CAL_INPUTS || (key & 0x07) >= ADS1115_CAL_PGAS) {
+            return HAL_ERROR;
+        }
+    }
+
+    ADS1115_CalReset(cal);
+    for (uint16_t i = 0; i < entries; i++) {
+        const uint8_t* entry = &buf[4 + i * ADS1115_CAL_ENTRY_LEN];
+        ADS1115_CalCoef_t* coef = &cal->coef[entry[0] >> 3][entry[0] & 0x07];
+        coef->bias = (int32_t)ADS1115_GetU32(&entry[1]);
+        coef->gain = ADS1115_GetU32(&entry[5]);
+    }
+    return HAL_OK;
+}
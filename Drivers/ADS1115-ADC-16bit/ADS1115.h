@@ -1,6 +1,11 @@
 #ifndef ADS1115_H
 #define ADS1115_H
 #include "main.h"
+#include "RegCore.h"
+#include "DmaCache.h"
+#ifdef USE_I2CBUS
+#include "I2CBus.h"
+#endif
 /*------------------- Regester Address Defines ---------------------------*/
 #define ADS1115_REG_CONVERSION 0x00
 #define ADS1115_REG_CONFIG     0x01
@@ -51,6 +56,63 @@
 #define ADS1115_COMP_QUE_4_MASK 0x0002 // Assert ALERT/RDY after four conversions
 #define ADS1115_COMP_QUE_DISABLE_MASK 0x0003 // Disable the comparator and put ALERT/RDY in high state (default)
 
+/************************ Timing defines ********************************/
+#define ADS1115_WAKEUP_US 25 // Power-up before a single-shot conversion starts
+#define ADS1115_OSC_TOLERANCE_PCT 10 // Internal oscillator accuracy, conversions may take this much longer
+
+/************************ Compile-time Configuration ********************************/
+// ADS1115_CONFIG() assembles the config register from field codes (sChannel_t,
+// sPGA_t, sSampleRate_t) as a constant expression. A field out of range, such as
+// a *_MASK passed where a code is expected, stops the build:
+//   static const uint16_t adcConfig = ADS1115_CONFIG(AIN0, PGA_4_096V, SPS_860, 1);
+//   ADS1115_WriteConfig(&hads1115, adcConfig);
+#define ADS1115_CHECK(cond, msg) (0u * sizeof(struct { _Static_assert(cond, msg); int unused; }))
+
+#define ADS1115_CONFIG(mux, pga, rate, singleShot) ((uint16_t)( \
+    ADS1115_CHECK((unsigned)(mux) - 1u <= 6u, "ADS1115: mux must be an sChannel_t") + \
+    ADS1115_CHECK((unsigned)(pga) <= 5u, "ADS1115: pga must be an sPGA_t code, not a mask") + \
+    ADS1115_CHECK((unsigned)(rate) <= 7u, "ADS1115: rate must be an sSampleRate_t code, not a mask") + \
+    ADS1115_CHECK((unsigned)(singleShot) <= 1u, "ADS1115: singleShot must be 0 or 1") + \
+    ((unsigned)(mux) << 12 | (unsigned)(pga) << 9 | (unsigned)(singleShot) << 8 | \
+     (unsigned)(rate) << 5 | ADS1115_COMP_QUE_DISABLE_MASK)))
+
+#define ADS1115_FSR_MV(pga) ((pga) == 0 ? 6144u : 8192u >> (pga)) // Full-scale range, mV
+#define ADS1115_LSB_PV(pga) ((uint32_t)((uint64_t)ADS1115_FSR_MV(pga) * 1000000000u / 32768u)) // One count, pV
+#define ADS1115_TO_UV(raw, pga) ((int32_t)((int64_t)(int16_t)(raw) * ADS1115_LSB_PV(pga) / 1000000)) // Conversion result to uV
+
+// Register word from the mirror, which holds every register MSB first as on the wire
+#define ADS1115_REG_VALUE(hads1115, reg) ((uint16_t)((hads1115)->Reg[reg].value[0] << 8 | (hads1115)->Reg[reg].value[1]))
+
+// Ideal conversion result of an input voltage, for calibration points
+#define ADS1115_FROM_UV(uv, pga) ((int32_t)(((int64_t)(uv) * 1000000 + ((uv) < 0 ? -1 : 1) * \
+    (int64_t)(ADS1115_LSB_PV(pga) / 2)) / (int64_t)ADS1115_LSB_PV(pga)))
+
+#define ADS1115_SPS(rate) ((rate) <= 4 ? 8u << (rate) : (rate) == 5 ? 250u : (rate) == 6 ? 475u : 860u)
+#define ADS1115_CONV_US(rate) ((1000000u * (100u + ADS1115_OSC_TOLERANCE_PCT) / 100u + ADS1115_SPS(rate) - 1u) \
+    / ADS1115_SPS(rate) + ADS1115_WAKEUP_US) // Single-shot start to result, worst case
+
+/************************ Calibration ********************************/
+// ADS1115_GetSample() corrects each result with the gain and bias of its
+// input and PGA: sat16((raw * gain + bias + 2^15) >> 16). Both are Q16.16,
+// so gain ADS1115_CAL_UNITY with bias 0 leaves the result as it is.
+#define ADS1115_CAL_UNITY  65536u
+#define ADS1115_CAL_INPUTS 8 // MUX codes: the sChannel_t values, and 0 for AIN0 - AIN1
+#define ADS1115_CAL_PGAS   6 // sPGA_t; the codes above PGA_0_256V use its entry
+
+// Blob, little-endian: "AC", u8 version, u8 entries, then per entry
+// u8 MUX << 3 | PGA, s32 bias, u32 gain, then the Fletcher-16 of all
+// bytes before it. Entries at unity are left out.
+#define ADS1115_CAL_VERSION 1
+#define ADS1115_CAL_ENTRY_LEN 9
+#define ADS1115_CAL_BLOB_MAX (4 + ADS1115_CAL_INPUTS * ADS1115_CAL_PGAS * ADS1115_CAL_ENTRY_LEN + 2)
+
+/************************ Handle Layout ********************************/
+// Define ADS1115_COMPACT_HANDLE (or DRIVERS_COMPACT_HANDLES for every driver) to drop
+// the padding from ADS1115_Handle_t on memory-constrained targets
+#if defined(DRIVERS_COMPACT_HANDLES) && !defined(ADS1115_COMPACT_HANDLE)
+#define ADS1115_COMPACT_HANDLE
+#endif
+
 /************************ Driver Structs ********************************/
 typedef enum {
     DIF_A0_A3 = 1,
@@ -74,23 +136,76 @@ typedef enum {
     
 }sSampleRate_t;
 
+typedef enum {
+    PGA_6_144V = 0,
+    PGA_4_096V = 1,
+    PGA_2_048V = 2,
+    PGA_1_024V = 3,
+    PGA_0_512V = 4,
+    PGA_0_256V = 5
+}sPGA_t;
+
+
+typedef struct {
+    int32_t bias;   // Counts added after the gain, Q16.16: minus the offset times the gain
+    uint32_t gain;  // Q16.16, ADS1115_CAL_UNITY for none
+} ADS1115_CalCoef_t;
+
+typedef struct {
+    ADS1115_CalCoef_t coef[ADS1115_CAL_INPUTS][ADS1115_CAL_PGAS]; // [MUX code][sPGA_t]
+} ADS1115_CalTable_t;
 
+// One register as a write goes on the wire: pointer byte, then the value MSB
+// first. The mirror keeps every register in this form, so a write is a single
+// 3-byte transfer straight from the handle and a read lands in value.
+typedef struct {
+    uint8_t ptr;
+    uint8_t value[2];
+} ADS1115_Frame_t;
 
+#ifdef ADS1115_COMPACT_HANDLE
+typedef struct {
+    I2C_HandleTypeDef* i2c_handle;
+#ifdef USE_I2CBUS
+    I2CBus_Client_t* bus_client; // Transfers go through the bus manager instead of i2c_handle
+#endif
+#if defined(DRIVERS_DCACHE) && !defined(USE_I2CBUS)
+    DmaCache_Rx_t dmaRx; // DMA read in flight on i2c_handle, for DmaCache_RxDone() in the receive callback
+#endif
+    const ADS1115_CalTable_t* cal; // NULL: results are not corrected
+    RegCore_State_t regState;
+    DMACACHE_REGION(RegLines, ADS1115_Frame_t Reg[4]); // Register mirror, DMA source and destination
+    uint8_t I2C_address;
+    uint8_t channel; // sChannel_t
+} ADS1115_Handle_t;
+#else
 typedef struct {
     I2C_HandleTypeDef* i2c_handle;
+#ifdef USE_I2CBUS
+    I2CBus_Client_t* bus_client; // Transfers go through the bus manager instead of i2c_handle
+#endif
+#if defined(DRIVERS_DCACHE) && !defined(USE_I2CBUS)
+    DmaCache_Rx_t dmaRx; // DMA read in flight on i2c_handle, for DmaCache_RxDone() in the receive callback
+#endif
+    const ADS1115_CalTable_t* cal; // NULL: results are not corrected
     uint8_t I2C_address;
     sChannel_t channel;
-    uint8_t ptr_reg;
-    uint16_t Reg[4]; // Register buffer
+    DMACACHE_REGION(RegLines, ADS1115_Frame_t Reg[4]); // Register mirror, DMA source and destination
+    RegCore_State_t regState;
 } ADS1115_Handle_t;
+#endif
 
 /*------------------- Function Declarations ---------------------------*/
 HAL_StatusTypeDef ADS1115_Init(ADS1115_Handle_t* hads1115,uint16_t mode,sChannel_t channel, uint16_t pga, uint16_t sampleRate);
+HAL_StatusTypeDef ADS1115_WriteConfig(ADS1115_Handle_t* hads1115, uint16_t config);
 HAL_StatusTypeDef ADS1115_ReadConfigReg(ADS1115_Handle_t* hads1115);
 HAL_StatusTypeDef ADS1115_ReadConversionReg(ADS1115_Handle_t* hads1115);
+void ADS1115_LoadRegs(ADS1115_Handle_t* hads1115, uint8_t first, const uint8_t* regs, uint8_t count);
 HAL_StatusTypeDef ADS1115_SetChannel(ADS1115_Handle_t* hads1115, sChannel_t channel);
 HAL_StatusTypeDef ADS1115_SetSampleRate(ADS1115_Handle_t* hads1115, sSampleRate_t rate);
 HAL_StatusTypeDef ADS1115_StartSSConv(ADS1115_Handle_t* hads1115);
+HAL_StatusTypeDef ADS1115_StartConversion(ADS1115_Handle_t* hads1115, sChannel_t channel);
+uint32_t ADS1115_ConversionTimeUs(const ADS1115_Handle_t* hads1115);
 HAL_StatusTypeDef ADS1115_SetSSMode(ADS1115_Handle_t* hads1115);
 HAL_StatusTypeDef ADS1115_SetThresholds(ADS1115_Handle_t* hads1115, uint16_t lo_thresh, uint16_t hi_thresh);
 HAL_StatusTypeDef ADS1115_Comp_Init(ADS1115_Handle_t* hads1115, uint16_t mode, uint16_t pol, uint16_t lat, uint16_t que);
@@ -98,6 +213,14 @@ HAL_StatusTypeDef ADS1115_Comp_SetMode(ADS1115_Handle_t* hads1115, uint16_t mode
 HAL_StatusTypeDef ADS1115_Comp_SetPol(ADS1115_Handle_t* hads1115, uint16_t pol);
 HAL_StatusTypeDef ADS1115_Comp_SetLat(ADS1115_Handle_t* hads1115, uint16_t lat);
 HAL_StatusTypeDef ADS1115_Comp_SetQue(ADS1115_Handle_t* hads1115, uint16_t que);
+void ADS1115_SetCalibration(ADS1115_Handle_t* hads1115, const ADS1115_CalTable_t* cal);
+int16_t ADS1115_GetSample(const ADS1115_Handle_t* hads1115);
+HAL_StatusTypeDef ADS1115_ReadSample(ADS1115_Handle_t* hads1115, int16_t* sample);
+int16_t ADS1115_CalApply(const ADS1115_CalCoef_t* coef, int16_t raw);
+void ADS1115_CalReset(ADS1115_CalTable_t* cal);
+HAL_StatusTypeDef ADS1115_CalFromPoints(ADS1115_CalCoef_t* coef, int32_t sumLo, int32_t idealLo, int32_t sumHi, int32_t idealHi, uint16_t count);
+uint16_t ADS1115_CalSave(const ADS1115_CalTable_t* cal, uint8_t* buf, uint16_t size);
+HAL_StatusTypeDef ADS1115_CalLoad(ADS1115_CalTable_t* cal, const uint8_t* buf, uint16_t len);
 
 
 #endif // ADS1115_H
\ No newline at end of file
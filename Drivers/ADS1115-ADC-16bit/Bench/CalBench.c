@@ -0,0 +1,330 @@
+#define _POSIX_C_SOURCE 200809L // clock_gettime
+#include "CalBench.h"
+#include <math.h>
+#include <string.h>
+#include <time.h>
+
+/**
+ ******************************************************************************
+ * @file    CalBench.c
+ * @author  Yair Yamin
+ * @brief   Accuracy, cost and storage of the ADS1115 fixed-point calibration.
+ * @details Simulates an analog front end with its own offset and gain error
+ * per PGA, calibrates it from two noisy averaged points (shorted input and a
+ * reference at 80 % of full scale), then sweeps the whole input range.
+ *
+ * - accuracy: worst error of ADS1115_CalApply() and of the float correction
+ *   it replaces, against the true input in counts.
+ * - speed: host CPU time of ADS1115_GetSample() without a table, with one,
+ *   and of the float correction on the same mirror.
+ * - blob: ADS1115_CalSave()/ADS1115_CalLoad() round trips, and that a
+ *   corrupt or truncated blob is refused.
+ ******************************************************************************
+ */
+
+/* ========================== Defines ============================ */
+#define CAL_BENCH_OFFSET_MAX 40.0 // Front-end offset, +/- counts
+#define CAL_BENCH_GAIN_ERR   0.02 // Front-end gain error, +/-
+#define CAL_BENCH_NOISE      1.5  // Result noise, counts RMS
+#define CAL_BENCH_SWEEP_STEP 7    // Counts between swept inputs
+#define CAL_BENCH_RAWS       4096 // Distinct results cycled through by the speed test
+
+/* ========================== Global Variables ============================ */
+static uint32_t seed = 1;
+static volatile int32_t sink;
+
+/* ========================== Static Helpers ============================ */
+
+static uint64_t CalBench_CpuNs(void)
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_PROCESS_CPUTIME_ID, &ts);
+    return (uint64_t)ts.tv_sec * 1000000000u + (uint64_t)ts.tv_nsec;
+}
+
+static double CalBench_Uniform(void)
+{
+    seed = seed * 1664525u + 1013904223u;
+    return (double)(seed >> 8) / 16777216.0;
+}
+
+// Roughly normal, sum of four uniforms
+static double CalBench_Noise(void)
+{
+    return (CalBench_Uniform() + CalBench_Uniform() + CalBench_Uniform() + CalBench_Uniform() - 2.0) *
+           CAL_BENCH_NOISE * sqrt(3.0);
+}
+
+// What the ADC returns for a true input of x counts
+static int16_t CalBench_Convert(double x, double offset, double gain, int noisy)
+{
+    double raw = x * gain + offset + (noisy ? CalBench_Noise() : 0.0);
+    raw = floor(raw + 0.5);
+    if (raw > INT16_MAX) return INT16_MAX;
+    if (raw < INT16_MIN) return INT16_MIN;
+    return (int16_t)raw;
+}
+
+static int32_t CalBench_Sum(double x, double offset, double gain)
+{
+    int32_t sum = 0;
+    for (int i = 0; i < CAL_BENCH_POINT_AVG; i++) {
+        sum += CalBench_Convert(x, offset, gain, 1);
+    }
+    return sum;
+}
+
+static void CalBench_SetMirror(ADS1115_Handle_t *hads1115, uint8_t reg, uint16_t value)
+{
+    hads1115->Reg[reg].value[0] = (uint8_t)(value >> 8);
+    hads1115->Reg[reg].value[1] = (uint8_t)value;
+}
+
+static int CalBench_SameTable(const ADS1115_CalTable_t *a, const ADS1115_CalTable_t *b)
+{
+    for (uint8_t mux = 0; mux < ADS1115_CAL_INPUTS; mux++) {
+        for (uint8_t pga = 0; pga < ADS1115_CAL_PGAS; pga++) {
+            if (a->coef[mux][pga].bias != b->coef[mux][pga].bias || a->coef[mux][pga].gain != b->coef[mux][pga].gain) {
+                return 0;
+            }
+        }
+    }
+    return 1;
+}
+
+static CalBench_Result_t *CalBench_Add(CalBench_Result_t *results, uint16_t *count, uint16_t max,
+                                       const char *name, const char *variant)
+{
+    CalBench_Result_t *r;
+    if (*count >= max) {
+        return NULL;
+    }
+    r = &results[(*count)++];
+    memset(r, 0, sizeof(*r));
+    snprintf(r->name, sizeof(r->name), "%s", name);
+    r->variant = variant;
+    return r;
+}
+
+// The float correction the table replaces, on the same mirror
+typedef struct {
+    float offset[ADS1115_CAL_INPUTS][ADS1115_CAL_PGAS];
+    float gain[ADS1115_CAL_INPUTS][ADS1115_CAL_PGAS];
+} CalBench_FloatTable_t;
+
+__attribute__((noinline)) static float CalBench_FloatSample(const ADS1115_Handle_t *hads1115, const CalBench_FloatTable_t *cal)
+{
+    int16_t raw = (int16_t)ADS1115_REG_VALUE(hads1115, ADS1115_REG_CONVERSION);
+    uint16_t config = ADS1115_REG_VALUE(hads1115, ADS1115_REG_CONFIG);
+    uint8_t mux = (uint8_t)((config >> 12) & 0x07);
+    uint8_t pga = (uint8_t)((config >> 9) & 0x07);
+    if (pga > PGA_0_256V) pga = PGA_0_256V;
+    return ((float)raw - cal->offset[mux][pga]) * cal->gain[mux][pga];
+}
+
+ /* ========================== Function Definitions ============================ */
+
+/**
+ * @brief Calibrate a simulated front end per PGA and sweep the input range
+ * @return uint16_t Results written, two per PGA
+ */
+uint16_t CalBench_Accuracy(CalBench_Result_t *results, uint16_t max)
+{
+    static const char *pgaNames[ADS1115_CAL_PGAS] = {"6v144", "4v096", "2v048", "1v024", "0v512", "0v256"};
+    uint16_t count = 0;
+
+    for (uint8_t pga = 0; pga < ADS1115_CAL_PGAS; pga++) {
+        double offset = (CalBench_Uniform() * 2.0 - 1.0) * CAL_BENCH_OFFSET_MAX;
+        double gain = 1.0 + (CalBench_Uniform() * 2.0 - 1.0) * CAL_BENCH_GAIN_ERR;
+        int32_t refUv = (int32_t)(ADS1115_FSR_MV(pga) * 800u); // 80 % of full scale
+        int32_t idealHi = ADS1115_FROM_UV(refUv, pga);
+        int32_t sumLo = CalBench_Sum(0.0, offset, gain);
+        int32_t sumHi = CalBench_Sum(idealHi, offset, gain);
+        ADS1115_CalCoef_t coef = {0, ADS1115_CAL_UNITY};
+        float floatGain = (float)idealHi * CAL_BENCH_POINT_AVG / (float)(sumHi - sumLo);
+        float floatOffset = (float)sumLo / CAL_BENCH_POINT_AVG;
+        double fixedErr = 0.0, floatErr = 0.0;
+        uint32_t samples = 0;
+        char name[CAL_BENCH_NAME_LEN];
+        CalBench_Result_t *r;
+        HAL_StatusTypeDef status;
+
+        status = ADS1115_CalFromPoints(&coef, sumLo, 0, sumHi, idealHi, CAL_BENCH_POINT_AVG);
+        for (int32_t x = INT16_MIN; x <= INT16_MAX; x += CAL_BENCH_SWEEP_STEP) {
+            int16_t raw = CalBench_Convert(x, offset, gain, 0);
+            int16_t fixed;
+            float corrected;
+            if (raw == INT16_MAX || raw == INT16_MIN) {
+                continue; // Clipped by the ADC, nothing to correct
+            }
+            fixed = ADS1115_CalApply(&coef, raw);
+            corrected = ((float)raw - floatOffset) * floatGain;
+            if (fixed != INT16_MAX && fixed != INT16_MIN && fabs((double)fixed - x) > fixedErr) fixedErr = fabs((double)fixed - x);
+            if (fabs(corrected - x) > floatErr) floatErr = fabs(corrected - x);
+            samples++;
+        }
+
+        snprintf(name, sizeof(name), "accuracy_%s", pgaNames[pga]);
+        if ((r = CalBench_Add(results, &count, max, name, "fixed")) != NULL) {
+            r->samples = samples;
+            r->maxErr = fixedErr;
+            r->bytes = sizeof(ADS1115_CalCoef_t);
+            r->pass = status == HAL_OK && fixedErr <= floatErr + 0.5; // Rounding to whole counts
+        }
+        if ((r = CalBench_Add(results, &count, max, name, "float")) != NULL) {
+            r->samples = samples;
+            r->maxErr = floatErr;
+            r->bytes = 2 * sizeof(float);
+            r->pass = 1;
+        }
+    }
+    return count;
+}
+
+/**
+ * @brief Time the sample path without a table, with one, and in float
+ * @return uint16_t Results written
+ */
+uint16_t CalBench_Speed(CalBench_Result_t *results, uint16_t max)
+{
+    static ADS1115_CalTable_t cal;
+    static CalBench_FloatTable_t floatCal;
+    static int16_t raws[CAL_BENCH_RAWS];
+    static const char *variants[3] = {"raw", "fixed", "float"};
+    ADS1115_Handle_t hads1115;
+    uint16_t count = 0;
+
+    memset(&hads1115, 0, sizeof(hads1115));
+    ADS1115_CalReset(&cal);
+    for (uint8_t mux = 0; mux < ADS1115_CAL_INPUTS; mux++) {
+        for (uint8_t pga = 0; pga < ADS1115_CAL_PGAS; pga++) {
+            cal.coef[mux][pga].gain = ADS1115_CAL_UNITY - 200 + mux * 20 + pga;
+            cal.coef[mux][pga].bias = -(mux * 3 - pga) * (int32_t)cal.coef[mux][pga].gain;
+            floatCal.offset[mux][pga] = (float)(mux * 3 - pga);
+            floatCal.gain[mux][pga] = cal.coef[mux][pga].gain / (float)ADS1115_CAL_UNITY;
+        }
+    }
+    for (uint32_t i = 0; i < CAL_BENCH_RAWS; i++) {
+        raws[i] = (int16_t)(CalBench_Uniform() * 65536.0 - 32768.0);
+    }
+    CalBench_SetMirror(&hads1115, ADS1115_REG_CONFIG, ADS1115_CONFIG(AIN1, PGA_2_048V, SPS_860, 1));
+
+    for (int v = 0; v < 3; v++) {
+        CalBench_Result_t *r = CalBench_Add(results, &count, max, "speed", variants[v]);
+        int32_t sum = 0;
+        uint64_t t0;
+        if (r == NULL) {
+            break;
+        }
+        ADS1115_SetCalibration(&hads1115, v == 1 ? &cal : NULL);
+        t0 = CalBench_CpuNs();
+        for (uint32_t i = 0; i < CAL_BENCH_SAMPLES; i++) {
+            CalBench_SetMirror(&hads1115, ADS1115_REG_CONVERSION, (uint16_t)raws[i % CAL_BENCH_RAWS]);
+            if (v == 2) {
+                sum += (int32_t)CalBench_FloatSample(&hads1115, &floatCal);
+            } else {
+                sum += ADS1115_GetSample(&hads1115);
+            }
+        }
+        r->cpuNs = CalBench_CpuNs() - t0;
+        r->samples = CAL_BENCH_SAMPLES;
+        r->bytes = v == 0 ? 0 : v == 1 ? sizeof(cal) : sizeof(floatCal);
+        r->pass = 1;
+        sink = sum;
+    }
+    return count;
+}
+
+/**
+ * @brief Round-trip tables through blobs and feed CalLoad broken ones
+ * @return uint16_t Results written
+ */
+uint16_t CalBench_Blob(CalBench_Result_t *results, uint16_t max)
+{
+    static ADS1115_CalTable_t cal, loaded;
+    uint8_t blob[ADS1115_CAL_BLOB_MAX];
+    uint16_t count = 0;
+    uint16_t len;
+    CalBench_Result_t *r;
+
+    // Unity, one calibrated input, then every entry
+    for (int c = 0; c < 3; c++) {
+        static const char *names[3] = {"blob_unity", "blob_ain0", "blob_full"};
+        ADS1115_CalReset(&cal);
+        for (uint8_t mux = 0; mux < ADS1115_CAL_INPUTS && c > 0; mux++) {
+            if (c == 1 && mux != AIN0) continue;
+            for (uint8_t pga = 0; pga < ADS1115_CAL_PGAS; pga++) {
+                cal.coef[mux][pga].bias = (int32_t)(CalBench_Uniform() * 13107200.0 - 6553600.0);
+                cal.coef[mux][pga].gain = (uint32_t)(ADS1115_CAL_UNITY + CalBench_Uniform() * 2000.0 - 1000.0);
+            }
+        }
+        memset(&loaded, 0xA5, sizeof(loaded));
+        len = ADS1115_CalSave(&cal, blob, sizeof(blob));
+        if ((r = CalBench_Add(results, &count, max, names[c], "blob")) == NULL) break;
+        r->bytes = len;
+        r->pass = len != 0 && ADS1115_CalLoad(&loaded, blob, len) == HAL_OK && CalBench_SameTable(&cal, &loaded);
+    }
+
+    // The full table is still in blob: every single bit flip and a short blob must be refused
+    len = ADS1115_CalSave(&cal, blob, sizeof(blob));
+    if ((r = CalBench_Add(results, &count, max, "blob_corrupt", "blob")) != NULL) {
+        r->bytes = len;
+        r->pass = 1;
+        memcpy(&loaded, &cal, sizeof(cal));
+        for (uint16_t i = 0; i < len * 8u; i++) {
+            blob[i / 8] ^= (uint8_t)(1u << (i % 8));
+            if (ADS1115_CalLoad(&loaded, blob, len) != HAL_ERROR) r->pass = 0;
+            blob[i / 8] ^= (uint8_t)(1u << (i % 8));
+            r->samples++;
+        }
+        if (ADS1115_CalLoad(&loaded, blob, (uint16_t)(len - 1)) != HAL_ERROR) r->pass = 0;
+        if (!CalBench_SameTable(&cal, &loaded)) r->pass = 0;
+    }
+    if ((r = CalBench_Add(results, &count, max, "blob_small_buffer", "blob")) != NULL) {
+        r->bytes = (uint16_t)(len - 1);
+        r->pass = ADS1115_CalSave(&cal, blob, (uint16_t)(len - 1)) == 0;
+    }
+    return count;
+}
+
+/**
+ * @brief Write results as CSV, one row per result
+ */
+void CalBench_WriteCsv(FILE *out, const CalBench_Result_t *results, uint16_t count)
+{
+    fprintf(out, "test,variant,samples,ns_per_sample,max_err_counts,bytes,status\n");
+    for (uint16_t i = 0; i < count; i++) {
+        const CalBench_Result_t *r = &results[i];
+        fprintf(out, "%s,%s,%lu,%.2f,%.3f,%u,%s\n", r->name, r->variant, (unsigned long)r->samples,
+                r->samples ? (double)r->cpuNs / r->samples : 0.0, r->maxErr, r->bytes, r->pass ? "ok" : "FAIL");
+    }
+}
+
+/**
+ * @brief Run every test and print the CSV
+ * @return int 0 if every result passed, 1 if one failed, 2 on a usage error
+ */
+int CalBench_Main(int argc, char **argv)
+{
+    static CalBench_Result_t results[32];
+    const uint16_t max = sizeof(results) / sizeof(results[0]);
+    uint16_t count = 0;
+    int failed = 0;
+
+    if (argc > 1) {
+        fprintf(stderr, "usage: %s\n", argv[0]);
+        return 2;
+    }
+    count += CalBench_Accuracy(&results[count], (uint16_t)(max - count));
+    count += CalBench_Speed(&results[count], (uint16_t)(max - count));
+    count += CalBench_Blob(&results[count], (uint16_t)(max - count));
+
+    CalBench_WriteCsv(stdout, results, count);
+    for (uint16_t i = 0; i < count; i++) {
+        if (!results[i].pass) {
+            fprintf(stderr, "%s %s failed\n", results[i].name, results[i].variant);
+            failed = 1;
+        }
+    }
+    return failed;
+}
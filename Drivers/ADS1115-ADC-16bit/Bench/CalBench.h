@@ -0,0 +1,33 @@
+#ifndef CAL_BENCH_H
+#define CAL_BENCH_H
+#include "ADS1115.h"
+#include <stdio.h>
+
+/*------------------- Configuration ---------------------------*/
+#ifndef CAL_BENCH_SAMPLES
+#define CAL_BENCH_SAMPLES 1000000 // Corrections timed per variant
+#endif
+#ifndef CAL_BENCH_POINT_AVG
+#define CAL_BENCH_POINT_AVG 64 // Noisy results averaged per calibration point
+#endif
+#define CAL_BENCH_NAME_LEN 32
+
+/************************ Bench Structs ********************************/
+typedef struct {
+    char name[CAL_BENCH_NAME_LEN]; // "accuracy_<pga>", "speed", "blob_<case>"
+    const char *variant;    // "fixed", "float", "raw" or "blob"
+    uint32_t samples;       // Results corrected
+    uint64_t cpuNs;         // Host CPU time, informational only
+    double maxErr;          // Largest error against the true input, counts
+    uint16_t bytes;         // Blob length or table size
+    int pass;               // 1 if within half a count of the float correction, or the blob check held
+} CalBench_Result_t;
+
+/*------------------- Function Prototypes ---------------------------*/
+uint16_t CalBench_Accuracy(CalBench_Result_t *results, uint16_t max);
+uint16_t CalBench_Speed(CalBench_Result_t *results, uint16_t max);
+uint16_t CalBench_Blob(CalBench_Result_t *results, uint16_t max);
+void CalBench_WriteCsv(FILE *out, const CalBench_Result_t *results, uint16_t count);
+int CalBench_Main(int argc, char **argv);
+
+#endif
@@ -0,0 +1,243 @@
+#include "AcqSched.h"
+#include <string.h>
+
+/**
+ ******************************************************************************
+ * @file    AcqSched.c
+ * @author  Yair Yamin
+ * @brief   Cooperative acquisition scheduler for sensors with conversion times.
+ * @details Every channel is a trigger (start a conversion), a wait of the
+ * device's worst-case conversion time, and a read. Instead of blocking in
+ * HAL_Delay() during the wait, the scheduler starts or reads other channels,
+ * so one device converts while another one uses the bus.
+ *
+ * - AcqSched_Poll() makes at most one driver call and returns the time until
+ *   the next one is due; the main loop sleeps or does other work meanwhile.
+ * - Due triggers go first, earliest due first: a trigger's delay is the
+ *   sample's timing error. Reads only add latency.
+ * - Channels sharing a device (the ADS1115 inputs behind its multiplexer)
+ *   take turns: a trigger waits until the previous conversion was read.
+ * - Samples are due at fixed multiples of the period. A trigger a full period
+ *   late skips the missed samples instead of bunching them up.
+ ******************************************************************************
+ */
+
+/* ========================== Static Helpers ============================ */
+
+/**
+ * @brief Channel converting on the same device, NULL if the device is free
+ */
+static AcqSched_Channel_t *AcqSched_DevOwner(AcqSched_t *sched, const AcqSched_Channel_t *ch)
+{
+    if (ch->config.trigger == NULL) {
+        return NULL; // Plain reads do not disturb a conversion
+    }
+    for (uint8_t i = 0; i < sched->count; i++) {
+        AcqSched_Channel_t *other = &sched->channels[i];
+        if (other != ch && other->converting && other->config.trigger != NULL && other->config.dev == ch->config.dev) {
+            return other;
+        }
+    }
+    return NULL;
+}
+
+static HAL_StatusTypeDef AcqSched_Call(AcqSched_t *sched, AcqSched_Channel_t *ch, AcqSched_Op_t op)
+{
+    uint32_t start = ACQSCHED_NOW_US();
+    HAL_StatusTypeDef status = op(ch);
+    sched->busyUs += ACQSCHED_NOW_US() - start;
+    sched->actions++;
+    return status;
+}
+
+static void AcqSched_Trigger(AcqSched_t *sched, AcqSched_Channel_t *ch, uint32_t now)
+{
+    uint32_t period = ch->config.periodUs;
+    uint32_t late = now - ch->releaseUs;
+    HAL_StatusTypeDef status = HAL_OK;
+
+    if (late >= period) {
+        uint32_t skipped = late / period;
+        ch->stats.misses += skipped;
+        ch->releaseUs += skipped * period;
+        late -= skipped * period;
+    }
+    if (ch->config.trigger != NULL) {
+        status = AcqSched_Call(sched, ch, ch->config.trigger);
+    }
+    if (status == HAL_BUSY) {
+        ch->stats.retries++;
+        ch->waitUs = ACQSCHED_NOW_US() + ACQSCHED_RETRY_US;
+        return;
+    }
+    ch->releaseUs += period;
+    if (status != HAL_OK) {
+        ch->stats.errors++;
+        ch->waitUs = ch->releaseUs;
+        return;
+    }
+    ch->triggerUs = now;
+    ch->lateUs = late;
+    ch->converting = 1;
+    ch->waitUs = now + ch->config.convUs;
+}
+
+static void AcqSched_Read(AcqSched_t *sched, AcqSched_Channel_t *ch)
+{
+    HAL_StatusTypeDef status = AcqSched_Call(sched, ch, ch->config.read);
+    uint32_t done = ACQSCHED_NOW_US();
+
+    if (status == HAL_BUSY) {
+        ch->stats.retries++;
+        ch->waitUs = done + ACQSCHED_RETRY_US;
+        return;
+    }
+    ch->converting = 0;
+    ch->waitUs = ch->releaseUs;
+    if (status != HAL_OK) {
+        ch->stats.errors++;
+        return;
+    }
+
+    AcqSched_Stats_t *stats = &ch->stats;
+    if (stats->samples++ == 0) {
+        stats->firstUs = ch->triggerUs;
+    }
+    stats->lastUs = ch->triggerUs;
+    stats->sumLateUs += ch->lateUs;
+    if (ch->lateUs > stats->maxLateUs) {
+        stats->maxLateUs = ch->lateUs;
+    }
+    if (done - ch->triggerUs > stats->maxLatencyUs) {
+        stats->maxLatencyUs = done - ch->triggerUs;
+    }
+    if (ch->config.onSample != NULL) {
+        ch->config.onSample(ch, ch->triggerUs);
+    }
+}
+
+ /* ========================== Function Definitions ============================ */
+
+/**
+ * @brief Initialize an empty scheduler
+ * @param sched Scheduler state
+ */
+void AcqSched_Init(AcqSched_t *sched)
+{
+    memset(sched, 0, sizeof(*sched));
+}
+
+/**
+ * @brief Add a channel
+ * @param sched Scheduler state
+ * @param config Channel description, copied
+ * @param id Index of the channel in sched->channels, may be NULL
+ * @return HAL_StatusTypeDef HAL_OK, HAL_ERROR without read callback or period,
+ *         or when ACQSCHED_MAX_CHANNELS channels exist
+ */
+HAL_StatusTypeDef AcqSched_Add(AcqSched_t *sched, const AcqSched_Config_t *config, uint8_t *id)
+{
+    if (config->read == NULL || config->periodUs == 0 || sched->count == ACQSCHED_MAX_CHANNELS) {
+        return HAL_ERROR;
+    }
+    AcqSched_Channel_t *ch = &sched->channels[sched->count];
+    memset(ch, 0, sizeof(*ch));
+    ch->config = *config;
+    if (id != NULL) {
+        *id = sched->count;
+    }
+    sched->count++;
+    return HAL_OK;
+}
+
+/**
+ * @brief Start sampling, the first sample of each channel is due after its phase
+ * @param sched Scheduler state
+ * @details Also clears the statistics.
+ */
+void AcqSched_Start(AcqSched_t *sched)
+{
+    uint32_t now = ACQSCHED_NOW_US();
+
+    sched->startUs = now;
+    sched->busyUs = 0;
+    sched->actions = 0;
+    for (uint8_t i = 0; i < sched->count; i++) {
+        AcqSched_Channel_t *ch = &sched->channels[i];
+        ch->releaseUs = now + ch->config.phaseUs;
+        ch->waitUs = ch->releaseUs;
+        ch->converting = 0;
+        memset(&ch->stats, 0, sizeof(ch->stats));
+    }
+}
+
+/**
+ * @brief Make the most urgent due driver call
+ * @param sched Scheduler state
+ * @return uint32_t 0 if a call was made, otherwise microseconds until the next
+ *         one is due (0xFFFFFFFF without channels)
+ * @details Call from the main loop. Sleeping for the returned time is safe;
+ *          sleeping longer delays triggers and shows up as jitter.
+ */
+uint32_t AcqSched_Poll(AcqSched_t *sched)
+{
+    uint32_t now = ACQSCHED_NOW_US();
+    uint32_t sleep = 0xFFFFFFFFu;
+    AcqSched_Channel_t *trigger = NULL;
+    AcqSched_Channel_t *read = NULL;
+
+    for (uint8_t i = 0; i < sched->count; i++) {
+        AcqSched_Channel_t *ch = &sched->channels[i];
+        int32_t until = (int32_t)(ch->waitUs - now);
+
+        if (!ch->converting && AcqSched_DevOwner(sched, ch) != NULL) {
+            continue; // Becomes eligible after the owner's read, which is accounted for
+        }
+        if (until > 0) {
+            if ((uint32_t)until < sleep) {
+                sleep = (uint32_t)until;
+            }
+        } else if (ch->converting) {
+            if (read == NULL || (int32_t)(ch->waitUs - read->waitUs) < 0) {
+                read = ch;
+            }
+        } else if (trigger == NULL || (int32_t)(ch->releaseUs - trigger->releaseUs) < 0) {
+            trigger = ch;
+        }
+    }
+
+    if (trigger != NULL) {
+        AcqSched_Trigger(sched, trigger, now);
+        return 0;
+    }
+    if (read != NULL) {
+        AcqSched_Read(sched, read);
+        return 0;
+    }
+    return sleep;
+}
+
+/**
+ * @brief Achieved sample rate
+ * @param ch Channel
+ * @return uint32_t Samples per 1000 s between the first and last sample, 0 before two samples
+ */
+uint32_t AcqSched_RateMilliHz(const AcqSched_Channel_t *ch)
+{
+    uint32_t span = ch->stats.lastUs - ch->stats.firstUs;
+
+    if (ch->stats.samples < 2 || span == 0) {
+        return 0;
+    }
+    return (uint32_t)(((uint64_t)(ch->stats.samples - 1) * 1000000000u) / span);
+}
+
+/**
+ * @brief Mean trigger delay after the due time
+ * @param ch Channel
+ * @return uint32_t Microseconds, 0 before the first sample
+ */
+uint32_t AcqSched_MeanLateUs(const AcqSched_Channel_t *ch)
+{
+    return ch->stats.samples ? (uint32_t)(ch->stats.sumLateUs / ch->stats.samples) : 0;
+}
@@ -0,0 +1,80 @@
+#ifndef ACQ_SCHED_H
+#define ACQ_SCHED_H
+#include "main.h"
+
+/*------------------- Configuration ---------------------------*/
+#ifndef ACQSCHED_MAX_CHANNELS
+#define ACQSCHED_MAX_CHANNELS 8 // Channels per scheduler
+#endif
+
+#ifndef ACQSCHED_RETRY_US
+#define ACQSCHED_RETRY_US 2000 // Wait before retrying a trigger or read that returned HAL_BUSY
+#endif
+
+// Microsecond clock, may wrap. The SysTick default limits jitter figures to
+// 1 ms resolution; a 1 MHz timer (e.g. TIM2->CNT) gives exact values.
+#ifndef ACQSCHED_NOW_US
+#ifdef HOSTSIM_H
+#define ACQSCHED_NOW_US() ((uint32_t)(HostSim_NowNs() / 1000u))
+#else
+#define ACQSCHED_NOW_US() (HAL_GetTick() * 1000u)
+#endif
+#endif
+
+/************************ Scheduler Structs ********************************/
+typedef struct AcqSched_Channel_s AcqSched_Channel_t;
+
+typedef HAL_StatusTypeDef (*AcqSched_Op_t)(AcqSched_Channel_t *ch);
+typedef void (*AcqSched_SampleCallback_t)(AcqSched_Channel_t *ch, uint32_t sampleUs);
+
+typedef struct {
+    AcqSched_Op_t trigger;  // Start a conversion, NULL if a read is enough
+    AcqSched_Op_t read;     // Fetch the result; HAL_BUSY if it is not ready yet
+    AcqSched_SampleCallback_t onSample; // Optional, called after each successful read
+    void *dev;              // Driver handle; triggered channels with the same dev never convert at the same time
+    void *ctx;              // For the callbacks
+    uint32_t periodUs;      // Sample period
+    uint32_t convUs;        // Trigger to result, worst case
+    uint32_t phaseUs;       // Delay of the first sample after AcqSched_Start()
+    uint8_t arg;            // For the callbacks, e.g. the ADS1115 input
+} AcqSched_Config_t;
+
+typedef struct {
+    uint32_t samples;       // Successful reads
+    uint32_t misses;        // Periods skipped because the trigger was a full period late
+    uint32_t errors;        // Triggers or reads that failed
+    uint32_t retries;       // HAL_BUSY answers
+    uint32_t maxLateUs;     // Largest trigger delay after the sample was due (jitter)
+    uint64_t sumLateUs;     // Over all samples
+    uint32_t maxLatencyUs;  // Largest time from trigger to finished read
+    uint32_t firstUs;       // Trigger time of the first and last sample
+    uint32_t lastUs;
+} AcqSched_Stats_t;
+
+struct AcqSched_Channel_s {
+    AcqSched_Config_t config;
+    uint32_t releaseUs;     // Next sample is due
+    uint32_t waitUs;        // Earliest time of the next action
+    uint32_t triggerUs;     // Trigger time of the sample being converted
+    uint32_t lateUs;        // How late that trigger was
+    uint8_t converting;
+    AcqSched_Stats_t stats;
+};
+
+typedef struct {
+    AcqSched_Channel_t channels[ACQSCHED_MAX_CHANNELS];
+    uint8_t count;
+    uint32_t startUs;
+    uint64_t busyUs;        // Time spent inside driver calls
+    uint32_t actions;       // Driver calls made
+} AcqSched_t;
+
+/*------------------- Function Prototypes ---------------------------*/
+void AcqSched_Init(AcqSched_t *sched);
+HAL_StatusTypeDef AcqSched_Add(AcqSched_t *sched, const AcqSched_Config_t *config, uint8_t *id);
+void AcqSched_Start(AcqSched_t *sched);
+uint32_t AcqSched_Poll(AcqSched_t *sched);
+uint32_t AcqSched_RateMilliHz(const AcqSched_Channel_t *ch);
+uint32_t AcqSched_MeanLateUs(const AcqSched_Channel_t *ch);
+
+#endif
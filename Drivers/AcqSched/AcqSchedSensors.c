@@ -0,0 +1,135 @@
+#include "AcqSchedSensors.h"
+#include <string.h>
+
+/**
+ ******************************************************************************
+ * @file    AcqSchedSensors.c
+ * @author  Yair Yamin
+ * @brief   AcqSched channels for the ADS1115, BME280 and DS3231 drivers.
+ * @details Each function fills a channel description with the driver calls
+ * and the conversion time the driver reports for its current configuration.
+ * Configure the device first (ADS1115_Init(), BME280_SetOSVals()) and set
+ * onSample/ctx/phaseUs in the description before AcqSched_Add().
+ ******************************************************************************
+ */
+
+/* ========================== Static Helpers ============================ */
+
+static HAL_StatusTypeDef AcqSched_ADS1115Trigger(AcqSched_Channel_t *ch)
+{
+    return ADS1115_StartConversion((ADS1115_Handle_t *)ch->config.dev, (sChannel_t)ch->config.arg);
+}
+
+static HAL_StatusTypeDef AcqSched_ADS1115Read(AcqSched_Channel_t *ch)
+{
+    return ADS1115_ReadConversionReg((ADS1115_Handle_t *)ch->config.dev);
+}
+
+static HAL_StatusTypeDef AcqSched_BME280Trigger(AcqSched_Channel_t *ch)
+{
+    return BME280_StartForced((BME280_Handle_t *)ch->config.dev);
+}
+
+/**
+ * @brief Read the enabled measurements, temperature first for the compensation
+ */
+static HAL_StatusTypeDef AcqSched_BME280Read(AcqSched_Channel_t *ch)
+{
+    BME280_Handle_t *hbme280 = (BME280_Handle_t *)ch->config.dev;
+    HAL_StatusTypeDef status;
+
+    status = BME280_GetTemp(hbme280);
+    if (status != HAL_OK) return status;
+    if (hbme280->Reg.ctrl_meas_reg & 0x1C) {
+        status = BME280_GetPress(hbme280);
+        if (status != HAL_OK) return status;
+    }
+    if (hbme280->Reg.ctrl_hum_reg & 0x07) {
+        status = BME280_GetHum(hbme280);
+    }
+    return status;
+}
+
+static HAL_StatusTypeDef AcqSched_DS3231TempTrigger(AcqSched_Channel_t *ch)
+{
+    return DS3231_StartTempConv((DS3231_Handle_t *)ch->config.dev);
+}
+
+static HAL_StatusTypeDef AcqSched_DS3231TempRead(AcqSched_Channel_t *ch)
+{
+    return DS3231_PollTempConv((DS3231_Handle_t *)ch->config.dev);
+}
+
+static HAL_StatusTypeDef AcqSched_DS3231TimeRead(AcqSched_Channel_t *ch)
+{
+    HAL_StatusTypeDef status = DS3231_GetTime((DS3231_Handle_t *)ch->config.dev);
+    if (status != HAL_OK) return status;
+    return DS3231_GetDate((DS3231_Handle_t *)ch->config.dev);
+}
+
+ /* ========================== Function Definitions ============================ */
+
+/**
+ * @brief Channel for one ADS1115 input in single-shot mode
+ * @param config Filled in
+ * @param hads1115 Initialized driver handle, its data rate sets the conversion time
+ * @param input Input for this channel; the inputs of one ADS1115 take turns
+ * @param periodUs Sample period
+ */
+void AcqSched_ADS1115Config(AcqSched_Config_t *config, ADS1115_Handle_t *hads1115, sChannel_t input, uint32_t periodUs)
+{
+    memset(config, 0, sizeof(*config));
+    config->trigger = AcqSched_ADS1115Trigger;
+    config->read = AcqSched_ADS1115Read;
+    config->dev = hads1115;
+    config->arg = (uint8_t)input;
+    config->periodUs = periodUs;
+    config->convUs = ADS1115_ConversionTimeUs(hads1115);
+}
+
+/**
+ * @brief Channel for BME280 forced-mode measurements
+ * @param config Filled in
+ * @param hbme280 Initialized driver handle, its oversampling sets the measurement time
+ * @param periodUs Sample period
+ */
+void AcqSched_BME280Config(AcqSched_Config_t *config, BME280_Handle_t *hbme280, uint32_t periodUs)
+{
+    memset(config, 0, sizeof(*config));
+    config->trigger = AcqSched_BME280Trigger;
+    config->read = AcqSched_BME280Read;
+    config->dev = hbme280;
+    config->periodUs = periodUs;
+    config->convUs = BME280_MeasureTimeUs(hbme280);
+}
+
+/**
+ * @brief Channel for forced DS3231 temperature conversions
+ * @param config Filled in
+ * @param hrtc Initialized driver handle
+ * @param periodUs Sample period, the chip converts on its own every 64 s anyway
+ * @details A trigger during an automatic conversion is retried later.
+ */
+void AcqSched_DS3231TempConfig(AcqSched_Config_t *config, DS3231_Handle_t *hrtc, uint32_t periodUs)
+{
+    memset(config, 0, sizeof(*config));
+    config->trigger = AcqSched_DS3231TempTrigger;
+    config->read = AcqSched_DS3231TempRead;
+    config->dev = hrtc;
+    config->periodUs = periodUs;
+    config->convUs = DS3231_TEMP_CONV_MAX_US;
+}
+
+/**
+ * @brief Channel reading the DS3231 time and date, no conversion
+ * @param config Filled in
+ * @param hrtc Initialized driver handle
+ * @param periodUs Sample period
+ */
+void AcqSched_DS3231TimeConfig(AcqSched_Config_t *config, DS3231_Handle_t *hrtc, uint32_t periodUs)
+{
+    memset(config, 0, sizeof(*config));
+    config->read = AcqSched_DS3231TimeRead;
+    config->dev = hrtc;
+    config->periodUs = periodUs;
+}
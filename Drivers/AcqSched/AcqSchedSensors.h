@@ -0,0 +1,14 @@
+#ifndef ACQ_SCHED_SENSORS_H
+#define ACQ_SCHED_SENSORS_H
+#include "AcqSched.h"
+#include "ADS1115.h"
+#include "BME280.h"
+#include "DS3231.h"
+
+/*------------------- Function Prototypes ---------------------------*/
+void AcqSched_ADS1115Config(AcqSched_Config_t *config, ADS1115_Handle_t *hads1115, sChannel_t input, uint32_t periodUs);
+void AcqSched_BME280Config(AcqSched_Config_t *config, BME280_Handle_t *hbme280, uint32_t periodUs);
+void AcqSched_DS3231TempConfig(AcqSched_Config_t *config, DS3231_Handle_t *hrtc, uint32_t periodUs);
+void AcqSched_DS3231TimeConfig(AcqSched_Config_t *config, DS3231_Handle_t *hrtc, uint32_t periodUs);
+
+#endif
@@ -1,4 +1,11 @@
 #include "BME280.h"
+#ifdef DRIVER_TRACE
+#include "DriverTrace.h"
+#else
+#define DRIVER_TRACE_API(handle)
+#define DRIVER_TRACE_TXN_BEGIN()
+#define DRIVER_TRACE_TXN_END(device, reg, len, op, status)
+#endif
 /**
  ******************************************************************************
  * @file    BME280.h
@@ -17,11 +24,26 @@
  * - Humidity: ±3% relative humidity accuracy
  * - Pressure range: 300-1100 hPa
  * - Multiple power modes and oversampling settings
- * - I2C and SPI digital interfaces (I2C implementation in this driver)
+ * - I2C and SPI digital interfaces: I2C built in, SPI and others through
+ *   BME280_Transport_t (BME280Spi.c)
  *
  ******************************************************************************
  */
 
+#if defined(BME280_COMPACT_HANDLE) && !defined(DRIVERS_DCACHE)
+#ifdef USE_I2CBUS
+#define BME280_HANDLE_PTRS 3 // i2c_handle, bus_client and transport
+#else
+#define BME280_HANDLE_PTRS 2 // i2c_handle and transport
+#endif
+// Size report: handle pointers plus 63 payload bytes, rounded up to pointer alignment
+_Static_assert(sizeof(BME280_Handle_t) <= (BME280_HANDLE_PTRS * sizeof(void*) + 63 + sizeof(void*) - 1) / sizeof(void*) * sizeof(void*),
+               "BME280 compact handle grew");
+#endif
+#ifdef BME280_COMPACT_HANDLE
+_Static_assert(sizeof(BME280_Compensations_t) == 34, "BME280 compact calibration block is not packed");
+#endif
+
 /* ========================== Global Variables ============================ */
 static BME280_S32_t t_fine;
 
@@ -29,6 +51,149 @@ static BME280_S32_t t_fine;
 static inline uint16_t u16(uint8_t lsb, uint8_t msb) { return (uint16_t)lsb | ((uint16_t)msb << 8); }
 static inline  int16_t s16(uint8_t lsb, uint8_t msb) { return (int16_t) u16(lsb, msb); }
 
+ /* ========================== I/O Helpers ============================ */
+
+static HAL_StatusTypeDef BME280_ReadRegs(void* dev, uint8_t reg, uint8_t* data, uint16_t size)
+{
+    BME280_Handle_t* hbme280 = (BME280_Handle_t*)dev;
+    HAL_StatusTypeDef status;
+    DRIVER_TRACE_TXN_BEGIN();
+    if (hbme280->transport != NULL) {
+        status = hbme280->transport->ops->read(hbme280->transport, reg, data, size);
+    } else {
+#ifdef USE_I2CBUS
+        status = I2CBus_MemRead(hbme280->bus_client, hbme280->I2C_address, reg, data, size);
+#else
+#ifdef DRIVERS_DCACHE
+        DmaCache_RxStart(&hbme280->dmaRx, data, size);
+#endif
+        status = HAL_I2C_Mem_Read_DMA(hbme280->i2c_handle, hbme280->I2C_address, reg, I2C_MEMADD_SIZE_8BIT, data, size);
+#endif
+    }
+    DRIVER_TRACE_TXN_END(hbme280->I2C_address, reg, size, DRIVER_TRACE_OP_MEM_READ, status);
+    return status;
+}
+
+static HAL_StatusTypeDef BME280_WriteRegs(void* dev, uint8_t reg, uint8_t* data, uint16_t size)
+{
+    BME280_Handle_t* hbme280 = (BME280_Handle_t*)dev;
+    HAL_StatusTypeDef status;
+    DRIVER_TRACE_TXN_BEGIN();
+    if (hbme280->transport != NULL) {
+        status = hbme280->transport->ops->write(hbme280->transport, reg, data, size);
+    } else {
+#ifdef USE_I2CBUS
+        status = I2CBus_MemWrite(hbme280->bus_client, hbme280->I2C_address, reg, data, size);
+#else
+        DmaCache_Clean(data, size);
+        status = HAL_I2C_Mem_Write_DMA(hbme280->i2c_handle, hbme280->I2C_address, reg, I2C_MEMADD_SIZE_8BIT, data, size);
+#endif
+    }
+    DRIVER_TRACE_TXN_END(hbme280->I2C_address, reg, size, DRIVER_TRACE_OP_MEM_WRITE, status);
+    return status;
+}
+
+ /* ========================== Conversion Helpers ============================ */
+
+// raw: temp_msb, temp_lsb, temp_xlsb. Sets t_fine, so it runs before the other two
+static void BME280_ConvertTemp(BME280_Handle_t* hbme280, const uint8_t* raw)
+{
+    BME280_S32_t adc_T = (BME280_S32_t)(((uint32_t)raw[0] << 12) | ((uint32_t)raw[1] << 4) | ((uint32_t)raw[2] >> 4));
+#ifdef BME280_COMPACT_HANDLE
+    hbme280->temperature = (int16_t)BME280_compensate_T_int32(adc_T,hbme280->Comp);
+#else
+    hbme280->temperature = (float)BME280_compensate_T_int32(adc_T,hbme280->Comp) / 100.0f;
+#endif
+}
+
+// raw: press_msb, press_lsb, press_xlsb
+static void BME280_ConvertPress(BME280_Handle_t* hbme280, const uint8_t* raw)
+{
+    BME280_S32_t adc_P = (BME280_S32_t)(((uint32_t)raw[0] << 12) | ((uint32_t)raw[1] << 4) | ((uint32_t)raw[2] >> 4));
+#ifdef BME280_COMPACT_HANDLE
+    hbme280->pressure = BME280_compensate_P_int64(adc_P,hbme280->Comp);
+#else
+    hbme280->pressure = (float)BME280_compensate_P_int64(adc_P,hbme280->Comp) / 256.0f;
+#endif
+}
+
+// raw: hum_msb, hum_lsb
+static void BME280_ConvertHum(BME280_Handle_t* hbme280, const uint8_t* raw)
+{
+    BME280_S32_t adc_H = (BME280_S32_t)(((uint32_t)raw[0] << 8) | (uint32_t)raw[1]);
+#ifdef BME280_COMPACT_HANDLE
+    hbme280->humidity = (uint16_t)((BME280_compensate_H_int32(adc_H,hbme280->Comp) * 100u + 512u) >> 10);
+#else
+    hbme280->humidity = (float)BME280_compensate_H_int32(adc_H,hbme280->Comp) / 1024.0f;
+#endif
+}
+
+ /* ========================== Register Table ============================ */
+
+// Mirror index of the registers kept in Reg
+enum {
+    BME280_IDX_ID,
+    BME280_IDX_CTRL_HUM,
+    BME280_IDX_CTRL_MEAS,
+    BME280_IDX_CONFIG,
+    BME280_IDX_PRESS_MSB,
+    BME280_IDX_PRESS_LSB,
+    BME280_IDX_PRESS_XLSB,
+    BME280_IDX_TEMP_MSB,
+    BME280_IDX_TEMP_LSB,
+    BME280_IDX_TEMP_XLSB,
+    BME280_IDX_HUM_MSB,
+    BME280_IDX_HUM_LSB,
+};
+
+#define BME280_MIRROR(reg, field, flags) {(reg), offsetof(BME280_RegMap_t, field), 1, (flags), 0}
+#define BME280_RESULT (REGCORE_VOLATILE | REGCORE_READ_ONLY)
+
+static const RegCore_Reg_t bme280Regs[] = {
+    [BME280_IDX_ID]         = BME280_MIRROR(BME280_ID_REG, id_reg, REGCORE_READ_ONLY),
+    [BME280_IDX_CTRL_HUM]   = BME280_MIRROR(BME280_CTRL_HUM_REG, ctrl_hum_reg, 0),
+    // The mode falls back to sleep after a forced measurement, and writing forced again starts the next one
+    [BME280_IDX_CTRL_MEAS]  = BME280_MIRROR(BME280_CTRL_MEAS_REG, ctrl_meas_reg, REGCORE_VOLATILE),
+    [BME280_IDX_CONFIG]     = BME280_MIRROR(BME280_CONFIG_REG, config_reg, 0),
+    [BME280_IDX_PRESS_MSB]  = BME280_MIRROR(BME280_PRESS_MSB_REG, press_msb_reg, BME280_RESULT),
+    [BME280_IDX_PRESS_LSB]  = BME280_MIRROR(BME280_PRESS_LSB_REG, press_lsb_reg, BME280_RESULT),
+    [BME280_IDX_PRESS_XLSB] = BME280_MIRROR(BME280_PRESS_XLSB_REG, press_xlsb_reg, BME280_RESULT),
+    [BME280_IDX_TEMP_MSB]   = BME280_MIRROR(BME280_TEMP_MSB_REG, temp_msb_reg, BME280_RESULT),
+    [BME280_IDX_TEMP_LSB]   = BME280_MIRROR(BME280_TEMP_LSB_REG, temp_lsb_reg, BME280_RESULT),
+    [BME280_IDX_TEMP_XLSB]  = BME280_MIRROR(BME280_TEMP_XLSB_REG, temp_xlsb_reg, BME280_RESULT),
+    [BME280_IDX_HUM_MSB]    = BME280_MIRROR(BME280_HUM_MSB_REG, hum_msb_reg, BME280_RESULT),
+    [BME280_IDX_HUM_LSB]    = BME280_MIRROR(BME280_HUM_LSB_REG, hum_lsb_reg, BME280_RESULT),
+};
+
+enum {
+    BME280_FIELD_OSRS_H,
+    BME280_FIELD_MODE,
+    BME280_FIELD_OSRS_P,
+    BME280_FIELD_OSRS_T,
+    BME280_FIELD_FILTER,
+    BME280_FIELD_T_SB,
+};
+
+static const RegCore_Field_t bme280Fields[] = {
+    [BME280_FIELD_OSRS_H] = {BME280_IDX_CTRL_HUM,  0, 0x07},
+    [BME280_FIELD_MODE]   = {BME280_IDX_CTRL_MEAS, 0, 0x03},
+    [BME280_FIELD_OSRS_P] = {BME280_IDX_CTRL_MEAS, 2, 0x1C},
+    [BME280_FIELD_OSRS_T] = {BME280_IDX_CTRL_MEAS, 5, 0xE0},
+    [BME280_FIELD_FILTER] = {BME280_IDX_CONFIG,    2, 0x1C},
+    [BME280_FIELD_T_SB]   = {BME280_IDX_CONFIG,    5, 0xE0},
+};
+
+static const RegCore_Desc_t bme280Desc = {
+    .regs = bme280Regs,
+    .fields = bme280Fields,
+    .read = BME280_ReadRegs,
+    .write = BME280_WriteRegs,
+    .mirror = offsetof(BME280_Handle_t, Reg),
+    .state = offsetof(BME280_Handle_t, regState),
+    .count = sizeof(bme280Regs) / sizeof(bme280Regs[0]),
+    .flags = REGCORE_BURST_READ, // Writes of several registers take address/data pairs, see BME280_ApplySettings()
+};
+
  /* ========================== Function Definitions ============================ */
 
 /**
@@ -113,7 +278,11 @@ BME280_U32_t BME280_compensate_H_int32(BME280_S32_t adc_H,BME280_Compensations_t
  */
 HAL_StatusTypeDef BME280_Init(BME280_Handle_t* hbme280)
 {
-    HAL_I2C_Mem_Read_DMA(hbme280->i2c_handle,hbme280->I2C_address,BME280_ID_REG,I2C_MEMADD_SIZE_8BIT,&hbme280->Reg.id_reg,1);
+    DRIVER_TRACE_API(hbme280);
+    HAL_StatusTypeDef status;
+    RegCore_Invalidate(&bme280Desc, hbme280);
+    status = RegCore_Load(&bme280Desc, hbme280, BME280_IDX_ID, 1);
+    if(status != HAL_OK) return status;
     if(hbme280->Reg.id_reg != 0x60) return HAL_ERROR;
 
     return BME280_CalCompensationParams(hbme280);
@@ -126,20 +295,38 @@ HAL_StatusTypeDef BME280_Init(BME280_Handle_t* hbme280)
  */
 HAL_StatusTypeDef BME280_CalCompensationParams(BME280_Handle_t* hbme280)
 {
+    DRIVER_TRACE_API(hbme280);
     HAL_StatusTypeDef status;
-    uint8_t  calibA[26] = {0};
-    uint8_t  calibB[7] = {0};
-    
-
-    status = HAL_I2C_Mem_Read_DMA(hbme280->i2c_handle,hbme280->I2C_address,0x88,I2C_MEMADD_SIZE_8BIT,calibA,26);
+#ifdef DRIVERS_DCACHE
+    uint8_t* calibA = hbme280->calib;
+    uint8_t* calibB = hbme280->calib + BME280_CALIB_A_LEN;
+#else
+    uint8_t  calibA[BME280_CALIB_A_LEN] = {0};
+    uint8_t  calibB[BME280_CALIB_B_LEN] = {0};
+#endif
+
+    status = BME280_ReadRegs(hbme280,BME280_CALIB_A_REG,calibA,BME280_CALIB_A_LEN);
     if(status != HAL_OK) return status;
-    status = HAL_I2C_Mem_Read_DMA(hbme280->i2c_handle,hbme280->I2C_address,0xE1,I2C_MEMADD_SIZE_8BIT,calibB,7);
+    status = BME280_ReadRegs(hbme280,BME280_CALIB_B_REG,calibB,BME280_CALIB_B_LEN);
     if(status != HAL_OK) return status;
-    
+
+    BME280_ParseCalib(hbme280,calibA,calibB);
+    return HAL_OK;
+}
+
+/**
+ * @brief Fill the compensation parameters from raw calibration bytes
+ * @param hbme280 Pointer to BME280 handle structure
+ * @param calibA BME280_CALIB_A_LEN bytes read from BME280_CALIB_A_REG
+ * @param calibB BME280_CALIB_B_LEN bytes read from BME280_CALIB_B_REG
+ * @details For callers that read the calibration registers themselves, e.g. asynchronously at boot.
+ */
+void BME280_ParseCalib(BME280_Handle_t* hbme280, const uint8_t* calibA, const uint8_t* calibB)
+{
     /* Temperature coefficients (Table 16) */
-    uint16_t dig_T1 = u16(calibA[0],  calibA[1]);   // 0x88 / 0x89  (unsigned)
-    int16_t dig_T2 = s16(calibA[2],  calibA[3]);   // 0x8A / 0x8B  (signed)
-    int16_t dig_T3 = s16(calibA[4],  calibA[5]);   // 0x8C / 0x8D  (signed)
+    hbme280->Comp.dig_T1 = u16(calibA[0],  calibA[1]);   // 0x88 / 0x89  (unsigned)
+    hbme280->Comp.dig_T2 = s16(calibA[2],  calibA[3]);   // 0x8A / 0x8B  (signed)
+    hbme280->Comp.dig_T3 = s16(calibA[4],  calibA[5]);   // 0x8C / 0x8D  (signed)
 
     /* Pressure coefficients (Table 16) */
     hbme280->Comp.dig_P1 = u16(calibA[6],  calibA[7]);   // 0x8E / 0x8F  (unsigned)
@@ -162,7 +349,26 @@ HAL_StatusTypeDef BME280_CalCompensationParams(BME280_Handle_t* hbme280)
     /* H5: [3:0] in 0xE5[7:4], [11:4] in 0xE6   → sign-extended 12-bit => int16_t */
     hbme280->Comp.dig_H5 = (int16_t)(( (int16_t)calibB[5] << 4) | (calibB[4] >> 4));
     hbme280->Comp.dig_H6 = (int8_t)calibB[6];           // 0xE7 (signed 8-bit)
+}
+
+/**
+ * @brief Soft-reset the sensor
+ * @param hbme280 Pointer to BME280 handle structure
+ * @return HAL_StatusTypeDef HAL_OK on success, error code otherwise
+ * @details Registers return to their power-on values; wait BME280_STARTUP_US
+ *          for the NVM copy before reading calibration or configuring.
+ */
+HAL_StatusTypeDef BME280_SoftReset(BME280_Handle_t* hbme280)
+{
+    DRIVER_TRACE_API(hbme280);
+    static const uint8_t resetWord = BME280_RESET_WORD; // DMA source, must outlive the call
+    static const uint8_t powerOn[3] = {0, 0, 0}; // ctrl_hum, ctrl_meas, config
+    HAL_StatusTypeDef status;
 
+    status = BME280_WriteRegs(hbme280,BME280_RESET_REG,(uint8_t*)&resetWord,1);
+    if(status != HAL_OK) return status;
+    RegCore_Invalidate(&bme280Desc, hbme280);
+    RegCore_Merge(&bme280Desc, hbme280, BME280_IDX_CTRL_HUM, powerOn, sizeof(powerOn));
     return HAL_OK;
 }
 
@@ -174,14 +380,13 @@ HAL_StatusTypeDef BME280_CalCompensationParams(BME280_Handle_t* hbme280)
  */
 HAL_StatusTypeDef BME280_GetTemp(BME280_Handle_t* hbme280)
 {
+    DRIVER_TRACE_API(hbme280);
     HAL_StatusTypeDef status;
-    BME280_S32_t adc_T;
 
-    status = HAL_I2C_Mem_Read_DMA(hbme280->i2c_handle,hbme280->I2C_address,BME280_TEMP_MSB_REG,I2C_MEMADD_SIZE_8BIT,hbme280->Reg.temp_msb_reg,3);
+    status = RegCore_Load(&bme280Desc, hbme280, BME280_IDX_TEMP_MSB, 3);
     if(status != HAL_OK) return status;
 
-    adc_T = (BME280_S32_t)(((uint32_t)(hbme280->Reg.temp_msb_reg) << 12) | ((uint32_t)(hbme280->Reg.temp_lsb_reg) << 4) | ((uint32_t)hbme280->Reg.temp_xlsb_reg >> 4));
-    hbme280->temperature = (float)BME280_compensate_T_int32(adc_T,hbme280->Comp) / 100.0f;
+    BME280_ConvertTemp(hbme280, &hbme280->Reg.temp_msb_reg);
     return HAL_OK;
 }
 
@@ -192,14 +397,13 @@ HAL_StatusTypeDef BME280_GetTemp(BME280_Handle_t* hbme280)
  */
 HAL_StatusTypeDef BME280_GetPress(BME280_Handle_t* hbme280)
 {
+    DRIVER_TRACE_API(hbme280);
     HAL_StatusTypeDef status;
-    BME280_S32_t adc_P;
 
-    status = HAL_I2C_Mem_Read_DMA(hbme280->i2c_handle,hbme280->I2C_address,BME280_PRESS_MSB_REG,I2C_MEMADD_SIZE_8BIT,hbme280->Reg.press_msb_reg,3);
+    status = RegCore_Load(&bme280Desc, hbme280, BME280_IDX_PRESS_MSB, 3);
     if(status != HAL_OK) return status;
 
-    adc_P = (BME280_S32_t)(((uint32_t)(hbme280->Reg.press_msb_reg) << 12) | ((uint32_t)(hbme280->Reg.press_lsb_reg) << 4) | ((uint32_t)hbme280->Reg.press_xlsb_reg >> 4));
-    hbme280->pressure = (float)BME280_compensate_P_int64(adc_P,hbme280->Comp) / 256.0f;
+    BME280_ConvertPress(hbme280, &hbme280->Reg.press_msb_reg);
     return HAL_OK;
 }
 
@@ -210,17 +414,50 @@ HAL_StatusTypeDef BME280_GetPress(BME280_Handle_t* hbme280)
  */
 HAL_StatusTypeDef BME280_GetHum(BME280_Handle_t* hbme280)
 {
+    DRIVER_TRACE_API(hbme280);
     HAL_StatusTypeDef status;
-    BME280_S32_t adc_H;
 
-    status = HAL_I2C_Mem_Read_DMA(hbme280->i2c_handle,hbme280->I2C_address,BME280_HUM_MSB_REG,I2C_MEMADD_SIZE_8BIT,hbme280->Reg.hum_msb_reg,2);
+    status = RegCore_Load(&bme280Desc, hbme280, BME280_IDX_HUM_MSB, 2);
     if(status != HAL_OK) return status;
 
-    adc_H = (BME280_S32_t)(((uint32_t)(hbme280->Reg.hum_msb_reg) << 8) | ((uint32_t)hbme280->Reg.hum_lsb_reg));
-    hbme280->humidity = (float)BME280_compensate_H_int32(adc_H,hbme280->Comp) / 1024.0f;
+    BME280_ConvertHum(hbme280, &hbme280->Reg.hum_msb_reg);
     return HAL_OK;
 }
 
+/**
+ * @brief Read pressure, temperature and humidity in one burst
+ * @param hbme280 Pointer to BME280 handle structure
+ * @return HAL_StatusTypeDef HAL_OK on success, error code otherwise
+ * @details One transaction of BME280_BURST_LEN bytes instead of three. The
+ *          datasheet recommends it: the chip shadows the result registers
+ *          during a burst, so the three values come from the same measurement.
+ */
+HAL_StatusTypeDef BME280_GetAll(BME280_Handle_t* hbme280)
+{
+    DRIVER_TRACE_API(hbme280);
+    HAL_StatusTypeDef status;
+
+    status = RegCore_Load(&bme280Desc, hbme280, BME280_IDX_PRESS_MSB, BME280_BURST_LEN);
+    if(status != HAL_OK) return status;
+
+    BME280_ParseMeasurement(hbme280, &hbme280->Reg.press_msb_reg);
+    return HAL_OK;
+}
+
+/**
+ * @brief Fill temperature, pressure and humidity from a raw burst
+ * @param hbme280 Pointer to BME280 handle structure
+ * @param data BME280_BURST_LEN bytes read from BME280_PRESS_MSB_REG
+ * @details For callers that read the results themselves, e.g. through the
+ *          transport from its DMA completion callback.
+ */
+void BME280_ParseMeasurement(BME280_Handle_t* hbme280, const uint8_t* data)
+{
+    BME280_ConvertTemp(hbme280, &data[3]);
+    BME280_ConvertPress(hbme280, &data[0]);
+    BME280_ConvertHum(hbme280, &data[6]);
+}
+
 /**
  * @brief Set oversampling values and mode for BME280
  * @param hbme280 Pointer to BME280 handle structure
@@ -229,19 +466,15 @@ HAL_StatusTypeDef BME280_GetHum(BME280_Handle_t* hbme280)
  * @param osrs_p Pressure oversampling setting
  * @param osrs_h Humidity oversampling setting
  * @return HAL_StatusTypeDef HAL_OK on success, error code otherwise
+ * @details ctrl_hum is only written when it changes; ctrl_meas always is,
+ *          which also makes a new ctrl_hum take effect.
  */
 HAL_StatusTypeDef BME280_SetOSVals(BME280_Handle_t* hbme280,uint8_t mode ,uint8_t osrs_t,uint8_t osrs_p,uint8_t osrs_h)
 {
-    HAL_StatusTypeDef status;
-    hbme280->Reg.ctrl_meas_reg = (osrs_t << 5) | (osrs_p << 2) | mode;
-    hbme280->Reg.ctrl_hum_reg = osrs_h;
-
-    status = HAL_I2C_Mem_Write_DMA(hbme280->i2c_handle,hbme280->I2C_address,BME280_CTRL_HUM_REG,I2C_MEMADD_SIZE_8BIT,&hbme280->Reg.ctrl_hum_reg,1);
-    if(status != HAL_OK) return status;
-    status = HAL_I2C_Mem_Write_DMA(hbme280->i2c_handle,hbme280->I2C_address,BME280_CTRL_MEAS_REG,I2C_MEMADD_SIZE_8BIT,&hbme280->Reg.ctrl_meas_reg,1);
-    if(status != HAL_OK) return status;
-
-    return HAL_OK;
+    DRIVER_TRACE_API(hbme280);
+    RegCore_Stage(&bme280Desc, hbme280, BME280_IDX_CTRL_HUM, osrs_h);
+    RegCore_Stage(&bme280Desc, hbme280, BME280_IDX_CTRL_MEAS, (osrs_t << 5) | (osrs_p << 2) | mode);
+    return RegCore_Flush(&bme280Desc, hbme280);
 }
 
 /**
@@ -250,15 +483,76 @@ HAL_StatusTypeDef BME280_SetOSVals(BME280_Handle_t* hbme280,uint8_t mode ,uint8_
  * @param t_sb Standby time between measurements in normal mode
  * @param filter IIR filter coefficient
  * @return HAL_StatusTypeDef HAL_OK on success, error code otherwise
+ * @details Nothing is sent when the register already holds these settings.
  */
 HAL_StatusTypeDef BME280_SetConfig(BME280_Handle_t* hbme280,uint8_t t_sb,uint8_t filter)
 {
-    HAL_StatusTypeDef status;
-    hbme280->Reg.config_reg = (t_sb << 5) | (filter << 2);
+    DRIVER_TRACE_API(hbme280);
+    RegCore_Stage(&bme280Desc, hbme280, BME280_IDX_CONFIG, (t_sb << 5) | (filter << 2));
+    return RegCore_Flush(&bme280Desc, hbme280);
+}
 
-    status = HAL_I2C_Mem_Write_DMA(hbme280->i2c_handle,hbme280->I2C_address,BME280_CONFIG_REG,I2C_MEMADD_SIZE_8BIT,&hbme280->Reg.config_reg,1);
+/**
+ * @brief Apply mode, oversampling, standby and filter settings in one write
+ * @param hbme280 Pointer to BME280 handle structure
+ * @param settings Wire image from BME280_SETTINGS(); must stay valid until the
+ *        transfer completes, so normally a static const
+ * @return HAL_StatusTypeDef HAL_OK on success, error code otherwise
+ * @details Replaces BME280_SetOSVals() plus BME280_SetConfig() (three writes) by
+ *          one burst of register/data pairs. config writes may be ignored in
+ *          normal mode, so a sensor running in normal mode is put to sleep first;
+ *          ctrl_meas is read first unless the mirror already holds it.
+ */
+HAL_StatusTypeDef BME280_ApplySettings(BME280_Handle_t* hbme280, const BME280_Settings_t* settings)
+{
+    DRIVER_TRACE_API(hbme280);
+    HAL_StatusTypeDef status;
+    // The mode may be left over from before a reset, so read it if the mirror does not hold it
+    status = RegCore_Ensure(&bme280Desc, hbme280, BME280_IDX_CTRL_MEAS, 1);
     if(status != HAL_OK) return status;
-
+    if (RegCore_GetField(&bme280Desc, hbme280, BME280_FIELD_MODE) == BME280_MODE_NORMAL) {
+        status = RegCore_SetField(&bme280Desc, hbme280, BME280_FIELD_MODE, BME280_MODE_SLEEP);
+        if(status != HAL_OK) return status;
+    }
+    status = BME280_WriteRegs(hbme280,BME280_CTRL_HUM_REG,(uint8_t*)settings,sizeof(BME280_Settings_t));
+    if(status != HAL_OK) return status;
+    RegCore_Merge(&bme280Desc, hbme280, BME280_IDX_CTRL_HUM, &settings->ctrl_hum, 1);
+    RegCore_Merge(&bme280Desc, hbme280, BME280_IDX_CTRL_MEAS, &settings->ctrl_meas, 1);
+    RegCore_Merge(&bme280Desc, hbme280, BME280_IDX_CONFIG, &settings->config, 1);
     return HAL_OK;
 }
 
+/**
+ * @brief Start one forced-mode measurement with the configured oversampling
+ * @param hbme280 Pointer to BME280 handle structure
+ * @return HAL_StatusTypeDef HAL_OK on success, error code otherwise
+ * @details One register write; call BME280_SetOSVals() once beforehand. The
+ *          results can be read BME280_MeasureTimeUs() later.
+ */
+HAL_StatusTypeDef BME280_StartForced(BME280_Handle_t* hbme280)
+{
+    DRIVER_TRACE_API(hbme280);
+    return RegCore_SetField(&bme280Desc, hbme280, BME280_FIELD_MODE, BME280_MODE_FORCED);
+}
+
+/**
+ * @brief Maximum duration of one measurement with the configured oversampling
+ * @param hbme280 Pointer to BME280 handle structure
+ * @return uint32_t Microseconds, datasheet appendix B maximum
+ * @details 1.25 ms plus 2.3 ms per temperature sample, and 2.3 ms per pressure
+ *          or humidity sample plus 0.575 ms for each of the two that is enabled.
+ *          BME280_MEASURE_US() is the compile-time equivalent.
+ */
+uint32_t BME280_MeasureTimeUs(const BME280_Handle_t* hbme280)
+{
+    static const uint8_t samples[8] = {0, 1, 2, 4, 8, 16, 16, 16}; // By osrs_x code
+    uint32_t osrsT = samples[RegCore_GetField(&bme280Desc, hbme280, BME280_FIELD_OSRS_T)];
+    uint32_t osrsP = samples[RegCore_GetField(&bme280Desc, hbme280, BME280_FIELD_OSRS_P)];
+    uint32_t osrsH = samples[RegCore_GetField(&bme280Desc, hbme280, BME280_FIELD_OSRS_H)];
+    uint32_t us = 1250u + 2300u * osrsT;
+
+    if (osrsP != 0) us += 2300u * osrsP + 575u;
+    if (osrsH != 0) us += 2300u * osrsH + 575u;
+    return us;
+}
+
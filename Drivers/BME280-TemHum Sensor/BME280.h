@@ -1,6 +1,11 @@
 #ifndef BME280_H
 #define BME280_H
 #include "main.h"
+#include "RegCore.h"
+#include "DmaCache.h"
+#ifdef USE_I2CBUS
+#include "I2CBus.h"
+#endif
 #include <stdint.h>
 /*------------------- Regester Address Defines ---------------------------*/
 #define BME280_ID_REG 0xD0
@@ -17,6 +22,11 @@
 #define BME280_TEMP_XLSB_REG 0xFC
 #define BME280_HUM_MSB_REG 0xFD
 #define BME280_HUM_LSB_REG 0xFE
+#define BME280_CALIB_A_REG 0x88 // dig_T1 ... dig_H1
+#define BME280_CALIB_A_LEN 26
+#define BME280_CALIB_B_REG 0xE1 // dig_H2 ... dig_H6
+#define BME280_CALIB_B_LEN 7
+#define BME280_BURST_LEN 8 // press_msb ... hum_lsb, one measurement
 /************************ Bit Mask defines ********************************/
 #define BME280_OS_HUM_SKIP 0x00
 #define BME280_OS_HUM_x1   0x01
@@ -52,6 +62,49 @@
 #define BME280_FILTER_x4 0x02
 #define BME280_FILTER_x8 0x03
 #define BME280_FILTER_x16 0x04
+#define BME280_RESET_WORD 0xB6
+/************************ Timing defines ********************************/
+#define BME280_STARTUP_US 2000 // Power-on or soft reset until the NVM copy is done and registers are usable
+
+/************************ Compile-time Configuration ********************************/
+// BME280_SETTINGS() turns mode, oversampling, standby and filter codes into the
+// wire image of a single configuration write, as a constant initializer. Codes
+// out of range, or pressure/humidity without the temperature measurement that
+// their compensation depends on (t_fine), stop the build:
+//   static const BME280_Settings_t env = BME280_SETTINGS(BME280_MODE_NORMAL,
+//       BME280_OS_TEMP_x2, BME280_OS_PRESS_x16, BME280_OS_HUM_x1, BME280_STANDBY_62_5MS, BME280_FILTER_x16);
+//   BME280_ApplySettings(&hbme280, &env);
+#define BME280_CHECK(cond, msg) (0u * sizeof(struct { _Static_assert(cond, msg); int unused; }))
+
+#define BME280_SETTINGS(mode, osrs_t, osrs_p, osrs_h, t_sb, filter) { \
+    .ctrl_hum = (uint8_t)(BME280_CHECK((unsigned)(osrs_h) <= 5u, "BME280: osrs_h out of range") + (osrs_h)), \
+    .configReg = BME280_CONFIG_REG, \
+    .config = (uint8_t)(BME280_CHECK((unsigned)(t_sb) <= 7u, "BME280: t_sb out of range") + \
+        BME280_CHECK((unsigned)(filter) <= 4u, "BME280: filter out of range") + \
+        ((unsigned)(t_sb) << 5 | (unsigned)(filter) << 2)), \
+    .ctrlMeasReg = BME280_CTRL_MEAS_REG, \
+    .ctrl_meas = (uint8_t)(BME280_CHECK((unsigned)(osrs_t) <= 5u, "BME280: osrs_t out of range") + \
+        BME280_CHECK((unsigned)(osrs_p) <= 5u, "BME280: osrs_p out of range") + \
+        BME280_CHECK((mode) == BME280_MODE_SLEEP || (mode) == BME280_MODE_FORCED || (mode) == BME280_MODE_NORMAL, \
+            "BME280: mode must be BME280_MODE_SLEEP, _FORCED or _NORMAL") + \
+        BME280_CHECK((osrs_t) != 0 || ((osrs_p) == 0 && (osrs_h) == 0), \
+            "BME280: pressure and humidity compensation need the temperature measurement") + \
+        ((unsigned)(osrs_t) << 5 | (unsigned)(osrs_p) << 2 | (unsigned)(mode))) }
+
+#define BME280_OS_SAMPLES(code) ((code) == 0 ? 0u : (code) >= 5 ? 16u : 1u << ((code) - 1))
+#define BME280_MEASURE_US(osrs_t, osrs_p, osrs_h) (1250u + 2300u * BME280_OS_SAMPLES(osrs_t) + \
+    ((osrs_p) != 0 ? 2300u * BME280_OS_SAMPLES(osrs_p) + 575u : 0u) + \
+    ((osrs_h) != 0 ? 2300u * BME280_OS_SAMPLES(osrs_h) + 575u : 0u)) // Datasheet appendix B maximum
+#define BME280_STANDBY_US(t_sb) ((t_sb) == 0 ? 500u : (t_sb) <= 5 ? 62500u << ((t_sb) - 1) : (t_sb) == 6 ? 10000u : 20000u)
+
+/************************ Handle Layout ********************************/
+// Define BME280_COMPACT_HANDLE (or DRIVERS_COMPACT_HANDLES for every driver) on
+// memory-constrained targets: results are kept in fixed point instead of float,
+// the calibration block is packed and unused register mirrors are dropped.
+//   temperature: 0.01 degC   pressure: 1/256 Pa   humidity: 0.01 %RH
+#if defined(DRIVERS_COMPACT_HANDLES) && !defined(BME280_COMPACT_HANDLE)
+#define BME280_COMPACT_HANDLE
+#endif
 
 /************************ Driver Structs ********************************/
 typedef int32_t   BME280_S32_t;
@@ -75,19 +128,53 @@ typedef struct {
     BME280_S16_t dig_P7;
     BME280_S16_t dig_P8;
     BME280_S16_t dig_P9;
+#ifdef BME280_COMPACT_HANDLE
+    BME280_S16_t dig_H2;
+    BME280_S16_t dig_H4;
+    BME280_S16_t dig_H5;
+    BME280_U8_t  dig_H1;
+    BME280_U8_t  dig_H3;
+    BME280_S8_t  dig_H6;
+#else
     BME280_U8_t  dig_H1;
     BME280_S16_t dig_H2;
     BME280_U8_t  dig_H3;
     BME280_S16_t dig_H4;
     BME280_S16_t dig_H5;
     BME280_S8_t  dig_H6;
+#endif
 }BME280_Compensations_t;
 
+/************************ Transport ********************************/
+// Set hbme280->transport to run the driver over something other than its
+// built-in I2C path, e.g. SPI (BME280Spi.h). NULL keeps I2C through
+// i2c_handle (or bus_client) and I2C_address.
+typedef struct BME280_Transport_s BME280_Transport_t;
+
+typedef struct {
+    // Burst read of size registers starting at reg
+    HAL_StatusTypeDef (*read)(BME280_Transport_t* transport, uint8_t reg, uint8_t* data, uint16_t size);
+    // Write data[0] to reg; further bytes are register/value pairs, see BME280_Settings_t
+    HAL_StatusTypeDef (*write)(BME280_Transport_t* transport, uint8_t reg, const uint8_t* data, uint16_t size);
+} BME280_TransportOps_t;
+
+struct BME280_Transport_s {
+    const BME280_TransportOps_t* ops;
+    // Optional, called once per transfer when it has finished: before read/write
+    // return for polled transfers, from the completion interrupt for DMA
+    void (*done)(void* ctx, HAL_StatusTypeDef status);
+    void* ctx;
+};
+
 typedef struct {
     uint8_t id_reg;
+#ifndef BME280_COMPACT_HANDLE
     uint8_t reset_reg;
+#endif
     uint8_t ctrl_hum_reg;
+#ifndef BME280_COMPACT_HANDLE
     uint8_t status_reg;
+#endif
     uint8_t ctrl_meas_reg;
     uint8_t config_reg;
     uint8_t press_msb_reg;
@@ -100,24 +187,77 @@ typedef struct {
     uint8_t hum_lsb_reg;
 } BME280_RegMap_t;
 
+#ifdef BME280_COMPACT_HANDLE
+typedef struct {
+    I2C_HandleTypeDef* i2c_handle;
+#ifdef USE_I2CBUS
+    I2CBus_Client_t* bus_client; // Transfers go through the bus manager instead of i2c_handle
+#endif
+#if defined(DRIVERS_DCACHE) && !defined(USE_I2CBUS)
+    DmaCache_Rx_t dmaRx; // DMA read in flight on i2c_handle, for DmaCache_RxDone() in the receive callback
+#endif
+    BME280_Transport_t* transport; // NULL for I2C
+    uint32_t pressure;    // 1/256 Pa
+    int16_t temperature;  // 0.01 degC
+    uint16_t humidity;    // 0.01 %RH
+    RegCore_State_t regState;
+    BME280_Compensations_t Comp;
+    DMACACHE_REGION(RegLines, BME280_RegMap_t Reg); // Register mirror, DMA source and destination
+    uint8_t I2C_address;
+#ifdef DRIVERS_DCACHE
+    // Calibration read in BME280_CalCompensationParams(), kept off the stack for DMA
+    DMACACHE_REGION(calibLines, uint8_t calib[BME280_CALIB_A_LEN + BME280_CALIB_B_LEN]);
+#endif
+} BME280_Handle_t;
+#else
 typedef struct {
     I2C_HandleTypeDef* i2c_handle;
+#ifdef USE_I2CBUS
+    I2CBus_Client_t* bus_client; // Transfers go through the bus manager instead of i2c_handle
+#endif
+#if defined(DRIVERS_DCACHE) && !defined(USE_I2CBUS)
+    DmaCache_Rx_t dmaRx; // DMA read in flight on i2c_handle, for DmaCache_RxDone() in the receive callback
+#endif
+    BME280_Transport_t* transport; // NULL for I2C
     uint8_t I2C_address;
     float temperature;
     float pressure;
     float humidity;
+    RegCore_State_t regState;
     BME280_Compensations_t Comp;
-    BME280_RegMap_t Reg;
+    DMACACHE_REGION(RegLines, BME280_RegMap_t Reg); // Register mirror, DMA source and destination
+#ifdef DRIVERS_DCACHE
+    // Calibration read in BME280_CalCompensationParams(), kept off the stack for DMA
+    DMACACHE_REGION(calibLines, uint8_t calib[BME280_CALIB_A_LEN + BME280_CALIB_B_LEN]);
+#endif
 } BME280_Handle_t;
+#endif
+
+// One configuration write: the bytes after the first register address
+// (BME280_CTRL_HUM_REG), ctrl_meas last so the new ctrl_hum takes effect
+typedef struct {
+    uint8_t ctrl_hum;
+    uint8_t configReg;
+    uint8_t config;
+    uint8_t ctrlMeasReg;
+    uint8_t ctrl_meas;
+} BME280_Settings_t;
 
 /*------------------- Function Declarations ---------------------------*/
 HAL_StatusTypeDef BME280_Init(BME280_Handle_t* hbme280);
 HAL_StatusTypeDef BME280_CalCompensationParams(BME280_Handle_t* hbme280);
+void BME280_ParseCalib(BME280_Handle_t* hbme280, const uint8_t* calibA, const uint8_t* calibB);
+HAL_StatusTypeDef BME280_SoftReset(BME280_Handle_t* hbme280);
 HAL_StatusTypeDef BME280_GetTemp(BME280_Handle_t* hbme280);
 HAL_StatusTypeDef BME280_GetPress(BME280_Handle_t* hbme280);
 HAL_StatusTypeDef BME280_GetHum(BME280_Handle_t* hbme280);
+HAL_StatusTypeDef BME280_GetAll(BME280_Handle_t* hbme280);
+void BME280_ParseMeasurement(BME280_Handle_t* hbme280, const uint8_t* data);
 HAL_StatusTypeDef BME280_SetOSVals(BME280_Handle_t* hbme280,uint8_t mode,uint8_t osrs_t,uint8_t osrs_p,uint8_t osrs_h);
 HAL_StatusTypeDef BME280_SetConfig(BME280_Handle_t* hbme280,uint8_t t_sb,uint8_t filter);
+HAL_StatusTypeDef BME280_ApplySettings(BME280_Handle_t* hbme280, const BME280_Settings_t* settings);
+HAL_StatusTypeDef BME280_StartForced(BME280_Handle_t* hbme280);
+uint32_t BME280_MeasureTimeUs(const BME280_Handle_t* hbme280);
 BME280_S32_t BME280_compensate_T_int32(BME280_S32_t adc_T,BME280_Compensations_t comp);
 BME280_U32_t BME280_compensate_P_int64(BME280_S32_t adc_P,BME280_Compensations_t comp);
 BME280_U32_t BME280_compensate_H_int32(BME280_S32_t adc_H,BME280_Compensations_t comp);
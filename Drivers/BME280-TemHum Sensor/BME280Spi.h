@@ -0,0 +1,30 @@
+#ifndef BME280_SPI_H
+#define BME280_SPI_H
+#include "BME280.h"
+
+/*------------------- Configuration ---------------------------*/
+#ifndef BME280_SPI_TIMEOUT_MS
+#define BME280_SPI_TIMEOUT_MS 10 // Polled transfers
+#endif
+#define BME280_SPI_MAX_FRAME (1 + BME280_CALIB_A_LEN) // Control byte plus the longest burst the driver reads
+#define BME280_SPI_READ 0x80 // Control byte bit 7: 1 read, 0 write
+
+/************************ SPI Transport Structs ********************************/
+typedef struct {
+    BME280_Transport_t base; // Must stay first, hbme280->transport = &spi.base
+    SPI_HandleTypeDef* hspi; // Mode 0 or 3, at most 10 MHz
+    GPIO_TypeDef* csPort;    // Chip select, a GPIO output driven by the transport
+    uint16_t csPin;
+    uint8_t useDma;          // 0: transfers finish before returning; 1: in BME280_SpiOnComplete()
+    volatile uint8_t busy;   // A DMA transfer is on the wire
+    uint8_t* rxDest;         // Caller buffer of the DMA read in flight
+    uint16_t rxLen;          // Frame length less the control byte
+    DMACACHE_REGION(txLines, uint8_t tx[BME280_SPI_MAX_FRAME]); // DMA source
+    DMACACHE_REGION(rxLines, uint8_t rx[BME280_SPI_MAX_FRAME]); // DMA destination
+} BME280_Spi_t;
+
+/*------------------- Function Prototypes ---------------------------*/
+void BME280_SpiInit(BME280_Spi_t* spi, SPI_HandleTypeDef* hspi, GPIO_TypeDef* csPort, uint16_t csPin, uint8_t useDma);
+void BME280_SpiOnComplete(BME280_Spi_t* spi, SPI_HandleTypeDef* hspi, HAL_StatusTypeDef status);
+
+#endif
@@ -0,0 +1,264 @@
+#define _POSIX_C_SOURCE 200809L // clock_gettime
+#include "TransportBench.h"
+#include "SimBME280.h"
+#include <string.h>
+#include <time.h>
+
+/**
+ ******************************************************************************
+ * @file    TransportBench.c
+ * @author  Yair Yamin
+ * @brief   Wire time per BME280 measurement over I2C and SPI.
+ * @details Runs TRANSPORT_BENCH_MEASUREMENTS forced measurements against the
+ * simulated BME280, each with new raw readings, over the built-in I2C path at
+ * 100 kHz, 400 kHz and 1 MHz and over BME280Spi at 1, 4 and 10 MHz.
+ *
+ * - separate: BME280_GetTemp(), BME280_GetPress(), BME280_GetHum().
+ * - burst: BME280_GetAll(), one read of BME280_BURST_LEN bytes.
+ * - async: the burst through base.ops->read with DMA completing in simulated
+ *   time, parsed by BME280_ParseMeasurement() from base.done.
+ *
+ * Every measurement is compared with the readings of a 400 kHz I2C run.
+ ******************************************************************************
+ */
+
+/* ========================== Defines ============================ */
+#define TRANSPORT_BENCH_ADDR   (0x76 << 1)
+#define TRANSPORT_BENCH_CS_PIN GPIO_PIN_4 // On GPIOA
+
+/* ========================== Global Variables ============================ */
+static struct {
+    I2C_HandleTypeDef hi2c;
+    SPI_HandleTypeDef hspi;
+    SimBME280_t sim;
+    BME280_Handle_t bme;
+    BME280_Spi_t spi;
+    uint8_t raw[BME280_BURST_LEN];
+    uint8_t waiting;        // The async burst read is on the wire
+    uint8_t done;
+    HAL_StatusTypeDef doneStatus;
+} bench;
+static double reference[TRANSPORT_BENCH_MEASUREMENTS][3];
+static uint32_t seed;
+
+static const char *const readNames[] = {"separate", "burst", "async"};
+
+/* ========================== Static Helpers ============================ */
+
+static uint64_t TransportBench_CpuNs(void)
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_PROCESS_CPUTIME_ID, &ts);
+    return (uint64_t)ts.tv_sec * 1000000000u + (uint64_t)ts.tv_nsec;
+}
+
+static int32_t TransportBench_Around(int32_t center, int32_t span)
+{
+    seed = seed * 1664525u + 1013904223u;
+    return center - span + (int32_t)((seed >> 8) % (uint32_t)(2 * span + 1));
+}
+
+static void TransportBench_OnBurst(void *ctx, HAL_StatusTypeDef status)
+{
+    if (!bench.waiting) return; // Forced-mode start
+    bench.waiting = 0;
+    bench.done = 1;
+    bench.doneStatus = status;
+    if (status == HAL_OK) {
+        BME280_ParseMeasurement((BME280_Handle_t *)ctx, bench.raw);
+    }
+}
+
+void HAL_SPI_TxRxCpltCallback(SPI_HandleTypeDef *hspi)
+{
+    BME280_SpiOnComplete(&bench.spi, hspi, HAL_OK);
+}
+
+void HAL_SPI_ErrorCallback(SPI_HandleTypeDef *hspi)
+{
+    BME280_SpiOnComplete(&bench.spi, hspi, HAL_ERROR);
+}
+
+static HAL_StatusTypeDef TransportBench_Setup(int spi, uint32_t busHz, TransportBench_Read_t read)
+{
+    HAL_StatusTypeDef status;
+
+    memset(&bench, 0, sizeof(bench));
+    HostSim_Reset();
+    SimBME280_Init(&bench.sim, TRANSPORT_BENCH_ADDR);
+    if (spi) {
+        // Init and configuration complete before returning, even with DMA
+        HostSim_SPIInit(&bench.hspi, busHz, HOSTSIM_DMA_IMMEDIATE);
+        SimBME280_AttachSpi(&bench.sim, &bench.hspi, GPIOA, TRANSPORT_BENCH_CS_PIN);
+        BME280_SpiInit(&bench.spi, &bench.hspi, GPIOA, TRANSPORT_BENCH_CS_PIN, read == TRANSPORT_BENCH_ASYNC);
+        bench.spi.base.done = TransportBench_OnBurst;
+        bench.spi.base.ctx = &bench.bme;
+        bench.bme.transport = &bench.spi.base;
+    } else {
+        HostSim_I2CInit(&bench.hi2c, busHz, HOSTSIM_DMA_IMMEDIATE);
+        HostSim_Attach(&bench.hi2c, &bench.sim.dev);
+        bench.bme.i2c_handle = &bench.hi2c;
+        bench.bme.I2C_address = TRANSPORT_BENCH_ADDR;
+    }
+    status = BME280_Init(&bench.bme);
+    if (status != HAL_OK) return status;
+    status = BME280_SetOSVals(&bench.bme, BME280_MODE_SLEEP, BME280_OS_TEMP_x1, BME280_OS_PRESS_x1, BME280_OS_HUM_x1);
+    if (status != HAL_OK) return status;
+
+    bench.hspi.dmaMode = HOSTSIM_DMA_DEFERRED;
+    memset(&bench.hi2c.stats, 0, sizeof(bench.hi2c.stats));
+    memset(&bench.hspi.stats, 0, sizeof(bench.hspi.stats));
+    return HAL_OK;
+}
+
+static HAL_StatusTypeDef TransportBench_Read(TransportBench_Read_t read, uint64_t *latencyNs)
+{
+    HAL_StatusTypeDef status;
+    uint64_t start;
+
+    switch (read) {
+    case TRANSPORT_BENCH_SEPARATE:
+        status = BME280_GetTemp(&bench.bme);
+        if (status == HAL_OK) status = BME280_GetPress(&bench.bme);
+        if (status == HAL_OK) status = BME280_GetHum(&bench.bme);
+        return status;
+    case TRANSPORT_BENCH_BURST:
+        return BME280_GetAll(&bench.bme);
+    default:
+        start = HostSim_NowNs();
+        bench.done = 0;
+        bench.waiting = 1;
+        status = bench.spi.base.ops->read(&bench.spi.base, BME280_PRESS_MSB_REG, bench.raw, BME280_BURST_LEN);
+        if (status != HAL_OK) {
+            bench.waiting = 0;
+            return status;
+        }
+        while (!bench.done) {
+            HostSim_WaitForEvent();
+        }
+        if (HostSim_NowNs() - start > *latencyNs) {
+            *latencyNs = HostSim_NowNs() - start;
+        }
+        // Chip select must be released once the frame is over
+        if (!(GPIOA->ODR & TRANSPORT_BENCH_CS_PIN)) return HAL_ERROR;
+        return bench.doneStatus;
+    }
+}
+
+/* ========================== Function Definitions ============================ */
+
+/**
+ * @brief Run the forced measurements over one transport
+ * @param transport "i2c" or "spi"
+ * @param busHz SCL or SCK frequency
+ * @param read How the results are read, TRANSPORT_BENCH_ASYNC only over SPI
+ * @return TransportBench_Result_t Totals of the run; mismatches counts against
+ *         the reference filled by the first call
+ */
+TransportBench_Result_t TransportBench_Run(const char *transport, uint32_t busHz, TransportBench_Read_t read)
+{
+    static int haveReference = 0;
+    TransportBench_Result_t r;
+    const HostSim_BusStats_t *stats;
+    int spi = (strcmp(transport, "spi") == 0);
+    uint64_t cpuStart;
+
+    memset(&r, 0, sizeof(r));
+    r.transport = transport;
+    r.read = read;
+    r.busHz = busHz;
+    if (TransportBench_Setup(spi, busHz, read) != HAL_OK) {
+        return r;
+    }
+    stats = spi ? &bench.hspi.stats : &bench.hi2c.stats;
+
+    seed = 1;
+    cpuStart = TransportBench_CpuNs();
+    for (uint32_t i = 0; i < TRANSPORT_BENCH_MEASUREMENTS; i++) {
+        int32_t adcT = TransportBench_Around(519888, 30000);
+        int32_t adcP = TransportBench_Around(415148, 30000);
+        int32_t adcH = TransportBench_Around(30000, 8000);
+        double got[3];
+
+        SimBME280_SetRaw(&bench.sim, adcT, adcP, adcH);
+        if (BME280_StartForced(&bench.bme) != HAL_OK) break;
+        HostSim_AdvanceUs(BME280_MeasureTimeUs(&bench.bme));
+        if (TransportBench_Read(read, &r.latencyNs) != HAL_OK) break;
+
+        got[0] = (double)bench.bme.temperature;
+        got[1] = (double)bench.bme.pressure;
+        got[2] = (double)bench.bme.humidity;
+        if (!haveReference) {
+            memcpy(reference[i], got, sizeof(got));
+        } else if (memcmp(reference[i], got, sizeof(got)) != 0) {
+            r.mismatches++;
+        }
+        r.measurements++;
+    }
+    r.cpuNs = TransportBench_CpuNs() - cpuStart;
+    haveReference = 1;
+
+    r.transactions = stats->transactions;
+    r.bytes = stats->bytes;
+    r.wireNs = stats->busyNs;
+    r.pass = (r.measurements == TRANSPORT_BENCH_MEASUREMENTS && r.mismatches == 0);
+    return r;
+}
+
+/**
+ * @brief Write results as CSV, per measurement
+ * @param out Output stream
+ * @param results Results to write
+ * @param count Number of results
+ */
+void TransportBench_WriteCsv(FILE *out, const TransportBench_Result_t *results, uint16_t count)
+{
+    fprintf(out, "transport,read,bus_hz,measurements,transactions,bytes,wire_us,latency_us,cpu_ns,mismatches,status\n");
+    for (uint16_t i = 0; i < count; i++) {
+        const TransportBench_Result_t *r = &results[i];
+        double n = r->measurements ? (double)r->measurements : 1.0;
+        fprintf(out, "%s,%s,%lu,%lu,%.1f,%.1f,%.2f,%.2f,%.0f,%lu,%s\n", r->transport, readNames[r->read],
+                (unsigned long)r->busHz, (unsigned long)r->measurements, (double)r->transactions / n,
+                (double)r->bytes / n, (double)r->wireNs / n / 1000.0, (double)r->latencyNs / 1000.0,
+                (double)r->cpuNs / n, (unsigned long)r->mismatches, r->pass ? "ok" : "FAIL");
+    }
+}
+
+/**
+ * @brief Run every transport and read mode and print the CSV
+ * @return int 0 if every run matched the reference, 1 if one did not, 2 on a usage error
+ */
+int TransportBench_Main(int argc, char **argv)
+{
+    static const uint32_t i2cHz[] = {100000, 400000, 1000000};
+    static const uint32_t spiHz[] = {1000000, 4000000, 10000000};
+    TransportBench_Result_t results[16];
+    uint16_t count = 0;
+    int failed = 0;
+
+    if (argc > 1) {
+        fprintf(stderr, "usage: %s\n", argv[0]);
+        return 2;
+    }
+    (void)TransportBench_Run("i2c", 400000, TRANSPORT_BENCH_SEPARATE); // Reference readings
+
+    for (uint16_t i = 0; i < sizeof(i2cHz) / sizeof(i2cHz[0]); i++) {
+        results[count++] = TransportBench_Run("i2c", i2cHz[i], TRANSPORT_BENCH_SEPARATE);
+        results[count++] = TransportBench_Run("i2c", i2cHz[i], TRANSPORT_BENCH_BURST);
+    }
+    for (uint16_t i = 0; i < sizeof(spiHz) / sizeof(spiHz[0]); i++) {
+        results[count++] = TransportBench_Run("spi", spiHz[i], TRANSPORT_BENCH_SEPARATE);
+        results[count++] = TransportBench_Run("spi", spiHz[i], TRANSPORT_BENCH_BURST);
+        results[count++] = TransportBench_Run("spi", spiHz[i], TRANSPORT_BENCH_ASYNC);
+    }
+
+    TransportBench_WriteCsv(stdout, results, count);
+    for (uint16_t i = 0; i < count; i++) {
+        if (!results[i].pass) {
+            fprintf(stderr, "%s %s at %lu Hz failed\n", results[i].transport, readNames[results[i].read],
+                    (unsigned long)results[i].busHz);
+            failed = 1;
+        }
+    }
+    return failed;
+}
@@ -0,0 +1,37 @@
+#ifndef TRANSPORT_BENCH_H
+#define TRANSPORT_BENCH_H
+#include "BME280Spi.h"
+#include <stdio.h>
+
+/*------------------- Configuration ---------------------------*/
+#ifndef TRANSPORT_BENCH_MEASUREMENTS
+#define TRANSPORT_BENCH_MEASUREMENTS 100 // Forced measurements per run
+#endif
+
+/************************ Bench Structs ********************************/
+typedef enum {
+    TRANSPORT_BENCH_SEPARATE = 0, // BME280_GetTemp(), _GetPress(), _GetHum()
+    TRANSPORT_BENCH_BURST,        // BME280_GetAll()
+    TRANSPORT_BENCH_ASYNC         // DMA burst through the transport, parsed from its done callback
+} TransportBench_Read_t;
+
+typedef struct {
+    const char *transport;  // "i2c" or "spi"
+    TransportBench_Read_t read;
+    uint32_t busHz;
+    uint32_t measurements;
+    uint64_t transactions;  // Whole run, forced-mode start included
+    uint64_t bytes;         // On the wire, I2C address bytes included
+    uint64_t wireNs;        // Bus busy time
+    uint64_t latencyNs;     // Worst read start to done callback, async only
+    uint64_t cpuNs;         // Host CPU time, simulator included, informational only
+    uint32_t mismatches;    // Measurements that differ from the I2C reference
+    int pass;               // 1 if every measurement matched and, for async, completed
+} TransportBench_Result_t;
+
+/*------------------- Function Prototypes ---------------------------*/
+TransportBench_Result_t TransportBench_Run(const char *transport, uint32_t busHz, TransportBench_Read_t read);
+void TransportBench_WriteCsv(FILE *out, const TransportBench_Result_t *results, uint16_t count);
+int TransportBench_Main(int argc, char **argv);
+
+#endif
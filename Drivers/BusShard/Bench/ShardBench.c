@@ -0,0 +1,311 @@
+#include "ShardBench.h"
+#include "SimADS1115.h"
+#include "SimBME280.h"
+#include "SimDS3231.h"
+#include <stdlib.h>
+#include <string.h>
+
+/**
+ ******************************************************************************
+ * @file    ShardBench.c
+ * @author  Yair Yamin
+ * @brief   One bus against three for a sensor set placed by BusShard.
+ * @details The set needs about one 100 kHz bus worth of wire time:
+ *
+ * - Four ADS1115 (0x48 ... 0x4B), single-shot at 860 SPS, 250 Hz each
+ * - Two BME280 (0x76, 0x77), forced mode at x1 oversampling, 50 Hz each
+ * - One DS3231, time and date at 10 Hz, wired to the first bus only
+ *
+ * "single" puts everything on hi2c1 as the hand-bound handles do today, with
+ * the placement limit lifted; "sharded" lets BusShard spread the devices over
+ * three buses. Each simulated device is attached to the bus it was placed
+ * on, as if the board routed it there. Both run for the same simulated time
+ * with deferred DMA completions, so the buses move data independently.
+ *
+ * "stuck" is the sharded run with the completion of the first transfer on
+ * SHARD_BENCH_HANG_BUS lost. The bus watchdog, run by BusShard_Poll(), must
+ * abort it: that sample is one error, and the devices on the bus go back to
+ * their rate while the other buses are untouched.
+ *
+ * Per device: achieved rate, missed periods, lateness. Per bus: the planned
+ * load, the load counted from the finished transactions, and the simulated
+ * SCL busy time, which must agree. The run also reports how much of the time
+ * two or more buses were transferring at once.
+ ******************************************************************************
+ */
+
+/* ========================== Defines ============================ */
+#define SHARD_BENCH_HZ 100000
+#define SHARD_BENCH_ADS  0
+#define SHARD_BENCH_BME  1
+#define SHARD_BENCH_RTC  2
+
+/************************ Bench Context ********************************/
+typedef struct {
+    uint8_t type;
+    uint8_t address;  // 7-bit
+    uint32_t periodUs;
+    uint8_t busMask;
+} ShardBench_Spec_t;
+
+typedef struct {
+    I2C_HandleTypeDef hi2c[SHARD_BENCH_BUSES];
+    SimADS1115_t simAds[4];
+    SimBME280_t simBme[2];
+    SimDS3231_t simRtc;
+    ADS1115_Handle_t ads[4];
+    BME280_Handle_t bme[2];
+    DS3231_Handle_t rtc;
+    HostSim_Device_t *sim[SHARD_BENCH_DEVICES];
+    BusShard_t shard;
+} ShardBench_Ctx_t;
+
+static const ShardBench_Spec_t specs[SHARD_BENCH_DEVICES] = {
+    {SHARD_BENCH_ADS, 0x48, 4000, 0},
+    {SHARD_BENCH_ADS, 0x49, 4000, 0},
+    {SHARD_BENCH_ADS, 0x4A, 4000, 0},
+    {SHARD_BENCH_ADS, 0x4B, 4000, 0},
+    {SHARD_BENCH_BME, 0x76, 20000, 0},
+    {SHARD_BENCH_BME, 0x77, 20000, 0},
+    {SHARD_BENCH_RTC, 0x68, 100000, 0x01},
+};
+
+static const char *const typeNames[] = {"ads1115", "bme280", "ds3231"};
+
+/* ========================== Static Helpers ============================ */
+
+static void ShardBench_Setup(ShardBench_Ctx_t *ctx, uint8_t busCount, ShardBench_Run_t *run)
+{
+    BusShard_t *shard = &ctx->shard;
+    BusShard_Config_t config;
+    uint8_t ads = 0, bme = 0;
+
+    memset(ctx, 0, sizeof(*ctx));
+    HostSim_Reset();
+    BusShard_Init(shard);
+    for (uint8_t b = 0; b < busCount; b++) {
+        HostSim_I2CInit(&ctx->hi2c[b], SHARD_BENCH_HZ, HOSTSIM_DMA_DEFERRED);
+        BusShard_AddBus(shard, &ctx->hi2c[b], SHARD_BENCH_HZ, NULL);
+    }
+    if (busCount == 1) {
+        shard->maxUtilPpm = 0xFFFFFFFFu; // Everything on hi2c1, however loaded
+    }
+
+    for (uint8_t i = 0; i < SHARD_BENCH_DEVICES; i++) {
+        const ShardBench_Spec_t *spec = &specs[i];
+        uint16_t addr = (uint16_t)(spec->address << 1);
+        if (spec->type == SHARD_BENCH_ADS) {
+            SimADS1115_Init(&ctx->simAds[ads], addr);
+            ctx->sim[i] = &ctx->simAds[ads].dev;
+            ctx->ads[ads].I2C_address = (uint8_t)addr;
+            BusShard_ADS1115Config(&config, &ctx->ads[ads], AIN0, spec->periodUs);
+            ads++;
+        } else if (spec->type == SHARD_BENCH_BME) {
+            SimBME280_Init(&ctx->simBme[bme], addr);
+            ctx->sim[i] = &ctx->simBme[bme].dev;
+            ctx->bme[bme].I2C_address = (uint8_t)addr;
+            BusShard_BME280Config(&config, &ctx->bme[bme], spec->periodUs);
+            bme++;
+        } else {
+            SimDS3231_Init(&ctx->simRtc, addr);
+            ctx->sim[i] = &ctx->simRtc.dev;
+            ctx->rtc.I2C_address = (uint8_t)addr;
+            BusShard_DS3231Config(&config, &ctx->rtc, spec->periodUs);
+        }
+        config.busMask = spec->busMask;
+        BusShard_AddDevice(shard, &config, NULL);
+        snprintf(run->devices[i].device, SHARD_BENCH_NAME_LEN, "%s@0x%02X", typeNames[spec->type], spec->address);
+    }
+    run->placement = BusShard_Place(shard);
+
+    // The board wires each device to the bus it was placed on
+    for (uint8_t i = 0; i < SHARD_BENCH_DEVICES; i++) {
+        if (shard->devices[i].bus != BUSSHARD_NO_BUS) {
+            HostSim_Attach(&ctx->hi2c[shard->devices[i].bus], ctx->sim[i]);
+        }
+    }
+    for (uint8_t i = 0; i < SHARD_BENCH_DEVICES; i++) {
+        if (shard->devices[i].bus == BUSSHARD_NO_BUS) {
+            continue;
+        }
+        if (specs[i].type == SHARD_BENCH_ADS) {
+            ADS1115_Init((ADS1115_Handle_t *)shard->devices[i].config.dev, ADS1115_MODE_SINGLESHOT_MASK, AIN0,
+                         ADS1115_PGA_4_096V_MASK, ADS1115_DR_860SPS_MASK);
+        } else if (specs[i].type == SHARD_BENCH_BME) {
+            BME280_Handle_t *hbme280 = (BME280_Handle_t *)shard->devices[i].config.dev;
+            BME280_Init(hbme280);
+            BME280_SetOSVals(hbme280, BME280_MODE_SLEEP, BME280_OS_TEMP_x1, BME280_OS_PRESS_x1, BME280_OS_HUM_x1);
+        } else {
+            ctx->rtc.time = (ds3231_time_t){.hours = 12, .minutes = 0, .seconds = 0};
+            ctx->rtc.date = (ds3231_data_t){.date = 1, .month = 1, .year = 25};
+            ctx->rtc.dayOfWeek = Wednesday;
+            DS3231_Init(&ctx->rtc);
+        }
+    }
+}
+
+/**
+ * @brief Poll the shard, advancing simulated time to the next completion or due sample
+ * @return uint64_t Nanoseconds with transfers on two or more buses
+ */
+static uint64_t ShardBench_Loop(ShardBench_Ctx_t *ctx, uint8_t busCount, uint64_t endNs)
+{
+    uint64_t parallelNs = 0;
+
+    while (HostSim_NowNs() < endNs) {
+        uint32_t idle = BusShard_Poll(&ctx->shard);
+        if (idle == 0) {
+            continue;
+        }
+        uint64_t now = HostSim_NowNs();
+        uint64_t step = (idle == 0xFFFFFFFFu) ? 1000000u : (uint64_t)idle * 1000u;
+        uint8_t busy = 0;
+        for (uint8_t b = 0; b < busCount; b++) {
+            const I2C_HandleTypeDef *hi2c = &ctx->hi2c[b];
+            if (hi2c->pendingCplt != HOSTSIM_CPLT_NONE) {
+                busy++;
+                if (hi2c->busyUntilNs - now < step) {
+                    step = hi2c->busyUntilNs - now;
+                }
+            }
+        }
+        if (now + step > endNs) {
+            step = endNs - now;
+        }
+        // Transfers only start in BusShard_Poll() or at a completion, so the
+        // busy buses stay busy up to the first completion
+        if (busy >= 2) {
+            parallelNs += step;
+        }
+        HostSim_AdvanceNs(step);
+    }
+    return parallelNs;
+}
+
+/* ========================== Function Definitions ============================ */
+
+/**
+ * @brief Place and sample the device set once
+ * @param busCount 1 for everything on hi2c1, SHARD_BENCH_BUSES to shard
+ * @param hangBus Bus whose first transfer never completes, BUSSHARD_NO_BUS for none
+ * @param seconds Simulated run time
+ * @param run Filled in
+ */
+void ShardBench_Run(uint8_t busCount, uint8_t hangBus, uint32_t seconds, ShardBench_Run_t *run)
+{
+    static ShardBench_Ctx_t ctx;
+    BusShard_t *shard = &ctx.shard;
+    uint64_t startNs, parallelNs;
+
+    memset(run, 0, sizeof(*run));
+    run->mode = (busCount == 1) ? "single" : (hangBus < busCount) ? "stuck" : "sharded";
+    run->busCount = busCount;
+    ShardBench_Setup(&ctx, busCount, run);
+
+    for (uint8_t b = 0; b < busCount; b++) {
+        HostSim_ClearStats(&ctx.hi2c[b]);
+    }
+    if (hangBus < busCount) {
+        HostSim_InjectFault(&ctx.hi2c[hangBus], HOSTSIM_FAULT_HANG, 1);
+    }
+    BusShard_Start(shard);
+    startNs = HostSim_NowNs();
+    parallelNs = ShardBench_Loop(&ctx, busCount, startNs + (uint64_t)seconds * 1000000000u);
+    run->runUs = (HostSim_NowNs() - startNs) / 1000u;
+    run->parallelPermille = (uint32_t)(parallelNs / run->runUs);
+
+    for (uint8_t i = 0; i < SHARD_BENCH_DEVICES; i++) {
+        const BusShard_Device_t *dev = &shard->devices[i];
+        ShardBench_Device_t *d = &run->devices[i];
+        d->bus = dev->bus;
+        d->periodUs = dev->config.periodUs;
+        d->loadPermille = dev->loadPpm / 1000u;
+        d->rateMilliHz = (uint32_t)((uint64_t)dev->stats.samples * 1000000000u / run->runUs);
+        d->misses = dev->stats.misses;
+        d->errors = dev->stats.errors;
+        d->meanLateUs = dev->stats.samples ? (uint32_t)(dev->stats.lateTotalUs / dev->stats.samples) : 0;
+        d->maxLateUs = dev->stats.maxLateUs;
+        d->maxLatencyUs = dev->stats.maxLatencyUs;
+    }
+    for (uint8_t b = 0; b < busCount; b++) {
+        ShardBench_Bus_t *bus = &run->buses[b];
+        bus->devices = shard->buses[b].devices;
+        bus->plannedPermille = shard->buses[b].plannedPpm / 1000u;
+        bus->countedPermille = BusShard_UtilizationPpm(shard, b) / 1000u;
+        bus->wirePermille = (uint32_t)(ctx.hi2c[b].stats.busyNs / run->runUs);
+    }
+}
+
+/**
+ * @brief Write the device rows, then the bus rows, as CSV with header lines
+ */
+void ShardBench_WriteCsv(FILE *out, const ShardBench_Run_t *runs, uint8_t count)
+{
+    fprintf(out, "mode,device,bus,period_us,load_permille,rate_mhz,misses,errors,mean_late_us,max_late_us,max_latency_us\n");
+    for (uint8_t r = 0; r < count; r++) {
+        for (uint8_t i = 0; i < SHARD_BENCH_DEVICES; i++) {
+            const ShardBench_Device_t *d = &runs[r].devices[i];
+            fprintf(out, "%s,%s,%d,%lu,%lu,%lu,%lu,%lu,%lu,%lu,%lu\n", runs[r].mode, d->device,
+                    d->bus == BUSSHARD_NO_BUS ? -1 : (int)d->bus, (unsigned long)d->periodUs,
+                    (unsigned long)d->loadPermille, (unsigned long)d->rateMilliHz, (unsigned long)d->misses,
+                    (unsigned long)d->errors, (unsigned long)d->meanLateUs, (unsigned long)d->maxLateUs,
+                    (unsigned long)d->maxLatencyUs);
+        }
+    }
+    fprintf(out, "\nmode,bus,devices,planned_permille,counted_permille,wire_permille,parallel_permille,placement\n");
+    for (uint8_t r = 0; r < count; r++) {
+        for (uint8_t b = 0; b < runs[r].busCount; b++) {
+            const ShardBench_Bus_t *bus = &runs[r].buses[b];
+            fprintf(out, "%s,%u,%u,%lu,%lu,%lu,%lu,%d\n", runs[r].mode, (unsigned)b, (unsigned)bus->devices,
+                    (unsigned long)bus->plannedPermille, (unsigned long)bus->countedPermille,
+                    (unsigned long)bus->wirePermille, (unsigned long)runs[r].parallelPermille, (int)runs[r].placement);
+        }
+    }
+}
+
+/**
+ * @brief Command line entry: [seconds]
+ * @return int 0, 1 if the sharded run missed samples, did not overlap the buses
+ *         or its counted load disagrees with the wire, or the stuck run did not
+ *         recover from the lost completion, 2 on usage errors
+ */
+int ShardBench_Main(int argc, char **argv)
+{
+    static ShardBench_Run_t runs[3];
+    uint32_t seconds = 2;
+    uint32_t hungErrors = 0;
+    int failed = 0;
+
+    if (argc > 2 || (argc == 2 && (seconds = (uint32_t)strtoul(argv[1], NULL, 10)) == 0)) {
+        fprintf(stderr, "usage: %s [seconds]\n", argv[0]);
+        return 2;
+    }
+    ShardBench_Run(1, BUSSHARD_NO_BUS, seconds, &runs[0]);
+    ShardBench_Run(SHARD_BENCH_BUSES, BUSSHARD_NO_BUS, seconds, &runs[1]);
+    ShardBench_Run(SHARD_BENCH_BUSES, SHARD_BENCH_HANG_BUS, seconds, &runs[2]);
+    ShardBench_WriteCsv(stdout, runs, 3);
+
+    const ShardBench_Run_t *sharded = &runs[1];
+    failed |= (sharded->placement != HAL_OK || sharded->parallelPermille == 0);
+    for (uint8_t i = 0; i < SHARD_BENCH_DEVICES; i++) {
+        failed |= (sharded->devices[i].misses != 0 || sharded->devices[i].errors != 0);
+    }
+    for (uint8_t b = 0; b < sharded->busCount; b++) {
+        const ShardBench_Bus_t *bus = &sharded->buses[b];
+        failed |= (abs((int)bus->countedPermille - (int)bus->wirePermille) > 2);
+    }
+
+    // One sample lost to the hung transfer, then back to at least 95 % of the rate
+    const ShardBench_Run_t *stuck = &runs[2];
+    for (uint8_t i = 0; i < SHARD_BENCH_DEVICES; i++) {
+        const ShardBench_Device_t *d = &stuck->devices[i];
+        if (d->bus == SHARD_BENCH_HANG_BUS) {
+            hungErrors += d->errors;
+            failed |= ((uint64_t)d->rateMilliHz * d->periodUs < 950000000u);
+        } else {
+            failed |= (d->misses != 0 || d->errors != 0);
+        }
+    }
+    failed |= (stuck->placement != HAL_OK || hungErrors != 1);
+    return failed;
+}
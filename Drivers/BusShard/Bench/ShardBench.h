@@ -0,0 +1,52 @@
+#ifndef SHARD_BENCH_H
+#define SHARD_BENCH_H
+#include "BusShardSensors.h"
+#include <stdio.h>
+
+/*------------------- Configuration ---------------------------*/
+#define SHARD_BENCH_BUSES 3
+#define SHARD_BENCH_DEVICES 7
+#define SHARD_BENCH_NAME_LEN 16
+#define SHARD_BENCH_HANG_BUS 1 // Bus whose first transfer loses its completion in the "stuck" run
+
+#if I2CBUS_MAX_BUSES < SHARD_BENCH_BUSES || BUSSHARD_MAX_BUSES < SHARD_BENCH_BUSES
+#error "ShardBench drives three buses, build it with -DI2CBUS_MAX_BUSES=3"
+#endif
+
+/************************ Bench Structs ********************************/
+typedef struct {
+    char device[SHARD_BENCH_NAME_LEN]; // Driver and 7-bit address
+    uint8_t bus;            // Placed on, BUSSHARD_NO_BUS if it did not fit
+    uint32_t periodUs;      // Requested sample period
+    uint32_t loadPermille;  // Planned share of its bus
+    uint32_t rateMilliHz;   // Achieved sample rate
+    uint32_t misses;
+    uint32_t errors;
+    uint32_t meanLateUs;    // Due time to the first submission
+    uint32_t maxLateUs;
+    uint32_t maxLatencyUs;  // Due time to the parsed result
+} ShardBench_Device_t;
+
+typedef struct {
+    uint8_t devices;
+    uint32_t plannedPermille; // Placement estimate
+    uint32_t countedPermille; // BusShard_UtilizationPpm(), from the finished transactions
+    uint32_t wirePermille;    // Simulated SCL busy time over the run
+} ShardBench_Bus_t;
+
+typedef struct {
+    const char *mode;       // "single", "sharded" or "stuck"
+    HAL_StatusTypeDef placement;
+    uint8_t busCount;
+    uint64_t runUs;
+    uint32_t parallelPermille; // Share of the run with transfers on two or more buses at once
+    ShardBench_Device_t devices[SHARD_BENCH_DEVICES];
+    ShardBench_Bus_t buses[SHARD_BENCH_BUSES];
+} ShardBench_Run_t;
+
+/*------------------- Function Prototypes ---------------------------*/
+void ShardBench_Run(uint8_t busCount, uint8_t hangBus, uint32_t seconds, ShardBench_Run_t *run);
+void ShardBench_WriteCsv(FILE *out, const ShardBench_Run_t *runs, uint8_t count);
+int ShardBench_Main(int argc, char **argv);
+
+#endif
@@ -0,0 +1,460 @@
+#include "BusShard.h"
+#include <string.h>
+
+/**
+ ******************************************************************************
+ * @file    BusShard.c
+ * @author  Yair Yamin
+ * @brief   Placement of I2C devices across several buses and their sampling.
+ * @details Every driver handle is bound to one I2C peripheral by hand, so on
+ * boards with three of them most sensors end up on the first and saturate it
+ * while the others idle. Here the devices are described with the sample
+ * rate they need and the buses they can be reached on, and the shard picks
+ * the bus of each one:
+ *
+ * - Cost: the SCL clocks of one sample are counted from the transactions
+ *   the device ops build (9 per byte, START, STOP, repeated START), so a
+ *   device's load is clocks / SCL frequency / period.
+ * - Placement: most constrained devices first, then the heaviest; each goes
+ *   to the bus it can reach that ends up least loaded, never next to a device
+ *   with the same address and never above maxUtilPpm. Devices that fit
+ *   nowhere are left unplaced and BusShard_Place() reports it.
+ * - Sampling: each device runs trigger, conversion wait, read as
+ *   transactions submitted to the bus manager of its bus, so all buses move
+ *   data at the same time from one BusShard_Poll() loop.
+ * - Utilization: planned per bus at placement, and counted from the finished
+ *   transactions while running.
+ ******************************************************************************
+ */
+
+/* ========================== Static Helpers ============================ */
+
+static void BusShard_TxnDone(const I2CBus_Txn_t *txn, HAL_StatusTypeDef status)
+{
+    BusShard_Device_t *dev = (BusShard_Device_t *)txn->ctx;
+
+    dev->status = status;
+    dev->doneUs = BUSSHARD_NOW_US();
+    dev->state++; // QUEUED to DONE
+}
+
+/**
+ * @brief SCL clocks of one sample, from the transactions the ops build
+ * @return uint32_t 0 if an op fails
+ */
+static uint32_t BusShard_SampleClocks(BusShard_Device_t *dev)
+{
+    const BusShard_Ops_t *ops = dev->config.ops;
+    I2CBus_Txn_t txn;
+    uint32_t clocks = 0;
+
+    if (ops->trigger != NULL) {
+        memset(&txn, 0, sizeof(txn));
+        if (ops->trigger(dev, &txn) != HAL_OK) {
+            return 0;
+        }
+        clocks += BusShard_TxnClocks(&txn);
+    }
+    memset(&txn, 0, sizeof(txn));
+    if (ops->read(dev, &txn) != HAL_OK) {
+        return 0;
+    }
+    return clocks + BusShard_TxnClocks(&txn);
+}
+
+static uint32_t BusShard_LoadPpm(const BusShard_Device_t *dev, uint32_t clockHz)
+{
+    uint64_t ppm = (uint64_t)dev->sampleClocks * 1000000000000ull / ((uint64_t)clockHz * dev->config.periodUs);
+
+    return (ppm > 0xFFFFFFFFu) ? 0xFFFFFFFFu : (uint32_t)ppm;
+}
+
+static uint8_t BusShard_Reachable(const BusShard_t *shard, const BusShard_Device_t *dev)
+{
+    uint8_t count = 0;
+
+    for (uint8_t b = 0; b < shard->busCount; b++) {
+        count += (dev->config.busMask == 0 || (dev->config.busMask & (1u << b)) != 0);
+    }
+    return count;
+}
+
+static uint8_t BusShard_AddressFree(const BusShard_t *shard, uint8_t bus, uint16_t devAddress)
+{
+    for (uint8_t i = 0; i < shard->deviceCount; i++) {
+        const BusShard_Device_t *other = &shard->devices[i];
+        if (other->bus == bus && (other->config.devAddress & 0xFE) == (devAddress & 0xFE)) {
+            return 0;
+        }
+    }
+    return 1;
+}
+
+/**
+ * @brief Order for placement: fewest reachable buses first, then the most SCL clocks per second
+ */
+static uint8_t BusShard_Before(const BusShard_t *shard, const BusShard_Device_t *a, const BusShard_Device_t *b)
+{
+    uint8_t reachA = BusShard_Reachable(shard, a);
+    uint8_t reachB = BusShard_Reachable(shard, b);
+
+    if (reachA != reachB) {
+        return reachA < reachB;
+    }
+    return (uint64_t)a->sampleClocks * b->config.periodUs > (uint64_t)b->sampleClocks * a->config.periodUs;
+}
+
+static HAL_StatusTypeDef BusShard_Submit(BusShard_Device_t *dev, uint8_t trigger)
+{
+    const BusShard_Ops_t *ops = dev->config.ops;
+    I2CBus_Txn_t txn;
+    HAL_StatusTypeDef status;
+
+    memset(&txn, 0, sizeof(txn));
+    status = trigger ? ops->trigger(dev, &txn) : ops->read(dev, &txn);
+    if (status != HAL_OK) {
+        return status;
+    }
+    txn.devAddress = dev->config.devAddress;
+    txn.done = BusShard_TxnDone;
+    txn.ctx = dev;
+    dev->txn = txn;
+    dev->state = trigger ? BUSSHARD_TRIGGER_QUEUED : BUSSHARD_READ_QUEUED;
+    status = I2CBus_Submit(&dev->client, &txn);
+    if (status != HAL_OK) {
+        dev->state = trigger ? BUSSHARD_IDLE : BUSSHARD_CONVERTING;
+    }
+    return status;
+}
+
+static void BusShard_Finish(BusShard_Device_t *dev, HAL_StatusTypeDef status, uint32_t now)
+{
+    if (status == HAL_OK) {
+        uint32_t latency = now - dev->releaseUs;
+        dev->stats.samples++;
+        if (latency > dev->stats.maxLatencyUs) {
+            dev->stats.maxLatencyUs = latency;
+        }
+    } else {
+        dev->stats.errors++;
+    }
+    dev->releaseUs += dev->config.periodUs;
+    dev->state = BUSSHARD_IDLE;
+    if (status == HAL_OK && dev->config.onSample != NULL) {
+        dev->config.onSample(dev);
+    }
+}
+
+/**
+ * @brief Account a finished transaction and run the done op on it
+ */
+static HAL_StatusTypeDef BusShard_Collect(BusShard_t *shard, BusShard_Device_t *dev)
+{
+    BusShard_Bus_t *bus = &shard->buses[dev->bus];
+
+    bus->clocks += BusShard_TxnClocks(&dev->txn);
+    bus->transactions++;
+    if (dev->status != HAL_OK || dev->config.ops->done == NULL) {
+        return dev->status;
+    }
+    return dev->config.ops->done(dev, &dev->txn);
+}
+
+ /* ========================== Function Definitions ============================ */
+
+/**
+ * @brief Clear the shard
+ * @param shard Shard state
+ */
+void BusShard_Init(BusShard_t *shard)
+{
+    memset(shard, 0, sizeof(*shard));
+    shard->maxUtilPpm = BUSSHARD_MAX_UTIL_PPM;
+}
+
+/**
+ * @brief Add a bus and start its bus manager
+ * @param shard Shard state
+ * @param hi2c Initialized I2C peripheral
+ * @param clockHz Its SCL frequency, for the load estimates
+ * @param id Receives the bus id for BusShard_Config_t.busMask, may be NULL
+ * @return HAL_StatusTypeDef HAL_OK, HAL_ERROR if the table or the bus manager registry is full
+ */
+HAL_StatusTypeDef BusShard_AddBus(BusShard_t *shard, I2C_HandleTypeDef *hi2c, uint32_t clockHz, uint8_t *id)
+{
+    if (shard->busCount >= BUSSHARD_MAX_BUSES || clockHz == 0) {
+        return HAL_ERROR;
+    }
+    BusShard_Bus_t *bus = &shard->buses[shard->busCount];
+    memset(bus, 0, sizeof(*bus));
+    if (I2CBus_Init(&bus->bus, hi2c) != HAL_OK) {
+        return HAL_ERROR;
+    }
+    bus->clockHz = clockHz;
+    if (id != NULL) {
+        *id = shard->busCount;
+    }
+    shard->busCount++;
+    return HAL_OK;
+}
+
+/**
+ * @brief Add a device, e.g. from BusShard_ADS1115Config()
+ * @param shard Shard state
+ * @param config Copied
+ * @param id Receives the index in shard->devices, may be NULL
+ * @return HAL_StatusTypeDef HAL_OK, HAL_ERROR if the table is full or the config is incomplete
+ */
+HAL_StatusTypeDef BusShard_AddDevice(BusShard_t *shard, const BusShard_Config_t *config, uint8_t *id)
+{
+    if (shard->deviceCount >= BUSSHARD_MAX_DEVICES || config->ops == NULL || config->ops->read == NULL ||
+        config->periodUs == 0) {
+        return HAL_ERROR;
+    }
+    BusShard_Device_t *dev = &shard->devices[shard->deviceCount];
+    memset(dev, 0, sizeof(*dev));
+    dev->config = *config;
+    dev->bus = BUSSHARD_NO_BUS;
+    if (id != NULL) {
+        *id = shard->deviceCount;
+    }
+    shard->deviceCount++;
+    return HAL_OK;
+}
+
+/**
+ * @brief Assign every device to a bus and bind its driver handle there
+ * @param shard Shard state with its buses and devices added
+ * @return HAL_StatusTypeDef HAL_OK, HAL_ERROR if a device fit on no bus; it
+ *         keeps bus BUSSHARD_NO_BUS and is not sampled, the others are placed
+ * @details Call before the driver Init() functions, the handles then talk to
+ *          the bus they were placed on. Placing again starts over.
+ */
+HAL_StatusTypeDef BusShard_Place(BusShard_t *shard)
+{
+    uint8_t order[BUSSHARD_MAX_DEVICES];
+    HAL_StatusTypeDef result = HAL_OK;
+
+    for (uint8_t b = 0; b < shard->busCount; b++) {
+        shard->buses[b].plannedPpm = 0;
+        shard->buses[b].devices = 0;
+    }
+    for (uint8_t i = 0; i < shard->deviceCount; i++) {
+        BusShard_Device_t *dev = &shard->devices[i];
+        dev->bus = BUSSHARD_NO_BUS;
+        dev->loadPpm = 0;
+        dev->sampleClocks = BusShard_SampleClocks(dev);
+        // Insertion sort, the table is small
+        uint8_t k = i;
+        while (k > 0 && BusShard_Before(shard, dev, &shard->devices[order[k - 1]])) {
+            order[k] = order[k - 1];
+            k--;
+        }
+        order[k] = i;
+    }
+
+    for (uint8_t i = 0; i < shard->deviceCount; i++) {
+        BusShard_Device_t *dev = &shard->devices[order[i]];
+        uint8_t best = BUSSHARD_NO_BUS;
+        uint64_t bestPpm = 0;
+
+        for (uint8_t b = 0; b < shard->busCount && dev->sampleClocks != 0; b++) {
+            const BusShard_Bus_t *bus = &shard->buses[b];
+            if (dev->config.busMask != 0 && (dev->config.busMask & (1u << b)) == 0) {
+                continue;
+            }
+            if (!BusShard_AddressFree(shard, b, dev->config.devAddress)) {
+                continue;
+            }
+            uint64_t ppm = (uint64_t)bus->plannedPpm + BusShard_LoadPpm(dev, bus->clockHz);
+            if (ppm <= shard->maxUtilPpm && (best == BUSSHARD_NO_BUS || ppm < bestPpm)) {
+                best = b;
+                bestPpm = ppm;
+            }
+        }
+        if (best == BUSSHARD_NO_BUS) {
+            result = HAL_ERROR;
+            continue;
+        }
+        BusShard_Bus_t *bus = &shard->buses[best];
+        dev->bus = best;
+        dev->loadPpm = BusShard_LoadPpm(dev, bus->clockHz);
+        bus->plannedPpm = (uint32_t)bestPpm;
+        bus->devices++;
+        if (I2CBus_ClientInit(&dev->client, &bus->bus, dev->config.name, (I2CBus_Priority_t)dev->config.priority) != HAL_OK) {
+            return HAL_ERROR;
+        }
+        if (dev->config.ops->bind != NULL) {
+            dev->config.ops->bind(dev, bus->bus.hi2c, &dev->client);
+        }
+    }
+    return result;
+}
+
+/**
+ * @brief Start sampling, every placed device is due with the next BusShard_Poll()
+ * @param shard Placed shard
+ */
+void BusShard_Start(BusShard_t *shard)
+{
+    shard->startUs = BUSSHARD_NOW_US();
+    shard->lastUs = shard->startUs;
+    shard->elapsedUs = 0;
+    for (uint8_t b = 0; b < shard->busCount; b++) {
+        shard->buses[b].clocks = 0;
+        shard->buses[b].transactions = 0;
+    }
+    for (uint8_t i = 0; i < shard->deviceCount; i++) {
+        BusShard_Device_t *dev = &shard->devices[i];
+        memset(&dev->stats, 0, sizeof(dev->stats));
+        if (dev->config.ops->convUs != NULL) {
+            dev->config.convUs = dev->config.ops->convUs(dev);
+        }
+        dev->state = BUSSHARD_IDLE;
+        dev->releaseUs = shard->startUs;
+    }
+}
+
+/**
+ * @brief Collect finished transactions and submit the due ones
+ * @param shard Started shard
+ * @return uint32_t 0 if anything happened, otherwise microseconds until the next
+ *         sample or conversion is due, or the bus watchdog of an outstanding
+ *         transfer can fire (0xFFFFFFFF if nothing is placed)
+ * @details Call from the main loop; transactions on different buses run in
+ *          parallel between calls. Runs the watchdog of each bus first, so a
+ *          transfer whose completion interrupt was lost is aborted and its
+ *          sample counted as an error instead of holding the bus.
+ */
+uint32_t BusShard_Poll(BusShard_t *shard)
+{
+    uint32_t now = BUSSHARD_NOW_US();
+    uint32_t sleep = 0xFFFFFFFFu;
+    uint8_t changed = 0;
+
+    for (uint8_t b = 0; b < shard->busCount; b++) {
+        I2CBus_Poll(&shard->buses[b].bus);
+        if (shard->buses[b].bus.busy) {
+            uint32_t watchdogUs = (shard->buses[b].bus.txnTimeout + 1u) * BUSSHARD_TICK_US;
+            if (watchdogUs < sleep) {
+                sleep = watchdogUs;
+            }
+        }
+    }
+    shard->elapsedUs += (uint32_t)(now - shard->lastUs);
+    shard->lastUs = now;
+
+    for (uint8_t i = 0; i < shard->deviceCount; i++) {
+        BusShard_Device_t *dev = &shard->devices[i];
+        HAL_StatusTypeDef status;
+
+        if (dev->bus == BUSSHARD_NO_BUS) {
+            continue;
+        }
+        if (dev->state == BUSSHARD_TRIGGER_DONE) {
+            status = BusShard_Collect(shard, dev);
+            if (status == HAL_OK) {
+                dev->waitUs = dev->doneUs + dev->config.convUs;
+                dev->state = BUSSHARD_CONVERTING;
+            } else {
+                BusShard_Finish(dev, status, now);
+            }
+            changed = 1;
+        } else if (dev->state == BUSSHARD_READ_DONE) {
+            BusShard_Finish(dev, BusShard_Collect(shard, dev), now);
+            changed = 1;
+        }
+
+        if (dev->state == BUSSHARD_IDLE) {
+            int32_t until = (int32_t)(dev->releaseUs - now);
+            if (until > 0) {
+                if ((uint32_t)until < sleep) {
+                    sleep = (uint32_t)until;
+                }
+                continue;
+            }
+            uint32_t late = now - dev->releaseUs;
+            if (late >= dev->config.periodUs) {
+                uint32_t skipped = late / dev->config.periodUs;
+                dev->stats.misses += skipped;
+                dev->releaseUs += skipped * dev->config.periodUs;
+                late -= skipped * dev->config.periodUs;
+            }
+            status = BusShard_Submit(dev, dev->config.ops->trigger != NULL);
+            if (status == HAL_BUSY) {
+                continue; // Queue full, retried after the next completion
+            }
+            if (status != HAL_OK) {
+                BusShard_Finish(dev, status, now);
+            } else {
+                dev->stats.lateTotalUs += late;
+                if (late > dev->stats.maxLateUs) {
+                    dev->stats.maxLateUs = late;
+                }
+            }
+            changed = 1;
+        } else if (dev->state == BUSSHARD_CONVERTING) {
+            int32_t until = (int32_t)(dev->waitUs - now);
+            if (until > 0) {
+                if ((uint32_t)until < sleep) {
+                    sleep = (uint32_t)until;
+                }
+                continue;
+            }
+            status = BusShard_Submit(dev, 0);
+            if (status == HAL_BUSY) {
+                continue;
+            }
+            if (status != HAL_OK) {
+                BusShard_Finish(dev, status, now);
+            }
+            changed = 1;
+        }
+    }
+    return changed ? 0 : sleep;
+}
+
+/**
+ * @brief SCL clocks of a transaction on the wire
+ * @param txn Transaction, only op and size are used
+ * @return uint32_t 9 per byte (address, register and data bytes) plus START,
+ *         STOP and the repeated START of a register read
+ * @details Clock stretching and the gaps between transactions are not counted.
+ */
+uint32_t BusShard_TxnClocks(const I2CBus_Txn_t *txn)
+{
+    switch (txn->op) {
+    case I2CBUS_MEM_READ:
+        return 9u * (3u + txn->size) + 3u;
+    case I2CBUS_MEM_WRITE:
+        return 9u * (2u + txn->size) + 2u;
+    default:
+        return 9u * (1u + txn->size) + 2u;
+    }
+}
+
+/**
+ * @brief Share of time a bus spent on the wire since BusShard_Start()
+ * @param shard Started shard
+ * @param bus Bus id
+ * @return uint32_t Parts per million, from the finished transactions
+ * @details The window is the whole run since BusShard_Start(), kept in 64 bits,
+ *          so it does not wrap with BUSSHARD_NOW_US() as long as BusShard_Poll()
+ *          runs at least once per wrap of that clock (71 min for a 32-bit
+ *          microsecond count). Call BusShard_Start() again for a fresh window.
+ */
+uint32_t BusShard_UtilizationPpm(const BusShard_t *shard, uint8_t bus)
+{
+    uint64_t elapsedUs = shard->elapsedUs + (uint32_t)(BUSSHARD_NOW_US() - shard->lastUs);
+
+    if (bus >= shard->busCount || elapsedUs == 0) {
+        return 0;
+    }
+    const BusShard_Bus_t *b = &shard->buses[bus];
+    uint64_t busyUs = b->clocks * 1000000u / b->clockHz;
+    while (busyUs > UINT64_MAX / 1000000u) {
+        busyUs >>= 1; // Over 200 days on the wire: keep the ratio, drop precision
+        elapsedUs >>= 1;
+    }
+    return (uint32_t)(busyUs * 1000000u / elapsedUs);
+}
@@ -0,0 +1,130 @@
+#ifndef BUS_SHARD_H
+#define BUS_SHARD_H
+#include "main.h"
+#include "I2CBus.h"
+#include "DmaCache.h"
+
+/*------------------- Configuration ---------------------------*/
+#ifndef BUSSHARD_MAX_BUSES
+#define BUSSHARD_MAX_BUSES I2CBUS_MAX_BUSES // Raise I2CBUS_MAX_BUSES too, it routes the completions
+#endif
+#ifndef BUSSHARD_MAX_DEVICES
+#define BUSSHARD_MAX_DEVICES 12
+#endif
+#ifndef BUSSHARD_MAX_UTIL_PPM
+#define BUSSHARD_MAX_UTIL_PPM 700000 // Planned wire time a bus may take, the rest absorbs queueing and retries
+#endif
+#ifndef BUSSHARD_BUF_LEN
+#define BUSSHARD_BUF_LEN 8 // Largest transfer of one sample step, the BME280 burst
+#endif
+
+#ifndef BUSSHARD_TICK_US
+#define BUSSHARD_TICK_US 1000 // Length of an I2CBUS_NOW() tick, to wake up for the bus watchdog
+#endif
+
+// Microsecond clock, may wrap
+#ifndef BUSSHARD_NOW_US
+#ifdef HOSTSIM_H
+#define BUSSHARD_NOW_US() ((uint32_t)(HostSim_NowNs() / 1000u))
+#else
+#define BUSSHARD_NOW_US() (HAL_GetTick() * 1000u)
+#endif
+#endif
+
+#define BUSSHARD_NO_BUS 0xFF
+
+/************************ Bus Shard Structs ********************************/
+typedef struct BusShard_Device_s BusShard_Device_t;
+
+// How one kind of device takes a sample. trigger and read fill op, memAddress,
+// data (dev->buf) and size of a transaction; the shard sets the rest.
+typedef struct {
+    HAL_StatusTypeDef (*trigger)(BusShard_Device_t *dev, I2CBus_Txn_t *txn); // NULL if the read alone is a sample
+    HAL_StatusTypeDef (*read)(BusShard_Device_t *dev, I2CBus_Txn_t *txn);
+    // After each successful transaction, from BusShard_Poll(): update the driver handle
+    HAL_StatusTypeDef (*done)(BusShard_Device_t *dev, const I2CBus_Txn_t *txn);
+    // Trigger to result at the handle's settings, taken at BusShard_Start(); NULL keeps config.convUs
+    uint32_t (*convUs)(const BusShard_Device_t *dev);
+    // Point the driver handle at the bus it was placed on
+    void (*bind)(BusShard_Device_t *dev, I2C_HandleTypeDef *hi2c, I2CBus_Client_t *client);
+} BusShard_Ops_t;
+
+typedef struct {
+    const BusShard_Ops_t *ops;
+    void *dev;                 // Driver handle
+    const char *name;          // Client name, for reports
+    uint16_t devAddress;       // 8-bit HAL address, unique among the devices of a bus
+    uint8_t arg;               // For the ops, e.g. the ADS1115 input
+    uint8_t busMask;           // Bit per bus id the device can be reached on, 0 for any
+    uint8_t priority;          // I2CBus_Priority_t of its client
+    uint32_t periodUs;         // Required sample period
+    uint32_t convUs;           // Trigger to result, unused without a trigger
+    void (*onSample)(BusShard_Device_t *dev); // From BusShard_Poll() after each sample, may be NULL
+    void *ctx;                 // For onSample
+} BusShard_Config_t;
+
+typedef struct {
+    uint32_t samples;
+    uint32_t misses;           // Periods skipped because the previous sample was still running
+    uint32_t errors;           // Samples lost to a failed transaction
+    uint32_t maxLateUs;        // Due time to the first submission
+    uint64_t lateTotalUs;
+    uint32_t maxLatencyUs;     // Due time to the parsed result
+} BusShard_Stats_t;
+
+typedef enum {
+    BUSSHARD_IDLE = 0,         // Waiting for the next period
+    BUSSHARD_TRIGGER_QUEUED = 1,
+    BUSSHARD_TRIGGER_DONE = 2, // Set by the completion interrupt
+    BUSSHARD_CONVERTING = 3,
+    BUSSHARD_READ_QUEUED = 4,
+    BUSSHARD_READ_DONE = 5     // Set by the completion interrupt
+} BusShard_State_t;
+
+struct BusShard_Device_s {
+    BusShard_Config_t config;
+    I2CBus_Client_t client;    // On the bus it was placed on
+    DMACACHE_REGION(bufLines, uint8_t buf[BUSSHARD_BUF_LEN]); // Data of the transaction in flight
+    I2CBus_Txn_t txn;          // Last submitted, for the done op
+    uint8_t bus;               // Bus id, BUSSHARD_NO_BUS before placement or if it did not fit
+    volatile uint8_t state;    // BusShard_State_t
+    volatile HAL_StatusTypeDef status;
+    volatile uint32_t doneUs;
+    uint32_t sampleClocks;     // SCL clocks of one sample, from its transactions
+    uint32_t loadPpm;          // Planned share of its bus
+    uint32_t releaseUs;        // Due time of the next sample
+    uint32_t waitUs;           // End of the conversion
+    BusShard_Stats_t stats;
+};
+
+typedef struct {
+    I2CBus_t bus;
+    uint32_t clockHz;          // SCL frequency the peripheral is set to
+    uint32_t plannedPpm;       // Sum of the loads placed on it
+    uint64_t clocks;           // SCL clocks of the transactions finished since BusShard_Start()
+    uint32_t transactions;
+    uint8_t devices;
+} BusShard_Bus_t;
+
+typedef struct {
+    BusShard_Bus_t buses[BUSSHARD_MAX_BUSES];
+    BusShard_Device_t devices[BUSSHARD_MAX_DEVICES];
+    uint8_t busCount;
+    uint8_t deviceCount;
+    uint32_t maxUtilPpm;       // Placement limit per bus, BUSSHARD_MAX_UTIL_PPM after BusShard_Init()
+    uint32_t startUs;
+    uint32_t lastUs;           // BUSSHARD_NOW_US() at the last BusShard_Poll()
+    uint64_t elapsedUs;        // Since BusShard_Start() up to lastUs, does not wrap
+} BusShard_t;
+
+/*------------------- Function Prototypes ---------------------------*/
+void BusShard_Init(BusShard_t *shard);
+HAL_StatusTypeDef BusShard_AddBus(BusShard_t *shard, I2C_HandleTypeDef *hi2c, uint32_t clockHz, uint8_t *id);
+HAL_StatusTypeDef BusShard_AddDevice(BusShard_t *shard, const BusShard_Config_t *config, uint8_t *id);
+HAL_StatusTypeDef BusShard_Place(BusShard_t *shard);
+void BusShard_Start(BusShard_t *shard);
+uint32_t BusShard_Poll(BusShard_t *shard);
+uint32_t BusShard_TxnClocks(const I2CBus_Txn_t *txn);
+uint32_t BusShard_UtilizationPpm(const BusShard_t *shard, uint8_t bus);
+
+#endif
@@ -0,0 +1,223 @@
+#include "BusShardSensors.h"
+#include <string.h>
+
+/**
+ ******************************************************************************
+ * @file    BusShardSensors.c
+ * @author  Yair Yamin
+ * @brief   BusShard devices for the ADS1115, BME280 and DS3231 drivers.
+ * @details Each sample is the transactions the driver calls would make,
+ * built asynchronously from the handle's register mirror:
+ *
+ * - ADS1115: single-shot start on the configured input (one config write),
+ *   then the conversion register after ADS1115_ConversionTimeUs().
+ * - BME280: ctrl_meas write in forced mode, then the measurement burst
+ *   after BME280_MeasureTimeUs(), compensated into the handle.
+ * - DS3231: time and date read, no trigger.
+ *
+ * The results land in the handles as after the blocking calls. The handles
+ * are bound to their bus by BusShard_Place(), so configure the devices after
+ * it (ADS1115_Init(), BME280_Init(), BME280_SetOSVals() in sleep mode); the
+ * conversion times are taken from the handles at BusShard_Start().
+ ******************************************************************************
+ */
+
+/* ========================== Static Helpers ============================ */
+
+static HAL_StatusTypeDef BusShard_ADS1115Trigger(BusShard_Device_t *dev, I2CBus_Txn_t *txn)
+{
+    const ADS1115_Handle_t *hads1115 = (const ADS1115_Handle_t *)dev->config.dev;
+    const uint8_t *value = hads1115->Reg[ADS1115_REG_CONFIG].value;
+    uint16_t config = (uint16_t)((value[0] << 8) | value[1]);
+
+    // As ADS1115_StartConversion(): input, single-shot, start
+    config = (uint16_t)((config & ~0x7000u) | ((uint16_t)dev->config.arg << 12) | ADS1115_OS_MASK |
+                        ADS1115_MODE_SINGLESHOT_MASK);
+    dev->buf[0] = (uint8_t)(config >> 8);
+    dev->buf[1] = (uint8_t)config;
+    txn->op = I2CBUS_MEM_WRITE;
+    txn->memAddress = ADS1115_REG_CONFIG;
+    txn->data = dev->buf;
+    txn->size = 2;
+    return HAL_OK;
+}
+
+static HAL_StatusTypeDef BusShard_ADS1115Read(BusShard_Device_t *dev, I2CBus_Txn_t *txn)
+{
+    txn->op = I2CBUS_MEM_READ;
+    txn->memAddress = ADS1115_REG_CONVERSION;
+    txn->data = dev->buf;
+    txn->size = 2;
+    return HAL_OK;
+}
+
+static HAL_StatusTypeDef BusShard_ADS1115Done(BusShard_Device_t *dev, const I2CBus_Txn_t *txn)
+{
+    ADS1115_Handle_t *hads1115 = (ADS1115_Handle_t *)dev->config.dev;
+
+    ADS1115_LoadRegs(hads1115, txn->memAddress, dev->buf, 1);
+    if (txn->memAddress == ADS1115_REG_CONFIG) {
+        hads1115->channel = (sChannel_t)dev->config.arg;
+    }
+    return HAL_OK;
+}
+
+static uint32_t BusShard_ADS1115ConvUs(const BusShard_Device_t *dev)
+{
+    return ADS1115_ConversionTimeUs((const ADS1115_Handle_t *)dev->config.dev);
+}
+
+static void BusShard_ADS1115Bind(BusShard_Device_t *dev, I2C_HandleTypeDef *hi2c, I2CBus_Client_t *client)
+{
+    ADS1115_Handle_t *hads1115 = (ADS1115_Handle_t *)dev->config.dev;
+
+    hads1115->i2c_handle = hi2c;
+    hads1115->bus_client = client;
+}
+
+static HAL_StatusTypeDef BusShard_BME280Trigger(BusShard_Device_t *dev, I2CBus_Txn_t *txn)
+{
+    const BME280_Handle_t *hbme280 = (const BME280_Handle_t *)dev->config.dev;
+
+    dev->buf[0] = (uint8_t)((hbme280->Reg.ctrl_meas_reg & ~0x03u) | BME280_MODE_FORCED);
+    txn->op = I2CBUS_MEM_WRITE;
+    txn->memAddress = BME280_CTRL_MEAS_REG;
+    txn->data = dev->buf;
+    txn->size = 1;
+    return HAL_OK;
+}
+
+static HAL_StatusTypeDef BusShard_BME280Read(BusShard_Device_t *dev, I2CBus_Txn_t *txn)
+{
+    const BME280_Handle_t *hbme280 = (const BME280_Handle_t *)dev->config.dev;
+
+    if (hbme280->transport != NULL) {
+        return HAL_ERROR; // On SPI, nothing to place
+    }
+    txn->op = I2CBUS_MEM_READ;
+    txn->memAddress = BME280_PRESS_MSB_REG;
+    txn->data = dev->buf;
+    txn->size = BME280_BURST_LEN;
+    return HAL_OK;
+}
+
+static HAL_StatusTypeDef BusShard_BME280Done(BusShard_Device_t *dev, const I2CBus_Txn_t *txn)
+{
+    BME280_Handle_t *hbme280 = (BME280_Handle_t *)dev->config.dev;
+
+    if (txn->memAddress == BME280_CTRL_MEAS_REG) {
+        hbme280->Reg.ctrl_meas_reg = dev->buf[0];
+    } else {
+        BME280_ParseMeasurement(hbme280, dev->buf);
+    }
+    return HAL_OK;
+}
+
+static uint32_t BusShard_BME280ConvUs(const BusShard_Device_t *dev)
+{
+    return BME280_MeasureTimeUs((const BME280_Handle_t *)dev->config.dev);
+}
+
+static void BusShard_BME280Bind(BusShard_Device_t *dev, I2C_HandleTypeDef *hi2c, I2CBus_Client_t *client)
+{
+    BME280_Handle_t *hbme280 = (BME280_Handle_t *)dev->config.dev;
+
+    hbme280->i2c_handle = hi2c;
+    hbme280->bus_client = client;
+}
+
+static HAL_StatusTypeDef BusShard_DS3231Read(BusShard_Device_t *dev, I2CBus_Txn_t *txn)
+{
+    txn->op = I2CBUS_MEM_READ;
+    txn->memAddress = DS3231_REG_SECONDS;
+    txn->data = dev->buf;
+    txn->size = DS3231_REG_YEAR + 1;
+    return HAL_OK;
+}
+
+static HAL_StatusTypeDef BusShard_DS3231Done(BusShard_Device_t *dev, const I2CBus_Txn_t *txn)
+{
+    DS3231_Handle_t *hrtc = (DS3231_Handle_t *)dev->config.dev;
+
+    DS3231_LoadRegs(hrtc, DS3231_REG_SECONDS, dev->buf, (uint8_t)txn->size);
+    hrtc->dayOfWeek = (ds3231_dow_t)(hrtc->Reg[DS3231_REG_DAY] & 0x07);
+    VALID(DS3231_DecodeTime(&hrtc->Reg[DS3231_REG_SECONDS], &hrtc->time));
+    return DS3231_DecodeDate(&hrtc->Reg[DS3231_REG_DATE], &hrtc->date);
+}
+
+static void BusShard_DS3231Bind(BusShard_Device_t *dev, I2C_HandleTypeDef *hi2c, I2CBus_Client_t *client)
+{
+    DS3231_Handle_t *hrtc = (DS3231_Handle_t *)dev->config.dev;
+
+    hrtc->i2c_handle = hi2c;
+    hrtc->bus_client = client;
+}
+
+static const BusShard_Ops_t ads1115Ops = {
+    BusShard_ADS1115Trigger, BusShard_ADS1115Read, BusShard_ADS1115Done, BusShard_ADS1115ConvUs, BusShard_ADS1115Bind
+};
+
+static const BusShard_Ops_t bme280Ops = {
+    BusShard_BME280Trigger, BusShard_BME280Read, BusShard_BME280Done, BusShard_BME280ConvUs, BusShard_BME280Bind
+};
+
+static const BusShard_Ops_t ds3231Ops = {
+    NULL, BusShard_DS3231Read, BusShard_DS3231Done, NULL, BusShard_DS3231Bind
+};
+
+ /* ========================== Function Definitions ============================ */
+
+/**
+ * @brief Device sampling one ADS1115 input in single-shot mode
+ * @param config Filled in
+ * @param hads1115 Driver handle with I2C_address set; its data rate at BusShard_Start() sets the conversion time
+ * @param input Input to sample
+ * @param periodUs Sample period
+ * @details Set busMask, priority and onSample before BusShard_AddDevice().
+ */
+void BusShard_ADS1115Config(BusShard_Config_t *config, ADS1115_Handle_t *hads1115, sChannel_t input, uint32_t periodUs)
+{
+    memset(config, 0, sizeof(*config));
+    config->ops = &ads1115Ops;
+    config->dev = hads1115;
+    config->name = "ads1115";
+    config->devAddress = hads1115->I2C_address;
+    config->arg = (uint8_t)input;
+    config->priority = I2CBUS_PRIO_NORMAL;
+    config->periodUs = periodUs;
+}
+
+/**
+ * @brief Device taking BME280 forced-mode measurements
+ * @param config Filled in
+ * @param hbme280 Driver handle with I2C_address set; its oversampling at BusShard_Start() sets the measurement time
+ * @param periodUs Sample period
+ * @details The handle needs its calibration (BME280_Init()) before the first sample.
+ */
+void BusShard_BME280Config(BusShard_Config_t *config, BME280_Handle_t *hbme280, uint32_t periodUs)
+{
+    memset(config, 0, sizeof(*config));
+    config->ops = &bme280Ops;
+    config->dev = hbme280;
+    config->name = "bme280";
+    config->devAddress = hbme280->I2C_address;
+    config->priority = I2CBUS_PRIO_NORMAL;
+    config->periodUs = periodUs;
+}
+
+/**
+ * @brief Device reading the DS3231 time, day and date
+ * @param config Filled in
+ * @param hrtc Driver handle with I2C_address set
+ * @param periodUs Sample period
+ */
+void BusShard_DS3231Config(BusShard_Config_t *config, DS3231_Handle_t *hrtc, uint32_t periodUs)
+{
+    memset(config, 0, sizeof(*config));
+    config->ops = &ds3231Ops;
+    config->dev = hrtc;
+    config->name = "ds3231";
+    config->devAddress = hrtc->I2C_address;
+    config->priority = I2CBUS_PRIO_LOW;
+    config->periodUs = periodUs;
+}
@@ -0,0 +1,19 @@
+#ifndef BUS_SHARD_SENSORS_H
+#define BUS_SHARD_SENSORS_H
+#include "BusShard.h"
+#include "ADS1115.h"
+#include "BME280.h"
+#include "DS3231.h"
+
+/*------------------- Configuration ---------------------------*/
+// Placement binds the handles' bus_client
+#ifndef USE_I2CBUS
+#error "BusShardSensors needs USE_I2CBUS"
+#endif
+
+/*------------------- Function Prototypes ---------------------------*/
+void BusShard_ADS1115Config(BusShard_Config_t *config, ADS1115_Handle_t *hads1115, sChannel_t input, uint32_t periodUs);
+void BusShard_BME280Config(BusShard_Config_t *config, BME280_Handle_t *hbme280, uint32_t periodUs);
+void BusShard_DS3231Config(BusShard_Config_t *config, DS3231_Handle_t *hrtc, uint32_t periodUs);
+
+#endif
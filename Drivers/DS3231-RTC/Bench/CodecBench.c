@@ -0,0 +1,451 @@
+#define _POSIX_C_SOURCE 200809L // clock_gettime
+#include "CodecBench.h"
+#include <string.h>
+#include <time.h>
+
+/**
+ ******************************************************************************
+ * @file    CodecBench.c
+ * @author  Yair Yamin
+ * @brief   Exhaustive check and cost of the DS3231 BCD codec.
+ * @details The reference is what the driver did before the codec: the
+ * decToBCD()/BCDToDec() macros, the per-mode alarm mask bits of
+ * SetAlarm1/SetAlarm2, and the datasheet ranges for validity.
+ *
+ * - time_24h, time_12h: every legal time, encoded (24-hour) and decoded;
+ *   12-hour images as other firmware may leave them, AM and PM.
+ * - date: every date, month and year with and without the century bit.
+ * - alarm1, alarm2: every time and every date and day in every mode.
+ * - reg_*: every byte of each register with the others legal; the decoder
+ *   must accept exactly the legal ones and leave its output alone otherwise.
+ * - speed: host CPU time to decode and encode a time image, codec against
+ *   the macros without validation.
+ ******************************************************************************
+ */
+
+/* ========================== Defines ============================ */
+#define CODEC_BENCH_TIME_VALUES (24u * 60u * 60u)
+
+/* ========================== Global Variables ============================ */
+static volatile uint32_t sink;
+
+// A1Mx/A2Mx bit per register for each mode, in register order, as SetAlarm1/SetAlarm2 wrote them
+static const uint8_t referenceMasks[6][4] = {
+    [EveryMinute] = {0x00, 0x80, 0x80, 0x80},
+    [EveryHour]   = {0x00, 0x00, 0x80, 0x80},
+    [EveryDay]    = {0x00, 0x00, 0x00, 0x80},
+    [Once]        = {0x00, 0x00, 0x00, 0x00},
+    [EveryWeek]   = {0x00, 0x00, 0x00, 0x00},
+};
+
+/* ========================== Static Helpers ============================ */
+
+static uint64_t CodecBench_CpuNs(void)
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_PROCESS_CPUTIME_ID, &ts);
+    return (uint64_t)ts.tv_sec * 1000000000u + (uint64_t)ts.tv_nsec;
+}
+
+// Time decode as the driver did it before the codec, out of line like DS3231_DecodeTime()
+__attribute__((noinline)) static HAL_StatusTypeDef CodecBench_MacroDecodeTime(const uint8_t *regs, ds3231_time_t *time)
+{
+    time->seconds = BCDToDec(regs[0]);
+    time->minutes = BCDToDec(regs[1]);
+    time->hours = BCDToDec(regs[2]);
+    return HAL_OK;
+}
+
+// Time encode as the driver did it before the codec, without the range check
+__attribute__((noinline)) static HAL_StatusTypeDef CodecBench_MacroEncodeTime(const ds3231_time_t *time, uint8_t *regs)
+{
+    regs[0] = decToBCD(time->seconds);
+    regs[1] = decToBCD(time->minutes);
+    regs[2] = decToBCD(time->hours);
+    return HAL_OK;
+}
+
+static CodecBench_Result_t *CodecBench_Add(CodecBench_Result_t *results, uint16_t *count, uint16_t max,
+                                           const char *name, const char *variant)
+{
+    CodecBench_Result_t *r;
+
+    if (*count >= max) {
+        return NULL;
+    }
+    r = &results[(*count)++];
+    memset(r, 0, sizeof(*r));
+    r->name = name;
+    r->variant = variant;
+    return r;
+}
+
+// Reference decode of one register: 1 and the value if the byte is legal there
+static int CodecBench_Legal(uint8_t reg, uint8_t byte, uint8_t *value)
+{
+    uint8_t v;
+
+    switch (reg) {
+    case DS3231_REG_SECONDS:
+    case DS3231_REG_MINUTES:
+        v = byte & 0x7F;
+        break;
+    case DS3231_REG_HOURS:
+        if (byte & HOURS_12H_MASK) {
+            v = byte & 0x1F;
+            if ((v & 0x0F) > 9 || BCDToDec(v) < 1 || BCDToDec(v) > 12) {
+                return 0;
+            }
+            *value = (uint8_t)(BCDToDec(v) % 12 + ((byte & HOURS_PM_MASK) ? 12 : 0));
+            return 1;
+        }
+        v = byte & 0x3F;
+        break;
+    case DS3231_REG_DATE:
+        v = byte & 0x3F;
+        break;
+    case DS3231_REG_MONTH:
+        v = byte & 0x1F; // Century bit ignored
+        break;
+    default:
+        v = byte;
+        break;
+    }
+    if ((v >> 4) > 9 || (v & 0x0F) > 9) {
+        return 0;
+    }
+    *value = (uint8_t)BCDToDec(v);
+    switch (reg) {
+    case DS3231_REG_SECONDS:
+    case DS3231_REG_MINUTES:
+        return *value <= 59;
+    case DS3231_REG_HOURS:
+        return *value <= 23;
+    case DS3231_REG_DATE:
+        return *value >= 1 && *value <= 31;
+    case DS3231_REG_MONTH:
+        return *value >= 1 && *value <= 12;
+    default:
+        return *value <= 99;
+    }
+}
+
+static void CodecBench_Time(CodecBench_Result_t *r24, CodecBench_Result_t *r12)
+{
+    for (uint32_t i = 0; i < CODEC_BENCH_TIME_VALUES; i++) {
+        ds3231_time_t time = {(uint8_t)(i / 3600u), (uint8_t)(i / 60u % 60u), (uint8_t)(i % 60u)};
+        ds3231_time_t decoded;
+        uint8_t regs[3];
+        uint8_t expect[3] = {decToBCD(time.seconds), decToBCD(time.minutes), decToBCD(time.hours)};
+
+        memset(&decoded, 0xFF, sizeof(decoded));
+        if (r24 != NULL) {
+            r24->values++;
+            if (DS3231_EncodeTime(&time, regs) != HAL_OK || memcmp(regs, expect, 3) != 0 ||
+                DS3231_DecodeTime(regs, &decoded) != HAL_OK || memcmp(&decoded, &time, sizeof(time)) != 0) {
+                r24->mismatches++;
+            }
+        }
+        if (r12 != NULL) {
+            uint8_t hours12 = (uint8_t)((time.hours % 12u) ? time.hours % 12u : 12u);
+            expect[2] = (uint8_t)(HOURS_12H_MASK | (time.hours >= 12 ? HOURS_PM_MASK : 0) | decToBCD(hours12));
+            memset(&decoded, 0xFF, sizeof(decoded));
+            r12->values++;
+            if (DS3231_DecodeTime(expect, &decoded) != HAL_OK || memcmp(&decoded, &time, sizeof(time)) != 0) {
+                r12->mismatches++;
+            }
+        }
+    }
+    // Out of range values are refused
+    if (r24 != NULL) {
+        ds3231_time_t bad[3] = {{24, 0, 0}, {0, 60, 0}, {0, 0, 60}};
+        uint8_t regs[3];
+        for (uint8_t i = 0; i < 3; i++) {
+            r24->mismatches += (DS3231_EncodeTime(&bad[i], regs) != HAL_ERROR);
+        }
+    }
+}
+
+static void CodecBench_Date(CodecBench_Result_t *r)
+{
+    for (uint8_t year = 0; year <= 99; year++) {
+        for (uint8_t month = 1; month <= 12; month++) {
+            for (uint8_t day = 1; day <= 31; day++) {
+                ds3231_data_t date = {day, month, year};
+                ds3231_data_t decoded;
+                uint8_t regs[3];
+                uint8_t expect[3] = {decToBCD(day), decToBCD(month), decToBCD(year)};
+
+                r->values += 2;
+                memset(&decoded, 0, sizeof(decoded));
+                if (DS3231_EncodeDate(&date, regs) != HAL_OK || memcmp(regs, expect, 3) != 0 ||
+                    DS3231_DecodeDate(regs, &decoded) != HAL_OK || memcmp(&decoded, &date, sizeof(date)) != 0) {
+                    r->mismatches++;
+                }
+                expect[1] |= 0x80; // Century bit, set by the chip after 2099
+                memset(&decoded, 0, sizeof(decoded));
+                if (DS3231_DecodeDate(expect, &decoded) != HAL_OK || memcmp(&decoded, &date, sizeof(date)) != 0) {
+                    r->mismatches++;
+                }
+            }
+        }
+    }
+    ds3231_data_t bad[5] = {{0, 1, 0}, {32, 1, 0}, {1, 0, 0}, {1, 13, 0}, {1, 1, 100}};
+    uint8_t regs[3];
+    for (uint8_t i = 0; i < 5; i++) {
+        r->mismatches += (DS3231_EncodeDate(&bad[i], regs) != HAL_ERROR);
+    }
+}
+
+// Reference image of one alarm as SetAlarm1/SetAlarm2 built it
+static void CodecBench_AlarmImage(const sAlram_t *alarm, sMode_t mode, uint8_t withSeconds, uint8_t *regs)
+{
+    const uint8_t *masks = referenceMasks[mode];
+    uint8_t dayDate = masks[3];
+
+    if (mode == Once) {
+        dayDate = (uint8_t)(((alarm->date / 10) << 4) | (alarm->date % 10));
+    } else if (mode == EveryWeek) {
+        dayDate = (uint8_t)(ALRAM_DAY_MASK | alarm->dayOfWeek);
+    }
+    if (withSeconds) {
+        *regs++ = (uint8_t)(masks[0] | decToBCD(alarm->seconds));
+    }
+    regs[0] = (uint8_t)(masks[1] | decToBCD(alarm->minutes));
+    regs[1] = (uint8_t)(masks[2] | decToBCD(alarm->hours));
+    regs[2] = dayDate;
+}
+
+static void CodecBench_AlarmCheck(CodecBench_Result_t *r, const sAlram_t *alarm, sMode_t mode, uint8_t withSeconds)
+{
+    uint8_t regs[4];
+    uint8_t expect[4];
+    uint8_t len = withSeconds ? 4 : 3;
+    sAlram_t decoded;
+
+    r->values++;
+    CodecBench_AlarmImage(alarm, mode, withSeconds, expect);
+    memset(&decoded, 0, sizeof(decoded));
+    if (DS3231_EncodeAlarm(alarm, mode, withSeconds, regs) != HAL_OK || memcmp(regs, expect, len) != 0 ||
+        DS3231_DecodeAlarm(regs, withSeconds, &decoded) != HAL_OK) {
+        r->mismatches++;
+        return;
+    }
+    // Only the field the DY/DT bit selects comes back, and Alarm 2 has no seconds
+    if (decoded.hours != alarm->hours || decoded.minutes != alarm->minutes ||
+        decoded.seconds != (withSeconds ? alarm->seconds : 0) ||
+        (mode == Once && decoded.date != alarm->date) ||
+        (mode == EveryWeek && decoded.dayOfWeek != alarm->dayOfWeek)) {
+        r->mismatches++;
+    }
+}
+
+static void CodecBench_Alarm(CodecBench_Result_t *r, uint8_t withSeconds)
+{
+    for (uint8_t mode = EveryMinute; mode <= EveryWeek; mode++) {
+        sAlram_t alarm = {0, 0, 0, Sunday, 1};
+        for (uint32_t i = 0; i < CODEC_BENCH_TIME_VALUES; i += withSeconds ? 1u : 60u) {
+            alarm.hours = (uint8_t)(i / 3600u);
+            alarm.minutes = (uint8_t)(i / 60u % 60u);
+            alarm.seconds = (uint8_t)(i % 60u);
+            CodecBench_AlarmCheck(r, &alarm, (sMode_t)mode, withSeconds);
+        }
+        alarm.hours = 12;
+        for (uint8_t date = 1; date <= 31; date++) {
+            for (uint8_t dow = Sunday; dow <= Saturday; dow++) {
+                alarm.date = date;
+                alarm.dayOfWeek = (ds3231_dow_t)dow;
+                CodecBench_AlarmCheck(r, &alarm, (sMode_t)mode, withSeconds);
+            }
+        }
+    }
+    sAlram_t bad = {0, 0, 0, Sunday, 0};
+    uint8_t regs[4];
+    r->mismatches += (DS3231_EncodeAlarm(&bad, Once, withSeconds, regs) != HAL_ERROR);
+    bad.date = 1;
+    r->mismatches += (DS3231_EncodeAlarm(&bad, (sMode_t)(EveryWeek + 1), withSeconds, regs) != HAL_ERROR);
+}
+
+// Every byte in one register of a legal time or date image
+static void CodecBench_Register(CodecBench_Result_t *r, uint8_t reg)
+{
+    static const uint8_t legal[7] = {0x45, 0x30, 0x17, 0x00, 0x28, 0x02, 0x24}; // 17:30:45, 28/02/2024
+    uint8_t isTime = reg <= DS3231_REG_HOURS;
+    uint8_t first = isTime ? DS3231_REG_SECONDS : DS3231_REG_DATE;
+
+    for (uint16_t byte = 0; byte <= 0xFF; byte++) {
+        uint8_t regs[7];
+        uint8_t value = 0;
+        uint8_t decodedValue;
+        int accepted;
+        int expected = CodecBench_Legal(reg, (uint8_t)byte, &value);
+
+        memcpy(regs, legal, sizeof(regs));
+        regs[reg] = (uint8_t)byte;
+        r->values++;
+        if (isTime) {
+            ds3231_time_t time = {0xEE, 0xEE, 0xEE};
+            accepted = DS3231_DecodeTime(&regs[first], &time) == HAL_OK;
+            decodedValue = (reg == DS3231_REG_SECONDS) ? time.seconds : (reg == DS3231_REG_MINUTES) ? time.minutes : time.hours;
+            if (!accepted && (time.hours != 0xEE || time.minutes != 0xEE || time.seconds != 0xEE)) {
+                r->mismatches++;
+            }
+        } else {
+            ds3231_data_t date = {0xEE, 0xEE, 0xEE};
+            accepted = DS3231_DecodeDate(&regs[first], &date) == HAL_OK;
+            decodedValue = (reg == DS3231_REG_DATE) ? date.date : (reg == DS3231_REG_MONTH) ? date.month : date.year;
+            if (!accepted && (date.date != 0xEE || date.month != 0xEE || date.year != 0xEE)) {
+                r->mismatches++;
+            }
+        }
+        if (accepted != expected || (accepted && decodedValue != value)) {
+            r->mismatches++;
+        }
+    }
+}
+
+ /* ========================== Function Definitions ============================ */
+
+/**
+ * @brief Check every legal value of every field against the reference
+ * @return uint16_t Results written
+ */
+uint16_t CodecBench_Exhaustive(CodecBench_Result_t *results, uint16_t max)
+{
+    static const char *regNames[7] = {"reg_seconds", "reg_minutes", "reg_hours", NULL, "reg_date", "reg_month", "reg_year"};
+    CodecBench_Result_t *r24 = NULL;
+    CodecBench_Result_t *r12 = NULL;
+    CodecBench_Result_t *r;
+    uint16_t count = 0;
+
+    r24 = CodecBench_Add(results, &count, max, "time_24h", "codec");
+    r12 = CodecBench_Add(results, &count, max, "time_12h", "codec");
+    CodecBench_Time(r24, r12);
+    if ((r = CodecBench_Add(results, &count, max, "date", "codec")) != NULL) {
+        CodecBench_Date(r);
+    }
+    if ((r = CodecBench_Add(results, &count, max, "alarm1", "codec")) != NULL) {
+        CodecBench_Alarm(r, 1);
+    }
+    if ((r = CodecBench_Add(results, &count, max, "alarm2", "codec")) != NULL) {
+        CodecBench_Alarm(r, 0);
+    }
+    for (uint8_t reg = DS3231_REG_SECONDS; reg <= DS3231_REG_YEAR; reg++) {
+        if (regNames[reg] != NULL && (r = CodecBench_Add(results, &count, max, regNames[reg], "codec")) != NULL) {
+            CodecBench_Register(r, reg);
+        }
+    }
+    for (uint16_t i = 0; i < count; i++) {
+        results[i].pass = results[i].mismatches == 0;
+    }
+    return count;
+}
+
+/**
+ * @brief Time decoding and encoding of time images, codec against the macros
+ * @return uint16_t Results written
+ */
+uint16_t CodecBench_Speed(CodecBench_Result_t *results, uint16_t max)
+{
+    static uint8_t images[CODEC_BENCH_TIME_VALUES][3];
+    static ds3231_time_t times[CODEC_BENCH_TIME_VALUES];
+    CodecBench_Result_t *r;
+    uint16_t count = 0;
+    uint32_t sum = 0;
+    uint64_t t0;
+
+    for (uint32_t i = 0; i < CODEC_BENCH_TIME_VALUES; i++) {
+        images[i][0] = decToBCD(i % 60u);
+        images[i][1] = decToBCD(i / 60u % 60u);
+        images[i][2] = decToBCD(i / 3600u);
+        times[i] = (ds3231_time_t){(uint8_t)(i / 3600u), (uint8_t)(i / 60u % 60u), (uint8_t)(i % 60u)};
+    }
+
+    if ((r = CodecBench_Add(results, &count, max, "decode_time", "codec")) != NULL) {
+        ds3231_time_t time;
+        t0 = CodecBench_CpuNs();
+        for (uint32_t i = 0; i < CODEC_BENCH_IMAGES; i++) {
+            sum += (DS3231_DecodeTime(images[i % CODEC_BENCH_TIME_VALUES], &time) == HAL_OK) + time.seconds +
+                   time.minutes + time.hours;
+        }
+        r->cpuNs = CodecBench_CpuNs() - t0;
+        r->values = CODEC_BENCH_IMAGES;
+        r->pass = 1;
+    }
+    if ((r = CodecBench_Add(results, &count, max, "decode_time", "macros")) != NULL) {
+        ds3231_time_t time;
+        t0 = CodecBench_CpuNs();
+        for (uint32_t i = 0; i < CODEC_BENCH_IMAGES; i++) {
+            sum += (CodecBench_MacroDecodeTime(images[i % CODEC_BENCH_TIME_VALUES], &time) == HAL_OK) + time.seconds +
+                   time.minutes + time.hours;
+        }
+        r->cpuNs = CodecBench_CpuNs() - t0;
+        r->values = CODEC_BENCH_IMAGES;
+        r->pass = 1;
+    }
+    if ((r = CodecBench_Add(results, &count, max, "encode_time", "codec")) != NULL) {
+        uint8_t regs[3];
+        t0 = CodecBench_CpuNs();
+        for (uint32_t i = 0; i < CODEC_BENCH_IMAGES; i++) {
+            sum += (DS3231_EncodeTime(&times[i % CODEC_BENCH_TIME_VALUES], regs) == HAL_OK) + regs[0] + regs[1] + regs[2];
+        }
+        r->cpuNs = CodecBench_CpuNs() - t0;
+        r->values = CODEC_BENCH_IMAGES;
+        r->pass = 1;
+    }
+    if ((r = CodecBench_Add(results, &count, max, "encode_time", "macros")) != NULL) {
+        uint8_t regs[3];
+        t0 = CodecBench_CpuNs();
+        for (uint32_t i = 0; i < CODEC_BENCH_IMAGES; i++) {
+            sum += (CodecBench_MacroEncodeTime(&times[i % CODEC_BENCH_TIME_VALUES], regs) == HAL_OK) + regs[0] + regs[1] +
+                   regs[2];
+        }
+        r->cpuNs = CodecBench_CpuNs() - t0;
+        r->values = CODEC_BENCH_IMAGES;
+        r->pass = 1;
+    }
+    sink = sum;
+    return count;
+}
+
+/**
+ * @brief Write results as CSV, one row per result
+ */
+void CodecBench_WriteCsv(FILE *out, const CodecBench_Result_t *results, uint16_t count)
+{
+    fprintf(out, "test,variant,values,mismatches,ns_per_value,status\n");
+    for (uint16_t i = 0; i < count; i++) {
+        const CodecBench_Result_t *r = &results[i];
+        fprintf(out, "%s,%s,%lu,%lu,%.2f,%s\n", r->name, r->variant, (unsigned long)r->values,
+                (unsigned long)r->mismatches, r->cpuNs && r->values ? (double)r->cpuNs / r->values : 0.0,
+                r->pass ? "ok" : "FAIL");
+    }
+}
+
+/**
+ * @brief Run every test and print the CSV
+ * @return int 0 if every result passed, 1 if one failed, 2 on a usage error
+ */
+int CodecBench_Main(int argc, char **argv)
+{
+    static CodecBench_Result_t results[24];
+    const uint16_t max = sizeof(results) / sizeof(results[0]);
+    uint16_t count = 0;
+    int failed = 0;
+
+    if (argc > 1) {
+        fprintf(stderr, "usage: %s\n", argv[0]);
+        return 2;
+    }
+    count += CodecBench_Exhaustive(&results[count], (uint16_t)(max - count));
+    count += CodecBench_Speed(&results[count], (uint16_t)(max - count));
+
+    CodecBench_WriteCsv(stdout, results, count);
+    for (uint16_t i = 0; i < count; i++) {
+        if (!results[i].pass) {
+            fprintf(stderr, "%s %s failed\n", results[i].name, results[i].variant);
+            failed = 1;
+        }
+    }
+    return failed;
+}
@@ -0,0 +1,27 @@
+#ifndef CODEC_BENCH_H
+#define CODEC_BENCH_H
+#include "DS3231.h"
+#include <stdio.h>
+
+/*------------------- Configuration ---------------------------*/
+#ifndef CODEC_BENCH_IMAGES
+#define CODEC_BENCH_IMAGES 10000000 // Register images timed per variant
+#endif
+
+/************************ Bench Structs ********************************/
+typedef struct {
+    const char *name;       // Test
+    const char *variant;    // "codec" or "macros"
+    uint32_t values;        // Register values or images checked or timed
+    uint32_t mismatches;    // Against the reference built from the old macros
+    uint64_t cpuNs;         // Host CPU time, speed rows only
+    int pass;
+} CodecBench_Result_t;
+
+/*------------------- Function Prototypes ---------------------------*/
+uint16_t CodecBench_Exhaustive(CodecBench_Result_t *results, uint16_t max);
+uint16_t CodecBench_Speed(CodecBench_Result_t *results, uint16_t max);
+void CodecBench_WriteCsv(FILE *out, const CodecBench_Result_t *results, uint16_t count);
+int CodecBench_Main(int argc, char **argv);
+
+#endif
@@ -0,0 +1,137 @@
+#include "DriftBench.h"
+#include "SimDS3231.h"
+#include <stdlib.h>
+#include <string.h>
+
+/**
+ ******************************************************************************
+ * @file    DriftBench.c
+ * @author  Yair Yamin
+ * @brief   DS3231_DriftUpdate() against a simulated DS3231 with a skewed crystal.
+ * @details The simulated clock is the reference time source: every hour the
+ * loop gets its seconds, as it would get a GPS or NTP time, while the model
+ * runs fast or slow by the crystal error minus 100 ppb per aging LSB. Each
+ * case runs for days with a one-day window and checks that the aging offset
+ * settles on the value that cancels the skew, including skews well below the
+ * 11.6 ppm a single one-day window can resolve.
+ ******************************************************************************
+ */
+
+/* ========================== Defines ============================ */
+#define DRIFT_BENCH_ADDR (0x68 << 1)
+#define DRIFT_BENCH_NS_PER_S 1000000000ull
+#define DRIFT_BENCH_DAY 86400u
+#define DRIFT_BENCH_UPDATE_S 3600u // Reference time available every hour
+
+/* ========================== Global Variables ============================ */
+static struct {
+    I2C_HandleTypeDef hi2c;
+    SimDS3231_t sim;
+    DS3231_Handle_t rtc;
+    DS3231_Drift_t drift;
+} bench;
+
+/* ========================== Static Helpers ============================ */
+
+// Model time without bus traffic, with the fraction of the running second
+static int64_t DriftBench_RtcMs(void)
+{
+    ds3231_time_t time;
+    ds3231_data_t date;
+
+    DS3231_DecodeTime(&bench.sim.regs[DS3231_REG_SECONDS], &time);
+    DS3231_DecodeDate(&bench.sim.regs[DS3231_REG_DATE], &date);
+    return (int64_t)DS3231_ToSeconds(&date, &time) * 1000 + bench.sim.fracNs / 1000000;
+}
+
+ /* ========================== Function Definitions ============================ */
+
+/**
+ * @brief Run the drift loop against one crystal error
+ * @param skewPpb Crystal error, positive runs fast
+ * @param windowS minWindow of the loop
+ * @param days Simulated days
+ * @param result Filled in
+ */
+void DriftBench_Run(int32_t skewPpb, uint32_t windowS, uint32_t days, DriftBench_Result_t *result)
+{
+    int64_t startErrMs = 0;
+    int8_t aging = 0;
+    int ok = 1;
+
+    memset(&bench, 0, sizeof(bench));
+    memset(result, 0, sizeof(*result));
+    result->skewPpb = skewPpb;
+    result->windowS = windowS;
+    result->days = days;
+    result->target = (int8_t)(skewPpb / DS3231_AGING_PPB_PER_LSB);
+
+    HostSim_Reset();
+    HostSim_I2CInit(&bench.hi2c, 400000, HOSTSIM_DMA_IMMEDIATE);
+    SimDS3231_Init(&bench.sim, DRIFT_BENCH_ADDR);
+    SimDS3231_SetDrift(&bench.sim, skewPpb);
+    HostSim_Attach(&bench.hi2c, &bench.sim.dev);
+    bench.rtc.i2c_handle = &bench.hi2c;
+    bench.rtc.I2C_address = DRIFT_BENCH_ADDR;
+    DS3231_DriftInit(&bench.drift, windowS);
+
+    for (uint32_t hour = 0; hour <= days * 24u; hour++) {
+        uint32_t refSeconds = (uint32_t)(HostSim_NowNs() / DRIFT_BENCH_NS_PER_S);
+        int8_t before = aging;
+
+        if (hour == (days > 30 ? days - 30 : 0) * 24u) {
+            startErrMs = DriftBench_RtcMs() - (int64_t)(HostSim_NowNs() / 1000000u);
+        }
+        ok &= (DS3231_DriftUpdate(&bench.rtc, &bench.drift, refSeconds) == HAL_OK);
+        ok &= (DS3231_GetAgingOffset(&bench.rtc, &aging) == HAL_OK);
+        if (aging != before) {
+            result->corrections++;
+        }
+        if (abs(aging - result->target) > DRIFT_BENCH_TOLERANCE) {
+            result->settledDay = hour / 24u + 1u;
+        }
+        HostSim_AdvanceNs((uint64_t)DRIFT_BENCH_UPDATE_S * DRIFT_BENCH_NS_PER_S);
+    }
+
+    result->aging = aging;
+    result->residualPpb = skewPpb - aging * DS3231_AGING_PPB_PER_LSB;
+    result->lastDaysErrMs = (int32_t)(DriftBench_RtcMs() - (int64_t)(HostSim_NowNs() / 1000000u) - startErrMs);
+    result->pass = ok && abs(aging - result->target) <= DRIFT_BENCH_TOLERANCE;
+}
+
+/**
+ * @brief Write results as CSV, one row per case
+ */
+void DriftBench_WriteCsv(FILE *out, const DriftBench_Result_t *results, uint16_t count)
+{
+    fprintf(out, "skew_ppb,window_s,days,corrections,target,aging,settled_day,residual_ppb,last30d_err_ms,status\n");
+    for (uint16_t i = 0; i < count; i++) {
+        const DriftBench_Result_t *r = &results[i];
+        fprintf(out, "%ld,%lu,%lu,%lu,%d,%d,%lu,%ld,%ld,%s\n", (long)r->skewPpb, (unsigned long)r->windowS,
+                (unsigned long)r->days, (unsigned long)r->corrections, r->target, r->aging, (unsigned long)r->settledDay,
+                (long)r->residualPpb, (long)r->lastDaysErrMs, r->pass ? "ok" : "FAIL");
+    }
+}
+
+/**
+ * @brief Run every crystal error and print the CSV
+ * @return int 0 if every offset settled, 1 if one did not, 2 on a usage error
+ */
+int DriftBench_Main(int argc, char **argv)
+{
+    static const int32_t skews[] = {3000, -5000, 8000, -11000, 12500}; // Within the +/-12.8 ppm the aging offset reaches
+    static DriftBench_Result_t results[sizeof(skews) / sizeof(skews[0])];
+    const uint16_t count = sizeof(skews) / sizeof(skews[0]);
+    int failed = 0;
+
+    if (argc > 1) {
+        fprintf(stderr, "usage: %s\n", argv[0]);
+        return 2;
+    }
+    for (uint16_t i = 0; i < count; i++) {
+        DriftBench_Run(skews[i], DRIFT_BENCH_DAY, DRIFT_BENCH_DAYS, &results[i]);
+        failed |= !results[i].pass;
+    }
+    DriftBench_WriteCsv(stdout, results, count);
+    return failed;
+}
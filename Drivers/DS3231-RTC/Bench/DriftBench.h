@@ -0,0 +1,31 @@
+#ifndef DRIFT_BENCH_H
+#define DRIFT_BENCH_H
+#include "DS3231.h"
+#include <stdio.h>
+
+/*------------------- Configuration ---------------------------*/
+#ifndef DRIFT_BENCH_DAYS
+#define DRIFT_BENCH_DAYS 180 // Simulated days per case
+#endif
+#define DRIFT_BENCH_TOLERANCE 2 // Aging LSBs the final offset may be off by
+
+/************************ Bench Structs ********************************/
+typedef struct {
+    int32_t skewPpb;        // Crystal error of the simulated DS3231
+    uint32_t windowS;       // minWindow of the loop
+    uint32_t days;
+    uint32_t corrections;   // Aging offset changes
+    int8_t target;          // Offset that cancels the skew
+    int8_t aging;           // Offset at the end
+    uint32_t settledDay;    // First day from which the offset stays within the tolerance
+    int32_t residualPpb;    // Skew left at the end
+    int32_t lastDaysErrMs;  // RTC minus reference over the last 30 days
+    int pass;
+} DriftBench_Result_t;
+
+/*------------------- Function Prototypes ---------------------------*/
+void DriftBench_Run(int32_t skewPpb, uint32_t windowS, uint32_t days, DriftBench_Result_t *result);
+void DriftBench_WriteCsv(FILE *out, const DriftBench_Result_t *results, uint16_t count);
+int DriftBench_Main(int argc, char **argv);
+
+#endif
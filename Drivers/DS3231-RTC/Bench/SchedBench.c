@@ -0,0 +1,278 @@
+#include "SchedBench.h"
+#include "SimDS3231.h"
+#include <string.h>
+
+/**
+ ******************************************************************************
+ * @file    SchedBench.c
+ * @author  Yair Yamin
+ * @brief   DS3231_Sched against the simulated DS3231.
+ * @details The INT/SQW pin of the model calls DS3231_Sched_IRQHandler() and
+ * the loop calls DS3231_Sched_Process() after every simulated second, as the
+ * main loop would after waking up. Every callback checks that it runs in the
+ * RTC second it was due.
+ *
+ * - heap_order: one-shots added out of order run in due order.
+ * - periodic: two periodic entries with co-prime periods.
+ * - cancel: cancelling the armed entry and a later one, and an unknown id.
+ * - month_out: due times 40 and 70 days out. Alarm 1 only matches the date,
+ *   so it first fires a month early and must be re-armed without a callback.
+ * - alarm2: the application runs Alarm 2 every minute on the same INT/SQW
+ *   pin and must see every event while the scheduler fires in the same
+ *   seconds.
+ * - full: DS3231_SCHED_MAX_TASKS entries, then HAL_BUSY.
+ ******************************************************************************
+ */
+
+/* ========================== Defines ============================ */
+#define SCHED_BENCH_ADDR (0x68 << 1)
+#define SCHED_BENCH_NS_PER_S 1000000000ull
+#define SCHED_BENCH_DAY 86400u
+
+/************************ Bench Context ********************************/
+typedef struct {
+    uint32_t next;          // RTC second of the next expected call
+    uint32_t period;
+    uint32_t fires;
+} SchedBench_Task_t;
+
+static struct {
+    I2C_HandleTypeDef hi2c;
+    SimDS3231_t sim;
+    DS3231_Handle_t rtc;
+    DS3231_Sched_t sched;
+    SchedBench_Task_t tasks[SCHED_BENCH_TASKS];
+    uint32_t order[SCHED_BENCH_TASKS]; // Task index per call, heap_order only
+    SchedBench_Result_t *result;
+    uint8_t intSeen;        // For the application's Alarm 2 check
+    uint8_t watchAlarm2;
+} bench;
+
+/* ========================== Static Helpers ============================ */
+
+// RTC time straight from the model, no bus traffic
+static uint32_t SchedBench_RtcSeconds(void)
+{
+    ds3231_time_t time;
+    ds3231_data_t date;
+
+    DS3231_DecodeTime(&bench.sim.regs[DS3231_REG_SECONDS], &time);
+    DS3231_DecodeDate(&bench.sim.regs[DS3231_REG_DATE], &date);
+    return DS3231_ToSeconds(&date, &time);
+}
+
+static void SchedBench_Int(void *ctx)
+{
+    (void)ctx;
+    bench.result->wakeups++;
+    bench.intSeen = 1;
+    DS3231_Sched_IRQHandler(&bench.sched);
+}
+
+static void SchedBench_Callback(uint8_t id, void *ctx)
+{
+    SchedBench_Task_t *task = (SchedBench_Task_t *)ctx;
+    int32_t late = (int32_t)(SchedBench_RtcSeconds() - task->next);
+    SchedBench_Result_t *r = bench.result;
+
+    (void)id;
+    if (late < 0) {
+        r->early++;
+    } else if ((uint32_t)late > r->maxLate) {
+        r->maxLate = (uint32_t)late;
+    }
+    if (r->fired < SCHED_BENCH_TASKS) {
+        bench.order[r->fired] = (uint32_t)(task - bench.tasks);
+    }
+    r->fired++;
+    task->fires++;
+    task->next += task->period;
+}
+
+static void SchedBench_Setup(SchedBench_Result_t *r, const char *name)
+{
+    memset(&bench, 0, sizeof(bench));
+    memset(r, 0, sizeof(*r));
+    r->name = name;
+    bench.result = r;
+
+    HostSim_Reset();
+    HostSim_I2CInit(&bench.hi2c, 400000, HOSTSIM_DMA_IMMEDIATE);
+    SimDS3231_Init(&bench.sim, SCHED_BENCH_ADDR);
+    HostSim_Attach(&bench.hi2c, &bench.sim.dev);
+    SimDS3231_SetIntCallback(&bench.sim, SchedBench_Int, NULL);
+
+    bench.rtc.i2c_handle = &bench.hi2c;
+    bench.rtc.I2C_address = SCHED_BENCH_ADDR;
+    DS3231_Sched_Init(&bench.sched, &bench.rtc);
+}
+
+static HAL_StatusTypeDef SchedBench_Add(uint8_t task, uint32_t delay, uint32_t period, uint8_t *id)
+{
+    bench.tasks[task].next = SchedBench_RtcSeconds() + delay;
+    bench.tasks[task].period = period;
+    return DS3231_Sched_Add(&bench.sched, delay, period, SchedBench_Callback, &bench.tasks[task], id);
+}
+
+// Step to just after each RTC second and service the wakeups, for seconds RTC seconds
+static int SchedBench_RunFor(uint32_t seconds)
+{
+    uint32_t end = SchedBench_RtcSeconds() + seconds;
+    int ok = 1;
+
+    while (SchedBench_RtcSeconds() < end) {
+        uint64_t now = HostSim_NowNs();
+        HostSim_AdvanceNs((now / SCHED_BENCH_NS_PER_S + 1) * SCHED_BENCH_NS_PER_S + 1000 - now);
+        ok &= (DS3231_Sched_Process(&bench.sched) == HAL_OK);
+        if (bench.watchAlarm2 && bench.intSeen) {
+            bench.intSeen = 0;
+            ok &= (DS3231_ReadStatus(&bench.rtc) == HAL_OK);
+            if (bench.rtc.Reg[DS3231_REG_STATUS] & STATUS_A2F_MASK) {
+                bench.result->alarm2++;
+                ok &= (DS3231_ClearFlags(&bench.rtc, STATUS_A2F_MASK) == HAL_OK);
+            }
+        }
+    }
+    bench.result->runSeconds += seconds;
+    return ok;
+}
+
+static int SchedBench_Done(SchedBench_Result_t *r, int ok)
+{
+    r->pass = ok && r->fired == r->expected && r->early == 0 && r->maxLate == 0;
+    return r->pass;
+}
+
+/* ========================== Function Definitions ============================ */
+
+/**
+ * @brief Run every case
+ * @return uint16_t Results written
+ */
+uint16_t SchedBench_Run(SchedBench_Result_t *results, uint16_t max)
+{
+    static const uint32_t delays[SCHED_BENCH_TASKS] = {50, 10, 40, 20, 70, 30, 60, 15};
+    SchedBench_Result_t *r;
+    uint16_t count = 0;
+    uint8_t ids[SCHED_BENCH_TASKS];
+    int ok;
+
+    if (count < max) {
+        r = &results[count++];
+        SchedBench_Setup(r, "heap_order");
+        ok = 1;
+        for (uint8_t i = 0; i < SCHED_BENCH_TASKS; i++) {
+            ok &= (SchedBench_Add(i, delays[i], 0, NULL) == HAL_OK);
+        }
+        r->expected = SCHED_BENCH_TASKS;
+        ok &= SchedBench_RunFor(80);
+        for (uint8_t i = 1; i < SCHED_BENCH_TASKS && i < r->fired; i++) {
+            ok &= (delays[bench.order[i - 1]] < delays[bench.order[i]]);
+        }
+        ok &= (bench.sched.count == 0);
+        SchedBench_Done(r, ok);
+    }
+
+    if (count < max) {
+        r = &results[count++];
+        SchedBench_Setup(r, "periodic");
+        ok = (SchedBench_Add(0, 5, 7, NULL) == HAL_OK) & (SchedBench_Add(1, 3, 11, NULL) == HAL_OK);
+        ok &= SchedBench_RunFor(60);
+        r->expected = 8 + 6; // 5, 12 ... 54 and 3, 14 ... 58
+        SchedBench_Done(r, ok);
+    }
+
+    if (count < max) {
+        r = &results[count++];
+        SchedBench_Setup(r, "cancel");
+        ok = 1;
+        for (uint8_t i = 0; i < 4; i++) {
+            ok &= (SchedBench_Add(i, 10u * (i + 1u), 0, &ids[i]) == HAL_OK);
+        }
+        ok &= (DS3231_Sched_Cancel(&bench.sched, ids[0]) == HAL_OK); // The armed one
+        ok &= (DS3231_Sched_Cancel(&bench.sched, ids[2]) == HAL_OK);
+        ok &= (DS3231_Sched_Cancel(&bench.sched, ids[2]) == HAL_ERROR);
+        ok &= SchedBench_RunFor(45);
+        ok &= (bench.tasks[0].fires == 0 && bench.tasks[1].fires == 1 && bench.tasks[2].fires == 0 && bench.tasks[3].fires == 1);
+        r->expected = 2;
+        SchedBench_Done(r, ok);
+    }
+
+    if (count < max) {
+        r = &results[count++];
+        SchedBench_Setup(r, "month_out");
+        ok = (SchedBench_Add(0, 40 * SCHED_BENCH_DAY + 3661, 0, NULL) == HAL_OK);
+        ok &= (SchedBench_Add(1, 70 * SCHED_BENCH_DAY, 0, NULL) == HAL_OK);
+        ok &= SchedBench_RunFor(71 * SCHED_BENCH_DAY);
+        r->expected = 2;
+        ok &= (r->wakeups == 4); // Two a month early, then each on time
+        SchedBench_Done(r, ok);
+    }
+
+    if (count < max) {
+        r = &results[count++];
+        SchedBench_Setup(r, "alarm2");
+        bench.watchAlarm2 = 1;
+        bench.rtc.alarm2.date = 1;
+        bench.rtc.alarm2.dayOfWeek = Saturday;
+        ok = (DS3231_SetAlarm2(EveryMinute, &bench.rtc) == HAL_OK);
+        ok &= (SchedBench_Add(0, 60, 60, NULL) == HAL_OK); // Due in the seconds Alarm 2 fires
+        ok &= (SchedBench_Add(1, 7, 7, NULL) == HAL_OK);
+        ok &= SchedBench_RunFor(301);
+        r->expected = 5 + 43;
+        ok &= (r->alarm2 == 5);
+        SchedBench_Done(r, ok);
+    }
+
+    if (count < max) {
+        r = &results[count++];
+        SchedBench_Setup(r, "full");
+        ok = 1;
+        for (uint16_t i = 0; i < DS3231_SCHED_MAX_TASKS; i++) {
+            ok &= (SchedBench_Add(0, 100u + i, 0, NULL) == HAL_OK);
+        }
+        ok &= (SchedBench_Add(0, 10, 0, NULL) == HAL_BUSY);
+        ok &= (bench.sched.count == DS3231_SCHED_MAX_TASKS);
+        SchedBench_Done(r, ok);
+    }
+    return count;
+}
+
+/**
+ * @brief Write results as CSV, one row per case
+ */
+void SchedBench_WriteCsv(FILE *out, const SchedBench_Result_t *results, uint16_t count)
+{
+    fprintf(out, "case,run_s,expected,fired,early,max_late_s,wakeups,alarm2,status\n");
+    for (uint16_t i = 0; i < count; i++) {
+        const SchedBench_Result_t *r = &results[i];
+        fprintf(out, "%s,%lu,%lu,%lu,%lu,%lu,%lu,%lu,%s\n", r->name, (unsigned long)r->runSeconds, (unsigned long)r->expected,
+                (unsigned long)r->fired, (unsigned long)r->early, (unsigned long)r->maxLate, (unsigned long)r->wakeups,
+                (unsigned long)r->alarm2, r->pass ? "ok" : "FAIL");
+    }
+}
+
+/**
+ * @brief Run every case and print the CSV
+ * @return int 0 if every case passed, 1 if one failed, 2 on a usage error
+ */
+int SchedBench_Main(int argc, char **argv)
+{
+    static SchedBench_Result_t results[8];
+    uint16_t count;
+    int failed = 0;
+
+    if (argc > 1) {
+        fprintf(stderr, "usage: %s\n", argv[0]);
+        return 2;
+    }
+    count = SchedBench_Run(results, sizeof(results) / sizeof(results[0]));
+    SchedBench_WriteCsv(stdout, results, count);
+    for (uint16_t i = 0; i < count; i++) {
+        if (!results[i].pass) {
+            fprintf(stderr, "%s failed\n", results[i].name);
+            failed = 1;
+        }
+    }
+    return failed;
+}
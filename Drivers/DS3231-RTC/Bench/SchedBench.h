@@ -0,0 +1,27 @@
+#ifndef SCHED_BENCH_H
+#define SCHED_BENCH_H
+#include "DS3231_Sched.h"
+#include <stdio.h>
+
+/*------------------- Configuration ---------------------------*/
+#define SCHED_BENCH_TASKS 8
+
+/************************ Bench Structs ********************************/
+typedef struct {
+    const char *name;       // Case
+    uint32_t runSeconds;    // Simulated RTC time
+    uint32_t expected;      // Callbacks that should have run
+    uint32_t fired;         // Callbacks that ran
+    uint32_t wakeups;       // INT/SQW interrupts
+    uint32_t alarm2;        // Alarm 2 events seen by the application
+    uint32_t early;         // Callbacks before their due second
+    uint32_t maxLate;       // Seconds from due time to callback
+    int pass;
+} SchedBench_Result_t;
+
+/*------------------- Function Prototypes ---------------------------*/
+uint16_t SchedBench_Run(SchedBench_Result_t *results, uint16_t max);
+void SchedBench_WriteCsv(FILE *out, const SchedBench_Result_t *results, uint16_t count);
+int SchedBench_Main(int argc, char **argv);
+
+#endif
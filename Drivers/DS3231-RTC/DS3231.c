@@ -1,4 +1,12 @@
 #include "DS3231.h"
+#include <string.h>
+#ifdef DRIVER_TRACE
+#include "DriverTrace.h"
+#else
+#define DRIVER_TRACE_API(handle)
+#define DRIVER_TRACE_TXN_BEGIN()
+#define DRIVER_TRACE_TXN_END(device, reg, len, op, status)
+#endif
 
 /**
  ******************************************************************************
@@ -35,225 +43,280 @@
 
 /* =============================== Global Variables =============================== */
 
+#if defined(DS3231_COMPACT_HANDLE) && !defined(DRIVERS_DCACHE)
+#ifdef USE_I2CBUS
+#define DS3231_HANDLE_PTRS 2 // i2c_handle and bus_client
+#else
+#define DS3231_HANDLE_PTRS 1
+#endif
+// Size report: handle pointers plus 48 payload bytes, rounded up to pointer alignment
+_Static_assert(sizeof(DS3231_Handle_t) <= (DS3231_HANDLE_PTRS * sizeof(void*) + 48 + sizeof(void*) - 1) / sizeof(void*) * sizeof(void*),
+               "DS3231 compact handle grew");
+#endif
+
+// Days elapsed before the first of each month in a non-leap year
+static const uint16_t daysBeforeMonth[12] = {0, 31, 59, 90, 120, 151, 181, 212, 243, 273, 304, 334};
+
+// Register byte to binary, one table per field. Malformed BCD and out of range
+// values decode to DS3231_BCD_INVALID, so OR-ing the fields of an image and
+// testing bit 7 validates all of them at once.
+#define BCD_DEC(v)   ((((v) >> 4) < 10 && ((v) & 0x0F) < 10) ? (((v) >> 4) * 10 + ((v) & 0x0F)) : DS3231_BCD_INVALID)
+#define BCD_RANGE(v, lo, hi) ((BCD_DEC(v) >= (lo) && BCD_DEC(v) <= (hi)) ? BCD_DEC(v) : DS3231_BCD_INVALID)
+#define SECMIN_DEC(v) BCD_RANGE(v, 0, 59)
+#define DATE_DEC(v)   BCD_RANGE(v, 1, 31)
+#define MONTH_DEC(v)  BCD_RANGE(v, 1, 12)
+// Bit 6 selects 12-hour mode with bit 5 for PM: 12 AM is 0, 12 PM is 12
+#define HOURS_DEC(v) (((v) & HOURS_12H_MASK) \
+    ? ((BCD_RANGE((v) & 0x1F, 1, 12) == DS3231_BCD_INVALID) ? DS3231_BCD_INVALID \
+       : BCD_DEC((v) & 0x1F) % 12 + (((v) & HOURS_PM_MASK) ? 12 : 0)) \
+    : BCD_RANGE(v, 0, 23))
+#define BCD_LUT4(f, v)  f(v), f((v) + 1), f((v) + 2), f((v) + 3)
+#define BCD_LUT16(f, v) BCD_LUT4(f, v), BCD_LUT4(f, (v) + 4), BCD_LUT4(f, (v) + 8), BCD_LUT4(f, (v) + 12)
+#define BCD_LUT32(f, v) BCD_LUT16(f, v), BCD_LUT16(f, (v) + 16)
+#define BCD_LUT64(f, v) BCD_LUT32(f, v), BCD_LUT32(f, (v) + 32)
+static const uint8_t bcdToBin[256] = { BCD_LUT64(BCD_DEC, 0), BCD_LUT64(BCD_DEC, 64), BCD_LUT64(BCD_DEC, 128), BCD_LUT64(BCD_DEC, 192) }; // Year, 0-99
+static const uint8_t secMinToBin[128] = { BCD_LUT64(SECMIN_DEC, 0), BCD_LUT64(SECMIN_DEC, 64) };  // Without bit 7
+static const uint8_t hoursToBin[128] = { BCD_LUT64(HOURS_DEC, 0), BCD_LUT64(HOURS_DEC, 64) };     // Without bit 7, either mode
+static const uint8_t dateToBin[64] = { BCD_LUT64(DATE_DEC, 0) };
+static const uint8_t monthToBin[32] = { BCD_LUT32(MONTH_DEC, 0) };                                  // Without the century bit
+
+// Binary 0-99 to BCD byte
+#define BCD_ENC(v)   ((((v) / 10) << 4) | ((v) % 10))
+#define BCD_ENC10(v) BCD_ENC(v), BCD_ENC((v) + 1), BCD_ENC((v) + 2), BCD_ENC((v) + 3), BCD_ENC((v) + 4), \
+                     BCD_ENC((v) + 5), BCD_ENC((v) + 6), BCD_ENC((v) + 7), BCD_ENC((v) + 8), BCD_ENC((v) + 9)
+static const uint8_t binToBcd[100] = { BCD_ENC10(0), BCD_ENC10(10), BCD_ENC10(20), BCD_ENC10(30), BCD_ENC10(40),
+                                       BCD_ENC10(50), BCD_ENC10(60), BCD_ENC10(70), BCD_ENC10(80), BCD_ENC10(90) };
+
+// AxMx mask bits per alarm mode, bit 0 = seconds register ... bit 3 = day/date register
+static const uint8_t alarmMaskBits[6] = {
+    [EveryMinute] = 0x0E,
+    [EveryHour]   = 0x0C,
+    [EveryDay]    = 0x08,
+    [Once]        = 0x00,
+    [EveryWeek]   = 0x00,
+};
+
+
+/* ========================== I/O Helpers ============================ */
+
+static HAL_StatusTypeDef DS3231_ReadRegs(void *dev, uint8_t reg, uint8_t *data, uint16_t size)
+{
+    DS3231_Handle_t *handle = (DS3231_Handle_t *)dev;
+    HAL_StatusTypeDef status;
+    DRIVER_TRACE_TXN_BEGIN();
+#ifdef USE_I2CBUS
+    status = I2CBus_MemRead(handle->bus_client, handle->I2C_address, reg, data, size);
+#else
+    status = HAL_I2C_Mem_Read(handle->i2c_handle, handle->I2C_address, reg, I2C_MEMADD_SIZE_8BIT, data, size, DS3231_I2C_TIMEOUT);
+#endif
+    DRIVER_TRACE_TXN_END(handle->I2C_address, reg, size, DRIVER_TRACE_OP_MEM_READ, status);
+    return status;
+}
 
-/* ========================== Function Definitions ============================ */
+static HAL_StatusTypeDef DS3231_WriteRegs(void *dev, uint8_t reg, uint8_t *data, uint16_t size)
+{
+    DS3231_Handle_t *handle = (DS3231_Handle_t *)dev;
+    HAL_StatusTypeDef status;
+    DRIVER_TRACE_TXN_BEGIN();
+#ifdef USE_I2CBUS
+    status = I2CBus_MemWrite(handle->bus_client, handle->I2C_address, reg, data, size);
+#else
+    status = HAL_I2C_Mem_Write(handle->i2c_handle, handle->I2C_address, reg, I2C_MEMADD_SIZE_8BIT, data, size, DS3231_I2C_TIMEOUT);
+#endif
+    DRIVER_TRACE_TXN_END(handle->I2C_address, reg, size, DRIVER_TRACE_OP_MEM_WRITE, status);
+    return status;
+}
 
-HAL_StatusTypeDef DS3231_Init(DS3231_Handle_t *handle) 
+/* ========================== Register Table ============================ */
+
+// Reg[] index and register address are the same
+#define DS3231_MIRROR(reg, flags, strobe) \
+    {(reg), (reg), 1, (uint8_t)((flags) | ((DS3231_VOLATILE_REGS & DS3231_REG_BIT(reg)) ? REGCORE_VOLATILE : 0)), (strobe)}
+
+static const RegCore_Reg_t ds3231Regs[DS3231_REG_COUNT] = {
+    DS3231_MIRROR(DS3231_REG_SECONDS, 0, 0),
+    DS3231_MIRROR(DS3231_REG_MINUTES, 0, 0),
+    DS3231_MIRROR(DS3231_REG_HOURS, 0, 0),
+    DS3231_MIRROR(DS3231_REG_DAY, 0, 0),
+    DS3231_MIRROR(DS3231_REG_DATE, 0, 0),
+    DS3231_MIRROR(DS3231_REG_MONTH, 0, 0),
+    DS3231_MIRROR(DS3231_REG_YEAR, 0, 0),
+    DS3231_MIRROR(DS3231_REG_ALARM1_SECONDS, 0, 0),
+    DS3231_MIRROR(DS3231_REG_ALARM1_MINUTES, 0, 0),
+    DS3231_MIRROR(DS3231_REG_ALARM1_HOURS, 0, 0),
+    DS3231_MIRROR(DS3231_REG_ALARM1_DAYDATE, 0, 0),
+    DS3231_MIRROR(DS3231_REG_ALARM2_MINUTES, 0, 0),
+    DS3231_MIRROR(DS3231_REG_ALARM2_HOURS, 0, 0),
+    DS3231_MIRROR(DS3231_REG_ALARM2_DAYDATE, 0, 0),
+    DS3231_MIRROR(DS3231_REG_CONTROL, 0, CONV_MASK), // CONV is cleared by the chip when the conversion is done
+    DS3231_MIRROR(DS3231_REG_STATUS, 0, 0),
+    DS3231_MIRROR(DS3231_REG_AGING, 0, 0),
+    DS3231_MIRROR(DS3231_REG_TEMP_MSB, REGCORE_READ_ONLY, 0),
+    DS3231_MIRROR(DS3231_REG_TEMP_LSB, REGCORE_READ_ONLY, 0),
+};
+
+// Registers are written whole or through DS3231_UpdateControl() masks, no field table
+static const RegCore_Desc_t ds3231Desc = {
+    .regs = ds3231Regs,
+    .read = DS3231_ReadRegs,
+    .write = DS3231_WriteRegs,
+    .mirror = offsetof(DS3231_Handle_t, Reg),
+    .state = offsetof(DS3231_Handle_t, regState),
+    .count = DS3231_REG_COUNT,
+    .flags = REGCORE_BURST_READ | REGCORE_BURST_WRITE,
+    .maxGap = DS3231_FLUSH_MAX_GAP,
+};
+
+/**
+ * @brief Make sure the mirror holds the alarm, control, status and aging registers
+ * @param handle Pointer to DS3231 handle structure
+ * @return HAL_StatusTypeDef HAL_OK on success, error code otherwise
+ * @details Loads 0x07-0x10 in one burst the first time, so later alarm re-arms can
+ *          merge alarm, control and status writes into a single transaction.
+ */
+static HAL_StatusTypeDef DS3231_EnsureAlarmBlock(DS3231_Handle_t *handle)
+{
+    return RegCore_Ensure(&ds3231Desc, handle, DS3231_REG_ALARM1_SECONDS, DS3231_REG_AGING - DS3231_REG_ALARM1_SECONDS + 1);
+}
+
+/**
+ * @brief Stage a write that clears alarm flags in the status register
+ * @param handle Pointer to DS3231 handle structure
+ * @param flags STATUS_A1F_MASK and/or STATUS_A2F_MASK
+ * @details The flags can only be written to 0, writing 1 leaves them unchanged.
+ *          OSF and the alarm flag not in flags are written as 1 so a stop event
+ *          or the other alarm's pending event is never cleared by accident,
+ *          EN32kHz keeps its mirrored value. Needs a valid status mirror.
+ */
+static void DS3231_StageClearFlags(DS3231_Handle_t *handle, uint8_t flags)
+{
+    uint8_t keep = (uint8_t)((STATUS_A1F_MASK | STATUS_A2F_MASK) & ~flags);
+
+    RegCore_Stage(&ds3231Desc, handle, DS3231_REG_STATUS,
+                  (handle->Reg[DS3231_REG_STATUS] & STATUS_EN32KHZ_MASK) | STATUS_OSF_MASK | keep);
+}
+
+static HAL_StatusTypeDef DS3231_StageTime(DS3231_Handle_t *handle)
 {
+    uint8_t regs[3];
 
-    VALID(DS3231_SetTime(handle));
-    VALID(DS3231_SetDate(handle));
-    VALID(DS3231_SetDOW(handle));
+    VALID(DS3231_EncodeTime(&handle->time, regs));
+    RegCore_StageBytes(&ds3231Desc, handle, DS3231_REG_SECONDS, regs, 3);
     return HAL_OK;
 }
 
-/** Functionality: Set operations for time, day, date, and alarms (Alarm1, Alarm2) **/
+static HAL_StatusTypeDef DS3231_StageDate(DS3231_Handle_t *handle)
+{
+    uint8_t regs[3];
 
+    VALID(DS3231_EncodeDate(&handle->date, regs));
+    RegCore_StageBytes(&ds3231Desc, handle, DS3231_REG_DATE, regs, 3);
+    return HAL_OK;
+}
 
-HAL_StatusTypeDef DS3231_SetTime( DS3231_Handle_t *handle)
+/* ========================== Function Definitions ============================ */
+
+/**
+ * @brief Take register values read outside the driver into the mirror
+ * @param handle Pointer to DS3231 handle structure
+ * @param first First register address
+ * @param regs Register values as read from the chip
+ * @param count Number of registers
+ * @details Registers with staged, unflushed values keep their staged value.
+ *          For callers that read the chip themselves, e.g. asynchronously at boot.
+ */
+void DS3231_LoadRegs(DS3231_Handle_t *handle, uint8_t first, const uint8_t *regs, uint8_t count)
 {
-    HAL_StatusTypeDef status;
-    ds3231_time_t *time = &handle->time;
-    uint8_t *DS3231_Reg = handle->Reg;
+    RegCore_Merge(&ds3231Desc, handle, first, regs, count);
+}
 
-    // Validate the input time values
-    if(time->hours > 23 || time->minutes > 59 || time->seconds > 59) {
-        return HAL_ERROR ;
-    }
-    
-    // Convert BCD format
-    DS3231_Reg[DS3231_REG_SECONDS] = decToBCD(time->seconds);
-    DS3231_Reg[DS3231_REG_MINUTES] = decToBCD(time->minutes);
-    DS3231_Reg[DS3231_REG_HOURS] = decToBCD(time->hours);
-    status = HAL_I2C_Mem_Write(handle->i2c_handle, handle->I2C_address, DS3231_REG_SECONDS, I2C_MEMADD_SIZE_8BIT, DS3231_Reg, 3, HAL_MAX_DELAY);
+HAL_StatusTypeDef DS3231_Init(DS3231_Handle_t *handle) 
+{
+    DRIVER_TRACE_API(handle);
+    DS3231_InvalidateMirror(handle);
+
+    // Time, day and date are adjacent: stage all of them and write one 7-byte burst
+    VALID(DS3231_StageTime(handle));
+    VALID(DS3231_StageDate(handle));
+    RegCore_Stage(&ds3231Desc, handle, DS3231_REG_DAY, handle->dayOfWeek);
+    return RegCore_Flush(&ds3231Desc, handle);
+}
 
-    return status;
+/** Functionality: Set operations for time, day, date, and alarms (Alarm1, Alarm2) **/
+
+
+HAL_StatusTypeDef DS3231_SetTime( DS3231_Handle_t *handle)
+{
+    DRIVER_TRACE_API(handle);
+    VALID(DS3231_StageTime(handle));
+    return RegCore_Flush(&ds3231Desc, handle);
 }
 
 
 HAL_StatusTypeDef DS3231_SetDate( DS3231_Handle_t *handle) {
-    HAL_StatusTypeDef status;
-    ds3231_data_t *date = &handle->date;
-    uint8_t *DS3231_Reg = handle->Reg;
-    // Validate the input date values
-    if(date->date > 31 || date->month < 1 || date->month > 12 || date->year > 99) {
-        return HAL_ERROR;
-    }
-    
-    // Convert BCD format
-    DS3231_Reg[DS3231_REG_DATE] = decToBCD(date->date);
-    DS3231_Reg[DS3231_REG_MONTH] =  decToBCD(date->month);
-    DS3231_Reg[DS3231_REG_YEAR] =decToBCD(date->year);
-
-    status = HAL_I2C_Mem_Write(handle->i2c_handle, handle->I2C_address, DS3231_REG_DATE, I2C_MEMADD_SIZE_8BIT, DS3231_Reg + DS3231_REG_DATE, 3, HAL_MAX_DELAY);
-    return status;
+    DRIVER_TRACE_API(handle);
+    VALID(DS3231_StageDate(handle));
+    return RegCore_Flush(&ds3231Desc, handle);
 }
 
 
 HAL_StatusTypeDef DS3231_SetDOW(DS3231_Handle_t *handle)
 {
-    HAL_StatusTypeDef status;
-    uint8_t *DS3231_Reg = handle->Reg;
-    DS3231_Reg[DS3231_REG_DAY] = handle->dayOfWeek;
-    status = HAL_I2C_Mem_Write(handle->i2c_handle, handle->I2C_address, DS3231_REG_DAY, I2C_MEMADD_SIZE_8BIT, DS3231_Reg + DS3231_REG_DAY, 1, HAL_MAX_DELAY);
-    return status;
-
+    DRIVER_TRACE_API(handle);
+    RegCore_Stage(&ds3231Desc, handle, DS3231_REG_DAY, handle->dayOfWeek);
+    return RegCore_Flush(&ds3231Desc, handle);
 }
 
 
 HAL_StatusTypeDef DS3231_SetAlarm1(sMode_t mode,DS3231_Handle_t *handle) {
+    DRIVER_TRACE_API(handle);
 
-    uint8_t A1M1, A1M2, A1M3, A1M4;
-    uint8_t temp = 0;
-    HAL_StatusTypeDef status;
-    sAlram_t *alarm = &handle->alarm1;
+    uint8_t regs[4];
     uint8_t *DS3231_Reg = handle->Reg;
-    // Validate the input alarm values
-    if(alarm->hours > 23 || alarm->minutes > 59 || alarm->seconds > 59 || (alarm->dayOfWeek < Sunday || alarm->dayOfWeek > Saturday) || alarm->date < 1 || alarm->date > 31) {
-        return HAL_ERROR;
-    }
 
-    switch (mode)
-    {
-
-    case EveryMinute:
-        A1M1 = 0b00000000;
-        A1M2 = 0b10000000;  
-        A1M3 = 0b10000000;
-        A1M4 = 0b10000000;
-
-        DS3231_Reg[DS3231_REG_ALARM1_DAYDATE] = A1M4 ;
-
-    break;
-    case EveryHour:
-        A1M1 = 0b00000000;
-        A1M2 = 0b00000000;
-        A1M3 = 0b10000000;
-        A1M4 = 0b10000000;
-        DS3231_Reg[DS3231_REG_ALARM1_DAYDATE] = A1M4 ;
-    break;
-    case EveryDay:
-        A1M1 = 0b00000000;
-        A1M2 = 0b00000000;  
-        A1M3 = 0b00000000;
-        A1M4 = 0b10000000;
-
-        DS3231_Reg[DS3231_REG_ALARM1_DAYDATE] = A1M4 ;
-    break;
-    case Once:
-        A1M1 = 0b00000000;
-        A1M2 = 0b00000000;
-        A1M3 = 0b00000000;
-        A1M4 = 0b00000000;
-        temp = (alarm->date / 10) << 4;
-        DS3231_Reg[DS3231_REG_ALARM1_DAYDATE] = A1M4 | temp | (alarm->date % 10); // Set the alarm to trigger on a specific date
-    break;
-    case EveryWeek:
-        A1M1 = 0b00000000;
-        A1M2 = 0b00000000;  
-        A1M3 = 0b00000000;
-        A1M4 = 0b00000000;
-        DS3231_Reg[DS3231_REG_ALARM1_DAYDATE] = A1M4 | ALRAM_DAY_MASK | alarm->dayOfWeek; //Set the Alram to trigger on a specific day of the week
-    break;
-    default:
-        break;
-    }
+    // Validate and convert to BCD with the A1Mx mask bits of the mode
+    VALID(DS3231_EncodeAlarm(&handle->alarm1, mode, 1, regs));
 
-    // Convert BCD format
-    DS3231_Reg[DS3231_REG_ALARM1_SECONDS] = A1M1 | decToBCD(alarm->seconds);
-    DS3231_Reg[DS3231_REG_ALARM1_MINUTES] = A1M2 | decToBCD(alarm->minutes);
-    DS3231_Reg[DS3231_REG_ALARM1_HOURS] = A1M3 | decToBCD(alarm->hours);
+    VALID(DS3231_EnsureAlarmBlock(handle));
 
-    // Clear the A1F (Alarm 1 Flag) before setting the alarm
-    DS3231_CLearAlarmsFlags(handle);
-    
-    status = HAL_I2C_Mem_Write(handle->i2c_handle, handle->I2C_address, DS3231_REG_ALARM1_SECONDS, I2C_MEMADD_SIZE_8BIT, DS3231_Reg + DS3231_REG_ALARM1_SECONDS, 4, HAL_MAX_DELAY);
-    if (status != HAL_OK) {
-        return status;
+    // Clear the A1F (Alarm 1 Flag) before enabling the interrupt so INT does not glitch on a stale flag
+    if (!(DS3231_Reg[DS3231_REG_CONTROL] & ALARM1_MASK)) {
+        VALID(DS3231_ClearFlags(handle, STATUS_A1F_MASK));
     }
 
-    DS3231_Reg[DS3231_REG_CONTROL] =  INTR_MODE_MASK |ALARM1_MASK ; // Enable Alarm 1 Interrupt
+    RegCore_StageBytes(&ds3231Desc, handle, DS3231_REG_ALARM1_SECONDS, regs, 4);
 
-    status = HAL_I2C_Mem_Write(handle->i2c_handle, handle->I2C_address, DS3231_REG_CONTROL, I2C_MEMADD_SIZE_8BIT, DS3231_Reg + DS3231_REG_CONTROL, 1, HAL_MAX_DELAY);
-    if (status != HAL_OK) {
-        return status;
-    }
-    return HAL_OK;
+    RegCore_Stage(&ds3231Desc, handle, DS3231_REG_CONTROL, RegCore_Get(&ds3231Desc, handle, DS3231_REG_CONTROL) | INTR_MODE_MASK | ALARM1_MASK); // Enable Alarm 1 Interrupt
+    DS3231_StageClearFlags(handle, STATUS_A1F_MASK); // A pending Alarm 2 stays pending
 
+    // Alarm, control and status registers go out in a single burst
+    return RegCore_Flush(&ds3231Desc, handle);
 }
 
 
 HAL_StatusTypeDef DS3231_SetAlarm2(sMode_t mode ,DS3231_Handle_t *handle) 
 {
-    uint8_t  A2M2, A2M3, A2M4;
-    uint8_t temp = 0;
-    HAL_StatusTypeDef status;
-    sAlram_t *alarm = &handle->alarm2;
+    DRIVER_TRACE_API(handle);
+    uint8_t regs[3];
     uint8_t *DS3231_Reg = handle->Reg;
-    // Validate the input alarm values
-    if(alarm->hours > 23 || alarm->minutes > 59 || (alarm->dayOfWeek < Sunday || alarm->dayOfWeek > Saturday) || alarm->date < 1 || alarm->date > 31) {
-        return HAL_ERROR;
-    }
-    switch (mode)
-    {
-
-    case EveryMinute:
-       
-        A2M2 = 0b10000000;
-        A2M3 = 0b10000000;
-        A2M4 = 0b10000000;
-        DS3231_Reg[DS3231_REG_ALARM2_DAYDATE] = A2M4;
-    break;
-    case EveryHour:
-        A2M2 = 0b00000000;
-        A2M3 = 0b10000000;
-        A2M4 = 0b10000000;
-        DS3231_Reg[DS3231_REG_ALARM2_DAYDATE] = A2M4;
-    break;
-    case EveryDay:
-        
-        A2M2 = 0b00000000;
-        A2M3 = 0b00000000;
-        A2M4 = 0b10000000;
-        DS3231_Reg[DS3231_REG_ALARM2_DAYDATE] = A2M4;
-    break;
-    case Once:
-       
-        A2M2 = 0b00000000;
-        A2M3 = 0b00000000;
-        A2M4 = 0b00000000;
-        temp = (alarm->date / 10) << 4;
-        DS3231_Reg[DS3231_REG_ALARM2_DAYDATE] = A2M4 | temp | (alarm->date % 10);
-    break;
-    case EveryWeek:
-        
-        A2M2 = 0b00000000;
-        A2M3 = 0b00000000;
-        A2M4 = 0b00000000;
-        DS3231_Reg[DS3231_REG_ALARM2_DAYDATE] = A2M4 | ALRAM_DAY_MASK | alarm->dayOfWeek; //Set the Alram to trigger on a specific day of the week
-    break;
-    default:
-        return HAL_ERROR;
-    }
 
-    // Convert BCD format
-    DS3231_Reg[DS3231_REG_ALARM2_MINUTES] = A2M2 | decToBCD(alarm->minutes);
-    DS3231_Reg[DS3231_REG_ALARM2_HOURS] = A2M3 | decToBCD(alarm->hours) ;
+    // Validate and convert to BCD with the A2Mx mask bits of the mode
+    VALID(DS3231_EncodeAlarm(&handle->alarm2, mode, 0, regs));
 
-    // Clear the A2F (Alarm 2 Flag) before setting the alarm
-    DS3231_CLearAlarmsFlags(handle);
-    
-    DS3231_Reg[DS3231_REG_CONTROL] |= INTR_MODE_MASK | ALARM2_MASK; // Enable Alarm 2 & Interrupt mode
-    status = HAL_I2C_Mem_Write(handle->i2c_handle, handle->I2C_address, DS3231_REG_CONTROL, I2C_MEMADD_SIZE_8BIT, DS3231_Reg + DS3231_REG_CONTROL, 1, HAL_MAX_DELAY);
-    if (status != HAL_OK) {
-        return status;
-    }
+    VALID(DS3231_EnsureAlarmBlock(handle));
 
-    status = HAL_I2C_Mem_Write(handle->i2c_handle, handle->I2C_address, DS3231_REG_ALARM2_MINUTES, I2C_MEMADD_SIZE_8BIT, DS3231_Reg + DS3231_REG_ALARM2_MINUTES, 3, HAL_MAX_DELAY);
-    if (status != HAL_OK) {
-        return status;
+    // Clear the A2F (Alarm 2 Flag) before enabling the interrupt so INT does not glitch on a stale flag
+    if (!(DS3231_Reg[DS3231_REG_CONTROL] & ALARM2_MASK)) {
+        VALID(DS3231_ClearFlags(handle, STATUS_A2F_MASK));
     }
-    return HAL_OK;
+
+    RegCore_StageBytes(&ds3231Desc, handle, DS3231_REG_ALARM2_MINUTES, regs, 3);
+
+    RegCore_Stage(&ds3231Desc, handle, DS3231_REG_CONTROL, RegCore_Get(&ds3231Desc, handle, DS3231_REG_CONTROL) | INTR_MODE_MASK | ALARM2_MASK); // Enable Alarm 2 & Interrupt mode
+    DS3231_StageClearFlags(handle, STATUS_A2F_MASK); // A pending Alarm 1 stays pending
+
+    // Alarm, control and status registers go out in a single burst
+    return RegCore_Flush(&ds3231Desc, handle);
 }
 
 
@@ -261,49 +324,32 @@ HAL_StatusTypeDef DS3231_SetAlarm2(sMode_t mode ,DS3231_Handle_t *handle)
 
 
 HAL_StatusTypeDef DS3231_GetTime(DS3231_Handle_t *handle) {
-    HAL_StatusTypeDef status;
-    ds3231_time_t *time = &handle->time;
-    uint8_t *DS3231_Reg = handle->Reg;
-    status = HAL_I2C_Mem_Read(handle->i2c_handle,handle->I2C_address, DS3231_REG_SECONDS, I2C_MEMADD_SIZE_8BIT, DS3231_Reg, 3, HAL_MAX_DELAY);
-    if (status == HAL_OK) {
-        time->seconds = BCDToDec(DS3231_Reg[DS3231_REG_SECONDS]);
-        time ->minutes = BCDToDec(DS3231_Reg[DS3231_REG_MINUTES]);
-        time ->hours = BCDToDec(DS3231_Reg[DS3231_REG_HOURS]);
-        return HAL_OK;
-    }
-    return status;
+    DRIVER_TRACE_API(handle);
+    VALID(RegCore_Load(&ds3231Desc, handle, DS3231_REG_SECONDS, 3));
+    return DS3231_DecodeTime(&handle->Reg[DS3231_REG_SECONDS], &handle->time);
 }
 
 
 HAL_StatusTypeDef DS3231_GetDate(DS3231_Handle_t *handle){
-    HAL_StatusTypeDef status;
-    ds3231_data_t *date = &handle->date;
-    uint8_t *DS3231_Reg = handle->Reg;
-    status = HAL_I2C_Mem_Read(handle->i2c_handle, handle->I2C_address, DS3231_REG_DATE, I2C_MEMADD_SIZE_8BIT, DS3231_Reg + DS3231_REG_DATE, 3, HAL_MAX_DELAY);
-    if (status == HAL_OK) {
-        date->date = BCDToDec(DS3231_Reg[DS3231_REG_DATE]);
-        date->month = BCDToDec(DS3231_Reg[DS3231_REG_MONTH]);
-        date->year = BCDToDec(DS3231_Reg[DS3231_REG_YEAR]);
-        return HAL_OK;
-    }
-    return status;
+    DRIVER_TRACE_API(handle);
+    VALID(RegCore_Load(&ds3231Desc, handle, DS3231_REG_DATE, 3));
+    return DS3231_DecodeDate(&handle->Reg[DS3231_REG_DATE], &handle->date);
 }
 
 
 HAL_StatusTypeDef DS3231_GetControlRegister(DS3231_Handle_t *handle) {
-    HAL_StatusTypeDef status;
-    status = HAL_I2C_Mem_Read(handle->i2c_handle, handle->I2C_address, DS3231_REG_CONTROL, I2C_MEMADD_SIZE_8BIT, &handle->Reg[DS3231_REG_CONTROL], 1, HAL_MAX_DELAY);
-    return status;
+    DRIVER_TRACE_API(handle);
+    return RegCore_Load(&ds3231Desc, handle, DS3231_REG_CONTROL, 1);
 }
 
 
 HAL_StatusTypeDef DS3231_GetDOW( DS3231_Handle_t *handle) {
+    DRIVER_TRACE_API(handle);
     HAL_StatusTypeDef status;
-    DOW_t *dayOfWeek = &handle->dayOfWeek;
     uint8_t *DS3231_Reg = handle->Reg;
-    status = HAL_I2C_Mem_Read(handle->i2c_handle, handle->I2C_address, DS3231_REG_DAY, I2C_MEMADD_SIZE_8BIT, DS3231_Reg + DS3231_REG_DAY, 1, HAL_MAX_DELAY);
+    status = RegCore_Load(&ds3231Desc, handle, DS3231_REG_DAY, 1);
     if (status == HAL_OK) {
-        *dayOfWeek = (DOW_t)(DS3231_Reg[DS3231_REG_DAY]);
+        handle->dayOfWeek = (DOW_t)(DS3231_Reg[DS3231_REG_DAY]);
         return HAL_OK;
     }
     return status;
@@ -312,14 +358,19 @@ HAL_StatusTypeDef DS3231_GetDOW( DS3231_Handle_t *handle) {
 
 HAL_StatusTypeDef DS3231_GetTemp(DS3231_Handle_t *handle)
 {
+    DRIVER_TRACE_API(handle);
     HAL_StatusTypeDef status;
-    float *temperature = &handle->temp;
     uint8_t *DS3231_Reg = handle->Reg;
     int16_t raw_value = 0;
-    status = HAL_I2C_Mem_Read(handle->i2c_handle, handle->I2C_address, DS3231_REG_TEMP_MSB, I2C_MEMADD_SIZE_8BIT, DS3231_Reg + DS3231_REG_TEMP_MSB, 2, HAL_MAX_DELAY);
+    status = RegCore_Load(&ds3231Desc, handle, DS3231_REG_TEMP_MSB, 2);
     if (status == HAL_OK) {
-        raw_value = (int16_t)(DS3231_Reg[DS3231_REG_TEMP_MSB] << 2) | (DS3231_Reg[DS3231_REG_TEMP_LSB] >> 6);
-        *temperature = raw_value / 4.0f;
+        // MSB is the signed integer part, the two top bits of LSB are quarter degrees
+        raw_value = (int16_t)((int8_t)DS3231_Reg[DS3231_REG_TEMP_MSB] * 4) | (DS3231_Reg[DS3231_REG_TEMP_LSB] >> 6);
+#ifdef DS3231_COMPACT_HANDLE
+        handle->temp = raw_value;
+#else
+        handle->temp = raw_value / 4.0f;
+#endif
         return HAL_OK;
     }
     return status;
@@ -328,69 +379,61 @@ HAL_StatusTypeDef DS3231_GetTemp(DS3231_Handle_t *handle)
 
 HAL_StatusTypeDef DS3231_GetAlarm1(DS3231_Handle_t *handle) 
 {
-    HAL_StatusTypeDef status;
-    sAlram_t *alarm = &handle->alarm1;
-    uint8_t *DS3231_Reg = handle->Reg;
-    status = HAL_I2C_Mem_Read(handle->i2c_handle, handle->I2C_address, DS3231_REG_ALARM1_SECONDS, I2C_MEMADD_SIZE_8BIT, DS3231_Reg + DS3231_REG_ALARM1_SECONDS, 4, HAL_MAX_DELAY);
-    if (status == HAL_OK) {
-        alarm->seconds = (DS3231_Reg[DS3231_REG_ALARM1_SECONDS] & 0x0F) + ((DS3231_Reg[DS3231_REG_ALARM1_SECONDS] >> 4) * 10);
-        alarm->minutes = (DS3231_Reg[DS3231_REG_ALARM1_MINUTES] & 0x0F) + ((DS3231_Reg[DS3231_REG_ALARM1_MINUTES] >> 4) * 10);
-        alarm->hours   = (DS3231_Reg[DS3231_REG_ALARM1_HOURS] & 0x0F) + ((DS3231_Reg[DS3231_REG_ALARM1_HOURS] >> 4) * 10);
-        alarm->dayOfWeek = (DOW_t)(DS3231_Reg[DS3231_REG_ALARM1_DAYDATE]);
-        alarm->date = (DS3231_Reg[DS3231_REG_ALARM1_DAYDATE] & 0x0F) + ((DS3231_Reg[DS3231_REG_ALARM1_DAYDATE] >> 4) * 10);
-    }
-    return status;
+    DRIVER_TRACE_API(handle);
+    VALID(RegCore_Load(&ds3231Desc, handle, DS3231_REG_ALARM1_SECONDS, 4));
+    return DS3231_DecodeAlarm(&handle->Reg[DS3231_REG_ALARM1_SECONDS], 1, &handle->alarm1);
 }
 
 
 HAL_StatusTypeDef DS3231_GetAlarm2(DS3231_Handle_t *handle) {
-    HAL_StatusTypeDef status;
-    sAlram_t *alarm = &handle->alarm2;
-    uint8_t *DS3231_Reg = handle->Reg;
-    status = HAL_I2C_Mem_Read(handle->i2c_handle, handle->I2C_address, DS3231_REG_ALARM2_MINUTES, I2C_MEMADD_SIZE_8BIT, DS3231_Reg + DS3231_REG_ALARM2_MINUTES, 3, HAL_MAX_DELAY);
-    if (status == HAL_OK) {
-        alarm->minutes = (DS3231_Reg[DS3231_REG_ALARM2_MINUTES] & 0x0F) + ((DS3231_Reg[DS3231_REG_ALARM2_MINUTES] >> 4) * 10);
-        alarm->hours   = (DS3231_Reg[DS3231_REG_ALARM2_HOURS] & 0x0F) + ((DS3231_Reg[DS3231_REG_ALARM2_HOURS] >> 4) * 10);
-        alarm->dayOfWeek = (DOW_t)(DS3231_Reg[DS3231_REG_ALARM2_DAYDATE]);
-        alarm->date = (DS3231_Reg[DS3231_REG_ALARM2_DAYDATE] & 0x0F) + ((DS3231_Reg[DS3231_REG_ALARM2_DAYDATE] >> 4) * 10);
-        alarm->seconds = 0; // Alarm B does not use seconds, so set it to 0
-        return HAL_OK;
-    }
-    return status;
+    DRIVER_TRACE_API(handle);
+    VALID(RegCore_Load(&ds3231Desc, handle, DS3231_REG_ALARM2_MINUTES, 3));
+    return DS3231_DecodeAlarm(&handle->Reg[DS3231_REG_ALARM2_MINUTES], 0, &handle->alarm2); // Alarm 2 has no seconds, reported as 0
 }
 
 /** Functionality: Read and write operations for status register and clear alarm flags **/
 
 HAL_StatusTypeDef DS3231_ReadStatus(DS3231_Handle_t *handle) {
+    DRIVER_TRACE_API(handle);
 
-    return HAL_I2C_Mem_Read(handle->i2c_handle, handle->I2C_address, DS3231_REG_STATUS,
-                            I2C_MEMADD_SIZE_8BIT, &handle->Reg[DS3231_REG_STATUS], 1, HAL_MAX_DELAY);
+    return RegCore_Load(&ds3231Desc, handle, DS3231_REG_STATUS, 1);
 }
 
 
 HAL_StatusTypeDef DS3231_WriteStatus(DS3231_Handle_t *handle) {
+    DRIVER_TRACE_API(handle);
     
-    return HAL_I2C_Mem_Write(handle->i2c_handle, handle->I2C_address, DS3231_REG_STATUS,
-                             I2C_MEMADD_SIZE_8BIT, &handle->Reg[DS3231_REG_STATUS], 1, HAL_MAX_DELAY);
+    RegCore_Stage(&ds3231Desc, handle, DS3231_REG_STATUS, handle->Reg[DS3231_REG_STATUS]); // Volatile, always written
+    return RegCore_Flush(&ds3231Desc, handle);
 }
 
 
 HAL_StatusTypeDef DS3231_CLearAlarmsFlags(DS3231_Handle_t *handle)
 {
-    uint8_t *st = &handle->Reg[DS3231_REG_STATUS];
-        if (HAL_I2C_Mem_Read(handle->i2c_handle, handle->I2C_address, DS3231_REG_STATUS,I2C_MEMADD_SIZE_8BIT, st, 1, HAL_MAX_DELAY) == HAL_OK) {
-            *st &= ~(1u<<0);  // clear A1F
-            *st &= ~(1u<<1);  // clear A2F
-            HAL_I2C_Mem_Write(handle->i2c_handle, handle->I2C_address, DS3231_REG_STATUS,I2C_MEMADD_SIZE_8BIT, st, 1, HAL_MAX_DELAY);
-        return HAL_OK;
-        }
-    return HAL_ERROR;
+    DRIVER_TRACE_API(handle);
+    return DS3231_ClearFlags(handle, STATUS_A1F_MASK | STATUS_A2F_MASK);
+}
+
+/**
+ * @brief Clear some of the alarm flags
+ * @param handle Pointer to DS3231 handle structure
+ * @param flags STATUS_A1F_MASK and/or STATUS_A2F_MASK, the other flag is left as it is
+ * @return HAL_StatusTypeDef HAL_OK on success, error code otherwise
+ */
+HAL_StatusTypeDef DS3231_ClearFlags(DS3231_Handle_t *handle, uint8_t flags)
+{
+    DRIVER_TRACE_API(handle);
+    // Only the first call reads the status register, later calls are a single write
+    VALID(RegCore_Ensure(&ds3231Desc, handle, DS3231_REG_STATUS, 1));
+    DS3231_StageClearFlags(handle, flags);
+    return RegCore_Flush(&ds3231Desc, handle);
 }
 
 
 /** Functionality: Configure the square wave output or PWM mode **/
 HAL_StatusTypeDef DS3231_OutputPWM( DS3231_Handle_t *handle,uint8_t RS2,uint8_t RS1) 
 {
+    DRIVER_TRACE_API(handle);
     /******************************************************************************
     * Square-Wave Output Frequency Options (when INTCN bit is 0):
     * ----------------------------------------------------
@@ -403,17 +446,432 @@ HAL_StatusTypeDef DS3231_OutputPWM( DS3231_Handle_t *handle,uint8_t RS2,uint8_t
     * ----------------------------------------------------
     ******************************************************************************/
     
-    HAL_StatusTypeDef status;
-    uint8_t *DS3231_Reg = handle->Reg;
     // Validate the input values
-    if(RS1 != 0 && RS1 != 1 && RS2 != 0 && RS2 != 1) {
+    if(RS1 > 1 || RS2 > 1) {
         return HAL_ERROR;
     }
 
-    // Set the control register for PWM output
-    DS3231_Reg[DS3231_REG_CONTROL] &= ~(PWM_MODE_MASK); // Clear INTCN bit
-    DS3231_Reg[DS3231_REG_CONTROL] = (RS1 << 3) | (RS2 << 4); // Set RS1 and RS2 bits
+    // Clear INTCN and set RS1 and RS2, leaving the alarm enables untouched
+    return DS3231_UpdateControl(handle, PWM_MODE_MASK | (1u << 3) | (1u << 4), (RS1 << 3) | (RS2 << 4));
+}
 
-    status = HAL_I2C_Mem_Write(handle->i2c_handle, handle->I2C_address, DS3231_REG_CONTROL, I2C_MEMADD_SIZE_8BIT, DS3231_Reg + DS3231_REG_CONTROL, 1, HAL_MAX_DELAY);
-    return status;
+
+/** Functionality: Register mirror maintenance **/
+
+/**
+ * @brief Read-modify-write the control register through the mirror
+ * @param handle Pointer to DS3231 handle structure
+ * @param mask Bits to change
+ * @param bits New values for the bits in mask
+ * @return HAL_StatusTypeDef HAL_OK on success, error code otherwise
+ * @details No bus traffic at all when the mirror already holds the requested bits.
+ */
+HAL_StatusTypeDef DS3231_UpdateControl(DS3231_Handle_t *handle, uint8_t mask, uint8_t bits)
+{
+    DRIVER_TRACE_API(handle);
+    VALID(DS3231_EnsureAlarmBlock(handle));
+    return RegCore_Update(&ds3231Desc, handle, DS3231_REG_CONTROL, mask, bits);
+}
+
+/**
+ * @brief Write every staged register to the chip
+ * @param handle Pointer to DS3231 handle structure
+ * @return HAL_StatusTypeDef HAL_OK on success, error code otherwise
+ * @details Contiguous dirty registers are written in one burst. Short runs of clean,
+ *          valid, non-volatile registers between two dirty ranges are rewritten with
+ *          their mirrored value so both ranges share a single transaction.
+ *          On error the remaining registers stay dirty and can be flushed again.
+ */
+HAL_StatusTypeDef DS3231_Flush(DS3231_Handle_t *handle)
+{
+    DRIVER_TRACE_API(handle);
+    return RegCore_Flush(&ds3231Desc, handle);
+}
+
+/**
+ * @brief Forget everything the mirror knows about the chip
+ * @param handle Pointer to DS3231 handle structure
+ * @details Call after the DS3231 lost power or was written by someone else.
+ */
+void DS3231_InvalidateMirror(DS3231_Handle_t *handle)
+{
+    RegCore_Invalidate(&ds3231Desc, handle);
+}
+
+
+/** Functionality: Temperature conversion and aging offset trimming **/
+
+/**
+ * @brief Force a temperature conversion
+ * @param handle Pointer to DS3231 handle structure
+ * @return HAL_StatusTypeDef HAL_OK when a conversion is running, HAL_BUSY if the
+ *         TCXO is busy with its own conversion, error code otherwise
+ * @details The chip only refreshes the temperature registers every 64 seconds.
+ *          Poll DS3231_PollTempConv() until it returns HAL_OK (up to DS3231_TEMP_CONV_MAX_US).
+ *          CONV is a strobe bit of the mirror, so later control register flushes
+ *          write it as 0 and do not start another conversion.
+ */
+HAL_StatusTypeDef DS3231_StartTempConv(DS3231_Handle_t *handle)
+{
+    DRIVER_TRACE_API(handle);
+    VALID(DS3231_ReadStatus(handle));
+    if (handle->Reg[DS3231_REG_STATUS] & STATUS_BSY_MASK) {
+        return HAL_BUSY;
+    }
+    VALID(DS3231_EnsureAlarmBlock(handle));
+    return RegCore_Update(&ds3231Desc, handle, DS3231_REG_CONTROL, CONV_MASK, CONV_MASK);
+}
+
+/**
+ * @brief Check whether a forced temperature conversion has finished
+ * @param handle Pointer to DS3231 handle structure
+ * @return HAL_StatusTypeDef HAL_BUSY while converting, HAL_OK once handle->temp
+ *         holds the new reading, error code otherwise
+ */
+HAL_StatusTypeDef DS3231_PollTempConv(DS3231_Handle_t *handle)
+{
+    DRIVER_TRACE_API(handle);
+    HAL_StatusTypeDef status;
+#ifdef DRIVERS_DCACHE
+    uint8_t* control = &handle->control;
+#else
+    uint8_t  controlByte;
+    uint8_t* control = &controlByte;
+#endif
+
+    // Read outside the mirror so the transient CONV bit never ends up in it
+    status = DS3231_ReadRegs(handle, DS3231_REG_CONTROL, control, 1);
+    if (status != HAL_OK) {
+        return status;
+    }
+    if (*control & CONV_MASK) {
+        return HAL_BUSY;
+    }
+    return DS3231_GetTemp(handle);
+}
+
+/**
+ * @brief Write the aging offset register
+ * @param handle Pointer to DS3231 handle structure
+ * @param offset Two's complement trim, positive values slow the oscillator down
+ * @return HAL_StatusTypeDef HAL_OK on success, error code otherwise
+ * @details The new value takes effect at the next temperature conversion, call
+ *          DS3231_StartTempConv() to apply it immediately.
+ */
+HAL_StatusTypeDef DS3231_SetAgingOffset(DS3231_Handle_t *handle, int8_t offset)
+{
+    DRIVER_TRACE_API(handle);
+    RegCore_Stage(&ds3231Desc, handle, DS3231_REG_AGING, (uint8_t)offset);
+    return RegCore_Flush(&ds3231Desc, handle);
+}
+
+/**
+ * @brief Read the aging offset register
+ * @param handle Pointer to DS3231 handle structure
+ * @param offset Output two's complement trim value
+ * @return HAL_StatusTypeDef HAL_OK on success, error code otherwise
+ */
+HAL_StatusTypeDef DS3231_GetAgingOffset(DS3231_Handle_t *handle, int8_t *offset)
+{
+    DRIVER_TRACE_API(handle);
+    VALID(RegCore_Load(&ds3231Desc, handle, DS3231_REG_AGING, 1));
+    *offset = (int8_t)handle->Reg[DS3231_REG_AGING];
+    return HAL_OK;
+}
+
+/**
+ * @brief Reset a drift compensation loop
+ * @param drift Pointer to drift state
+ * @param minWindow Reference seconds to observe at least before each adjustment. The
+ *        RTC only resolves whole seconds, so a smaller drift keeps the window open
+ *        until it adds up to more than a second: with one day, 12 ppm are corrected
+ *        after a day and 1.2 ppm after about ten.
+ */
+void DS3231_DriftInit(DS3231_Drift_t *drift, uint32_t minWindow)
+{
+    memset(drift, 0, sizeof(*drift));
+    drift->minWindow = minWindow;
+}
+
+/**
+ * @brief Compare the RTC against a reference time and trim the aging offset
+ * @param handle Pointer to DS3231 handle structure
+ * @param drift Pointer to drift state
+ * @param refSeconds Current reference time in seconds (GPS, NTP, ...), any epoch
+ * @return HAL_StatusTypeDef HAL_OK on success, error code otherwise
+ * @details Call whenever a reference time is available. The first call opens the
+ *          measurement window. Once minWindow reference seconds have passed, the
+ *          drift is measured, the aging offset is moved by at most
+ *          DS3231_DRIFT_MAX_STEP LSBs to cancel it, a conversion is forced so the
+ *          trim applies right away, and a new window starts.
+ *          A drift of one second or less is within the measurement error: the
+ *          offset is left untouched and the window stays open, so the drift keeps
+ *          adding up over the following calls until it can be measured.
+ */
+HAL_StatusTypeDef DS3231_DriftUpdate(DS3231_Handle_t *handle, DS3231_Drift_t *drift, uint32_t refSeconds)
+{
+    DRIVER_TRACE_API(handle);
+    HAL_StatusTypeDef status;
+    uint32_t rtcNow;
+    int8_t aging;
+
+    VALID(DS3231_GetTime(handle));
+    VALID(DS3231_GetDate(handle));
+    rtcNow = DS3231_ToSeconds(&handle->date, &handle->time);
+
+    if (!drift->started) {
+        drift->refStart = refSeconds;
+        drift->rtcStart = rtcNow;
+        drift->started = 1;
+        return HAL_OK;
+    }
+
+    uint32_t refElapsed = refSeconds - drift->refStart;
+    if (refElapsed < drift->minWindow || refElapsed == 0) {
+        return HAL_OK;
+    }
+    int32_t driftSeconds = (int32_t)((rtcNow - drift->rtcStart) - refElapsed);
+    drift->driftPpb = (int32_t)(((int64_t)driftSeconds * 1000000000LL) / (int64_t)refElapsed);
+
+    if (driftSeconds >= -1 && driftSeconds <= 1) {
+        return HAL_OK; // Within the measurement error: keep the window open until the drift adds up
+    }
+    drift->refStart = refSeconds;
+    drift->rtcStart = rtcNow;
+
+    // A fast RTC needs a larger offset to slow the oscillator down
+    int32_t step = drift->driftPpb / DS3231_AGING_PPB_PER_LSB;
+    if (step > DS3231_DRIFT_MAX_STEP) {
+        step = DS3231_DRIFT_MAX_STEP;
+    } else if (step < -DS3231_DRIFT_MAX_STEP) {
+        step = -DS3231_DRIFT_MAX_STEP;
+    }
+    VALID(DS3231_GetAgingOffset(handle, &aging));
+    int32_t trimmed = aging + step;
+    if (trimmed > 127) {
+        trimmed = 127;
+    } else if (trimmed < -128) {
+        trimmed = -128;
+    }
+    VALID(DS3231_SetAgingOffset(handle, (int8_t)trimmed));
+
+    status = DS3231_StartTempConv(handle);
+    return (status == HAL_BUSY) ? HAL_OK : status; // A busy TCXO applies the new offset on its own
+}
+
+
+/** Functionality: BCD codec for register images **/
+
+/**
+ * @brief Encode a time of day into the seconds, minutes and hours registers
+ * @param time Time in 24-hour format
+ * @param regs Output image of registers 0x00-0x02
+ * @return HAL_StatusTypeDef HAL_OK on success, HAL_ERROR if a field is out of range
+ */
+HAL_StatusTypeDef DS3231_EncodeTime(const ds3231_time_t *time, uint8_t *regs)
+{
+    if(time->hours > 23 || time->minutes > 59 || time->seconds > 59) {
+        return HAL_ERROR;
+    }
+    regs[0] = binToBcd[time->seconds];
+    regs[1] = binToBcd[time->minutes];
+    regs[2] = binToBcd[time->hours]; // 24-hour mode, bit 6 cleared
+    return HAL_OK;
+}
+
+/**
+ * @brief Decode the seconds, minutes and hours registers
+ * @param regs Image of registers 0x00-0x02
+ * @param time Output time in 24-hour format, left untouched on error
+ * @return HAL_StatusTypeDef HAL_OK on success, HAL_ERROR on a non-BCD or out of range field
+ * @details Each field table maps malformed BCD and out of range values to
+ *          DS3231_BCD_INVALID, so one test covers the whole image. Hours
+ *          written in 12-hour mode by other firmware are converted to 24-hour.
+ */
+HAL_StatusTypeDef DS3231_DecodeTime(const uint8_t *regs, ds3231_time_t *time)
+{
+    uint8_t seconds = secMinToBin[regs[0] & 0x7F];
+    uint8_t minutes = secMinToBin[regs[1] & 0x7F];
+    uint8_t hours = hoursToBin[regs[2] & 0x7F];
+    if ((seconds | minutes | hours) & 0x80) {
+        return HAL_ERROR;
+    }
+    time->seconds = seconds;
+    time->minutes = minutes;
+    time->hours = hours;
+    return HAL_OK;
+}
+
+/**
+ * @brief Encode a date into the date, month and year registers
+ * @param date Date, year 0-99 maps to 2000-2099
+ * @param regs Output image of registers 0x04-0x06
+ * @return HAL_StatusTypeDef HAL_OK on success, HAL_ERROR if a field is out of range
+ */
+HAL_StatusTypeDef DS3231_EncodeDate(const ds3231_data_t *date, uint8_t *regs)
+{
+    if(date->date < 1 || date->date > 31 || date->month < 1 || date->month > 12 || date->year > 99) {
+        return HAL_ERROR;
+    }
+    regs[0] = binToBcd[date->date];
+    regs[1] = binToBcd[date->month]; // Century bit cleared
+    regs[2] = binToBcd[date->year];
+    return HAL_OK;
+}
+
+/**
+ * @brief Decode the date, month and year registers
+ * @param regs Image of registers 0x04-0x06
+ * @param date Output date, left untouched on error
+ * @return HAL_StatusTypeDef HAL_OK on success, HAL_ERROR on a non-BCD or out of range field
+ */
+HAL_StatusTypeDef DS3231_DecodeDate(const uint8_t *regs, ds3231_data_t *date)
+{
+    uint8_t day = dateToBin[regs[0] & 0x3F];
+    uint8_t month = monthToBin[regs[1] & 0x1F];
+    uint8_t year = bcdToBin[regs[2]];
+    if ((day | month | year) & 0x80) {
+        return HAL_ERROR;
+    }
+    date->date = day;
+    date->month = month;
+    date->year = year;
+    return HAL_OK;
+}
+
+/**
+ * @brief Encode an alarm and its trigger mode into alarm registers
+ * @param alarm Alarm time, day of week and date
+ * @param mode Trigger mode, selects the AxMx mask bits
+ * @param withSeconds 1 for Alarm 1 (4 registers from seconds), 0 for Alarm 2 (3 registers from minutes)
+ * @param regs Output register image
+ * @return HAL_StatusTypeDef HAL_OK on success, HAL_ERROR if a field or the mode is out of range
+ */
+HAL_StatusTypeDef DS3231_EncodeAlarm(const sAlram_t *alarm, sMode_t mode, uint8_t withSeconds, uint8_t *regs)
+{
+    if(alarm->hours > 23 || alarm->minutes > 59 || (withSeconds && alarm->seconds > 59) ||
+       alarm->dayOfWeek < Sunday || alarm->dayOfWeek > Saturday || alarm->date < 1 || alarm->date > 31 ||
+       mode < EveryMinute || mode > EveryWeek) {
+        return HAL_ERROR;
+    }
+
+    uint8_t masks = alarmMaskBits[mode];
+    uint8_t dayDate;
+    if (masks & 0x08) {
+        dayDate = 0x80; // Day/date ignored
+    } else if (mode == EveryWeek) {
+        dayDate = ALRAM_DAY_MASK | alarm->dayOfWeek; // Trigger on a specific day of the week
+    } else {
+        dayDate = binToBcd[alarm->date]; // Trigger on a specific date
+    }
+
+    if (withSeconds) {
+        *regs++ = ((masks & 0x01) << 7) | binToBcd[alarm->seconds];
+    }
+    regs[0] = ((masks & 0x02) << 6) | binToBcd[alarm->minutes];
+    regs[1] = ((masks & 0x04) << 5) | binToBcd[alarm->hours];
+    regs[2] = dayDate;
+    return HAL_OK;
+}
+
+/**
+ * @brief Decode alarm registers
+ * @param regs Register image, from seconds for Alarm 1 or from minutes for Alarm 2
+ * @param withSeconds 1 for Alarm 1, 0 for Alarm 2 (seconds reported as 0)
+ * @param alarm Output alarm; depending on the DY/DT bit only dayOfWeek or date is updated
+ * @return HAL_StatusTypeDef HAL_OK on success, HAL_ERROR on a non-BCD or out of range field
+ */
+HAL_StatusTypeDef DS3231_DecodeAlarm(const uint8_t *regs, uint8_t withSeconds, sAlram_t *alarm)
+{
+    uint8_t seconds = 0;
+    if (withSeconds) {
+        seconds = secMinToBin[*regs++ & 0x7F];
+    }
+    uint8_t minutes = secMinToBin[regs[0] & 0x7F];
+    uint8_t hours = hoursToBin[regs[1] & 0x7F];
+    uint8_t dayDate = regs[2];
+    if ((seconds | minutes | hours) & 0x80) {
+        return HAL_ERROR;
+    }
+
+    if (dayDate & ALRAM_DAY_MASK) {
+        uint8_t dow = dayDate & 0x0F;
+        if ((uint8_t)(dow - 1) > 6) {
+            return HAL_ERROR;
+        }
+        alarm->dayOfWeek = (DOW_t)dow;
+    } else if (!(dayDate & 0x80)) {
+        uint8_t date = dateToBin[dayDate & 0x3F];
+        if (date & 0x80) {
+            return HAL_ERROR;
+        }
+        alarm->date = date;
+    }
+    alarm->seconds = seconds;
+    alarm->minutes = minutes;
+    alarm->hours = hours;
+    return HAL_OK;
+}
+
+
+/** Functionality: Conversion between calendar time and a linear seconds counter **/
+
+/**
+ * @brief Convert a date and time to seconds elapsed since 01/01/2000 00:00:00
+ * @param date Date (year 0-99 maps to 2000-2099)
+ * @param time Time of day in 24-hour format
+ * @return uint32_t Seconds since 01/01/2000 00:00:00
+ * @details The DS3231 only covers 2000-2099, so every year divisible by 4 is a leap year.
+ */
+uint32_t DS3231_ToSeconds(const ds3231_data_t *date, const ds3231_time_t *time)
+{
+    uint32_t year = date->year;
+    uint32_t days = year * 365u + (year + 3u) / 4u; // Leap days in the years before this one
+    days += daysBeforeMonth[(date->month - 1u) % 12u];
+    if ((year % 4u) == 0u && date->month > 2) {
+        days++;
+    }
+    days += date->date - 1u;
+    return ((days * 24u + time->hours) * 60u + time->minutes) * 60u + time->seconds;
+}
+
+/**
+ * @brief Convert seconds elapsed since 01/01/2000 00:00:00 back to a date and time
+ * @param seconds Seconds since 01/01/2000 00:00:00
+ * @param date Output date, may be NULL
+ * @param time Output time of day, may be NULL
+ * @param dayOfWeek Output day of the week, may be NULL
+ */
+void DS3231_FromSeconds(uint32_t seconds, ds3231_data_t *date, ds3231_time_t *time, DOW_t *dayOfWeek)
+{
+    uint32_t days = seconds / 86400u;
+    uint32_t rem = seconds % 86400u;
+
+    if (time != NULL) {
+        time->hours = (uint8_t)(rem / 3600u);
+        time->minutes = (uint8_t)((rem % 3600u) / 60u);
+        time->seconds = (uint8_t)(rem % 60u);
+    }
+    if (dayOfWeek != NULL) {
+        *dayOfWeek = (DOW_t)(((days + 6u) % 7u) + 1u); // 01/01/2000 was a Saturday
+    }
+    if (date != NULL) {
+        // Every 4-year block starts with a leap year and holds 1461 days
+        uint32_t year = (days / 1461u) * 4u;
+        days %= 1461u;
+        if (days >= 366u) {
+            days -= 366u;
+            year += 1u + days / 365u;
+            days %= 365u;
+        }
+        uint8_t leap = (year % 4u) == 0u;
+        uint8_t month = 12;
+        while (month > 1 && days < daysBeforeMonth[month - 1] + ((leap && month > 2) ? 1u : 0u)) {
+            month--;
+        }
+        days -= daysBeforeMonth[month - 1] + ((leap && month > 2) ? 1u : 0u);
+        date->year = (uint8_t)year;
+        date->month = month;
+        date->date = (uint8_t)(days + 1u);
+    }
 }
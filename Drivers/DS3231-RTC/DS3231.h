@@ -1,6 +1,11 @@
 #ifndef DS3231_H
 #define DS3231_H
 #include "main.h"
+#include "RegCore.h"
+#include "DmaCache.h"
+#ifdef USE_I2CBUS
+#include "I2CBus.h"
+#endif
 
 
 
@@ -31,6 +36,47 @@
 #define ALARM1_MASK 0b00000001 // Alarm 1 Interrupt enable 
 #define ALARM2_MASK 0b00000010 // Alarm 2 Interrupt enable
 #define PWM_MODE_MASK 0b00000100 // PWM mode for SQW pin
+#define CONV_MASK 0b00100000 // Force a temperature conversion, cleared by the chip when done
+#define STATUS_A1F_MASK 0b00000001 // Alarm 1 flag
+#define STATUS_A2F_MASK 0b00000010 // Alarm 2 flag
+#define STATUS_BSY_MASK 0b00000100 // TCXO function busy
+#define STATUS_EN32KHZ_MASK 0b00001000 // 32kHz output enable
+#define STATUS_OSF_MASK 0b10000000 // Oscillator stop flag
+#define HOURS_12H_MASK 0b01000000 // Hours register in 12-hour mode
+#define HOURS_PM_MASK 0b00100000 // PM in 12-hour mode
+
+/************************ Timing defines ********************************/
+#define DS3231_TEMP_CONV_MAX_US 200000 // tCONV maximum of a forced temperature conversion
+#ifndef DS3231_I2C_TIMEOUT
+#define DS3231_I2C_TIMEOUT 10 // HAL timeout of the blocking transfers without USE_I2CBUS, ms
+#endif
+
+/************************ Register Mirror defines ********************************/
+#define DS3231_REG_COUNT 19
+#define DS3231_REG_BIT(reg) REGCORE_BIT(reg)
+// Registers the chip changes on its own: never trusted from the mirror, always written when staged
+#define DS3231_VOLATILE_REGS (DS3231_REG_BIT(DS3231_REG_SECONDS) | DS3231_REG_BIT(DS3231_REG_MINUTES) | \
+                              DS3231_REG_BIT(DS3231_REG_HOURS) | DS3231_REG_BIT(DS3231_REG_DAY) | \
+                              DS3231_REG_BIT(DS3231_REG_DATE) | DS3231_REG_BIT(DS3231_REG_MONTH) | \
+                              DS3231_REG_BIT(DS3231_REG_YEAR) | DS3231_REG_BIT(DS3231_REG_STATUS) | \
+                              DS3231_REG_BIT(DS3231_REG_TEMP_MSB) | DS3231_REG_BIT(DS3231_REG_TEMP_LSB))
+#ifndef DS3231_FLUSH_MAX_GAP
+#define DS3231_FLUSH_MAX_GAP 3 // Clean registers a flush may rewrite to merge two dirty ranges into one burst
+#endif
+
+/************************ Drift Compensation defines ********************************/
+#define DS3231_AGING_PPB_PER_LSB 100 // Typical frequency change per aging LSB at 25C
+#ifndef DS3231_DRIFT_MAX_STEP
+#define DS3231_DRIFT_MAX_STEP 20 // Largest aging offset change applied by one drift update
+#endif
+
+/************************ Handle Layout ********************************/
+// Define DS3231_COMPACT_HANDLE (or DRIVERS_COMPACT_HANDLES for every driver) on
+// memory-constrained targets: day-of-week fields take one byte, the temperature
+// is kept in 0.25 degC steps instead of float and padding is removed.
+#if defined(DRIVERS_COMPACT_HANDLES) && !defined(DS3231_COMPACT_HANDLE)
+#define DS3231_COMPACT_HANDLE
+#endif
 
 /************************ Driver Structs ********************************/
 typedef struct {
@@ -55,11 +101,17 @@ typedef enum {
     Saturday = 7
 }DOW_t;
 
+#ifdef DS3231_COMPACT_HANDLE
+typedef uint8_t ds3231_dow_t; // DOW_t stored in one byte
+#else
+typedef DOW_t ds3231_dow_t;
+#endif
+
 typedef struct {
     uint8_t hours;    // 0-23
     uint8_t minutes;  // 0-59
     uint8_t seconds;  // 0-59
-    DOW_t dayOfWeek;  // Day of the week
+    ds3231_dow_t dayOfWeek;  // Day of the week
     uint8_t date;     // Date
 }sAlram_t;
 
@@ -71,17 +123,55 @@ typedef enum {
     EveryWeek = 5,
 }sMode_t;
 
+#ifdef DS3231_COMPACT_HANDLE
 typedef struct {
     I2C_HandleTypeDef* i2c_handle;
+#ifdef USE_I2CBUS
+    I2CBus_Client_t* bus_client; // Transfers go through the bus manager instead of i2c_handle
+#endif
+    RegCore_State_t regState; // Valid and dirty bit per register
+    DMACACHE_REGION(RegLines, uint8_t Reg[DS3231_REG_COUNT]); // Register mirror, DMA source and destination
+    uint8_t I2C_address;
+    ds3231_time_t time;
+    ds3231_data_t date;
+    ds3231_dow_t dayOfWeek;
+    sAlram_t alarm1;
+    sAlram_t alarm2;
+    int16_t temp; // 0.25 degC
+#ifdef DRIVERS_DCACHE
+    // Control register read in DS3231_PollTempConv(), kept off the stack for DMA
+    DMACACHE_REGION(controlLines, uint8_t control);
+#endif
+} DS3231_Handle_t;
+#else
+typedef struct {
+    I2C_HandleTypeDef* i2c_handle;
+#ifdef USE_I2CBUS
+    I2CBus_Client_t* bus_client; // Transfers go through the bus manager instead of i2c_handle
+#endif
     uint8_t I2C_address;
     ds3231_time_t time;
     ds3231_data_t date;
     DOW_t dayOfWeek;
-    uint8_t Reg[19]; // Register buffer
+    DMACACHE_REGION(RegLines, uint8_t Reg[DS3231_REG_COUNT]); // Register mirror, DMA source and destination
+    RegCore_State_t regState; // Valid and dirty bit per register
     sAlram_t alarm1;
     sAlram_t alarm2;
     float temp;
+#ifdef DRIVERS_DCACHE
+    // Control register read in DS3231_PollTempConv(), kept off the stack for DMA
+    DMACACHE_REGION(controlLines, uint8_t control);
+#endif
 } DS3231_Handle_t;
+#endif
+
+typedef struct {
+    uint32_t refStart;  // Reference time at the start of the window, seconds
+    uint32_t rtcStart;  // RTC time at the start of the window, seconds since 01/01/2000
+    uint32_t minWindow; // Reference seconds to observe before adjusting the aging offset
+    int32_t driftPpb;   // Last measured drift, positive when the RTC runs fast
+    uint8_t started;
+} DS3231_Drift_t;
 
 /*------------------- Function Prototypes ---------------------------*/
 HAL_StatusTypeDef DS3231_Init(DS3231_Handle_t *handle) ;
@@ -101,10 +191,30 @@ HAL_StatusTypeDef DS3231_ReadStatus(DS3231_Handle_t *handle);
 HAL_StatusTypeDef DS3231_WriteStatus(DS3231_Handle_t *handle);
 HAL_StatusTypeDef DS3231_OutputPWM( DS3231_Handle_t *handle,uint8_t RS2,uint8_t RS1) ;
 HAL_StatusTypeDef DS3231_CLearAlarmsFlags(DS3231_Handle_t *handle);
+HAL_StatusTypeDef DS3231_ClearFlags(DS3231_Handle_t *handle, uint8_t flags);
+HAL_StatusTypeDef DS3231_UpdateControl(DS3231_Handle_t *handle, uint8_t mask, uint8_t bits);
+HAL_StatusTypeDef DS3231_Flush(DS3231_Handle_t *handle);
+void DS3231_InvalidateMirror(DS3231_Handle_t *handle);
+void DS3231_LoadRegs(DS3231_Handle_t *handle, uint8_t first, const uint8_t *regs, uint8_t count);
+HAL_StatusTypeDef DS3231_StartTempConv(DS3231_Handle_t *handle);
+HAL_StatusTypeDef DS3231_PollTempConv(DS3231_Handle_t *handle);
+HAL_StatusTypeDef DS3231_SetAgingOffset(DS3231_Handle_t *handle, int8_t offset);
+HAL_StatusTypeDef DS3231_GetAgingOffset(DS3231_Handle_t *handle, int8_t *offset);
+void DS3231_DriftInit(DS3231_Drift_t *drift, uint32_t minWindow);
+HAL_StatusTypeDef DS3231_DriftUpdate(DS3231_Handle_t *handle, DS3231_Drift_t *drift, uint32_t refSeconds);
+HAL_StatusTypeDef DS3231_EncodeTime(const ds3231_time_t *time, uint8_t *regs);
+HAL_StatusTypeDef DS3231_DecodeTime(const uint8_t *regs, ds3231_time_t *time);
+HAL_StatusTypeDef DS3231_EncodeDate(const ds3231_data_t *date, uint8_t *regs);
+HAL_StatusTypeDef DS3231_DecodeDate(const uint8_t *regs, ds3231_data_t *date);
+HAL_StatusTypeDef DS3231_EncodeAlarm(const sAlram_t *alarm, sMode_t mode, uint8_t withSeconds, uint8_t *regs);
+HAL_StatusTypeDef DS3231_DecodeAlarm(const uint8_t *regs, uint8_t withSeconds, sAlram_t *alarm);
+uint32_t DS3231_ToSeconds(const ds3231_data_t *date, const ds3231_time_t *time);
+void DS3231_FromSeconds(uint32_t seconds, ds3231_data_t *date, ds3231_time_t *time, DOW_t *dayOfWeek);
 
 /*------------------- Macros ---------------------------*/
 #define VALID(x) if((x) != HAL_OK) { return HAL_ERROR; }
 #define decToBCD(value) (((value / 10) << 4) | (value % 10))
 #define BCDToDec(value) (((value >> 4) * 10) + (value & 0x0F))
+#define DS3231_BCD_INVALID 0xFF // Decoded value of a byte that is not valid BCD
 
 #endif
\ No newline at end of file
@@ -0,0 +1,270 @@
+#include "DS3231_Sched.h"
+#include <string.h>
+#ifdef DRIVER_TRACE
+#include "DriverTrace.h"
+#else
+#define DRIVER_TRACE_API(handle)
+#endif
+
+/**
+ ******************************************************************************
+ * @file    DS3231_Sched.c
+ * @author  Yair Yamin
+ * @brief   Software alarm multiplexer on top of the DS3231 Alarm 1.
+ * @details The DS3231 has only two hardware alarms. This module keeps an
+ * arbitrary number of pending wakeups in a min-heap ordered by due time and
+ * always programs the nearest one into Alarm 1, so the MCU can sleep until
+ * the INT/SQW pin fires and then service every task that became due.
+ *
+ * Usage:
+ * - Call DS3231_Sched_IRQHandler() from the EXTI callback of the INT/SQW pin.
+ * - Call DS3231_Sched_Process() from the main loop after waking up; it runs
+ *   the due callbacks, re-schedules periodic entries and re-arms Alarm 1.
+ *
+ * Adding or cancelling an entry costs O(log n) heap operations plus at most
+ * one Alarm 1 write when the nearest wakeup changes. Alarm 2 stays with the
+ * application: the scheduler only ever clears A1F, so an Alarm 2 event on the
+ * shared INT/SQW pin is still pending after DS3231_Sched_Process().
+ ******************************************************************************
+ */
+
+/* ========================== Defines ============================ */
+// count and the entry ids are bytes; ids must outnumber the entries so a free one is always found
+_Static_assert(DS3231_SCHED_MAX_TASKS >= 1 && DS3231_SCHED_MAX_TASKS <= 255, "DS3231_SCHED_MAX_TASKS must be 1-255");
+
+/* ========================== Static Helpers ============================ */
+
+static void DS3231_Sched_Swap(DS3231_SchedEntry_t *a, DS3231_SchedEntry_t *b)
+{
+    DS3231_SchedEntry_t tmp = *a;
+    *a = *b;
+    *b = tmp;
+}
+
+static void DS3231_Sched_SiftUp(DS3231_Sched_t *sched, uint16_t idx)
+{
+    while (idx > 0) {
+        uint16_t parent = (uint16_t)((idx - 1) / 2);
+        if (sched->heap[parent].due <= sched->heap[idx].due) {
+            break;
+        }
+        DS3231_Sched_Swap(&sched->heap[parent], &sched->heap[idx]);
+        idx = parent;
+    }
+}
+
+static void DS3231_Sched_SiftDown(DS3231_Sched_t *sched, uint16_t idx)
+{
+    for (;;) {
+        uint16_t left = (uint16_t)(2 * idx + 1); // Wider than count, cannot wrap back into the heap
+        uint16_t right = (uint16_t)(left + 1);
+        uint16_t smallest = idx;
+        if (left < sched->count && sched->heap[left].due < sched->heap[smallest].due) {
+            smallest = left;
+        }
+        if (right < sched->count && sched->heap[right].due < sched->heap[smallest].due) {
+            smallest = right;
+        }
+        if (smallest == idx) {
+            break;
+        }
+        DS3231_Sched_Swap(&sched->heap[smallest], &sched->heap[idx]);
+        idx = smallest;
+    }
+}
+
+static void DS3231_Sched_RemoveAt(DS3231_Sched_t *sched, uint16_t idx)
+{
+    sched->count--;
+    if (idx == sched->count) {
+        return;
+    }
+    sched->heap[idx] = sched->heap[sched->count];
+    DS3231_Sched_SiftUp(sched, idx);
+    DS3231_Sched_SiftDown(sched, idx);
+}
+
+static int DS3231_Sched_Find(DS3231_Sched_t *sched, uint8_t id)
+{
+    for (uint8_t i = 0; i < sched->count; i++) {
+        if (sched->heap[i].id == id) {
+            return i;
+        }
+    }
+    return -1;
+}
+
+static HAL_StatusTypeDef DS3231_Sched_Now(DS3231_Sched_t *sched, uint32_t *now)
+{
+    VALID(DS3231_GetTime(sched->rtc));
+    VALID(DS3231_GetDate(sched->rtc));
+    *now = DS3231_ToSeconds(&sched->rtc->date, &sched->rtc->time);
+    return HAL_OK;
+}
+
+/**
+ * @brief Program the nearest due time into Alarm 1
+ * @param sched Pointer to scheduler
+ * @return HAL_StatusTypeDef HAL_OK on success, error code otherwise
+ * @details Skips the bus entirely when Alarm 1 already holds the nearest wakeup.
+ *          If the due time passed while arming, the scheduler is marked pending
+ *          so the next DS3231_Sched_Process() call services it without waiting
+ *          for an interrupt that would otherwise only come a month later.
+ */
+static HAL_StatusTypeDef DS3231_Sched_Arm(DS3231_Sched_t *sched)
+{
+    DS3231_Handle_t *rtc = sched->rtc;
+    uint32_t now;
+
+    if (sched->count == 0) {
+        sched->armedValid = 0;
+        return DS3231_UpdateControl(rtc, ALARM1_MASK, 0); // Nothing pending, disable Alarm 1 interrupt
+    }
+
+    if (sched->armedValid && sched->armed == sched->heap[0].due) {
+        return HAL_OK;
+    }
+
+    ds3231_time_t time;
+    ds3231_data_t date;
+    DOW_t dayOfWeek;
+    DS3231_FromSeconds(sched->heap[0].due, &date, &time, &dayOfWeek);
+    rtc->alarm1.dayOfWeek = dayOfWeek;
+    rtc->alarm1.hours = time.hours;
+    rtc->alarm1.minutes = time.minutes;
+    rtc->alarm1.seconds = time.seconds;
+    rtc->alarm1.date = date.date;
+    VALID(DS3231_SetAlarm1(Once, rtc));
+    sched->armed = sched->heap[0].due;
+    sched->armedValid = 1;
+
+    VALID(DS3231_Sched_Now(sched, &now));
+    if (now >= sched->armed) {
+        sched->pending = 1;
+    }
+    return HAL_OK;
+}
+
+/* ========================== Function Definitions ============================ */
+
+/**
+ * @brief Initialize an empty scheduler bound to a DS3231 handle
+ * @param sched Pointer to scheduler
+ * @param rtc Pointer to an initialized DS3231 handle, Alarm 1 is reserved for the scheduler
+ * @return HAL_StatusTypeDef HAL_OK on success, HAL_ERROR on invalid arguments
+ */
+HAL_StatusTypeDef DS3231_Sched_Init(DS3231_Sched_t *sched, DS3231_Handle_t *rtc)
+{
+    DRIVER_TRACE_API(rtc);
+    if (sched == NULL || rtc == NULL) {
+        return HAL_ERROR;
+    }
+    memset(sched, 0, sizeof(*sched));
+    sched->rtc = rtc;
+    return HAL_OK;
+}
+
+/**
+ * @brief Schedule a wakeup
+ * @param sched Pointer to scheduler
+ * @param delay Seconds from now until the first wakeup
+ * @param period Interval in seconds for periodic wakeups, 0 for a one-shot wakeup
+ * @param callback Function called from DS3231_Sched_Process() when the wakeup is due
+ * @param ctx User pointer passed to the callback
+ * @param id Output identifier usable with DS3231_Sched_Cancel(), may be NULL
+ * @return HAL_StatusTypeDef HAL_OK on success, HAL_BUSY if the heap is full, error code otherwise
+ */
+HAL_StatusTypeDef DS3231_Sched_Add(DS3231_Sched_t *sched, uint32_t delay, uint32_t period, DS3231_SchedCallback_t callback, void *ctx, uint8_t *id)
+{
+    DRIVER_TRACE_API(sched->rtc);
+    uint32_t now;
+
+    if (callback == NULL) {
+        return HAL_ERROR;
+    }
+    if (sched->count >= DS3231_SCHED_MAX_TASKS) {
+        return HAL_BUSY;
+    }
+    VALID(DS3231_Sched_Now(sched, &now));
+
+    // Pick the next identifier that is not in use
+    while (DS3231_Sched_Find(sched, sched->nextId) >= 0) {
+        sched->nextId++;
+    }
+
+    DS3231_SchedEntry_t *entry = &sched->heap[sched->count];
+    entry->due = now + delay;
+    entry->period = period;
+    entry->callback = callback;
+    entry->ctx = ctx;
+    entry->id = sched->nextId++;
+    if (id != NULL) {
+        *id = entry->id;
+    }
+    sched->count++;
+    DS3231_Sched_SiftUp(sched, (uint16_t)(sched->count - 1));
+
+    return DS3231_Sched_Arm(sched);
+}
+
+/**
+ * @brief Remove a pending wakeup
+ * @param sched Pointer to scheduler
+ * @param id Identifier returned by DS3231_Sched_Add()
+ * @return HAL_StatusTypeDef HAL_OK on success, HAL_ERROR if the identifier is unknown
+ */
+HAL_StatusTypeDef DS3231_Sched_Cancel(DS3231_Sched_t *sched, uint8_t id)
+{
+    DRIVER_TRACE_API(sched->rtc);
+    int idx = DS3231_Sched_Find(sched, id);
+    if (idx < 0) {
+        return HAL_ERROR;
+    }
+    DS3231_Sched_RemoveAt(sched, (uint16_t)idx);
+    return DS3231_Sched_Arm(sched);
+}
+
+/**
+ * @brief Notify the scheduler that the INT/SQW pin fired
+ * @param sched Pointer to scheduler
+ * @details Safe to call from interrupt context, no bus access is done here.
+ */
+void DS3231_Sched_IRQHandler(DS3231_Sched_t *sched)
+{
+    sched->pending = 1;
+}
+
+/**
+ * @brief Run every due callback and re-arm Alarm 1 for the next wakeup
+ * @param sched Pointer to scheduler
+ * @return HAL_StatusTypeDef HAL_OK on success, error code otherwise
+ * @details Periodic entries that missed several periods are moved to their next
+ *          future slot instead of firing once per missed period.
+ *          Callbacks may add or cancel entries.
+ */
+HAL_StatusTypeDef DS3231_Sched_Process(DS3231_Sched_t *sched)
+{
+    DRIVER_TRACE_API(sched->rtc);
+    uint32_t now;
+
+    if (!sched->pending) {
+        return HAL_OK;
+    }
+    sched->pending = 0;
+    VALID(DS3231_Sched_Now(sched, &now));
+
+    while (sched->count > 0 && sched->heap[0].due <= now) {
+        DS3231_SchedEntry_t entry = sched->heap[0];
+        if (entry.period != 0) {
+            sched->heap[0].due += entry.period * ((now - entry.due) / entry.period + 1u);
+            DS3231_Sched_SiftDown(sched, 0);
+        } else {
+            DS3231_Sched_RemoveAt(sched, 0);
+        }
+        entry.callback(entry.id, entry.ctx);
+    }
+
+    sched->armedValid = 0; // Alarm 1 fired or is stale, always re-program it
+    VALID(DS3231_ClearFlags(sched->rtc, STATUS_A1F_MASK)); // Alarm 2 belongs to the application, keep its flag
+    return DS3231_Sched_Arm(sched);
+}
@@ -0,0 +1,38 @@
+#ifndef DS3231_SCHED_H
+#define DS3231_SCHED_H
+#include "DS3231.h"
+
+/*------------------- Configuration ---------------------------*/
+#ifndef DS3231_SCHED_MAX_TASKS
+#define DS3231_SCHED_MAX_TASKS 16 // Maximum number of pending wakeups
+#endif
+
+/************************ Driver Structs ********************************/
+typedef void (*DS3231_SchedCallback_t)(uint8_t id, void *ctx);
+
+typedef struct {
+    uint32_t due;      // Absolute wakeup time, seconds since 01/01/2000
+    uint32_t period;   // Re-schedule interval in seconds, 0 for one-shot
+    DS3231_SchedCallback_t callback;
+    void *ctx;
+    uint8_t id;
+} DS3231_SchedEntry_t;
+
+typedef struct {
+    DS3231_Handle_t *rtc;
+    DS3231_SchedEntry_t heap[DS3231_SCHED_MAX_TASKS]; // Min-heap ordered by due time
+    uint8_t count;
+    uint8_t nextId;
+    uint8_t armedValid;       // Alarm 1 currently holds heap[0].due
+    uint32_t armed;           // Due time programmed into Alarm 1
+    volatile uint8_t pending; // Set from the INT/SQW interrupt
+} DS3231_Sched_t;
+
+/*------------------- Function Prototypes ---------------------------*/
+HAL_StatusTypeDef DS3231_Sched_Init(DS3231_Sched_t *sched, DS3231_Handle_t *rtc);
+HAL_StatusTypeDef DS3231_Sched_Add(DS3231_Sched_t *sched, uint32_t delay, uint32_t period, DS3231_SchedCallback_t callback, void *ctx, uint8_t *id);
+HAL_StatusTypeDef DS3231_Sched_Cancel(DS3231_Sched_t *sched, uint8_t id);
+void DS3231_Sched_IRQHandler(DS3231_Sched_t *sched);
+HAL_StatusTypeDef DS3231_Sched_Process(DS3231_Sched_t *sched);
+
+#endif
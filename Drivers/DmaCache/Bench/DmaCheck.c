@@ -0,0 +1,415 @@
+#include "DmaCheck.h"
+#include "SimADS1115.h"
+#include "SimBME280.h"
+#include "SimDS3231.h"
+#include <string.h>
+
+/**
+ ******************************************************************************
+ * @file    DmaCheck.c
+ * @author  Yair Yamin
+ * @brief   Host check of the DRIVERS_DCACHE buffer placement and maintenance.
+ * @details Two parts, both built with -DDRIVERS_DCACHE:
+ *
+ * - Layout: every DMA region of the driver handles, the SPI transport and
+ *   the FastBoot job buffers must start on a DMACACHE_LINE boundary and own
+ *   every line its bytes touch, in a handle aligned to the line.
+ * - Runs: the drivers work against the HostSim-HAL models, and HostSim_Cache
+ *   must show every DMA source cleaned, every destination clean-invalidated
+ *   before the transfer and invalidated on completion, always on whole lines.
+ *
+ * Built with USE_I2CBUS the drivers go through the bus manager with deferred
+ * DMA, and FastBoot runs too. Built without it the drivers start their DMA
+ * transfers themselves and return; completions run inside the HAL call, and
+ * the receive callbacks below call DmaCache_RxDone() as an application would.
+ *
+ * The last run starts a DMA read with no maintenance at all; it passes only
+ * if the simulator reports it, so a check that cannot fail is caught too.
+ ******************************************************************************
+ */
+
+/* ========================== Defines ============================ */
+#define ADS1115_ADDR (0x48 << 1)
+#define BME280_ADDR  (0x76 << 1)
+#define DS3231_ADDR  (0x68 << 1)
+#define BME280_CS_PIN GPIO_PIN_4 // On GPIOA
+
+enum {
+    DMA_CHECK_DRIVERS,
+    DMA_CHECK_FASTBOOT,
+    DMA_CHECK_SPI,
+    DMA_CHECK_UNMAINTAINED
+};
+
+#define DMA_CHECK_LAYOUT(type, lines, firstMember, lastMember)                                              \
+    DmaCheck_Layout(#type, #lines, offsetof(type, lines), sizeof(((type *)0)->lines), offsetof(type, firstMember), \
+                    offsetof(type, lastMember) + sizeof(((type *)0)->lastMember), _Alignof(type), sizeof(type))
+
+/************************ Check Context ********************************/
+typedef struct {
+    I2C_HandleTypeDef hi2c;
+    SPI_HandleTypeDef hspi;
+    SimADS1115_t simAds;
+    SimBME280_t simBme;
+    SimDS3231_t simRtc;
+#ifdef USE_I2CBUS
+    I2CBus_t bus;
+    I2CBus_Client_t adsClient, bmeClient, rtcClient;
+#endif
+    ADS1115_Handle_t ads;
+    BME280_Handle_t bme;
+    DS3231_Handle_t rtc;
+    BME280_Spi_t spi;
+#ifdef USE_I2CBUS
+    FastBoot_t boot;
+    FastBoot_ADS1115_t bootAds;
+    FastBoot_BME280_t bootBme;
+    FastBoot_DS3231_t bootRtc;
+#endif
+    uint8_t raw[BME280_BURST_LEN];
+    uint8_t done;
+    HAL_StatusTypeDef doneStatus;
+    DMACACHE_REGION(controlLines, uint8_t control[DMACACHE_LINE]);
+} DmaCheck_Ctx_t;
+
+static DmaCheck_Ctx_t ctx;
+
+static const char *const runNames[] = {
+    [DMA_CHECK_DRIVERS] = "drivers",
+    [DMA_CHECK_FASTBOOT] = "fastboot",
+    [DMA_CHECK_SPI] = "spi",
+    [DMA_CHECK_UNMAINTAINED] = "unmaintained",
+};
+#ifdef USE_I2CBUS
+static const uint8_t runList[] = {DMA_CHECK_DRIVERS, DMA_CHECK_FASTBOOT, DMA_CHECK_SPI, DMA_CHECK_UNMAINTAINED};
+#else
+static const uint8_t runList[] = {DMA_CHECK_DRIVERS, DMA_CHECK_SPI, DMA_CHECK_UNMAINTAINED}; // FastBoot needs the bus manager
+#endif
+#define DMA_CHECK_RUNS (sizeof(runList) / sizeof(runList[0]))
+static const BME280_Settings_t bmeSettings = BME280_SETTINGS(BME280_MODE_NORMAL, BME280_OS_TEMP_x2, BME280_OS_PRESS_x16,
+                                                             BME280_OS_HUM_x1, BME280_STANDBY_62_5MS, BME280_FILTER_x16);
+
+/* ========================== Static Helpers ============================ */
+
+static DmaCheck_Layout_t DmaCheck_Layout(const char *handle, const char *region, uint32_t offset, uint32_t size,
+                                         uint32_t first, uint32_t end, uint32_t align, uint32_t handleSize)
+{
+    DmaCheck_Layout_t r = {handle, region, offset, size, first, end, align, handleSize, 0};
+
+    r.pass = (offset % DMACACHE_LINE == 0 && size > 0 && size % DMACACHE_LINE == 0 && first >= offset &&
+              end <= offset + size && align % DMACACHE_LINE == 0 && handleSize % DMACACHE_LINE == 0);
+    return r;
+}
+
+static int DmaCheck_Aligned(const void *addr)
+{
+    return ((uintptr_t)addr % DMACACHE_LINE) == 0;
+}
+
+void HAL_SPI_TxRxCpltCallback(SPI_HandleTypeDef *hspi)
+{
+    BME280_SpiOnComplete(&ctx.spi, hspi, HAL_OK);
+}
+
+void HAL_SPI_ErrorCallback(SPI_HandleTypeDef *hspi)
+{
+    BME280_SpiOnComplete(&ctx.spi, hspi, HAL_ERROR);
+}
+
+#ifndef USE_I2CBUS
+// Without the bus manager the application ends each DMA read: only one
+// transfer runs per peripheral, so at most one of these has a read pending
+static void DmaCheck_RxDone(I2C_HandleTypeDef *hi2c)
+{
+    if (hi2c == ctx.ads.i2c_handle) {
+        DmaCache_RxDone(&ctx.ads.dmaRx);
+    }
+    if (hi2c == ctx.bme.i2c_handle) {
+        DmaCache_RxDone(&ctx.bme.dmaRx);
+    }
+}
+
+void HAL_I2C_MasterRxCpltCallback(I2C_HandleTypeDef *hi2c) { DmaCheck_RxDone(hi2c); }
+void HAL_I2C_MemRxCpltCallback(I2C_HandleTypeDef *hi2c) { DmaCheck_RxDone(hi2c); }
+void HAL_I2C_ErrorCallback(I2C_HandleTypeDef *hi2c) { DmaCheck_RxDone(hi2c); }
+#endif
+
+static void DmaCheck_OnBurst(void *arg, HAL_StatusTypeDef status)
+{
+    (void)arg;
+    ctx.done = 1;
+    ctx.doneStatus = status;
+}
+
+static void DmaCheck_Setup(void)
+{
+    memset(&ctx, 0, sizeof(ctx));
+    HostSim_Reset();
+#ifdef USE_I2CBUS
+    HostSim_I2CInit(&ctx.hi2c, 400000, HOSTSIM_DMA_DEFERRED);
+#else
+    HostSim_I2CInit(&ctx.hi2c, 400000, HOSTSIM_DMA_IMMEDIATE); // The drivers do not wait for their DMA
+#endif
+    SimADS1115_Init(&ctx.simAds, ADS1115_ADDR);
+    SimBME280_Init(&ctx.simBme, BME280_ADDR);
+    SimDS3231_Init(&ctx.simRtc, DS3231_ADDR);
+    HostSim_Attach(&ctx.hi2c, &ctx.simAds.dev);
+    HostSim_Attach(&ctx.hi2c, &ctx.simBme.dev);
+    HostSim_Attach(&ctx.hi2c, &ctx.simRtc.dev);
+
+#ifdef USE_I2CBUS
+    I2CBus_Init(&ctx.bus, &ctx.hi2c);
+    I2CBus_ClientInit(&ctx.adsClient, &ctx.bus, "ads1115", I2CBUS_PRIO_NORMAL);
+    I2CBus_ClientInit(&ctx.bmeClient, &ctx.bus, "bme280", I2CBUS_PRIO_NORMAL);
+    I2CBus_ClientInit(&ctx.rtcClient, &ctx.bus, "ds3231", I2CBUS_PRIO_NORMAL);
+    ctx.ads.bus_client = &ctx.adsClient;
+    ctx.bme.bus_client = &ctx.bmeClient;
+    ctx.rtc.bus_client = &ctx.rtcClient;
+#endif
+    ctx.ads.i2c_handle = &ctx.hi2c;
+    ctx.ads.I2C_address = ADS1115_ADDR;
+    ctx.bme.i2c_handle = &ctx.hi2c;
+    ctx.bme.I2C_address = BME280_ADDR;
+    ctx.rtc.i2c_handle = &ctx.hi2c;
+    ctx.rtc.I2C_address = DS3231_ADDR;
+    ctx.rtc.time = (ds3231_time_t){.hours = 12, .minutes = 0, .seconds = 0};
+    ctx.rtc.date = (ds3231_data_t){.date = 1, .month = 1, .year = 25};
+    ctx.rtc.dayOfWeek = Wednesday;
+}
+
+/**
+ * @brief Init, read and write each driver, through the bus manager if built with it
+ */
+static HAL_StatusTypeDef DmaCheck_Drivers(void)
+{
+    HAL_StatusTypeDef status;
+
+    if (!DmaCheck_Aligned(ctx.ads.Reg) || !DmaCheck_Aligned(&ctx.bme.Reg) || !DmaCheck_Aligned(ctx.bme.calib) ||
+        !DmaCheck_Aligned(ctx.rtc.Reg) || !DmaCheck_Aligned(&ctx.rtc.control)) {
+        return HAL_ERROR;
+    }
+    status = ADS1115_Init(&ctx.ads, ADS1115_MODE_SINGLESHOT_MASK, AIN0, ADS1115_PGA_4_096V_MASK, ADS1115_DR_860SPS_MASK);
+    if (status == HAL_OK) status = BME280_Init(&ctx.bme);
+    if (status == HAL_OK) status = BME280_ApplySettings(&ctx.bme, &bmeSettings);
+    if (status == HAL_OK) status = DS3231_Init(&ctx.rtc);
+    if (status == HAL_OK) status = DS3231_StartTempConv(&ctx.rtc);
+    if (status == HAL_OK) {
+        // Control byte read by DMA into the handle until CONV clears
+        while ((status = DS3231_PollTempConv(&ctx.rtc)) == HAL_BUSY) {
+            HostSim_AdvanceUs(1000);
+        }
+        if (status == HAL_OK && ctx.rtc.control != ctx.simRtc.regs[DS3231_REG_CONTROL]) {
+            status = HAL_ERROR; // Read landed somewhere else, e.g. on the stack
+        }
+    }
+    for (uint16_t i = 0; i < DMA_CHECK_READS && status == HAL_OK; i++) {
+        status = ADS1115_ReadConversionReg(&ctx.ads);
+        if (status == HAL_OK) status = ADS1115_SetThresholds(&ctx.ads, (uint16_t)(0x8000u + i), 0x7FFF);
+        if (status == HAL_OK) status = BME280_GetAll(&ctx.bme);
+        if (status == HAL_OK) status = DS3231_GetTime(&ctx.rtc);
+        HostSim_AdvanceUs(1000);
+    }
+    return status;
+}
+
+#ifdef USE_I2CBUS
+/**
+ * @brief Bring the devices up as one FastBoot graph, DMA buffers in the job structs
+ */
+static HAL_StatusTypeDef DmaCheck_FastBoot(void)
+{
+    FastBoot_t *boot = &ctx.boot;
+
+    FastBoot_Init(boot);
+    FastBoot_AddDS3231(boot, &ctx.bootRtc, &ctx.rtc, 1);
+    FastBoot_AddBME280(boot, &ctx.bootBme, &ctx.bme, &bmeSettings);
+    FastBoot_AddADS1115(boot, &ctx.bootAds, &ctx.ads, ADS1115_CONFIG(AIN0, PGA_4_096V, SPS_860, 1));
+
+    FastBoot_Start(boot);
+    while (!boot->finished) {
+        uint32_t idle = FastBoot_Poll(boot);
+        if (boot->finished || idle == 0) {
+            continue;
+        }
+        if (ctx.hi2c.pendingCplt != HOSTSIM_CPLT_NONE) {
+            uint64_t wireNs = ctx.hi2c.busyUntilNs - HostSim_NowNs();
+            HostSim_AdvanceNs(wireNs < (uint64_t)idle * 1000u ? wireNs : (uint64_t)idle * 1000u);
+        } else if (idle != 0xFFFFFFFFu) {
+            HostSim_AdvanceUs(idle);
+        } else {
+            return HAL_TIMEOUT; // Nothing on the wire and nothing scheduled: the graph is stuck
+        }
+    }
+    for (uint8_t i = 0; i < boot->deviceCount; i++) {
+        if (boot->devices[i].status != HAL_OK) return boot->devices[i].status;
+    }
+    return HAL_OK;
+}
+
+#endif
+
+/**
+ * @brief BME280 over SPI with DMA: polled-looking init, then background bursts
+ */
+static HAL_StatusTypeDef DmaCheck_Spi(void)
+{
+    HAL_StatusTypeDef status;
+
+    if (!DmaCheck_Aligned(ctx.spi.tx) || !DmaCheck_Aligned(ctx.spi.rx)) {
+        return HAL_ERROR;
+    }
+    // Init parses right after each read, so its DMA completes before returning
+    HostSim_SPIInit(&ctx.hspi, 10000000, HOSTSIM_DMA_IMMEDIATE);
+    SimBME280_AttachSpi(&ctx.simBme, &ctx.hspi, GPIOA, BME280_CS_PIN);
+    BME280_SpiInit(&ctx.spi, &ctx.hspi, GPIOA, BME280_CS_PIN, 1);
+    ctx.bme.transport = &ctx.spi.base;
+    status = BME280_Init(&ctx.bme);
+    if (status == HAL_OK) status = BME280_ApplySettings(&ctx.bme, &bmeSettings);
+
+    ctx.hspi.dmaMode = HOSTSIM_DMA_DEFERRED;
+    ctx.spi.base.done = DmaCheck_OnBurst;
+    for (uint16_t i = 0; i < DMA_CHECK_READS && status == HAL_OK; i++) {
+        ctx.done = 0;
+        status = ctx.spi.base.ops->read(&ctx.spi.base, BME280_PRESS_MSB_REG, ctx.raw, BME280_BURST_LEN);
+        while (status == HAL_OK && !ctx.done) {
+            HostSim_WaitForEvent();
+        }
+        if (status == HAL_OK) status = ctx.doneStatus;
+        if (status == HAL_OK) BME280_ParseMeasurement(&ctx.bme, ctx.raw);
+    }
+    return status;
+}
+
+/**
+ * @brief A DMA read straight through the HAL, without any maintenance
+ */
+static HAL_StatusTypeDef DmaCheck_Unmaintained(void)
+{
+    HAL_StatusTypeDef status = HAL_I2C_Mem_Read_DMA(&ctx.hi2c, DS3231_ADDR, 0x00, I2C_MEMADD_SIZE_8BIT, ctx.control, 7);
+    HostSim_RunUntilIdle(&ctx.hi2c);
+    return status;
+}
+
+/* ========================== Function Definitions ============================ */
+
+/**
+ * @brief Check the placement of every DMA region
+ * @param results Output, one per region
+ * @param max Capacity of results
+ * @return uint8_t Number of results
+ */
+uint8_t DmaCheck_Layouts(DmaCheck_Layout_t *results, uint8_t max)
+{
+    DmaCheck_Layout_t all[] = {
+        DMA_CHECK_LAYOUT(ADS1115_Handle_t, RegLines, Reg, Reg),
+        DMA_CHECK_LAYOUT(BME280_Handle_t, RegLines, Reg, Reg),
+        DMA_CHECK_LAYOUT(BME280_Handle_t, calibLines, calib, calib),
+        DMA_CHECK_LAYOUT(DS3231_Handle_t, RegLines, Reg, Reg),
+        DMA_CHECK_LAYOUT(DS3231_Handle_t, controlLines, control, control),
+        DMA_CHECK_LAYOUT(BME280_Spi_t, txLines, tx, tx),
+        DMA_CHECK_LAYOUT(BME280_Spi_t, rxLines, rx, rx),
+#ifdef USE_I2CBUS
+        DMA_CHECK_LAYOUT(FastBoot_ADS1115_t, bufLines, wire, readback),
+        DMA_CHECK_LAYOUT(FastBoot_BME280_t, bufLines, id, calibB),
+        DMA_CHECK_LAYOUT(FastBoot_DS3231_t, bufLines, regs, regs),
+#endif
+    };
+    uint8_t count = 0;
+
+    for (uint8_t i = 0; i < sizeof(all) / sizeof(all[0]) && count < max; i++) {
+        results[count++] = all[i];
+    }
+    return count;
+}
+
+/**
+ * @brief Run one scenario against the simulator
+ * @param run Index in the runs of this build: drivers, fastboot (with USE_I2CBUS
+ *        only), spi, unmaintained (negative control)
+ * @return DmaCheck_Run_t Status and cache counters of the run
+ */
+DmaCheck_Run_t DmaCheck_Run(uint8_t run)
+{
+    DmaCheck_Run_t r;
+    const HostSim_CacheStats_t *c = &HostSim_Cache;
+
+    memset(&r, 0, sizeof(r));
+    run = (run < DMA_CHECK_RUNS) ? runList[run] : DMA_CHECK_UNMAINTAINED;
+    r.run = runNames[run];
+    DmaCheck_Setup();
+    switch (run) {
+    case DMA_CHECK_DRIVERS:  r.status = DmaCheck_Drivers(); break;
+#ifdef USE_I2CBUS
+    case DMA_CHECK_FASTBOOT: r.status = DmaCheck_FastBoot(); break;
+#endif
+    case DMA_CHECK_SPI:      r.status = DmaCheck_Spi(); break;
+    default: r.status = DmaCheck_Unmaintained(); r.control = 1; break;
+    }
+    r.cache = *c;
+    if (r.control) {
+        r.pass = (r.status == HAL_OK && c->undropped == 1 && c->stale == 1);
+    } else {
+        r.pass = (r.status == HAL_OK && c->dmaReads > 0 && c->dmaWrites > 0 && c->unaligned == 0 &&
+                  c->uncleaned == 0 && c->undropped == 0 && c->stale == 0);
+    }
+    return r;
+}
+
+/**
+ * @brief Write the layout CSV, a blank line, then the run CSV
+ */
+void DmaCheck_WriteCsv(FILE *out, const DmaCheck_Layout_t *layouts, uint8_t layoutCount, const DmaCheck_Run_t *runs, uint8_t runCount)
+{
+    fprintf(out, "handle,region,offset,size,first,end,align,handle_size,status\n");
+    for (uint8_t i = 0; i < layoutCount; i++) {
+        const DmaCheck_Layout_t *l = &layouts[i];
+        fprintf(out, "%s,%s,%lu,%lu,%lu,%lu,%lu,%lu,%s\n", l->handle, l->region, (unsigned long)l->offset,
+                (unsigned long)l->size, (unsigned long)l->first, (unsigned long)l->end, (unsigned long)l->align,
+                (unsigned long)l->handleSize, l->pass ? "ok" : "FAIL");
+    }
+    fprintf(out, "\nrun,dma_reads,dma_writes,cleans,invalidates,unaligned,uncleaned,undropped,stale,hal_status,status\n");
+    for (uint8_t i = 0; i < runCount; i++) {
+        const DmaCheck_Run_t *r = &runs[i];
+        fprintf(out, "%s,%llu,%llu,%llu,%llu,%llu,%llu,%llu,%llu,%d,%s\n", r->run, (unsigned long long)r->cache.dmaReads,
+                (unsigned long long)r->cache.dmaWrites, (unsigned long long)r->cache.cleans,
+                (unsigned long long)r->cache.invalidates, (unsigned long long)r->cache.unaligned,
+                (unsigned long long)r->cache.uncleaned, (unsigned long long)r->cache.undropped,
+                (unsigned long long)r->cache.stale, (int)r->status, r->pass ? (r->control ? "detected" : "ok") : "FAIL");
+    }
+}
+
+/**
+ * @brief Command line entry, no arguments
+ * @return int 0 if every layout and run passed, 1 if one failed, 2 on usage errors
+ */
+int DmaCheck_Main(int argc, char **argv)
+{
+    DmaCheck_Layout_t layouts[16];
+    DmaCheck_Run_t runs[DMA_CHECK_RUNS];
+    uint8_t layoutCount;
+    int failed = 0;
+
+    if (argc > 1) {
+        fprintf(stderr, "usage: %s\n", argv[0]);
+        return 2;
+    }
+    layoutCount = DmaCheck_Layouts(layouts, (uint8_t)(sizeof(layouts) / sizeof(layouts[0])));
+    for (uint8_t i = 0; i < DMA_CHECK_RUNS; i++) {
+        runs[i] = DmaCheck_Run(i);
+    }
+
+    DmaCheck_WriteCsv(stdout, layouts, layoutCount, runs, DMA_CHECK_RUNS);
+    for (uint8_t i = 0; i < layoutCount; i++) {
+        if (!layouts[i].pass) {
+            fprintf(stderr, "%s.%s does not own its cache lines\n", layouts[i].handle, layouts[i].region);
+            failed = 1;
+        }
+    }
+    for (uint8_t i = 0; i < DMA_CHECK_RUNS; i++) {
+        if (!runs[i].pass) {
+            fprintf(stderr, "%s run failed\n", runs[i].run);
+            failed = 1;
+        }
+    }
+    return failed;
+}
@@ -0,0 +1,51 @@
+#ifndef DMA_CHECK_H
+#define DMA_CHECK_H
+#ifdef USE_I2CBUS
+#include "FastBootSensors.h"
+#else
+#include "ADS1115.h"
+#include "BME280.h"
+#include "DS3231.h"
+#endif
+#include "BME280Spi.h"
+#include <stdio.h>
+
+/*------------------- Configuration ---------------------------*/
+#ifndef DRIVERS_DCACHE
+#error "DmaCheck checks the DRIVERS_DCACHE layouts, build it with -DDRIVERS_DCACHE"
+#endif
+#ifdef DRIVERS_DMA_NONCACHEABLE
+#error "DmaCheck checks the cache maintenance, build it without DRIVERS_DMA_NONCACHEABLE"
+#endif
+#ifndef DMA_CHECK_READS
+#define DMA_CHECK_READS 20 // Reads per driver in the driver run
+#endif
+
+/************************ Check Structs ********************************/
+typedef struct {
+    const char *handle;
+    const char *region;
+    uint32_t offset;  // Of the region in the handle
+    uint32_t size;    // Region bytes, padding to the last line included
+    uint32_t first;   // Offset of the first DMA byte
+    uint32_t end;     // Offset after the last DMA byte
+    uint32_t align;   // _Alignof the handle
+    uint32_t handleSize;
+    int pass;         // 1 if the region starts on a line and owns every line it touches
+} DmaCheck_Layout_t;
+
+typedef struct {
+    const char *run;
+    HAL_StatusTypeDef status;
+    HostSim_CacheStats_t cache;
+    uint8_t control;  // Negative control: the faults must be detected
+    int pass;
+} DmaCheck_Run_t;
+
+/*------------------- Function Prototypes ---------------------------*/
+uint8_t DmaCheck_Layouts(DmaCheck_Layout_t *results, uint8_t max);
+DmaCheck_Run_t DmaCheck_Run(uint8_t run);
+void DmaCheck_WriteCsv(FILE *out, const DmaCheck_Layout_t *layouts, uint8_t layoutCount, const DmaCheck_Run_t *runs, uint8_t runCount);
+int DmaCheck_Main(int argc, char **argv);
+
+#endif
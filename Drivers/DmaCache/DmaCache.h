@@ -0,0 +1,91 @@
+#ifndef DMACACHE_H
+#define DMACACHE_H
+#include "main.h"
+#include <stdint.h>
+
+/*------------------- Configuration ---------------------------*/
+// Define DRIVERS_DCACHE on targets with the data cache enabled (STM32F7, STM32H7)
+#ifndef DMACACHE_LINE
+#define DMACACHE_LINE 32 // Cortex-M7 D-cache line, bytes
+#endif
+#ifndef DMACACHE_SECTION_NAME
+#define DMACACHE_SECTION_NAME ".dma_buffer" // Output section the linker script puts in a non-cacheable MPU region
+#endif
+// Define DRIVERS_DMA_NONCACHEABLE when every handle doing DMA is placed with
+// DMACACHE_NONCACHEABLE (or the D-cache is off): maintenance compiles to nothing
+
+#define DMACACHE_SIZE(n) (((n) + DMACACHE_LINE - 1) / DMACACHE_LINE * DMACACHE_LINE)
+
+#ifdef DRIVERS_DCACHE
+#define DMACACHE_ALIGNED __attribute__((aligned(DMACACHE_LINE)))
+// Member declaration(s) in a region of whole cache lines; lines is a byte
+// view of the region, padding included, for size checks
+#define DMACACHE_REGION(lines, ...) \
+    union { __VA_ARGS__; uint8_t lines[DMACACHE_SIZE(sizeof(struct { __VA_ARGS__; }))]; } DMACACHE_ALIGNED
+#else
+#define DMACACHE_ALIGNED
+#define DMACACHE_REGION(lines, ...) __VA_ARGS__
+#endif
+
+// Put on a handle definition: static ADS1115_Handle_t hads1115 DMACACHE_NONCACHEABLE;
+#define DMACACHE_NONCACHEABLE __attribute__((section(DMACACHE_SECTION_NAME)))
+
+/*------------------- Cache Maintenance ---------------------------*/
+// Handles with regions must be statics or aligned_alloc()ed: malloc() only
+// aligns to 8 bytes. The CPU must not write a region while DMA writes it.
+#if defined(DRIVERS_DCACHE) && !defined(DRIVERS_DMA_NONCACHEABLE)
+#define DMACACHE_FIRST(addr) ((uintptr_t)(addr) & ~(uintptr_t)(DMACACHE_LINE - 1))
+#define DMACACHE_SPAN(addr, size) ((int32_t)(DMACACHE_SIZE((uintptr_t)(addr) + (size)) - DMACACHE_FIRST(addr)))
+
+// Before the DMA reads size bytes at addr: write the CPU's data to memory
+static inline void DmaCache_Clean(const void *addr, uint32_t size)
+{
+    SCB_CleanDCache_by_Addr((uint32_t *)DMACACHE_FIRST(addr), DMACACHE_SPAN(addr, size));
+}
+
+// Before the DMA writes size bytes at addr: write back the rest of the lines
+// and drop them, so no eviction lands on top of the transfer
+static inline void DmaCache_CleanInvalidate(const void *addr, uint32_t size)
+{
+    SCB_CleanInvalidateDCache_by_Addr((uint32_t *)DMACACHE_FIRST(addr), DMACACHE_SPAN(addr, size));
+}
+
+// After the DMA has written size bytes at addr: drop lines fetched meanwhile
+static inline void DmaCache_Invalidate(const void *addr, uint32_t size)
+{
+    SCB_InvalidateDCache_by_Addr((uint32_t *)DMACACHE_FIRST(addr), DMACACHE_SPAN(addr, size));
+}
+#else
+#define DmaCache_Clean(addr, size) ((void)(addr), (void)(size))
+#define DmaCache_CleanInvalidate(addr, size) ((void)(addr), (void)(size))
+#define DmaCache_Invalidate(addr, size) ((void)(addr), (void)(size))
+#endif
+
+/*------------------- Pending DMA Reads ---------------------------*/
+// Without USE_I2CBUS the drivers start a DMA read and return before it
+// completes. They record its destination here; the application's receive
+// completion (and error) callback calls DmaCache_RxDone() on it.
+typedef struct {
+    void *volatile addr; // NULL when no read is pending
+    uint32_t size;
+} DmaCache_Rx_t;
+
+// Before starting a DMA read of size bytes at addr
+static inline void DmaCache_RxStart(DmaCache_Rx_t *rx, void *addr, uint32_t size)
+{
+    DmaCache_CleanInvalidate(addr, size);
+    rx->size = size;
+    rx->addr = addr;
+}
+
+// From the completion or error callback: drop the lines the DMA wrote, no-op if none is pending
+static inline void DmaCache_RxDone(DmaCache_Rx_t *rx)
+{
+    void *addr = rx->addr;
+    if (addr != NULL) {
+        rx->addr = NULL;
+        DmaCache_Invalidate(addr, rx->size);
+    }
+}
+
+#endif
@@ -0,0 +1,69 @@
+#ifndef DRIVER_OS_H
+#define DRIVER_OS_H
+#include "main.h"
+
+/*------------------- Configuration ---------------------------*/
+// Backend: FreeRTOS on the target, POSIX threads on the host
+#if !defined(DRIVER_OS_FREERTOS) && !defined(DRIVER_OS_POSIX)
+#ifdef HOSTSIM_H
+#define DRIVER_OS_POSIX
+#else
+#define DRIVER_OS_FREERTOS
+#endif
+#endif
+
+#ifndef DRIVER_OS_NOTIFY_INDEX
+#define DRIVER_OS_NOTIFY_INDEX 0 // FreeRTOS task notification slot the completion wakes
+#endif
+
+#define DRIVER_OS_FOREVER 0xFFFFFFFFu
+
+/************************ Backend Types ********************************/
+#ifdef DRIVER_OS_FREERTOS
+#include "FreeRTOS.h"
+#include "task.h"
+#include "semphr.h"
+
+typedef struct {
+    SemaphoreHandle_t handle;
+    StaticSemaphore_t buffer;
+} DriverOs_Mutex_t;
+
+typedef struct {
+    volatile TaskHandle_t task; // Task sleeping in DriverOs_EventWait()
+} DriverOs_Event_t;
+
+// BASEPRI masking, valid in tasks and in interrupts up to configMAX_SYSCALL_INTERRUPT_PRIORITY
+#define DRIVER_OS_CRITICAL_ENTER() UBaseType_t driverOsMask = taskENTER_CRITICAL_FROM_ISR()
+#define DRIVER_OS_CRITICAL_EXIT()  taskEXIT_CRITICAL_FROM_ISR(driverOsMask)
+#else
+#include <pthread.h>
+
+typedef pthread_mutex_t DriverOs_Mutex_t;
+
+typedef struct {
+    pthread_mutex_t lock;
+    pthread_cond_t cond;
+    uint8_t set;
+} DriverOs_Event_t;
+
+// One process-wide lock stands for masked interrupts; the thread playing the
+// interrupt handlers takes it too
+#define DRIVER_OS_CRITICAL_ENTER() DriverOs_CriticalEnter()
+#define DRIVER_OS_CRITICAL_EXIT()  DriverOs_CriticalExit()
+void DriverOs_CriticalEnter(void);
+void DriverOs_CriticalExit(void);
+#endif
+
+/*------------------- Function Prototypes ---------------------------*/
+uint8_t DriverOs_Running(void);
+uint32_t DriverOs_NowMs(void);
+HAL_StatusTypeDef DriverOs_MutexInit(DriverOs_Mutex_t *mutex);
+HAL_StatusTypeDef DriverOs_MutexTake(DriverOs_Mutex_t *mutex, uint32_t timeoutMs);
+void DriverOs_MutexGive(DriverOs_Mutex_t *mutex);
+HAL_StatusTypeDef DriverOs_EventInit(DriverOs_Event_t *event);
+void DriverOs_EventPrepare(DriverOs_Event_t *event);
+HAL_StatusTypeDef DriverOs_EventWait(DriverOs_Event_t *event, uint32_t timeoutMs);
+void DriverOs_EventSignal(DriverOs_Event_t *event);
+
+#endif
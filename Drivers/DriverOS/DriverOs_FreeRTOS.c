@@ -0,0 +1,138 @@
+#include "DriverOs.h"
+#ifdef DRIVER_OS_FREERTOS
+
+/**
+ ******************************************************************************
+ * @file    DriverOs_FreeRTOS.c
+ * @author  Yair Yamin
+ * @brief   FreeRTOS backend of the driver OS layer.
+ * @details Mutexes are statically allocated recursive mutexes, so a task may
+ * hold the bus and still make driver calls on it. Events are direct task
+ * notifications: the waiting task records itself and the completion
+ * interrupt gives its notification, which is the cheapest way FreeRTOS has
+ * to wake one task from an ISR.
+ *
+ * Needs configSUPPORT_STATIC_ALLOCATION, configUSE_RECURSIVE_MUTEXES and
+ * FreeRTOS 10.4 or later for the indexed notification functions.
+ * Define DRIVER_OS_HAL_DELAY to replace the weak HAL_Delay() with
+ * vTaskDelay(), so the conversion waits inside the drivers yield as well.
+ ******************************************************************************
+ */
+
+_Static_assert(1000u % configTICK_RATE_HZ == 0, "DriverOs needs a tick rate that divides 1 kHz");
+
+/* ========================== Static Helpers ============================ */
+
+static TickType_t DriverOs_Ticks(uint32_t timeoutMs)
+{
+    return (timeoutMs == DRIVER_OS_FOREVER) ? portMAX_DELAY : pdMS_TO_TICKS(timeoutMs);
+}
+
+ /* ========================== Function Definitions ============================ */
+
+/**
+ * @brief Whether blocking on OS objects is possible
+ * @return uint8_t 0 before vTaskStartScheduler(), callers then poll instead
+ */
+uint8_t DriverOs_Running(void)
+{
+    return xTaskGetSchedulerState() != taskSCHEDULER_NOT_STARTED;
+}
+
+/**
+ * @brief Millisecond clock for timeouts, the RTOS tick
+ */
+uint32_t DriverOs_NowMs(void)
+{
+    return (uint32_t)xTaskGetTickCount() * (1000u / configTICK_RATE_HZ);
+}
+
+/**
+ * @brief Create a recursive mutex in place
+ * @return HAL_StatusTypeDef HAL_OK, HAL_ERROR if FreeRTOS refused
+ */
+HAL_StatusTypeDef DriverOs_MutexInit(DriverOs_Mutex_t *mutex)
+{
+    mutex->handle = xSemaphoreCreateRecursiveMutexStatic(&mutex->buffer);
+    return (mutex->handle != NULL) ? HAL_OK : HAL_ERROR;
+}
+
+/**
+ * @brief Take a mutex, recursively
+ * @param timeoutMs Longest wait, DRIVER_OS_FOREVER for no limit
+ * @return HAL_StatusTypeDef HAL_OK, HAL_TIMEOUT if another task kept it
+ */
+HAL_StatusTypeDef DriverOs_MutexTake(DriverOs_Mutex_t *mutex, uint32_t timeoutMs)
+{
+    return (xSemaphoreTakeRecursive(mutex->handle, DriverOs_Ticks(timeoutMs)) == pdTRUE) ? HAL_OK : HAL_TIMEOUT;
+}
+
+void DriverOs_MutexGive(DriverOs_Mutex_t *mutex)
+{
+    xSemaphoreGiveRecursive(mutex->handle);
+}
+
+HAL_StatusTypeDef DriverOs_EventInit(DriverOs_Event_t *event)
+{
+    event->task = NULL;
+    return HAL_OK;
+}
+
+/**
+ * @brief Make the calling task the one the next signal wakes
+ * @details Call before starting the operation whose completion signals, so a
+ *          completion that arrives before the wait is not lost. Drops a
+ *          notification left over from an earlier operation that timed out.
+ */
+void DriverOs_EventPrepare(DriverOs_Event_t *event)
+{
+    event->task = xTaskGetCurrentTaskHandle();
+    (void)ulTaskNotifyTakeIndexed(DRIVER_OS_NOTIFY_INDEX, pdTRUE, 0);
+}
+
+/**
+ * @brief Sleep until the event is signalled
+ * @param timeoutMs Longest wait, DRIVER_OS_FOREVER for no limit
+ * @return HAL_StatusTypeDef HAL_OK when woken, HAL_TIMEOUT otherwise
+ * @details May return HAL_OK for a signal meant for an earlier operation,
+ *          callers check their own completion flag.
+ */
+HAL_StatusTypeDef DriverOs_EventWait(DriverOs_Event_t *event, uint32_t timeoutMs)
+{
+    (void)event;
+    return (ulTaskNotifyTakeIndexed(DRIVER_OS_NOTIFY_INDEX, pdTRUE, DriverOs_Ticks(timeoutMs)) != 0) ? HAL_OK : HAL_TIMEOUT;
+}
+
+/**
+ * @brief Wake the task waiting on the event, from a task or an interrupt
+ */
+void DriverOs_EventSignal(DriverOs_Event_t *event)
+{
+    TaskHandle_t task = event->task;
+
+    if (task == NULL) {
+        return;
+    }
+    if (xPortIsInsideInterrupt()) {
+        BaseType_t woken = pdFALSE;
+        vTaskNotifyGiveIndexedFromISR(task, DRIVER_OS_NOTIFY_INDEX, &woken);
+        portYIELD_FROM_ISR(woken);
+    } else {
+        xTaskNotifyGiveIndexed(task, DRIVER_OS_NOTIFY_INDEX);
+    }
+}
+
+#ifdef DRIVER_OS_HAL_DELAY
+void HAL_Delay(uint32_t Delay)
+{
+    if (!DriverOs_Running()) {
+        uint32_t start = HAL_GetTick();
+        while ((uint32_t)(HAL_GetTick() - start) < Delay + 1u) {
+        }
+        return;
+    }
+    vTaskDelay(pdMS_TO_TICKS(Delay) + 1u); // Round up, the first tick may be partial
+}
+#endif
+
+#endif
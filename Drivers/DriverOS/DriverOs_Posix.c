@@ -0,0 +1,154 @@
+#define _POSIX_C_SOURCE 200809L
+#include "DriverOs.h"
+#ifdef DRIVER_OS_POSIX
+#include <errno.h>
+#include <time.h>
+
+/**
+ ******************************************************************************
+ * @file    DriverOs_Posix.c
+ * @author  Yair Yamin
+ * @brief   POSIX threads backend of the driver OS layer, for host builds.
+ * @details Threads play the tasks. Mutexes are recursive pthread mutexes and
+ * events are a flag with a condition variable. One process-wide recursive
+ * lock stands for interrupt masking: the thread that plays the interrupt
+ * handlers must run them while holding it (DriverOs_CriticalEnter()), so they
+ * never run inside a critical section of a task, just like on the target.
+ ******************************************************************************
+ */
+
+/* ========================== Global Variables ============================ */
+static pthread_mutex_t irqLock;
+static pthread_once_t irqLockOnce = PTHREAD_ONCE_INIT;
+
+/* ========================== Static Helpers ============================ */
+
+static void DriverOs_IrqLockInit(void)
+{
+    pthread_mutexattr_t attr;
+    pthread_mutexattr_init(&attr);
+    pthread_mutexattr_settype(&attr, PTHREAD_MUTEX_RECURSIVE);
+    pthread_mutex_init(&irqLock, &attr);
+    pthread_mutexattr_destroy(&attr);
+}
+
+/**
+ * @brief Absolute deadline timeoutMs from now on the given clock
+ */
+static struct timespec DriverOs_Deadline(clockid_t clock, uint32_t timeoutMs)
+{
+    struct timespec ts;
+    clock_gettime(clock, &ts);
+    ts.tv_sec += timeoutMs / 1000u;
+    ts.tv_nsec += (long)(timeoutMs % 1000u) * 1000000L;
+    if (ts.tv_nsec >= 1000000000L) {
+        ts.tv_sec++;
+        ts.tv_nsec -= 1000000000L;
+    }
+    return ts;
+}
+
+ /* ========================== Function Definitions ============================ */
+
+void DriverOs_CriticalEnter(void)
+{
+    pthread_once(&irqLockOnce, DriverOs_IrqLockInit);
+    pthread_mutex_lock(&irqLock);
+}
+
+void DriverOs_CriticalExit(void)
+{
+    pthread_mutex_unlock(&irqLock);
+}
+
+uint8_t DriverOs_Running(void)
+{
+    return 1;
+}
+
+/**
+ * @brief Millisecond clock for timeouts, CLOCK_MONOTONIC
+ * @details Real time, not HostSim time: a stuck simulated bus does not
+ *          advance the simulated clock, and its waiters must still time out.
+ */
+uint32_t DriverOs_NowMs(void)
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint32_t)((uint64_t)ts.tv_sec * 1000u + (uint64_t)ts.tv_nsec / 1000000u);
+}
+
+HAL_StatusTypeDef DriverOs_MutexInit(DriverOs_Mutex_t *mutex)
+{
+    pthread_mutexattr_t attr;
+    int err;
+
+    pthread_mutexattr_init(&attr);
+    pthread_mutexattr_settype(&attr, PTHREAD_MUTEX_RECURSIVE);
+    err = pthread_mutex_init(mutex, &attr);
+    pthread_mutexattr_destroy(&attr);
+    return (err == 0) ? HAL_OK : HAL_ERROR;
+}
+
+HAL_StatusTypeDef DriverOs_MutexTake(DriverOs_Mutex_t *mutex, uint32_t timeoutMs)
+{
+    if (timeoutMs == DRIVER_OS_FOREVER) {
+        return (pthread_mutex_lock(mutex) == 0) ? HAL_OK : HAL_ERROR;
+    }
+    struct timespec deadline = DriverOs_Deadline(CLOCK_REALTIME, timeoutMs); // The clock timedlock uses
+    return (pthread_mutex_timedlock(mutex, &deadline) == 0) ? HAL_OK : HAL_TIMEOUT;
+}
+
+void DriverOs_MutexGive(DriverOs_Mutex_t *mutex)
+{
+    pthread_mutex_unlock(mutex);
+}
+
+HAL_StatusTypeDef DriverOs_EventInit(DriverOs_Event_t *event)
+{
+    pthread_condattr_t attr;
+    int err;
+
+    pthread_condattr_init(&attr);
+    pthread_condattr_setclock(&attr, CLOCK_MONOTONIC);
+    err = pthread_mutex_init(&event->lock, NULL);
+    if (err == 0) {
+        err = pthread_cond_init(&event->cond, &attr);
+    }
+    pthread_condattr_destroy(&attr);
+    event->set = 0;
+    return (err == 0) ? HAL_OK : HAL_ERROR;
+}
+
+void DriverOs_EventPrepare(DriverOs_Event_t *event)
+{
+    pthread_mutex_lock(&event->lock);
+    event->set = 0;
+    pthread_mutex_unlock(&event->lock);
+}
+
+HAL_StatusTypeDef DriverOs_EventWait(DriverOs_Event_t *event, uint32_t timeoutMs)
+{
+    struct timespec deadline = DriverOs_Deadline(CLOCK_MONOTONIC, (timeoutMs == DRIVER_OS_FOREVER) ? 0 : timeoutMs);
+    int err = 0;
+
+    pthread_mutex_lock(&event->lock);
+    while (!event->set && err != ETIMEDOUT) {
+        err = (timeoutMs == DRIVER_OS_FOREVER) ? pthread_cond_wait(&event->cond, &event->lock)
+                                               : pthread_cond_timedwait(&event->cond, &event->lock, &deadline);
+    }
+    HAL_StatusTypeDef status = event->set ? HAL_OK : HAL_TIMEOUT;
+    event->set = 0;
+    pthread_mutex_unlock(&event->lock);
+    return status;
+}
+
+void DriverOs_EventSignal(DriverOs_Event_t *event)
+{
+    pthread_mutex_lock(&event->lock);
+    event->set = 1;
+    pthread_cond_signal(&event->cond);
+    pthread_mutex_unlock(&event->lock);
+}
+
+#endif
@@ -0,0 +1,270 @@
+#include "DriverTrace.h"
+#include <string.h>
+
+/**
+ ******************************************************************************
+ * @file    DriverTrace.c
+ * @author  Yair Yamin
+ * @brief   Transaction trace and per-function counters for the I2C drivers.
+ * @details Add this file to the build and define DRIVER_TRACE for the whole
+ * project. Without DRIVER_TRACE the driver hooks expand to nothing.
+ *
+ * - Every transfer made by a driver I/O helper is written to a ring of the last
+ *   DRIVER_TRACE_RING_LEN transactions. Writers claim a slot with one atomic
+ *   increment and publish it with a sequence number, so the ring can be written
+ *   from interrupts and read while it is being written, without locks.
+ * - Each traced driver function keeps call, transaction, byte and error counters,
+ *   its bus time and a log2 histogram of its call duration. A call made from
+ *   inside another call on the same handle is accounted to the outer one.
+ *
+ * The ring overwrites its oldest entries, read it with DriverTrace_ReadEvents().
+ ******************************************************************************
+ */
+
+/* ========================== Defines ============================ */
+#define DRIVER_TRACE_LOCK()   uint32_t primask = __get_PRIMASK(); __disable_irq()
+#define DRIVER_TRACE_UNLOCK() __set_PRIMASK(primask)
+
+// Innermost driver call in progress. With a preemptive RTOS map it to a
+// thread-local slot so calls from different tasks are not mixed up.
+#ifndef DRIVER_TRACE_CURRENT
+#define DRIVER_TRACE_CURRENT driverTraceCurrent
+static DriverTrace_Scope_t *driverTraceCurrent;
+#endif
+
+/* ========================== Global Variables ============================ */
+static DriverTrace_Event_t traceRing[DRIVER_TRACE_RING_LEN];
+static uint32_t traceHead; // Transactions recorded since the last reset
+static DriverTrace_Api_t traceApis[DRIVER_TRACE_MAX_APIS];
+static uint16_t traceApiCount;
+
+/* ========================== Static Helpers ============================ */
+
+static uint8_t DriverTrace_HistBin(uint32_t cycles)
+{
+    uint32_t scaled = cycles >> DRIVER_TRACE_HIST_SHIFT;
+    uint8_t bin = scaled ? (uint8_t)(32 - __builtin_clz(scaled)) : 0;
+    return bin < DRIVER_TRACE_HIST_BINS ? bin : DRIVER_TRACE_HIST_BINS - 1;
+}
+
+static void DriverTrace_Record(uint32_t start, uint32_t end, const char *api, uint8_t device,
+                               uint16_t reg, uint16_t len, uint8_t op, uint8_t status)
+{
+    uint32_t index = __atomic_fetch_add(&traceHead, 1, __ATOMIC_RELAXED);
+    DriverTrace_Event_t *event = &traceRing[index & (DRIVER_TRACE_RING_LEN - 1)];
+
+    // seq 0 marks the slot as being written until the fields are complete
+    __atomic_store_n(&event->seq, 0, __ATOMIC_RELAXED);
+    __atomic_thread_fence(__ATOMIC_RELEASE);
+    event->start = start;
+    event->end = end;
+    event->api = api;
+    event->reg = reg;
+    event->len = len;
+    event->device = device;
+    event->op = op;
+    event->status = status;
+    __atomic_store_n(&event->seq, index + 1, __ATOMIC_RELEASE);
+}
+
+ /* ========================== Function Definitions ============================ */
+
+/**
+ * @brief Start the cycle counter and clear the trace
+ * @details On Cortex-M3 and up this enables the DWT cycle counter used as the
+ *          default timestamp source. Call once before the first traced driver call.
+ */
+void DriverTrace_Init(void)
+{
+#if !defined(HOSTSIM_H) && defined(DWT_CTRL_CYCCNTENA_Msk)
+    CoreDebug->DEMCR |= CoreDebug_DEMCR_TRCENA_Msk;
+    DWT->CYCCNT = 0;
+    DWT->CTRL |= DWT_CTRL_CYCCNTENA_Msk;
+#endif
+    DriverTrace_Reset();
+}
+
+/**
+ * @brief Clear the ring and every counter
+ * @details Function names stay registered so their cached slots remain valid.
+ *          Not safe against driver calls running at the same time.
+ */
+void DriverTrace_Reset(void)
+{
+    memset(traceRing, 0, sizeof(traceRing));
+    traceHead = 0;
+    for (uint16_t i = 0; i < traceApiCount; i++) {
+        const char *name = traceApis[i].name;
+        memset(&traceApis[i], 0, sizeof(traceApis[i]));
+        traceApis[i].name = name;
+    }
+}
+
+/**
+ * @brief Open the trace scope of a driver call
+ * @param scope Scope on the caller's stack, closed by DriverTrace_Leave()
+ * @param stats The function's cached counter slot, registered on first use
+ * @param handle Driver handle the call works on
+ * @param api Function name
+ * @details Used by DRIVER_TRACE_API(), not meant to be called directly.
+ */
+void DriverTrace_Enter(DriverTrace_Scope_t *scope, DriverTrace_Api_t **stats, const void *handle, const char *api)
+{
+    DriverTrace_Scope_t *current = DRIVER_TRACE_CURRENT;
+
+    memset(scope, 0, sizeof(*scope));
+    if (current != NULL && current->handle == handle) {
+        return; // Nested call, its transactions belong to the outer one
+    }
+
+    if (*stats == NULL) {
+        DRIVER_TRACE_LOCK();
+        if (*stats == NULL && traceApiCount < DRIVER_TRACE_MAX_APIS) {
+            traceApis[traceApiCount].name = api;
+            *stats = &traceApis[traceApiCount++];
+        }
+        DRIVER_TRACE_UNLOCK();
+    }
+
+    scope->prev = current;
+    scope->stats = *stats;
+    scope->api = api;
+    scope->handle = handle;
+    scope->active = 1;
+    DRIVER_TRACE_CURRENT = scope;
+    scope->start = DRIVER_TRACE_CYCLES();
+}
+
+/**
+ * @brief Close the trace scope of a driver call and account it
+ * @param scope Scope opened by DriverTrace_Enter()
+ * @details Runs automatically when the traced function returns.
+ */
+void DriverTrace_Leave(DriverTrace_Scope_t *scope)
+{
+    if (!scope->active) {
+        return;
+    }
+    uint32_t cycles = DRIVER_TRACE_CYCLES() - scope->start;
+    DRIVER_TRACE_CURRENT = scope->prev;
+
+    DriverTrace_Api_t *stats = scope->stats;
+    if (stats == NULL) {
+        return; // Counter table full, the ring still has the transactions
+    }
+    DRIVER_TRACE_LOCK();
+    stats->calls++;
+    stats->transactions += scope->transactions;
+    stats->bytes += scope->bytes;
+    stats->errors += scope->errors;
+    stats->totalCycles += cycles;
+    stats->busCycles += scope->busCycles;
+    if (cycles > stats->maxCycles) {
+        stats->maxCycles = cycles;
+    }
+    stats->hist[DriverTrace_HistBin(cycles)]++;
+    DRIVER_TRACE_UNLOCK();
+}
+
+/**
+ * @brief Record a finished transfer
+ * @param start DRIVER_TRACE_CYCLES() taken before the transfer
+ * @param device I2C address
+ * @param reg Register address or DRIVER_TRACE_NO_REG
+ * @param len Data bytes
+ * @param op DRIVER_TRACE_OP_...
+ * @param status Result of the transfer
+ * @details Used by DRIVER_TRACE_TXN_END(). For the _DMA HAL functions the end
+ *          timestamp is when the transfer was started, not when it completed.
+ */
+void DriverTrace_Txn(uint32_t start, uint8_t device, uint16_t reg, uint16_t len, uint8_t op, HAL_StatusTypeDef status)
+{
+    uint32_t end = DRIVER_TRACE_CYCLES();
+    DriverTrace_Scope_t *scope = DRIVER_TRACE_CURRENT;
+
+    DriverTrace_Record(start, end, scope ? scope->api : NULL, device, reg, len, op, (uint8_t)status);
+    if (scope != NULL) {
+        scope->transactions++;
+        scope->bytes += len;
+        scope->busCycles += end - start;
+        if (status != HAL_OK) {
+            scope->errors++;
+        }
+    }
+}
+
+/**
+ * @brief Copy the most recent transactions out of the ring
+ * @param events Output array, oldest first
+ * @param max Capacity of events
+ * @return uint16_t Number of events copied
+ * @details Slots overwritten or still being written while they are copied are
+ *          skipped, so the sequence numbers may have gaps.
+ */
+uint16_t DriverTrace_ReadEvents(DriverTrace_Event_t *events, uint16_t max)
+{
+    uint32_t head = __atomic_load_n(&traceHead, __ATOMIC_ACQUIRE);
+    uint32_t available = head < DRIVER_TRACE_RING_LEN ? head : DRIVER_TRACE_RING_LEN;
+    uint16_t count = 0;
+
+    if (available > max) {
+        available = max;
+    }
+    for (uint32_t index = head - available; index != head; index++) {
+        const DriverTrace_Event_t *slot = &traceRing[index & (DRIVER_TRACE_RING_LEN - 1)];
+        if (__atomic_load_n(&slot->seq, __ATOMIC_ACQUIRE) != index + 1) {
+            continue;
+        }
+        events[count] = *slot;
+        __atomic_thread_fence(__ATOMIC_ACQUIRE);
+        if (__atomic_load_n(&slot->seq, __ATOMIC_RELAXED) != index + 1) {
+            continue; // Overwritten while copying
+        }
+        events[count].seq = index + 1;
+        count++;
+    }
+    return count;
+}
+
+/**
+ * @brief Number of transactions recorded since the last reset
+ * @return uint32_t Count, including the ones the ring no longer holds
+ */
+uint32_t DriverTrace_EventCount(void)
+{
+    return __atomic_load_n(&traceHead, __ATOMIC_RELAXED);
+}
+
+/**
+ * @brief Number of driver functions with counters
+ * @return uint16_t Count
+ */
+uint16_t DriverTrace_ApiCount(void)
+{
+    return traceApiCount;
+}
+
+/**
+ * @brief Get the counters of a driver function by index
+ * @param index 0 to DriverTrace_ApiCount() - 1, in order of first call
+ * @return const DriverTrace_Api_t* Counters, NULL if index is out of range
+ */
+const DriverTrace_Api_t *DriverTrace_GetApi(uint16_t index)
+{
+    return index < traceApiCount ? &traceApis[index] : NULL;
+}
+
+/**
+ * @brief Get the counters of a driver function by name
+ * @param name Function name, e.g. "BME280_GetTemp"
+ * @return const DriverTrace_Api_t* Counters, NULL if the function was never called
+ */
+const DriverTrace_Api_t *DriverTrace_FindApi(const char *name)
+{
+    for (uint16_t i = 0; i < traceApiCount; i++) {
+        if (strcmp(traceApis[i].name, name) == 0) {
+            return &traceApis[i];
+        }
+    }
+    return NULL;
+}
@@ -0,0 +1,108 @@
+#ifndef DRIVER_TRACE_H
+#define DRIVER_TRACE_H
+#include "main.h"
+
+/*------------------- Configuration ---------------------------*/
+#ifndef DRIVER_TRACE_RING_LEN
+#define DRIVER_TRACE_RING_LEN 64 // Transactions kept, must be a power of two
+#endif
+#ifndef DRIVER_TRACE_MAX_APIS
+#define DRIVER_TRACE_MAX_APIS 64 // Driver functions with their own counters
+#endif
+#ifndef DRIVER_TRACE_HIST_BINS
+#define DRIVER_TRACE_HIST_BINS 16
+#endif
+#ifndef DRIVER_TRACE_HIST_SHIFT
+#define DRIVER_TRACE_HIST_SHIFT 10 // Bin 0 holds calls shorter than 2^10 cycles
+#endif
+
+// Timestamp source: simulated nanoseconds on the host, the DWT cycle counter on the
+// target. Cortex-M0/M0+ have no CYCCNT, point this at a free-running timer instead.
+#ifndef DRIVER_TRACE_CYCLES
+#ifdef HOSTSIM_H
+#define DRIVER_TRACE_CYCLES() ((uint32_t)HostSim_NowNs())
+#else
+#define DRIVER_TRACE_CYCLES() (DWT->CYCCNT)
+#endif
+#endif
+
+#if (DRIVER_TRACE_RING_LEN & (DRIVER_TRACE_RING_LEN - 1)) != 0
+#error "DRIVER_TRACE_RING_LEN must be a power of two"
+#endif
+#if !defined(__GNUC__) && !defined(__clang__)
+#error "DRIVER_TRACE needs __attribute__((cleanup)), build with GCC or Clang"
+#endif
+
+/************************ Trace Defines ********************************/
+#define DRIVER_TRACE_OP_MEM_READ  0
+#define DRIVER_TRACE_OP_MEM_WRITE 1
+#define DRIVER_TRACE_OP_TRANSMIT  2
+#define DRIVER_TRACE_OP_RECEIVE   3
+
+#define DRIVER_TRACE_NO_REG 0xFFFF // Transmit/receive without a register address
+
+/************************ Trace Structs ********************************/
+typedef struct {
+    uint32_t seq;       // Position in the trace, 1 for the first transaction
+    uint32_t start;     // DRIVER_TRACE_CYCLES() before the transfer
+    uint32_t end;       // DRIVER_TRACE_CYCLES() after the transfer returned
+    const char *api;    // Outermost driver function, NULL outside of one
+    uint16_t reg;       // Register address or DRIVER_TRACE_NO_REG
+    uint16_t len;       // Data bytes
+    uint8_t device;     // I2C address as passed to the HAL (shifted)
+    uint8_t op;         // DRIVER_TRACE_OP_...
+    uint8_t status;     // HAL_StatusTypeDef
+} DriverTrace_Event_t;
+
+typedef struct {
+    const char *name;
+    uint32_t calls;
+    uint32_t transactions;
+    uint32_t bytes;
+    uint32_t errors;        // Transactions that did not return HAL_OK
+    uint32_t maxCycles;     // Longest call
+    uint64_t totalCycles;   // All calls, driver code and delays included
+    uint64_t busCycles;     // Time spent inside the transfers
+    uint32_t hist[DRIVER_TRACE_HIST_BINS]; // Call duration, log2 bins from 2^DRIVER_TRACE_HIST_SHIFT
+} DriverTrace_Api_t;
+
+// One per driver call in progress, lives on the caller's stack
+typedef struct DriverTrace_Scope {
+    struct DriverTrace_Scope *prev;
+    DriverTrace_Api_t *stats;
+    const char *api;
+    const void *handle;
+    uint32_t start;
+    uint32_t transactions;
+    uint32_t bytes;
+    uint32_t errors;
+    uint32_t busCycles;
+    uint8_t active;         // 0 when nested inside another call on the same handle
+} DriverTrace_Scope_t;
+
+/************************ Driver Hooks ********************************/
+// First statement of every traced driver function. The scope ends, and the call is
+// accounted, whenever the function returns.
+#define DRIVER_TRACE_API(handle) \
+    static DriverTrace_Api_t *driverTraceStats; \
+    DriverTrace_Scope_t driverTraceScope __attribute__((cleanup(DriverTrace_Leave))); \
+    DriverTrace_Enter(&driverTraceScope, &driverTraceStats, (handle), __func__)
+
+// Around each transfer in the driver I/O helpers
+#define DRIVER_TRACE_TXN_BEGIN() uint32_t driverTraceStart = DRIVER_TRACE_CYCLES()
+#define DRIVER_TRACE_TXN_END(device, reg, len, op, status) \
+    DriverTrace_Txn(driverTraceStart, (device), (reg), (len), (op), (status))
+
+/*------------------- Function Prototypes ---------------------------*/
+void DriverTrace_Init(void);
+void DriverTrace_Reset(void);
+void DriverTrace_Enter(DriverTrace_Scope_t *scope, DriverTrace_Api_t **stats, const void *handle, const char *api);
+void DriverTrace_Leave(DriverTrace_Scope_t *scope);
+void DriverTrace_Txn(uint32_t start, uint8_t device, uint16_t reg, uint16_t len, uint8_t op, HAL_StatusTypeDef status);
+uint16_t DriverTrace_ReadEvents(DriverTrace_Event_t *events, uint16_t max);
+uint32_t DriverTrace_EventCount(void);
+uint16_t DriverTrace_ApiCount(void);
+const DriverTrace_Api_t *DriverTrace_GetApi(uint16_t index);
+const DriverTrace_Api_t *DriverTrace_FindApi(const char *name);
+
+#endif
@@ -0,0 +1,323 @@
+#include "FastBoot.h"
+#include <string.h>
+
+/**
+ ******************************************************************************
+ * @file    FastBoot.c
+ * @author  Yair Yamin
+ * @brief   Pipelined power-up of several I2C devices as one job graph.
+ * @details Bringing the sensors up one driver Init() after another leaves the
+ * bus idle during every device-internal delay: the BME280 spends 2 ms copying
+ * its NVM after a reset while the ADS1115 and DS3231 wait their turn. Here
+ * every probe, reset, calibration read and configuration write is a job with
+ * dependencies and a minimum delay after them, and ready jobs of all devices
+ * are fed to the bus manager as soon as they are allowed to run.
+ *
+ * - Jobs are plain I2CBus transactions; a check function runs after each one
+ *   from FastBoot_Poll(), outside the interrupt, to verify or parse the data.
+ * - Among ready jobs the one with the longest chain of delays behind it goes
+ *   first, so the reset that starts the NVM copy is not queued behind bulk reads.
+ * - Only FASTBOOT_MAX_INFLIGHT jobs are handed to the bus at once, enough to
+ *   keep it busy without the client priorities reordering the graph. A slot
+ *   is not given to a job ranked below one that a transfer on the bus is
+ *   about to release.
+ * - A failed job skips everything that depends on it; the other devices finish.
+ ******************************************************************************
+ */
+
+/* ========================== Static Helpers ============================ */
+
+static void FastBoot_TxnDone(const I2CBus_Txn_t *txn, HAL_StatusTypeDef status)
+{
+    FastBoot_Job_t *job = (FastBoot_Job_t *)txn->ctx;
+
+    job->status = status;
+    job->doneUs = FASTBOOT_NOW_US();
+    job->state = FASTBOOT_JOB_COMPLETE;
+}
+
+static void FastBoot_Fail(FastBoot_t *boot, FastBoot_Job_t *job, uint8_t state, HAL_StatusTypeDef status)
+{
+    FastBoot_Device_t *dev = &boot->devices[job->device];
+
+    job->state = state;
+    job->status = status;
+    if (dev->status == HAL_OK) {
+        dev->status = status;
+    }
+}
+
+/**
+ * @brief Check completed transfers and skip jobs behind failed ones
+ * @return uint8_t Non-zero if any job changed state
+ */
+static uint8_t FastBoot_Collect(FastBoot_t *boot, uint32_t now)
+{
+    uint8_t changed = 0;
+    uint32_t failed = 0;
+
+    for (uint8_t i = 0; i < boot->jobCount; i++) {
+        FastBoot_Job_t *job = &boot->jobs[i];
+        if (job->state == FASTBOOT_JOB_COMPLETE) {
+            HAL_StatusTypeDef status = job->status;
+            if (status == HAL_OK && job->check != NULL) {
+                status = job->check(job);
+            }
+            if (status == HAL_OK) {
+                job->state = FASTBOOT_JOB_DONE;
+            } else {
+                FastBoot_Fail(boot, job, FASTBOOT_JOB_FAILED, status);
+            }
+            changed = 1;
+        }
+        if (job->state == FASTBOOT_JOB_FAILED || job->state == FASTBOOT_JOB_SKIPPED) {
+            failed |= 1UL << i;
+        } else if (job->state == FASTBOOT_JOB_WAITING && (job->deps & failed)) {
+            // Dependencies have lower ids, so one pass reaches the whole chain
+            FastBoot_Fail(boot, job, FASTBOOT_JOB_SKIPPED, HAL_ERROR);
+            job->doneUs = now;
+            failed |= 1UL << i;
+            changed = 1;
+        }
+    }
+    return changed;
+}
+
+static void FastBoot_Finish(FastBoot_t *boot)
+{
+    boot->totalUs = 0;
+    for (uint8_t i = 0; i < boot->jobCount; i++) {
+        const FastBoot_Job_t *job = &boot->jobs[i];
+        uint32_t us = job->doneUs - boot->startUs;
+        FastBoot_Device_t *dev = &boot->devices[job->device];
+        if (us > dev->initUs) {
+            dev->initUs = us;
+        }
+        if (us > boot->totalUs) {
+            boot->totalUs = us;
+        }
+    }
+    boot->finished = 1;
+}
+
+/* ========================== Function Definitions ============================ */
+
+/**
+ * @brief Clear the graph
+ * @param boot Boot graph state
+ */
+void FastBoot_Init(FastBoot_t *boot)
+{
+    memset(boot, 0, sizeof(*boot));
+}
+
+/**
+ * @brief Register a device, its jobs are reported together
+ * @param boot Boot graph state
+ * @param name For reports
+ * @param client Bus client the device's transactions are submitted through
+ * @param id Receives the device id for FastBoot_Job_t.device, may be NULL
+ * @return HAL_StatusTypeDef HAL_OK, HAL_ERROR if the device table is full
+ */
+HAL_StatusTypeDef FastBoot_AddDevice(FastBoot_t *boot, const char *name, I2CBus_Client_t *client, uint8_t *id)
+{
+    if (boot->deviceCount >= FASTBOOT_MAX_DEVICES || client == NULL) {
+        return HAL_ERROR;
+    }
+    FastBoot_Device_t *dev = &boot->devices[boot->deviceCount];
+    dev->name = name;
+    dev->client = client;
+    if (id != NULL) {
+        *id = boot->deviceCount;
+    }
+    boot->deviceCount++;
+    return HAL_OK;
+}
+
+/**
+ * @brief Add a job
+ * @param boot Boot graph state
+ * @param job Copied. Its dependencies must already be in the graph
+ * @param id Receives the job id for the deps mask of later jobs, may be NULL
+ * @return HAL_StatusTypeDef HAL_OK, HAL_ERROR if the graph is full or the job is invalid
+ */
+HAL_StatusTypeDef FastBoot_AddJob(FastBoot_t *boot, const FastBoot_Job_t *job, uint8_t *id)
+{
+    uint8_t n = boot->jobCount;
+
+    if (n >= FASTBOOT_MAX_JOBS || n >= 32 || job->device >= boot->deviceCount || (job->deps >> n) != 0) {
+        return HAL_ERROR;
+    }
+    boot->jobs[n] = *job;
+    if (id != NULL) {
+        *id = n;
+    }
+    boot->jobCount++;
+    return HAL_OK;
+}
+
+/**
+ * @brief Arm the graph, the first jobs go out with the next FastBoot_Poll()
+ * @param boot Boot graph state
+ */
+void FastBoot_Start(FastBoot_t *boot)
+{
+    // Jobs only depend on earlier ones, so one backward pass ranks them
+    for (int8_t i = (int8_t)boot->jobCount - 1; i >= 0; i--) {
+        FastBoot_Job_t *job = &boot->jobs[i];
+        job->rankUs = 0;
+        for (uint8_t k = (uint8_t)(i + 1); k < boot->jobCount; k++) {
+            const FastBoot_Job_t *next = &boot->jobs[k];
+            if ((next->deps & (1UL << i)) && next->delayUs + next->rankUs > job->rankUs) {
+                job->rankUs = next->delayUs + next->rankUs;
+            }
+        }
+        job->state = FASTBOOT_JOB_WAITING;
+        job->status = HAL_OK;
+        job->doneUs = 0;
+    }
+    for (uint8_t i = 0; i < boot->deviceCount; i++) {
+        boot->devices[i].status = HAL_OK;
+        boot->devices[i].initUs = 0;
+    }
+    boot->finished = 0;
+    boot->totalUs = 0;
+    boot->startUs = FASTBOOT_NOW_US();
+}
+
+/**
+ * @brief Check finished jobs and hand ready ones to the bus
+ * @param boot Boot graph state
+ * @return uint32_t 0 if anything happened, otherwise microseconds until the next
+ *         delay runs out (0xFFFFFFFF if only transfers are outstanding or the
+ *         graph is finished)
+ * @details Call from the main loop until boot->finished is set.
+ */
+uint32_t FastBoot_Poll(FastBoot_t *boot)
+{
+    uint32_t now = FASTBOOT_NOW_US();
+    uint32_t sleep = 0xFFFFFFFFu;
+    uint8_t changed = FastBoot_Collect(boot, now);
+    uint8_t inflight = 0;
+    uint8_t open = 0;
+
+    for (uint8_t i = 0; i < boot->jobCount; i++) {
+        uint8_t state = boot->jobs[i].state;
+        inflight += (state == FASTBOOT_JOB_QUEUED || state == FASTBOOT_JOB_COMPLETE);
+        open += (state != FASTBOOT_JOB_DONE && state != FASTBOOT_JOB_FAILED && state != FASTBOOT_JOB_SKIPPED);
+    }
+    if (open == 0) {
+        if (!boot->finished) {
+            FastBoot_Finish(boot);
+        }
+        return 0xFFFFFFFFu;
+    }
+
+    while (inflight < FASTBOOT_MAX_INFLIGHT) {
+        FastBoot_Job_t *best = NULL;
+        uint32_t nextRankUs = 0; // Best job the transfers on the bus will release
+
+        for (uint8_t i = 0; i < boot->jobCount; i++) {
+            FastBoot_Job_t *job = &boot->jobs[i];
+            uint32_t readyUs = boot->startUs;
+            uint8_t blocked = 0;
+            uint8_t onBus = 1;
+
+            if (job->state != FASTBOOT_JOB_WAITING) {
+                continue;
+            }
+            for (uint8_t k = 0; k < i; k++) {
+                if (job->deps & (1UL << k)) {
+                    uint8_t state = boot->jobs[k].state;
+                    if (state != FASTBOOT_JOB_DONE) {
+                        blocked = 1;
+                        onBus &= (state == FASTBOOT_JOB_QUEUED || state == FASTBOOT_JOB_COMPLETE);
+                    } else if ((int32_t)(boot->jobs[k].doneUs - readyUs) > 0) {
+                        readyUs = boot->jobs[k].doneUs;
+                    }
+                }
+            }
+            if (blocked) {
+                if (onBus && job->delayUs == 0 && job->rankUs + 1 > nextRankUs) {
+                    nextRankUs = job->rankUs + 1;
+                }
+                continue;
+            }
+            int32_t until = (int32_t)(readyUs + job->delayUs - now);
+            if (until > 0) {
+                if ((uint32_t)until < sleep) {
+                    sleep = (uint32_t)until;
+                }
+            } else if (best == NULL || job->rankUs > best->rankUs) {
+                best = job;
+            }
+        }
+        if (best == NULL || (inflight > 0 && best->rankUs + 1 < nextRankUs)) {
+            break; // Keep the slot for the more urgent job
+        }
+
+        I2CBus_Txn_t txn = best->txn;
+        txn.done = FastBoot_TxnDone;
+        txn.ctx = best;
+        best->state = FASTBOOT_JOB_QUEUED;
+        HAL_StatusTypeDef status = I2CBus_Submit(boot->devices[best->device].client, &txn);
+        if (status == HAL_BUSY) {
+            best->state = FASTBOOT_JOB_WAITING; // Queue full, retried after the next completion
+            break;
+        }
+        if (status != HAL_OK) {
+            best->doneUs = now;
+            FastBoot_Fail(boot, best, FASTBOOT_JOB_FAILED, status);
+        } else {
+            inflight++;
+        }
+        changed = 1;
+    }
+    return changed ? 0 : sleep;
+}
+
+/**
+ * @brief Run the whole graph, sleeping with I2CBUS_WAIT() between steps
+ * @param boot Boot graph state, filled with jobs
+ * @param timeoutUs Give up after this long
+ * @return HAL_StatusTypeDef HAL_OK if every job succeeded, HAL_TIMEOUT, or the
+ *         first device failure
+ * @details After a timeout, transfers may still be queued on the bus: boot and
+ *          the job buffers must stay valid until they complete.
+ */
+HAL_StatusTypeDef FastBoot_Run(FastBoot_t *boot, uint32_t timeoutUs)
+{
+    FastBoot_Start(boot);
+    for (;;) {
+        uint32_t idle = FastBoot_Poll(boot);
+        if (boot->finished) {
+            break;
+        }
+        if (idle == 0) {
+            continue;
+        }
+        if (FASTBOOT_NOW_US() - boot->startUs >= timeoutUs) {
+            return HAL_TIMEOUT;
+        }
+        I2CBUS_WAIT();
+    }
+    return FastBoot_Status(boot);
+}
+
+/**
+ * @brief Overall result
+ * @param boot Boot graph state
+ * @return HAL_StatusTypeDef HAL_BUSY while running, else HAL_OK or the first device failure
+ */
+HAL_StatusTypeDef FastBoot_Status(const FastBoot_t *boot)
+{
+    if (!boot->finished) {
+        return HAL_BUSY;
+    }
+    for (uint8_t i = 0; i < boot->deviceCount; i++) {
+        if (boot->devices[i].status != HAL_OK) {
+            return boot->devices[i].status;
+        }
+    }
+    return HAL_OK;
+}
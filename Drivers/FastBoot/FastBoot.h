@@ -0,0 +1,82 @@
+#ifndef FAST_BOOT_H
+#define FAST_BOOT_H
+#include "main.h"
+#include "I2CBus.h"
+
+/*------------------- Configuration ---------------------------*/
+#ifndef FASTBOOT_MAX_JOBS
+#define FASTBOOT_MAX_JOBS 16 // Jobs per boot graph, at most 32
+#endif
+
+#ifndef FASTBOOT_MAX_DEVICES
+#define FASTBOOT_MAX_DEVICES 4
+#endif
+
+#ifndef FASTBOOT_MAX_INFLIGHT
+#define FASTBOOT_MAX_INFLIGHT 2 // Jobs handed to the bus at once: one on the wire, one queued behind it
+#endif
+
+// Microsecond clock, may wrap
+#ifndef FASTBOOT_NOW_US
+#ifdef HOSTSIM_H
+#define FASTBOOT_NOW_US() ((uint32_t)(HostSim_NowNs() / 1000u))
+#else
+#define FASTBOOT_NOW_US() (HAL_GetTick() * 1000u)
+#endif
+#endif
+
+/************************ Boot Graph Structs ********************************/
+typedef struct FastBoot_Job_s FastBoot_Job_t;
+
+// Runs from FastBoot_Poll() after the transfer, e.g. to check an ID or parse calibration
+typedef HAL_StatusTypeDef (*FastBoot_Check_t)(FastBoot_Job_t *job);
+
+typedef enum {
+    FASTBOOT_JOB_WAITING = 0,  // Dependencies or delay outstanding
+    FASTBOOT_JOB_QUEUED = 1,   // Handed to the bus
+    FASTBOOT_JOB_COMPLETE = 2, // Transfer finished, check not run yet
+    FASTBOOT_JOB_DONE = 3,
+    FASTBOOT_JOB_FAILED = 4,
+    FASTBOOT_JOB_SKIPPED = 5   // A dependency failed
+} FastBoot_JobState_t;
+
+struct FastBoot_Job_s {
+    I2CBus_Txn_t txn;          // op, devAddress, memAddress, data and size; done and ctx are set by the graph
+    FastBoot_Check_t check;    // May be NULL
+    void *ctx;                 // For the check
+    uint32_t deps;             // Bit per job id that must be done first
+    uint32_t delayUs;          // Device-internal delay after the last dependency, e.g. the BME280 NVM copy
+    uint8_t device;            // Id from FastBoot_AddDevice()
+    volatile uint8_t state;    // FastBoot_JobState_t
+    volatile HAL_StatusTypeDef status;
+    uint32_t rankUs;           // Delays on the longest path from this job to the end of the graph
+    volatile uint32_t doneUs;
+};
+
+typedef struct {
+    const char *name;
+    I2CBus_Client_t *client;
+    HAL_StatusTypeDef status;  // First failure of one of its jobs
+    uint32_t initUs;           // FastBoot_Start() to its last finished job
+} FastBoot_Device_t;
+
+typedef struct {
+    FastBoot_Job_t jobs[FASTBOOT_MAX_JOBS];
+    FastBoot_Device_t devices[FASTBOOT_MAX_DEVICES];
+    uint8_t jobCount;
+    uint8_t deviceCount;
+    uint8_t finished;
+    uint32_t startUs;
+    uint32_t totalUs;          // FastBoot_Start() to the last finished job
+} FastBoot_t;
+
+/*------------------- Function Prototypes ---------------------------*/
+void FastBoot_Init(FastBoot_t *boot);
+HAL_StatusTypeDef FastBoot_AddDevice(FastBoot_t *boot, const char *name, I2CBus_Client_t *client, uint8_t *id);
+HAL_StatusTypeDef FastBoot_AddJob(FastBoot_t *boot, const FastBoot_Job_t *job, uint8_t *id);
+void FastBoot_Start(FastBoot_t *boot);
+uint32_t FastBoot_Poll(FastBoot_t *boot);
+HAL_StatusTypeDef FastBoot_Run(FastBoot_t *boot, uint32_t timeoutUs);
+HAL_StatusTypeDef FastBoot_Status(const FastBoot_t *boot);
+
+#endif
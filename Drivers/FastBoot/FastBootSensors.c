@@ -0,0 +1,185 @@
+#include "FastBootSensors.h"
+#include <string.h>
+
+/**
+ ******************************************************************************
+ * @file    FastBootSensors.c
+ * @author  Yair Yamin
+ * @brief   FastBoot jobs for the ADS1115, BME280 and DS3231 drivers.
+ * @details Each function registers a device and the transactions its driver
+ * Init() would make, split at the points where the device needs time:
+ *
+ * - BME280: ID probe, soft reset, then BME280_STARTUP_US later the two
+ *   calibration reads and the configuration write.
+ * - ADS1115: configuration write (MSB first, one transaction) and read-back.
+ * - DS3231: either one burst read of every register into the mirror, or the
+ *   time/date write DS3231_Init() makes.
+ *
+ * The handles end up as after the driver calls: IDs and calibration parsed,
+ * register mirrors filled. Handles need their bus_client set.
+ ******************************************************************************
+ */
+
+/* ========================== Static Helpers ============================ */
+
+static HAL_StatusTypeDef FastBoot_Add(FastBoot_t *boot, uint8_t device, I2CBus_Op_t op, uint16_t devAddress, uint8_t memAddress,
+                                      uint8_t *data, uint16_t size, uint32_t deps, uint32_t delayUs,
+                                      FastBoot_Check_t check, void *ctx, uint8_t *id)
+{
+    FastBoot_Job_t job;
+
+    memset(&job, 0, sizeof(job));
+    job.txn.op = (uint8_t)op;
+    job.txn.devAddress = devAddress;
+    job.txn.memAddress = memAddress;
+    job.txn.data = data;
+    job.txn.size = size;
+    job.deps = deps;
+    job.delayUs = delayUs;
+    job.check = check;
+    job.ctx = ctx;
+    job.device = device;
+    return FastBoot_AddJob(boot, &job, id);
+}
+
+static HAL_StatusTypeDef FastBoot_BME280Id(FastBoot_Job_t *job)
+{
+    FastBoot_BME280_t *dev = (FastBoot_BME280_t *)job->ctx;
+
+    dev->handle->Reg.id_reg = dev->id;
+    return (dev->id == 0x60) ? HAL_OK : HAL_ERROR;
+}
+
+static HAL_StatusTypeDef FastBoot_BME280Calib(FastBoot_Job_t *job)
+{
+    FastBoot_BME280_t *dev = (FastBoot_BME280_t *)job->ctx;
+
+    BME280_ParseCalib(dev->handle, dev->calibA, dev->calibB);
+    return HAL_OK;
+}
+
+static HAL_StatusTypeDef FastBoot_BME280Settings(FastBoot_Job_t *job)
+{
+    FastBoot_BME280_t *dev = (FastBoot_BME280_t *)job->ctx;
+
+    dev->handle->Reg.ctrl_hum_reg = dev->settings->ctrl_hum;
+    dev->handle->Reg.config_reg = dev->settings->config;
+    dev->handle->Reg.ctrl_meas_reg = dev->settings->ctrl_meas;
+    return HAL_OK;
+}
+
+static HAL_StatusTypeDef FastBoot_ADS1115Verify(FastBoot_Job_t *job)
+{
+    FastBoot_ADS1115_t *dev = (FastBoot_ADS1115_t *)job->ctx;
+    uint16_t value = (uint16_t)((dev->readback[0] << 8) | dev->readback[1]);
+
+    // OS reads back as the conversion status, not as written
+    if ((value & ~ADS1115_OS_MASK) != (dev->config & ~ADS1115_OS_MASK)) {
+        return HAL_ERROR;
+    }
+    ADS1115_LoadRegs(dev->handle, ADS1115_REG_CONFIG, dev->readback, 1);
+    dev->handle->channel = (sChannel_t)((dev->config >> 12) & 0x07);
+    return HAL_OK;
+}
+
+static HAL_StatusTypeDef FastBoot_DS3231Loaded(FastBoot_Job_t *job)
+{
+    FastBoot_DS3231_t *dev = (FastBoot_DS3231_t *)job->ctx;
+    DS3231_Handle_t *handle = dev->handle;
+
+    DS3231_InvalidateMirror(handle);
+    DS3231_LoadRegs(handle, DS3231_REG_SECONDS, dev->regs, (uint8_t)job->txn.size);
+    handle->dayOfWeek = (ds3231_dow_t)(handle->Reg[DS3231_REG_DAY] & 0x07);
+    VALID(DS3231_DecodeTime(&handle->Reg[DS3231_REG_SECONDS], &handle->time));
+    return DS3231_DecodeDate(&handle->Reg[DS3231_REG_DATE], &handle->date);
+}
+
+ /* ========================== Function Definitions ============================ */
+
+/**
+ * @brief Add the BME280 bring-up: probe, reset, calibration, configuration
+ * @param boot Boot graph
+ * @param dev Job buffers, must outlive the boot
+ * @param hbme280 Driver handle with I2C_address and bus_client set
+ * @param settings From BME280_SETTINGS(), must stay valid until the boot finishes; NULL to skip
+ * @return HAL_StatusTypeDef HAL_OK, HAL_ERROR if the graph is full
+ */
+HAL_StatusTypeDef FastBoot_AddBME280(FastBoot_t *boot, FastBoot_BME280_t *dev, BME280_Handle_t *hbme280, const BME280_Settings_t *settings)
+{
+    static const uint8_t resetWord = BME280_RESET_WORD;
+    uint16_t addr = hbme280->I2C_address;
+    uint8_t device, probe, reset, calibA;
+
+    memset(dev, 0, sizeof(*dev));
+    dev->handle = hbme280;
+    dev->settings = settings;
+    VALID(FastBoot_AddDevice(boot, "bme280", hbme280->bus_client, &device));
+    VALID(FastBoot_Add(boot, device, I2CBUS_MEM_READ, addr, BME280_ID_REG, &dev->id, 1,
+                       0, 0, FastBoot_BME280Id, dev, &probe));
+    VALID(FastBoot_Add(boot, device, I2CBUS_MEM_WRITE, addr, BME280_RESET_REG, (uint8_t *)&resetWord, 1,
+                       1UL << probe, 0, NULL, dev, &reset));
+    VALID(FastBoot_Add(boot, device, I2CBUS_MEM_READ, addr, BME280_CALIB_A_REG, dev->calibA, BME280_CALIB_A_LEN,
+                       1UL << reset, BME280_STARTUP_US, NULL, dev, &calibA));
+    VALID(FastBoot_Add(boot, device, I2CBUS_MEM_READ, addr, BME280_CALIB_B_REG, dev->calibB, BME280_CALIB_B_LEN,
+                       1UL << calibA, 0, FastBoot_BME280Calib, dev, NULL));
+    if (settings != NULL) {
+        VALID(FastBoot_Add(boot, device, I2CBUS_MEM_WRITE, addr, BME280_CTRL_HUM_REG, (uint8_t *)settings, sizeof(*settings),
+                           1UL << reset, BME280_STARTUP_US, FastBoot_BME280Settings, dev, NULL));
+    }
+    return HAL_OK;
+}
+
+/**
+ * @brief Add the ADS1115 bring-up: configuration write and read-back
+ * @param boot Boot graph
+ * @param dev Job buffers, must outlive the boot
+ * @param hads1115 Driver handle with I2C_address and bus_client set
+ * @param config Register word, e.g. from ADS1115_CONFIG()
+ * @return HAL_StatusTypeDef HAL_OK, HAL_ERROR if the graph is full
+ * @details The chip has no ID register, the read-back doubles as the probe.
+ */
+HAL_StatusTypeDef FastBoot_AddADS1115(FastBoot_t *boot, FastBoot_ADS1115_t *dev, ADS1115_Handle_t *hads1115, uint16_t config)
+{
+    uint16_t addr = hads1115->I2C_address;
+    uint8_t device, write;
+
+    memset(dev, 0, sizeof(*dev));
+    dev->handle = hads1115;
+    dev->config = config;
+    dev->wire[0] = (uint8_t)(config >> 8);
+    dev->wire[1] = (uint8_t)config;
+    VALID(FastBoot_AddDevice(boot, "ads1115", hads1115->bus_client, &device));
+    VALID(FastBoot_Add(boot, device, I2CBUS_MEM_WRITE, addr, ADS1115_REG_CONFIG, dev->wire, 2,
+                       0, 0, NULL, dev, &write));
+    return FastBoot_Add(boot, device, I2CBUS_MEM_READ, addr, ADS1115_REG_CONFIG, dev->readback, 2,
+                        1UL << write, 0, FastBoot_ADS1115Verify, dev, NULL);
+}
+
+/**
+ * @brief Add the DS3231 bring-up
+ * @param boot Boot graph
+ * @param dev Job buffers, must outlive the boot
+ * @param hrtc Driver handle with I2C_address and bus_client set
+ * @param setTime 0: read every register into the mirror and decode the time,
+ *        date and day (a clock that kept running). 1: write time, date and day
+ *        from the handle in one burst, like DS3231_Init()
+ * @return HAL_StatusTypeDef HAL_OK, HAL_ERROR if the graph is full or the handle time is invalid
+ */
+HAL_StatusTypeDef FastBoot_AddDS3231(FastBoot_t *boot, FastBoot_DS3231_t *dev, DS3231_Handle_t *hrtc, uint8_t setTime)
+{
+    uint16_t addr = hrtc->I2C_address;
+    uint8_t device;
+
+    memset(dev, 0, sizeof(*dev));
+    dev->handle = hrtc;
+    VALID(FastBoot_AddDevice(boot, "ds3231", hrtc->bus_client, &device));
+    if (!setTime) {
+        return FastBoot_Add(boot, device, I2CBUS_MEM_READ, addr, DS3231_REG_SECONDS, dev->regs, DS3231_REG_COUNT,
+                            0, 0, FastBoot_DS3231Loaded, dev, NULL);
+    }
+    VALID(DS3231_EncodeTime(&hrtc->time, &dev->regs[DS3231_REG_SECONDS]));
+    dev->regs[DS3231_REG_DAY] = (uint8_t)hrtc->dayOfWeek;
+    VALID(DS3231_EncodeDate(&hrtc->date, &dev->regs[DS3231_REG_DATE]));
+    return FastBoot_Add(boot, device, I2CBUS_MEM_WRITE, addr, DS3231_REG_SECONDS, dev->regs, DS3231_REG_YEAR + 1,
+                        0, 0, FastBoot_DS3231Loaded, dev, NULL);
+}
@@ -0,0 +1,47 @@
+#ifndef FAST_BOOT_SENSORS_H
+#define FAST_BOOT_SENSORS_H
+#include "FastBoot.h"
+#include "ADS1115.h"
+#include "BME280.h"
+#include "DS3231.h"
+
+/*------------------- Configuration ---------------------------*/
+// The jobs go through the handles' bus_client
+#ifndef USE_I2CBUS
+#error "FastBootSensors needs USE_I2CBUS"
+#endif
+
+/************************ Device Job Structs ********************************/
+// Transfer buffers of each device's jobs; keep them alive until the boot finishes.
+// They are DMA buffers, in their own cache lines with DRIVERS_DCACHE.
+
+typedef struct {
+    BME280_Handle_t *handle;
+    const BME280_Settings_t *settings; // NULL leaves the sensor in sleep mode with power-on settings
+    DMACACHE_REGION(bufLines, struct {
+        uint8_t id;
+        uint8_t calibA[BME280_CALIB_A_LEN];
+        uint8_t calibB[BME280_CALIB_B_LEN];
+    });
+} FastBoot_BME280_t;
+
+typedef struct {
+    ADS1115_Handle_t *handle;
+    uint16_t config;
+    DMACACHE_REGION(bufLines, struct {
+        uint8_t wire[2];     // config, MSB first
+        uint8_t readback[2];
+    });
+} FastBoot_ADS1115_t;
+
+typedef struct {
+    DS3231_Handle_t *handle;
+    DMACACHE_REGION(bufLines, uint8_t regs[DS3231_REG_COUNT]); // Seconds ... temperature, or the time and date written when setting the clock
+} FastBoot_DS3231_t;
+
+/*------------------- Function Prototypes ---------------------------*/
+HAL_StatusTypeDef FastBoot_AddBME280(FastBoot_t *boot, FastBoot_BME280_t *dev, BME280_Handle_t *hbme280, const BME280_Settings_t *settings);
+HAL_StatusTypeDef FastBoot_AddADS1115(FastBoot_t *boot, FastBoot_ADS1115_t *dev, ADS1115_Handle_t *hads1115, uint16_t config);
+HAL_StatusTypeDef FastBoot_AddDS3231(FastBoot_t *boot, FastBoot_DS3231_t *dev, DS3231_Handle_t *hrtc, uint8_t setTime);
+
+#endif
@@ -0,0 +1,214 @@
+#include "AcqBench.h"
+#include "SimADS1115.h"
+#include "SimBME280.h"
+#include "SimDS3231.h"
+#include <stdlib.h>
+#include <string.h>
+
+/**
+ ******************************************************************************
+ * @file    AcqBench.c
+ * @author  Yair Yamin
+ * @brief   Fixed polling loop against AcqSched on the simulated devices.
+ * @details Samples the same channels both ways for a number of simulated
+ * seconds and reports, per channel, the achieved rate, how late the samples
+ * were taken and how many were skipped:
+ *
+ * - BME280 temperature/pressure/humidity at x2 oversampling, 20 Hz
+ * - ADS1115 AIN0 and AIN1 at 250 SPS, 100 Hz each
+ * - DS3231 forced temperature conversion, 1 Hz
+ * - DS3231 time and date, 1 Hz
+ *
+ * The fixed loop is the usual firmware pattern: visit every channel that is
+ * due, trigger it, HAL_Delay() for its conversion time, read it, repeat.
+ ******************************************************************************
+ */
+
+/* ========================== Defines ============================ */
+#define ADS1115_ADDR (0x48 << 1)
+#define BME280_ADDR  (0x76 << 1)
+#define DS3231_ADDR  (0x68 << 1)
+#define ACQ_BENCH_CHANNELS 5
+
+/************************ Bench Context ********************************/
+typedef struct {
+    I2C_HandleTypeDef hi2c;
+    SimADS1115_t simAds;
+    SimBME280_t simBme;
+    SimDS3231_t simRtc;
+    ADS1115_Handle_t ads;
+    BME280_Handle_t bme;
+    DS3231_Handle_t rtc;
+    AcqSched_t sched;
+} AcqBench_Ctx_t;
+
+static const char *const channelNames[ACQ_BENCH_CHANNELS] = {
+    "bme280", "ads1115_ain0", "ads1115_ain1", "ds3231_temp", "ds3231_time",
+};
+
+/* ========================== Static Helpers ============================ */
+
+static void AcqBench_Setup(AcqBench_Ctx_t *ctx)
+{
+    AcqSched_Config_t config;
+
+    memset(ctx, 0, sizeof(*ctx));
+    HostSim_Reset();
+    HostSim_I2CInit(&ctx->hi2c, 400000, HOSTSIM_DMA_IMMEDIATE);
+    SimADS1115_Init(&ctx->simAds, ADS1115_ADDR);
+    SimBME280_Init(&ctx->simBme, BME280_ADDR);
+    SimDS3231_Init(&ctx->simRtc, DS3231_ADDR);
+    HostSim_Attach(&ctx->hi2c, &ctx->simAds.dev);
+    HostSim_Attach(&ctx->hi2c, &ctx->simBme.dev);
+    HostSim_Attach(&ctx->hi2c, &ctx->simRtc.dev);
+
+    ctx->ads.i2c_handle = &ctx->hi2c;
+    ctx->ads.I2C_address = ADS1115_ADDR;
+    ctx->bme.i2c_handle = &ctx->hi2c;
+    ctx->bme.I2C_address = BME280_ADDR;
+    ctx->rtc.i2c_handle = &ctx->hi2c;
+    ctx->rtc.I2C_address = DS3231_ADDR;
+    ADS1115_Init(&ctx->ads, ADS1115_MODE_SINGLESHOT_MASK, AIN0, ADS1115_PGA_4_096V_MASK, ADS1115_DR_250SPS_MASK);
+    BME280_Init(&ctx->bme);
+    BME280_SetOSVals(&ctx->bme, BME280_MODE_SLEEP, BME280_OS_TEMP_x2, BME280_OS_PRESS_x2, BME280_OS_HUM_x2);
+    DS3231_Init(&ctx->rtc);
+
+    AcqSched_Init(&ctx->sched);
+    AcqSched_BME280Config(&config, &ctx->bme, 50000);
+    AcqSched_Add(&ctx->sched, &config, NULL);
+    AcqSched_ADS1115Config(&config, &ctx->ads, AIN0, 10000);
+    AcqSched_Add(&ctx->sched, &config, NULL);
+    AcqSched_ADS1115Config(&config, &ctx->ads, AIN1, 10000);
+    config.phaseUs = 5000; // Half a period after AIN0, both convert on the same chip
+    AcqSched_Add(&ctx->sched, &config, NULL);
+    AcqSched_DS3231TempConfig(&config, &ctx->rtc, 1000000);
+    AcqSched_Add(&ctx->sched, &config, NULL);
+    AcqSched_DS3231TimeConfig(&config, &ctx->rtc, 1000000);
+    AcqSched_Add(&ctx->sched, &config, NULL);
+}
+
+/**
+ * @brief Sample the channels the blocking way, with the scheduler's bookkeeping
+ */
+static void AcqBench_FixedLoop(AcqBench_Ctx_t *ctx, uint32_t endUs)
+{
+    AcqSched_t *sched = &ctx->sched;
+
+    while ((int32_t)(ACQSCHED_NOW_US() - endUs) < 0) {
+        uint8_t idle = 1;
+        for (uint8_t i = 0; i < sched->count; i++) {
+            AcqSched_Channel_t *ch = &sched->channels[i];
+            uint32_t now = ACQSCHED_NOW_US();
+            uint32_t late = now - ch->releaseUs;
+            if ((int32_t)late < 0) {
+                continue;
+            }
+            idle = 0;
+            if (late >= ch->config.periodUs) {
+                ch->stats.misses += late / ch->config.periodUs;
+                ch->releaseUs += (late / ch->config.periodUs) * ch->config.periodUs;
+                late %= ch->config.periodUs;
+            }
+            ch->releaseUs += ch->config.periodUs;
+            if (ch->config.trigger != NULL) {
+                ch->config.trigger(ch);
+                HAL_Delay((ch->config.convUs + 999u) / 1000u);
+            }
+            while (ch->config.read(ch) == HAL_BUSY) {
+                HAL_Delay(1);
+            }
+            if (ch->stats.samples++ == 0) {
+                ch->stats.firstUs = now;
+            }
+            ch->stats.lastUs = now;
+            ch->stats.sumLateUs += late;
+            if (late > ch->stats.maxLateUs) {
+                ch->stats.maxLateUs = late;
+            }
+        }
+        if (idle) {
+            HAL_Delay(1); // Loop tick
+        }
+    }
+}
+
+ /* ========================== Function Definitions ============================ */
+
+/**
+ * @brief Run the channel set for a number of simulated seconds
+ * @param useSched 1 for AcqSched, 0 for the fixed loop
+ * @param seconds Simulated run time
+ * @param results One result per channel
+ * @param max Capacity of results
+ * @return uint8_t Number of results
+ */
+uint8_t AcqBench_Run(uint8_t useSched, uint32_t seconds, AcqBench_Result_t *results, uint8_t max)
+{
+    static AcqBench_Ctx_t ctx;
+    uint8_t count = 0;
+
+    AcqBench_Setup(&ctx);
+    HostSim_ClearStats(&ctx.hi2c);
+    AcqSched_Start(&ctx.sched);
+    uint32_t endUs = ctx.sched.startUs + seconds * 1000000u;
+
+    if (useSched) {
+        while ((int32_t)(ACQSCHED_NOW_US() - endUs) < 0) {
+            uint32_t idle = AcqSched_Poll(&ctx.sched);
+            uint32_t left = endUs - ACQSCHED_NOW_US();
+            if (idle != 0) {
+                HostSim_AdvanceUs(idle < left ? idle : left);
+            }
+        }
+    } else {
+        AcqBench_FixedLoop(&ctx, endUs);
+    }
+
+    uint32_t util = (uint32_t)(ctx.hi2c.stats.busyNs / ((uint64_t)seconds * 1000000u));
+    for (uint8_t i = 0; i < ctx.sched.count && count < max; i++) {
+        const AcqSched_Channel_t *ch = &ctx.sched.channels[i];
+        AcqBench_Result_t *r = &results[count++];
+        snprintf(r->mode, sizeof(r->mode), "%s", useSched ? "acqsched" : "fixed_loop");
+        snprintf(r->channel, sizeof(r->channel), "%s", channelNames[i]);
+        r->periodUs = ch->config.periodUs;
+        r->rateMilliHz = AcqSched_RateMilliHz(ch);
+        r->meanLateUs = AcqSched_MeanLateUs(ch);
+        r->maxLateUs = ch->stats.maxLateUs;
+        r->misses = ch->stats.misses;
+        r->busUtilPermille = util;
+    }
+    return count;
+}
+
+/**
+ * @brief Write results as CSV with a header line
+ */
+void AcqBench_WriteCsv(FILE *out, const AcqBench_Result_t *results, uint8_t count)
+{
+    fprintf(out, "mode,channel,target_hz,achieved_hz,mean_late_us,max_late_us,misses,bus_util_pct\n");
+    for (uint8_t i = 0; i < count; i++) {
+        const AcqBench_Result_t *r = &results[i];
+        fprintf(out, "%s,%s,%.3f,%.3f,%u,%u,%u,%.1f\n", r->mode, r->channel, 1e6 / r->periodUs,
+                r->rateMilliHz / 1000.0, r->meanLateUs, r->maxLateUs, r->misses, r->busUtilPermille / 10.0);
+    }
+}
+
+/**
+ * @brief Command line entry: [seconds]
+ * @return int 0, 2 on usage errors
+ */
+int AcqBench_Main(int argc, char **argv)
+{
+    AcqBench_Result_t results[2 * ACQ_BENCH_CHANNELS];
+    uint32_t seconds = 60;
+    uint8_t count = 0;
+
+    if (argc > 2 || (argc == 2 && (seconds = (uint32_t)strtoul(argv[1], NULL, 10)) == 0)) {
+        fprintf(stderr, "usage: %s [seconds]\n", argv[0]);
+        return 2;
+    }
+    count += AcqBench_Run(0, seconds, &results[count], ACQ_BENCH_CHANNELS);
+    count += AcqBench_Run(1, seconds, &results[count], ACQ_BENCH_CHANNELS);
+    AcqBench_WriteCsv(stdout, results, count);
+    return 0;
+}
@@ -0,0 +1,26 @@
+#ifndef ACQ_BENCH_H
+#define ACQ_BENCH_H
+#include "AcqSchedSensors.h"
+#include <stdio.h>
+
+/*------------------- Configuration ---------------------------*/
+#define ACQ_BENCH_NAME_LEN 24
+
+/************************ Bench Structs ********************************/
+typedef struct {
+    char mode[12];          // "fixed_loop" or "acqsched"
+    char channel[ACQ_BENCH_NAME_LEN];
+    uint32_t periodUs;      // Requested sample period
+    uint32_t rateMilliHz;   // Achieved sample rate
+    uint32_t meanLateUs;    // Trigger delay after the due time
+    uint32_t maxLateUs;
+    uint32_t misses;        // Samples skipped
+    uint32_t busUtilPermille; // SCL busy time over the run, all channels
+} AcqBench_Result_t;
+
+/*------------------- Function Prototypes ---------------------------*/
+uint8_t AcqBench_Run(uint8_t useSched, uint32_t seconds, AcqBench_Result_t *results, uint8_t max);
+void AcqBench_WriteCsv(FILE *out, const AcqBench_Result_t *results, uint8_t count);
+int AcqBench_Main(int argc, char **argv);
+
+#endif
@@ -0,0 +1,235 @@
+#include "BootBench.h"
+#include "SimADS1115.h"
+#include "SimBME280.h"
+#include "SimDS3231.h"
+#include <stdlib.h>
+#include <string.h>
+
+/**
+ ******************************************************************************
+ * @file    BootBench.c
+ * @author  Yair Yamin
+ * @brief   Sequential driver Init() calls against the FastBoot job graph.
+ * @details Brings the three simulated devices up from power-on both ways,
+ * with DMA completions arriving after the wire time:
+ *
+ * - sequential: DS3231_Init(), then BME280_SoftReset(), HAL_Delay() for the
+ *   NVM copy, BME280_Init() and BME280_ApplySettings(), then ADS1115_Init(),
+ *   each call waiting for its own transfers.
+ * - fastboot: the same work as one FastBoot graph, plus the ADS1115 read-back.
+ *
+ * Per device it reports the time from the start of the boot until the device
+ * was ready, and for the whole boot the transactions and SCL busy time.
+ ******************************************************************************
+ */
+
+/* ========================== Defines ============================ */
+#define ADS1115_ADDR (0x48 << 1)
+#define BME280_ADDR  (0x76 << 1)
+#define DS3231_ADDR  (0x68 << 1)
+
+/************************ Bench Context ********************************/
+typedef struct {
+    I2C_HandleTypeDef hi2c;
+    SimADS1115_t simAds;
+    SimBME280_t simBme;
+    SimDS3231_t simRtc;
+    I2CBus_t bus;
+    I2CBus_Client_t adsClient, bmeClient, rtcClient;
+    ADS1115_Handle_t ads;
+    BME280_Handle_t bme;
+    DS3231_Handle_t rtc;
+    FastBoot_t boot;
+    FastBoot_ADS1115_t bootAds;
+    FastBoot_BME280_t bootBme;
+    FastBoot_DS3231_t bootRtc;
+} BootBench_Ctx_t;
+
+static const BME280_Settings_t bmeSettings = BME280_SETTINGS(BME280_MODE_NORMAL, BME280_OS_TEMP_x2, BME280_OS_PRESS_x16,
+                                                             BME280_OS_HUM_x1, BME280_STANDBY_62_5MS, BME280_FILTER_x16);
+static const uint16_t adsConfig = ADS1115_CONFIG(AIN0, PGA_4_096V, SPS_860, 1);
+
+/* ========================== Static Helpers ============================ */
+
+static void BootBench_Setup(BootBench_Ctx_t *ctx, uint32_t busHz)
+{
+    memset(ctx, 0, sizeof(*ctx));
+    HostSim_Reset();
+    HostSim_I2CInit(&ctx->hi2c, busHz, HOSTSIM_DMA_DEFERRED);
+    SimADS1115_Init(&ctx->simAds, ADS1115_ADDR);
+    SimBME280_Init(&ctx->simBme, BME280_ADDR);
+    SimDS3231_Init(&ctx->simRtc, DS3231_ADDR);
+    HostSim_Attach(&ctx->hi2c, &ctx->simAds.dev);
+    HostSim_Attach(&ctx->hi2c, &ctx->simBme.dev);
+    HostSim_Attach(&ctx->hi2c, &ctx->simRtc.dev);
+
+    I2CBus_Init(&ctx->bus, &ctx->hi2c);
+    I2CBus_ClientInit(&ctx->adsClient, &ctx->bus, "ads1115", I2CBUS_PRIO_NORMAL);
+    I2CBus_ClientInit(&ctx->bmeClient, &ctx->bus, "bme280", I2CBUS_PRIO_NORMAL);
+    I2CBus_ClientInit(&ctx->rtcClient, &ctx->bus, "ds3231", I2CBUS_PRIO_NORMAL);
+    ctx->ads.i2c_handle = &ctx->hi2c;
+    ctx->ads.bus_client = &ctx->adsClient;
+    ctx->ads.I2C_address = ADS1115_ADDR;
+    ctx->bme.i2c_handle = &ctx->hi2c;
+    ctx->bme.bus_client = &ctx->bmeClient;
+    ctx->bme.I2C_address = BME280_ADDR;
+    ctx->rtc.i2c_handle = &ctx->hi2c;
+    ctx->rtc.bus_client = &ctx->rtcClient;
+    ctx->rtc.I2C_address = DS3231_ADDR;
+    ctx->rtc.time = (ds3231_time_t){.hours = 12, .minutes = 0, .seconds = 0};
+    ctx->rtc.date = (ds3231_data_t){.date = 1, .month = 1, .year = 25};
+    ctx->rtc.dayOfWeek = Wednesday;
+}
+
+static uint32_t BootBench_Us(uint64_t startNs)
+{
+    return (uint32_t)((HostSim_NowNs() - startNs) / 1000u);
+}
+
+static void BootBench_Sequential(BootBench_Ctx_t *ctx, BootBench_Result_t *dev)
+{
+    uint64_t start = HostSim_NowNs();
+    HAL_StatusTypeDef status;
+
+    dev[0].status = DS3231_Init(&ctx->rtc);
+    dev[0].initUs = BootBench_Us(start);
+
+    status = BME280_SoftReset(&ctx->bme);
+    if (status == HAL_OK) {
+        HAL_Delay((BME280_STARTUP_US + 999) / 1000);
+        status = BME280_Init(&ctx->bme);
+    }
+    if (status == HAL_OK) {
+        status = BME280_ApplySettings(&ctx->bme, &bmeSettings);
+    }
+    dev[1].status = status;
+    dev[1].initUs = BootBench_Us(start);
+
+    dev[2].status = ADS1115_Init(&ctx->ads, ADS1115_MODE_SINGLESHOT_MASK, AIN0, ADS1115_PGA_4_096V_MASK, ADS1115_DR_860SPS_MASK);
+    dev[2].initUs = BootBench_Us(start);
+}
+
+/**
+ * @brief Run the graph, advancing simulated time to the next completion or delay
+ */
+static void BootBench_FastBoot(BootBench_Ctx_t *ctx, BootBench_Result_t *dev)
+{
+    FastBoot_t *boot = &ctx->boot;
+
+    FastBoot_Init(boot);
+    FastBoot_AddDS3231(boot, &ctx->bootRtc, &ctx->rtc, 1);
+    FastBoot_AddBME280(boot, &ctx->bootBme, &ctx->bme, &bmeSettings);
+    FastBoot_AddADS1115(boot, &ctx->bootAds, &ctx->ads, adsConfig);
+
+    FastBoot_Start(boot);
+    while (!boot->finished) {
+        uint32_t idle = FastBoot_Poll(boot);
+        if (boot->finished || idle == 0) {
+            continue;
+        }
+        if (ctx->hi2c.pendingCplt != HOSTSIM_CPLT_NONE) {
+            uint64_t wireNs = ctx->hi2c.busyUntilNs - HostSim_NowNs();
+            HostSim_AdvanceNs(wireNs < (uint64_t)idle * 1000u ? wireNs : (uint64_t)idle * 1000u);
+        } else if (idle != 0xFFFFFFFFu) {
+            HostSim_AdvanceUs(idle);
+        } else {
+            break; // Nothing on the wire and nothing scheduled: the graph is stuck
+        }
+    }
+    for (uint8_t i = 0; i < BOOT_BENCH_DEVICES && i < boot->deviceCount; i++) {
+        dev[i].initUs = boot->devices[i].initUs;
+        dev[i].status = boot->devices[i].status;
+    }
+}
+
+/* ========================== Function Definitions ============================ */
+
+/**
+ * @brief Boot the simulated devices once
+ * @param useFastBoot 0 for the sequential Init() calls, 1 for the FastBoot graph
+ * @param busHz SCL frequency
+ * @param results One result per device and a "total" row
+ * @param max Capacity of results, at least BOOT_BENCH_DEVICES + 1
+ * @return uint8_t Number of results, 0 if max is too small
+ */
+uint8_t BootBench_Run(uint8_t useFastBoot, uint32_t busHz, BootBench_Result_t *results, uint8_t max)
+{
+    static BootBench_Ctx_t ctx;
+    static const char *const names[BOOT_BENCH_DEVICES] = {"ds3231", "bme280", "ads1115"};
+    BootBench_Result_t *total = &results[BOOT_BENCH_DEVICES];
+
+    if (max < BOOT_BENCH_DEVICES + 1) {
+        return 0;
+    }
+    memset(results, 0, (BOOT_BENCH_DEVICES + 1) * sizeof(*results));
+    BootBench_Setup(&ctx, busHz);
+    if (useFastBoot) {
+        BootBench_FastBoot(&ctx, results);
+    } else {
+        BootBench_Sequential(&ctx, results);
+    }
+
+    total->device = "total";
+    total->status = HAL_OK;
+    for (uint8_t i = 0; i < BOOT_BENCH_DEVICES; i++) {
+        results[i].device = names[i];
+        if (results[i].initUs > total->initUs) {
+            total->initUs = results[i].initUs;
+        }
+        if (total->status == HAL_OK) {
+            total->status = results[i].status;
+        }
+    }
+    total->transactions = (uint32_t)ctx.hi2c.stats.transactions;
+    total->busyUs = (uint32_t)(ctx.hi2c.stats.busyNs / 1000u);
+    for (uint8_t i = 0; i <= BOOT_BENCH_DEVICES; i++) {
+        results[i].mode = useFastBoot ? "fastboot" : "sequential";
+        results[i].busHz = busHz;
+    }
+    return BOOT_BENCH_DEVICES + 1;
+}
+
+/**
+ * @brief Write results as CSV with a header line
+ */
+void BootBench_WriteCsv(FILE *out, const BootBench_Result_t *results, uint8_t count)
+{
+    fprintf(out, "mode,bus_hz,device,init_us,transactions,bus_busy_us,status\n");
+    for (uint8_t i = 0; i < count; i++) {
+        const BootBench_Result_t *r = &results[i];
+        fprintf(out, "%s,%lu,%s,%lu,%lu,%lu,%d\n", r->mode, (unsigned long)r->busHz, r->device, (unsigned long)r->initUs,
+                (unsigned long)r->transactions, (unsigned long)r->busyUs, (int)r->status);
+    }
+}
+
+/**
+ * @brief Command line entry: [bus_hz]
+ * @return int 0, 1 if a device failed to come up, 2 on usage errors
+ */
+int BootBench_Main(int argc, char **argv)
+{
+    static const uint32_t speeds[] = {100000, 400000, 1000000};
+    BootBench_Result_t results[2 * 3 * (BOOT_BENCH_DEVICES + 1)];
+    uint32_t busHz = 0;
+    uint8_t count = 0;
+    int failed = 0;
+
+    if (argc > 2 || (argc == 2 && (busHz = (uint32_t)strtoul(argv[1], NULL, 10)) == 0)) {
+        fprintf(stderr, "usage: %s [bus_hz]\n", argv[0]);
+        return 2;
+    }
+    for (uint8_t s = 0; s < 3; s++) {
+        uint32_t hz = busHz ? busHz : speeds[s];
+        for (uint8_t fast = 0; fast <= 1; fast++) {
+            count += BootBench_Run(fast, hz, &results[count], (uint8_t)(sizeof(results) / sizeof(results[0]) - count));
+        }
+        if (busHz) {
+            break;
+        }
+    }
+    for (uint8_t i = 0; i < count; i++) {
+        failed |= (results[i].status != HAL_OK);
+    }
+    BootBench_WriteCsv(stdout, results, count);
+    return failed;
+}
@@ -0,0 +1,28 @@
+#ifndef BOOT_BENCH_H
+#define BOOT_BENCH_H
+#include "FastBootSensors.h"
+#include <stdio.h>
+
+/*------------------- Configuration ---------------------------*/
+#ifndef USE_I2CBUS
+#error "BootBench needs USE_I2CBUS"
+#endif
+#define BOOT_BENCH_DEVICES 3
+
+/************************ Bench Structs ********************************/
+typedef struct {
+    const char *mode;       // "sequential" or "fastboot"
+    const char *device;     // Driver, or "total"
+    uint32_t busHz;
+    uint32_t initUs;        // Boot start to the device's last transfer (sequential: its own Init calls)
+    uint32_t transactions;  // Bus transactions over the whole boot, "total" row only
+    uint32_t busyUs;        // SCL busy time over the whole boot, "total" row only
+    HAL_StatusTypeDef status;
+} BootBench_Result_t;
+
+/*------------------- Function Prototypes ---------------------------*/
+uint8_t BootBench_Run(uint8_t useFastBoot, uint32_t busHz, BootBench_Result_t *results, uint8_t max);
+void BootBench_WriteCsv(FILE *out, const BootBench_Result_t *results, uint8_t count);
+int BootBench_Main(int argc, char **argv);
+
+#endif
@@ -0,0 +1,392 @@
+#define _POSIX_C_SOURCE 200809L // clock_gettime
+#include "DriverBench.h"
+#include "ADS1115.h"
+#include "BME280.h"
+#include "DS3231.h"
+#include "SimADS1115.h"
+#include "SimBME280.h"
+#include "SimDS3231.h"
+#include <string.h>
+#include <time.h>
+
+/**
+ ******************************************************************************
+ * @file    DriverBench.c
+ * @author  Yair Yamin
+ * @brief   Bus-cost benchmark of every public driver call on the simulated HAL.
+ * @details Runs a fixed script of ADS1115, BME280 and DS3231 calls against
+ * fresh device models and records, per call, the transactions, bytes on the
+ * wire, SCL busy time, simulated wall time (HAL_Delay included) and host CPU
+ * time.
+ *
+ * The script order is part of the benchmark: the DS3231 register mirror makes
+ * a call cheaper when an earlier call already loaded the registers it needs.
+ * Everything except CPU time is deterministic, so DriverBench_Compare() treats
+ * any increase over a stored baseline as a regression.
+ *
+ * DMA transfers complete immediately so back-to-back driver calls are
+ * measured as they are issued. With USE_I2CBUS the drivers go through the bus
+ * manager, which needs I2CBUS_HAL_CALLBACKS.
+ ******************************************************************************
+ */
+
+/* ========================== Defines ============================ */
+#define ADS1115_ADDR (0x48 << 1)
+#define BME280_ADDR  (0x76 << 1)
+#define DS3231_ADDR  (0x68 << 1)
+
+/************************ Bench Context ********************************/
+typedef struct {
+    I2C_HandleTypeDef *hi2c;
+    uint32_t busHz;
+    DriverBench_Result_t *results;
+    uint16_t max;
+    uint16_t count;
+    HostSim_BusStats_t stats; // Counters when the measured call started
+    uint64_t startNs;
+    uint64_t startCpuNs;
+} DriverBench_Ctx_t;
+
+// Measure one driver call; expr must evaluate to its HAL_StatusTypeDef
+#define BENCH(ctx, name, expr) do { DriverBench_Begin(ctx); int st_ = (int)(expr); DriverBench_End(ctx, name, st_); } while (0)
+
+/* ========================== Static Helpers ============================ */
+
+static uint64_t DriverBench_CpuNs(void)
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_PROCESS_CPUTIME_ID, &ts);
+    return (uint64_t)ts.tv_sec * 1000000000u + (uint64_t)ts.tv_nsec;
+}
+
+static void DriverBench_Begin(DriverBench_Ctx_t *ctx)
+{
+    ctx->stats = ctx->hi2c->stats;
+    ctx->startNs = HostSim_NowNs();
+    ctx->startCpuNs = DriverBench_CpuNs();
+}
+
+static void DriverBench_End(DriverBench_Ctx_t *ctx, const char *name, int status)
+{
+    uint64_t cpuNs = DriverBench_CpuNs() - ctx->startCpuNs;
+    if (ctx->count >= ctx->max) {
+        return;
+    }
+    DriverBench_Result_t *r = &ctx->results[ctx->count++];
+    memset(r, 0, sizeof(*r));
+    strncpy(r->name, name, DRIVER_BENCH_NAME_LEN - 1);
+    r->busHz = ctx->busHz;
+    r->transactions = (uint32_t)(ctx->hi2c->stats.transactions - ctx->stats.transactions);
+    r->bytes = (uint32_t)(ctx->hi2c->stats.bytes - ctx->stats.bytes);
+    r->busyNs = ctx->hi2c->stats.busyNs - ctx->stats.busyNs;
+    r->wallNs = HostSim_NowNs() - ctx->startNs;
+    r->cpuNs = cpuNs;
+    r->status = status;
+}
+
+// Same settings as the ADS1115_Init() and BME280_SetOSVals()/SetConfig() calls,
+// for comparing the run-time and compile-time configuration paths
+static const uint16_t adsConfig = ADS1115_CONFIG(AIN0, PGA_2_048V, SPS_860, 1);
+_Static_assert(ADS1115_CONFIG(AIN0, PGA_2_048V, SPS_860, 1) == ((AIN0 << 12) | ADS1115_PGA_2_048V_MASK |
+               ADS1115_MODE_SINGLESHOT_MASK | ADS1115_DR_860SPS_MASK | ADS1115_COMP_QUE_DISABLE_MASK), "ADS1115_CONFIG mismatch");
+static const BME280_Settings_t bmeSettings = BME280_SETTINGS(BME280_MODE_FORCED, BME280_OS_TEMP_x1, BME280_OS_PRESS_x1,
+                                                             BME280_OS_HUM_x1, BME280_STANDBY_0_5MS, BME280_FILTER_OFF);
+
+static void DriverBench_ADS1115(DriverBench_Ctx_t *ctx, ADS1115_Handle_t *ads)
+{
+    BENCH(ctx, "ADS1115_Init", ADS1115_Init(ads, ADS1115_MODE_SINGLESHOT_MASK, AIN0, ADS1115_PGA_2_048V_MASK, ADS1115_DR_860SPS_MASK));
+    BENCH(ctx, "ADS1115_WriteConfig", ADS1115_WriteConfig(ads, adsConfig));
+    BENCH(ctx, "ADS1115_ReadConfigReg", ADS1115_ReadConfigReg(ads));
+    BENCH(ctx, "ADS1115_StartSSConv", ADS1115_StartSSConv(ads));
+    BENCH(ctx, "ADS1115_ReadConversionReg", ADS1115_ReadConversionReg(ads));
+    BENCH(ctx, "ADS1115_SetChannel", ADS1115_SetChannel(ads, AIN1));
+    BENCH(ctx, "ADS1115_SetSampleRate", ADS1115_SetSampleRate(ads, SPS_128));
+    BENCH(ctx, "ADS1115_SetSSMode", ADS1115_SetSSMode(ads));
+    BENCH(ctx, "ADS1115_SetThresholds", ADS1115_SetThresholds(ads, 0x1000, 0x7000));
+    BENCH(ctx, "ADS1115_Comp_Init", ADS1115_Comp_Init(ads, ADS1115_COMP_MODE_TRAD_MASK, ADS1115_COMP_POL_ACTIVE_LOW_MASK,
+                                                       ADS1115_COMP_LAT_NON_LATCHING_MASK, ADS1115_COMP_QUE_1_MASK));
+    BENCH(ctx, "ADS1115_Comp_SetMode", ADS1115_Comp_SetMode(ads, ADS1115_COMP_MODE_WINDOW_MASK));
+    BENCH(ctx, "ADS1115_Comp_SetPol", ADS1115_Comp_SetPol(ads, ADS1115_COMP_POL_ACTIVE_HIGH_MASK));
+    BENCH(ctx, "ADS1115_Comp_SetLat", ADS1115_Comp_SetLat(ads, ADS1115_COMP_LAT_LATCHING_MASK));
+    BENCH(ctx, "ADS1115_Comp_SetQue", ADS1115_Comp_SetQue(ads, ADS1115_COMP_QUE_DISABLE_MASK));
+}
+
+static void DriverBench_BME280(DriverBench_Ctx_t *ctx, BME280_Handle_t *bme)
+{
+    BENCH(ctx, "BME280_Init", BME280_Init(bme));
+    BENCH(ctx, "BME280_CalCompensationParams", BME280_CalCompensationParams(bme));
+    BENCH(ctx, "BME280_SetConfig", BME280_SetConfig(bme, BME280_STANDBY_0_5MS, BME280_FILTER_OFF));
+    BENCH(ctx, "BME280_SetOSVals", BME280_SetOSVals(bme, BME280_MODE_FORCED, BME280_OS_TEMP_x1, BME280_OS_PRESS_x1, BME280_OS_HUM_x1));
+    BENCH(ctx, "BME280_ApplySettings", BME280_ApplySettings(bme, &bmeSettings));
+    HAL_Delay(10); // Let the forced measurement finish outside the measured calls
+    BENCH(ctx, "BME280_GetTemp", BME280_GetTemp(bme));
+    BENCH(ctx, "BME280_GetPress", BME280_GetPress(bme));
+    BENCH(ctx, "BME280_GetHum", BME280_GetHum(bme));
+    BENCH(ctx, "BME280_compensate_T_int32", (BME280_compensate_T_int32(519888, bme->Comp), HAL_OK));
+    BENCH(ctx, "BME280_compensate_P_int64", (BME280_compensate_P_int64(415148, bme->Comp), HAL_OK));
+    BENCH(ctx, "BME280_compensate_H_int32", (BME280_compensate_H_int32(30000, bme->Comp), HAL_OK));
+}
+
+static void DriverBench_DS3231(DriverBench_Ctx_t *ctx, DS3231_Handle_t *rtc)
+{
+    int8_t aging;
+
+    rtc->time = (ds3231_time_t){12, 0, 0};
+    rtc->date = (ds3231_data_t){1, 1, 25};
+    rtc->dayOfWeek = Wednesday;
+    rtc->alarm1 = (sAlram_t){12, 30, 0, Wednesday, 1};
+    rtc->alarm2 = (sAlram_t){13, 0, 0, Wednesday, 1};
+
+    BENCH(ctx, "DS3231_Init", DS3231_Init(rtc));
+    BENCH(ctx, "DS3231_GetTime", DS3231_GetTime(rtc));
+    BENCH(ctx, "DS3231_GetDate", DS3231_GetDate(rtc));
+    BENCH(ctx, "DS3231_GetDOW", DS3231_GetDOW(rtc));
+    BENCH(ctx, "DS3231_SetTime", DS3231_SetTime(rtc));
+    BENCH(ctx, "DS3231_SetDate", DS3231_SetDate(rtc));
+    BENCH(ctx, "DS3231_SetDOW", DS3231_SetDOW(rtc));
+    BENCH(ctx, "DS3231_SetAlarm1", DS3231_SetAlarm1(Once, rtc));
+    BENCH(ctx, "DS3231_SetAlarm1_Again", DS3231_SetAlarm1(Once, rtc));
+    BENCH(ctx, "DS3231_SetAlarm2", DS3231_SetAlarm2(EveryDay, rtc));
+    BENCH(ctx, "DS3231_GetAlarm1", DS3231_GetAlarm1(rtc));
+    BENCH(ctx, "DS3231_GetAlarm2", DS3231_GetAlarm2(rtc));
+    BENCH(ctx, "DS3231_GetControlRegister", DS3231_GetControlRegister(rtc));
+    BENCH(ctx, "DS3231_ReadStatus", DS3231_ReadStatus(rtc));
+    BENCH(ctx, "DS3231_WriteStatus", DS3231_WriteStatus(rtc));
+    BENCH(ctx, "DS3231_CLearAlarmsFlags", DS3231_CLearAlarmsFlags(rtc));
+    BENCH(ctx, "DS3231_UpdateControl", DS3231_UpdateControl(rtc, ALARM2_MASK, 0));
+    BENCH(ctx, "DS3231_Flush", DS3231_Flush(rtc));
+    BENCH(ctx, "DS3231_OutputPWM", DS3231_OutputPWM(rtc, 0, 0));
+    BENCH(ctx, "DS3231_GetTemp", DS3231_GetTemp(rtc));
+    BENCH(ctx, "DS3231_StartTempConv", DS3231_StartTempConv(rtc));
+    HAL_Delay(200); // Conversion time, not part of any call
+    BENCH(ctx, "DS3231_PollTempConv", DS3231_PollTempConv(rtc));
+    BENCH(ctx, "DS3231_SetAgingOffset", DS3231_SetAgingOffset(rtc, 2));
+    BENCH(ctx, "DS3231_GetAgingOffset", DS3231_GetAgingOffset(rtc, &aging));
+}
+
+static const DriverBench_Result_t *DriverBench_Find(const DriverBench_Result_t *results, uint16_t count, const char *name, uint32_t busHz)
+{
+    for (uint16_t i = 0; i < count; i++) {
+        if (results[i].busHz == busHz && strcmp(results[i].name, name) == 0) {
+            return &results[i];
+        }
+    }
+    return NULL;
+}
+
+/* ========================== Function Definitions ============================ */
+
+/**
+ * @brief Run the benchmark script at one bus speed
+ * @param busHz SCL frequency in Hz
+ * @param results Output array
+ * @param max Capacity of the output array
+ * @return uint16_t Number of results written
+ */
+uint16_t DriverBench_Run(uint32_t busHz, DriverBench_Result_t *results, uint16_t max)
+{
+    static I2C_HandleTypeDef hi2c;
+    static SimADS1115_t simAds;
+    static SimBME280_t simBme;
+    static SimDS3231_t simRtc;
+    ADS1115_Handle_t ads = {0};
+    BME280_Handle_t bme = {0};
+    DS3231_Handle_t rtc = {0};
+    DriverBench_Ctx_t ctx = {.hi2c = &hi2c, .busHz = busHz, .results = results, .max = max};
+
+    HostSim_Reset();
+    HostSim_I2CInit(&hi2c, busHz, HOSTSIM_DMA_IMMEDIATE);
+    SimADS1115_Init(&simAds, ADS1115_ADDR);
+    SimBME280_Init(&simBme, BME280_ADDR);
+    SimDS3231_Init(&simRtc, DS3231_ADDR);
+    HostSim_Attach(&hi2c, &simAds.dev);
+    HostSim_Attach(&hi2c, &simBme.dev);
+    HostSim_Attach(&hi2c, &simRtc.dev);
+
+    ads.i2c_handle = &hi2c;
+    ads.I2C_address = ADS1115_ADDR;
+    bme.i2c_handle = &hi2c;
+    bme.I2C_address = BME280_ADDR;
+    rtc.i2c_handle = &hi2c;
+    rtc.I2C_address = DS3231_ADDR;
+#ifdef USE_I2CBUS
+    static I2CBus_t bus;
+    static I2CBus_Client_t adsClient, bmeClient, rtcClient;
+    I2CBus_Init(&bus, &hi2c);
+    I2CBus_ClientInit(&adsClient, &bus, "ads1115", I2CBUS_PRIO_CRITICAL);
+    I2CBus_ClientInit(&bmeClient, &bus, "bme280", I2CBUS_PRIO_NORMAL);
+    I2CBus_ClientInit(&rtcClient, &bus, "ds3231", I2CBUS_PRIO_LOW);
+    ads.bus_client = &adsClient;
+    bme.bus_client = &bmeClient;
+    rtc.bus_client = &rtcClient;
+#endif
+
+    DriverBench_ADS1115(&ctx, &ads);
+    DriverBench_BME280(&ctx, &bme);
+    DriverBench_DS3231(&ctx, &rtc);
+    return ctx.count;
+}
+
+/**
+ * @brief Write results as CSV with a header line
+ * @param out Output stream
+ * @param results Results to write
+ * @param count Number of results
+ */
+void DriverBench_WriteCsv(FILE *out, const DriverBench_Result_t *results, uint16_t count)
+{
+    fprintf(out, "name,bus_hz,transactions,bytes,busy_ns,wall_ns,cpu_ns,status\n");
+    for (uint16_t i = 0; i < count; i++) {
+        const DriverBench_Result_t *r = &results[i];
+        fprintf(out, "%s,%lu,%lu,%lu,%llu,%llu,%llu,%d\n", r->name, (unsigned long)r->busHz,
+                (unsigned long)r->transactions, (unsigned long)r->bytes, (unsigned long long)r->busyNs,
+                (unsigned long long)r->wallNs, (unsigned long long)r->cpuNs, r->status);
+    }
+}
+
+/**
+ * @brief Write results as a JSON array of objects
+ * @param out Output stream
+ * @param results Results to write
+ * @param count Number of results
+ */
+void DriverBench_WriteJson(FILE *out, const DriverBench_Result_t *results, uint16_t count)
+{
+    fprintf(out, "[\n");
+    for (uint16_t i = 0; i < count; i++) {
+        const DriverBench_Result_t *r = &results[i];
+        fprintf(out, "  {\"name\": \"%s\", \"bus_hz\": %lu, \"transactions\": %lu, \"bytes\": %lu, "
+                     "\"busy_ns\": %llu, \"wall_ns\": %llu, \"cpu_ns\": %llu, \"status\": %d}%s\n",
+                r->name, (unsigned long)r->busHz, (unsigned long)r->transactions, (unsigned long)r->bytes,
+                (unsigned long long)r->busyNs, (unsigned long long)r->wallNs, (unsigned long long)r->cpuNs,
+                r->status, (i + 1 < count) ? "," : "");
+    }
+    fprintf(out, "]\n");
+}
+
+/**
+ * @brief Read results written by DriverBench_WriteCsv()
+ * @param in Input stream
+ * @param results Output array
+ * @param max Capacity of the output array
+ * @return uint16_t Number of results read, the header and malformed lines are skipped
+ */
+uint16_t DriverBench_ReadCsv(FILE *in, DriverBench_Result_t *results, uint16_t max)
+{
+    char line[256];
+    uint16_t count = 0;
+
+    while (count < max && fgets(line, sizeof(line), in) != NULL) {
+        DriverBench_Result_t *r = &results[count];
+        unsigned long busHz, transactions, bytes;
+        unsigned long long busyNs, wallNs, cpuNs;
+        char *comma = strchr(line, ',');
+        if (comma == NULL || (size_t)(comma - line) >= DRIVER_BENCH_NAME_LEN) {
+            continue;
+        }
+        if (sscanf(comma + 1, "%lu,%lu,%lu,%llu,%llu,%llu,%d", &busHz, &transactions, &bytes,
+                   &busyNs, &wallNs, &cpuNs, &r->status) != 7) {
+            continue; // Header
+        }
+        memset(r->name, 0, sizeof(r->name));
+        memcpy(r->name, line, (size_t)(comma - line));
+        r->busHz = (uint32_t)busHz;
+        r->transactions = (uint32_t)transactions;
+        r->bytes = (uint32_t)bytes;
+        r->busyNs = busyNs;
+        r->wallNs = wallNs;
+        r->cpuNs = cpuNs;
+        count++;
+    }
+    return count;
+}
+
+/**
+ * @brief Compare results against a baseline
+ * @param results Current results
+ * @param count Number of current results
+ * @param baseline Baseline results, matched by name and bus speed
+ * @param baselineCount Number of baseline results
+ * @param report Stream for one line per regression or improvement, may be NULL
+ * @return uint16_t Number of calls that got more expensive or stopped returning HAL_OK
+ * @details CPU time is ignored, it is not reproducible across hosts.
+ */
+uint16_t DriverBench_Compare(const DriverBench_Result_t *results, uint16_t count,
+                             const DriverBench_Result_t *baseline, uint16_t baselineCount, FILE *report)
+{
+    uint16_t regressions = 0;
+
+    for (uint16_t i = 0; i < count; i++) {
+        const DriverBench_Result_t *r = &results[i];
+        const DriverBench_Result_t *b = DriverBench_Find(baseline, baselineCount, r->name, r->busHz);
+        if (b == NULL) {
+            continue;
+        }
+        int worse = r->transactions > b->transactions || r->bytes > b->bytes || r->busyNs > b->busyNs ||
+                    r->wallNs > b->wallNs || (b->status == 0 && r->status != 0);
+        int better = r->transactions < b->transactions || r->bytes < b->bytes || r->wallNs < b->wallNs;
+        if (report != NULL && (worse || better)) {
+            fprintf(report, "%s %s @%lu Hz: transactions %lu -> %lu, bytes %lu -> %lu, wall %llu -> %llu ns, status %d -> %d\n",
+                    worse ? "REGRESSION" : "improved", r->name, (unsigned long)r->busHz,
+                    (unsigned long)b->transactions, (unsigned long)r->transactions,
+                    (unsigned long)b->bytes, (unsigned long)r->bytes,
+                    (unsigned long long)b->wallNs, (unsigned long long)r->wallNs, b->status, r->status);
+        }
+        regressions += worse ? 1 : 0;
+    }
+    return regressions;
+}
+
+/**
+ * @brief Command line entry point for a benchmark executable
+ * @param argc Argument count
+ * @param argv Arguments: [--json] [--baseline file.csv]
+ * @return int 0 on success, 1 if any call regressed against the baseline, 2 on usage errors
+ * @details Runs the script at 100 kHz, 400 kHz and 1 MHz and prints CSV (or JSON)
+ *          to stdout; the regression report goes to stderr.
+ */
+int DriverBench_Main(int argc, char **argv)
+{
+    static const uint32_t speeds[] = {100000, 400000, 1000000};
+    static DriverBench_Result_t results[DRIVER_BENCH_MAX_RESULTS];
+    static DriverBench_Result_t baseline[DRIVER_BENCH_MAX_RESULTS];
+    const char *baselinePath = NULL;
+    int json = 0;
+    uint16_t count = 0;
+
+    for (int i = 1; i < argc; i++) {
+        if (strcmp(argv[i], "--json") == 0) {
+            json = 1;
+        } else if (strcmp(argv[i], "--baseline") == 0 && i + 1 < argc) {
+            baselinePath = argv[++i];
+        } else {
+            fprintf(stderr, "usage: %s [--json] [--baseline file.csv]\n", argv[0]);
+            return 2;
+        }
+    }
+
+    for (size_t s = 0; s < sizeof(speeds) / sizeof(speeds[0]); s++) {
+        count += DriverBench_Run(speeds[s], &results[count], (uint16_t)(DRIVER_BENCH_MAX_RESULTS - count));
+    }
+    if (json) {
+        DriverBench_WriteJson(stdout, results, count);
+    } else {
+        DriverBench_WriteCsv(stdout, results, count);
+    }
+
+    if (baselinePath != NULL) {
+        FILE *in = fopen(baselinePath, "r");
+        if (in == NULL) {
+            fprintf(stderr, "cannot open baseline %s\n", baselinePath);
+            return 2;
+        }
+        uint16_t baselineCount = DriverBench_ReadCsv(in, baseline, DRIVER_BENCH_MAX_RESULTS);
+        fclose(in);
+        uint16_t regressions = DriverBench_Compare(results, count, baseline, baselineCount, stderr);
+        if (regressions != 0) {
+            fprintf(stderr, "%u driver calls regressed\n", regressions);
+            return 1;
+        }
+    }
+    return 0;
+}
@@ -0,0 +1,33 @@
+#ifndef DRIVER_BENCH_H
+#define DRIVER_BENCH_H
+#include "main.h"
+#include <stdio.h>
+
+/*------------------- Configuration ---------------------------*/
+#ifndef DRIVER_BENCH_MAX_RESULTS
+#define DRIVER_BENCH_MAX_RESULTS 256 // Results kept per run, all bus speeds together
+#endif
+#define DRIVER_BENCH_NAME_LEN 40
+
+/************************ Bench Structs ********************************/
+typedef struct {
+    char name[DRIVER_BENCH_NAME_LEN]; // Driver function
+    uint32_t busHz;         // SCL frequency
+    uint32_t transactions;  // START ... STOP sequences
+    uint32_t bytes;         // Bytes on the wire including address and register bytes
+    uint64_t busyNs;        // Time SCL was driven
+    uint64_t wallNs;        // Simulated time the call took, delays included
+    uint64_t cpuNs;         // Host CPU time, informational only
+    int status;             // HAL_StatusTypeDef returned by the call
+} DriverBench_Result_t;
+
+/*------------------- Function Prototypes ---------------------------*/
+uint16_t DriverBench_Run(uint32_t busHz, DriverBench_Result_t *results, uint16_t max);
+void DriverBench_WriteCsv(FILE *out, const DriverBench_Result_t *results, uint16_t count);
+void DriverBench_WriteJson(FILE *out, const DriverBench_Result_t *results, uint16_t count);
+uint16_t DriverBench_ReadCsv(FILE *in, DriverBench_Result_t *results, uint16_t max);
+uint16_t DriverBench_Compare(const DriverBench_Result_t *results, uint16_t count,
+                             const DriverBench_Result_t *baseline, uint16_t baselineCount, FILE *report);
+int DriverBench_Main(int argc, char **argv);
+
+#endif
@@ -0,0 +1,231 @@
+#include "FaultBench.h"
+#include "SimADS1115.h"
+#include "SimBME280.h"
+#include "SimDS3231.h"
+#include <string.h>
+
+/**
+ ******************************************************************************
+ * @file    FaultBench.c
+ * @author  Yair Yamin
+ * @brief   Driver calls on a faulty simulated bus, with and without recovery.
+ * @details Each run sets up the three simulated devices behind one bus
+ * manager, injects one fault and makes one driver call, then the same call
+ * again to see whether the bus came back:
+ *
+ * - recover: default retries and backoff, the transfer watchdog, and the SCL
+ *   and SDA pins for the 9-clock unlock.
+ * - bare: no retries, no watchdog, no pins; the blocking calls only have
+ *   their client timeout, and the bus only resets the peripheral.
+ *
+ * The recover runs must stay within FaultBench_BoundUs() and come back from
+ * every fault a bus can be recovered from.
+ ******************************************************************************
+ */
+
+/* ========================== Defines ============================ */
+#define ADS1115_ADDR (0x48 << 1)
+#define BME280_ADDR  (0x76 << 1)
+#define DS3231_ADDR  (0x68 << 1)
+
+/************************ Bench Context ********************************/
+typedef struct {
+    I2C_HandleTypeDef hi2c;
+    SimADS1115_t simAds;
+    SimBME280_t simBme;
+    SimDS3231_t simRtc;
+    I2CBus_t bus;
+    I2CBus_Client_t adsClient, bmeClient, rtcClient;
+    ADS1115_Handle_t ads;
+    BME280_Handle_t bme;
+    DS3231_Handle_t rtc;
+} FaultBench_Ctx_t;
+
+typedef struct {
+    const char *name;
+    HostSim_Fault_t fault;
+    uint32_t count;
+    uint8_t recoverable; // The call itself can succeed
+} FaultBench_Scenario_t;
+
+typedef struct {
+    const char *name;
+    HAL_StatusTypeDef (*call)(FaultBench_Ctx_t *ctx);
+    I2CBus_Client_t *(*client)(FaultBench_Ctx_t *ctx);
+} FaultBench_Call_t;
+
+static const FaultBench_Scenario_t scenarios[] = {
+    {"none",         HOSTSIM_FAULT_NONE,      0,    1},
+    {"nack_x1",      HOSTSIM_FAULT_NACK,      1,    1},
+    {"nack_x50",     HOSTSIM_FAULT_NACK,      50,   0},
+    {"arb_lost_x1",  HOSTSIM_FAULT_ARB_LOST,  1,    1},
+    {"bus_error_x1", HOSTSIM_FAULT_BUS_ERROR, 1,    1},
+    {"hang_x1",      HOSTSIM_FAULT_HANG,      1,    1},
+    {"sda_stuck_5",  HOSTSIM_FAULT_SDA_STUCK, 5,    1},
+    {"sda_held",     HOSTSIM_FAULT_SDA_STUCK, 1000, 0},
+};
+
+static const I2CRecover_Pins_t pins = {GPIOB, GPIO_PIN_6, GPIOB, GPIO_PIN_7};
+
+/* ========================== Static Helpers ============================ */
+
+static HAL_StatusTypeDef FaultBench_RtcGetTime(FaultBench_Ctx_t *ctx) { return DS3231_GetTime(&ctx->rtc); }
+static HAL_StatusTypeDef FaultBench_BmeGetTemp(FaultBench_Ctx_t *ctx) { return BME280_GetTemp(&ctx->bme); }
+static HAL_StatusTypeDef FaultBench_AdsRead(FaultBench_Ctx_t *ctx) { return ADS1115_ReadConversionReg(&ctx->ads); }
+static I2CBus_Client_t *FaultBench_RtcClient(FaultBench_Ctx_t *ctx) { return &ctx->rtcClient; }
+static I2CBus_Client_t *FaultBench_BmeClient(FaultBench_Ctx_t *ctx) { return &ctx->bmeClient; }
+static I2CBus_Client_t *FaultBench_AdsClient(FaultBench_Ctx_t *ctx) { return &ctx->adsClient; }
+
+static const FaultBench_Call_t calls[] = {
+    {"DS3231_GetTime",            FaultBench_RtcGetTime, FaultBench_RtcClient},
+    {"BME280_GetTemp",            FaultBench_BmeGetTemp, FaultBench_BmeClient},
+    {"ADS1115_ReadConversionReg", FaultBench_AdsRead,    FaultBench_AdsClient},
+};
+
+static HAL_StatusTypeDef FaultBench_Setup(FaultBench_Ctx_t *ctx, uint8_t recover)
+{
+    memset(ctx, 0, sizeof(*ctx));
+    HostSim_Reset();
+    HostSim_I2CInit(&ctx->hi2c, 400000, HOSTSIM_DMA_DEFERRED);
+    HostSim_I2CPins(&ctx->hi2c, pins.sclPort, pins.sclPin, pins.sdaPort, pins.sdaPin);
+    SimADS1115_Init(&ctx->simAds, ADS1115_ADDR);
+    SimBME280_Init(&ctx->simBme, BME280_ADDR);
+    SimDS3231_Init(&ctx->simRtc, DS3231_ADDR);
+    HostSim_Attach(&ctx->hi2c, &ctx->simAds.dev);
+    HostSim_Attach(&ctx->hi2c, &ctx->simBme.dev);
+    HostSim_Attach(&ctx->hi2c, &ctx->simRtc.dev);
+
+    I2CBus_Init(&ctx->bus, &ctx->hi2c);
+    I2CBus_ClientInit(&ctx->adsClient, &ctx->bus, "ads1115", I2CBUS_PRIO_NORMAL);
+    I2CBus_ClientInit(&ctx->bmeClient, &ctx->bus, "bme280", I2CBUS_PRIO_NORMAL);
+    I2CBus_ClientInit(&ctx->rtcClient, &ctx->bus, "ds3231", I2CBUS_PRIO_NORMAL);
+    if (recover) {
+        I2CBus_SetRecovery(&ctx->bus, &pins, I2CBUS_TXN_TIMEOUT_TICKS);
+    } else {
+        I2CBus_SetRecovery(&ctx->bus, NULL, 0xFFFFFFFFu);
+        I2CBus_SetRetry(&ctx->adsClient, 0, 0);
+        I2CBus_SetRetry(&ctx->bmeClient, 0, 0);
+        I2CBus_SetRetry(&ctx->rtcClient, 0, 0);
+    }
+    ctx->ads.bus_client = &ctx->adsClient;
+    ctx->ads.I2C_address = ADS1115_ADDR;
+    ctx->bme.bus_client = &ctx->bmeClient;
+    ctx->bme.I2C_address = BME280_ADDR;
+    ctx->rtc.bus_client = &ctx->rtcClient;
+    ctx->rtc.I2C_address = DS3231_ADDR;
+    ctx->rtc.time = (ds3231_time_t){.hours = 12, .minutes = 0, .seconds = 0};
+    ctx->rtc.date = (ds3231_data_t){.date = 1, .month = 1, .year = 25};
+    ctx->rtc.dayOfWeek = Wednesday;
+
+    VALID(DS3231_Init(&ctx->rtc));
+    VALID(BME280_Init(&ctx->bme));
+    return ADS1115_Init(&ctx->ads, ADS1115_MODE_SINGLESHOT_MASK, AIN0, ADS1115_PGA_4_096V_MASK, ADS1115_DR_860SPS_MASK);
+}
+
+static void FaultBench_One(uint8_t recover, const FaultBench_Scenario_t *scenario, const FaultBench_Call_t *call, FaultBench_Result_t *r)
+{
+    static FaultBench_Ctx_t ctx;
+    HAL_StatusTypeDef setup = FaultBench_Setup(&ctx, recover);
+    I2CBus_Client_t *client = call->client(&ctx);
+
+    memset(r, 0, sizeof(*r));
+    r->policy = recover ? "recover" : "bare";
+    r->fault = scenario->name;
+    r->call = call->name;
+    if (setup != HAL_OK) {
+        r->status = r->nextStatus = setup;
+        return;
+    }
+    I2CBus_ResetMetrics(client);
+    memset(&ctx.bus.recovery, 0, sizeof(ctx.bus.recovery));
+
+    HostSim_InjectFault(&ctx.hi2c, scenario->fault, scenario->count);
+    uint64_t start = HostSim_NowNs();
+    r->status = call->call(&ctx);
+    r->latencyUs = (uint32_t)((HostSim_NowNs() - start) / 1000u);
+    r->retries = client->metrics.retries;
+    r->nacks = client->metrics.nacks;
+    r->busErrors = client->metrics.busErrors;
+    r->timeouts = client->metrics.timeouts;
+    r->unlocks = ctx.bus.recovery.unlocks;
+    r->reinits = ctx.bus.recovery.reinits;
+    r->nextStatus = call->call(&ctx);
+}
+
+/* ========================== Function Definitions ============================ */
+
+/**
+ * @brief Longest a driver call may take with recovery on
+ * @return uint32_t Microseconds: the client timeout plus one tick of polling,
+ *         one refused start on a held bus (the HAL's busy-flag wait) and the
+ *         unlock clocks
+ */
+uint32_t FaultBench_BoundUs(void)
+{
+    return (I2CBUS_TIMEOUT_TICKS + 1 + HOSTSIM_BUSY_FLAG_MS) * 1000u + 20u * I2CRECOVER_HALF_CLOCK_US + 100u;
+}
+
+/**
+ * @brief Run every fault against every driver call
+ * @param recover 1 for the recovery policy, 0 for the bare bus
+ * @param results One result per fault and call
+ * @param max Capacity of results
+ * @return uint16_t Number of results
+ */
+uint16_t FaultBench_Run(uint8_t recover, FaultBench_Result_t *results, uint16_t max)
+{
+    uint16_t count = 0;
+
+    for (uint8_t s = 0; s < sizeof(scenarios) / sizeof(scenarios[0]); s++) {
+        for (uint8_t c = 0; c < sizeof(calls) / sizeof(calls[0]) && count < max; c++) {
+            FaultBench_One(recover, &scenarios[s], &calls[c], &results[count++]);
+        }
+    }
+    return count;
+}
+
+/**
+ * @brief Write results as CSV with a header line
+ */
+void FaultBench_WriteCsv(FILE *out, const FaultBench_Result_t *results, uint16_t count)
+{
+    fprintf(out, "policy,fault,call,status,latency_us,retries,nacks,bus_errors,timeouts,unlocks,reinits,next_status\n");
+    for (uint16_t i = 0; i < count; i++) {
+        const FaultBench_Result_t *r = &results[i];
+        fprintf(out, "%s,%s,%s,%d,%lu,%lu,%lu,%lu,%lu,%lu,%lu,%d\n", r->policy, r->fault, r->call, (int)r->status,
+                (unsigned long)r->latencyUs, (unsigned long)r->retries, (unsigned long)r->nacks,
+                (unsigned long)r->busErrors, (unsigned long)r->timeouts, (unsigned long)r->unlocks,
+                (unsigned long)r->reinits, (int)r->nextStatus);
+    }
+}
+
+/**
+ * @brief Command line entry, no arguments
+ * @return int 0, 1 if a recover run exceeded the bound or did not come back
+ *         from a recoverable fault, 2 on usage errors
+ */
+int FaultBench_Main(int argc, char **argv)
+{
+    static FaultBench_Result_t results[2 * sizeof(scenarios) / sizeof(scenarios[0]) * sizeof(calls) / sizeof(calls[0])];
+    const uint16_t perPolicy = (uint16_t)(sizeof(results) / sizeof(results[0]) / 2);
+    uint16_t count;
+    int failed = 0;
+
+    if (argc > 1) {
+        fprintf(stderr, "usage: %s\n", argv[0]);
+        return 2;
+    }
+    count = FaultBench_Run(1, results, perPolicy);
+    for (uint16_t i = 0; i < count; i++) {
+        const FaultBench_Scenario_t *scenario = &scenarios[i / (sizeof(calls) / sizeof(calls[0]))];
+        if (results[i].latencyUs > FaultBench_BoundUs() ||
+            (scenario->recoverable && (results[i].status != HAL_OK || results[i].nextStatus != HAL_OK))) {
+            fprintf(stderr, "%s/%s: status %d after %lu us, next %d\n", results[i].fault, results[i].call,
+                    (int)results[i].status, (unsigned long)results[i].latencyUs, (int)results[i].nextStatus);
+            failed = 1;
+        }
+    }
+    count += FaultBench_Run(0, &results[count], perPolicy);
+    FaultBench_WriteCsv(stdout, results, count);
+    return failed;
+}
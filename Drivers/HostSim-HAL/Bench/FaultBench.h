@@ -0,0 +1,35 @@
+#ifndef FAULT_BENCH_H
+#define FAULT_BENCH_H
+#include "ADS1115.h"
+#include "BME280.h"
+#include "DS3231.h"
+#include <stdio.h>
+
+/*------------------- Configuration ---------------------------*/
+#ifndef USE_I2CBUS
+#error "FaultBench needs USE_I2CBUS"
+#endif
+
+/************************ Bench Structs ********************************/
+typedef struct {
+    const char *policy;     // "recover" or "bare"
+    const char *fault;      // Injected fault and count
+    const char *call;       // Driver call made with the fault pending
+    HAL_StatusTypeDef status;
+    uint32_t latencyUs;     // Duration of the call in simulated time
+    uint32_t retries;
+    uint32_t nacks;
+    uint32_t busErrors;
+    uint32_t timeouts;
+    uint32_t unlocks;
+    uint32_t reinits;
+    HAL_StatusTypeDef nextStatus; // Same call again, fault gone: did the bus come back
+} FaultBench_Result_t;
+
+/*------------------- Function Prototypes ---------------------------*/
+uint16_t FaultBench_Run(uint8_t recover, FaultBench_Result_t *results, uint16_t max);
+uint32_t FaultBench_BoundUs(void);
+void FaultBench_WriteCsv(FILE *out, const FaultBench_Result_t *results, uint16_t count);
+int FaultBench_Main(int argc, char **argv);
+
+#endif
@@ -0,0 +1,400 @@
+#define _POSIX_C_SOURCE 200809L
+#include "RtosBench.h"
+#include "SimADS1115.h"
+#include "SimBME280.h"
+#include "SimDS3231.h"
+#include <pthread.h>
+#include <stdlib.h>
+#include <time.h>
+
+/**
+ ******************************************************************************
+ * @file    RtosBench.c
+ * @author  Yair Yamin
+ * @brief   The drivers under the RTOS port, with POSIX threads as tasks.
+ * @details Three task threads call the ADS1115, BME280 and DS3231 drivers on
+ * one bus through I2CBus with I2CBUS_RTOS, and a fourth thread plays the
+ * hardware: it lets each deferred DMA transfer take its wire time in real
+ * time, then runs the completion interrupt under the DriverOs critical lock.
+ * The same thread plays a timer interrupt that queues an ADS1115 read with
+ * I2CBus_Submit() every RTOS_BENCH_ISR_PERIOD_US.
+ *
+ * A task that sleeps during its transfers uses a small fraction of its wall
+ * time as CPU time; a task that polls for completion uses all of it. The
+ * DS3231 task also keeps the bus with I2CBus_Acquire() for every 16th call.
+ ******************************************************************************
+ */
+
+/* ========================== Defines ============================ */
+#define ADS1115_ADDR (0x48 << 1)
+#define BME280_ADDR  (0x76 << 1)
+#define DS3231_ADDR  (0x68 << 1)
+#define RTOS_BENCH_TASKS 3
+
+/************************ Bench Context ********************************/
+typedef struct RtosBench_Task_s RtosBench_Task_t;
+
+struct RtosBench_Task_s {
+    const char *name;
+    I2CBus_Client_t *client;
+    HAL_StatusTypeDef (*call)(uint32_t i);
+    uint32_t iterations;
+    RtosBench_Result_t *result;
+};
+
+typedef struct {
+    I2C_HandleTypeDef hi2c;
+    SimADS1115_t simAds;
+    SimBME280_t simBme;
+    SimDS3231_t simRtc;
+    I2CBus_t bus;
+    I2CBus_Client_t adsClient;
+    I2CBus_Client_t bmeClient;
+    I2CBus_Client_t rtcClient;
+    I2CBus_Client_t isrClient;
+    ADS1115_Handle_t ads;
+    BME280_Handle_t bme;
+    DS3231_Handle_t rtc;
+    pthread_t irqThread;
+    uint8_t stop;           // Guarded by the DriverOs critical lock
+    uint8_t isrData[2];
+    volatile uint32_t isrSubmitted;
+    volatile uint32_t isrRejected;
+    volatile uint32_t isrErrors;
+} RtosBench_Ctx_t;
+
+/* ========================== Global Variables ============================ */
+static RtosBench_Ctx_t bench;
+
+/* ========================== Static Helpers ============================ */
+
+static uint64_t RtosBench_ClockNs(clockid_t clock)
+{
+    struct timespec ts;
+    clock_gettime(clock, &ts);
+    return (uint64_t)ts.tv_sec * 1000000000u + (uint64_t)ts.tv_nsec;
+}
+
+static void RtosBench_SleepNs(uint64_t ns)
+{
+    struct timespec ts = { (time_t)(ns / 1000000000u), (long)(ns % 1000000000u) };
+    nanosleep(&ts, NULL);
+}
+
+static void RtosBench_IsrDone(const I2CBus_Txn_t *txn, HAL_StatusTypeDef status)
+{
+    (void)txn;
+    if (status != HAL_OK) {
+        bench.isrErrors++;
+    }
+}
+
+/**
+ * @brief Simulated timer interrupt, queues an ADS1115 conversion read
+ */
+static void RtosBench_TimerIsr(void)
+{
+    I2CBus_Txn_t txn = {0};
+
+    txn.op = I2CBUS_RECEIVE;
+    txn.devAddress = ADS1115_ADDR;
+    txn.data = bench.isrData;
+    txn.size = sizeof(bench.isrData);
+    txn.done = RtosBench_IsrDone;
+    if (I2CBus_Submit(&bench.isrClient, &txn) == HAL_OK) {
+        bench.isrSubmitted++;
+    } else {
+        bench.isrRejected++;
+    }
+}
+
+/**
+ * @brief The hardware: completes transfers after their wire time, fires the timer
+ */
+static void *RtosBench_IrqThread(void *arg)
+{
+    uint64_t nextTimer = RtosBench_ClockNs(CLOCK_MONOTONIC) + RTOS_BENCH_ISR_PERIOD_US * 1000u;
+    (void)arg;
+
+    for (;;) {
+        DRIVER_OS_CRITICAL_ENTER();
+        if (bench.stop) {
+            DRIVER_OS_CRITICAL_EXIT();
+            break;
+        }
+        uint8_t pending = (bench.hi2c.pendingCplt != HOSTSIM_CPLT_NONE);
+        uint64_t wireNs = pending ? bench.hi2c.busyUntilNs - HostSim_NowNs() : 0;
+        DRIVER_OS_CRITICAL_EXIT();
+
+        if (pending) {
+            RtosBench_SleepNs(wireNs);
+            DRIVER_OS_CRITICAL_ENTER();
+            HostSim_AdvanceNs(wireNs); // Completion interrupt, dispatches the next transfer
+            DRIVER_OS_CRITICAL_EXIT();
+        } else {
+            RtosBench_SleepNs(20000); // Idle bus
+        }
+        if (RtosBench_ClockNs(CLOCK_MONOTONIC) >= nextTimer) {
+            nextTimer += RTOS_BENCH_ISR_PERIOD_US * 1000u;
+            DRIVER_OS_CRITICAL_ENTER();
+            RtosBench_TimerIsr();
+            DRIVER_OS_CRITICAL_EXIT();
+        }
+    }
+    return NULL;
+}
+
+static HAL_StatusTypeDef RtosBench_AdsCall(uint32_t i)
+{
+    (void)i;
+    return ADS1115_ReadConversionReg(&bench.ads);
+}
+
+static HAL_StatusTypeDef RtosBench_BmeCall(uint32_t i)
+{
+    switch (i % 3) {
+    case 0:  return BME280_GetTemp(&bench.bme);
+    case 1:  return BME280_GetPress(&bench.bme);
+    default: return BME280_GetHum(&bench.bme);
+    }
+}
+
+static HAL_StatusTypeDef RtosBench_RtcCall(uint32_t i)
+{
+    HAL_StatusTypeDef status;
+
+    if (i % 16 != 0) {
+        return (i & 1) ? DS3231_GetTime(&bench.rtc) : DS3231_GetDate(&bench.rtc);
+    }
+    // Time and date from one consistent moment: nobody else's task traffic in between
+    status = I2CBus_Acquire(&bench.rtcClient);
+    if (status != HAL_OK) {
+        return status;
+    }
+    status = DS3231_GetTime(&bench.rtc);
+    if (status == HAL_OK) {
+        status = DS3231_GetDate(&bench.rtc);
+    }
+    I2CBus_Release(&bench.rtcClient);
+    return status;
+}
+
+static void *RtosBench_TaskThread(void *arg)
+{
+    RtosBench_Task_t *task = arg;
+    RtosBench_Result_t *r = task->result;
+    uint64_t wall0 = RtosBench_ClockNs(CLOCK_MONOTONIC);
+    uint64_t cpu0 = RtosBench_ClockNs(CLOCK_THREAD_CPUTIME_ID);
+
+    for (uint32_t i = 0; i < task->iterations; i++) {
+        uint64_t start = RtosBench_ClockNs(CLOCK_MONOTONIC);
+        HAL_StatusTypeDef status = task->call(i);
+        uint32_t us = (uint32_t)((RtosBench_ClockNs(CLOCK_MONOTONIC) - start) / 1000u);
+        r->calls++;
+        if (status == HAL_TIMEOUT) {
+            r->timeouts++;
+        } else if (status != HAL_OK) {
+            r->errors++;
+        }
+        if (us > r->maxCallUs) {
+            r->maxCallUs = us;
+        }
+    }
+    r->cpuNs = RtosBench_ClockNs(CLOCK_THREAD_CPUTIME_ID) - cpu0;
+    r->wallNs = RtosBench_ClockNs(CLOCK_MONOTONIC) - wall0;
+    return NULL;
+}
+
+/**
+ * @brief Bus, models, clients and the hardware thread; the drivers are initialized through it
+ */
+static HAL_StatusTypeDef RtosBench_Setup(void)
+{
+    HAL_StatusTypeDef status;
+
+    memset(&bench, 0, sizeof(bench));
+    HostSim_Reset();
+    HostSim_I2CInit(&bench.hi2c, 400000, HOSTSIM_DMA_DEFERRED);
+    SimADS1115_Init(&bench.simAds, ADS1115_ADDR);
+    SimBME280_Init(&bench.simBme, BME280_ADDR);
+    SimDS3231_Init(&bench.simRtc, DS3231_ADDR);
+    HostSim_Attach(&bench.hi2c, &bench.simAds.dev);
+    HostSim_Attach(&bench.hi2c, &bench.simBme.dev);
+    HostSim_Attach(&bench.hi2c, &bench.simRtc.dev);
+
+    if (I2CBus_Init(&bench.bus, &bench.hi2c) != HAL_OK ||
+        I2CBus_ClientInit(&bench.adsClient, &bench.bus, "ads1115", I2CBUS_PRIO_HIGH) != HAL_OK ||
+        I2CBus_ClientInit(&bench.bmeClient, &bench.bus, "bme280", I2CBUS_PRIO_NORMAL) != HAL_OK ||
+        I2CBus_ClientInit(&bench.rtcClient, &bench.bus, "ds3231", I2CBUS_PRIO_LOW) != HAL_OK ||
+        I2CBus_ClientInit(&bench.isrClient, &bench.bus, "isr", I2CBUS_PRIO_CRITICAL) != HAL_OK) {
+        return HAL_ERROR;
+    }
+    bench.ads.bus_client = &bench.adsClient;
+    bench.ads.I2C_address = ADS1115_ADDR;
+    bench.bme.bus_client = &bench.bmeClient;
+    bench.bme.I2C_address = BME280_ADDR;
+    bench.rtc.bus_client = &bench.rtcClient;
+    bench.rtc.I2C_address = DS3231_ADDR;
+    bench.rtc.date.date = 1;
+    bench.rtc.date.month = 1;
+    bench.rtc.date.year = 25;
+    bench.rtc.dayOfWeek = Wednesday;
+
+    if (pthread_create(&bench.irqThread, NULL, RtosBench_IrqThread, NULL) != 0) {
+        return HAL_ERROR;
+    }
+    status = ADS1115_Init(&bench.ads, ADS1115_MODE_CONTINUOUS_MASK, AIN0, ADS1115_PGA_4_096V_MASK, ADS1115_DR_860SPS_MASK);
+    if (status == HAL_OK) {
+        status = BME280_Init(&bench.bme);
+    }
+    if (status == HAL_OK) {
+        status = BME280_SetOSVals(&bench.bme, BME280_MODE_NORMAL, BME280_OS_TEMP_x1, BME280_OS_PRESS_x1, BME280_OS_HUM_x1);
+    }
+    if (status == HAL_OK) {
+        status = DS3231_Init(&bench.rtc);
+    }
+    return status;
+}
+
+static void RtosBench_Teardown(void)
+{
+    DRIVER_OS_CRITICAL_ENTER();
+    bench.stop = 1;
+    DRIVER_OS_CRITICAL_EXIT();
+    pthread_join(bench.irqThread, NULL);
+}
+
+/**
+ * @brief Keeps the bus for holdMs, see RtosBench_LockTimeout()
+ */
+static void *RtosBench_Holder(void *arg)
+{
+    DriverOs_Event_t *held = arg;
+
+    if (I2CBus_Acquire(&bench.rtcClient) == HAL_OK) {
+        DriverOs_EventSignal(held);
+        RtosBench_SleepNs((uint64_t)bench.rtcClient.timeout * 1000000u);
+        I2CBus_Release(&bench.rtcClient);
+    }
+    return NULL;
+}
+
+ /* ========================== Function Definitions ============================ */
+
+/**
+ * @brief Run the three driver tasks and the timer interrupt concurrently
+ * @param iterations Driver calls per task
+ * @param results One result per task plus one for the interrupt submissions
+ * @param max Capacity of results, at least 4
+ * @return uint8_t Number of results, 0 if the setup failed
+ */
+uint8_t RtosBench_Run(uint32_t iterations, RtosBench_Result_t *results, uint8_t max)
+{
+    RtosBench_Task_t tasks[RTOS_BENCH_TASKS] = {
+        { "ads1115", &bench.adsClient, RtosBench_AdsCall, iterations, NULL },
+        { "bme280",  &bench.bmeClient, RtosBench_BmeCall, iterations, NULL },
+        { "ds3231",  &bench.rtcClient, RtosBench_RtcCall, iterations, NULL },
+    };
+    pthread_t threads[RTOS_BENCH_TASKS];
+    uint32_t initTransfers[RTOS_BENCH_TASKS];
+
+    if (max < RTOS_BENCH_TASKS + 1) {
+        return 0;
+    }
+    memset(results, 0, sizeof(*results) * (RTOS_BENCH_TASKS + 1));
+    if (RtosBench_Setup() != HAL_OK) {
+        RtosBench_Teardown();
+        return 0;
+    }
+    for (uint8_t i = 0; i < RTOS_BENCH_TASKS; i++) {
+        initTransfers[i] = tasks[i].client->metrics.completed; // Only this thread's calls complete for its client
+        tasks[i].result = &results[i];
+        snprintf(results[i].name, sizeof(results[i].name), "%s", tasks[i].name);
+        pthread_create(&threads[i], NULL, RtosBench_TaskThread, &tasks[i]);
+    }
+    for (uint8_t i = 0; i < RTOS_BENCH_TASKS; i++) {
+        pthread_join(threads[i], NULL);
+        results[i].transfers = tasks[i].client->metrics.completed - initTransfers[i];
+    }
+    RtosBench_Teardown();
+
+    RtosBench_Result_t *isr = &results[RTOS_BENCH_TASKS];
+    snprintf(isr->name, sizeof(isr->name), "isr");
+    isr->calls = bench.isrSubmitted;
+    isr->errors = bench.isrErrors + bench.isrRejected;
+    isr->transfers = bench.isrClient.metrics.completed;
+    return RTOS_BENCH_TASKS + 1;
+}
+
+/**
+ * @brief Check that a blocking call times out while another task keeps the bus
+ * @param holdMs How long the other task keeps it
+ * @param timeoutMs Timeout of the call that waits
+ * @return HAL_StatusTypeDef Status of the waiting call: HAL_TIMEOUT when holdMs > timeoutMs
+ */
+HAL_StatusTypeDef RtosBench_LockTimeout(uint32_t holdMs, uint32_t timeoutMs)
+{
+    DriverOs_Event_t held;
+    pthread_t holder;
+    HAL_StatusTypeDef status;
+
+    if (RtosBench_Setup() != HAL_OK || DriverOs_EventInit(&held) != HAL_OK) {
+        RtosBench_Teardown();
+        return HAL_ERROR;
+    }
+    I2CBus_SetTimeout(&bench.rtcClient, holdMs); // The holder sleeps for its own timeout
+    I2CBus_SetTimeout(&bench.bmeClient, timeoutMs);
+    DriverOs_EventPrepare(&held);
+    pthread_create(&holder, NULL, RtosBench_Holder, &held);
+    status = DriverOs_EventWait(&held, 1000);
+    if (status == HAL_OK) {
+        status = BME280_GetTemp(&bench.bme);
+    }
+    pthread_join(holder, NULL);
+    RtosBench_Teardown();
+    return status;
+}
+
+/**
+ * @brief Write results as CSV with a header line
+ */
+void RtosBench_WriteCsv(FILE *out, const RtosBench_Result_t *results, uint8_t count)
+{
+    fprintf(out, "task,calls,errors,timeouts,transfers,wall_ms,cpu_ms,cpu_pct,max_call_us\n");
+    for (uint8_t i = 0; i < count; i++) {
+        const RtosBench_Result_t *r = &results[i];
+        fprintf(out, "%s,%u,%u,%u,%u,%.1f,%.2f,%.1f,%u\n", r->name, r->calls, r->errors, r->timeouts, r->transfers,
+                r->wallNs / 1e6, r->cpuNs / 1e6, r->wallNs ? 100.0 * (double)r->cpuNs / (double)r->wallNs : 0.0,
+                r->maxCallUs);
+    }
+}
+
+/**
+ * @brief Command line entry: [iterations]
+ * @return int 0, 1 if a task saw an error or the lock timeout check failed, 2 on usage errors
+ */
+int RtosBench_Main(int argc, char **argv)
+{
+    RtosBench_Result_t results[RTOS_BENCH_TASKS + 1];
+    uint32_t iterations = 500;
+    int failed = 0;
+
+    if (argc > 2 || (argc == 2 && (iterations = (uint32_t)strtoul(argv[1], NULL, 10)) == 0)) {
+        fprintf(stderr, "usage: %s [iterations]\n", argv[0]);
+        return 2;
+    }
+    uint8_t count = RtosBench_Run(iterations, results, RTOS_BENCH_TASKS + 1);
+    if (count == 0) {
+        fprintf(stderr, "setup failed\n");
+        return 1;
+    }
+    RtosBench_WriteCsv(stdout, results, count);
+    for (uint8_t i = 0; i < count; i++) {
+        failed |= (results[i].errors != 0 || results[i].timeouts != 0);
+    }
+
+    HAL_StatusTypeDef status = RtosBench_LockTimeout(50, 10);
+    fprintf(stderr, "bus kept 50 ms, call with 10 ms timeout: %s\n", (status == HAL_TIMEOUT) ? "HAL_TIMEOUT" : "unexpected status");
+    failed |= (status != HAL_TIMEOUT);
+    return failed;
+}
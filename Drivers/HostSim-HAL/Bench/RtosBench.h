@@ -0,0 +1,37 @@
+#ifndef RTOS_BENCH_H
+#define RTOS_BENCH_H
+#include "ADS1115.h"
+#include "BME280.h"
+#include "DS3231.h"
+#include <stdio.h>
+
+/*------------------- Configuration ---------------------------*/
+// Build with USE_I2CBUS, I2CBUS_RTOS and I2CBUS_HAL_CALLBACKS, link with -pthread
+#if !defined(USE_I2CBUS) || !defined(I2CBUS_RTOS)
+#error "RtosBench needs USE_I2CBUS and I2CBUS_RTOS"
+#endif
+
+#ifndef RTOS_BENCH_ISR_PERIOD_US
+#define RTOS_BENCH_ISR_PERIOD_US 2000 // Simulated timer interrupt queueing an ADS1115 read
+#endif
+#define RTOS_BENCH_NAME_LEN 16
+
+/************************ Bench Structs ********************************/
+typedef struct {
+    char name[RTOS_BENCH_NAME_LEN]; // Task, or "isr" for the interrupt submissions
+    uint32_t calls;         // Driver calls, or transactions submitted from the ISR
+    uint32_t errors;        // Calls that returned an error other than HAL_TIMEOUT
+    uint32_t timeouts;
+    uint32_t transfers;     // Bus transactions completed for the client
+    uint64_t wallNs;        // Real time from the first call to the last return
+    uint64_t cpuNs;         // Thread CPU time over the same span
+    uint32_t maxCallUs;     // Longest call, real time
+} RtosBench_Result_t;
+
+/*------------------- Function Prototypes ---------------------------*/
+uint8_t RtosBench_Run(uint32_t iterations, RtosBench_Result_t *results, uint8_t max);
+HAL_StatusTypeDef RtosBench_LockTimeout(uint32_t holdMs, uint32_t timeoutMs);
+void RtosBench_WriteCsv(FILE *out, const RtosBench_Result_t *results, uint8_t count);
+int RtosBench_Main(int argc, char **argv);
+
+#endif
@@ -0,0 +1,883 @@
+#include "HostSim.h"
+
+/**
+ ******************************************************************************
+ * @file    HostSim.c
+ * @author  Yair Yamin
+ * @brief   Simulated STM32 HAL I2C and SPI layer for running the drivers on Linux.
+ * @details Implements the HAL I2C entry points used by the drivers on top of
+ * a simulated clock and a list of register-accurate device models per bus.
+ *
+ * Timing model:
+ * - Every transfer costs START + 9 clocks per byte (address, register and
+ *   data bytes) + one clock per repeated START + STOP at the bus ClockSpeed.
+ * - Blocking calls advance the simulated clock by the wire time.
+ * - _DMA calls either finish immediately (HOSTSIM_DMA_IMMEDIATE) or keep the
+ *   bus busy until simulated time passes the wire time and then fire the
+ *   completion callback (HOSTSIM_DMA_DEFERRED), returning HAL_BUSY to any
+ *   transfer started in between, like the real peripheral. Read data only
+ *   reaches the caller's buffer when the transfer completes.
+ * - HAL_Delay() advances the simulated clock; device models see the time
+ *   through their tick hook and HostSim_NowNs().
+ *
+ * Each bus keeps transaction, byte, busy-time and NACK counters.
+ *
+ * SPI: one full-duplex transfer costs 8 SCK cycles per byte at BaudRate and
+ * goes to the device model whose chip-select GPIO is low; with none selected
+ * MISO reads 0xFF. DMA transfers complete like I2C ones, through
+ * HAL_SPI_TxRxCpltCallback().
+ *
+ * D-cache (HostSim_Cache): the SCB maintenance calls are recorded, and each
+ * _DMA call checks that its buffers were cleaned (DMA reads them) or
+ * clean-invalidated (DMA writes them) since the previous one. A completion
+ * callback must invalidate the buffer a DMA transfer wrote.
+ *
+ * Fault injection (HostSim_InjectFault()):
+ * - NACK, arbitration loss and bus error fail the next transactions after the
+ *   address byte with the matching HAL error code.
+ * - A hung transfer never completes: a blocking call returns HAL_TIMEOUT
+ *   after its Timeout, a DMA transfer keeps the peripheral busy until
+ *   HAL_I2C_DeInit().
+ * - A stuck SDA line makes every start wait HOSTSIM_BUSY_FLAG_MS and fail
+ *   with HAL_BUSY and HAL_I2C_ERROR_TIMEOUT, as the HAL does on a busy bus,
+ *   until enough clocks are bit-banged on the SCL pin set with
+ *   HostSim_I2CPins(). Re-initializing the peripheral does not help.
+ ******************************************************************************
+ */
+
+/* ========================== Global Variables ============================ */
+static uint64_t simNowNs;
+static I2C_HandleTypeDef *simBuses;
+static SPI_HandleTypeDef *simSpis;
+GPIO_TypeDef HostSim_GPIOA;
+GPIO_TypeDef HostSim_GPIOB;
+
+HostSim_CacheStats_t HostSim_Cache;
+
+#define HOSTSIM_NEVER_NS UINT64_MAX // busyUntilNs of a hung transfer
+
+#define HOSTSIM_CACHE_CLEAN      0x01
+#define HOSTSIM_CACHE_INVALIDATE 0x02
+#define HOSTSIM_CACHE_RANGES     8 // Maintenance calls remembered between two DMA starts
+
+static struct {
+    uintptr_t start;
+    uintptr_t end;
+    uint8_t op;
+} cacheRanges[HOSTSIM_CACHE_RANGES];
+static uint8_t cacheRangeCount;
+static uintptr_t cacheRxStart; // Buffer of the DMA write whose completion callback runs
+static uintptr_t cacheRxEnd;
+static uint8_t cacheRxDropped;
+
+/* ========================== Static Helpers ============================ */
+
+static HostSim_Device_t *HostSim_FindDevice(I2C_HandleTypeDef *hi2c, uint16_t devAddress)
+{
+    for (HostSim_Device_t *dev = hi2c->devices; dev != NULL; dev = dev->next) {
+        if ((dev->address & 0xFE) == (devAddress & 0xFE)) {
+            return dev;
+        }
+    }
+    return NULL;
+}
+
+static void HostSim_TickDevices(void)
+{
+    for (I2C_HandleTypeDef *bus = simBuses; bus != NULL; bus = bus->next) {
+        for (HostSim_Device_t *dev = bus->devices; dev != NULL; dev = dev->next) {
+            if (dev->tick != NULL) {
+                dev->tick(dev, simNowNs);
+            }
+        }
+    }
+    for (SPI_HandleTypeDef *spi = simSpis; spi != NULL; spi = spi->next) {
+        for (HostSim_SpiDevice_t *dev = spi->devices; dev != NULL; dev = dev->next) {
+            if (dev->tick != NULL) {
+                dev->tick(dev, simNowNs);
+            }
+        }
+    }
+}
+
+static void HostSim_CacheOp(volatile void *addr, int32_t dsize, uint8_t op)
+{
+    uintptr_t start = (uintptr_t)addr;
+    uintptr_t end = start + (uintptr_t)(dsize > 0 ? dsize : 0);
+
+    if (start % HOSTSIM_DCACHE_LINE != 0 || dsize <= 0 || dsize % HOSTSIM_DCACHE_LINE != 0) {
+        HostSim_Cache.unaligned++;
+    }
+    if (op & HOSTSIM_CACHE_CLEAN) {
+        HostSim_Cache.cleans++;
+    }
+    if (op & HOSTSIM_CACHE_INVALIDATE) {
+        HostSim_Cache.invalidates++;
+        if (start <= cacheRxStart && cacheRxEnd <= end) {
+            cacheRxDropped = 1;
+        }
+    }
+    if (cacheRangeCount < HOSTSIM_CACHE_RANGES) {
+        cacheRanges[cacheRangeCount].start = start;
+        cacheRanges[cacheRangeCount].end = end;
+        cacheRanges[cacheRangeCount].op = op;
+        cacheRangeCount++;
+    }
+}
+
+static int HostSim_CacheCovered(const void *buf, uint16_t len, uint8_t op)
+{
+    uintptr_t start = (uintptr_t)buf;
+
+    for (uint8_t i = 0; i < cacheRangeCount; i++) {
+        if ((cacheRanges[i].op & op) == op && cacheRanges[i].start <= start && start + len <= cacheRanges[i].end) {
+            return 1;
+        }
+    }
+    return 0;
+}
+
+/**
+ * @brief Check the maintenance done for a DMA transfer about to start
+ * @param src Buffer the DMA reads, NULL if none
+ * @param srcLen Bytes read
+ * @param dst Buffer the DMA writes, NULL if none
+ * @param dstLen Bytes written
+ */
+static void HostSim_CacheDmaStart(const void *src, uint16_t srcLen, const void *dst, uint16_t dstLen)
+{
+    if (src != NULL && srcLen > 0) {
+        HostSim_Cache.dmaReads++;
+        if (!HostSim_CacheCovered(src, srcLen, HOSTSIM_CACHE_CLEAN)) {
+            HostSim_Cache.uncleaned++;
+        }
+    }
+    if (dst != NULL && dstLen > 0) {
+        HostSim_Cache.dmaWrites++;
+        if (!HostSim_CacheCovered(dst, dstLen, HOSTSIM_CACHE_CLEAN | HOSTSIM_CACHE_INVALIDATE)) {
+            HostSim_Cache.undropped++;
+        }
+    }
+    cacheRangeCount = 0;
+}
+
+/**
+ * @brief Run a completion callback and check it invalidated the DMA write
+ * @param rx Buffer the finished transfer wrote, NULL if none
+ * @param rxLen Bytes written
+ * @param callback Completion callback and its argument
+ * @details Callbacks can start and finish further transfers, so the buffer of
+ *          the outer transfer is put back afterwards.
+ */
+static void HostSim_CacheComplete(const uint8_t *rx, uint16_t rxLen, void (*callback)(void *arg), void *arg)
+{
+    uintptr_t outerStart = cacheRxStart;
+    uintptr_t outerEnd = cacheRxEnd;
+    uint8_t outerDropped = cacheRxDropped;
+
+    cacheRxStart = (uintptr_t)rx;
+    cacheRxEnd = (uintptr_t)rx + rxLen;
+    cacheRxDropped = 0;
+    callback(arg);
+    if (rx != NULL && rxLen > 0 && !cacheRxDropped) {
+        HostSim_Cache.stale++;
+    }
+    cacheRxStart = outerStart;
+    cacheRxEnd = outerEnd;
+    cacheRxDropped = outerDropped;
+}
+
+static void HostSim_I2CCallback(void *arg)
+{
+    I2C_HandleTypeDef *hi2c = (I2C_HandleTypeDef *)arg;
+    HostSim_Cplt_t cplt = hi2c->pendingCplt;
+    hi2c->pendingCplt = HOSTSIM_CPLT_NONE;
+
+    switch (cplt) {
+    case HOSTSIM_CPLT_MEM_TX:    HAL_I2C_MemTxCpltCallback(hi2c); break;
+    case HOSTSIM_CPLT_MEM_RX:    HAL_I2C_MemRxCpltCallback(hi2c); break;
+    case HOSTSIM_CPLT_MASTER_TX: HAL_I2C_MasterTxCpltCallback(hi2c); break;
+    case HOSTSIM_CPLT_MASTER_RX: HAL_I2C_MasterRxCpltCallback(hi2c); break;
+    case HOSTSIM_CPLT_ERROR:     HAL_I2C_ErrorCallback(hi2c); break;
+    default: break;
+    }
+}
+
+static void HostSim_Complete(I2C_HandleTypeDef *hi2c)
+{
+    uint8_t *rx = hi2c->pendingRx;
+
+    hi2c->State = HAL_I2C_STATE_READY;
+    if (rx != NULL) {
+        memcpy(rx, hi2c->rxBuf, hi2c->pendingRxLen);
+        hi2c->pendingRx = NULL;
+    }
+    HostSim_CacheComplete(rx, hi2c->pendingRxLen, HostSim_I2CCallback, hi2c);
+}
+
+/**
+ * @brief Run one transaction against the device models
+ * @param hi2c Bus handle
+ * @param devAddress 8-bit device address
+ * @param tx Bytes written after the address byte, NULL for a pure read
+ * @param txLen Number of bytes written
+ * @param rx Buffer for bytes read after a repeated START, NULL for a pure write
+ * @param rxLen Number of bytes read
+ * @param wireNs Output wire time of the transaction, HOSTSIM_NEVER_NS if it hangs
+ * @return HAL_StatusTypeDef HAL_OK, HAL_BUSY while a DMA transfer is on the wire
+ *         or SDA is held, HAL_ERROR on NACK or an injected bus fault
+ * @details Data moves at the start of the transaction, the caller decides when
+ *          the simulated clock accounts for the wire time.
+ */
+static HAL_StatusTypeDef HostSim_Transfer(I2C_HandleTypeDef *hi2c, uint16_t devAddress, const uint8_t *tx, uint16_t txLen, uint8_t *rx, uint16_t rxLen, uint64_t *wireNs)
+{
+    HostSim_Device_t *dev;
+    HAL_StatusTypeDef status = HAL_OK;
+    HostSim_Fault_t fault = HOSTSIM_FAULT_NONE;
+    uint32_t errorCode = HAL_I2C_ERROR_AF;
+    uint32_t bytes = 0;
+    uint8_t restarts = 0;
+
+    if (hi2c == NULL) {
+        return HAL_ERROR;
+    }
+    if (hi2c->State != HAL_I2C_STATE_READY) {
+        return HAL_BUSY;
+    }
+    hi2c->ErrorCode = HAL_I2C_ERROR_NONE;
+    if (hi2c->fault == HOSTSIM_FAULT_SDA_STUCK) {
+        // The HAL polls the BUSY flag, then gives up without touching the bus
+        hi2c->stats.faults++;
+        HostSim_AdvanceNs((uint64_t)HOSTSIM_BUSY_FLAG_MS * 1000000u);
+        hi2c->ErrorCode = HAL_I2C_ERROR_TIMEOUT;
+        return HAL_BUSY;
+    }
+    if (hi2c->fault != HOSTSIM_FAULT_NONE && hi2c->faultCount > 0) {
+        fault = hi2c->fault;
+        hi2c->stats.faults++;
+        if (--hi2c->faultCount == 0) {
+            hi2c->fault = HOSTSIM_FAULT_NONE;
+        }
+    }
+    HostSim_TickDevices();
+
+    dev = HostSim_FindDevice(hi2c, devAddress);
+    if (fault == HOSTSIM_FAULT_HANG) {
+        *wireNs = HOSTSIM_NEVER_NS;
+        return HAL_OK;
+    }
+    if (dev == NULL || fault != HOSTSIM_FAULT_NONE) {
+        bytes = 1; // Address byte, NACKed or cut short
+        status = HAL_ERROR;
+        errorCode = (fault == HOSTSIM_FAULT_ARB_LOST) ? HAL_I2C_ERROR_ARLO
+                  : (fault == HOSTSIM_FAULT_BUS_ERROR) ? HAL_I2C_ERROR_BERR : HAL_I2C_ERROR_AF;
+    } else {
+        if (tx != NULL) {
+            bytes += 1 + txLen;
+            status = (dev->write != NULL) ? dev->write(dev, tx, txLen) : HAL_ERROR;
+        }
+        if (status == HAL_OK && rx != NULL) {
+            restarts = (tx != NULL) ? 1 : 0;
+            bytes += 1 + rxLen;
+            status = (dev->read != NULL) ? dev->read(dev, rx, rxLen) : HAL_ERROR;
+        }
+    }
+
+    *wireNs = HostSim_WireTimeNs(hi2c, bytes, restarts);
+    hi2c->stats.transactions++;
+    hi2c->stats.bytes += bytes;
+    hi2c->stats.busyNs += *wireNs;
+    if (status != HAL_OK) {
+        hi2c->stats.nacks += (errorCode == HAL_I2C_ERROR_AF);
+        hi2c->ErrorCode = errorCode;
+    }
+    return status;
+}
+
+static HAL_StatusTypeDef HostSim_Blocking(I2C_HandleTypeDef *hi2c, uint16_t devAddress, const uint8_t *tx, uint16_t txLen, uint8_t *rx, uint16_t rxLen, uint32_t timeout)
+{
+    uint64_t wireNs = 0;
+    HAL_StatusTypeDef status = HostSim_Transfer(hi2c, devAddress, tx, txLen, rx, rxLen, &wireNs);
+    if (status == HAL_BUSY) {
+        return status;
+    }
+    if (wireNs == HOSTSIM_NEVER_NS) {
+        // HAL_MAX_DELAY waits for ever on the target; here it costs 49 days of simulated time
+        HostSim_AdvanceNs((uint64_t)timeout * 1000000u);
+        hi2c->ErrorCode = HAL_I2C_ERROR_TIMEOUT;
+        return HAL_TIMEOUT;
+    }
+    HostSim_AdvanceNs(wireNs);
+    return status;
+}
+
+static HAL_StatusTypeDef HostSim_Dma(I2C_HandleTypeDef *hi2c, uint16_t devAddress, const uint8_t *tx, uint16_t txLen, uint8_t *rx, uint16_t rxLen, HostSim_Cplt_t cplt)
+{
+    uint64_t wireNs = 0;
+    HAL_StatusTypeDef status;
+
+    if (rx != NULL && rxLen > HOSTSIM_MAX_FRAME) {
+        return HAL_ERROR;
+    }
+    // Read data lands in the caller's buffer only when the transfer completes
+    status = HostSim_Transfer(hi2c, devAddress, tx, txLen, (rx != NULL) ? hi2c->rxBuf : NULL, rxLen, &wireNs);
+    if (status == HAL_BUSY) {
+        return status;
+    }
+    hi2c->pendingRx = (status == HAL_OK) ? rx : NULL;
+    hi2c->pendingRxLen = rxLen;
+    if (status != HAL_OK) {
+        // The real peripheral reports a NACK through the error callback
+        cplt = HOSTSIM_CPLT_ERROR;
+    }
+    hi2c->State = HAL_I2C_STATE_BUSY;
+    hi2c->pendingCplt = cplt;
+    if (wireNs == HOSTSIM_NEVER_NS) {
+        hi2c->pendingRx = NULL;
+        hi2c->busyUntilNs = HOSTSIM_NEVER_NS;
+        return HAL_OK;
+    }
+    hi2c->busyUntilNs = simNowNs + wireNs;
+    if (hi2c->dmaMode == HOSTSIM_DMA_IMMEDIATE) {
+        HostSim_AdvanceNs(wireNs);
+    }
+    return HAL_OK;
+}
+
+static void HostSim_SpiCallback(void *arg)
+{
+    HAL_SPI_TxRxCpltCallback((SPI_HandleTypeDef *)arg);
+}
+
+static void HostSim_SpiComplete(SPI_HandleTypeDef *hspi)
+{
+    uint8_t *rx = hspi->pendingRx;
+
+    hspi->pendingCplt = 0;
+    hspi->State = HAL_SPI_STATE_READY;
+    if (rx != NULL) {
+        memcpy(rx, hspi->rxBuf, hspi->pendingRxLen);
+        hspi->pendingRx = NULL;
+    }
+    HostSim_CacheComplete(rx, hspi->pendingRxLen, HostSim_SpiCallback, hspi);
+}
+
+/**
+ * @brief Clock one frame through the selected SPI device model
+ * @param hspi Bus handle
+ * @param tx Bytes shifted out on MOSI
+ * @param rx Buffer for the bytes shifted in on MISO
+ * @param len Frame length
+ * @return uint64_t Wire time of the frame
+ */
+static uint64_t HostSim_SpiTransfer(SPI_HandleTypeDef *hspi, const uint8_t *tx, uint8_t *rx, uint16_t len)
+{
+    HostSim_SpiDevice_t *sel = NULL;
+    uint64_t wireNs = HostSim_SpiWireTimeNs(hspi, len);
+
+    HostSim_TickDevices();
+    for (HostSim_SpiDevice_t *dev = hspi->devices; dev != NULL; dev = dev->next) {
+        if (!(dev->csPort->ODR & dev->csPin)) {
+            sel = dev;
+            break;
+        }
+    }
+    if (sel != NULL) {
+        sel->transfer(sel, tx, rx, len);
+    } else {
+        memset(rx, 0xFF, len);
+    }
+    hspi->stats.transactions++;
+    hspi->stats.bytes += len;
+    hspi->stats.busyNs += wireNs;
+    return wireNs;
+}
+
+static uint16_t HostSim_MemFrame(uint8_t *frame, uint16_t memAddress, uint16_t memAddSize)
+{
+    if (memAddSize == I2C_MEMADD_SIZE_16BIT) {
+        frame[0] = (uint8_t)(memAddress >> 8);
+        frame[1] = (uint8_t)memAddress;
+        return 2;
+    }
+    frame[0] = (uint8_t)memAddress;
+    return 1;
+}
+
+/* ========================== HAL Stand-in Functions ============================ */
+
+HAL_StatusTypeDef HAL_I2C_Init(I2C_HandleTypeDef *hi2c)
+{
+    if (hi2c == NULL) {
+        return HAL_ERROR;
+    }
+    hi2c->ErrorCode = HAL_I2C_ERROR_NONE;
+    hi2c->State = HAL_I2C_STATE_READY;
+    return HAL_OK;
+}
+
+/**
+ * @details Drops a transfer on the wire without its completion callback
+ */
+HAL_StatusTypeDef HAL_I2C_DeInit(I2C_HandleTypeDef *hi2c)
+{
+    if (hi2c == NULL) {
+        return HAL_ERROR;
+    }
+    hi2c->pendingCplt = HOSTSIM_CPLT_NONE;
+    hi2c->pendingRx = NULL;
+    hi2c->busyUntilNs = simNowNs;
+    hi2c->ErrorCode = HAL_I2C_ERROR_NONE;
+    hi2c->State = HAL_I2C_STATE_RESET;
+    return HAL_OK;
+}
+
+HAL_StatusTypeDef HAL_I2C_Mem_Write(I2C_HandleTypeDef *hi2c, uint16_t DevAddress, uint16_t MemAddress, uint16_t MemAddSize, uint8_t *pData, uint16_t Size, uint32_t Timeout)
+{
+    uint8_t frame[HOSTSIM_MAX_FRAME];
+    uint16_t len = HostSim_MemFrame(frame, MemAddress, MemAddSize);
+    if (Size > HOSTSIM_MAX_FRAME - len) {
+        return HAL_ERROR;
+    }
+    memcpy(&frame[len], pData, Size);
+    return HostSim_Blocking(hi2c, DevAddress, frame, (uint16_t)(len + Size), NULL, 0, Timeout);
+}
+
+HAL_StatusTypeDef HAL_I2C_Mem_Read(I2C_HandleTypeDef *hi2c, uint16_t DevAddress, uint16_t MemAddress, uint16_t MemAddSize, uint8_t *pData, uint16_t Size, uint32_t Timeout)
+{
+    uint8_t frame[2];
+    uint16_t len = HostSim_MemFrame(frame, MemAddress, MemAddSize);
+    return HostSim_Blocking(hi2c, DevAddress, frame, len, pData, Size, Timeout);
+}
+
+HAL_StatusTypeDef HAL_I2C_Mem_Write_DMA(I2C_HandleTypeDef *hi2c, uint16_t DevAddress, uint16_t MemAddress, uint16_t MemAddSize, uint8_t *pData, uint16_t Size)
+{
+    uint8_t frame[HOSTSIM_MAX_FRAME];
+    uint16_t len = HostSim_MemFrame(frame, MemAddress, MemAddSize);
+    if (Size > HOSTSIM_MAX_FRAME - len) {
+        return HAL_ERROR;
+    }
+    memcpy(&frame[len], pData, Size);
+    HostSim_CacheDmaStart(pData, Size, NULL, 0);
+    return HostSim_Dma(hi2c, DevAddress, frame, (uint16_t)(len + Size), NULL, 0, HOSTSIM_CPLT_MEM_TX);
+}
+
+HAL_StatusTypeDef HAL_I2C_Mem_Read_DMA(I2C_HandleTypeDef *hi2c, uint16_t DevAddress, uint16_t MemAddress, uint16_t MemAddSize, uint8_t *pData, uint16_t Size)
+{
+    uint8_t frame[2];
+    uint16_t len = HostSim_MemFrame(frame, MemAddress, MemAddSize);
+    HostSim_CacheDmaStart(NULL, 0, pData, Size);
+    return HostSim_Dma(hi2c, DevAddress, frame, len, pData, Size, HOSTSIM_CPLT_MEM_RX);
+}
+
+HAL_StatusTypeDef HAL_I2C_Master_Transmit(I2C_HandleTypeDef *hi2c, uint16_t DevAddress, uint8_t *pData, uint16_t Size, uint32_t Timeout)
+{
+    return HostSim_Blocking(hi2c, DevAddress, pData, Size, NULL, 0, Timeout);
+}
+
+HAL_StatusTypeDef HAL_I2C_Master_Receive(I2C_HandleTypeDef *hi2c, uint16_t DevAddress, uint8_t *pData, uint16_t Size, uint32_t Timeout)
+{
+    return HostSim_Blocking(hi2c, DevAddress, NULL, 0, pData, Size, Timeout);
+}
+
+HAL_StatusTypeDef HAL_I2C_Master_Transmit_DMA(I2C_HandleTypeDef *hi2c, uint16_t DevAddress, uint8_t *pData, uint16_t Size)
+{
+    HostSim_CacheDmaStart(pData, Size, NULL, 0);
+    return HostSim_Dma(hi2c, DevAddress, pData, Size, NULL, 0, HOSTSIM_CPLT_MASTER_TX);
+}
+
+HAL_StatusTypeDef HAL_I2C_Master_Receive_DMA(I2C_HandleTypeDef *hi2c, uint16_t DevAddress, uint8_t *pData, uint16_t Size)
+{
+    HostSim_CacheDmaStart(NULL, 0, pData, Size);
+    return HostSim_Dma(hi2c, DevAddress, NULL, 0, pData, Size, HOSTSIM_CPLT_MASTER_RX);
+}
+
+HAL_StatusTypeDef HAL_I2C_IsDeviceReady(I2C_HandleTypeDef *hi2c, uint16_t DevAddress, uint32_t Trials, uint32_t Timeout)
+{
+    (void)Timeout;
+    for (uint32_t i = 0; i < Trials; i++) {
+        if (hi2c->State != HAL_I2C_STATE_READY) {
+            return HAL_BUSY;
+        }
+        uint64_t wireNs = HostSim_WireTimeNs(hi2c, 1, 0);
+        hi2c->stats.transactions++;
+        hi2c->stats.bytes++;
+        hi2c->stats.busyNs += wireNs;
+        HostSim_AdvanceNs(wireNs);
+        if (HostSim_FindDevice(hi2c, DevAddress) != NULL) {
+            return HAL_OK;
+        }
+        hi2c->stats.nacks++;
+    }
+    hi2c->ErrorCode = HAL_I2C_ERROR_AF;
+    return HAL_ERROR;
+}
+
+HAL_I2C_StateTypeDef HAL_I2C_GetState(I2C_HandleTypeDef *hi2c)
+{
+    return hi2c->State;
+}
+
+uint32_t HAL_I2C_GetError(I2C_HandleTypeDef *hi2c)
+{
+    return hi2c->ErrorCode;
+}
+
+__weak void HAL_I2C_MemTxCpltCallback(I2C_HandleTypeDef *hi2c) { (void)hi2c; }
+__weak void HAL_I2C_MemRxCpltCallback(I2C_HandleTypeDef *hi2c) { (void)hi2c; }
+__weak void HAL_I2C_MasterTxCpltCallback(I2C_HandleTypeDef *hi2c) { (void)hi2c; }
+__weak void HAL_I2C_MasterRxCpltCallback(I2C_HandleTypeDef *hi2c) { (void)hi2c; }
+__weak void HAL_I2C_ErrorCallback(I2C_HandleTypeDef *hi2c) { (void)hi2c; }
+
+HAL_StatusTypeDef HAL_SPI_Init(SPI_HandleTypeDef *hspi)
+{
+    if (hspi == NULL) {
+        return HAL_ERROR;
+    }
+    hspi->ErrorCode = HAL_SPI_ERROR_NONE;
+    hspi->State = HAL_SPI_STATE_READY;
+    return HAL_OK;
+}
+
+HAL_StatusTypeDef HAL_SPI_TransmitReceive(SPI_HandleTypeDef *hspi, uint8_t *pTxData, uint8_t *pRxData, uint16_t Size, uint32_t Timeout)
+{
+    (void)Timeout;
+    if (hspi == NULL || Size == 0) {
+        return HAL_ERROR;
+    }
+    if (hspi->State != HAL_SPI_STATE_READY) {
+        return HAL_BUSY;
+    }
+    HostSim_AdvanceNs(HostSim_SpiTransfer(hspi, pTxData, pRxData, Size));
+    return HAL_OK;
+}
+
+HAL_StatusTypeDef HAL_SPI_TransmitReceive_DMA(SPI_HandleTypeDef *hspi, uint8_t *pTxData, uint8_t *pRxData, uint16_t Size)
+{
+    uint64_t wireNs;
+
+    if (hspi == NULL || Size == 0 || Size > HOSTSIM_MAX_FRAME) {
+        return HAL_ERROR;
+    }
+    if (hspi->State != HAL_SPI_STATE_READY) {
+        return HAL_BUSY;
+    }
+    HostSim_CacheDmaStart(pTxData, Size, pRxData, Size);
+    // Received bytes land in the caller's buffer only when the transfer completes
+    wireNs = HostSim_SpiTransfer(hspi, pTxData, hspi->rxBuf, Size);
+    hspi->pendingRx = pRxData;
+    hspi->pendingRxLen = Size;
+    hspi->State = HAL_SPI_STATE_BUSY_TX_RX;
+    hspi->pendingCplt = 1;
+    hspi->busyUntilNs = simNowNs + wireNs;
+    if (hspi->dmaMode == HOSTSIM_DMA_IMMEDIATE) {
+        HostSim_AdvanceNs(wireNs);
+    }
+    return HAL_OK;
+}
+
+HAL_SPI_StateTypeDef HAL_SPI_GetState(SPI_HandleTypeDef *hspi)
+{
+    return hspi->State;
+}
+
+__weak void HAL_SPI_TxRxCpltCallback(SPI_HandleTypeDef *hspi) { (void)hspi; }
+__weak void HAL_SPI_ErrorCallback(SPI_HandleTypeDef *hspi) { (void)hspi; }
+
+void HAL_GPIO_Init(GPIO_TypeDef *GPIOx, GPIO_InitTypeDef *GPIO_Init)
+{
+    if (GPIO_Init->Mode == GPIO_MODE_OUTPUT_OD || GPIO_Init->Mode == GPIO_MODE_OUTPUT_PP) {
+        GPIOx->MODER |= GPIO_Init->Pin;
+    } else {
+        GPIOx->MODER &= ~GPIO_Init->Pin;
+    }
+}
+
+/**
+ * @details A rising edge on a bus SCL pin is one clock for a slave holding SDA
+ */
+void HAL_GPIO_WritePin(GPIO_TypeDef *GPIOx, uint16_t GPIO_Pin, GPIO_PinState PinState)
+{
+    uint32_t before = GPIOx->ODR;
+
+    if (PinState == GPIO_PIN_SET) {
+        GPIOx->ODR |= GPIO_Pin;
+    } else {
+        GPIOx->ODR &= ~(uint32_t)GPIO_Pin;
+    }
+    if ((before & GPIO_Pin) || PinState != GPIO_PIN_SET || !(GPIOx->MODER & GPIO_Pin)) {
+        return;
+    }
+    for (I2C_HandleTypeDef *bus = simBuses; bus != NULL; bus = bus->next) {
+        if (bus->sclPort == GPIOx && bus->sclPin == GPIO_Pin && bus->fault == HOSTSIM_FAULT_SDA_STUCK) {
+            if (bus->faultCount <= 1) {
+                bus->fault = HOSTSIM_FAULT_NONE;
+                bus->faultCount = 0;
+            } else {
+                bus->faultCount--;
+            }
+        }
+    }
+}
+
+GPIO_PinState HAL_GPIO_ReadPin(GPIO_TypeDef *GPIOx, uint16_t GPIO_Pin)
+{
+    for (I2C_HandleTypeDef *bus = simBuses; bus != NULL; bus = bus->next) {
+        if (bus->sdaPort == GPIOx && bus->sdaPin == GPIO_Pin && bus->fault == HOSTSIM_FAULT_SDA_STUCK) {
+            return GPIO_PIN_RESET;
+        }
+    }
+    return (GPIOx->ODR & GPIO_Pin) ? GPIO_PIN_SET : GPIO_PIN_RESET;
+}
+
+void HAL_Delay(uint32_t Delay)
+{
+    HostSim_AdvanceNs((uint64_t)Delay * 1000000u);
+}
+
+uint32_t HAL_GetTick(void)
+{
+    return (uint32_t)(simNowNs / 1000000u);
+}
+
+void SCB_CleanDCache_by_Addr(volatile void *addr, int32_t dsize)
+{
+    HostSim_CacheOp(addr, dsize, HOSTSIM_CACHE_CLEAN);
+}
+
+void SCB_InvalidateDCache_by_Addr(volatile void *addr, int32_t dsize)
+{
+    HostSim_CacheOp(addr, dsize, HOSTSIM_CACHE_INVALIDATE);
+}
+
+void SCB_CleanInvalidateDCache_by_Addr(volatile void *addr, int32_t dsize)
+{
+    HostSim_CacheOp(addr, dsize, HOSTSIM_CACHE_CLEAN | HOSTSIM_CACHE_INVALIDATE);
+}
+
+/* ========================== Simulator Functions ============================ */
+
+/**
+ * @brief Reset the simulated clock and the cache counters, forget every registered bus
+ */
+void HostSim_Reset(void)
+{
+    simNowNs = 0;
+    simBuses = NULL;
+    simSpis = NULL;
+    memset(&HostSim_Cache, 0, sizeof(HostSim_Cache));
+    cacheRangeCount = 0;
+    memset(&HostSim_GPIOA, 0, sizeof(HostSim_GPIOA));
+    memset(&HostSim_GPIOB, 0, sizeof(HostSim_GPIOB));
+}
+
+/**
+ * @brief Initialize a simulated I2C bus
+ * @param hi2c Bus handle
+ * @param clockSpeed SCL frequency in Hz, e.g. 100000, 400000 or 1000000
+ * @param dmaMode How _DMA calls complete
+ */
+void HostSim_I2CInit(I2C_HandleTypeDef *hi2c, uint32_t clockSpeed, HostSim_DmaMode_t dmaMode)
+{
+    memset(hi2c, 0, sizeof(*hi2c));
+    hi2c->Init.ClockSpeed = clockSpeed;
+    hi2c->dmaMode = dmaMode;
+    hi2c->State = HAL_I2C_STATE_READY;
+    hi2c->next = simBuses;
+    simBuses = hi2c;
+}
+
+/**
+ * @brief Connect a device model to a bus
+ * @param hi2c Bus handle
+ * @param dev Device model with its address and callbacks set
+ */
+void HostSim_Attach(I2C_HandleTypeDef *hi2c, HostSim_Device_t *dev)
+{
+    dev->next = hi2c->devices;
+    hi2c->devices = dev;
+}
+
+/**
+ * @brief Current simulated time in nanoseconds
+ */
+uint64_t HostSim_NowNs(void)
+{
+    return simNowNs;
+}
+
+/**
+ * @brief Advance simulated time, completing deferred DMA transfers in time order
+ * @param ns Nanoseconds to advance
+ * @details Completion callbacks run at their completion time and may start new
+ *          transfers, which complete within the same call if they fit.
+ */
+void HostSim_AdvanceNs(uint64_t ns)
+{
+    uint64_t target = simNowNs + ns;
+
+    for (;;) {
+        I2C_HandleTypeDef *first = NULL;
+        SPI_HandleTypeDef *firstSpi = NULL;
+        for (I2C_HandleTypeDef *bus = simBuses; bus != NULL; bus = bus->next) {
+            if (bus->pendingCplt != HOSTSIM_CPLT_NONE && bus->busyUntilNs <= target &&
+                (first == NULL || bus->busyUntilNs < first->busyUntilNs)) {
+                first = bus;
+            }
+        }
+        for (SPI_HandleTypeDef *spi = simSpis; spi != NULL; spi = spi->next) {
+            if (spi->pendingCplt && spi->busyUntilNs <= target &&
+                (firstSpi == NULL || spi->busyUntilNs < firstSpi->busyUntilNs)) {
+                firstSpi = spi;
+            }
+        }
+        if (first == NULL && firstSpi == NULL) {
+            break;
+        }
+        uint64_t at = (first == NULL || (firstSpi != NULL && firstSpi->busyUntilNs < first->busyUntilNs))
+                    ? firstSpi->busyUntilNs : first->busyUntilNs;
+        if (at > simNowNs) {
+            simNowNs = at;
+        }
+        HostSim_TickDevices();
+        if (first != NULL && first->busyUntilNs == at) {
+            HostSim_Complete(first);
+        } else {
+            HostSim_SpiComplete(firstSpi);
+        }
+    }
+    if (target > simNowNs) {
+        simNowNs = target; // A callback may have waited past it, e.g. on a held bus
+    }
+    HostSim_TickDevices();
+}
+
+void HostSim_AdvanceUs(uint32_t us)
+{
+    HostSim_AdvanceNs((uint64_t)us * 1000u);
+}
+
+/**
+ * @brief Advance simulated time until the bus has no transfer on the wire
+ * @param hi2c Bus handle
+ * @details Returns with a hung transfer still pending.
+ */
+void HostSim_RunUntilIdle(I2C_HandleTypeDef *hi2c)
+{
+    while (hi2c->pendingCplt != HOSTSIM_CPLT_NONE && hi2c->busyUntilNs != HOSTSIM_NEVER_NS) {
+        HostSim_AdvanceNs((hi2c->busyUntilNs > simNowNs) ? hi2c->busyUntilNs - simNowNs : 0);
+    }
+}
+
+/**
+ * @brief Sleep until the next simulated interrupt, stands in for __WFI()
+ * @details Advances to the earliest deferred DMA completion on any I2C or SPI
+ *          bus, or by one SysTick
+ *          period (1 ms) if no transfer is on the wire.
+ */
+void HostSim_WaitForEvent(void)
+{
+    uint64_t next = simNowNs + 1000000u;
+
+    for (I2C_HandleTypeDef *bus = simBuses; bus != NULL; bus = bus->next) {
+        if (bus->pendingCplt != HOSTSIM_CPLT_NONE && bus->busyUntilNs < next) {
+            next = bus->busyUntilNs;
+        }
+    }
+    for (SPI_HandleTypeDef *spi = simSpis; spi != NULL; spi = spi->next) {
+        if (spi->pendingCplt && spi->busyUntilNs < next) {
+            next = spi->busyUntilNs;
+        }
+    }
+    HostSim_AdvanceNs((next > simNowNs) ? next - simNowNs : 0);
+}
+
+/**
+ * @brief Wire time of a transaction
+ * @param hi2c Bus handle, provides the SCL frequency
+ * @param bytes Bytes on the wire including address bytes
+ * @param restarts Number of repeated START conditions
+ * @return uint64_t Nanoseconds from START to STOP
+ */
+uint64_t HostSim_WireTimeNs(const I2C_HandleTypeDef *hi2c, uint32_t bytes, uint8_t restarts)
+{
+    uint64_t clocks = 9u * (uint64_t)bytes + 2u + restarts; // 8 data bits + ACK per byte, START, STOP
+    return clocks * 1000000000u / (hi2c->Init.ClockSpeed ? hi2c->Init.ClockSpeed : 100000u);
+}
+
+/**
+ * @brief Reset the bus counters
+ * @param hi2c Bus handle
+ */
+void HostSim_ClearStats(I2C_HandleTypeDef *hi2c)
+{
+    memset(&hi2c->stats, 0, sizeof(hi2c->stats));
+}
+
+/**
+ * @brief Tell the simulator which GPIOs are the bus pins, for bus unlock sequences
+ * @param hi2c Bus handle
+ * @param sclPort SCL port, e.g. GPIOB
+ * @param sclPin SCL pin mask
+ * @param sdaPort SDA port
+ * @param sdaPin SDA pin mask
+ */
+void HostSim_I2CPins(I2C_HandleTypeDef *hi2c, GPIO_TypeDef *sclPort, uint16_t sclPin, GPIO_TypeDef *sdaPort, uint16_t sdaPin)
+{
+    hi2c->sclPort = sclPort;
+    hi2c->sclPin = sclPin;
+    hi2c->sdaPort = sdaPort;
+    hi2c->sdaPin = sdaPin;
+}
+
+/**
+ * @brief Make the next transactions on a bus fail
+ * @param hi2c Bus handle
+ * @param fault Fault to inject, HOSTSIM_FAULT_NONE clears a pending one
+ * @param count Transactions to fail; for HOSTSIM_FAULT_SDA_STUCK the SCL
+ *        clocks the slave needs before it releases SDA, more than one unlock
+ *        sequence gives for a slave that is broken
+ */
+void HostSim_InjectFault(I2C_HandleTypeDef *hi2c, HostSim_Fault_t fault, uint32_t count)
+{
+    hi2c->fault = (count > 0) ? fault : HOSTSIM_FAULT_NONE;
+    hi2c->faultCount = count;
+}
+
+/**
+ * @brief Initialize a simulated SPI bus
+ * @param hspi Bus handle
+ * @param baudRate SCK frequency in Hz, e.g. 10000000
+ * @param dmaMode How _DMA calls complete
+ */
+void HostSim_SPIInit(SPI_HandleTypeDef *hspi, uint32_t baudRate, HostSim_DmaMode_t dmaMode)
+{
+    memset(hspi, 0, sizeof(*hspi));
+    hspi->Init.BaudRate = baudRate;
+    hspi->dmaMode = dmaMode;
+    hspi->State = HAL_SPI_STATE_READY;
+    hspi->next = simSpis;
+    simSpis = hspi;
+}
+
+/**
+ * @brief Connect a device model to an SPI bus
+ * @param hspi Bus handle
+ * @param dev Device model with its chip select and callbacks set
+ */
+void HostSim_AttachSpi(SPI_HandleTypeDef *hspi, HostSim_SpiDevice_t *dev)
+{
+    dev->next = hspi->devices;
+    hspi->devices = dev;
+}
+
+/**
+ * @brief Wire time of an SPI transfer
+ * @param hspi Bus handle, provides the SCK frequency
+ * @param bytes Frame length
+ * @return uint64_t Nanoseconds with chip select low, 8 SCK cycles per byte
+ */
+uint64_t HostSim_SpiWireTimeNs(const SPI_HandleTypeDef *hspi, uint32_t bytes)
+{
+    return 8u * (uint64_t)bytes * 1000000000u / (hspi->Init.BaudRate ? hspi->Init.BaudRate : 1000000u);
+}
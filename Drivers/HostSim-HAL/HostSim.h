@@ -0,0 +1,279 @@
+#ifndef HOSTSIM_H
+#define HOSTSIM_H
+#include <stdint.h>
+#include <stddef.h>
+#include <string.h>
+
+/*------------------- HAL Stand-in Defines ---------------------------*/
+typedef enum {
+    HAL_OK = 0x00U,
+    HAL_ERROR = 0x01U,
+    HAL_BUSY = 0x02U,
+    HAL_TIMEOUT = 0x03U
+} HAL_StatusTypeDef;
+
+typedef enum {
+    HAL_I2C_STATE_RESET = 0x00U,
+    HAL_I2C_STATE_READY = 0x20U,
+    HAL_I2C_STATE_BUSY = 0x24U
+} HAL_I2C_StateTypeDef;
+
+#define HAL_I2C_ERROR_NONE    0x00000000U
+#define HAL_I2C_ERROR_BERR    0x00000001U // Bus error
+#define HAL_I2C_ERROR_ARLO    0x00000002U // Arbitration lost
+#define HAL_I2C_ERROR_AF      0x00000004U // Acknowledge failure
+#define HAL_I2C_ERROR_TIMEOUT 0x00000020U
+
+typedef enum {
+    HAL_SPI_STATE_RESET = 0x00U,
+    HAL_SPI_STATE_READY = 0x01U,
+    HAL_SPI_STATE_BUSY_TX_RX = 0x05U
+} HAL_SPI_StateTypeDef;
+
+#define HAL_SPI_ERROR_NONE 0x00000000U
+
+#define I2C_MEMADD_SIZE_8BIT  0x00000001U
+#define I2C_MEMADD_SIZE_16BIT 0x00000002U
+#define HAL_MAX_DELAY 0xFFFFFFFFU
+
+#ifndef HOSTSIM_MAX_FRAME
+#define HOSTSIM_MAX_FRAME 260 // Register address plus the largest burst a model accepts
+#endif
+
+#ifndef HOSTSIM_BUSY_FLAG_MS
+#define HOSTSIM_BUSY_FLAG_MS 25 // HAL I2C_TIMEOUT_BUSY_FLAG: how long a transfer start waits for a held bus
+#endif
+
+#ifndef __weak
+#define __weak __attribute__((weak))
+#endif
+
+/*------------------- GPIO Stand-in ---------------------------*/
+typedef enum {
+    GPIO_PIN_RESET = 0,
+    GPIO_PIN_SET = 1
+} GPIO_PinState;
+
+#define GPIO_PIN_0  0x0001U
+#define GPIO_PIN_1  0x0002U
+#define GPIO_PIN_2  0x0004U
+#define GPIO_PIN_3  0x0008U
+#define GPIO_PIN_4  0x0010U
+#define GPIO_PIN_5  0x0020U
+#define GPIO_PIN_6  0x0040U
+#define GPIO_PIN_7  0x0080U
+#define GPIO_PIN_8  0x0100U
+#define GPIO_PIN_9  0x0200U
+#define GPIO_PIN_10 0x0400U
+#define GPIO_PIN_11 0x0800U
+#define GPIO_PIN_12 0x1000U
+#define GPIO_PIN_13 0x2000U
+#define GPIO_PIN_14 0x4000U
+#define GPIO_PIN_15 0x8000U
+
+#define GPIO_MODE_INPUT      0x00000000U
+#define GPIO_MODE_OUTPUT_PP  0x00000001U
+#define GPIO_MODE_OUTPUT_OD  0x00000011U
+#define GPIO_MODE_AF_OD      0x00000012U
+#define GPIO_NOPULL          0x00000000U
+#define GPIO_PULLUP          0x00000001U
+#define GPIO_SPEED_FREQ_HIGH 0x00000002U
+
+typedef struct {
+    uint32_t Pin;
+    uint32_t Mode;
+    uint32_t Pull;
+    uint32_t Speed;
+    uint32_t Alternate;
+} GPIO_InitTypeDef;
+
+typedef struct {
+    uint32_t ODR;   // Driven levels; open-drain pins read low while a device pulls them
+    uint32_t MODER; // Pins set up as GPIO outputs, one bit per pin
+} GPIO_TypeDef;
+
+extern GPIO_TypeDef HostSim_GPIOA;
+extern GPIO_TypeDef HostSim_GPIOB;
+#define GPIOA (&HostSim_GPIOA)
+#define GPIOB (&HostSim_GPIOB)
+
+/*------------------- CMSIS Stand-in ---------------------------*/
+// Single-threaded host: interrupts are simulated callbacks, masking is a no-op
+#define __disable_irq() ((void)0)
+#define __enable_irq() ((void)0)
+#define __get_PRIMASK() 0U
+#define __set_PRIMASK(x) ((void)(x))
+#define __WFI() HostSim_WaitForEvent()
+#define HOSTSIM_DCACHE_LINE 32 // Cortex-M7 D-cache line the maintenance calls are checked against
+
+/************************ Simulator Structs ********************************/
+typedef enum {
+    HOSTSIM_DMA_IMMEDIATE = 0, // _DMA calls finish before returning, completion callback included
+    HOSTSIM_DMA_DEFERRED = 1   // _DMA calls finish when simulated time passes the wire time
+} HostSim_DmaMode_t;
+
+typedef enum {
+    HOSTSIM_CPLT_NONE = 0,
+    HOSTSIM_CPLT_MEM_TX,
+    HOSTSIM_CPLT_MEM_RX,
+    HOSTSIM_CPLT_MASTER_TX,
+    HOSTSIM_CPLT_MASTER_RX,
+    HOSTSIM_CPLT_ERROR
+} HostSim_Cplt_t;
+
+typedef enum {
+    HOSTSIM_FAULT_NONE = 0,
+    HOSTSIM_FAULT_NACK,      // The next transactions are not acknowledged
+    HOSTSIM_FAULT_ARB_LOST,  // The next transactions lose arbitration
+    HOSTSIM_FAULT_BUS_ERROR, // The next transactions end in a bus error
+    HOSTSIM_FAULT_HANG,      // The next transfers never complete
+    HOSTSIM_FAULT_SDA_STUCK  // A slave holds SDA low until clocked on the SCL GPIO
+} HostSim_Fault_t;
+
+typedef struct HostSim_Device_s HostSim_Device_t;
+
+/**
+ * I2C device model. A write transaction delivers every byte after the address
+ * byte, a read transaction asks for len bytes. Returning HAL_ERROR NACKs.
+ */
+struct HostSim_Device_s {
+    uint16_t address; // 8-bit HAL address
+    HAL_StatusTypeDef (*write)(HostSim_Device_t *dev, const uint8_t *data, uint16_t len);
+    HAL_StatusTypeDef (*read)(HostSim_Device_t *dev, uint8_t *data, uint16_t len);
+    void (*tick)(HostSim_Device_t *dev, uint64_t nowNs); // Optional, called whenever time advances
+    HostSim_Device_t *next;
+};
+
+typedef struct {
+    uint64_t transactions; // START ... STOP sequences, a register read counts once
+    uint64_t bytes;        // Bytes on the wire including address and register bytes
+    uint64_t busyNs;       // Time SCL was driven
+    uint64_t nacks;
+    uint64_t faults;       // Transactions hit by an injected fault
+} HostSim_BusStats_t;
+
+// There is no cache on the host: the SCB maintenance calls are recorded and
+// every DMA transfer is checked against the ones made for its buffers
+typedef struct {
+    uint64_t cleans;      // Clean and clean-invalidate calls
+    uint64_t invalidates; // Invalidate and clean-invalidate calls
+    uint64_t unaligned;   // Calls not on whole cache lines
+    uint64_t dmaReads;    // DMA transfers out of memory
+    uint64_t dmaWrites;   // DMA transfers into memory
+    uint64_t uncleaned;   // DMA reads of a buffer not cleaned since the previous DMA start
+    uint64_t undropped;   // DMA writes to a buffer not clean-invalidated since the previous DMA start
+    uint64_t stale;       // Completed DMA writes whose buffer the completion callback did not invalidate
+} HostSim_CacheStats_t;
+
+extern HostSim_CacheStats_t HostSim_Cache;
+
+typedef struct HostSim_SpiDevice_s HostSim_SpiDevice_t;
+
+/**
+ * SPI device model. Selected while its chip-select GPIO is low, it sees each
+ * transfer as one full-duplex frame and fills rx byte for byte against tx.
+ */
+struct HostSim_SpiDevice_s {
+    GPIO_TypeDef *csPort;
+    uint16_t csPin;
+    void (*transfer)(HostSim_SpiDevice_t *dev, const uint8_t *tx, uint8_t *rx, uint16_t len);
+    void (*tick)(HostSim_SpiDevice_t *dev, uint64_t nowNs); // Optional, called whenever time advances
+    HostSim_SpiDevice_t *next;
+};
+
+typedef struct {
+    uint32_t ClockSpeed; // SCL frequency in Hz
+} I2C_InitTypeDef;
+
+typedef struct __I2C_HandleTypeDef {
+    I2C_InitTypeDef Init;
+    HostSim_DmaMode_t dmaMode;
+    volatile HAL_I2C_StateTypeDef State;
+    volatile uint32_t ErrorCode;
+    HostSim_Device_t *devices;
+    HostSim_BusStats_t stats;
+    uint64_t busyUntilNs; // End of the transfer currently on the wire
+    HostSim_Cplt_t pendingCplt;
+    uint8_t *pendingRx;   // Caller buffer filled when a deferred DMA read completes
+    uint16_t pendingRxLen;
+    uint8_t rxBuf[HOSTSIM_MAX_FRAME];
+    HostSim_Fault_t fault;
+    uint32_t faultCount;  // Transactions still to fault, or for SDA_STUCK the SCL clocks until release
+    GPIO_TypeDef *sclPort;
+    GPIO_TypeDef *sdaPort;
+    uint16_t sclPin;
+    uint16_t sdaPin;
+    struct __I2C_HandleTypeDef *next;
+} I2C_HandleTypeDef;
+
+typedef struct {
+    uint32_t BaudRate; // SCK frequency in Hz; the real HAL sets a prescaler of the bus clock
+} SPI_InitTypeDef;
+
+typedef struct __SPI_HandleTypeDef {
+    SPI_InitTypeDef Init;
+    HostSim_DmaMode_t dmaMode;
+    volatile HAL_SPI_StateTypeDef State;
+    volatile uint32_t ErrorCode;
+    HostSim_SpiDevice_t *devices;
+    HostSim_BusStats_t stats; // A transaction is one transfer; nacks and faults stay 0
+    uint64_t busyUntilNs;
+    uint8_t pendingCplt;      // A DMA transfer waits for its completion callback
+    uint8_t *pendingRx;
+    uint16_t pendingRxLen;
+    uint8_t rxBuf[HOSTSIM_MAX_FRAME];
+    struct __SPI_HandleTypeDef *next;
+} SPI_HandleTypeDef;
+
+/*------------------- HAL Stand-in Prototypes ---------------------------*/
+HAL_StatusTypeDef HAL_I2C_Init(I2C_HandleTypeDef *hi2c);
+HAL_StatusTypeDef HAL_I2C_DeInit(I2C_HandleTypeDef *hi2c);
+HAL_StatusTypeDef HAL_I2C_Mem_Write(I2C_HandleTypeDef *hi2c, uint16_t DevAddress, uint16_t MemAddress, uint16_t MemAddSize, uint8_t *pData, uint16_t Size, uint32_t Timeout);
+HAL_StatusTypeDef HAL_I2C_Mem_Read(I2C_HandleTypeDef *hi2c, uint16_t DevAddress, uint16_t MemAddress, uint16_t MemAddSize, uint8_t *pData, uint16_t Size, uint32_t Timeout);
+HAL_StatusTypeDef HAL_I2C_Mem_Write_DMA(I2C_HandleTypeDef *hi2c, uint16_t DevAddress, uint16_t MemAddress, uint16_t MemAddSize, uint8_t *pData, uint16_t Size);
+HAL_StatusTypeDef HAL_I2C_Mem_Read_DMA(I2C_HandleTypeDef *hi2c, uint16_t DevAddress, uint16_t MemAddress, uint16_t MemAddSize, uint8_t *pData, uint16_t Size);
+HAL_StatusTypeDef HAL_I2C_Master_Transmit(I2C_HandleTypeDef *hi2c, uint16_t DevAddress, uint8_t *pData, uint16_t Size, uint32_t Timeout);
+HAL_StatusTypeDef HAL_I2C_Master_Receive(I2C_HandleTypeDef *hi2c, uint16_t DevAddress, uint8_t *pData, uint16_t Size, uint32_t Timeout);
+HAL_StatusTypeDef HAL_I2C_Master_Transmit_DMA(I2C_HandleTypeDef *hi2c, uint16_t DevAddress, uint8_t *pData, uint16_t Size);
+HAL_StatusTypeDef HAL_I2C_Master_Receive_DMA(I2C_HandleTypeDef *hi2c, uint16_t DevAddress, uint8_t *pData, uint16_t Size);
+HAL_StatusTypeDef HAL_I2C_IsDeviceReady(I2C_HandleTypeDef *hi2c, uint16_t DevAddress, uint32_t Trials, uint32_t Timeout);
+HAL_I2C_StateTypeDef HAL_I2C_GetState(I2C_HandleTypeDef *hi2c);
+uint32_t HAL_I2C_GetError(I2C_HandleTypeDef *hi2c);
+void HAL_I2C_MemTxCpltCallback(I2C_HandleTypeDef *hi2c);
+void HAL_I2C_MemRxCpltCallback(I2C_HandleTypeDef *hi2c);
+void HAL_I2C_MasterTxCpltCallback(I2C_HandleTypeDef *hi2c);
+void HAL_I2C_MasterRxCpltCallback(I2C_HandleTypeDef *hi2c);
+void HAL_I2C_ErrorCallback(I2C_HandleTypeDef *hi2c);
+HAL_StatusTypeDef HAL_SPI_Init(SPI_HandleTypeDef *hspi);
+HAL_StatusTypeDef HAL_SPI_TransmitReceive(SPI_HandleTypeDef *hspi, uint8_t *pTxData, uint8_t *pRxData, uint16_t Size, uint32_t Timeout);
+HAL_StatusTypeDef HAL_SPI_TransmitReceive_DMA(SPI_HandleTypeDef *hspi, uint8_t *pTxData, uint8_t *pRxData, uint16_t Size);
+HAL_SPI_StateTypeDef HAL_SPI_GetState(SPI_HandleTypeDef *hspi);
+void HAL_SPI_TxRxCpltCallback(SPI_HandleTypeDef *hspi);
+void HAL_SPI_ErrorCallback(SPI_HandleTypeDef *hspi);
+void HAL_GPIO_Init(GPIO_TypeDef *GPIOx, GPIO_InitTypeDef *GPIO_Init);
+void HAL_GPIO_WritePin(GPIO_TypeDef *GPIOx, uint16_t GPIO_Pin, GPIO_PinState PinState);
+GPIO_PinState HAL_GPIO_ReadPin(GPIO_TypeDef *GPIOx, uint16_t GPIO_Pin);
+void HAL_Delay(uint32_t Delay);
+uint32_t HAL_GetTick(void);
+void SCB_CleanDCache_by_Addr(volatile void *addr, int32_t dsize);
+void SCB_InvalidateDCache_by_Addr(volatile void *addr, int32_t dsize);
+void SCB_CleanInvalidateDCache_by_Addr(volatile void *addr, int32_t dsize);
+
+/*------------------- Simulator Prototypes ---------------------------*/
+void HostSim_Reset(void);
+void HostSim_I2CInit(I2C_HandleTypeDef *hi2c, uint32_t clockSpeed, HostSim_DmaMode_t dmaMode);
+void HostSim_Attach(I2C_HandleTypeDef *hi2c, HostSim_Device_t *dev);
+uint64_t HostSim_NowNs(void);
+void HostSim_AdvanceNs(uint64_t ns);
+void HostSim_AdvanceUs(uint32_t us);
+void HostSim_RunUntilIdle(I2C_HandleTypeDef *hi2c);
+void HostSim_WaitForEvent(void);
+uint64_t HostSim_WireTimeNs(const I2C_HandleTypeDef *hi2c, uint32_t bytes, uint8_t restarts);
+void HostSim_ClearStats(I2C_HandleTypeDef *hi2c);
+void HostSim_I2CPins(I2C_HandleTypeDef *hi2c, GPIO_TypeDef *sclPort, uint16_t sclPin, GPIO_TypeDef *sdaPort, uint16_t sdaPin);
+void HostSim_InjectFault(I2C_HandleTypeDef *hi2c, HostSim_Fault_t fault, uint32_t count);
+void HostSim_SPIInit(SPI_HandleTypeDef *hspi, uint32_t baudRate, HostSim_DmaMode_t dmaMode);
+void HostSim_AttachSpi(SPI_HandleTypeDef *hspi, HostSim_SpiDevice_t *dev);
+uint64_t HostSim_SpiWireTimeNs(const SPI_HandleTypeDef *hspi, uint32_t bytes);
+
+#endif
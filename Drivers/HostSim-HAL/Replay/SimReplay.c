@@ -0,0 +1,232 @@
+#include "SimReplay.h"
+
+/**
+ ******************************************************************************
+ * @file    SimReplay.c
+ * @author  Yair Yamin
+ * @brief   Device model that answers the drivers from an I2CRec recording.
+ * @details Stands in for every device of one recorded bus. Transactions are
+ * expected in recorded order: writes are compared byte for byte, reads return
+ * the recorded data and NACKs are reproduced.
+ *
+ * - A transaction that does not match is counted, answered as well as possible
+ *   and the recording moves on, so one divergence does not hide later ones.
+ * - Each transaction's start is compared with its recorded start, relative to
+ *   the first one, giving the largest lead and lag of the replayed firmware.
+ * - Time is HostSim's simulated clock, a replay runs as fast as the host can
+ *   execute the drivers.
+ ******************************************************************************
+ */
+
+/* ========================== Static Helpers ============================ */
+
+static void SimReplay_Fetch(SimReplay_t *replay)
+{
+    replay->haveNext = 0;
+    while (I2CRec_Next(&replay->reader, &replay->next) == HAL_OK) {
+        if (replay->next.bus == replay->bus) {
+            replay->haveNext = 1;
+            return;
+        }
+    }
+}
+
+static void SimReplay_Mismatch(SimReplay_t *replay)
+{
+    if (replay->stats.mismatches == 0) {
+        replay->stats.firstMismatch = replay->reader.index - 1;
+    }
+    replay->stats.mismatches++;
+}
+
+/**
+ * @brief Compare the start of the current transaction with the recording
+ */
+static void SimReplay_Timing(SimReplay_t *replay)
+{
+    uint64_t now = HostSim_NowNs();
+
+    if (replay->stats.replayed == 0) {
+        replay->originNs = now;
+        replay->originTicks = replay->next.start;
+        return;
+    }
+    int64_t recordedNs = (replay->next.start - replay->originTicks) * 1000000000ll / replay->reader.tickHz;
+    int64_t skewNs = (int64_t)(now - replay->originNs) - recordedNs;
+    if (skewNs > replay->stats.maxLagNs) {
+        replay->stats.maxLagNs = skewNs;
+    }
+    if (-skewNs > replay->stats.maxLeadNs) {
+        replay->stats.maxLeadNs = -skewNs;
+    }
+}
+
+static HAL_StatusTypeDef SimReplay_Consume(SimReplay_t *replay)
+{
+    HAL_StatusTypeDef status = (HAL_StatusTypeDef)replay->next.status;
+    replay->stats.replayed++;
+    replay->addressed = 0;
+    SimReplay_Fetch(replay);
+    return status;
+}
+
+static uint8_t SimReplay_Matches(const I2CRec_Record_t *rec, const uint8_t *data, uint16_t len, uint8_t withPayload)
+{
+    uint16_t expected = rec->regSize + (withPayload ? rec->len : 0);
+
+    if (len != expected) {
+        return 0;
+    }
+    if (rec->regSize == 2 && (data[0] != (uint8_t)(rec->reg >> 8) || data[1] != (uint8_t)rec->reg)) {
+        return 0;
+    }
+    if (rec->regSize == 1 && data[0] != (uint8_t)rec->reg) {
+        return 0;
+    }
+    return !withPayload || rec->len == 0 || rec->data == NULL || memcmp(&data[rec->regSize], rec->data, rec->len) == 0;
+}
+
+static HAL_StatusTypeDef SimReplay_Write(HostSim_Device_t *dev, const uint8_t *data, uint16_t len)
+{
+    SimReplay_t *replay = ((SimReplay_Device_t *)dev)->replay;
+    const I2CRec_Record_t *rec = &replay->next;
+
+    if (!replay->haveNext) {
+        replay->stats.overruns++;
+        return HAL_ERROR;
+    }
+    SimReplay_Timing(replay);
+    if ((rec->device & 0xFE) != (dev->address & 0xFE)) {
+        SimReplay_Mismatch(replay);
+        SimReplay_Consume(replay);
+        return HAL_OK;
+    }
+
+    switch (rec->op) {
+    case I2CREC_OP_MEM_READ:
+        if (!SimReplay_Matches(rec, data, len, 0)) {
+            SimReplay_Mismatch(replay);
+            if (len != rec->regSize) {
+                SimReplay_Consume(replay); // A write with payload, no read follows
+                return HAL_OK;
+            }
+        }
+        if (rec->status != HAL_OK) {
+            return SimReplay_Consume(replay);
+        }
+        replay->addressed = 1; // The read after the repeated START consumes the record
+        return HAL_OK;
+    case I2CREC_OP_MEM_WRITE:
+    case I2CREC_OP_TRANSMIT:
+        if (!SimReplay_Matches(rec, data, len, 1)) {
+            SimReplay_Mismatch(replay);
+        }
+        return SimReplay_Consume(replay);
+    default:
+        SimReplay_Mismatch(replay); // A read was recorded
+        SimReplay_Consume(replay);
+        return HAL_OK;
+    }
+}
+
+static HAL_StatusTypeDef SimReplay_Read(HostSim_Device_t *dev, uint8_t *data, uint16_t len)
+{
+    SimReplay_t *replay = ((SimReplay_Device_t *)dev)->replay;
+    const I2CRec_Record_t *rec = &replay->next;
+
+    if (!replay->haveNext) {
+        replay->stats.overruns++;
+        return HAL_ERROR;
+    }
+    if (!replay->addressed) {
+        SimReplay_Timing(replay);
+        if (rec->op != I2CREC_OP_RECEIVE || (rec->device & 0xFE) != (dev->address & 0xFE)) {
+            SimReplay_Mismatch(replay);
+            memset(data, 0, len);
+            SimReplay_Consume(replay);
+            return HAL_OK;
+        }
+    }
+
+    uint16_t copy = (rec->data == NULL) ? 0 : (rec->len < len ? rec->len : len);
+    if (len != rec->len) {
+        SimReplay_Mismatch(replay);
+    }
+    if (copy != 0) {
+        memcpy(data, rec->data, copy);
+    }
+    memset(&data[copy], 0, len - copy);
+    return SimReplay_Consume(replay);
+}
+
+ /* ========================== Function Definitions ============================ */
+
+/**
+ * @brief Load a recording for one bus
+ * @param replay Model state
+ * @param recording I2CRec recording, must stay valid during the replay
+ * @param len Recording length
+ * @param bus Bus number in the recording, 0 for the first bus the recorder saw
+ * @return HAL_StatusTypeDef HAL_OK, HAL_ERROR if the recording is invalid or has
+ *         more than SIMREPLAY_MAX_DEVICES addresses on the bus
+ * @details One device model is created per address found on the bus.
+ */
+HAL_StatusTypeDef SimReplay_Init(SimReplay_t *replay, const uint8_t *recording, uint32_t len, uint8_t bus)
+{
+    I2CRec_Record_t rec;
+
+    memset(replay, 0, sizeof(*replay));
+    replay->bus = bus;
+    if (I2CRec_ReaderInit(&replay->reader, recording, len) != HAL_OK || replay->reader.tickHz == 0) {
+        return HAL_ERROR;
+    }
+
+    I2CRec_Reader_t scan = replay->reader;
+    while (I2CRec_Next(&scan, &rec) == HAL_OK) {
+        uint8_t known = 0;
+        if (rec.bus != bus) {
+            continue;
+        }
+        for (uint8_t i = 0; i < replay->deviceCount; i++) {
+            known |= ((replay->devices[i].dev.address & 0xFE) == (rec.device & 0xFE));
+        }
+        if (known) {
+            continue;
+        }
+        if (replay->deviceCount == SIMREPLAY_MAX_DEVICES) {
+            return HAL_ERROR;
+        }
+        SimReplay_Device_t *device = &replay->devices[replay->deviceCount++];
+        device->dev.address = rec.device & 0xFE;
+        device->dev.write = SimReplay_Write;
+        device->dev.read = SimReplay_Read;
+        device->replay = replay;
+    }
+
+    SimReplay_Fetch(replay);
+    return HAL_OK;
+}
+
+/**
+ * @brief Connect the recorded devices to a simulated bus
+ * @param replay Model state loaded with SimReplay_Init()
+ * @param hi2c Bus handle, do not attach other models with the same addresses
+ * @return HAL_StatusTypeDef HAL_OK
+ */
+HAL_StatusTypeDef SimReplay_Attach(SimReplay_t *replay, I2C_HandleTypeDef *hi2c)
+{
+    for (uint8_t i = 0; i < replay->deviceCount; i++) {
+        HostSim_Attach(hi2c, &replay->devices[i].dev);
+    }
+    return HAL_OK;
+}
+
+/**
+ * @brief Check whether every recorded transaction was replayed
+ * @param replay Model state
+ * @return uint8_t 1 when the recording is exhausted
+ */
+uint8_t SimReplay_Done(const SimReplay_t *replay)
+{
+    return !replay->haveNext;
+}
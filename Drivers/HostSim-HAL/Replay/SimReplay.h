@@ -0,0 +1,46 @@
+#ifndef SIM_REPLAY_H
+#define SIM_REPLAY_H
+#include "HostSim.h"
+#include "I2CRec.h"
+
+/*------------------- Configuration ---------------------------*/
+#ifndef SIMREPLAY_MAX_DEVICES
+#define SIMREPLAY_MAX_DEVICES 8 // Addresses answered per bus
+#endif
+
+/************************ Model Structs ********************************/
+typedef struct SimReplay_s SimReplay_t;
+
+typedef struct {
+    HostSim_Device_t dev;  // Must stay first, the bus hands this pointer back to the model
+    SimReplay_t *replay;
+} SimReplay_Device_t;
+
+typedef struct {
+    uint32_t replayed;      // Records consumed by the drivers
+    uint32_t mismatches;    // Transactions that differ from the recording
+    uint32_t firstMismatch; // Record index of the first mismatch, valid if mismatches != 0
+    uint32_t overruns;      // Transactions after the recording ended
+    int64_t maxLeadNs;      // Largest amount a transaction started earlier than recorded
+    int64_t maxLagNs;       // Largest amount a transaction started later than recorded
+} SimReplay_Stats_t;
+
+struct SimReplay_s {
+    I2CRec_Reader_t reader;
+    I2CRec_Record_t next;   // Record the next transaction must match
+    uint8_t haveNext;
+    uint8_t addressed;      // Register phase of a memory read matched, the read follows
+    uint8_t bus;            // Bus number in the recording
+    uint8_t deviceCount;
+    SimReplay_Device_t devices[SIMREPLAY_MAX_DEVICES];
+    uint64_t originNs;      // HostSim time of the first transaction
+    int64_t originTicks;    // Recorded start of the first transaction
+    SimReplay_Stats_t stats;
+};
+
+/*------------------- Function Prototypes ---------------------------*/
+HAL_StatusTypeDef SimReplay_Init(SimReplay_t *replay, const uint8_t *recording, uint32_t len, uint8_t bus);
+HAL_StatusTypeDef SimReplay_Attach(SimReplay_t *replay, I2C_HandleTypeDef *hi2c);
+uint8_t SimReplay_Done(const SimReplay_t *replay);
+
+#endif
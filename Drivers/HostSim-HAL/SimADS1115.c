@@ -0,0 +1,163 @@
+#include "SimADS1115.h"
+
+/**
+ ******************************************************************************
+ * @file    SimADS1115.c
+ * @author  Yair Yamin
+ * @brief   Register-accurate ADS1115 model for the host simulated HAL.
+ * @see     https://www.ti.com/lit/ds/symlink/ads1115.pdf
+ * @details Follows the datasheet I2C protocol: the first byte of a write
+ * selects the address pointer, a full 16-bit value (MSB first) after it
+ * updates the register. Reads return the register the pointer selects.
+ *
+ * - Writing OS=1 in power-down mode starts a single-shot conversion that
+ *   completes after one data-rate period; OS reads 0 until it is done.
+ * - Continuous mode produces a new result every data-rate period.
+ * - Results follow MUX and PGA from the input voltages set with
+ *   SimADS1115_SetInput() and clip at the full-scale range.
+ ******************************************************************************
+ */
+
+/* ========================== Defines ============================ */
+#define SIM_ADS1115_CONFIG_DEFAULT 0x8583
+#define SIM_ADS1115_OS   0x8000
+#define SIM_ADS1115_MODE 0x0100
+
+/* ========================== Lookup Tables ============================ */
+static const uint16_t dataRateSps[8] = {8, 16, 32, 64, 128, 250, 475, 860};
+static const float fullScaleV[8] = {6.144f, 4.096f, 2.048f, 1.024f, 0.512f, 0.256f, 0.256f, 0.256f};
+
+/* ========================== Static Helpers ============================ */
+
+static int16_t SimADS1115_Sample(const SimADS1115_t *sim)
+{
+    uint16_t config = sim->reg[1];
+    float volts;
+
+    switch ((config >> 12) & 0x7) {
+    case 0: volts = sim->ain[0] - sim->ain[1]; break;
+    case 1: volts = sim->ain[0] - sim->ain[3]; break;
+    case 2: volts = sim->ain[1] - sim->ain[3]; break;
+    case 3: volts = sim->ain[2] - sim->ain[3]; break;
+    default: volts = sim->ain[((config >> 12) & 0x7) - 4]; break;
+    }
+
+    float code = volts / fullScaleV[(config >> 9) & 0x7] * 32768.0f;
+    if (code >= 32767.0f) {
+        return 32767;
+    }
+    if (code <= -32768.0f) {
+        return -32768;
+    }
+    return (int16_t)code;
+}
+
+static void SimADS1115_Tick(HostSim_Device_t *dev, uint64_t nowNs)
+{
+    SimADS1115_t *sim = (SimADS1115_t *)dev;
+
+    if (sim->converting && nowNs >= sim->convDoneNs) {
+        sim->reg[0] = (uint16_t)SimADS1115_Sample(sim);
+        sim->reg[1] |= SIM_ADS1115_OS;
+        sim->converting = 0;
+    }
+    if (!(sim->reg[1] & SIM_ADS1115_MODE)) {
+        uint64_t period = SimADS1115_ConvTimeNs(sim->reg[1]);
+        while (nowNs >= sim->nextContNs) {
+            sim->reg[0] = (uint16_t)SimADS1115_Sample(sim);
+            sim->nextContNs += period;
+        }
+    }
+}
+
+static HAL_StatusTypeDef SimADS1115_Write(HostSim_Device_t *dev, const uint8_t *data, uint16_t len)
+{
+    SimADS1115_t *sim = (SimADS1115_t *)dev;
+    uint64_t now = HostSim_NowNs();
+
+    if (len == 0) {
+        return HAL_OK;
+    }
+    sim->pointer = data[0] & 0x03;
+    if (len < 3) {
+        return HAL_OK; // Pointer update only, a lone data byte is dropped by the chip
+    }
+
+    uint16_t value = (uint16_t)((data[1] << 8) | data[2]);
+    switch (sim->pointer) {
+    case 0:
+        break; // Conversion register is read-only
+    case 1: {
+        uint16_t old = sim->reg[1];
+        sim->reg[1] = (uint16_t)((value & ~SIM_ADS1115_OS) | (old & SIM_ADS1115_OS));
+        if (!(value & SIM_ADS1115_MODE)) {
+            if (old & SIM_ADS1115_MODE) {
+                sim->nextContNs = now + SimADS1115_ConvTimeNs(value); // Continuous mode starts now
+            }
+            sim->converting = 0;
+        } else if ((value & SIM_ADS1115_OS) && !sim->converting) {
+            sim->converting = 1;
+            sim->convDoneNs = now + SimADS1115_ConvTimeNs(value);
+            sim->reg[1] &= (uint16_t)~SIM_ADS1115_OS;
+        }
+        break;
+    }
+    default:
+        sim->reg[sim->pointer] = value;
+        break;
+    }
+    return HAL_OK;
+}
+
+static HAL_StatusTypeDef SimADS1115_Read(HostSim_Device_t *dev, uint8_t *data, uint16_t len)
+{
+    SimADS1115_t *sim = (SimADS1115_t *)dev;
+    uint16_t value = sim->reg[sim->pointer];
+
+    for (uint16_t i = 0; i < len; i++) {
+        data[i] = (i & 1) ? (uint8_t)value : (uint8_t)(value >> 8);
+    }
+    return HAL_OK;
+}
+
+/* ========================== Function Definitions ============================ */
+
+/**
+ * @brief Initialize the model with the power-on register values
+ * @param sim Pointer to the model
+ * @param address 8-bit I2C address, e.g. 0x48 << 1
+ */
+void SimADS1115_Init(SimADS1115_t *sim, uint16_t address)
+{
+    memset(sim, 0, sizeof(*sim));
+    sim->dev.address = address;
+    sim->dev.write = SimADS1115_Write;
+    sim->dev.read = SimADS1115_Read;
+    sim->dev.tick = SimADS1115_Tick;
+    sim->reg[1] = SIM_ADS1115_CONFIG_DEFAULT;
+    sim->reg[2] = 0x8000;
+    sim->reg[3] = 0x7FFF;
+}
+
+/**
+ * @brief Set the voltage on an analog input
+ * @param sim Pointer to the model
+ * @param ain Input index 0-3
+ * @param volts Voltage relative to GND
+ */
+void SimADS1115_SetInput(SimADS1115_t *sim, uint8_t ain, float volts)
+{
+    if (ain < 4) {
+        sim->ain[ain] = volts;
+    }
+}
+
+/**
+ * @brief Conversion time for a config register value
+ * @param config Config register value, only the DR bits are used
+ * @return uint64_t One data-rate period in nanoseconds
+ */
+uint64_t SimADS1115_ConvTimeNs(uint16_t config)
+{
+    return 1000000000u / dataRateSps[(config >> 5) & 0x7];
+}
@@ -0,0 +1,21 @@
+#ifndef SIM_ADS1115_H
+#define SIM_ADS1115_H
+#include "HostSim.h"
+
+/************************ Model Structs ********************************/
+typedef struct {
+    HostSim_Device_t dev; // Must stay first, the bus hands this pointer back to the model
+    uint16_t reg[4];      // Conversion, config, lo_thresh, hi_thresh
+    uint8_t pointer;      // Address pointer register
+    float ain[4];         // Input voltages in volts
+    uint8_t converting;   // Single-shot conversion in progress
+    uint64_t convDoneNs;  // End of the single-shot conversion
+    uint64_t nextContNs;  // End of the next continuous-mode conversion
+} SimADS1115_t;
+
+/*------------------- Function Prototypes ---------------------------*/
+void SimADS1115_Init(SimADS1115_t *sim, uint16_t address);
+void SimADS1115_SetInput(SimADS1115_t *sim, uint8_t ain, float volts);
+uint64_t SimADS1115_ConvTimeNs(uint16_t config);
+
+#endif
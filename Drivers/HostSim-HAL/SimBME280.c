@@ -0,0 +1,289 @@
+#include "SimBME280.h"
+
+/**
+ ******************************************************************************
+ * @file    SimBME280.c
+ * @author  Yair Yamin
+ * @brief   Register-accurate BME280 model for the host simulated HAL.
+ * @see     https://www.bosch-sensortec.com/media/boschsensortec/downloads/datasheets/bst-bme280-ds002.pdf
+ * @details Follows the datasheet I2C protocol: writes are register/data pairs,
+ * reads auto-increment from the last written register address. The same model
+ * also answers 4-wire SPI (SimBME280_AttachSpi()), where bit 7 of each
+ * register address is the read/write bit.
+ *
+ * - Calibration NVM holds a fixed example set, chip ID is 0x60.
+ * - ctrl_hum only takes effect with the next ctrl_meas write.
+ * - Forced mode runs one measurement and returns to sleep, normal mode
+ *   repeats with the t_sb standby time from config. status.measuring is
+ *   set while a measurement runs.
+ * - Measurement time is the datasheet typical
+ *   1 + 2*T + (2*P + 0.5) + (2*H + 0.5) ms for oversampling T, P and H.
+ * - Writing 0xB6 to reset restores the power-on state, status.im_update
+ *   is set for 2 ms while the NVM is copied.
+ * - Skipped channels read 0x80000 (0x8000 for humidity).
+ ******************************************************************************
+ */
+
+/* ========================== Defines ============================ */
+#define SIM_BME280_ID         0x60
+#define SIM_BME280_RESET_WORD 0xB6
+#define SIM_BME280_MEASURING  0x08
+#define SIM_BME280_IM_UPDATE  0x01
+#define SIM_BME280_NVM_COPY_NS 2000000u
+
+/* ========================== Lookup Tables ============================ */
+static const uint8_t oversampling[8] = {0, 1, 2, 4, 8, 16, 16, 16};
+static const uint32_t standbyUs[8] = {500, 62500, 125000, 250000, 500000, 1000000, 10000, 20000};
+
+/* ========================== Static Helpers ============================ */
+
+static void SimBME280_Put16(uint8_t *regs, uint8_t reg, uint16_t value)
+{
+    regs[reg] = (uint8_t)value;
+    regs[reg + 1] = (uint8_t)(value >> 8);
+}
+
+static void SimBME280_PowerOn(SimBME280_t *sim)
+{
+    uint8_t *regs = sim->regs;
+    memset(regs, 0, sizeof(sim->regs));
+
+    // Calibration example set from the Bosch reference code
+    SimBME280_Put16(regs, 0x88, 27504);             // dig_T1
+    SimBME280_Put16(regs, 0x8A, 26435);             // dig_T2
+    SimBME280_Put16(regs, 0x8C, (uint16_t)-1000);   // dig_T3
+    SimBME280_Put16(regs, 0x8E, 36477);             // dig_P1
+    SimBME280_Put16(regs, 0x90, (uint16_t)-10685);  // dig_P2
+    SimBME280_Put16(regs, 0x92, 3024);              // dig_P3
+    SimBME280_Put16(regs, 0x94, 2855);              // dig_P4
+    SimBME280_Put16(regs, 0x96, 140);               // dig_P5
+    SimBME280_Put16(regs, 0x98, (uint16_t)-7);      // dig_P6
+    SimBME280_Put16(regs, 0x9A, 15500);             // dig_P7
+    SimBME280_Put16(regs, 0x9C, (uint16_t)-14600);  // dig_P8
+    SimBME280_Put16(regs, 0x9E, 6000);              // dig_P9
+    regs[0xA1] = 75;                                // dig_H1
+    SimBME280_Put16(regs, 0xE1, 362);               // dig_H2
+    regs[0xE3] = 0;                                 // dig_H3
+    regs[0xE4] = 324 >> 4;                          // dig_H4 [11:4]
+    regs[0xE5] = (324 & 0x0F) | ((50 & 0x0F) << 4); // dig_H4 [3:0], dig_H5 [3:0]
+    regs[0xE6] = 50 >> 4;                           // dig_H5 [11:4]
+    regs[0xE7] = 30;                                // dig_H6
+
+    regs[0xD0] = SIM_BME280_ID;
+    regs[0xF7] = 0x80; // press
+    regs[0xFA] = 0x80; // temp
+    regs[0xFD] = 0x80; // hum
+
+    sim->osrsH = 0;
+    sim->measuring = 0;
+}
+
+static void SimBME280_Latch(SimBME280_t *sim)
+{
+    uint8_t *regs = sim->regs;
+    uint8_t ctrlMeas = regs[0xF4];
+    uint32_t press = ((ctrlMeas >> 2) & 0x7) ? (uint32_t)sim->adcP : 0x80000;
+    uint32_t temp = ((ctrlMeas >> 5) & 0x7) ? (uint32_t)sim->adcT : 0x80000;
+    uint32_t hum = (sim->osrsH & 0x7) ? (uint32_t)sim->adcH : 0x8000;
+
+    regs[0xF7] = (uint8_t)(press >> 12);
+    regs[0xF8] = (uint8_t)(press >> 4);
+    regs[0xF9] = (uint8_t)((press & 0x0F) << 4);
+    regs[0xFA] = (uint8_t)(temp >> 12);
+    regs[0xFB] = (uint8_t)(temp >> 4);
+    regs[0xFC] = (uint8_t)((temp & 0x0F) << 4);
+    regs[0xFD] = (uint8_t)(hum >> 8);
+    regs[0xFE] = (uint8_t)hum;
+}
+
+static void SimBME280_Tick(HostSim_Device_t *dev, uint64_t nowNs)
+{
+    SimBME280_t *sim = (SimBME280_t *)dev;
+
+    for (;;) {
+        uint8_t mode = sim->regs[0xF4] & 0x03;
+        if (sim->measuring) {
+            if (nowNs < sim->measDoneNs) {
+                return;
+            }
+            SimBME280_Latch(sim);
+            sim->measuring = 0;
+            if (mode == 0x03) {
+                sim->nextMeasNs = sim->measDoneNs + (uint64_t)standbyUs[sim->regs[0xF5] >> 5] * 1000u;
+            } else {
+                sim->regs[0xF4] &= (uint8_t)~0x03; // Forced mode falls back to sleep
+                return;
+            }
+        } else if (mode == 0x03 && nowNs >= sim->nextMeasNs) {
+            sim->measuring = 1;
+            sim->measDoneNs = sim->nextMeasNs + SimBME280_MeasTimeNs(sim->regs[0xF4], sim->osrsH);
+        } else {
+            return;
+        }
+    }
+}
+
+static void SimBME280_WriteReg(SimBME280_t *sim, uint8_t reg, uint8_t value, uint64_t now)
+{
+    switch (reg) {
+    case 0xE0:
+        if (value == SIM_BME280_RESET_WORD) {
+            SimBME280_PowerOn(sim);
+            sim->resetDoneNs = now + SIM_BME280_NVM_COPY_NS;
+        }
+        break;
+    case 0xF2:
+        sim->regs[0xF2] = value & 0x07;
+        break;
+    case 0xF4:
+        sim->regs[0xF4] = value;
+        sim->osrsH = sim->regs[0xF2];
+        if ((value & 0x03) == 0x03) {
+            if (!sim->measuring) {
+                sim->nextMeasNs = now;
+            }
+        } else if ((value & 0x03) != 0x00 && !sim->measuring) {
+            sim->measuring = 1;
+            sim->measDoneNs = now + SimBME280_MeasTimeNs(value, sim->osrsH);
+        }
+        break;
+    case 0xF5:
+        sim->regs[0xF5] = value & 0xFD;
+        break;
+    default:
+        break; // Read-only
+    }
+}
+
+static HAL_StatusTypeDef SimBME280_Write(HostSim_Device_t *dev, const uint8_t *data, uint16_t len)
+{
+    SimBME280_t *sim = (SimBME280_t *)dev;
+    uint64_t now = HostSim_NowNs();
+
+    if (len == 0) {
+        return HAL_OK;
+    }
+    sim->pointer = data[0];
+    for (uint16_t i = 0; i + 1 < len; i += 2) {
+        SimBME280_WriteReg(sim, data[i], data[i + 1], now);
+    }
+    SimBME280_Tick(dev, now);
+    return HAL_OK;
+}
+
+static HAL_StatusTypeDef SimBME280_Read(HostSim_Device_t *dev, uint8_t *data, uint16_t len)
+{
+    SimBME280_t *sim = (SimBME280_t *)dev;
+    uint64_t now = HostSim_NowNs();
+
+    sim->regs[0xF3] = (sim->measuring ? SIM_BME280_MEASURING : 0) | ((now < sim->resetDoneNs) ? SIM_BME280_IM_UPDATE : 0);
+    for (uint16_t i = 0; i < len; i++) {
+        data[i] = sim->regs[sim->pointer++];
+    }
+    return HAL_OK;
+}
+
+static SimBME280_t *SimBME280_FromSpi(HostSim_SpiDevice_t *dev)
+{
+    return (SimBME280_t *)((uint8_t *)dev - offsetof(SimBME280_t, spi));
+}
+
+/**
+ * @details Control byte with bit 7 set: read from that address on. Clear: the
+ *          frame is register/data pairs, addresses sent without bit 7.
+ */
+static void SimBME280_SpiTransfer(HostSim_SpiDevice_t *dev, const uint8_t *tx, uint8_t *rx, uint16_t len)
+{
+    SimBME280_t *sim = SimBME280_FromSpi(dev);
+    uint8_t frame[HOSTSIM_MAX_FRAME];
+
+    rx[0] = 0xFF; // MISO is not driven during the control byte
+    if (tx[0] & 0x80) {
+        sim->pointer = tx[0];
+        SimBME280_Read(&sim->dev, &rx[1], (uint16_t)(len - 1));
+        return;
+    }
+    for (uint16_t i = 0; i < len; i++) {
+        frame[i] = (i & 1) ? tx[i] : (uint8_t)(tx[i] | 0x80);
+        rx[i] = 0xFF;
+    }
+    SimBME280_Write(&sim->dev, frame, len);
+}
+
+static void SimBME280_SpiTick(HostSim_SpiDevice_t *dev, uint64_t nowNs)
+{
+    SimBME280_Tick(&SimBME280_FromSpi(dev)->dev, nowNs);
+}
+
+/* ========================== Function Definitions ============================ */
+
+/**
+ * @brief Initialize the model with the power-on register values
+ * @param sim Pointer to the model
+ * @param address 8-bit I2C address, e.g. 0x76 << 1
+ * @details Raw readings default to the Bosch reference example (about 25 degC, 1006 hPa).
+ */
+void SimBME280_Init(SimBME280_t *sim, uint16_t address)
+{
+    memset(sim, 0, sizeof(*sim));
+    sim->dev.address = address;
+    sim->dev.write = SimBME280_Write;
+    sim->dev.read = SimBME280_Read;
+    sim->dev.tick = SimBME280_Tick;
+    sim->adcT = 519888;
+    sim->adcP = 415148;
+    sim->adcH = 30000;
+    SimBME280_PowerOn(sim);
+}
+
+/**
+ * @brief Connect the model to an SPI bus instead of (or besides) an I2C bus
+ * @param sim Pointer to the model, initialized with SimBME280_Init()
+ * @param hspi Bus handle
+ * @param csPort Chip-select port, e.g. GPIOA
+ * @param csPin Chip-select pin mask
+ */
+void SimBME280_AttachSpi(SimBME280_t *sim, SPI_HandleTypeDef *hspi, GPIO_TypeDef *csPort, uint16_t csPin)
+{
+    sim->spi.csPort = csPort;
+    sim->spi.csPin = csPin;
+    sim->spi.transfer = SimBME280_SpiTransfer;
+    sim->spi.tick = SimBME280_SpiTick;
+    HostSim_AttachSpi(hspi, &sim->spi);
+}
+
+/**
+ * @brief Set the raw readings latched by the next completed measurement
+ * @param sim Pointer to the model
+ * @param adcT Raw 20-bit temperature
+ * @param adcP Raw 20-bit pressure
+ * @param adcH Raw 16-bit humidity
+ */
+void SimBME280_SetRaw(SimBME280_t *sim, int32_t adcT, int32_t adcP, int32_t adcH)
+{
+    sim->adcT = adcT & 0xFFFFF;
+    sim->adcP = adcP & 0xFFFFF;
+    sim->adcH = adcH & 0xFFFF;
+}
+
+/**
+ * @brief Typical measurement time for a ctrl_meas / ctrl_hum setting
+ * @param ctrlMeas ctrl_meas register value
+ * @param ctrlHum ctrl_hum register value
+ * @return uint64_t Measurement time in nanoseconds
+ */
+uint64_t SimBME280_MeasTimeNs(uint8_t ctrlMeas, uint8_t ctrlHum)
+{
+    uint8_t osT = oversampling[(ctrlMeas >> 5) & 0x7];
+    uint8_t osP = oversampling[(ctrlMeas >> 2) & 0x7];
+    uint8_t osH = oversampling[ctrlHum & 0x7];
+    uint64_t us = 1000u + 2000u * osT;
+
+    if (osP) {
+        us += 2000u * osP + 500u;
+    }
+    if (osH) {
+        us += 2000u * osH + 500u;
+    }
+    return us * 1000u;
+}
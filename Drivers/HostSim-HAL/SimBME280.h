@@ -0,0 +1,27 @@
+#ifndef SIM_BME280_H
+#define SIM_BME280_H
+#include "HostSim.h"
+
+/************************ Model Structs ********************************/
+typedef struct {
+    HostSim_Device_t dev; // Must stay first, the bus hands this pointer back to the model
+    uint8_t regs[256];    // Register file, addressed like the chip
+    uint8_t pointer;      // Register address for the next read
+    int32_t adcT;         // Raw 20-bit temperature latched by the next measurement
+    int32_t adcP;         // Raw 20-bit pressure latched by the next measurement
+    int32_t adcH;         // Raw 16-bit humidity latched by the next measurement
+    uint8_t osrsH;        // ctrl_hum value latched by the last ctrl_meas write
+    uint8_t measuring;
+    uint64_t measDoneNs;  // End of the measurement in progress
+    uint64_t nextMeasNs;  // Start of the next normal-mode measurement
+    uint64_t resetDoneNs; // End of the NVM copy after a soft reset
+    HostSim_SpiDevice_t spi; // Used once attached with SimBME280_AttachSpi()
+} SimBME280_t;
+
+/*------------------- Function Prototypes ---------------------------*/
+void SimBME280_Init(SimBME280_t *sim, uint16_t address);
+void SimBME280_SetRaw(SimBME280_t *sim, int32_t adcT, int32_t adcP, int32_t adcH);
+void SimBME280_AttachSpi(SimBME280_t *sim, SPI_HandleTypeDef *hspi, GPIO_TypeDef *csPort, uint16_t csPin);
+uint64_t SimBME280_MeasTimeNs(uint8_t ctrlMeas, uint8_t ctrlHum);
+
+#endif
@@ -0,0 +1,307 @@
+#include "SimDS3231.h"
+
+/**
+ ******************************************************************************
+ * @file    SimDS3231.c
+ * @author  Yair Yamin
+ * @brief   Register-accurate DS3231 model for the host simulated HAL.
+ * @see     https://www.analog.com/media/en/technical-documentation/data-sheets/DS3231.pdf
+ * @details Follows the datasheet I2C protocol: the first byte of a write sets
+ * the register pointer, following bytes are written with auto-increment and
+ * reads continue from the pointer, wrapping from 0x12 back to 0x00.
+ *
+ * - Timekeeping runs from the simulated clock, scaled by the crystal error
+ *   set with SimDS3231_SetDrift() minus 100 ppb per aging register LSB.
+ * - Writing the seconds register resets the countdown chain.
+ * - Alarm 1 and Alarm 2 are matched once per second, honouring the AxMy
+ *   mask bits and DY/DT, and set A1F/A2F. INT/SQW is asserted while a flag
+ *   and its enable are set with INTCN=1.
+ * - A temperature conversion runs every 64 s and on CONV, keeping BSY (and
+ *   CONV) set for 200 ms before the temperature registers update.
+ * - Status flags can only be cleared by writes, BSY is read-only.
+ * - 24-hour mode only, the 12/24 bit is ignored.
+ ******************************************************************************
+ */
+
+/* ========================== Defines ============================ */
+#define SIM_DS3231_CONTROL_DEFAULT 0x1C
+#define SIM_DS3231_STATUS_DEFAULT  0x88 // OSF | EN32kHz
+#define SIM_DS3231_CONV_NS   200000000u
+#define SIM_DS3231_AUTO_CONV_NS (64ull * 1000000000u)
+#define SIM_DS3231_NS_PER_S  1000000000ll
+#define SIM_DS3231_LAST_REG  0x12
+
+/* ========================== Static Helpers ============================ */
+
+static uint8_t SimDS3231_FromBcd(uint8_t bcd)
+{
+    return (uint8_t)((bcd >> 4) * 10 + (bcd & 0x0F));
+}
+
+static uint8_t SimDS3231_ToBcd(uint8_t value)
+{
+    return (uint8_t)(((value / 10) << 4) | (value % 10));
+}
+
+static uint8_t SimDS3231_DaysInMonth(uint8_t month, uint8_t year)
+{
+    static const uint8_t days[12] = {31, 28, 31, 30, 31, 30, 31, 31, 30, 31, 30, 31};
+    if (month == 2 && (year % 4) == 0) {
+        return 29; // Valid for 2000-2099
+    }
+    return days[(month - 1) % 12];
+}
+
+static void SimDS3231_UpdateInt(SimDS3231_t *sim)
+{
+    uint8_t control = sim->regs[0x0E];
+    uint8_t status = sim->regs[0x0F];
+    uint8_t asserted = (control & 0x04) && (status & control & 0x03);
+
+    if (asserted && !sim->intAsserted && sim->onInt != NULL) {
+        sim->intAsserted = asserted;
+        sim->onInt(sim->intCtx);
+        return;
+    }
+    sim->intAsserted = asserted;
+}
+
+static uint8_t SimDS3231_AlarmField(uint8_t reg, uint8_t value, uint8_t mask)
+{
+    return (reg & 0x80) || ((reg & mask) == (value & mask));
+}
+
+static uint8_t SimDS3231_AlarmDay(const uint8_t *regs, uint8_t reg)
+{
+    if (reg & 0x80) {
+        return 1;
+    }
+    if (reg & 0x40) {
+        return (reg & 0x0F) == (regs[0x03] & 0x07); // Day of week
+    }
+    return (reg & 0x3F) == (regs[0x04] & 0x3F); // Date
+}
+
+static void SimDS3231_CheckAlarms(SimDS3231_t *sim)
+{
+    uint8_t *regs = sim->regs;
+
+    if (SimDS3231_AlarmField(regs[0x07], regs[0x00], 0x7F) &&
+        SimDS3231_AlarmField(regs[0x08], regs[0x01], 0x7F) &&
+        SimDS3231_AlarmField(regs[0x09], regs[0x02], 0x3F) &&
+        SimDS3231_AlarmDay(regs, regs[0x0A])) {
+        regs[0x0F] |= 0x01;
+    }
+    if (regs[0x00] == 0 &&
+        SimDS3231_AlarmField(regs[0x0B], regs[0x01], 0x7F) &&
+        SimDS3231_AlarmField(regs[0x0C], regs[0x02], 0x3F) &&
+        SimDS3231_AlarmDay(regs, regs[0x0D])) {
+        regs[0x0F] |= 0x02;
+    }
+    SimDS3231_UpdateInt(sim);
+}
+
+static void SimDS3231_NextSecond(SimDS3231_t *sim)
+{
+    uint8_t *regs = sim->regs;
+    uint8_t sec = SimDS3231_FromBcd(regs[0x00] & 0x7F);
+    uint8_t min = SimDS3231_FromBcd(regs[0x01] & 0x7F);
+    uint8_t hour = SimDS3231_FromBcd(regs[0x02] & 0x3F);
+    uint8_t dow = regs[0x03] & 0x07;
+    uint8_t date = SimDS3231_FromBcd(regs[0x04] & 0x3F);
+    uint8_t month = SimDS3231_FromBcd(regs[0x05] & 0x1F);
+    uint8_t century = regs[0x05] & 0x80;
+    uint8_t year = SimDS3231_FromBcd(regs[0x06]);
+
+    if (++sec >= 60) {
+        sec = 0;
+        if (++min >= 60) {
+            min = 0;
+            if (++hour >= 24) {
+                hour = 0;
+                dow = (uint8_t)(dow % 7 + 1);
+                if (++date > SimDS3231_DaysInMonth(month, year)) {
+                    date = 1;
+                    if (++month > 12) {
+                        month = 1;
+                        if (++year > 99) {
+                            year = 0;
+                            century ^= 0x80;
+                        }
+                    }
+                }
+            }
+        }
+    }
+
+    regs[0x00] = SimDS3231_ToBcd(sec);
+    regs[0x01] = SimDS3231_ToBcd(min);
+    regs[0x02] = SimDS3231_ToBcd(hour);
+    regs[0x03] = dow;
+    regs[0x04] = SimDS3231_ToBcd(date);
+    regs[0x05] = (uint8_t)(century | SimDS3231_ToBcd(month));
+    regs[0x06] = SimDS3231_ToBcd(year);
+    SimDS3231_CheckAlarms(sim);
+}
+
+static void SimDS3231_StartConv(SimDS3231_t *sim, uint64_t nowNs)
+{
+    sim->converting = 1;
+    sim->convDoneNs = nowNs + SIM_DS3231_CONV_NS;
+    sim->regs[0x0F] |= 0x04; // BSY
+}
+
+static void SimDS3231_Tick(HostSim_Device_t *dev, uint64_t nowNs)
+{
+    SimDS3231_t *sim = (SimDS3231_t *)dev;
+    int64_t ppb = sim->driftPpb - (int64_t)(int8_t)sim->regs[0x10] * 100;
+    int64_t dt = (int64_t)(nowNs - sim->lastNs);
+
+    sim->lastNs = nowNs;
+    sim->fracNs += dt + (dt / SIM_DS3231_NS_PER_S) * ppb + (dt % SIM_DS3231_NS_PER_S) * ppb / SIM_DS3231_NS_PER_S;
+    while (sim->fracNs >= SIM_DS3231_NS_PER_S) {
+        sim->fracNs -= SIM_DS3231_NS_PER_S;
+        SimDS3231_NextSecond(sim);
+    }
+
+    if (sim->converting && nowNs >= sim->convDoneNs) {
+        sim->converting = 0;
+        sim->regs[0x0E] &= (uint8_t)~0x20; // CONV
+        sim->regs[0x0F] &= (uint8_t)~0x04; // BSY
+        sim->regs[0x11] = (uint8_t)(sim->temp >> 2);
+        sim->regs[0x12] = (uint8_t)((sim->temp & 0x03) << 6);
+    }
+    if (nowNs >= sim->nextConvNs) {
+        sim->nextConvNs = nowNs + SIM_DS3231_AUTO_CONV_NS;
+        if (!sim->converting) {
+            SimDS3231_StartConv(sim, nowNs);
+        }
+    }
+}
+
+static void SimDS3231_WriteReg(SimDS3231_t *sim, uint8_t reg, uint8_t value)
+{
+    switch (reg) {
+    case 0x00:
+        sim->regs[0x00] = value & 0x7F;
+        sim->fracNs = 0; // Countdown chain reset
+        break;
+    case 0x0E:
+        sim->regs[0x0E] = (uint8_t)(value & ~0x20) | (sim->regs[0x0E] & 0x20);
+        if ((value & 0x20) && !(sim->regs[0x0F] & 0x04)) {
+            sim->regs[0x0E] |= 0x20;
+            SimDS3231_StartConv(sim, HostSim_NowNs());
+        }
+        SimDS3231_UpdateInt(sim);
+        break;
+    case 0x0F:
+        // OSF, A2F and A1F can only be cleared, EN32kHz is read/write, BSY is read-only
+        sim->regs[0x0F] = (uint8_t)((sim->regs[0x0F] & value & 0x83) | (value & 0x08) | (sim->regs[0x0F] & 0x04));
+        SimDS3231_UpdateInt(sim);
+        break;
+    case 0x11:
+    case 0x12:
+        break; // Read-only
+    default:
+        sim->regs[reg] = value;
+        break;
+    }
+}
+
+static HAL_StatusTypeDef SimDS3231_Write(HostSim_Device_t *dev, const uint8_t *data, uint16_t len)
+{
+    SimDS3231_t *sim = (SimDS3231_t *)dev;
+
+    if (len == 0) {
+        return HAL_OK;
+    }
+    if (data[0] > SIM_DS3231_LAST_REG) {
+        return HAL_ERROR;
+    }
+    sim->pointer = data[0];
+    for (uint16_t i = 1; i < len; i++) {
+        SimDS3231_WriteReg(sim, sim->pointer, data[i]);
+        sim->pointer = (sim->pointer >= SIM_DS3231_LAST_REG) ? 0 : (uint8_t)(sim->pointer + 1);
+    }
+    return HAL_OK;
+}
+
+static HAL_StatusTypeDef SimDS3231_Read(HostSim_Device_t *dev, uint8_t *data, uint16_t len)
+{
+    SimDS3231_t *sim = (SimDS3231_t *)dev;
+
+    for (uint16_t i = 0; i < len; i++) {
+        data[i] = sim->regs[sim->pointer];
+        sim->pointer = (sim->pointer >= SIM_DS3231_LAST_REG) ? 0 : (uint8_t)(sim->pointer + 1);
+    }
+    return HAL_OK;
+}
+
+/* ========================== Function Definitions ============================ */
+
+/**
+ * @brief Initialize the model with the power-on register values
+ * @param sim Pointer to the model
+ * @param address 8-bit I2C address, e.g. 0x68 << 1
+ * @details The clock starts at 01/01/2000 00:00:00 (a Saturday) with OSF set,
+ *          25 degC and no crystal error.
+ */
+void SimDS3231_Init(SimDS3231_t *sim, uint16_t address)
+{
+    memset(sim, 0, sizeof(*sim));
+    sim->dev.address = address;
+    sim->dev.write = SimDS3231_Write;
+    sim->dev.read = SimDS3231_Read;
+    sim->dev.tick = SimDS3231_Tick;
+    sim->regs[0x03] = 7;
+    sim->regs[0x04] = 0x01;
+    sim->regs[0x05] = 0x01;
+    sim->regs[0x0E] = SIM_DS3231_CONTROL_DEFAULT;
+    sim->regs[0x0F] = SIM_DS3231_STATUS_DEFAULT;
+    sim->temp = 25 * 4;
+    sim->regs[0x11] = 25;
+    sim->lastNs = HostSim_NowNs();
+    sim->nextConvNs = sim->lastNs + SIM_DS3231_AUTO_CONV_NS;
+}
+
+/**
+ * @brief Set the crystal frequency error
+ * @param sim Pointer to the model
+ * @param ppb Error in parts per billion, positive makes the clock run fast
+ */
+void SimDS3231_SetDrift(SimDS3231_t *sim, int32_t ppb)
+{
+    sim->driftPpb = ppb;
+}
+
+/**
+ * @brief Set the die temperature reported by the next conversion
+ * @param sim Pointer to the model
+ * @param quarterDegC Temperature in 0.25 degC steps
+ */
+void SimDS3231_SetTemp(SimDS3231_t *sim, int16_t quarterDegC)
+{
+    sim->temp = quarterDegC;
+}
+
+/**
+ * @brief Register a function called when the INT/SQW pin becomes asserted
+ * @param sim Pointer to the model
+ * @param callback Called from the simulated clock, typically forwards to the EXTI handler
+ * @param ctx User pointer passed to the callback
+ */
+void SimDS3231_SetIntCallback(SimDS3231_t *sim, SimDS3231_IntCallback_t callback, void *ctx)
+{
+    sim->onInt = callback;
+    sim->intCtx = ctx;
+}
+
+/**
+ * @brief Current INT/SQW pin state
+ * @param sim Pointer to the model
+ * @return uint8_t 1 while an enabled alarm flag is set in interrupt mode
+ */
+uint8_t SimDS3231_IntAsserted(const SimDS3231_t *sim)
+{
+    return sim->intAsserted;
+}
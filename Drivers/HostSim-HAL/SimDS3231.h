@@ -0,0 +1,31 @@
+#ifndef SIM_DS3231_H
+#define SIM_DS3231_H
+#include "HostSim.h"
+
+/************************ Model Structs ********************************/
+typedef void (*SimDS3231_IntCallback_t)(void *ctx);
+
+typedef struct {
+    HostSim_Device_t dev;  // Must stay first, the bus hands this pointer back to the model
+    uint8_t regs[19];      // Register file 0x00-0x12
+    uint8_t pointer;       // Address pointer, wraps after 0x12
+    uint64_t lastNs;       // Simulated time of the last tick
+    int64_t fracNs;        // Countdown chain position inside the current second
+    int32_t driftPpb;      // Crystal error before aging trim, positive runs fast
+    int16_t temp;          // Die temperature in 0.25 degC steps
+    uint8_t converting;
+    uint64_t convDoneNs;   // End of the temperature conversion in progress
+    uint64_t nextConvNs;   // Next automatic 64 s temperature conversion
+    uint8_t intAsserted;   // INT/SQW pin state, active high here
+    SimDS3231_IntCallback_t onInt; // Called when INT/SQW becomes asserted
+    void *intCtx;
+} SimDS3231_t;
+
+/*------------------- Function Prototypes ---------------------------*/
+void SimDS3231_Init(SimDS3231_t *sim, uint16_t address);
+void SimDS3231_SetDrift(SimDS3231_t *sim, int32_t ppb);
+void SimDS3231_SetTemp(SimDS3231_t *sim, int16_t quarterDegC);
+void SimDS3231_SetIntCallback(SimDS3231_t *sim, SimDS3231_IntCallback_t callback, void *ctx);
+uint8_t SimDS3231_IntAsserted(const SimDS3231_t *sim);
+
+#endif
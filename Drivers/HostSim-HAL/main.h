@@ -0,0 +1,9 @@
+#ifndef __MAIN_H
+#define __MAIN_H
+/**
+ * Host stand-in for the CubeMX generated main.h. Put this directory on the
+ * include path instead of the target's Core/Inc to build the drivers on Linux.
+ */
+#include "HostSim.h"
+
+#endif
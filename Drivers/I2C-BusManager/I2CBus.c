@@ -0,0 +1,665 @@
+#include "I2CBus.h"
+#include "DmaCache.h"
+#include <string.h>
+
+/**
+ ******************************************************************************
+ * @file    I2CBus.c
+ * @author  Yair Yamin
+ * @brief   Shared I2C bus manager with a prioritized transaction queue.
+ * @details Owns one I2C peripheral and serializes the transactions of every
+ * driver on it, so a DMA transfer started from an interrupt never collides
+ * with a transfer from the main loop.
+ *
+ * - Transactions are queued by value in a bounded queue and started with the
+ *   HAL _DMA functions one at a time.
+ * - The next transaction is dispatched from the completion callback, highest
+ *   priority first, oldest first within a priority.
+ * - A queued transaction gains one priority level per I2CBUS_AGING_TICKS of
+ *   waiting, so low-priority clients cannot be starved.
+ * - Each client keeps wait, latency, error and overtake counters.
+ *
+ * Recovery, bounding the time a driver call can take:
+ * - A transfer that holds the bus longer than bus->txnTimeout is aborted by
+ *   I2CBus_Poll() (the blocking calls poll while they wait) and completes
+ *   with HAL_TIMEOUT.
+ * - Failures are counted by class. A bus error resets the peripheral; a held
+ *   SDA line or an aborted transfer also clocks the bus free if the pins are
+ *   known (I2CBus_SetRecovery()).
+ * - Blocking calls retry failed attempts with doubling backoff, but never
+ *   past their client timeout.
+ *
+ * Route the HAL completion callbacks to I2CBus_OnComplete(), or define
+ * I2CBUS_HAL_CALLBACKS to let this file implement them.
+ *
+ * With DRIVERS_DCACHE the data of each transaction is cleaned from the D-cache
+ * before the DMA reads it and invalidated around a DMA read; the buffers must
+ * own their cache lines (DMACACHE_REGION()).
+ *
+ * With I2CBUS_RTOS the queue is guarded by the RTOS critical section, a
+ * blocking call sleeps its task on a DriverOS event that the completion
+ * interrupt signals, and a per-bus mutex lets one task keep the bus for a
+ * sequence of calls (I2CBus_Acquire()).
+ ******************************************************************************
+ */
+
+/* ========================== Defines ============================ */
+#ifdef I2CBUS_RTOS
+#define I2CBUS_LOCK()   DRIVER_OS_CRITICAL_ENTER()
+#define I2CBUS_UNLOCK() DRIVER_OS_CRITICAL_EXIT()
+#else
+#define I2CBUS_LOCK()   uint32_t primask = __get_PRIMASK(); __disable_irq()
+#define I2CBUS_UNLOCK() __set_PRIMASK(primask)
+#endif
+
+/* ========================== Global Variables ============================ */
+static I2CBus_t *busRegistry[I2CBUS_MAX_BUSES];
+
+/* ========================== Static Helpers ============================ */
+
+static I2CBus_t *I2CBus_Find(I2C_HandleTypeDef *hi2c)
+{
+    for (uint8_t i = 0; i < I2CBUS_MAX_BUSES; i++) {
+        if (busRegistry[i] != NULL && busRegistry[i]->hi2c == hi2c) {
+            return busRegistry[i];
+        }
+    }
+    return NULL;
+}
+
+/**
+ * @brief Pick the queued transaction to run next
+ * @param bus Pointer to bus
+ * @param now Current I2CBUS_NOW() value
+ * @return uint8_t Queue index of the winner, the queue must not be empty
+ */
+static uint8_t I2CBus_PickNext(I2CBus_t *bus, uint32_t now)
+{
+    uint8_t best = 0;
+    uint32_t bestScore = 0;
+
+    for (uint8_t i = 0; i < bus->count; i++) {
+        const I2CBus_Txn_t *txn = &bus->queue[i];
+        uint32_t score = txn->priority + (now - txn->submitted) / I2CBUS_AGING_TICKS;
+        if (i == 0 || score > bestScore ||
+            (score == bestScore && (int32_t)(txn->seq - bus->queue[best].seq) < 0)) {
+            best = i;
+            bestScore = score;
+        }
+    }
+
+    // Fairness accounting: everything older than the winner was overtaken
+    for (uint8_t i = 0; i < bus->count; i++) {
+        if ((int32_t)(bus->queue[i].seq - bus->queue[best].seq) < 0) {
+            bus->queue[i].client->metrics.overtaken++;
+        }
+    }
+    return best;
+}
+
+static HAL_StatusTypeDef I2CBus_Start(I2CBus_t *bus, I2CBus_Txn_t *txn)
+{
+    switch (txn->op) {
+    case I2CBUS_MEM_READ:
+        DmaCache_CleanInvalidate(txn->data, txn->size);
+        return HAL_I2C_Mem_Read_DMA(bus->hi2c, txn->devAddress, txn->memAddress, I2C_MEMADD_SIZE_8BIT, txn->data, txn->size);
+    case I2CBUS_MEM_WRITE:
+        DmaCache_Clean(txn->data, txn->size);
+        return HAL_I2C_Mem_Write_DMA(bus->hi2c, txn->devAddress, txn->memAddress, I2C_MEMADD_SIZE_8BIT, txn->data, txn->size);
+    case I2CBUS_TRANSMIT:
+        DmaCache_Clean(txn->data, txn->size);
+        return HAL_I2C_Master_Transmit_DMA(bus->hi2c, txn->devAddress, txn->data, txn->size);
+    case I2CBUS_RECEIVE:
+        DmaCache_CleanInvalidate(txn->data, txn->size);
+        return HAL_I2C_Master_Receive_DMA(bus->hi2c, txn->devAddress, txn->data, txn->size);
+    default:
+        return HAL_ERROR;
+    }
+}
+
+/**
+ * @brief Count a failure by class and put the bus back into a usable state
+ * @param bus Pointer to bus, still marked busy
+ * @param metrics Metrics of the client whose transaction failed
+ * @param status Failure status, read together with the HAL error code
+ */
+static void I2CBus_Recover(I2CBus_t *bus, I2CBus_Metrics_t *metrics, HAL_StatusTypeDef status)
+{
+    switch (I2CRecover_Classify(status, HAL_I2C_GetError(bus->hi2c))) {
+    case I2CRECOVER_FAULT_NACK:
+        metrics->nacks++;
+        break;
+    case I2CRECOVER_FAULT_ARB_LOST:
+        metrics->busErrors++;
+        break;
+    case I2CRECOVER_FAULT_BUS_ERROR:
+        metrics->busErrors++;
+        (void)I2CRecover_Reinit(bus->hi2c, &bus->recovery);
+        break;
+    case I2CRECOVER_FAULT_BUS_STUCK:
+        bus->recovery.busStuck++;
+        (void)I2CRecover_Unlock(bus->hi2c, bus->pins, &bus->recovery);
+        break;
+    case I2CRECOVER_FAULT_TIMEOUT:
+        metrics->timeouts++;
+        (void)I2CRecover_Unlock(bus->hi2c, bus->pins, &bus->recovery);
+        break;
+    default:
+        break;
+    }
+}
+
+static void I2CBus_Finish(I2CBus_t *bus, HAL_StatusTypeDef status)
+{
+    I2CBus_Txn_t txn = bus->active;
+    I2CBus_Metrics_t *metrics = &txn.client->metrics;
+    uint32_t latency = I2CBUS_NOW() - txn.submitted;
+
+    if (txn.op == I2CBUS_MEM_READ || txn.op == I2CBUS_RECEIVE) {
+        DmaCache_Invalidate(txn.data, txn.size); // Also after a failure: the DMA may have written part of it
+    }
+    if (status != HAL_OK) {
+        I2CBus_Recover(bus, metrics, status); // Before the bus is released to the next transfer
+    }
+    bus->aborting = 0;
+    bus->busy = 0;
+    metrics->completed++;
+    if (status != HAL_OK) {
+        metrics->errors++;
+    }
+    metrics->latencyTotal += latency;
+    if (latency > metrics->latencyMax) {
+        metrics->latencyMax = latency;
+    }
+    if (txn.done != NULL) {
+        txn.done(&txn, status);
+    }
+}
+
+/**
+ * @brief Start the best queued transaction if the bus is idle
+ * @param bus Pointer to bus
+ * @details Transactions the HAL refuses to start are completed with its
+ *          error status and the next one is tried.
+ */
+static void I2CBus_Dispatch(I2CBus_t *bus)
+{
+    for (;;) {
+        I2CBUS_LOCK();
+        if (bus->busy || bus->count == 0) {
+            I2CBUS_UNLOCK();
+            return;
+        }
+        uint32_t now = I2CBUS_NOW();
+        uint8_t idx = I2CBus_PickNext(bus, now);
+        bus->active = bus->queue[idx];
+        bus->queue[idx] = bus->queue[--bus->count];
+        bus->busy = 1;
+        bus->activeSince = now;
+        bus->dispatched++;
+
+        I2CBus_Metrics_t *metrics = &bus->active.client->metrics;
+        uint32_t wait = now - bus->active.submitted;
+        metrics->waitTotal += wait;
+        if (wait > metrics->waitMax) {
+            metrics->waitMax = wait;
+        }
+#ifdef I2CBUS_RTOS
+        // Start before unlocking: a task preempted between claiming the bus
+        // and starting the transfer would leave it idle meanwhile
+        HAL_StatusTypeDef status = I2CBus_Start(bus, &bus->active);
+        I2CBUS_UNLOCK();
+#else
+        I2CBUS_UNLOCK();
+        HAL_StatusTypeDef status = I2CBus_Start(bus, &bus->active);
+#endif
+        if (status == HAL_OK) {
+            return; // The completion callback dispatches the next one
+        }
+        I2CBus_Finish(bus, status);
+    }
+}
+
+static void I2CBus_WakeWaiter(const I2CBus_Txn_t *txn, HAL_StatusTypeDef status)
+{
+    I2CBus_Client_t *client = txn->client;
+    if ((uint32_t)(uintptr_t)txn->ctx == client->waitSeq) {
+        client->waitStatus = status;
+        client->waitDone = 1;
+#ifdef I2CBUS_RTOS
+        DriverOs_EventSignal(&client->done);
+#endif
+    }
+}
+
+/**
+ * @brief Clock of the blocking call timeouts
+ * @return uint32_t DriverOs_NowMs() with a running RTOS, I2CBUS_NOW() otherwise
+ */
+static uint32_t I2CBus_Clock(void)
+{
+#ifdef I2CBUS_RTOS
+    if (DriverOs_Running()) {
+        return DriverOs_NowMs();
+    }
+#endif
+    return I2CBUS_NOW();
+}
+
+/**
+ * @brief Wait for the transaction of a blocking call
+ * @param client Pointer to client
+ * @param start I2CBus_Clock() when the call started
+ * @return HAL_StatusTypeDef Transaction status, HAL_TIMEOUT after client->timeout
+ */
+static HAL_StatusTypeDef I2CBus_Wait(I2CBus_Client_t *client, uint32_t start)
+{
+#ifdef I2CBUS_RTOS
+    if (DriverOs_Running()) {
+        for (;;) {
+            // Read both with the completion interrupt held off
+            I2CBUS_LOCK();
+            uint8_t done = client->waitDone;
+            HAL_StatusTypeDef status = client->waitStatus;
+            I2CBUS_UNLOCK();
+            if (done) {
+                return status;
+            }
+            uint32_t elapsed = DriverOs_NowMs() - start;
+            if (elapsed >= client->timeout) {
+                return HAL_TIMEOUT;
+            }
+            // Wake up in time to abort a hung transfer
+            uint32_t sleep = client->timeout - elapsed;
+            if (sleep > client->bus->txnTimeout + 1) {
+                sleep = client->bus->txnTimeout + 1;
+            }
+            (void)DriverOs_EventWait(&client->done, sleep);
+            I2CBus_Poll(client->bus);
+        }
+    }
+#endif
+    while (!client->waitDone) {
+        if ((uint32_t)(I2CBUS_NOW() - start) > client->timeout) {
+            return HAL_TIMEOUT;
+        }
+        I2CBUS_WAIT();
+        I2CBus_Poll(client->bus);
+    }
+    return client->waitStatus;
+}
+
+/**
+ * @brief Sleep between two attempts of a blocking call
+ * @param client Pointer to client
+ * @param ticks I2CBus_Clock() ticks
+ */
+static void I2CBus_Backoff(I2CBus_Client_t *client, uint32_t ticks)
+{
+    uint32_t start = I2CBus_Clock();
+
+#ifdef I2CBUS_RTOS
+    if (DriverOs_Running()) {
+        // The previous attempt has completed, nothing signals the event meanwhile
+        DriverOs_EventPrepare(&client->done);
+        (void)DriverOs_EventWait(&client->done, ticks);
+        return;
+    }
+#endif
+    while ((uint32_t)(I2CBus_Clock() - start) < ticks) {
+        I2CBUS_WAIT();
+        I2CBus_Poll(client->bus);
+    }
+}
+
+/**
+ * @brief One attempt of a blocking call: queue the transaction and wait for it
+ * @param start I2CBus_Clock() when the call started
+ * @return HAL_StatusTypeDef Transaction status, HAL_BUSY if the queue is full,
+ *         HAL_TIMEOUT after client->timeout
+ */
+static HAL_StatusTypeDef I2CBus_Attempt(I2CBus_Client_t *client, I2CBus_Txn_t *txn, uint32_t start)
+{
+    HAL_StatusTypeDef status;
+
+#ifdef I2CBUS_RTOS
+    uint8_t rtos = DriverOs_Running();
+    if (rtos) {
+        uint32_t elapsed = DriverOs_NowMs() - start;
+        if (elapsed >= client->timeout || DriverOs_MutexTake(&client->bus->lock, client->timeout - elapsed) != HAL_OK) {
+            return HAL_TIMEOUT;
+        }
+        DriverOs_EventPrepare(&client->done);
+    }
+#endif
+    client->waitSeq++;
+    client->waitDone = 0;
+    txn->ctx = (void *)(uintptr_t)client->waitSeq;
+
+    status = I2CBus_Submit(client, txn);
+#ifdef I2CBUS_RTOS
+    if (rtos) {
+        DriverOs_MutexGive(&client->bus->lock);
+    }
+#endif
+    if (status != HAL_OK) {
+        return status;
+    }
+    return I2CBus_Wait(client, start);
+}
+
+/**
+ * @brief Queue a transaction and wait for it to complete, retrying failures
+ * @return HAL_StatusTypeDef Status of the last attempt, HAL_BUSY if the queue
+ *         stayed full, HAL_TIMEOUT after client->timeout
+ * @details Must not be called from interrupt context or a completion callback.
+ *          After HAL_TIMEOUT the transaction may still run later, so data must
+ *          not live on the caller's stack if timeouts are expected.
+ *          With I2CBUS_RTOS the bus mutex is only held while queueing, so the
+ *          transactions of several tasks still wait in the priority queue
+ *          together; the timeout covers the mutex and the transfer.
+ *          A retry is only made if its backoff ends before client->timeout.
+ */
+static HAL_StatusTypeDef I2CBus_Blocking(I2CBus_Client_t *client, I2CBus_Op_t op, uint16_t devAddress, uint8_t memAddress, uint8_t *data, uint16_t size)
+{
+    I2CBus_Txn_t txn = {0};
+    HAL_StatusTypeDef status;
+    uint32_t start = I2CBus_Clock();
+
+    if (client == NULL) {
+        return HAL_ERROR;
+    }
+    txn.done = I2CBus_WakeWaiter;
+    txn.data = data;
+    txn.size = size;
+    txn.devAddress = devAddress;
+    txn.memAddress = memAddress;
+    txn.op = (uint8_t)op;
+
+    for (uint8_t attempt = 0;; attempt++) {
+        status = I2CBus_Attempt(client, &txn, start);
+        if (status == HAL_OK || attempt >= client->retries) {
+            return status;
+        }
+        uint32_t backoff = client->backoff << (attempt < 16 ? attempt : 16);
+        if ((uint32_t)(I2CBus_Clock() - start) + backoff >= client->timeout) {
+            return status;
+        }
+        client->metrics.retries++;
+        I2CBus_Backoff(client, backoff);
+    }
+}
+
+/* ========================== Function Definitions ============================ */
+
+/**
+ * @brief Take ownership of an I2C peripheral
+ * @param bus Pointer to bus
+ * @param hi2c Initialized HAL I2C handle, no other code may start transfers on it
+ * @return HAL_StatusTypeDef HAL_OK on success, HAL_ERROR if I2CBUS_MAX_BUSES are already registered
+ */
+HAL_StatusTypeDef I2CBus_Init(I2CBus_t *bus, I2C_HandleTypeDef *hi2c)
+{
+    uint8_t slot = I2CBUS_MAX_BUSES;
+
+    if (bus == NULL || hi2c == NULL) {
+        return HAL_ERROR;
+    }
+    for (uint8_t i = 0; i < I2CBUS_MAX_BUSES; i++) {
+        if (busRegistry[i] == bus || (busRegistry[i] != NULL && busRegistry[i]->hi2c == hi2c)) {
+            slot = i;
+            break;
+        }
+        if (busRegistry[i] == NULL && slot == I2CBUS_MAX_BUSES) {
+            slot = i;
+        }
+    }
+    if (slot == I2CBUS_MAX_BUSES) {
+        return HAL_ERROR;
+    }
+    memset(bus, 0, sizeof(*bus));
+    bus->hi2c = hi2c;
+    bus->txnTimeout = I2CBUS_TXN_TIMEOUT_TICKS;
+#ifdef I2CBUS_RTOS
+    if (DriverOs_MutexInit(&bus->lock) != HAL_OK) {
+        return HAL_ERROR;
+    }
+#endif
+    busRegistry[slot] = bus;
+    return HAL_OK;
+}
+
+/**
+ * @brief Register a client of a bus
+ * @param client Pointer to client, typically one per driver handle
+ * @param bus Pointer to initialized bus
+ * @param name Label for metrics reports, may be NULL
+ * @param priority Default priority of the client's transactions
+ * @return HAL_StatusTypeDef HAL_OK on success, HAL_ERROR on invalid arguments
+ */
+HAL_StatusTypeDef I2CBus_ClientInit(I2CBus_Client_t *client, I2CBus_t *bus, const char *name, I2CBus_Priority_t priority)
+{
+    if (client == NULL || bus == NULL) {
+        return HAL_ERROR;
+    }
+    memset(client, 0, sizeof(*client));
+    client->bus = bus;
+    client->name = name;
+    client->priority = (uint8_t)priority;
+    client->timeout = I2CBUS_TIMEOUT_TICKS;
+    client->retries = I2CBUS_RETRIES;
+    client->backoff = I2CBUS_BACKOFF_TICKS;
+#ifdef I2CBUS_RTOS
+    return DriverOs_EventInit(&client->done);
+#else
+    return HAL_OK;
+#endif
+}
+
+/**
+ * @brief Queue a transaction without waiting
+ * @param client Pointer to client
+ * @param txn Transaction, copied into the queue. Its priority can only raise the client priority
+ * @return HAL_StatusTypeDef HAL_OK if queued, HAL_BUSY if the queue is full, HAL_ERROR on invalid arguments
+ * @details Safe to call from interrupt context. The done callback runs from the
+ *          completion interrupt (or from this call if the HAL refuses to start).
+ */
+HAL_StatusTypeDef I2CBus_Submit(I2CBus_Client_t *client, const I2CBus_Txn_t *txn)
+{
+    if (client == NULL || client->bus == NULL || txn == NULL) {
+        return HAL_ERROR;
+    }
+    I2CBus_t *bus = client->bus;
+
+    I2CBUS_LOCK();
+    if (bus->count >= I2CBUS_QUEUE_LEN) {
+        client->metrics.rejected++;
+        I2CBUS_UNLOCK();
+        return HAL_BUSY;
+    }
+    I2CBus_Txn_t *entry = &bus->queue[bus->count++];
+    *entry = *txn;
+    entry->client = client;
+    if (entry->priority < client->priority) {
+        entry->priority = client->priority;
+    }
+    entry->seq = bus->nextSeq++;
+    entry->submitted = I2CBUS_NOW();
+    if (bus->count > bus->maxDepth) {
+        bus->maxDepth = bus->count;
+    }
+    client->metrics.submitted++;
+    I2CBUS_UNLOCK();
+
+    I2CBus_Dispatch(bus);
+    return HAL_OK;
+}
+
+/**
+ * @brief Blocking register read through the bus
+ * @param client Pointer to client
+ * @param devAddress 8-bit device address
+ * @param memAddress First register
+ * @param data Destination buffer
+ * @param size Number of bytes
+ * @return HAL_StatusTypeDef HAL_OK on success, error code otherwise
+ */
+HAL_StatusTypeDef I2CBus_MemRead(I2CBus_Client_t *client, uint16_t devAddress, uint8_t memAddress, uint8_t *data, uint16_t size)
+{
+    return I2CBus_Blocking(client, I2CBUS_MEM_READ, devAddress, memAddress, data, size);
+}
+
+/**
+ * @brief Blocking register write through the bus
+ * @param client Pointer to client
+ * @param devAddress 8-bit device address
+ * @param memAddress First register
+ * @param data Source buffer
+ * @param size Number of bytes
+ * @return HAL_StatusTypeDef HAL_OK on success, error code otherwise
+ */
+HAL_StatusTypeDef I2CBus_MemWrite(I2CBus_Client_t *client, uint16_t devAddress, uint8_t memAddress, uint8_t *data, uint16_t size)
+{
+    return I2CBus_Blocking(client, I2CBUS_MEM_WRITE, devAddress, memAddress, data, size);
+}
+
+/**
+ * @brief Blocking raw write through the bus
+ * @param client Pointer to client
+ * @param devAddress 8-bit device address
+ * @param data Source buffer
+ * @param size Number of bytes
+ * @return HAL_StatusTypeDef HAL_OK on success, error code otherwise
+ */
+HAL_StatusTypeDef I2CBus_Transmit(I2CBus_Client_t *client, uint16_t devAddress, uint8_t *data, uint16_t size)
+{
+    return I2CBus_Blocking(client, I2CBUS_TRANSMIT, devAddress, 0, data, size);
+}
+
+/**
+ * @brief Blocking raw read through the bus
+ * @param client Pointer to client
+ * @param devAddress 8-bit device address
+ * @param data Destination buffer
+ * @param size Number of bytes
+ * @return HAL_StatusTypeDef HAL_OK on success, error code otherwise
+ */
+HAL_StatusTypeDef I2CBus_Receive(I2CBus_Client_t *client, uint16_t devAddress, uint8_t *data, uint16_t size)
+{
+    return I2CBus_Blocking(client, I2CBUS_RECEIVE, devAddress, 0, data, size);
+}
+
+/**
+ * @brief Completion hook, call from the HAL I2C completion and error callbacks
+ * @param hi2c HAL I2C handle passed to the callback
+ * @param status HAL_OK from the Cplt callbacks, HAL_ERROR from HAL_I2C_ErrorCallback
+ */
+void I2CBus_OnComplete(I2C_HandleTypeDef *hi2c, HAL_StatusTypeDef status)
+{
+    I2CBus_t *bus = I2CBus_Find(hi2c);
+    if (bus == NULL || !bus->busy || bus->aborting) {
+        return;
+    }
+    I2CBus_Finish(bus, status);
+    I2CBus_Dispatch(bus);
+}
+
+/**
+ * @brief Clear the metrics of a client
+ * @param client Pointer to client
+ */
+void I2CBus_ResetMetrics(I2CBus_Client_t *client)
+{
+    memset(&client->metrics, 0, sizeof(client->metrics));
+}
+
+/**
+ * @brief Set how long the client's blocking calls wait
+ * @param client Pointer to client
+ * @param timeout I2CBUS_NOW() ticks, milliseconds with I2CBUS_RTOS
+ */
+void I2CBus_SetTimeout(I2CBus_Client_t *client, uint32_t timeout)
+{
+    client->timeout = timeout;
+}
+
+/**
+ * @brief Set how often the client's blocking calls retry
+ * @param client Pointer to client
+ * @param retries Extra attempts after a failure, 0 to return the first failure
+ * @param backoff Wait before the first retry, doubled for each further one,
+ *        I2CBUS_NOW() ticks (milliseconds with I2CBUS_RTOS)
+ * @details Retries never extend a call beyond the client timeout.
+ */
+void I2CBus_SetRetry(I2CBus_Client_t *client, uint8_t retries, uint32_t backoff)
+{
+    client->retries = retries;
+    client->backoff = backoff;
+}
+
+/**
+ * @brief Configure how the bus recovers from hung transfers and a held SDA line
+ * @param bus Pointer to bus
+ * @param pins SCL and SDA pins for the 9-clock unlock, NULL to only reset the peripheral
+ * @param txnTimeout I2CBUS_NOW() ticks a transfer may hold the bus, longer than
+ *        the longest transfer at the bus speed
+ */
+void I2CBus_SetRecovery(I2CBus_t *bus, const I2CRecover_Pins_t *pins, uint32_t txnTimeout)
+{
+    bus->pins = pins;
+    bus->txnTimeout = txnTimeout;
+}
+
+/**
+ * @brief Abort the active transfer if it has held the bus too long
+ * @param bus Pointer to bus
+ * @details The blocking calls poll while they wait. Users of I2CBus_Submit()
+ *          alone call it from their main loop. The aborted transaction
+ *          completes with HAL_TIMEOUT after the bus was recovered.
+ */
+void I2CBus_Poll(I2CBus_t *bus)
+{
+    I2CBUS_LOCK();
+    uint8_t expired = bus->busy && !bus->aborting && (uint32_t)(I2CBUS_NOW() - bus->activeSince) > bus->txnTimeout;
+    if (expired) {
+        bus->aborting = 1; // A late completion interrupt is ignored from here on
+    }
+    I2CBUS_UNLOCK();
+    if (!expired) {
+        return;
+    }
+    I2CBus_Finish(bus, HAL_TIMEOUT);
+    I2CBus_Dispatch(bus);
+}
+
+#ifdef I2CBUS_RTOS
+/**
+ * @brief Keep the bus for the calling task
+ * @param client Pointer to client
+ * @return HAL_StatusTypeDef HAL_OK, HAL_TIMEOUT if another task kept it for client->timeout
+ * @details Blocking calls of other tasks wait until I2CBus_Release(); the
+ *          owner's own calls go through. Transactions submitted from
+ *          interrupts are still queued and may run in between. Calls nest.
+ */
+HAL_StatusTypeDef I2CBus_Acquire(I2CBus_Client_t *client)
+{
+    return DriverOs_MutexTake(&client->bus->lock, client->timeout);
+}
+
+/**
+ * @brief Hand back a bus taken with I2CBus_Acquire()
+ * @param client Pointer to client
+ */
+void I2CBus_Release(I2CBus_Client_t *client)
+{
+    DriverOs_MutexGive(&client->bus->lock);
+}
+#endif
+
+#ifdef I2CBUS_HAL_CALLBACKS
+void HAL_I2C_MemTxCpltCallback(I2C_HandleTypeDef *hi2c) { I2CBus_OnComplete(hi2c, HAL_OK); }
+void HAL_I2C_MemRxCpltCallback(I2C_HandleTypeDef *hi2c) { I2CBus_OnComplete(hi2c, HAL_OK); }
+void HAL_I2C_MasterTxCpltCallback(I2C_HandleTypeDef *hi2c) { I2CBus_OnComplete(hi2c, HAL_OK); }
+void HAL_I2C_MasterRxCpltCallback(I2C_HandleTypeDef *hi2c) { I2CBus_OnComplete(hi2c, HAL_OK); }
+void HAL_I2C_ErrorCallback(I2C_HandleTypeDef *hi2c) { I2CBus_OnComplete(hi2c, HAL_ERROR); }
+#endif
@@ -0,0 +1,146 @@
+#ifndef I2CBUS_H
+#define I2CBUS_H
+#include "main.h"
+#include "I2CRecover.h"
+#ifdef I2CBUS_RTOS
+#include "DriverOs.h"
+#endif
+
+/*------------------- Configuration ---------------------------*/
+#ifndef I2CBUS_QUEUE_LEN
+#define I2CBUS_QUEUE_LEN 8 // Pending transactions per bus, the active one not included
+#endif
+#ifndef I2CBUS_MAX_BUSES
+#define I2CBUS_MAX_BUSES 2 // I2C peripherals the completion callbacks can be routed to
+#endif
+#ifndef I2CBUS_NOW
+#define I2CBUS_NOW() HAL_GetTick() // Timestamp for metrics and aging
+#endif
+#ifndef I2CBUS_AGING_TICKS
+#define I2CBUS_AGING_TICKS 10 // Queue wait that raises a transaction by one priority level
+#endif
+#ifndef I2CBUS_TIMEOUT_TICKS
+#define I2CBUS_TIMEOUT_TICKS 100 // Default longest wait of the blocking calls, milliseconds with I2CBUS_RTOS
+#endif
+#ifndef I2CBUS_WAIT
+#define I2CBUS_WAIT() __WFI() // Sleep until the next interrupt while a blocking call waits
+#endif
+#ifndef I2CBUS_RETRIES
+#define I2CBUS_RETRIES 2 // Default extra attempts of a failed blocking call, within its timeout
+#endif
+#ifndef I2CBUS_BACKOFF_TICKS
+#define I2CBUS_BACKOFF_TICKS 1 // Default wait before the first retry, doubled for each further one
+#endif
+#ifndef I2CBUS_TXN_TIMEOUT_TICKS
+#define I2CBUS_TXN_TIMEOUT_TICKS 25 // Longest a transfer may hold the bus before it is aborted
+#endif
+// Define I2CBUS_RTOS to make the blocking calls sleep the calling task until
+// the completion interrupt wakes it, through the DriverOS layer
+
+
+/************************ Bus Manager Structs ********************************/
+typedef enum {
+    I2CBUS_PRIO_LOW = 0,      // Housekeeping, e.g. RTC alarm re-arming
+    I2CBUS_PRIO_NORMAL = 1,
+    I2CBUS_PRIO_HIGH = 2,
+    I2CBUS_PRIO_CRITICAL = 3  // Time-critical sampling, e.g. ADC conversion reads
+} I2CBus_Priority_t;
+
+typedef enum {
+    I2CBUS_MEM_READ = 0,
+    I2CBUS_MEM_WRITE = 1,
+    I2CBUS_TRANSMIT = 2,
+    I2CBUS_RECEIVE = 3
+} I2CBus_Op_t;
+
+typedef struct I2CBus_s I2CBus_t;
+typedef struct I2CBus_Client_s I2CBus_Client_t;
+typedef struct I2CBus_Txn_s I2CBus_Txn_t;
+
+typedef void (*I2CBus_DoneCallback_t)(const I2CBus_Txn_t *txn, HAL_StatusTypeDef status);
+
+struct I2CBus_Txn_s {
+    I2CBus_Client_t *client;      // Filled in by I2CBus_Submit()
+    I2CBus_DoneCallback_t done;   // Called from the completion interrupt, may be NULL
+    void *ctx;                    // User pointer for the callback
+    uint8_t *data;                // Must stay valid until the transaction completes
+    uint16_t size;
+    uint16_t devAddress;          // 8-bit HAL address
+    uint8_t memAddress;           // Register address for the MEM operations
+    uint8_t op;                   // I2CBus_Op_t
+    uint8_t priority;             // I2CBus_Priority_t, defaults to the client priority
+    uint32_t seq;                 // Submission order, filled in by I2CBus_Submit()
+    uint32_t submitted;           // I2CBUS_NOW() at submission
+};
+
+typedef struct {
+    uint32_t submitted;
+    uint32_t completed;
+    uint32_t errors;       // Completed with an error or NACK
+    uint32_t nacks;
+    uint32_t busErrors;    // Bus error or arbitration lost
+    uint32_t timeouts;     // Aborted by the transfer watchdog
+    uint32_t retries;      // Attempts repeated by the blocking calls
+    uint32_t rejected;     // Refused because the queue was full
+    uint32_t overtaken;    // Times a later transaction was dispatched ahead of a queued one
+    uint32_t waitMax;      // Longest submit-to-dispatch time, I2CBUS_NOW() ticks
+    uint32_t waitTotal;
+    uint32_t latencyMax;   // Longest submit-to-completion time, I2CBUS_NOW() ticks
+    uint32_t latencyTotal;
+} I2CBus_Metrics_t;
+
+struct I2CBus_Client_s {
+    I2CBus_t *bus;
+    const char *name;
+    uint8_t priority;      // I2CBus_Priority_t
+    volatile uint8_t waitDone;
+    volatile HAL_StatusTypeDef waitStatus;
+    uint32_t waitSeq;      // Sequence number the blocking call waits for
+    uint32_t timeout;      // Longest wait of a blocking call, see I2CBus_SetTimeout()
+    uint8_t retries;       // See I2CBus_SetRetry()
+    uint32_t backoff;
+#ifdef I2CBUS_RTOS
+    DriverOs_Event_t done; // Wakes the task in the blocking call
+#endif
+    I2CBus_Metrics_t metrics;
+};
+
+struct I2CBus_s {
+    I2C_HandleTypeDef *hi2c;
+    I2CBus_Txn_t queue[I2CBUS_QUEUE_LEN]; // Unordered, the dispatcher picks the best entry
+    uint8_t count;
+    uint8_t maxDepth;      // Deepest queue seen
+    volatile uint8_t busy; // A transaction is on the wire
+    volatile uint8_t aborting; // The watchdog is taking the active transaction back
+    I2CBus_Txn_t active;
+    volatile uint32_t activeSince; // I2CBUS_NOW() at dispatch
+    uint32_t txnTimeout;
+    const I2CRecover_Pins_t *pins; // For bus unlock, NULL to only reset the peripheral
+    I2CRecover_Stats_t recovery;
+    uint32_t nextSeq;
+    uint32_t dispatched;
+#ifdef I2CBUS_RTOS
+    DriverOs_Mutex_t lock; // Held by blocking calls while they queue, and by I2CBus_Acquire()
+#endif
+};
+
+/*------------------- Function Prototypes ---------------------------*/
+HAL_StatusTypeDef I2CBus_Init(I2CBus_t *bus, I2C_HandleTypeDef *hi2c);
+HAL_StatusTypeDef I2CBus_ClientInit(I2CBus_Client_t *client, I2CBus_t *bus, const char *name, I2CBus_Priority_t priority);
+HAL_StatusTypeDef I2CBus_Submit(I2CBus_Client_t *client, const I2CBus_Txn_t *txn);
+HAL_StatusTypeDef I2CBus_MemRead(I2CBus_Client_t *client, uint16_t devAddress, uint8_t memAddress, uint8_t *data, uint16_t size);
+HAL_StatusTypeDef I2CBus_MemWrite(I2CBus_Client_t *client, uint16_t devAddress, uint8_t memAddress, uint8_t *data, uint16_t size);
+HAL_StatusTypeDef I2CBus_Transmit(I2CBus_Client_t *client, uint16_t devAddress, uint8_t *data, uint16_t size);
+HAL_StatusTypeDef I2CBus_Receive(I2CBus_Client_t *client, uint16_t devAddress, uint8_t *data, uint16_t size);
+void I2CBus_OnComplete(I2C_HandleTypeDef *hi2c, HAL_StatusTypeDef status);
+void I2CBus_ResetMetrics(I2CBus_Client_t *client);
+void I2CBus_SetTimeout(I2CBus_Client_t *client, uint32_t timeout);
+void I2CBus_SetRetry(I2CBus_Client_t *client, uint8_t retries, uint32_t backoff);
+void I2CBus_SetRecovery(I2CBus_t *bus, const I2CRecover_Pins_t *pins, uint32_t txnTimeout);
+void I2CBus_Poll(I2CBus_t *bus);
+#ifdef I2CBUS_RTOS
+HAL_StatusTypeDef I2CBus_Acquire(I2CBus_Client_t *client);
+void I2CBus_Release(I2CBus_Client_t *client);
+#endif
+
+#endif
@@ -0,0 +1,149 @@
+#include "I2CRecover.h"
+
+/**
+ ******************************************************************************
+ * @file    I2CRecover.c
+ * @author  Yair Yamin
+ * @brief   I2C fault classification, peripheral re-init and bus unlock.
+ * @details A slave reset or a glitch in the middle of a read can leave the
+ * slave driving SDA low while it waits for the clocks of a byte the master
+ * will never send. The peripheral then sees a busy bus and refuses every
+ * transfer until the slave is clocked out:
+ *
+ * - I2CRecover_Unlock() takes SCL and SDA as open-drain GPIOs, sends up to
+ *   nine clocks until the slave lets SDA go, ends with a STOP condition and
+ *   initializes the peripheral again.
+ * - I2CRecover_Reinit() only de-initializes and initializes the peripheral,
+ *   which drops a transfer that never completed and clears a latched bus
+ *   error.
+ * - I2CRecover_Classify() maps a HAL status and error code to the failure
+ *   class the caller bases its retry decision on.
+ *
+ * HAL_I2C_MspInit() must configure the pins for I2C, since it is what hands
+ * them back to the peripheral after the unlock.
+ ******************************************************************************
+ */
+
+/* ========================== Static Helpers ============================ */
+
+static void I2CRecover_PinsAsGpio(const I2CRecover_Pins_t *pins)
+{
+    GPIO_InitTypeDef gpio = {0};
+
+    gpio.Mode = GPIO_MODE_OUTPUT_OD;
+    gpio.Pull = GPIO_NOPULL;
+    gpio.Speed = GPIO_SPEED_FREQ_HIGH;
+    HAL_GPIO_WritePin(pins->sdaPort, pins->sdaPin, GPIO_PIN_SET);
+    HAL_GPIO_WritePin(pins->sclPort, pins->sclPin, GPIO_PIN_SET);
+    gpio.Pin = pins->sclPin;
+    HAL_GPIO_Init(pins->sclPort, &gpio);
+    gpio.Pin = pins->sdaPin;
+    HAL_GPIO_Init(pins->sdaPort, &gpio);
+}
+
+ /* ========================== Function Definitions ============================ */
+
+/**
+ * @brief Failure class of a finished or refused transfer
+ * @param status Status the HAL call or the completion reported
+ * @param errorCode HAL_I2C_GetError() right after the failure
+ * @return I2CRecover_Fault_t I2CRECOVER_FAULT_NONE for HAL_OK
+ * @details The HAL refuses to start with HAL_BUSY and HAL_I2C_ERROR_TIMEOUT
+ *          after waiting I2C_TIMEOUT_BUSY_FLAG for the bus to go idle.
+ */
+I2CRecover_Fault_t I2CRecover_Classify(HAL_StatusTypeDef status, uint32_t errorCode)
+{
+    if (status == HAL_OK) {
+        return I2CRECOVER_FAULT_NONE;
+    }
+    if (status == HAL_TIMEOUT) {
+        return I2CRECOVER_FAULT_TIMEOUT;
+    }
+    if (status == HAL_BUSY) {
+        return (errorCode & HAL_I2C_ERROR_TIMEOUT) ? I2CRECOVER_FAULT_BUS_STUCK : I2CRECOVER_FAULT_OTHER;
+    }
+    if (errorCode & HAL_I2C_ERROR_BERR) {
+        return I2CRECOVER_FAULT_BUS_ERROR;
+    }
+    if (errorCode & HAL_I2C_ERROR_ARLO) {
+        return I2CRECOVER_FAULT_ARB_LOST;
+    }
+    if (errorCode & HAL_I2C_ERROR_AF) {
+        return I2CRECOVER_FAULT_NACK;
+    }
+    if (errorCode & HAL_I2C_ERROR_TIMEOUT) {
+        return I2CRECOVER_FAULT_TIMEOUT;
+    }
+    return I2CRECOVER_FAULT_OTHER;
+}
+
+/**
+ * @brief Reset the peripheral, dropping any transfer in progress
+ * @param hi2c HAL I2C handle, its Init settings are reused
+ * @param stats Counters, may be NULL
+ * @return HAL_StatusTypeDef Status of HAL_I2C_Init()
+ * @details No completion callback runs for the dropped transfer.
+ */
+HAL_StatusTypeDef I2CRecover_Reinit(I2C_HandleTypeDef *hi2c, I2CRecover_Stats_t *stats)
+{
+    if (stats != NULL) {
+        stats->reinits++;
+    }
+    (void)HAL_I2C_DeInit(hi2c);
+    return HAL_I2C_Init(hi2c);
+}
+
+/**
+ * @brief Clock a slave that holds SDA low off the bus and reset the peripheral
+ * @param hi2c HAL I2C handle
+ * @param pins SCL and SDA pins, NULL to only reset the peripheral
+ * @param stats Counters, may be NULL
+ * @return HAL_StatusTypeDef HAL_OK if SDA is high afterwards, HAL_ERROR if it
+ *         stayed low, or the status of HAL_I2C_Init()
+ * @details Blocks for at most ten SCL periods of I2CRECOVER_HALF_CLOCK_US.
+ */
+HAL_StatusTypeDef I2CRecover_Unlock(I2C_HandleTypeDef *hi2c, const I2CRecover_Pins_t *pins, I2CRecover_Stats_t *stats)
+{
+    GPIO_PinState sda;
+    HAL_StatusTypeDef status;
+
+    if (pins == NULL) {
+        return I2CRecover_Reinit(hi2c, stats);
+    }
+    (void)HAL_I2C_DeInit(hi2c);
+    I2CRecover_PinsAsGpio(pins);
+    I2CRECOVER_DELAY_US(I2CRECOVER_HALF_CLOCK_US);
+
+    // A slave mid-byte releases SDA within the remaining 8 data bits and the ACK
+    sda = HAL_GPIO_ReadPin(pins->sdaPort, pins->sdaPin);
+    for (uint8_t i = 0; i < 9 && sda == GPIO_PIN_RESET; i++) {
+        HAL_GPIO_WritePin(pins->sclPort, pins->sclPin, GPIO_PIN_RESET);
+        I2CRECOVER_DELAY_US(I2CRECOVER_HALF_CLOCK_US);
+        HAL_GPIO_WritePin(pins->sclPort, pins->sclPin, GPIO_PIN_SET);
+        I2CRECOVER_DELAY_US(I2CRECOVER_HALF_CLOCK_US);
+        sda = HAL_GPIO_ReadPin(pins->sdaPort, pins->sdaPin);
+    }
+
+    // STOP: SDA rises while SCL is high
+    HAL_GPIO_WritePin(pins->sclPort, pins->sclPin, GPIO_PIN_RESET);
+    HAL_GPIO_WritePin(pins->sdaPort, pins->sdaPin, GPIO_PIN_RESET);
+    I2CRECOVER_DELAY_US(I2CRECOVER_HALF_CLOCK_US);
+    HAL_GPIO_WritePin(pins->sclPort, pins->sclPin, GPIO_PIN_SET);
+    I2CRECOVER_DELAY_US(I2CRECOVER_HALF_CLOCK_US);
+    HAL_GPIO_WritePin(pins->sdaPort, pins->sdaPin, GPIO_PIN_SET);
+    I2CRECOVER_DELAY_US(I2CRECOVER_HALF_CLOCK_US);
+    sda = HAL_GPIO_ReadPin(pins->sdaPort, pins->sdaPin);
+
+    if (stats != NULL) {
+        stats->unlocks++;
+        stats->reinits++;
+        if (sda == GPIO_PIN_RESET) {
+            stats->unlockFailed++;
+        }
+    }
+    status = HAL_I2C_Init(hi2c);
+    if (status != HAL_OK) {
+        return status;
+    }
+    return (sda == GPIO_PIN_SET) ? HAL_OK : HAL_ERROR;
+}
@@ -0,0 +1,50 @@
+#ifndef I2CRECOVER_H
+#define I2CRECOVER_H
+#include "main.h"
+
+/*------------------- Configuration ---------------------------*/
+#ifndef I2CRECOVER_HALF_CLOCK_US
+#define I2CRECOVER_HALF_CLOCK_US 5 // SCL half period of the unlock clocks, 100 kHz
+#endif
+
+// Microsecond busy wait between the unlock edges
+#ifndef I2CRECOVER_DELAY_US
+#ifdef HOSTSIM_H
+#define I2CRECOVER_DELAY_US(us) HostSim_AdvanceUs(us)
+#else
+#define I2CRECOVER_DELAY_US(us) do { for (volatile uint32_t n = (us) * (SystemCoreClock / 4000000u); n > 0; n--) {} } while (0)
+#endif
+#endif
+
+/************************ Recovery Structs ********************************/
+typedef enum {
+    I2CRECOVER_FAULT_NONE = 0,
+    I2CRECOVER_FAULT_NACK,      // Address or data not acknowledged, device absent or busy
+    I2CRECOVER_FAULT_ARB_LOST,  // Arbitration lost, a glitch on a single-master bus
+    I2CRECOVER_FAULT_BUS_ERROR, // Misplaced START or STOP
+    I2CRECOVER_FAULT_BUS_STUCK, // Peripheral sees the bus busy: a slave holds SDA low
+    I2CRECOVER_FAULT_TIMEOUT,   // Transfer never completed
+    I2CRECOVER_FAULT_OTHER
+} I2CRecover_Fault_t;
+
+// SCL and SDA as GPIOs, for clocking a slave off the bus
+typedef struct {
+    GPIO_TypeDef *sclPort;
+    uint16_t sclPin;
+    GPIO_TypeDef *sdaPort;
+    uint16_t sdaPin;
+} I2CRecover_Pins_t;
+
+typedef struct {
+    uint32_t busStuck;     // Transfers refused because SDA was held low
+    uint32_t unlocks;      // SCL clock sequences sent
+    uint32_t unlockFailed; // Sequences after which SDA stayed low
+    uint32_t reinits;      // Peripheral de-initialized and initialized again
+} I2CRecover_Stats_t;
+
+/*------------------- Function Prototypes ---------------------------*/
+I2CRecover_Fault_t I2CRecover_Classify(HAL_StatusTypeDef status, uint32_t errorCode);
+HAL_StatusTypeDef I2CRecover_Reinit(I2C_HandleTypeDef *hi2c, I2CRecover_Stats_t *stats);
+HAL_StatusTypeDef I2CRecover_Unlock(I2C_HandleTypeDef *hi2c, const I2CRecover_Pins_t *pins, I2CRecover_Stats_t *stats);
+
+#endif
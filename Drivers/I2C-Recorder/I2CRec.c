@@ -0,0 +1,426 @@
+#include "I2CRec.h"
+#include <string.h>
+
+/**
+ ******************************************************************************
+ * @file    I2CRec.c
+ * @author  Yair Yamin
+ * @brief   Recorder for HAL I2C traffic.
+ * @details The recorder sits between the drivers and the HAL without touching
+ * either: link with the GNU ld option --wrap for each HAL I2C function (see
+ * Readme.md) and every call is routed through the __wrap_ functions below,
+ * which call the real HAL and append the transaction to a RAM buffer.
+ *
+ * - Blocking calls are recorded when they return.
+ * - _DMA calls are recorded when I2CRec_OnComplete() reports their completion.
+ *   Without it they are closed at the next call on the same bus with the end
+ *   time marked as approximate.
+ * - Calls rejected with HAL_BUSY put nothing on the bus and are not recorded.
+ * - When the buffer is full recording stops, so a recording is always a
+ *   complete prefix of the session.
+ *
+ * Link this file only into recording builds, it needs the --wrap options.
+ * I2CRecReader.c decodes recordings on any platform.
+ ******************************************************************************
+ */
+
+/* ========================== Defines ============================ */
+#define I2CREC_LOCK()   uint32_t primask = __get_PRIMASK(); __disable_irq()
+#define I2CREC_UNLOCK() __set_PRIMASK(primask)
+
+#define I2CREC_MAX_RECORD_OVERHEAD 18 // flags, device, 3 varints, register, status
+
+/* ========================== Global Variables ============================ */
+static I2CRec_t *activeRec;
+
+/* ========================== Static Helpers ============================ */
+
+static void I2CRec_PutU32(uint8_t *p, uint32_t value)
+{
+    p[0] = (uint8_t)value;
+    p[1] = (uint8_t)(value >> 8);
+    p[2] = (uint8_t)(value >> 16);
+    p[3] = (uint8_t)(value >> 24);
+}
+
+static uint8_t I2CRec_PutVarint(uint8_t *p, uint32_t value)
+{
+    uint8_t n = 0;
+    while (value >= 0x80) {
+        p[n++] = (uint8_t)(value | 0x80);
+        value >>= 7;
+    }
+    p[n++] = (uint8_t)value;
+    return n;
+}
+
+/**
+ * @brief Bus number of a handle, registering it on first use
+ * @return int Bus number, -1 if I2CREC_MAX_BUSES buses are already recorded
+ */
+static int I2CRec_Bus(I2CRec_t *rec, I2C_HandleTypeDef *hi2c)
+{
+    for (int bus = 0; bus < I2CREC_MAX_BUSES; bus++) {
+        if (rec->pending[bus].hi2c == hi2c) {
+            return bus;
+        }
+        if (rec->pending[bus].hi2c == NULL) {
+            rec->pending[bus].hi2c = hi2c;
+            return bus;
+        }
+    }
+    return -1;
+}
+
+/**
+ * @brief Append one record, called with interrupts masked
+ */
+static void I2CRec_Append(I2CRec_t *rec, uint8_t flags, uint8_t device, uint32_t start, uint32_t end,
+                          uint16_t reg, const uint8_t *data, uint16_t len, HAL_StatusTypeDef status)
+{
+    uint8_t op = flags & I2CREC_FLAG_OP_MASK;
+    uint8_t isRead = (op == I2CREC_OP_MEM_READ || op == I2CREC_OP_RECEIVE);
+    uint16_t payload = (isRead && status != HAL_OK) ? 0 : len;
+    int32_t delta = (int32_t)(start - rec->lastStart);
+
+    if (!rec->active) {
+        return;
+    }
+    if (rec->len + I2CREC_MAX_RECORD_OVERHEAD + payload > rec->size) {
+        rec->dropped++;
+        rec->active = 0;
+        return;
+    }
+    if (status != HAL_OK) {
+        flags |= I2CREC_FLAG_STATUS;
+    }
+
+    uint8_t *p = &rec->buf[rec->len];
+    *p++ = flags;
+    *p++ = device;
+    p += I2CRec_PutVarint(p, ((uint32_t)delta << 1) ^ (uint32_t)(delta >> 31)); // Zigzag
+    p += I2CRec_PutVarint(p, end - start);
+    if (op == I2CREC_OP_MEM_READ || op == I2CREC_OP_MEM_WRITE) {
+        if (flags & I2CREC_FLAG_REG16) {
+            *p++ = (uint8_t)(reg >> 8);
+        }
+        *p++ = (uint8_t)reg;
+    }
+    p += I2CRec_PutVarint(p, len);
+    if (status != HAL_OK) {
+        *p++ = (uint8_t)status;
+    }
+    if (payload != 0) {
+        memcpy(p, data, payload);
+        p += payload;
+    }
+    rec->len = (uint32_t)(p - rec->buf);
+    rec->lastStart = start;
+    rec->records++;
+}
+
+/**
+ * @brief Close a DMA transfer that was never reported complete
+ * @details Called before a new transfer on the same bus; if the bus is idle the
+ *          previous transfer has ended, the exact time is unknown.
+ */
+static void I2CRec_Settle(I2CRec_t *rec, I2C_HandleTypeDef *hi2c)
+{
+    for (int bus = 0; bus < I2CREC_MAX_BUSES; bus++) {
+        I2CRec_Pending_t *pending = &rec->pending[bus];
+        if (pending->hi2c == hi2c && pending->inUse && HAL_I2C_GetState(hi2c) == HAL_I2C_STATE_READY) {
+            I2CREC_LOCK();
+            pending->inUse = 0;
+            I2CRec_Append(rec, pending->flags | I2CREC_FLAG_LATE, pending->device, pending->start, I2CREC_NOW(),
+                          pending->reg, pending->data, pending->len, HAL_OK);
+            I2CREC_UNLOCK();
+        }
+    }
+}
+
+static uint8_t I2CRec_Flags(I2CRec_t *rec, I2C_HandleTypeDef *hi2c, uint8_t op, uint16_t memAddSize, int *bus)
+{
+    *bus = I2CRec_Bus(rec, hi2c);
+    if (*bus < 0) {
+        rec->dropped++;
+        return 0;
+    }
+    return op | (uint8_t)(*bus << I2CREC_FLAG_BUS_POS) | ((memAddSize == I2C_MEMADD_SIZE_16BIT) ? I2CREC_FLAG_REG16 : 0);
+}
+
+/**
+ * @brief Record a blocking HAL call that just returned
+ */
+static void I2CRec_Log(I2C_HandleTypeDef *hi2c, uint8_t op, uint16_t devAddress, uint16_t memAddress, uint16_t memAddSize,
+                       uint8_t *data, uint16_t len, uint32_t start, HAL_StatusTypeDef status)
+{
+    I2CRec_t *rec = activeRec;
+    int bus;
+    if (rec == NULL || !rec->active || status == HAL_BUSY) {
+        return;
+    }
+
+    I2CREC_LOCK();
+    uint8_t flags = I2CRec_Flags(rec, hi2c, op, memAddSize, &bus);
+    if (bus >= 0) {
+        I2CRec_Append(rec, flags, (uint8_t)devAddress, start, I2CREC_NOW(), memAddress, data, len, status);
+    }
+    I2CREC_UNLOCK();
+}
+
+/**
+ * @brief Mark a _DMA transfer as in progress before it is started
+ * @return uint8_t 1 if the transfer is tracked, 0 if the bus already has one in
+ *         progress (the HAL will reject this one) or nothing is recorded
+ * @details Done before the HAL call because the completion interrupt can fire
+ *          before the call returns.
+ */
+static uint8_t I2CRec_Open(I2C_HandleTypeDef *hi2c, uint8_t op, uint16_t devAddress, uint16_t memAddress, uint16_t memAddSize,
+                           uint8_t *data, uint16_t len, uint32_t start)
+{
+    I2CRec_t *rec = activeRec;
+    uint8_t opened = 0;
+    int bus;
+    if (rec == NULL || !rec->active) {
+        return 0;
+    }
+    I2CRec_Settle(rec, hi2c);
+
+    I2CREC_LOCK();
+    uint8_t flags = I2CRec_Flags(rec, hi2c, op, memAddSize, &bus);
+    if (bus >= 0 && !rec->pending[bus].inUse) {
+        I2CRec_Pending_t *pending = &rec->pending[bus];
+        pending->data = data;
+        pending->start = start;
+        pending->reg = memAddress;
+        pending->len = len;
+        pending->flags = flags;
+        pending->device = (uint8_t)devAddress;
+        pending->inUse = 1;
+        opened = 1;
+    }
+    I2CREC_UNLOCK();
+    return opened;
+}
+
+/**
+ * @brief Handle the return value of a _DMA call tracked by I2CRec_Open()
+ * @details A started transfer is recorded on completion. A rejected one is
+ *          either dropped (HAL_BUSY, nothing on the bus) or recorded now.
+ */
+static void I2CRec_Close(I2C_HandleTypeDef *hi2c, HAL_StatusTypeDef status, uint8_t opened)
+{
+    I2CRec_t *rec = activeRec;
+    if (!opened || rec == NULL || status == HAL_OK) {
+        return;
+    }
+
+    I2CREC_LOCK();
+    for (int bus = 0; bus < I2CREC_MAX_BUSES; bus++) {
+        I2CRec_Pending_t *pending = &rec->pending[bus];
+        if (pending->hi2c == hi2c && pending->inUse) {
+            pending->inUse = 0;
+            if (status != HAL_BUSY) {
+                I2CRec_Append(rec, pending->flags, pending->device, pending->start, I2CREC_NOW(),
+                              pending->reg, pending->data, pending->len, status);
+            }
+        }
+    }
+    I2CREC_UNLOCK();
+}
+
+/* ========================== HAL Wrappers ============================ */
+
+HAL_StatusTypeDef __real_HAL_I2C_Mem_Write(I2C_HandleTypeDef *hi2c, uint16_t DevAddress, uint16_t MemAddress, uint16_t MemAddSize, uint8_t *pData, uint16_t Size, uint32_t Timeout);
+HAL_StatusTypeDef __real_HAL_I2C_Mem_Read(I2C_HandleTypeDef *hi2c, uint16_t DevAddress, uint16_t MemAddress, uint16_t MemAddSize, uint8_t *pData, uint16_t Size, uint32_t Timeout);
+HAL_StatusTypeDef __real_HAL_I2C_Mem_Write_DMA(I2C_HandleTypeDef *hi2c, uint16_t DevAddress, uint16_t MemAddress, uint16_t MemAddSize, uint8_t *pData, uint16_t Size);
+HAL_StatusTypeDef __real_HAL_I2C_Mem_Read_DMA(I2C_HandleTypeDef *hi2c, uint16_t DevAddress, uint16_t MemAddress, uint16_t MemAddSize, uint8_t *pData, uint16_t Size);
+HAL_StatusTypeDef __real_HAL_I2C_Master_Transmit(I2C_HandleTypeDef *hi2c, uint16_t DevAddress, uint8_t *pData, uint16_t Size, uint32_t Timeout);
+HAL_StatusTypeDef __real_HAL_I2C_Master_Receive(I2C_HandleTypeDef *hi2c, uint16_t DevAddress, uint8_t *pData, uint16_t Size, uint32_t Timeout);
+HAL_StatusTypeDef __real_HAL_I2C_Master_Transmit_DMA(I2C_HandleTypeDef *hi2c, uint16_t DevAddress, uint8_t *pData, uint16_t Size);
+HAL_StatusTypeDef __real_HAL_I2C_Master_Receive_DMA(I2C_HandleTypeDef *hi2c, uint16_t DevAddress, uint8_t *pData, uint16_t Size);
+
+HAL_StatusTypeDef __wrap_HAL_I2C_Mem_Write(I2C_HandleTypeDef *hi2c, uint16_t DevAddress, uint16_t MemAddress, uint16_t MemAddSize, uint8_t *pData, uint16_t Size, uint32_t Timeout);
+HAL_StatusTypeDef __wrap_HAL_I2C_Mem_Read(I2C_HandleTypeDef *hi2c, uint16_t DevAddress, uint16_t MemAddress, uint16_t MemAddSize, uint8_t *pData, uint16_t Size, uint32_t Timeout);
+HAL_StatusTypeDef __wrap_HAL_I2C_Mem_Write_DMA(I2C_HandleTypeDef *hi2c, uint16_t DevAddress, uint16_t MemAddress, uint16_t MemAddSize, uint8_t *pData, uint16_t Size);
+HAL_StatusTypeDef __wrap_HAL_I2C_Mem_Read_DMA(I2C_HandleTypeDef *hi2c, uint16_t DevAddress, uint16_t MemAddress, uint16_t MemAddSize, uint8_t *pData, uint16_t Size);
+HAL_StatusTypeDef __wrap_HAL_I2C_Master_Transmit(I2C_HandleTypeDef *hi2c, uint16_t DevAddress, uint8_t *pData, uint16_t Size, uint32_t Timeout);
+HAL_StatusTypeDef __wrap_HAL_I2C_Master_Receive(I2C_HandleTypeDef *hi2c, uint16_t DevAddress, uint8_t *pData, uint16_t Size, uint32_t Timeout);
+HAL_StatusTypeDef __wrap_HAL_I2C_Master_Transmit_DMA(I2C_HandleTypeDef *hi2c, uint16_t DevAddress, uint8_t *pData, uint16_t Size);
+HAL_StatusTypeDef __wrap_HAL_I2C_Master_Receive_DMA(I2C_HandleTypeDef *hi2c, uint16_t DevAddress, uint8_t *pData, uint16_t Size);
+
+HAL_StatusTypeDef __wrap_HAL_I2C_Mem_Write(I2C_HandleTypeDef *hi2c, uint16_t DevAddress, uint16_t MemAddress, uint16_t MemAddSize, uint8_t *pData, uint16_t Size, uint32_t Timeout)
+{
+    uint32_t start = I2CREC_NOW();
+    if (activeRec != NULL) {
+        I2CRec_Settle(activeRec, hi2c);
+    }
+    HAL_StatusTypeDef status = __real_HAL_I2C_Mem_Write(hi2c, DevAddress, MemAddress, MemAddSize, pData, Size, Timeout);
+    I2CRec_Log(hi2c, I2CREC_OP_MEM_WRITE, DevAddress, MemAddress, MemAddSize, pData, Size, start, status);
+    return status;
+}
+
+HAL_StatusTypeDef __wrap_HAL_I2C_Mem_Read(I2C_HandleTypeDef *hi2c, uint16_t DevAddress, uint16_t MemAddress, uint16_t MemAddSize, uint8_t *pData, uint16_t Size, uint32_t Timeout)
+{
+    uint32_t start = I2CREC_NOW();
+    if (activeRec != NULL) {
+        I2CRec_Settle(activeRec, hi2c);
+    }
+    HAL_StatusTypeDef status = __real_HAL_I2C_Mem_Read(hi2c, DevAddress, MemAddress, MemAddSize, pData, Size, Timeout);
+    I2CRec_Log(hi2c, I2CREC_OP_MEM_READ, DevAddress, MemAddress, MemAddSize, pData, Size, start, status);
+    return status;
+}
+
+HAL_StatusTypeDef __wrap_HAL_I2C_Mem_Write_DMA(I2C_HandleTypeDef *hi2c, uint16_t DevAddress, uint16_t MemAddress, uint16_t MemAddSize, uint8_t *pData, uint16_t Size)
+{
+    uint32_t start = I2CREC_NOW();
+    uint8_t opened = I2CRec_Open(hi2c, I2CREC_OP_MEM_WRITE, DevAddress, MemAddress, MemAddSize, pData, Size, start);
+    HAL_StatusTypeDef status = __real_HAL_I2C_Mem_Write_DMA(hi2c, DevAddress, MemAddress, MemAddSize, pData, Size);
+    I2CRec_Close(hi2c, status, opened);
+    return status;
+}
+
+HAL_StatusTypeDef __wrap_HAL_I2C_Mem_Read_DMA(I2C_HandleTypeDef *hi2c, uint16_t DevAddress, uint16_t MemAddress, uint16_t MemAddSize, uint8_t *pData, uint16_t Size)
+{
+    uint32_t start = I2CREC_NOW();
+    uint8_t opened = I2CRec_Open(hi2c, I2CREC_OP_MEM_READ, DevAddress, MemAddress, MemAddSize, pData, Size, start);
+    HAL_StatusTypeDef status = __real_HAL_I2C_Mem_Read_DMA(hi2c, DevAddress, MemAddress, MemAddSize, pData, Size);
+    I2CRec_Close(hi2c, status, opened);
+    return status;
+}
+
+HAL_StatusTypeDef __wrap_HAL_I2C_Master_Transmit(I2C_HandleTypeDef *hi2c, uint16_t DevAddress, uint8_t *pData, uint16_t Size, uint32_t Timeout)
+{
+    uint32_t start = I2CREC_NOW();
+    if (activeRec != NULL) {
+        I2CRec_Settle(activeRec, hi2c);
+    }
+    HAL_StatusTypeDef status = __real_HAL_I2C_Master_Transmit(hi2c, DevAddress, pData, Size, Timeout);
+    I2CRec_Log(hi2c, I2CREC_OP_TRANSMIT, DevAddress, 0, 0, pData, Size, start, status);
+    return status;
+}
+
+HAL_StatusTypeDef __wrap_HAL_I2C_Master_Receive(I2C_HandleTypeDef *hi2c, uint16_t DevAddress, uint8_t *pData, uint16_t Size, uint32_t Timeout)
+{
+    uint32_t start = I2CREC_NOW();
+    if (activeRec != NULL) {
+        I2CRec_Settle(activeRec, hi2c);
+    }
+    HAL_StatusTypeDef status = __real_HAL_I2C_Master_Receive(hi2c, DevAddress, pData, Size, Timeout);
+    I2CRec_Log(hi2c, I2CREC_OP_RECEIVE, DevAddress, 0, 0, pData, Size, start, status);
+    return status;
+}
+
+HAL_StatusTypeDef __wrap_HAL_I2C_Master_Transmit_DMA(I2C_HandleTypeDef *hi2c, uint16_t DevAddress, uint8_t *pData, uint16_t Size)
+{
+    uint32_t start = I2CREC_NOW();
+    uint8_t opened = I2CRec_Open(hi2c, I2CREC_OP_TRANSMIT, DevAddress, 0, 0, pData, Size, start);
+    HAL_StatusTypeDef status = __real_HAL_I2C_Master_Transmit_DMA(hi2c, DevAddress, pData, Size);
+    I2CRec_Close(hi2c, status, opened);
+    return status;
+}
+
+HAL_StatusTypeDef __wrap_HAL_I2C_Master_Receive_DMA(I2C_HandleTypeDef *hi2c, uint16_t DevAddress, uint8_t *pData, uint16_t Size)
+{
+    uint32_t start = I2CREC_NOW();
+    uint8_t opened = I2CRec_Open(hi2c, I2CREC_OP_RECEIVE, DevAddress, 0, 0, pData, Size, start);
+    HAL_StatusTypeDef status = __real_HAL_I2C_Master_Receive_DMA(hi2c, DevAddress, pData, Size);
+    I2CRec_Close(hi2c, status, opened);
+    return status;
+}
+
+ /* ========================== Function Definitions ============================ */
+
+/**
+ * @brief Prepare a recording buffer
+ * @param rec Recorder state
+ * @param buf Buffer the recording is written to, keep it until it was read out
+ * @param size Buffer size in bytes
+ * @return HAL_StatusTypeDef HAL_OK, HAL_ERROR if the buffer cannot hold the header
+ */
+HAL_StatusTypeDef I2CRec_Init(I2CRec_t *rec, uint8_t *buf, uint32_t size)
+{
+    if (rec == NULL || buf == NULL || size < I2CREC_HEADER_LEN) {
+        return HAL_ERROR;
+    }
+    memset(rec, 0, sizeof(*rec));
+    rec->buf = buf;
+    rec->size = size;
+
+    memcpy(buf, I2CREC_MAGIC, 4);
+    buf[4] = I2CREC_VERSION;
+    buf[5] = I2CREC_HEADER_LEN;
+    buf[6] = 0;
+    buf[7] = 0;
+    I2CRec_PutU32(&buf[8], I2CREC_TICK_HZ);
+    I2CRec_PutU32(&buf[12], 0);
+    rec->len = I2CREC_HEADER_LEN;
+    return HAL_OK;
+}
+
+/**
+ * @brief Start recording every wrapped HAL I2C call
+ * @param rec Recorder prepared with I2CRec_Init()
+ * @details Only one recorder is active at a time. Timestamps of the records are
+ *          relative to this call.
+ */
+void I2CRec_Start(I2CRec_t *rec)
+{
+#if !defined(HOSTSIM_H) && defined(DWT_CTRL_CYCCNTENA_Msk)
+    CoreDebug->DEMCR |= CoreDebug_DEMCR_TRCENA_Msk;
+    DWT->CTRL |= DWT_CTRL_CYCCNTENA_Msk;
+#endif
+    rec->lastStart = I2CREC_NOW();
+    rec->active = 1;
+    activeRec = rec;
+}
+
+/**
+ * @brief Stop recording and finish the header
+ * @param rec Recorder state
+ * @return uint32_t Length of the recording in rec->buf
+ * @details Transfers still marked in progress are closed with an approximate end time.
+ */
+uint32_t I2CRec_Stop(I2CRec_t *rec)
+{
+    for (int bus = 0; bus < I2CREC_MAX_BUSES; bus++) {
+        if (rec->pending[bus].inUse) {
+            I2CRec_Settle(rec, rec->pending[bus].hi2c);
+        }
+    }
+    I2CREC_LOCK();
+    rec->active = 0;
+    if (activeRec == rec) {
+        activeRec = NULL;
+    }
+    I2CREC_UNLOCK();
+    I2CRec_PutU32(&rec->buf[12], rec->records);
+    return rec->len;
+}
+
+/**
+ * @brief Report the end of a _DMA transfer
+ * @param hi2c Bus the transfer ran on
+ * @param status HAL_OK from the completion callbacks, HAL_ERROR from the error callback
+ * @details Call from the HAL I2C completion and error callbacks for exact end times
+ *          and error statuses.
+ */
+void I2CRec_OnComplete(I2C_HandleTypeDef *hi2c, HAL_StatusTypeDef status)
+{
+    I2CRec_t *rec = activeRec;
+    if (rec == NULL) {
+        return;
+    }
+    uint32_t end = I2CREC_NOW();
+
+    I2CREC_LOCK();
+    for (int bus = 0; bus < I2CREC_MAX_BUSES; bus++) {
+        I2CRec_Pending_t *pending = &rec->pending[bus];
+        if (pending->hi2c == hi2c && pending->inUse) {
+            pending->inUse = 0;
+            I2CRec_Append(rec, pending->flags, pending->device, pending->start, end,
+                          pending->reg, pending->data, pending->len, status);
+        }
+    }
+    I2CREC_UNLOCK();
+}
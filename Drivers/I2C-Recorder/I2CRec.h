@@ -0,0 +1,111 @@
+#ifndef I2C_REC_H
+#define I2C_REC_H
+#include "main.h"
+
+/*------------------- Configuration ---------------------------*/
+#ifndef I2CREC_MAX_BUSES
+#define I2CREC_MAX_BUSES 4 // The record format has two bits for the bus
+#endif
+
+// Timestamp source and its frequency: simulated microseconds on the host, the
+// DWT cycle counter on the target (enabled by I2CRec_Start()).
+#ifndef I2CREC_NOW
+#ifdef HOSTSIM_H
+#define I2CREC_NOW() ((uint32_t)(HostSim_NowNs() / 1000u))
+#define I2CREC_TICK_HZ 1000000u
+#else
+#define I2CREC_NOW() (DWT->CYCCNT)
+#define I2CREC_TICK_HZ SystemCoreClock
+#endif
+#endif
+
+/************************ Format Defines ********************************/
+// File header, little-endian:
+//   0  "I2CR"
+//   4  u8  version
+//   5  u8  header length
+//   6  u16 reserved
+//   8  u32 timestamp ticks per second
+//   12 u32 record count, written by I2CRec_Stop()
+// Record:
+//   u8 flags: bits 0-1 op, bit 2 16-bit register, bit 3 status byte follows,
+//             bits 4-5 bus, bit 6 end time approximate
+//   u8 device address (8-bit HAL address)
+//   varint zigzag start, ticks after the previous record started (the first: after I2CRec_Start())
+//   varint duration in ticks
+//   register, 1 or 2 bytes MSB first (memory operations only)
+//   varint length
+//   u8 status (only with bit 3)
+//   payload: data written, or data read when status is HAL_OK
+#define I2CREC_MAGIC "I2CR"
+#define I2CREC_VERSION 1
+#define I2CREC_HEADER_LEN 16
+
+#define I2CREC_OP_MEM_READ  0
+#define I2CREC_OP_MEM_WRITE 1
+#define I2CREC_OP_TRANSMIT  2
+#define I2CREC_OP_RECEIVE   3
+
+#define I2CREC_FLAG_OP_MASK  0x03
+#define I2CREC_FLAG_REG16    0x04
+#define I2CREC_FLAG_STATUS   0x08
+#define I2CREC_FLAG_BUS_POS  4
+#define I2CREC_FLAG_BUS_MASK 0x30
+#define I2CREC_FLAG_LATE     0x40
+
+/************************ Recorder Structs ********************************/
+typedef struct {
+    I2C_HandleTypeDef *hi2c;
+    uint8_t *data;      // Caller buffer of the DMA transfer in progress
+    uint32_t start;
+    uint16_t reg;
+    uint16_t len;
+    uint8_t flags;
+    uint8_t device;
+    uint8_t inUse;
+} I2CRec_Pending_t;
+
+typedef struct {
+    uint8_t *buf;
+    uint32_t size;
+    uint32_t len;       // Bytes used, header included
+    uint32_t records;
+    uint32_t dropped;   // Transactions that did not fit, recording stops at the first
+    uint32_t lastStart;
+    I2CRec_Pending_t pending[I2CREC_MAX_BUSES]; // One per bus, indexed by bus number
+    uint8_t active;
+} I2CRec_t;
+
+typedef struct {
+    uint8_t op;         // I2CREC_OP_...
+    uint8_t bus;
+    uint8_t device;
+    uint8_t status;     // HAL_StatusTypeDef
+    uint8_t late;       // End time taken at the next call instead of the completion
+    uint8_t regSize;    // 0 for transmit/receive
+    uint16_t reg;
+    uint16_t len;
+    int64_t start;      // Ticks since the first record
+    uint32_t duration;  // Ticks
+    const uint8_t *data; // Payload inside the recording, NULL if none
+} I2CRec_Record_t;
+
+typedef struct {
+    const uint8_t *buf;
+    uint32_t len;
+    uint32_t pos;
+    uint32_t index;     // Records read so far
+    uint32_t tickHz;
+    uint32_t count;     // From the header, 0 if the recording was not stopped
+    int64_t start;
+} I2CRec_Reader_t;
+
+/*------------------- Function Prototypes ---------------------------*/
+HAL_StatusTypeDef I2CRec_Init(I2CRec_t *rec, uint8_t *buf, uint32_t size);
+void I2CRec_Start(I2CRec_t *rec);
+uint32_t I2CRec_Stop(I2CRec_t *rec);
+void I2CRec_OnComplete(I2C_HandleTypeDef *hi2c, HAL_StatusTypeDef status);
+HAL_StatusTypeDef I2CRec_ReaderInit(I2CRec_Reader_t *reader, const uint8_t *buf, uint32_t len);
+HAL_StatusTypeDef I2CRec_Next(I2CRec_Reader_t *reader, I2CRec_Record_t *record);
+
+#endif
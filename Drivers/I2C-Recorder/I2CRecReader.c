@@ -0,0 +1,126 @@
+#include "I2CRec.h"
+#include <string.h>
+
+/**
+ ******************************************************************************
+ * @file    I2CRecReader.c
+ * @author  Yair Yamin
+ * @brief   Decoder for I2CRec recordings.
+ * @details Walks a recording record by record without copying payloads. Has no
+ * dependency on the recorder or the --wrap options, so it builds on the host
+ * next to HostSim (SimReplay uses it) as well as on the target.
+ ******************************************************************************
+ */
+
+/* ========================== Static Helpers ============================ */
+
+static uint32_t I2CRec_GetU32(const uint8_t *p)
+{
+    return (uint32_t)p[0] | ((uint32_t)p[1] << 8) | ((uint32_t)p[2] << 16) | ((uint32_t)p[3] << 24);
+}
+
+static HAL_StatusTypeDef I2CRec_GetVarint(I2CRec_Reader_t *reader, uint32_t *value)
+{
+    *value = 0;
+    for (uint8_t shift = 0; shift < 35; shift += 7) {
+        if (reader->pos >= reader->len) {
+            return HAL_ERROR;
+        }
+        uint8_t byte = reader->buf[reader->pos++];
+        *value |= (uint32_t)(byte & 0x7F) << shift;
+        if (!(byte & 0x80)) {
+            return HAL_OK;
+        }
+    }
+    return HAL_ERROR;
+}
+
+ /* ========================== Function Definitions ============================ */
+
+/**
+ * @brief Open a recording for reading
+ * @param reader Reader state
+ * @param buf Recording
+ * @param len Recording length
+ * @return HAL_StatusTypeDef HAL_OK, HAL_ERROR if the header is not a supported recording
+ */
+HAL_StatusTypeDef I2CRec_ReaderInit(I2CRec_Reader_t *reader, const uint8_t *buf, uint32_t len)
+{
+    memset(reader, 0, sizeof(*reader));
+    if (buf == NULL || len < I2CREC_HEADER_LEN || memcmp(buf, I2CREC_MAGIC, 4) != 0 ||
+        buf[4] != I2CREC_VERSION || buf[5] < I2CREC_HEADER_LEN || buf[5] > len) {
+        return HAL_ERROR;
+    }
+    reader->buf = buf;
+    reader->len = len;
+    reader->pos = buf[5];
+    reader->tickHz = I2CRec_GetU32(&buf[8]);
+    reader->count = I2CRec_GetU32(&buf[12]);
+    return HAL_OK;
+}
+
+/**
+ * @brief Decode the next record
+ * @param reader Reader state
+ * @param record Output record, its payload points into the recording
+ * @return HAL_StatusTypeDef HAL_OK, HAL_ERROR at the end or on a truncated record.
+ *         reader->pos == reader->len after the last complete record.
+ */
+HAL_StatusTypeDef I2CRec_Next(I2CRec_Reader_t *reader, I2CRec_Record_t *record)
+{
+    uint32_t pos = reader->pos;
+    uint32_t delta, duration, len;
+
+    if (pos + 2 > reader->len) {
+        return HAL_ERROR;
+    }
+    uint8_t flags = reader->buf[reader->pos++];
+    memset(record, 0, sizeof(*record));
+    record->op = flags & I2CREC_FLAG_OP_MASK;
+    record->bus = (flags & I2CREC_FLAG_BUS_MASK) >> I2CREC_FLAG_BUS_POS;
+    record->late = (flags & I2CREC_FLAG_LATE) ? 1 : 0;
+    record->device = reader->buf[reader->pos++];
+
+    if (I2CRec_GetVarint(reader, &delta) != HAL_OK || I2CRec_GetVarint(reader, &duration) != HAL_OK) {
+        reader->pos = pos;
+        return HAL_ERROR;
+    }
+    if (record->op == I2CREC_OP_MEM_READ || record->op == I2CREC_OP_MEM_WRITE) {
+        record->regSize = (flags & I2CREC_FLAG_REG16) ? 2 : 1;
+        if (reader->pos + record->regSize > reader->len) {
+            reader->pos = pos;
+            return HAL_ERROR;
+        }
+        for (uint8_t i = 0; i < record->regSize; i++) {
+            record->reg = (uint16_t)((record->reg << 8) | reader->buf[reader->pos++]);
+        }
+    }
+    if (I2CRec_GetVarint(reader, &len) != HAL_OK || len > 0xFFFF) {
+        reader->pos = pos;
+        return HAL_ERROR;
+    }
+    record->len = (uint16_t)len;
+    if (flags & I2CREC_FLAG_STATUS) {
+        if (reader->pos >= reader->len) {
+            reader->pos = pos;
+            return HAL_ERROR;
+        }
+        record->status = reader->buf[reader->pos++];
+    }
+
+    uint8_t isRead = (record->op == I2CREC_OP_MEM_READ || record->op == I2CREC_OP_RECEIVE);
+    if (!(isRead && record->status != HAL_OK) && len != 0) {
+        if (reader->pos + len > reader->len) {
+            reader->pos = pos;
+            return HAL_ERROR;
+        }
+        record->data = &reader->buf[reader->pos];
+        reader->pos += len;
+    }
+
+    reader->start += (int32_t)((delta >> 1) ^ (0u - (delta & 1))); // Zigzag
+    record->start = reader->start;
+    record->duration = duration;
+    reader->index++;
+    return HAL_OK;
+}
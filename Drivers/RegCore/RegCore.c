@@ -0,0 +1,285 @@
+#include "RegCore.h"
+#include <string.h>
+
+/**
+ ******************************************************************************
+ * @file    RegCore.c
+ * @author  Yair Yamin
+ * @brief   Table-driven register access shared by the device drivers.
+ * @details A driver describes its registers once, as a const RegCore_Desc_t:
+ * address, width and byte order of every register, the bitfields inside
+ * them, and the two functions that move bytes over its bus. The core then
+ * keeps a mirror of the registers in the driver handle and does the
+ * read-modify-write work every setter used to repeat:
+ *
+ * - RegCore_Update() and RegCore_SetField() change bits of one register,
+ *   reading it only if the mirror does not hold it yet, and write nothing
+ *   when the bits already have the requested value.
+ * - RegCore_Stage() collects several changes and RegCore_Flush() writes
+ *   them, adjacent registers in one burst where the device allows it.
+ * - RegCore_Load() reads a register range, in bursts where possible.
+ *
+ * The mirror holds the registers as they appear on the bus, so transfers go
+ * straight from and to the handle and stay valid for DMA. Only single-byte
+ * and 16-bit registers are supported.
+ *
+ * The getters, RegCore_Stage(), RegCore_Update() and RegCore_SetField() are
+ * inline in RegCore.h and handle single-byte registers without strobe bits
+ * there; this file holds the generic code behind them.
+ ******************************************************************************
+ */
+
+/* ========================== Static Helpers ============================ */
+
+// Bits first..last
+static uint32_t RegCore_Run(uint8_t first, uint8_t last)
+{
+    return (uint32_t)((REGCORE_BIT(last) << 1) - REGCORE_BIT(first));
+}
+
+// The register after prev follows it both on the device and in the mirror
+static uint8_t RegCore_Adjacent(const RegCore_Desc_t *desc, uint8_t prev)
+{
+    const RegCore_Reg_t *a = &desc->regs[prev];
+    const RegCore_Reg_t *b = a + 1;
+    return (uint8_t)(prev + 1 < desc->count && b->addr == a->addr + a->width && b->offset == a->offset + a->width);
+}
+
+// One transfer of the registers first..last, straight from or into the mirror
+static HAL_StatusTypeDef RegCore_Transfer(const RegCore_Desc_t *desc, void *dev, RegCore_Io_t io, uint8_t first, uint8_t last)
+{
+    const RegCore_Reg_t *r = &desc->regs[first];
+    return io(dev, r->addr, RegCore_Mirror(desc, dev) + r->offset,
+              (uint16_t)(desc->regs[last].offset + desc->regs[last].width - r->offset));
+}
+
+// Mirrored value including strobe bits
+static uint16_t RegCore_Raw(const RegCore_Desc_t *desc, const void *dev, uint8_t reg)
+{
+    return RegCore_Decode(&desc->regs[reg], RegCore_Mirror(desc, dev) + desc->regs[reg].offset);
+}
+
+static void RegCore_Put(const RegCore_Reg_t *r, uint8_t *m, uint16_t value)
+{
+    if (r->width == 1) {
+        m[0] = (uint8_t)value;
+    } else if (r->flags & REGCORE_BIG_ENDIAN) {
+        m[0] = (uint8_t)(value >> 8);
+        m[1] = (uint8_t)value;
+    } else {
+        m[0] = (uint8_t)value;
+        m[1] = (uint8_t)(value >> 8);
+    }
+}
+
+ /* ========================== Function Definitions ============================ */
+
+/**
+ * @brief Stage a register value for the next flush, any register
+ * @param desc Device description
+ * @param dev Driver handle
+ * @param reg Register index
+ * @param value Value to write
+ * @details The generic part of RegCore_Stage(), for 16-bit and read-only
+ *          registers, registers with strobe bits and indices only known at
+ *          run time.
+ */
+void RegCore_StageAny(const RegCore_Desc_t *desc, void *dev, uint8_t reg, uint16_t value)
+{
+    const RegCore_Reg_t *r = &desc->regs[reg];
+    RegCore_State_t *state = RegCore_State(desc, dev);
+    uint32_t bit = REGCORE_BIT(reg);
+
+    if (r->flags & REGCORE_READ_ONLY) {
+        return;
+    }
+    if (!(state->valid & bit) || (r->flags & REGCORE_VOLATILE) || (value & r->strobe) ||
+        RegCore_Get(desc, dev, reg) != value) {
+        RegCore_Put(r, RegCore_Mirror(desc, dev) + r->offset, value);
+        state->dirty |= bit;
+        state->valid |= bit;
+    }
+}
+
+/**
+ * @brief Stage a run of registers from bus-order bytes
+ * @param desc Device description
+ * @param dev Driver handle
+ * @param first First register index
+ * @param data Register bytes as they go on the bus, each register's width in turn
+ * @param count Number of registers
+ */
+void RegCore_StageBytes(const RegCore_Desc_t *desc, void *dev, uint8_t first, const uint8_t *data, uint8_t count)
+{
+    for (uint8_t reg = first; reg < first + count && reg < desc->count; reg++) {
+        RegCore_StageAny(desc, dev, reg, RegCore_Decode(&desc->regs[reg], data));
+        data += desc->regs[reg].width;
+    }
+}
+
+/**
+ * @brief Take register bytes read outside the core into the mirror
+ * @param desc Device description
+ * @param dev Driver handle
+ * @param first First register index
+ * @param data Register bytes as read from the bus, each register's width in turn
+ * @param count Number of registers
+ * @details Registers with staged, unflushed values keep their staged value.
+ */
+void RegCore_Merge(const RegCore_Desc_t *desc, void *dev, uint8_t first, const uint8_t *data, uint8_t count)
+{
+    RegCore_State_t *state = RegCore_State(desc, dev);
+    uint8_t *mirror = RegCore_Mirror(desc, dev);
+
+    for (uint8_t reg = first; reg < first + count && reg < desc->count; reg++) {
+        const RegCore_Reg_t *r = &desc->regs[reg];
+        if (!(state->dirty & REGCORE_BIT(reg))) {
+            memcpy(mirror + r->offset, data, r->width);
+        }
+        state->valid |= REGCORE_BIT(reg);
+        data += r->width;
+    }
+}
+
+/**
+ * @brief Forget everything the mirror knows about the device
+ * @param desc Device description
+ * @param dev Driver handle
+ * @details Staged values are dropped as well.
+ */
+void RegCore_Invalidate(const RegCore_Desc_t *desc, void *dev)
+{
+    RegCore_State_t *state = RegCore_State(desc, dev);
+    state->valid = 0;
+    state->dirty = 0;
+}
+
+/**
+ * @brief Read a register range into the mirror
+ * @param desc Device description
+ * @param dev Driver handle
+ * @param first First register index
+ * @param count Number of registers
+ * @return HAL_StatusTypeDef HAL_OK on success, error code otherwise
+ * @details One transfer per run of adjacent registers with REGCORE_BURST_READ,
+ *          one per register without, straight into the mirror. Staged values
+ *          in the range are flushed first rather than overwritten.
+ */
+HAL_StatusTypeDef RegCore_Load(const RegCore_Desc_t *desc, void *dev, uint8_t first, uint8_t count)
+{
+    RegCore_State_t *state = RegCore_State(desc, dev);
+    uint8_t end = (uint8_t)(first + count);
+    HAL_StatusTypeDef status;
+
+    if (state->dirty & RegCore_Run(first, (uint8_t)(end - 1))) {
+        status = RegCore_Flush(desc, dev);
+        if (status != HAL_OK) {
+            return status;
+        }
+    }
+    while (first < end) {
+        uint8_t last = first;
+        if (desc->flags & REGCORE_BURST_READ) {
+            while (last + 1 < end && RegCore_Adjacent(desc, last)) {
+                last++;
+            }
+        }
+        uint32_t run = RegCore_Run(first, last);
+
+        state->valid &= ~run;
+        status = RegCore_Transfer(desc, dev, desc->read, first, last);
+        if (status != HAL_OK) {
+            return status;
+        }
+        state->valid |= run;
+        first = (uint8_t)(last + 1);
+    }
+    return HAL_OK;
+}
+
+/**
+ * @brief Make sure the mirror holds a register range
+ * @param desc Device description
+ * @param dev Driver handle
+ * @param first First register index
+ * @param count Number of registers
+ * @return HAL_StatusTypeDef HAL_OK on success, error code otherwise
+ * @details Loads the whole range if any register in it is not valid yet.
+ */
+HAL_StatusTypeDef RegCore_Ensure(const RegCore_Desc_t *desc, void *dev, uint8_t first, uint8_t count)
+{
+    uint32_t run = RegCore_Run(first, (uint8_t)(first + count - 1));
+
+    if ((RegCore_State(desc, dev)->valid & run) == run) {
+        return HAL_OK;
+    }
+    return RegCore_Load(desc, dev, first, count);
+}
+
+/**
+ * @brief Write every staged register to the device
+ * @param desc Device description
+ * @param dev Driver handle
+ * @return HAL_StatusTypeDef HAL_OK on success, error code otherwise
+ * @details Registers go out in table order. With REGCORE_BURST_WRITE adjacent
+ *          dirty registers share one burst, and up to maxGap clean, valid,
+ *          non-volatile registers between two dirty ones are rewritten with
+ *          their mirrored value to join them, unless that value still holds a
+ *          strobe bit from an earlier write. On error the remaining registers
+ *          stay dirty and can be flushed again.
+ */
+HAL_StatusTypeDef RegCore_Flush(const RegCore_Desc_t *desc, void *dev)
+{
+    RegCore_State_t *state = RegCore_State(desc, dev);
+    HAL_StatusTypeDef status;
+    uint8_t first = 0;
+
+    while (state->dirty != 0) {
+        while (!(state->dirty & REGCORE_BIT(first))) {
+            first++;
+        }
+        uint8_t last = first;
+        if (desc->flags & REGCORE_BURST_WRITE) {
+            for (uint8_t prev = first; RegCore_Adjacent(desc, prev); prev++) {
+                uint8_t next = (uint8_t)(prev + 1);
+                uint32_t bit = REGCORE_BIT(next);
+                if (state->dirty & bit) {
+                    last = next;
+                } else if ((next - last) > desc->maxGap || !(state->valid & bit) ||
+                           (desc->regs[next].flags & (REGCORE_VOLATILE | REGCORE_READ_ONLY)) ||
+                           (RegCore_Raw(desc, dev, next) & desc->regs[next].strobe)) {
+                    break;
+                }
+            }
+        }
+        status = RegCore_Transfer(desc, dev, desc->write, first, last);
+        if (status != HAL_OK) {
+            return status;
+        }
+        state->dirty &= ~RegCore_Run(first, last);
+        first = (uint8_t)(last + 1);
+    }
+    return HAL_OK;
+}
+
+/**
+ * @brief Read-modify-write bits of one register, any register
+ * @param desc Device description
+ * @param dev Driver handle
+ * @param reg Register index
+ * @param mask Bits to change
+ * @param bits New values for the bits in mask
+ * @return HAL_StatusTypeDef HAL_OK on success, error code otherwise
+ * @details The generic part of RegCore_Update(): loads the register if needed
+ *          and flushes everything staged along with it.
+ */
+HAL_StatusTypeDef RegCore_UpdateAny(const RegCore_Desc_t *desc, void *dev, uint8_t reg, uint16_t mask, uint16_t bits)
+{
+    HAL_StatusTypeDef status = RegCore_Ensure(desc, dev, reg, 1);
+    if (status != HAL_OK) {
+        return status;
+    }
+    RegCore_StageAny(desc, dev, reg, (uint16_t)((RegCore_Get(desc, dev, reg) & ~mask) | (bits & mask)));
+    return RegCore_Flush(desc, dev);
+}
+
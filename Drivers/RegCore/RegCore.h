@@ -0,0 +1,208 @@
+#ifndef REGCORE_H
+#define REGCORE_H
+#include "main.h"
+#include <stddef.h>
+
+/************************ Register Table defines ********************************/
+#define REGCORE_MAX_REGS 32 // Registers per device: one valid and one dirty bit each
+#define REGCORE_BIT(reg) (1UL << (reg))
+
+// RegCore_Reg_t flags
+#define REGCORE_BIG_ENDIAN 0x01 // 16-bit register held MSB first, as most devices send it
+#define REGCORE_VOLATILE   0x02 // The device changes it: written whenever staged, never rewritten to fill a gap
+#define REGCORE_READ_ONLY  0x04 // Never written
+
+// RegCore_Desc_t flags
+#define REGCORE_BURST_READ  0x01 // Adjacent registers can be read in one transfer
+#define REGCORE_BURST_WRITE 0x02 // Adjacent registers can be written in one transfer
+
+/************************ Register Core Structs ********************************/
+// Bus access of a driver: read or write size bytes starting at register addr.
+// dev is the driver handle; write data points into the mirror and stays valid.
+typedef HAL_StatusTypeDef (*RegCore_Io_t)(void *dev, uint8_t addr, uint8_t *data, uint16_t size);
+
+typedef struct {
+    uint8_t addr;    // Register address on the bus
+    uint8_t offset;  // Byte offset in the mirror
+    uint8_t width;   // 1 or 2 bytes
+    uint8_t flags;   // REGCORE_BIG_ENDIAN, REGCORE_VOLATILE, REGCORE_READ_ONLY
+    uint16_t strobe; // Bits that act when written as 1 (start, trigger); never carried over from the mirror
+} RegCore_Reg_t;
+
+typedef struct {
+    uint8_t reg;     // Index in the register table
+    uint8_t shift;   // Position of the lowest field bit
+    uint16_t mask;   // Field bits, in place
+} RegCore_Field_t;
+
+typedef struct {
+    uint32_t valid;  // Bit per register: mirror matches the device
+    uint32_t dirty;  // Bit per register: staged in the mirror, not yet written
+} RegCore_State_t;
+
+// One per device type, a const table. Registers are indexed by their position
+// in regs, and two of them are adjacent when both their addresses and their
+// mirror bytes follow each other.
+typedef struct {
+    const RegCore_Reg_t *regs;
+    const RegCore_Field_t *fields;
+    RegCore_Io_t read;
+    RegCore_Io_t write;
+    uint16_t mirror; // offsetof() the register mirror in the driver handle
+    uint16_t state;  // offsetof() the RegCore_State_t in the driver handle
+    uint8_t count;   // Registers in regs, at most REGCORE_MAX_REGS
+    uint8_t flags;   // REGCORE_BURST_READ, REGCORE_BURST_WRITE
+    uint8_t maxGap;  // Clean registers a flush may rewrite to merge two dirty runs into one burst
+} RegCore_Desc_t;
+
+/*------------------- Function Prototypes ---------------------------*/
+void RegCore_StageAny(const RegCore_Desc_t *desc, void *dev, uint8_t reg, uint16_t value);
+void RegCore_StageBytes(const RegCore_Desc_t *desc, void *dev, uint8_t first, const uint8_t *data, uint8_t count);
+void RegCore_Merge(const RegCore_Desc_t *desc, void *dev, uint8_t first, const uint8_t *data, uint8_t count);
+void RegCore_Invalidate(const RegCore_Desc_t *desc, void *dev);
+HAL_StatusTypeDef RegCore_Load(const RegCore_Desc_t *desc, void *dev, uint8_t first, uint8_t count);
+HAL_StatusTypeDef RegCore_Ensure(const RegCore_Desc_t *desc, void *dev, uint8_t first, uint8_t count);
+HAL_StatusTypeDef RegCore_Flush(const RegCore_Desc_t *desc, void *dev);
+HAL_StatusTypeDef RegCore_UpdateAny(const RegCore_Desc_t *desc, void *dev, uint8_t reg, uint16_t mask, uint16_t bits);
+
+/*------------------- Inline Fast Path ---------------------------*/
+// Drivers pass their const descriptor and a constant register index, so the
+// compiler reads the register table at build time: getters become a load from
+// the mirror, and setters of a single-byte register without strobe bits get a
+// few instructions inline; every other register is a plain call to the generic
+// code. Forced inline, since -Os would otherwise keep one unfolded copy per driver.
+#define REGCORE_INLINE static inline __attribute__((always_inline))
+
+REGCORE_INLINE RegCore_State_t *RegCore_State(const RegCore_Desc_t *desc, void *dev)
+{
+    return (RegCore_State_t *)((uint8_t *)dev + desc->state);
+}
+
+REGCORE_INLINE uint8_t *RegCore_Mirror(const RegCore_Desc_t *desc, const void *dev)
+{
+    return (uint8_t *)dev + desc->mirror;
+}
+
+// Single byte, no strobe bits, writable: the mirror byte is the value
+REGCORE_INLINE int RegCore_IsPlainByte(const RegCore_Reg_t *r)
+{
+    return r->width == 1 && r->strobe == 0 && !(r->flags & REGCORE_READ_ONLY);
+}
+
+// Register value from its mirror bytes, in CPU byte order
+REGCORE_INLINE uint16_t RegCore_Decode(const RegCore_Reg_t *r, const uint8_t *m)
+{
+    if (r->width == 1) {
+        return m[0];
+    }
+    if (r->flags & REGCORE_BIG_ENDIAN) {
+        return (uint16_t)(m[0] << 8 | m[1]);
+    }
+    return (uint16_t)(m[1] << 8 | m[0]);
+}
+
+/**
+ * @brief Mirrored value of a register
+ * @param desc Device description
+ * @param dev Driver handle
+ * @param reg Register index
+ * @return uint16_t Value in CPU byte order, strobe bits cleared; whatever the
+ *         mirror holds, valid or not
+ */
+REGCORE_INLINE uint16_t RegCore_Get(const RegCore_Desc_t *desc, const void *dev, uint8_t reg)
+{
+    const RegCore_Reg_t *r = &desc->regs[reg];
+    return (uint16_t)(RegCore_Decode(r, RegCore_Mirror(desc, dev) + r->offset) & ~r->strobe);
+}
+
+/**
+ * @brief Mirrored value of a bitfield
+ * @param desc Device description
+ * @param dev Driver handle
+ * @param field Field index
+ * @return uint16_t Field value, shifted down to bit 0
+ */
+REGCORE_INLINE uint16_t RegCore_GetField(const RegCore_Desc_t *desc, const void *dev, uint8_t field)
+{
+    const RegCore_Field_t *f = &desc->fields[field];
+    return (uint16_t)((RegCore_Get(desc, dev, f->reg) & f->mask) >> f->shift);
+}
+
+/**
+ * @brief Stage a register value for the next flush
+ * @param desc Device description
+ * @param dev Driver handle
+ * @param reg Register index
+ * @param value Value to write
+ * @details A register whose valid mirror already holds the value is left clean,
+ *          unless it is volatile or the value sets one of its strobe bits.
+ */
+REGCORE_INLINE void RegCore_Stage(const RegCore_Desc_t *desc, void *dev, uint8_t reg, uint16_t value)
+{
+    const RegCore_Reg_t *r = &desc->regs[reg];
+
+    if (RegCore_IsPlainByte(r)) {
+        RegCore_State_t *state = RegCore_State(desc, dev);
+        uint8_t *m = RegCore_Mirror(desc, dev) + r->offset;
+        uint32_t bit = REGCORE_BIT(reg);
+        if (!(state->valid & bit) || (r->flags & REGCORE_VOLATILE) || *m != value) {
+            *m = (uint8_t)value;
+            state->dirty |= bit;
+            state->valid |= bit;
+        }
+        return;
+    }
+    RegCore_StageAny(desc, dev, reg, value);
+}
+
+/**
+ * @brief Read-modify-write bits of one register
+ * @param desc Device description
+ * @param dev Driver handle
+ * @param reg Register index
+ * @param mask Bits to change
+ * @param bits New values for the bits in mask
+ * @return HAL_StatusTypeDef HAL_OK on success, error code otherwise
+ * @details Reads the register only if the mirror does not hold it, and makes
+ *          no write at all when the bits already have the requested value.
+ *          Strobe bits outside mask are written as 0.
+ */
+REGCORE_INLINE HAL_StatusTypeDef RegCore_Update(const RegCore_Desc_t *desc, void *dev, uint8_t reg, uint16_t mask, uint16_t bits)
+{
+    const RegCore_Reg_t *r = &desc->regs[reg];
+    RegCore_State_t *state = RegCore_State(desc, dev);
+
+    // Mirror valid and nothing else staged: one byte write, or none
+    if (RegCore_IsPlainByte(r) && (state->valid & REGCORE_BIT(reg)) && state->dirty == 0) {
+        uint8_t *m = RegCore_Mirror(desc, dev) + r->offset;
+        uint8_t value = (uint8_t)((*m & ~mask) | (bits & mask));
+        HAL_StatusTypeDef status;
+        if (value == *m && !(r->flags & REGCORE_VOLATILE)) {
+            return HAL_OK;
+        }
+        *m = value;
+        state->dirty = REGCORE_BIT(reg); // Until the write succeeds, as in RegCore_Flush()
+        status = desc->write(dev, r->addr, m, 1);
+        if (status == HAL_OK) {
+            state->dirty = 0;
+        }
+        return status;
+    }
+    return RegCore_UpdateAny(desc, dev, reg, mask, bits);
+}
+
+/**
+ * @brief Set a bitfield and write its register
+ * @param desc Device description
+ * @param dev Driver handle
+ * @param field Field index
+ * @param value Field value, from bit 0; bits beyond the field are ignored
+ * @return HAL_StatusTypeDef HAL_OK on success, error code otherwise
+ */
+REGCORE_INLINE HAL_StatusTypeDef RegCore_SetField(const RegCore_Desc_t *desc, void *dev, uint8_t field, uint16_t value)
+{
+    const RegCore_Field_t *f = &desc->fields[field];
+    return RegCore_Update(desc, dev, f->reg, f->mask, (uint16_t)(value << f->shift));
+}
+
+#endif
@@ -0,0 +1,298 @@
+#define _POSIX_C_SOURCE 200809L // clock_gettime
+#include "PackBench.h"
+#include <math.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+/**
+ ******************************************************************************
+ * @file    PackBench.c
+ * @author  Yair Yamin
+ * @brief   Compression ratio and speed of SensorPack on typical sensor streams.
+ * @details Encodes each trace into SensorPack blocks, decodes it back and
+ * reports the size against 8 bytes per sample and the host CPU time of both
+ * directions. The synthetic traces are generated with a fixed seed so the
+ * sizes are reproducible; recorded SensorLog captures given on the command
+ * line are split into one stream per sensor, scale and channel.
+ *
+ * Synthetic traces:
+ * - BME280 temperature, pressure and humidity at 1 Hz: slow daily drift plus
+ *   a few counts of noise, the common case.
+ * - DS3231 seconds at 1 Hz: a counter.
+ * - ADS1115 slow channel at 10 Hz: a sensor voltage with 3 LSB of noise.
+ * - ADS1115 50 Hz sine at 860 SPS: full-scale signal, the worst case.
+ ******************************************************************************
+ */
+
+/* ========================== Defines ============================ */
+#define PACK_BENCH_PI 3.14159265358979323846
+
+/************************ Bench Context ********************************/
+typedef struct {
+    uint8_t *buf;
+    uint32_t size;
+    uint32_t len;
+} PackBench_Sink_t;
+
+/* ========================== Global Variables ============================ */
+static uint32_t benchTimes[PACK_BENCH_SAMPLES];
+static int32_t benchValues[PACK_BENCH_SAMPLES];
+static uint32_t decodedTimes[PACK_BENCH_SAMPLES];
+static int32_t decodedValues[PACK_BENCH_SAMPLES];
+static uint8_t packed[PACK_BENCH_SAMPLES * 8 + 4096];
+static uint32_t seed;
+
+/* ========================== Static Helpers ============================ */
+
+static uint64_t PackBench_CpuNs(void)
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_PROCESS_CPUTIME_ID, &ts);
+    return (uint64_t)ts.tv_sec * 1000000000u + (uint64_t)ts.tv_nsec;
+}
+
+static void PackBench_Sink(void *ctx, const uint8_t *block, uint32_t len)
+{
+    PackBench_Sink_t *sink = (PackBench_Sink_t *)ctx;
+    if (sink->len + len <= sink->size) {
+        memcpy(&sink->buf[sink->len], block, len);
+        sink->len += len;
+    }
+}
+
+/**
+ * @brief Uniform noise in [-amplitude, amplitude], fixed sequence
+ */
+static int32_t PackBench_Noise(int32_t amplitude)
+{
+    seed = seed * 1664525u + 1013904223u;
+    return (int32_t)((seed >> 8) % (uint32_t)(2 * amplitude + 1)) - amplitude;
+}
+
+/**
+ * @brief Millisecond timestamps of a loop sampling every periodUs, one tick late now and then
+ */
+static void PackBench_Ticks(uint32_t count, uint32_t periodUs)
+{
+    for (uint32_t i = 0; i < count; i++) {
+        uint32_t late = ((seed = seed * 1664525u + 1013904223u) >> 28) == 0; // 1 in 16
+        benchTimes[i] = (uint32_t)(((uint64_t)i * periodUs) / 1000u) + late;
+    }
+}
+
+static double PackBench_Wave(uint32_t i, double period, double phase)
+{
+    return sin(2.0 * PACK_BENCH_PI * (double)i / period + phase);
+}
+
+ /* ========================== Function Definitions ============================ */
+
+/**
+ * @brief Encode and decode one trace
+ * @param name Trace name for the report
+ * @param timestamps Sample times
+ * @param values Sample values
+ * @param count Samples, at most PACK_BENCH_SAMPLES
+ * @param result Sizes, times and round-trip check
+ */
+void PackBench_Run(const char *name, const uint32_t *timestamps, const int32_t *values, uint32_t count,
+                   PackBench_Result_t *result)
+{
+    static SensorPack_t pack;
+    PackBench_Sink_t sink = {packed, sizeof(packed), 0};
+    SensorPack_Block_t block;
+    uint32_t decoded = 0;
+
+    memset(result, 0, sizeof(*result));
+    snprintf(result->name, sizeof(result->name), "%s", name);
+    result->samples = count;
+    result->rawBytes = count * 8u;
+
+    uint64_t start = PackBench_CpuNs();
+    SensorPack_Init(&pack, 0, SENSORLOG_SCALE_RAW, 0, PackBench_Sink, &sink);
+    for (uint32_t i = 0; i < count; i++) {
+        SensorPack_Add(&pack, timestamps[i], values[i]);
+    }
+    SensorPack_Flush(&pack);
+    result->encodeNs = PackBench_CpuNs() - start;
+    result->packedBytes = sink.len;
+
+    start = PackBench_CpuNs();
+    for (uint32_t pos = 0; pos < sink.len; pos += block.len) {
+        pos = SensorPack_Find(packed, sink.len, pos, &block);
+        if (pos == sink.len) {
+            break;
+        }
+        int32_t n = SensorPack_Decode(&packed[pos], sink.len - pos, &decodedTimes[decoded], &decodedValues[decoded],
+                                      PACK_BENCH_SAMPLES - decoded);
+        if (n < 0) {
+            break;
+        }
+        decoded += (uint32_t)n;
+    }
+    result->decodeNs = PackBench_CpuNs() - start;
+
+    result->roundTrip = (decoded == count) &&
+                        memcmp(decodedTimes, timestamps, count * sizeof(timestamps[0])) == 0 &&
+                        memcmp(decodedValues, values, count * sizeof(values[0])) == 0;
+}
+
+/**
+ * @brief Run the synthetic traces
+ * @param results Filled with one result per trace
+ * @param max Capacity of results
+ * @return uint16_t Number of results
+ */
+uint16_t PackBench_Synthetic(PackBench_Result_t *results, uint16_t max)
+{
+    const uint32_t n = PACK_BENCH_SAMPLES;
+    uint16_t count = 0;
+
+    seed = 12345;
+    PackBench_Ticks(n, 1000000);
+    for (uint32_t i = 0; i < n; i++) {
+        benchValues[i] = 2350 + (int32_t)lround(150.0 * PackBench_Wave(i, 86400.0, 0.0)) + PackBench_Noise(1);
+    }
+    if (count < max) PackBench_Run("bme280_temp_1hz", benchTimes, benchValues, n, &results[count++]);
+
+    for (uint32_t i = 0; i < n; i++) {
+        benchValues[i] = 101325 * 256 + (int32_t)lround(200.0 * 256.0 * PackBench_Wave(i, 43200.0, 0.5)) + PackBench_Noise(40);
+    }
+    if (count < max) PackBench_Run("bme280_press_1hz", benchTimes, benchValues, n, &results[count++]);
+
+    for (uint32_t i = 0; i < n; i++) {
+        benchValues[i] = 4500 + (int32_t)lround(800.0 * PackBench_Wave(i, 86400.0, 1.0)) + PackBench_Noise(2);
+    }
+    if (count < max) PackBench_Run("bme280_hum_1hz", benchTimes, benchValues, n, &results[count++]);
+
+    for (uint32_t i = 0; i < n; i++) {
+        benchValues[i] = 845640000 + (int32_t)i;
+    }
+    if (count < max) PackBench_Run("ds3231_seconds_1hz", benchTimes, benchValues, n, &results[count++]);
+
+    PackBench_Ticks(n, 100000);
+    for (uint32_t i = 0; i < n; i++) {
+        benchValues[i] = 12000 + (int32_t)lround(200.0 * PackBench_Wave(i, 36000.0, 0.0)) + PackBench_Noise(3);
+    }
+    if (count < max) PackBench_Run("ads1115_slow_10hz", benchTimes, benchValues, n, &results[count++]);
+
+    PackBench_Ticks(n, 1000000 / 860);
+    for (uint32_t i = 0; i < n; i++) {
+        benchValues[i] = (int32_t)lround(16000.0 * PackBench_Wave(i, 860.0 / 50.0, 0.0)) + PackBench_Noise(2);
+    }
+    if (count < max) PackBench_Run("ads1115_sine_860sps", benchTimes, benchValues, n, &results[count++]);
+    return count;
+}
+
+/**
+ * @brief Run every stream of a recorded SensorLog capture
+ * @param capture SensorLog blocks as received from the board
+ * @param len Length of capture
+ * @param results Filled with one result per sensor, scale and channel
+ * @param max Capacity of results
+ * @return uint16_t Number of results
+ */
+uint16_t PackBench_Capture(const uint8_t *capture, uint32_t len, PackBench_Result_t *results, uint16_t max)
+{
+    uint32_t keys[PACK_BENCH_MAX_STREAMS];
+    uint16_t streams = 0;
+    SensorLog_Reader_t reader;
+    SensorLog_Record_t record;
+
+    if (SensorLog_ReaderInit(&reader, capture, len) != HAL_OK) {
+        return 0;
+    }
+    while (SensorLog_Next(&reader, &record) == HAL_OK) {
+        uint32_t key = ((uint32_t)record.sensor << 16) | ((uint32_t)record.scale << 8) | record.channel;
+        uint16_t s = 0;
+        while (s < streams && keys[s] != key) {
+            s++;
+        }
+        if (s == streams && streams < PACK_BENCH_MAX_STREAMS) {
+            keys[streams++] = key;
+        }
+    }
+
+    uint16_t count = 0;
+    for (uint16_t s = 0; s < streams && count < max; s++) {
+        uint32_t n = 0;
+        char name[PACK_BENCH_NAME_LEN];
+        SensorLog_ReaderInit(&reader, capture, len);
+        while (n < PACK_BENCH_SAMPLES && SensorLog_Next(&reader, &record) == HAL_OK) {
+            if ((((uint32_t)record.sensor << 16) | ((uint32_t)record.scale << 8) | record.channel) == keys[s]) {
+                benchTimes[n] = record.timestamp;
+                benchValues[n] = record.value;
+                n++;
+            }
+        }
+        snprintf(name, sizeof(name), "capture_s%u_%s%u", (unsigned)(keys[s] >> 16),
+                 SensorLog_Unit((uint8_t)(keys[s] >> 8)), (unsigned)(keys[s] & 0xFF));
+        PackBench_Run(name, benchTimes, benchValues, n, &results[count++]);
+    }
+    return count;
+}
+
+/**
+ * @brief Write results as CSV with a header line
+ */
+void PackBench_WriteCsv(FILE *out, const PackBench_Result_t *results, uint16_t count)
+{
+    fprintf(out, "trace,samples,raw_bytes,packed_bytes,ratio,bits_per_sample,encode_ns_per_sample,decode_ns_per_sample,round_trip\n");
+    for (uint16_t i = 0; i < count; i++) {
+        const PackBench_Result_t *r = &results[i];
+        double samples = r->samples ? (double)r->samples : 1.0;
+        fprintf(out, "%s,%u,%u,%u,%.2f,%.2f,%.1f,%.1f,%s\n", r->name, r->samples, r->rawBytes, r->packedBytes,
+                r->packedBytes ? (double)r->rawBytes / r->packedBytes : 0.0, 8.0 * r->packedBytes / samples,
+                (double)r->encodeNs / samples, (double)r->decodeNs / samples, r->roundTrip ? "ok" : "FAIL");
+    }
+}
+
+/**
+ * @brief Command line entry: [--min-ratio R] [capture.bin ...]
+ * @return int 0, 1 if a trace did not round-trip or a ratio is below R, 2 on usage errors
+ * @details Without --min-ratio only the round trip is checked. The ratio limit
+ * applies to every trace except the full-scale sine, which is not meant to compress.
+ */
+int PackBench_Main(int argc, char **argv)
+{
+    static PackBench_Result_t results[16 + PACK_BENCH_MAX_STREAMS];
+    const uint16_t max = sizeof(results) / sizeof(results[0]);
+    double minRatio = 0.0;
+    uint16_t count;
+    int failed = 0;
+
+    count = PackBench_Synthetic(results, max);
+    for (int i = 1; i < argc; i++) {
+        if (strcmp(argv[i], "--min-ratio") == 0 && i + 1 < argc) {
+            minRatio = atof(argv[++i]);
+            continue;
+        }
+        if (argv[i][0] == '-') {
+            fprintf(stderr, "usage: %s [--min-ratio R] [capture.bin ...]\n", argv[0]);
+            return 2;
+        }
+        FILE *in = fopen(argv[i], "rb");
+        if (in == NULL) {
+            fprintf(stderr, "cannot open capture %s\n", argv[i]);
+            return 2;
+        }
+        static uint8_t capture[1 << 22];
+        uint32_t len = (uint32_t)fread(capture, 1, sizeof(capture), in);
+        fclose(in);
+        count += PackBench_Capture(capture, len, &results[count], (uint16_t)(max - count));
+    }
+
+    PackBench_WriteCsv(stdout, results, count);
+    for (uint16_t i = 0; i < count; i++) {
+        double ratio = results[i].packedBytes ? (double)results[i].rawBytes / results[i].packedBytes : 0.0;
+        if (!results[i].roundTrip) {
+            fprintf(stderr, "%s: decoded samples differ\n", results[i].name);
+            failed = 1;
+        } else if (ratio < minRatio && strstr(results[i].name, "sine") == NULL) {
+            fprintf(stderr, "%s: ratio %.2f below %.2f\n", results[i].name, ratio, minRatio);
+            failed = 1;
+        }
+    }
+    return failed;
+}
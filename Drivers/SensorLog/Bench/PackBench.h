@@ -0,0 +1,34 @@
+#ifndef PACK_BENCH_H
+#define PACK_BENCH_H
+#include "SensorPack.h"
+#include <stdio.h>
+
+/*------------------- Configuration ---------------------------*/
+#ifndef PACK_BENCH_SAMPLES
+#define PACK_BENCH_SAMPLES 100000 // Samples per synthetic trace
+#endif
+#ifndef PACK_BENCH_MAX_STREAMS
+#define PACK_BENCH_MAX_STREAMS 32 // Streams taken from a recorded SensorLog capture
+#endif
+#define PACK_BENCH_NAME_LEN 32
+
+/************************ Bench Structs ********************************/
+typedef struct {
+    char name[PACK_BENCH_NAME_LEN]; // Trace
+    uint32_t samples;
+    uint32_t rawBytes;      // 8 bytes per sample: u32 timestamp and s32 value
+    uint32_t packedBytes;   // SensorPack blocks, headers included
+    uint64_t encodeNs;      // Host CPU time, informational only
+    uint64_t decodeNs;
+    int roundTrip;          // 1 if every sample decoded to its original
+} PackBench_Result_t;
+
+/*------------------- Function Prototypes ---------------------------*/
+void PackBench_Run(const char *name, const uint32_t *timestamps, const int32_t *values, uint32_t count,
+                   PackBench_Result_t *result);
+uint16_t PackBench_Synthetic(PackBench_Result_t *results, uint16_t max);
+uint16_t PackBench_Capture(const uint8_t *capture, uint32_t len, PackBench_Result_t *results, uint16_t max);
+void PackBench_WriteCsv(FILE *out, const PackBench_Result_t *results, uint16_t count);
+int PackBench_Main(int argc, char **argv);
+
+#endif
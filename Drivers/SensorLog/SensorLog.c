@@ -0,0 +1,174 @@
+#include "SensorLog.h"
+#include <string.h>
+
+/**
+ ******************************************************************************
+ * @file    SensorLog.c
+ * @author  Yair Yamin
+ * @brief   Streaming writer for timestamped sensor samples.
+ * @details Samples are stored as fixed 12-byte records in one of two blocks.
+ * When the block being filled is full it is handed to the sink (UART/SPI DMA,
+ * SD or flash write) and the other block is filled meanwhile, so writing a
+ * sample is a timestamp read and a 12-byte copy: no formatting, no allocation.
+ *
+ * - SensorLog_Write() may be called from tasks and interrupts.
+ * - A block stays with the sink until SensorLog_Release(). If both blocks are
+ *   with the sink, samples are dropped and counted instead of blocking.
+ * - Records are copied in CPU byte order, the format is little-endian like
+ *   every Cortex-M target. SensorLogReader.c decodes blocks on any host.
+ ******************************************************************************
+ */
+
+/* ========================== Defines ============================ */
+#define SENSORLOG_LOCK()   uint32_t primask = __get_PRIMASK(); __disable_irq()
+#define SENSORLOG_UNLOCK() __set_PRIMASK(primask)
+
+_Static_assert(sizeof(SensorLog_Record_t) == SENSORLOG_RECORD_LEN, "SensorLog_Record_t must match the record format");
+
+/* ========================== Static Helpers ============================ */
+
+static void SensorLog_PutU32(uint8_t *p, uint32_t value)
+{
+    p[0] = (uint8_t)value;
+    p[1] = (uint8_t)(value >> 8);
+    p[2] = (uint8_t)(value >> 16);
+    p[3] = (uint8_t)(value >> 24);
+}
+
+/**
+ * @brief Hand the active block to the sink's queue, called with interrupts masked
+ * @return uint8_t Index of the sealed block
+ */
+static uint8_t SensorLog_Seal(SensorLog_t *log, uint16_t *count, uint32_t *seq)
+{
+    uint8_t sealed = log->active;
+
+    *count = log->count;
+    *seq = log->seq++;
+    log->busy[sealed] = 1;
+    log->active ^= 1;
+    log->count = 0;
+    return sealed;
+}
+
+/**
+ * @brief Finish the header of a sealed block and pass it to the sink
+ * @details The block belongs to the sink now, so this runs with interrupts enabled.
+ */
+static void SensorLog_Emit(SensorLog_t *log, uint8_t sealed, uint16_t count, uint32_t seq)
+{
+    uint8_t *block = (uint8_t *)log->block[sealed];
+    uint32_t used = SENSORLOG_HEADER_LEN + (uint32_t)count * SENSORLOG_RECORD_LEN;
+
+    block[6] = (uint8_t)count;
+    block[7] = (uint8_t)(count >> 8);
+    SensorLog_PutU32(&block[8], seq);
+    memset(&block[used], 0, SENSORLOG_BLOCK_SIZE - used);
+    log->sink(log->ctx, block, SENSORLOG_BLOCK_SIZE);
+}
+
+ /* ========================== Function Definitions ============================ */
+
+/**
+ * @brief Initialize a log
+ * @param log Log state, the two blocks live inside it
+ * @param sink Called with each full block
+ * @param ctx Passed to the sink
+ * @return HAL_StatusTypeDef HAL_OK, HAL_ERROR without a sink
+ */
+HAL_StatusTypeDef SensorLog_Init(SensorLog_t *log, SensorLog_Sink_t sink, void *ctx)
+{
+    if (sink == NULL) {
+        return HAL_ERROR;
+    }
+    memset(log, 0, sizeof(*log));
+    log->sink = sink;
+    log->ctx = ctx;
+    for (uint8_t i = 0; i < 2; i++) {
+        uint8_t *block = (uint8_t *)log->block[i];
+        memcpy(block, SENSORLOG_MAGIC, 4);
+        block[4] = SENSORLOG_VERSION;
+        block[5] = SENSORLOG_RECORD_LEN;
+        SensorLog_PutU32(&block[12], SENSORLOG_TICK_HZ);
+        SensorLog_PutU32(&block[16], SENSORLOG_BLOCK_SIZE);
+    }
+    return HAL_OK;
+}
+
+/**
+ * @brief Append one timestamped sample
+ * @param log Log state
+ * @param sensor Application-defined sensor id
+ * @param scale Unit of the value, SENSORLOG_SCALE_...
+ * @param channel Channel of the sensor, 0 if it has one
+ * @param value Sample as an integer count of the scale unit
+ * @return HAL_StatusTypeDef HAL_OK, HAL_BUSY if the sample was dropped
+ * @details The sink is called from here when the sample fills the block.
+ */
+HAL_StatusTypeDef SensorLog_Write(SensorLog_t *log, uint8_t sensor, uint8_t scale, uint8_t channel, int32_t value)
+{
+    SensorLog_Record_t record = {SENSORLOG_NOW(), value, sensor, scale, channel, 0};
+    uint16_t count;
+    uint32_t seq;
+    int sealed = -1;
+
+    SENSORLOG_LOCK();
+    if (log->busy[log->active]) {
+        log->dropped++;
+        SENSORLOG_UNLOCK();
+        return HAL_BUSY;
+    }
+    memcpy((uint8_t *)log->block[log->active] + SENSORLOG_HEADER_LEN + (uint32_t)log->count * SENSORLOG_RECORD_LEN,
+           &record, SENSORLOG_RECORD_LEN);
+    log->written++;
+    if (++log->count == SENSORLOG_RECORDS_PER_BLOCK) {
+        sealed = SensorLog_Seal(log, &count, &seq);
+    }
+    SENSORLOG_UNLOCK();
+
+    if (sealed >= 0) {
+        SensorLog_Emit(log, (uint8_t)sealed, count, seq);
+    }
+    return HAL_OK;
+}
+
+/**
+ * @brief Hand the partly filled block to the sink
+ * @param log Log state
+ * @return HAL_StatusTypeDef HAL_OK, also when there was nothing to flush
+ * @details Use before power-down or on a timer so samples do not wait for a full
+ * block. The block is still SENSORLOG_BLOCK_SIZE bytes with a zero tail.
+ */
+HAL_StatusTypeDef SensorLog_Flush(SensorLog_t *log)
+{
+    uint16_t count;
+    uint32_t seq;
+    uint8_t sealed;
+
+    SENSORLOG_LOCK();
+    if (log->count == 0 || log->busy[log->active]) {
+        SENSORLOG_UNLOCK();
+        return HAL_OK;
+    }
+    sealed = SensorLog_Seal(log, &count, &seq);
+    SENSORLOG_UNLOCK();
+
+    SensorLog_Emit(log, sealed, count, seq);
+    return HAL_OK;
+}
+
+/**
+ * @brief Return the oldest block handed to the sink
+ * @param log Log state
+ * @details Call from the transfer-complete callback. Blocks are released in the
+ * order they were handed out.
+ */
+void SensorLog_Release(SensorLog_t *log)
+{
+    SENSORLOG_LOCK();
+    if (log->busy[log->oldest]) {
+        log->busy[log->oldest] = 0;
+        log->oldest ^= 1;
+    }
+    SENSORLOG_UNLOCK();
+}
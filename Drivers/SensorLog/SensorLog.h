@@ -0,0 +1,114 @@
+#ifndef SENSOR_LOG_H
+#define SENSOR_LOG_H
+#include "main.h"
+
+/*------------------- Configuration ---------------------------*/
+#ifndef SENSORLOG_BLOCK_SIZE
+#define SENSORLOG_BLOCK_SIZE 512 // Bytes per block, one SD sector by default
+#endif
+
+// Record timestamp and its frequency. Override both together, e.g. with a
+// free-running timer for sub-millisecond timestamps.
+#ifndef SENSORLOG_NOW
+#define SENSORLOG_NOW() HAL_GetTick()
+#define SENSORLOG_TICK_HZ 1000u
+#endif
+
+/************************ Format Defines ********************************/
+// Block, little-endian, SENSORLOG_BLOCK_SIZE bytes:
+//   0  "SLOG"
+//   4  u8  version
+//   5  u8  record size
+//   6  u16 records in this block
+//   8  u32 block sequence number, starts at 0
+//   12 u32 timestamp ticks per second
+//   16 u32 block size in bytes
+//   20 records, the unused tail is zero
+// Record, 12 bytes:
+//   0  u32 timestamp
+//   4  s32 value, integer in the unit given by the scale tag
+//   8  u8  sensor id, chosen by the application
+//   9  u8  scale tag (SENSORLOG_SCALE_...)
+//   10 u8  channel, e.g. the ADS1115 input
+//   11 u8  reserved, 0
+#define SENSORLOG_MAGIC "SLOG"
+#define SENSORLOG_VERSION 1
+#define SENSORLOG_HEADER_LEN 20
+#define SENSORLOG_RECORD_LEN 12
+#define SENSORLOG_RECORDS_PER_BLOCK ((SENSORLOG_BLOCK_SIZE - SENSORLOG_HEADER_LEN) / SENSORLOG_RECORD_LEN)
+
+// Scale tags: what one count of the value is
+#define SENSORLOG_SCALE_RAW            0  // Counts, no unit
+#define SENSORLOG_SCALE_ADS1115_6V144  1  // 187.5 uV (ADS1115 PGA +/-6.144 V)
+#define SENSORLOG_SCALE_ADS1115_4V096  2  // 125 uV
+#define SENSORLOG_SCALE_ADS1115_2V048  3  // 62.5 uV
+#define SENSORLOG_SCALE_ADS1115_1V024  4  // 31.25 uV
+#define SENSORLOG_SCALE_ADS1115_0V512  5  // 15.625 uV
+#define SENSORLOG_SCALE_ADS1115_0V256  6  // 7.8125 uV
+#define SENSORLOG_SCALE_CENTI_DEGC     7  // 0.01 degC
+#define SENSORLOG_SCALE_PA_Q8          8  // 1/256 Pa
+#define SENSORLOG_SCALE_CENTI_RH       9  // 0.01 %RH
+#define SENSORLOG_SCALE_QUARTER_DEGC   10 // 0.25 degC
+#define SENSORLOG_SCALE_RTC_SECONDS    11 // Seconds since 2000-01-01 00:00:00 of the RTC, value read as u32
+#define SENSORLOG_SCALE_COUNT          12
+
+#if SENSORLOG_RECORDS_PER_BLOCK < 1 || SENSORLOG_RECORDS_PER_BLOCK > 0xFFFF || (SENSORLOG_BLOCK_SIZE % 4) != 0
+#error "SENSORLOG_BLOCK_SIZE must be a multiple of 4 holding 1 to 65535 records"
+#endif
+
+/************************ Log Structs ********************************/
+typedef struct {
+    uint32_t timestamp;
+    int32_t value;
+    uint8_t sensor;
+    uint8_t scale;
+    uint8_t channel;
+    uint8_t reserved;
+} SensorLog_Record_t;
+
+/**
+ * @brief Called with every full (or flushed) block
+ * @details Runs in the context of the SensorLog_Write() that filled the block,
+ * possibly an interrupt. Start the transfer (UART/SPI DMA, SD write) and call
+ * SensorLog_Release() when the block may be reused.
+ */
+typedef void (*SensorLog_Sink_t)(void *ctx, const uint8_t *block, uint32_t len);
+
+typedef struct {
+    uint32_t block[2][SENSORLOG_BLOCK_SIZE / 4]; // Word-aligned for DMA
+    SensorLog_Sink_t sink;
+    void *ctx;
+    uint32_t seq;       // Sequence number of the next block handed to the sink
+    uint32_t written;   // Records accepted
+    uint32_t dropped;   // Records lost because both blocks were waiting for the sink
+    uint16_t count;     // Records in the active block
+    uint8_t active;     // Block being filled
+    uint8_t oldest;     // Block the next SensorLog_Release() frees
+    uint8_t busy[2];    // Handed to the sink, not yet released
+} SensorLog_t;
+
+typedef struct {
+    const uint8_t *buf;
+    uint32_t len;
+    uint32_t pos;       // Offset of the current block
+    uint32_t blockSize; // Size of the current block, 0 before the first
+    uint16_t index;     // Next record in the current block
+    uint16_t count;     // Records in the current block
+    uint32_t tickHz;
+    uint32_t seq;       // Sequence number of the current block
+    uint32_t blocks;    // Valid blocks read
+    uint32_t lostBlocks; // Gaps in the sequence numbers
+    uint32_t badBlocks; // Runs of bytes skipped to find the next header
+} SensorLog_Reader_t;
+
+/*------------------- Function Prototypes ---------------------------*/
+HAL_StatusTypeDef SensorLog_Init(SensorLog_t *log, SensorLog_Sink_t sink, void *ctx);
+HAL_StatusTypeDef SensorLog_Write(SensorLog_t *log, uint8_t sensor, uint8_t scale, uint8_t channel, int32_t value);
+HAL_StatusTypeDef SensorLog_Flush(SensorLog_t *log);
+void SensorLog_Release(SensorLog_t *log);
+HAL_StatusTypeDef SensorLog_ReaderInit(SensorLog_Reader_t *reader, const uint8_t *buf, uint32_t len);
+HAL_StatusTypeDef SensorLog_Next(SensorLog_Reader_t *reader, SensorLog_Record_t *record);
+double SensorLog_Scale(uint8_t scale);
+const char *SensorLog_Unit(uint8_t scale);
+
+#endif
@@ -0,0 +1,135 @@
+#include "SensorLog.h"
+#include <string.h>
+
+/**
+ ******************************************************************************
+ * @file    SensorLogReader.c
+ * @author  Yair Yamin
+ * @brief   Decoder for SensorLog blocks.
+ * @details Portable C, decodes byte by byte and builds on any host. Blocks are
+ * located by their header, so a log that lost blocks or has garbage between
+ * them (a torn SD write, a UART capture started mid-block) still decodes:
+ * unreadable bytes are skipped up to the next valid header and gaps in the
+ * block sequence are counted.
+ ******************************************************************************
+ */
+
+/* ========================== Static Helpers ============================ */
+
+static uint32_t SensorLog_GetU32(const uint8_t *p)
+{
+    return (uint32_t)p[0] | ((uint32_t)p[1] << 8) | ((uint32_t)p[2] << 16) | ((uint32_t)p[3] << 24);
+}
+
+/**
+ * @brief Find the first valid block header at or after reader->pos
+ * @return uint8_t 1 if a block was opened
+ */
+static uint8_t SensorLog_OpenBlock(SensorLog_Reader_t *reader)
+{
+    uint8_t skipping = 0;
+
+    while (reader->pos + SENSORLOG_HEADER_LEN <= reader->len) {
+        const uint8_t *p = &reader->buf[reader->pos];
+        uint32_t size = SensorLog_GetU32(&p[16]);
+        uint16_t count = (uint16_t)(p[6] | (p[7] << 8));
+
+        if (memcmp(p, SENSORLOG_MAGIC, 4) == 0 && p[4] == SENSORLOG_VERSION && p[5] == SENSORLOG_RECORD_LEN &&
+            size >= SENSORLOG_HEADER_LEN && (size - SENSORLOG_HEADER_LEN) / SENSORLOG_RECORD_LEN >= count) {
+            uint32_t seq = SensorLog_GetU32(&p[8]);
+            uint32_t available = (reader->len - reader->pos - SENSORLOG_HEADER_LEN) / SENSORLOG_RECORD_LEN;
+
+            if (reader->blocks != 0 && seq != 0 && seq != reader->seq + 1) {
+                reader->lostBlocks += seq - reader->seq - 1; // A sequence restarting at 0 is a new session
+            }
+            reader->seq = seq;
+            reader->tickHz = SensorLog_GetU32(&p[12]);
+            reader->blockSize = size;
+            reader->count = (available < count) ? (uint16_t)available : count; // Last block may be cut off
+            reader->index = 0;
+            reader->blocks++;
+            return 1;
+        }
+        if (!skipping) {
+            reader->badBlocks++;
+            skipping = 1;
+        }
+        reader->pos++; // A capture may start at any byte
+    }
+    return 0;
+}
+
+ /* ========================== Function Definitions ============================ */
+
+/**
+ * @brief Start decoding a log
+ * @param reader Reader state
+ * @param buf Concatenated blocks as received from the sink
+ * @param len Length of buf
+ * @return HAL_StatusTypeDef HAL_OK, HAL_ERROR if buf holds no valid block
+ */
+HAL_StatusTypeDef SensorLog_ReaderInit(SensorLog_Reader_t *reader, const uint8_t *buf, uint32_t len)
+{
+    memset(reader, 0, sizeof(*reader));
+    reader->buf = buf;
+    reader->len = len;
+    return SensorLog_OpenBlock(reader) ? HAL_OK : HAL_ERROR;
+}
+
+/**
+ * @brief Decode the next record
+ * @param reader Reader state
+ * @param record Decoded record, timestamp in reader->tickHz ticks
+ * @return HAL_StatusTypeDef HAL_OK, HAL_ERROR at the end of the log
+ */
+HAL_StatusTypeDef SensorLog_Next(SensorLog_Reader_t *reader, SensorLog_Record_t *record)
+{
+    while (reader->index >= reader->count) {
+        if (reader->blockSize == 0) {
+            return HAL_ERROR;
+        }
+        reader->pos += reader->blockSize;
+        reader->blockSize = 0;
+        if (!SensorLog_OpenBlock(reader)) {
+            return HAL_ERROR;
+        }
+    }
+
+    const uint8_t *p = &reader->buf[reader->pos + SENSORLOG_HEADER_LEN + (uint32_t)reader->index * SENSORLOG_RECORD_LEN];
+    record->timestamp = SensorLog_GetU32(&p[0]);
+    record->value = (int32_t)SensorLog_GetU32(&p[4]);
+    record->sensor = p[8];
+    record->scale = p[9];
+    record->channel = p[10];
+    record->reserved = p[11];
+    reader->index++;
+    return HAL_OK;
+}
+
+/**
+ * @brief Size of one count of a scale tag in its unit
+ * @param scale SENSORLOG_SCALE_...
+ * @return double Multiplier, 1 for unknown tags
+ * @details For SENSORLOG_SCALE_RTC_SECONDS convert the value as uint32_t first.
+ */
+double SensorLog_Scale(uint8_t scale)
+{
+    static const double scales[SENSORLOG_SCALE_COUNT] = {
+        1.0, 187.5e-6, 125e-6, 62.5e-6, 31.25e-6, 15.625e-6, 7.8125e-6,
+        0.01, 1.0 / 256.0, 0.01, 0.25, 1.0,
+    };
+    return (scale < SENSORLOG_SCALE_COUNT) ? scales[scale] : 1.0;
+}
+
+/**
+ * @brief Unit of a scale tag
+ * @param scale SENSORLOG_SCALE_...
+ * @return const char* Unit, "" for raw counts and unknown tags
+ */
+const char *SensorLog_Unit(uint8_t scale)
+{
+    static const char *const units[SENSORLOG_SCALE_COUNT] = {
+        "", "V", "V", "V", "V", "V", "V", "degC", "Pa", "%RH", "degC", "s",
+    };
+    return (scale < SENSORLOG_SCALE_COUNT) ? units[scale] : "";
+}
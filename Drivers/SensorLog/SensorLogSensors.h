@@ -0,0 +1,82 @@
+#ifndef SENSOR_LOG_SENSORS_H
+#define SENSOR_LOG_SENSORS_H
+#include "SensorLog.h"
+#include "ADS1115.h"
+#include "BME280.h"
+#include "DS3231.h"
+
+// Log the last readings held in the driver handles. Each helper only reads the
+// handle, call it right after the driver function that fetched the reading.
+
+/**
+ * @brief Log the conversion read by ADS1115_ReadConversionReg()
+ * @details The scale tag follows the PGA in the configuration mirror. The
+ * value is corrected when a calibration table is set, see ADS1115_GetSample().
+ */
+static inline HAL_StatusTypeDef SensorLog_ADS1115(SensorLog_t *log, uint8_t sensor, const ADS1115_Handle_t *hads1115)
+{
+    uint8_t pga = (uint8_t)((ADS1115_REG_VALUE(hads1115, ADS1115_REG_CONFIG) >> 9) & 0x07);
+
+    if (pga > 5) {
+        pga = 5; // Codes 6 and 7 are +/-0.256 V as well
+    }
+    return SensorLog_Write(log, sensor, (uint8_t)(SENSORLOG_SCALE_ADS1115_6V144 + pga), (uint8_t)hads1115->channel,
+                           ADS1115_GetSample(hads1115));
+}
+
+#ifndef BME280_COMPACT_HANDLE
+static inline int32_t SensorLog_Round(float value)
+{
+    return (int32_t)(value < 0.0f ? value - 0.5f : value + 0.5f);
+}
+#endif
+
+/**
+ * @brief Log temperature, pressure and humidity of the last BME280 readings
+ * @return HAL_StatusTypeDef HAL_OK, or the status of the first record that failed
+ * @details Three records on channels 0, 1 and 2. With the compact handle the
+ * fixed-point readings are logged as they are.
+ */
+static inline HAL_StatusTypeDef SensorLog_BME280(SensorLog_t *log, uint8_t sensor, const BME280_Handle_t *hbme280)
+{
+    HAL_StatusTypeDef status;
+#ifdef BME280_COMPACT_HANDLE
+    int32_t temperature = hbme280->temperature;
+    int32_t pressure = (int32_t)hbme280->pressure;
+    int32_t humidity = hbme280->humidity;
+#else
+    int32_t temperature = SensorLog_Round(hbme280->temperature * 100.0f);
+    int32_t pressure = SensorLog_Round(hbme280->pressure * 256.0f);
+    int32_t humidity = SensorLog_Round(hbme280->humidity * 100.0f);
+#endif
+
+    status = SensorLog_Write(log, sensor, SENSORLOG_SCALE_CENTI_DEGC, 0, temperature);
+    if (status != HAL_OK) return status;
+    status = SensorLog_Write(log, sensor, SENSORLOG_SCALE_PA_Q8, 1, pressure);
+    if (status != HAL_OK) return status;
+    return SensorLog_Write(log, sensor, SENSORLOG_SCALE_CENTI_RH, 2, humidity);
+}
+
+/**
+ * @brief Log the RTC time read by DS3231_GetTime()/DS3231_GetDate()
+ * @details Pairs the log timestamp with calendar time, seconds since 2000-01-01.
+ */
+static inline HAL_StatusTypeDef SensorLog_DS3231(SensorLog_t *log, uint8_t sensor, const DS3231_Handle_t *hrtc)
+{
+    return SensorLog_Write(log, sensor, SENSORLOG_SCALE_RTC_SECONDS, 0, (int32_t)DS3231_ToSeconds(&hrtc->date, &hrtc->time));
+}
+
+/**
+ * @brief Log the DS3231 temperature read by DS3231_GetTemp()
+ */
+static inline HAL_StatusTypeDef SensorLog_DS3231Temp(SensorLog_t *log, uint8_t sensor, const DS3231_Handle_t *hrtc)
+{
+#ifdef DS3231_COMPACT_HANDLE
+    int32_t temp = hrtc->temp;
+#else
+    int32_t temp = (int32_t)(hrtc->temp * 4.0f); // Exact, the chip reports 0.25 degC steps
+#endif
+    return SensorLog_Write(log, sensor, SENSORLOG_SCALE_QUARTER_DEGC, 1, temp);
+}
+
+#endif
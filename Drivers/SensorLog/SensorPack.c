@@ -0,0 +1,273 @@
+#include "SensorPack.h"
+#include <string.h>
+
+/**
+ ******************************************************************************
+ * @file    SensorPack.c
+ * @author  Yair Yamin
+ * @brief   Streaming compressor for the samples of one sensor channel.
+ * @details Environmental readings change little between samples and are taken
+ * at a fixed rate, so the encoder stores the first sample of a block as is and
+ * every following one as the change of its value and the change of its
+ * sampling interval. Groups of 8 such changes are zigzag coded and bit-packed
+ * at the width of the largest one: a steady 1 Hz temperature costs a few bits
+ * per sample instead of 8 bytes.
+ *
+ * - RAM is one block plus one group per stream, nothing is allocated.
+ * - Every block starts from an absolute sample (a resync point) and carries a
+ *   checksum, a lost or damaged block does not affect the others.
+ * - Not interrupt safe: call SensorPack_Add() for a stream from one context.
+ ******************************************************************************
+ */
+
+/* ========================== Static Helpers ============================ */
+
+static void SensorPack_PutU16(uint8_t *p, uint16_t value)
+{
+    p[0] = (uint8_t)value;
+    p[1] = (uint8_t)(value >> 8);
+}
+
+static void SensorPack_PutU32(uint8_t *p, uint32_t value)
+{
+    p[0] = (uint8_t)value;
+    p[1] = (uint8_t)(value >> 8);
+    p[2] = (uint8_t)(value >> 16);
+    p[3] = (uint8_t)(value >> 24);
+}
+
+static uint32_t SensorPack_ZigZag(uint32_t delta)
+{
+    return (delta << 1) ^ (0u - (delta >> 31));
+}
+
+/**
+ * @brief Smallest width code that holds max
+ */
+static uint8_t SensorPack_WidthCode(uint32_t max)
+{
+    static const uint8_t widths[16] = SENSORPACK_WIDTHS;
+    uint8_t bits = 0;
+    uint8_t code = 0;
+
+    while (bits < 32 && (max >> bits) != 0) {
+        bits++;
+    }
+    while (widths[code] < bits) {
+        code++;
+    }
+    return code;
+}
+
+/**
+ * @brief Fletcher-16 over the block payload
+ */
+static uint16_t SensorPack_Checksum(const uint8_t *data, uint32_t len)
+{
+    uint32_t sum1 = 0;
+    uint32_t sum2 = 0;
+
+    while (len != 0) {
+        uint32_t chunk = (len < 5802u) ? len : 5802u; // Largest run before the sums overflow
+        len -= chunk;
+        while (chunk-- != 0) {
+            sum1 += *data++;
+            sum2 += sum1;
+        }
+        sum1 %= 255u;
+        sum2 %= 255u;
+    }
+    return (uint16_t)((sum2 << 8) | sum1);
+}
+
+static void SensorPack_Start(SensorPack_t *pack, uint32_t timestamp, int32_t value)
+{
+    pack->block[0] = SENSORPACK_MARKER;
+    pack->block[1] = SENSORPACK_VERSION;
+    pack->block[2] = pack->sensor;
+    pack->block[3] = pack->scale;
+    pack->block[4] = pack->channel;
+    pack->block[5] = 0;
+    SensorPack_PutU32(&pack->block[12], timestamp);
+    SensorPack_PutU32(&pack->block[16], (uint32_t)value);
+    pack->len = SENSORPACK_HEADER_LEN;
+    pack->count = 1;
+    pack->pending = 0;
+    pack->baseTime = timestamp;
+    pack->baseValue = value;
+    pack->baseInterval = 0;
+}
+
+/**
+ * @brief Hand the block, pending group excluded, to the sink
+ */
+static void SensorPack_Emit(SensorPack_t *pack)
+{
+    uint16_t count = (uint16_t)(pack->count - pack->pending);
+
+    SensorPack_PutU16(&pack->block[6], count);
+    SensorPack_PutU16(&pack->block[8], pack->len);
+    SensorPack_PutU16(&pack->block[10], SensorPack_Checksum(&pack->block[SENSORPACK_HEADER_LEN],
+                                                            (uint32_t)pack->len - SENSORPACK_HEADER_LEN));
+    pack->sink(pack->ctx, pack->block, pack->len);
+    pack->bytes += pack->len;
+    pack->count = 0;
+}
+
+/**
+ * @brief Bit-pack the pending samples relative to the base sample
+ * @return uint16_t Length of the packed group
+ */
+static uint16_t SensorPack_PackGroup(const SensorPack_t *pack, uint8_t *out)
+{
+    static const uint8_t widths[16] = SENSORPACK_WIDTHS;
+    uint32_t timeCodes[SENSORPACK_GROUP];
+    uint32_t valueCodes[SENSORPACK_GROUP];
+    uint32_t maxTime = 0;
+    uint32_t maxValue = 0;
+    uint32_t prevTime = pack->baseTime;
+    uint32_t prevInterval = pack->baseInterval;
+    uint32_t prevValue = (uint32_t)pack->baseValue;
+    uint8_t n = pack->pending;
+
+    for (uint8_t i = 0; i < n; i++) {
+        uint32_t interval = pack->times[i] - prevTime;
+        timeCodes[i] = SensorPack_ZigZag(interval - prevInterval);
+        valueCodes[i] = SensorPack_ZigZag((uint32_t)pack->values[i] - prevValue);
+        maxTime |= timeCodes[i];
+        maxValue |= valueCodes[i];
+        prevTime = pack->times[i];
+        prevInterval = interval;
+        prevValue = (uint32_t)pack->values[i];
+    }
+
+    uint8_t timeCode = SensorPack_WidthCode(maxTime);
+    uint8_t valueCode = SensorPack_WidthCode(maxValue);
+    uint8_t timeWidth = widths[timeCode];
+    uint8_t valueWidth = widths[valueCode];
+    uint64_t acc = 0;
+    uint8_t accBits = 0;
+    uint16_t len = 0;
+
+    out[len++] = (uint8_t)(timeCode | (valueCode << 4));
+    for (uint8_t i = 0; i < 2 * n; i++) {
+        uint32_t code = (i < n) ? timeCodes[i] : valueCodes[i - n];
+        uint8_t width = (i < n) ? timeWidth : valueWidth;
+        acc |= (uint64_t)code << accBits;
+        accBits += width;
+        while (accBits >= 8) {
+            out[len++] = (uint8_t)acc;
+            acc >>= 8;
+            accBits -= 8;
+        }
+    }
+    if (accBits != 0) {
+        out[len++] = (uint8_t)acc;
+    }
+    return len;
+}
+
+/**
+ * @brief Move the pending group into the block, starting a new block if it does not fit
+ */
+static void SensorPack_Commit(SensorPack_t *pack)
+{
+    uint8_t group[SENSORPACK_MAX_GROUP_LEN];
+    uint16_t len = SensorPack_PackGroup(pack, group);
+    uint8_t n = pack->pending;
+
+    if (pack->len + len <= SENSORPACK_BLOCK_SIZE) {
+        memcpy(&pack->block[pack->len], group, len);
+        pack->len = (uint16_t)(pack->len + len);
+        pack->baseInterval = pack->times[n - 1] - (n > 1 ? pack->times[n - 2] : pack->baseTime);
+        pack->baseTime = pack->times[n - 1];
+        pack->baseValue = pack->values[n - 1];
+        pack->pending = 0;
+        return;
+    }
+
+    // The group becomes the start of the next block: its first sample is the
+    // new resync point, the rest waits for the next group.
+    uint32_t times[SENSORPACK_GROUP];
+    int32_t values[SENSORPACK_GROUP];
+    memcpy(times, pack->times, n * sizeof(times[0]));
+    memcpy(values, pack->values, n * sizeof(values[0]));
+    SensorPack_Emit(pack);
+    SensorPack_Start(pack, times[0], values[0]);
+    for (uint8_t i = 1; i < n; i++) {
+        pack->times[pack->pending] = times[i];
+        pack->values[pack->pending] = values[i];
+        pack->pending++;
+        pack->count++;
+    }
+}
+
+ /* ========================== Function Definitions ============================ */
+
+/**
+ * @brief Initialize the encoder of one stream
+ * @param pack Encoder state, holds the block buffer
+ * @param sensor Sensor id stored in every block
+ * @param scale Unit of the values, SENSORLOG_SCALE_...
+ * @param channel Channel stored in every block
+ * @param sink Called with each finished block
+ * @param ctx Passed to the sink
+ * @return HAL_StatusTypeDef HAL_OK, HAL_ERROR without a sink
+ */
+HAL_StatusTypeDef SensorPack_Init(SensorPack_t *pack, uint8_t sensor, uint8_t scale, uint8_t channel,
+                                  SensorPack_Sink_t sink, void *ctx)
+{
+    if (sink == NULL) {
+        return HAL_ERROR;
+    }
+    memset(pack, 0, sizeof(*pack));
+    pack->sink = sink;
+    pack->ctx = ctx;
+    pack->sensor = sensor;
+    pack->scale = scale;
+    pack->channel = channel;
+    return HAL_OK;
+}
+
+/**
+ * @brief Add one sample to the stream
+ * @param pack Encoder state
+ * @param timestamp Sample time, any tick rate, may wrap
+ * @param value Sample value
+ * @details Every 8th sample packs a group; the sink is called from here when
+ * the group does not fit into the block.
+ */
+void SensorPack_Add(SensorPack_t *pack, uint32_t timestamp, int32_t value)
+{
+    pack->samples++;
+    if (pack->count == 0) {
+        SensorPack_Start(pack, timestamp, value);
+        return;
+    }
+    pack->times[pack->pending] = timestamp;
+    pack->values[pack->pending] = value;
+    pack->pending++;
+    pack->count++;
+    if (pack->pending == SENSORPACK_GROUP) {
+        SensorPack_Commit(pack);
+    }
+    if (pack->count == 0xFFFF) {
+        SensorPack_Flush(pack); // Sample count limit of large blocks
+    }
+}
+
+/**
+ * @brief Finish the current block and hand it to the sink
+ * @param pack Encoder state
+ * @details Call before power-down or on a timer. The next sample starts a new
+ * block; flushing often costs a header per block.
+ */
+void SensorPack_Flush(SensorPack_t *pack)
+{
+    while (pack->pending != 0) {
+        SensorPack_Commit(pack); // Twice at most, a fresh block holds any group
+    }
+    if (pack->count != 0) {
+        SensorPack_Emit(pack);
+    }
+}
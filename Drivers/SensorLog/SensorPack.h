@@ -0,0 +1,82 @@
+#ifndef SENSOR_PACK_H
+#define SENSOR_PACK_H
+#include "SensorLog.h"
+
+/*------------------- Configuration ---------------------------*/
+#ifndef SENSORPACK_BLOCK_SIZE
+#define SENSORPACK_BLOCK_SIZE 256 // Largest block in bytes, the encoder buffers one per stream
+#endif
+
+/************************ Format Defines ********************************/
+// One block per resync point, little-endian, decodable on its own:
+//   0  u8  'P'
+//   1  u8  version
+//   2  u8  sensor id
+//   3  u8  scale tag (SENSORLOG_SCALE_...)
+//   4  u8  channel
+//   5  u8  reserved, 0
+//   6  u16 samples in the block
+//   8  u16 block length in bytes, header included
+//   10 u16 Fletcher-16 of the bytes after the header
+//   12 u32 timestamp of the first sample
+//   16 s32 value of the first sample
+//   20 groups of up to 8 following samples:
+//      u8 width codes, bits 0-3 timestamps, bits 4-7 values (SENSORPACK_WIDTHS)
+//      timestamp codes, then value codes, each n x width bits, LSB first,
+//      padded to a byte. Timestamp code: zigzag of the change of the sampling
+//      interval. Value code: zigzag of the change of the value. Both wrap at 32 bits.
+#define SENSORPACK_MARKER 'P'
+#define SENSORPACK_VERSION 1
+#define SENSORPACK_HEADER_LEN 20
+#define SENSORPACK_GROUP 8
+#define SENSORPACK_MAX_GROUP_LEN (1 + 2 * SENSORPACK_GROUP * 32 / 8)
+#define SENSORPACK_WIDTHS {0, 1, 2, 3, 4, 5, 6, 7, 8, 10, 12, 14, 16, 20, 24, 32}
+
+#if SENSORPACK_BLOCK_SIZE < SENSORPACK_HEADER_LEN + SENSORPACK_MAX_GROUP_LEN || SENSORPACK_BLOCK_SIZE > 0xFFFF
+#error "SENSORPACK_BLOCK_SIZE must hold the header and one full group and fit 16 bits"
+#endif
+
+/************************ Codec Structs ********************************/
+/**
+ * @brief Called with every finished block
+ * @details The block is reused when the call returns, copy or write it out.
+ */
+typedef void (*SensorPack_Sink_t)(void *ctx, const uint8_t *block, uint32_t len);
+
+typedef struct {
+    uint8_t block[SENSORPACK_BLOCK_SIZE];
+    SensorPack_Sink_t sink;
+    void *ctx;
+    uint16_t len;       // Bytes of the block in use
+    uint16_t count;     // Samples in the block, pending group included
+    uint8_t sensor;
+    uint8_t scale;
+    uint8_t channel;
+    uint8_t pending;    // Samples waiting in the group
+    uint32_t baseTime;  // Last sample before the pending group
+    int32_t baseValue;
+    uint32_t baseInterval;
+    uint32_t times[SENSORPACK_GROUP];
+    int32_t values[SENSORPACK_GROUP];
+    uint32_t samples;   // Samples accepted
+    uint32_t bytes;     // Bytes handed to the sink
+} SensorPack_t;
+
+typedef struct {
+    uint8_t sensor;
+    uint8_t scale;
+    uint8_t channel;
+    uint16_t count;
+    uint16_t len;
+} SensorPack_Block_t;
+
+/*------------------- Function Prototypes ---------------------------*/
+HAL_StatusTypeDef SensorPack_Init(SensorPack_t *pack, uint8_t sensor, uint8_t scale, uint8_t channel,
+                                  SensorPack_Sink_t sink, void *ctx);
+void SensorPack_Add(SensorPack_t *pack, uint32_t timestamp, int32_t value);
+void SensorPack_Flush(SensorPack_t *pack);
+HAL_StatusTypeDef SensorPack_Header(const uint8_t *buf, uint32_t len, SensorPack_Block_t *block);
+int32_t SensorPack_Decode(const uint8_t *buf, uint32_t len, uint32_t *timestamps, int32_t *values, uint32_t max);
+uint32_t SensorPack_Find(const uint8_t *buf, uint32_t len, uint32_t pos, SensorPack_Block_t *block);
+
+#endif
@@ -0,0 +1,183 @@
+#include "SensorPack.h"
+
+/**
+ ******************************************************************************
+ * @file    SensorPackReader.c
+ * @author  Yair Yamin
+ * @brief   Decoder for SensorPack blocks.
+ * @details Decodes a block in two passes over the output arrays: the first
+ * unpacks the bit fields of all groups, the second undoes the zigzag coding
+ * and then accumulates the changes. The zigzag pass has no dependency between
+ * samples so the compiler vectorizes it, and the bit unpacking handles a
+ * whole group with one width, leaving only the running sums sequential.
+ ******************************************************************************
+ */
+
+/* ========================== Static Helpers ============================ */
+
+static uint16_t SensorPack_GetU16(const uint8_t *p)
+{
+    return (uint16_t)(p[0] | (p[1] << 8));
+}
+
+static uint32_t SensorPack_GetU32(const uint8_t *p)
+{
+    return (uint32_t)p[0] | ((uint32_t)p[1] << 8) | ((uint32_t)p[2] << 16) | ((uint32_t)p[3] << 24);
+}
+
+static uint16_t SensorPack_Fletcher(const uint8_t *data, uint32_t len)
+{
+    uint32_t sum1 = 0;
+    uint32_t sum2 = 0;
+
+    while (len != 0) {
+        uint32_t chunk = (len < 5802u) ? len : 5802u; // Largest run before the sums overflow
+        len -= chunk;
+        while (chunk-- != 0) {
+            sum1 += *data++;
+            sum2 += sum1;
+        }
+        sum1 %= 255u;
+        sum2 %= 255u;
+    }
+    return (uint16_t)((sum2 << 8) | sum1);
+}
+
+/**
+ * @brief Unpack n fields of one width
+ * @return uint32_t Bit position after the fields
+ */
+static uint32_t SensorPack_Unpack(const uint8_t *data, uint32_t bitPos, uint8_t width, uint32_t *out, uint8_t n)
+{
+    if (width == 0) {
+        for (uint8_t i = 0; i < n; i++) {
+            out[i] = 0;
+        }
+        return bitPos;
+    }
+    uint64_t mask = (width == 32) ? 0xFFFFFFFFu : ((1u << width) - 1u);
+    for (uint8_t i = 0; i < n; i++) {
+        const uint8_t *p = &data[bitPos >> 3];
+        uint32_t shift = bitPos & 7u;
+        uint32_t bytes = (shift + width + 7u) >> 3; // At most 5
+        uint64_t acc = 0;
+        for (uint32_t b = 0; b < bytes; b++) {
+            acc |= (uint64_t)p[b] << (8 * b);
+        }
+        out[i] = (uint32_t)((acc >> shift) & mask);
+        bitPos += width;
+    }
+    return bitPos;
+}
+
+ /* ========================== Function Definitions ============================ */
+
+/**
+ * @brief Validate a block header and checksum
+ * @param buf Start of the block
+ * @param len Bytes available at buf
+ * @param block Header fields, may be NULL
+ * @return HAL_StatusTypeDef HAL_OK for a complete, intact block
+ */
+HAL_StatusTypeDef SensorPack_Header(const uint8_t *buf, uint32_t len, SensorPack_Block_t *block)
+{
+    if (len < SENSORPACK_HEADER_LEN || buf[0] != SENSORPACK_MARKER || buf[1] != SENSORPACK_VERSION) {
+        return HAL_ERROR;
+    }
+    uint16_t count = SensorPack_GetU16(&buf[6]);
+    uint16_t blockLen = SensorPack_GetU16(&buf[8]);
+    if (count == 0 || blockLen < SENSORPACK_HEADER_LEN || blockLen > len ||
+        SensorPack_Fletcher(&buf[SENSORPACK_HEADER_LEN], blockLen - SENSORPACK_HEADER_LEN) != SensorPack_GetU16(&buf[10])) {
+        return HAL_ERROR;
+    }
+    if (block != NULL) {
+        block->sensor = buf[2];
+        block->scale = buf[3];
+        block->channel = buf[4];
+        block->count = count;
+        block->len = blockLen;
+    }
+    return HAL_OK;
+}
+
+/**
+ * @brief Decode all samples of a block
+ * @param buf Start of the block
+ * @param len Bytes available at buf
+ * @param timestamps Decoded timestamps
+ * @param values Decoded values
+ * @param max Capacity of both arrays
+ * @return int32_t Number of samples, -1 if the block is invalid or larger than max
+ */
+int32_t SensorPack_Decode(const uint8_t *buf, uint32_t len, uint32_t *timestamps, int32_t *values, uint32_t max)
+{
+    static const uint8_t widths[16] = SENSORPACK_WIDTHS;
+    SensorPack_Block_t block;
+    uint32_t *valueCodes = (uint32_t *)values;
+
+    if (SensorPack_Header(buf, len, &block) != HAL_OK || block.count > max) {
+        return -1;
+    }
+
+    // Pass 1: bit fields of every group
+    const uint8_t *data = &buf[SENSORPACK_HEADER_LEN];
+    uint32_t payload = block.len - SENSORPACK_HEADER_LEN;
+    uint32_t pos = 0;
+    for (uint32_t i = 1; i < block.count; i += SENSORPACK_GROUP) {
+        uint8_t n = (uint8_t)((block.count - i < SENSORPACK_GROUP) ? block.count - i : SENSORPACK_GROUP);
+        if (pos >= payload) {
+            return -1;
+        }
+        uint8_t timeWidth = widths[data[pos] & 0x0F];
+        uint8_t valueWidth = widths[data[pos] >> 4];
+        uint32_t groupLen = 1u + (n * (uint32_t)(timeWidth + valueWidth) + 7u) / 8u;
+        if (pos + groupLen > payload) {
+            return -1;
+        }
+        uint32_t bitPos = SensorPack_Unpack(&data[pos + 1], 0, timeWidth, &timestamps[i], n);
+        SensorPack_Unpack(&data[pos + 1], bitPos, valueWidth, &valueCodes[i], n);
+        pos += groupLen;
+    }
+    if (pos != payload) {
+        return -1;
+    }
+
+    // Pass 2: undo zigzag, independent per sample
+    for (uint32_t i = 1; i < block.count; i++) {
+        timestamps[i] = (timestamps[i] >> 1) ^ (0u - (timestamps[i] & 1u));
+        valueCodes[i] = (valueCodes[i] >> 1) ^ (0u - (valueCodes[i] & 1u));
+    }
+
+    // Pass 3: running sums from the resync sample
+    uint32_t time = SensorPack_GetU32(&buf[12]);
+    uint32_t value = SensorPack_GetU32(&buf[16]);
+    uint32_t interval = 0;
+    timestamps[0] = time;
+    valueCodes[0] = value;
+    for (uint32_t i = 1; i < block.count; i++) {
+        interval += timestamps[i];
+        time += interval;
+        value += valueCodes[i];
+        timestamps[i] = time;
+        valueCodes[i] = value;
+    }
+    return block.count;
+}
+
+/**
+ * @brief Find the next intact block
+ * @param buf Concatenated blocks, possibly with damaged or foreign bytes between them
+ * @param len Length of buf
+ * @param pos Offset to search from, e.g. the end of the previous block
+ * @param block Header fields of the block found
+ * @return uint32_t Offset of the block, len if there is none
+ */
+uint32_t SensorPack_Find(const uint8_t *buf, uint32_t len, uint32_t pos, SensorPack_Block_t *block)
+{
+    for (; pos + SENSORPACK_HEADER_LEN <= len; pos++) {
+        if (buf[pos] == SENSORPACK_MARKER && SensorPack_Header(&buf[pos], len - pos, block) == HAL_OK) {
+            return pos;
+        }
+    }
+    return len;
+}
@@ -0,0 +1,301 @@
+#define _POSIX_C_SOURCE 200809L
+#include "SnapBench.h"
+#include <pthread.h>
+#include <sched.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+/**
+ ******************************************************************************
+ * @file    SnapBench.c
+ * @author  Yair Yamin
+ * @brief   Concurrent stress of SensorSnap with POSIX threads.
+ * @details One writer thread publishes as fast as it can while
+ * SNAP_BENCH_READERS reader threads copy the latest reading, for
+ * SNAP_BENCH_MS of wall time per store. Every publish is derived from its
+ * index, so a reader can tell a consistent copy from a torn one and check
+ * that the version it got names the publish the data came from:
+ *
+ * - bme280: the writer fills a BME280 handle and calls
+ *   SensorSnap_PublishBME280(), as the DMA completion callback would.
+ * - record: four derived words through SensorSnap_Publish(), the whole
+ *   SENSORSNAP_MAX_BYTES.
+ * - unprotected: the same four words stored and loaded one by one, the way
+ *   consumers read the handle fields today. Reported, not checked: how often
+ *   it tears depends on the cores and the scheduler.
+ * - stalled: a publish cut off half way, as by a reader interrupt above the
+ *   writer's priority, must give HAL_BUSY and leave the reading alone.
+ ******************************************************************************
+ */
+
+/* ========================== Defines ============================ */
+#define SNAP_BENCH_BME_MASK 0x3FFFu // Keeps the derived fields exact in every handle layout
+#define SNAP_BENCH_MIX 2654435761u
+
+/************************ Bench Context ********************************/
+typedef struct {
+    const char *store;
+    SensorSnap_t snap;
+    BME280_Handle_t bme;
+    volatile uint32_t plain[4];
+    uint32_t stop;
+    uint32_t publishes;
+} SnapBench_Ctx_t;
+
+typedef struct {
+    SnapBench_Ctx_t *ctx;
+    pthread_t thread;
+    SnapBench_Result_t counts;
+} SnapBench_Reader_t;
+
+/* ========================== Static Helpers ============================ */
+
+static void SnapBench_Derive(uint32_t k, uint32_t words[4])
+{
+    words[0] = k;
+    words[1] = ~k;
+    words[2] = k * SNAP_BENCH_MIX;
+    words[3] = k ^ 0x5A5A5A5Au;
+}
+
+static uint8_t SnapBench_Consistent(const uint32_t words[4])
+{
+    uint32_t expected[4];
+
+    SnapBench_Derive(words[0], expected);
+    return memcmp(words, expected, sizeof(expected)) == 0;
+}
+
+static void SnapBench_Publish(SnapBench_Ctx_t *ctx, uint32_t k)
+{
+    uint32_t words[4];
+
+    if (strcmp(ctx->store, "bme280") == 0) {
+        uint32_t t = k & SNAP_BENCH_BME_MASK;
+        ctx->bme.temperature = t;
+        ctx->bme.pressure = 4 * t;
+        ctx->bme.humidity = 2 * t;
+        SensorSnap_PublishBME280(&ctx->snap, &ctx->bme);
+        return;
+    }
+    SnapBench_Derive(k, words);
+    if (strcmp(ctx->store, "record") == 0) {
+        SensorSnap_Publish(&ctx->snap, words, sizeof(words));
+        return;
+    }
+    for (uint8_t i = 0; i < 4; i++) {
+        ctx->plain[i] = words[i];
+    }
+}
+
+static void *SnapBench_Writer(void *arg)
+{
+    SnapBench_Ctx_t *ctx = (SnapBench_Ctx_t *)arg;
+    uint32_t k = 0;
+
+    while (!__atomic_load_n(&ctx->stop, __ATOMIC_ACQUIRE)) {
+        SnapBench_Publish(ctx, ++k);
+    }
+    ctx->publishes = k;
+    return NULL;
+}
+
+// One read; the version and the data it names, 0 if nothing was copied
+static uint32_t SnapBench_ReadOnce(SnapBench_Ctx_t *ctx, SnapBench_Result_t *counts)
+{
+    uint32_t words[4];
+    uint32_t version = 0;
+    HAL_StatusTypeDef status;
+
+    counts->reads++;
+    if (strcmp(ctx->store, "unprotected") == 0) {
+        for (uint8_t i = 0; i < 4; i++) {
+            words[i] = ctx->plain[i];
+        }
+        if (words[0] == 0) {
+            return 0;
+        }
+        counts->ok++;
+        counts->torn += !SnapBench_Consistent(words);
+        return words[0];
+    }
+    if (strcmp(ctx->store, "bme280") == 0) {
+        SensorSnap_BME280_t reading;
+        status = SensorSnap_ReadBME280(&ctx->snap, &reading, &version);
+        if (status == HAL_OK) {
+            uint32_t t = (uint32_t)reading.temperature;
+            counts->ok++;
+            if ((uint32_t)reading.pressure != 4 * t || (uint32_t)reading.humidity != 2 * t) {
+                counts->torn++;
+            } else if (t != (version & SNAP_BENCH_BME_MASK)) {
+                counts->mismatched++;
+            }
+        }
+    } else {
+        status = SensorSnap_Read(&ctx->snap, words, sizeof(words), &version);
+        if (status == HAL_OK) {
+            counts->ok++;
+            if (!SnapBench_Consistent(words)) {
+                counts->torn++;
+            } else if (words[0] != version) {
+                counts->mismatched++;
+            }
+        }
+    }
+    if (status == HAL_BUSY) {
+        counts->busy++;
+        sched_yield(); // Let the writer finish, as a thread reader would
+    }
+    return (status == HAL_OK) ? version : 0;
+}
+
+static void *SnapBench_Reader(void *arg)
+{
+    SnapBench_Reader_t *reader = (SnapBench_Reader_t *)arg;
+    uint32_t last = 0;
+
+    while (!__atomic_load_n(&reader->ctx->stop, __ATOMIC_ACQUIRE)) {
+        uint32_t version = SnapBench_ReadOnce(reader->ctx, &reader->counts);
+        if (version != 0) {
+            reader->counts.backwards += (version < last);
+            last = (version > last) ? version : last;
+        }
+    }
+    return NULL;
+}
+
+ /* ========================== Function Definitions ============================ */
+
+/**
+ * @brief Stress one store with a writer and SNAP_BENCH_READERS readers
+ * @param store "bme280", "record" or "unprotected"
+ * @param ms Wall time
+ * @param result Filled in
+ */
+void SnapBench_Run(const char *store, uint32_t ms, SnapBench_Result_t *result)
+{
+    static SnapBench_Ctx_t ctx;
+    static SnapBench_Reader_t readers[SNAP_BENCH_READERS];
+    struct timespec wait = { (time_t)(ms / 1000u), (long)(ms % 1000u) * 1000000L };
+    pthread_t writer;
+
+    memset(&ctx, 0, sizeof(ctx));
+    memset(readers, 0, sizeof(readers));
+    memset(result, 0, sizeof(*result));
+    ctx.store = store;
+    SensorSnap_Init(&ctx.snap);
+
+    for (uint8_t i = 0; i < SNAP_BENCH_READERS; i++) {
+        readers[i].ctx = &ctx;
+        pthread_create(&readers[i].thread, NULL, SnapBench_Reader, &readers[i]);
+    }
+    pthread_create(&writer, NULL, SnapBench_Writer, &ctx);
+    nanosleep(&wait, NULL);
+    __atomic_store_n(&ctx.stop, 1, __ATOMIC_RELEASE);
+    pthread_join(writer, NULL);
+
+    result->store = store;
+    result->publishes = ctx.publishes;
+    for (uint8_t i = 0; i < SNAP_BENCH_READERS; i++) {
+        const SnapBench_Result_t *counts = &readers[i].counts;
+        pthread_join(readers[i].thread, NULL);
+        result->reads += counts->reads;
+        result->ok += counts->ok;
+        result->busy += counts->busy;
+        result->torn += counts->torn;
+        result->backwards += counts->backwards;
+        result->mismatched += counts->mismatched;
+    }
+}
+
+/**
+ * @brief Read an empty snapshot and one whose writer stopped half way
+ * @param result Filled in: 3 reads, the empty one counted as mismatched
+ *        unless HAL_ERROR, the stalled one busy, the finished one ok
+ */
+void SnapBench_Stalled(SnapBench_Result_t *result)
+{
+    static SensorSnap_t snap;
+    uint32_t words[4];
+    uint32_t reading[4];
+    uint32_t version = 0;
+
+    memset(result, 0, sizeof(*result));
+    result->store = "stalled";
+    SensorSnap_Init(&snap);
+    result->reads++;
+    result->mismatched += (SensorSnap_Read(&snap, reading, sizeof(reading), &version) != HAL_ERROR);
+
+    SnapBench_Derive(1, words);
+    SensorSnap_Publish(&snap, words, sizeof(words));
+    result->publishes++;
+
+    // Second publish interrupted after its first word, as SensorSnap_Publish() leaves it
+    SnapBench_Derive(2, words);
+    snap.seq++;
+    snap.words[0] = words[0];
+    memset(reading, 0, sizeof(reading));
+    result->reads++;
+    if (SensorSnap_Read(&snap, reading, sizeof(reading), &version) == HAL_BUSY) {
+        result->busy++;
+        result->torn += (reading[0] != 0); // Written although no copy was returned
+    }
+
+    // The writer resumes and finishes
+    memcpy(snap.words, words, sizeof(words));
+    snap.seq++;
+    result->publishes++;
+    result->reads++;
+    if (SensorSnap_Read(&snap, reading, sizeof(reading), &version) == HAL_OK) {
+        result->ok++;
+        result->torn += !SnapBench_Consistent(reading);
+        result->mismatched += (reading[0] != version || version != 2);
+    }
+}
+
+/**
+ * @brief Write the results as CSV
+ */
+void SnapBench_WriteCsv(FILE *out, const SnapBench_Result_t *results, uint8_t count)
+{
+    fprintf(out, "store,publishes,reads,ok,busy,torn,backwards,mismatched\n");
+    for (uint8_t i = 0; i < count; i++) {
+        const SnapBench_Result_t *r = &results[i];
+        fprintf(out, "%s,%u,%llu,%llu,%llu,%llu,%llu,%llu\n", r->store, r->publishes, (unsigned long long)r->reads,
+                (unsigned long long)r->ok, (unsigned long long)r->busy, (unsigned long long)r->torn,
+                (unsigned long long)r->backwards, (unsigned long long)r->mismatched);
+    }
+}
+
+/**
+ * @brief Bench entry point: SnapBench [ms]
+ * @return int 0 if no snapshot read tore, went back or named the wrong
+ *         publish, 1 otherwise, 2 on bad arguments
+ */
+int SnapBench_Main(int argc, char **argv)
+{
+    static SnapBench_Result_t results[4];
+    uint32_t ms = SNAP_BENCH_MS;
+    int failed = 0;
+
+    if (argc > 2 || (argc == 2 && (ms = (uint32_t)strtoul(argv[1], NULL, 10)) == 0)) {
+        fprintf(stderr, "usage: %s [ms]\n", argv[0]);
+        return 2;
+    }
+    SnapBench_Run("bme280", ms, &results[0]);
+    SnapBench_Run("record", ms, &results[1]);
+    SnapBench_Run("unprotected", ms, &results[2]);
+    SnapBench_Stalled(&results[3]);
+    SnapBench_WriteCsv(stdout, results, 4);
+
+    for (uint8_t i = 0; i < 4; i++) {
+        const SnapBench_Result_t *r = &results[i];
+        if (strcmp(r->store, "unprotected") == 0) {
+            continue;
+        }
+        failed |= (r->publishes == 0 || r->ok == 0 || r->torn != 0 || r->backwards != 0 || r->mismatched != 0);
+    }
+    failed |= (results[3].busy != 1 || results[3].ok != 1);
+    return failed;
+}
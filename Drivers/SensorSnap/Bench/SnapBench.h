@@ -0,0 +1,28 @@
+#ifndef SNAP_BENCH_H
+#define SNAP_BENCH_H
+#include "SensorSnapSensors.h"
+#include <stdio.h>
+
+/*------------------- Configuration ---------------------------*/
+#define SNAP_BENCH_READERS 3
+#define SNAP_BENCH_MS 500 // Wall time of each stress run
+
+/************************ Bench Structs ********************************/
+typedef struct {
+    const char *store;      // "bme280", "record", "unprotected" or "stalled"
+    uint32_t publishes;
+    uint64_t reads;         // Calls by all the readers
+    uint64_t ok;            // Copies returned
+    uint64_t busy;          // HAL_BUSY, every try overlapped a publish
+    uint64_t torn;          // Copies mixing two publishes
+    uint64_t backwards;     // Copies older than one the same reader had
+    uint64_t mismatched;    // Copies whose data is not the publish their version names
+} SnapBench_Result_t;
+
+/*------------------- Function Prototypes ---------------------------*/
+void SnapBench_Run(const char *store, uint32_t ms, SnapBench_Result_t *result);
+void SnapBench_Stalled(SnapBench_Result_t *result);
+void SnapBench_WriteCsv(FILE *out, const SnapBench_Result_t *results, uint8_t count);
+int SnapBench_Main(int argc, char **argv);
+
+#endif
@@ -0,0 +1,123 @@
+#include "SensorSnap.h"
+#include <string.h>
+
+/**
+ ******************************************************************************
+ * @file    SensorSnap.c
+ * @author  Yair Yamin
+ * @brief   Latest-value snapshots of sensor readings behind a sequence lock.
+ * @details Readers that look at the driver handles directly, e.g.
+ * hbme280->temperature and hbme280->humidity, can get fields of two different
+ * samples when a DMA callback or an interrupt updates the handle between
+ * their loads. Here the writer publishes the whole reading into a snapshot
+ * and readers take a copy that is known to belong to one publish:
+ *
+ * - Publish makes the sequence number odd, stores the words, then makes it
+ *   even again: a fixed number of stores, no loop on the readers, so it is
+ *   wait-free and safe from an interrupt.
+ * - Read copies the words between two loads of the sequence number and keeps
+ *   the copy only if both are the same even value. A publish in between makes
+ *   it copy again, at most SENSORSNAP_READ_TRIES times.
+ * - No locks and no interrupt masking on either side; every shared word is
+ *   accessed atomically, with fences ordering the words against the sequence
+ *   number (GCC/Clang __atomic builtins, a DMB on Cortex-M7).
+ *
+ * The interrupt that publishes never waits for a reader. A reader that runs
+ * above the writer's priority and interrupts a publish cannot let it finish,
+ * so it gets HAL_BUSY instead of spinning; thread readers retry at once.
+ ******************************************************************************
+ */
+
+ /* ========================== Function Definitions ============================ */
+
+/**
+ * @brief Clear a snapshot, reads fail until the first publish
+ * @param snap Snapshot
+ */
+void SensorSnap_Init(SensorSnap_t *snap)
+{
+    memset(snap, 0, sizeof(*snap));
+}
+
+/**
+ * @brief Replace the reading, from the snapshot's one writer
+ * @param snap Snapshot
+ * @param reading Complete reading, e.g. a SensorSnap_BME280_t
+ * @param size Its size in bytes, at most SENSORSNAP_MAX_BYTES
+ * @return HAL_StatusTypeDef HAL_OK, HAL_ERROR if it does not fit
+ * @details Wait-free: callable from interrupts and DMA completion callbacks.
+ *          Two contexts must not publish to the same snapshot.
+ */
+HAL_StatusTypeDef SensorSnap_Publish(SensorSnap_t *snap, const void *reading, uint16_t size)
+{
+    const uint8_t *src = (const uint8_t *)reading;
+    uint32_t seq;
+
+    if (size > SENSORSNAP_MAX_BYTES) {
+        return HAL_ERROR;
+    }
+    seq = __atomic_load_n(&snap->seq, __ATOMIC_RELAXED); // Only this writer changes it
+    __atomic_store_n(&snap->seq, seq + 1, __ATOMIC_RELAXED);
+    // Readers that see any of the new words see the odd sequence number too
+    __atomic_thread_fence(__ATOMIC_RELEASE);
+    for (uint16_t offset = 0; offset < size; offset += 4) {
+        uint32_t word = 0;
+        memcpy(&word, src + offset, (size - offset < 4) ? (size_t)(size - offset) : 4u);
+        __atomic_store_n(&snap->words[offset / 4], word, __ATOMIC_RELAXED);
+    }
+    __atomic_store_n(&snap->seq, seq + 2, __ATOMIC_RELEASE);
+    return HAL_OK;
+}
+
+/**
+ * @brief Copy the latest reading
+ * @param snap Snapshot
+ * @param reading Receives a reading from one publish, never a mix of two
+ * @param size Bytes to copy, the size it was published with
+ * @param version Receives the number of publishes up to this reading, may be
+ *        NULL; unchanged between two reads means no new data
+ * @return HAL_StatusTypeDef HAL_OK, HAL_ERROR if nothing was published yet or
+ *         size is too large, HAL_BUSY if every try overlapped a publish
+ * @details Lock-free; reading is only written on success.
+ */
+HAL_StatusTypeDef SensorSnap_Read(const SensorSnap_t *snap, void *reading, uint16_t size, uint32_t *version)
+{
+    uint32_t words[SENSORSNAP_WORDS];
+    uint16_t count = (uint16_t)((size + 3u) / 4u);
+
+    if (size > SENSORSNAP_MAX_BYTES) {
+        return HAL_ERROR;
+    }
+    for (uint8_t attempt = 0; attempt < SENSORSNAP_READ_TRIES; attempt++) {
+        uint32_t seq = __atomic_load_n(&snap->seq, __ATOMIC_ACQUIRE);
+        if (seq & 1u) {
+            continue; // Publish in progress
+        }
+        for (uint16_t i = 0; i < count; i++) {
+            words[i] = __atomic_load_n(&snap->words[i], __ATOMIC_RELAXED);
+        }
+        __atomic_thread_fence(__ATOMIC_ACQUIRE);
+        if (__atomic_load_n(&snap->seq, __ATOMIC_RELAXED) != seq) {
+            continue; // Published again while copying
+        }
+        if (seq == 0) {
+            return HAL_ERROR;
+        }
+        memcpy(reading, words, size);
+        if (version != NULL) {
+            *version = seq / 2;
+        }
+        return HAL_OK;
+    }
+    return HAL_BUSY;
+}
+
+/**
+ * @brief Number of completed publishes
+ * @param snap Snapshot
+ * @return uint32_t Count, compare with the version of the last read to see if there is new data
+ */
+uint32_t SensorSnap_Version(const SensorSnap_t *snap)
+{
+    return __atomic_load_n(&snap->seq, __ATOMIC_ACQUIRE) / 2;
+}
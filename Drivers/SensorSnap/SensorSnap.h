@@ -0,0 +1,30 @@
+#ifndef SENSOR_SNAP_H
+#define SENSOR_SNAP_H
+#include "main.h"
+
+/*------------------- Configuration ---------------------------*/
+#ifndef SENSORSNAP_MAX_BYTES
+#define SENSORSNAP_MAX_BYTES 16 // Largest reading a snapshot holds, the BME280 one by default
+#endif
+#ifndef SENSORSNAP_READ_TRIES
+#define SENSORSNAP_READ_TRIES 8 // Copies a read attempts before giving up on a busy writer
+#endif
+
+#define SENSORSNAP_WORDS ((SENSORSNAP_MAX_BYTES + 3) / 4)
+
+/************************ Snapshot Structs ********************************/
+// Latest complete reading of one sensor. One writer per snapshot (an ISR, a
+// DMA callback or a task), any number of readers. The words are only
+// accessed through SensorSnap_Publish() and SensorSnap_Read().
+typedef struct {
+    uint32_t seq;                     // Odd while a publish is in progress; publishes = seq / 2
+    uint32_t words[SENSORSNAP_WORDS]; // Reading, copied a word at a time
+} SensorSnap_t;
+
+/*------------------- Function Prototypes ---------------------------*/
+void SensorSnap_Init(SensorSnap_t *snap);
+HAL_StatusTypeDef SensorSnap_Publish(SensorSnap_t *snap, const void *reading, uint16_t size);
+HAL_StatusTypeDef SensorSnap_Read(const SensorSnap_t *snap, void *reading, uint16_t size, uint32_t *version);
+uint32_t SensorSnap_Version(const SensorSnap_t *snap);
+
+#endif
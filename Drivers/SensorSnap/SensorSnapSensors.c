@@ -0,0 +1,99 @@
+#include "SensorSnapSensors.h"
+#include <string.h>
+
+/**
+ ******************************************************************************
+ * @file    SensorSnapSensors.c
+ * @author  Yair Yamin
+ * @brief   Snapshot readings of the ADS1115, BME280 and DS3231 handles.
+ * @details Call the publish function in the same context that updated the
+ * handle, right after the update: the DMA completion callback that parsed a
+ * BME280 burst, the BusShard onSample hook, or the task after a blocking
+ * read. Consumers read the snapshot instead of the handle fields.
+ ******************************************************************************
+ */
+
+/* ========================== Defines ============================ */
+_Static_assert(sizeof(SensorSnap_ADS1115_t) <= SENSORSNAP_MAX_BYTES, "SENSORSNAP_MAX_BYTES too small for the ADS1115 reading");
+_Static_assert(sizeof(SensorSnap_BME280_t) <= SENSORSNAP_MAX_BYTES, "SENSORSNAP_MAX_BYTES too small for the BME280 reading");
+_Static_assert(sizeof(SensorSnap_DS3231_t) <= SENSORSNAP_MAX_BYTES, "SENSORSNAP_MAX_BYTES too small for the DS3231 reading");
+
+ /* ========================== Function Definitions ============================ */
+
+/**
+ * @brief Publish the last conversion of an ADS1115
+ * @param snap Snapshot of this device
+ * @param hads1115 Handle with the conversion register loaded
+ * @return HAL_StatusTypeDef HAL_OK
+ */
+HAL_StatusTypeDef SensorSnap_PublishADS1115(SensorSnap_t *snap, const ADS1115_Handle_t *hads1115)
+{
+    SensorSnap_ADS1115_t reading;
+
+    memset(&reading, 0, sizeof(reading));
+    reading.tick = SENSORSNAP_NOW();
+    reading.raw = (int16_t)ADS1115_REG_VALUE(hads1115, ADS1115_REG_CONVERSION);
+    reading.sample = ADS1115_GetSample(hads1115);
+    reading.channel = (uint8_t)hads1115->channel;
+    return SensorSnap_Publish(snap, &reading, sizeof(reading));
+}
+
+/**
+ * @brief Publish temperature, pressure and humidity of one BME280 measurement
+ * @param snap Snapshot of this device
+ * @param hbme280 Handle after BME280_GetAll() or BME280_ParseMeasurement()
+ * @return HAL_StatusTypeDef HAL_OK
+ */
+HAL_StatusTypeDef SensorSnap_PublishBME280(SensorSnap_t *snap, const BME280_Handle_t *hbme280)
+{
+    SensorSnap_BME280_t reading;
+
+    memset(&reading, 0, sizeof(reading));
+    reading.tick = SENSORSNAP_NOW();
+    reading.temperature = hbme280->temperature;
+    reading.pressure = hbme280->pressure;
+    reading.humidity = hbme280->humidity;
+    return SensorSnap_Publish(snap, &reading, sizeof(reading));
+}
+
+/**
+ * @brief Publish the time, date and day of a DS3231
+ * @param snap Snapshot of this device
+ * @param hrtc Handle after DS3231_GetTime() and DS3231_GetDate(), or a burst read
+ * @return HAL_StatusTypeDef HAL_OK
+ */
+HAL_StatusTypeDef SensorSnap_PublishDS3231(SensorSnap_t *snap, const DS3231_Handle_t *hrtc)
+{
+    SensorSnap_DS3231_t reading;
+
+    memset(&reading, 0, sizeof(reading));
+    reading.tick = SENSORSNAP_NOW();
+    reading.time = hrtc->time;
+    reading.date = hrtc->date;
+    reading.dayOfWeek = (uint8_t)hrtc->dayOfWeek;
+    return SensorSnap_Publish(snap, &reading, sizeof(reading));
+}
+
+/**
+ * @brief Latest ADS1115 reading, see SensorSnap_Read()
+ */
+HAL_StatusTypeDef SensorSnap_ReadADS1115(const SensorSnap_t *snap, SensorSnap_ADS1115_t *reading, uint32_t *version)
+{
+    return SensorSnap_Read(snap, reading, sizeof(*reading), version);
+}
+
+/**
+ * @brief Latest BME280 reading, see SensorSnap_Read()
+ */
+HAL_StatusTypeDef SensorSnap_ReadBME280(const SensorSnap_t *snap, SensorSnap_BME280_t *reading, uint32_t *version)
+{
+    return SensorSnap_Read(snap, reading, sizeof(*reading), version);
+}
+
+/**
+ * @brief Latest DS3231 reading, see SensorSnap_Read()
+ */
+HAL_StatusTypeDef SensorSnap_ReadDS3231(const SensorSnap_t *snap, SensorSnap_DS3231_t *reading, uint32_t *version)
+{
+    return SensorSnap_Read(snap, reading, sizeof(*reading), version);
+}
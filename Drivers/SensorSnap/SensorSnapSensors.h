@@ -0,0 +1,49 @@
+#ifndef SENSOR_SNAP_SENSORS_H
+#define SENSOR_SNAP_SENSORS_H
+#include "SensorSnap.h"
+#include "ADS1115.h"
+#include "BME280.h"
+#include "DS3231.h"
+
+/*------------------- Configuration ---------------------------*/
+#ifndef SENSORSNAP_NOW
+#define SENSORSNAP_NOW() HAL_GetTick() // Timestamp of a published reading
+#endif
+
+/************************ Reading Structs ********************************/
+typedef struct {
+    uint32_t tick;       // SENSORSNAP_NOW() at publish
+    int16_t raw;         // Conversion register
+    int16_t sample;      // Calibrated, ADS1115_GetSample()
+    uint8_t channel;     // sChannel_t the conversion was started on
+} SensorSnap_ADS1115_t;
+
+typedef struct {
+    uint32_t tick;
+#ifdef BME280_COMPACT_HANDLE
+    uint32_t pressure;   // 1/256 Pa
+    int16_t temperature; // 0.01 degC
+    uint16_t humidity;   // 0.01 %RH
+#else
+    float temperature;
+    float pressure;
+    float humidity;
+#endif
+} SensorSnap_BME280_t;
+
+typedef struct {
+    uint32_t tick;
+    ds3231_time_t time;
+    ds3231_data_t date;
+    uint8_t dayOfWeek;   // DOW_t
+} SensorSnap_DS3231_t;
+
+/*------------------- Function Prototypes ---------------------------*/
+HAL_StatusTypeDef SensorSnap_PublishADS1115(SensorSnap_t *snap, const ADS1115_Handle_t *hads1115);
+HAL_StatusTypeDef SensorSnap_PublishBME280(SensorSnap_t *snap, const BME280_Handle_t *hbme280);
+HAL_StatusTypeDef SensorSnap_PublishDS3231(SensorSnap_t *snap, const DS3231_Handle_t *hrtc);
+HAL_StatusTypeDef SensorSnap_ReadADS1115(const SensorSnap_t *snap, SensorSnap_ADS1115_t *reading, uint32_t *version);
+HAL_StatusTypeDef SensorSnap_ReadBME280(const SensorSnap_t *snap, SensorSnap_BME280_t *reading, uint32_t *version);
+HAL_StatusTypeDef SensorSnap_ReadDS3231(const SensorSnap_t *snap, SensorSnap_DS3231_t *reading, uint32_t *version);
+
+#endif
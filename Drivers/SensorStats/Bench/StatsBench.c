@@ -0,0 +1,450 @@
+#define _POSIX_C_SOURCE 200809L // clock_gettime
+#include "StatsBench.h"
+#include <math.h>
+#include <string.h>
+#include <time.h>
+
+/**
+ ******************************************************************************
+ * @file    StatsBench.c
+ * @author  Yair Yamin
+ * @brief   Accuracy and speed of SensorStats against window rescans.
+ * @details Every trace runs through three ways of getting per-window min,
+ * max, mean and variance, with tumbling windows and with a sliding window
+ * advancing by one pane:
+ *
+ * - sensorstats: SensorStats_Add() per sample, panes merged at pane ends.
+ * - rescan_float: the samples kept in a float ring and rescanned, two-pass,
+ *   at every window end; what the application code did.
+ * - running_sums_float: a float sum and sum of squares updated per sample,
+ *   the textbook O(1) shortcut. It has no O(1) min and max.
+ *
+ * Every window is compared with a two-pass double reference over the same
+ * samples. Three more rows check SensorStats over a whole trace: the total of
+ * a channel without windows, its moving average against a double one, and
+ * the trace split into uneven chunks whose accumulators are merged.
+ * The traces are generated with a fixed seed; the offset stress trace sits at
+ * 2^30 with a variance below 1.
+ ******************************************************************************
+ */
+
+/* ========================== Defines ============================ */
+#define STATS_BENCH_PI 3.14159265358979323846
+#define STATS_BENCH_PANE (STATS_BENCH_WINDOW / STATS_BENCH_PANES)
+#define STATS_BENCH_MAX_WINDOWS (STATS_BENCH_SAMPLES / STATS_BENCH_PANE + 1)
+#define STATS_BENCH_MEAN_TOL 1e-4 // Mean error, fraction of the window's range plus one count
+#define STATS_BENCH_VAR_TOL  1e-3 // Variance error, fraction of the variance plus 1e-3 counts^2
+#define STATS_BENCH_EMA_ALPHA (1.0 / 64.0)
+
+#if (STATS_BENCH_WINDOW % STATS_BENCH_PANES) != 0 || STATS_BENCH_PANES > SENSORSTATS_MAX_PANES
+#error "STATS_BENCH_WINDOW must split into STATS_BENCH_PANES panes, at most SENSORSTATS_MAX_PANES"
+#endif
+
+/************************ Bench Context ********************************/
+typedef struct {
+    uint32_t end;   // Index after the window's last sample
+    double mean;
+    double var;
+    int32_t min;
+    int32_t max;
+} StatsBench_Window_t;
+
+/* ========================== Global Variables ============================ */
+static int32_t benchValues[STATS_BENCH_SAMPLES];
+static float ringFloat[STATS_BENCH_WINDOW];
+static StatsBench_Window_t windows[STATS_BENCH_MAX_WINDOWS];
+static uint32_t windowCount;
+static uint32_t sampleIndex;
+static uint32_t seed;
+
+/* ========================== Static Helpers ============================ */
+
+static uint64_t StatsBench_CpuNs(void)
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_PROCESS_CPUTIME_ID, &ts);
+    return (uint64_t)ts.tv_sec * 1000000000u + (uint64_t)ts.tv_nsec;
+}
+
+/**
+ * @brief Uniform noise in [-amplitude, amplitude], fixed sequence
+ */
+static int32_t StatsBench_Noise(int32_t amplitude)
+{
+    seed = seed * 1664525u + 1013904223u;
+    return (int32_t)((seed >> 8) % (uint32_t)(2 * amplitude + 1)) - amplitude;
+}
+
+static double StatsBench_Wave(uint32_t i, double period, double phase)
+{
+    return sin(2.0 * STATS_BENCH_PI * (double)i / period + phase);
+}
+
+/**
+ * @brief Two-pass double statistics of values[first..end)
+ */
+static void StatsBench_Reference(const int32_t *values, uint32_t first, uint32_t end, StatsBench_Window_t *ref)
+{
+    double sum = 0.0, sq = 0.0;
+
+    ref->end = end;
+    ref->min = ref->max = values[first];
+    for (uint32_t i = first; i < end; i++) {
+        sum += values[i];
+        if (values[i] < ref->min) ref->min = values[i];
+        if (values[i] > ref->max) ref->max = values[i];
+    }
+    ref->mean = sum / (double)(end - first);
+    for (uint32_t i = first; i < end; i++) {
+        double d = values[i] - ref->mean;
+        sq += d * d;
+    }
+    ref->var = (end - first > 1) ? sq / (double)(end - first - 1) : 0.0;
+}
+
+/**
+ * @brief Fold the error of one window into the result
+ * @return int 1 if within the tolerances
+ */
+static int StatsBench_Compare(const StatsBench_Window_t *w, const StatsBench_Window_t *ref, StatsBench_Result_t *r)
+{
+    double meanErr = fabs(w->mean - ref->mean);
+    double varErr = fabs(w->var - ref->var);
+    double varRelErr = varErr / (ref->var > 0.0 ? ref->var : 1.0);
+
+    if (meanErr > r->maxMeanErr) r->maxMeanErr = meanErr;
+    if (varRelErr > r->maxVarRelErr) r->maxVarRelErr = varRelErr;
+    if (w->min != ref->min || w->max != ref->max) r->extremesOk = 0;
+    return meanErr <= STATS_BENCH_MEAN_TOL * ((double)ref->max - ref->min + 1.0) &&
+           varErr <= STATS_BENCH_VAR_TOL * ref->var + 1e-3;
+}
+
+/**
+ * @brief Compare the recorded windows with the reference
+ * @param step Samples between window ends
+ */
+static void StatsBench_Check(const int32_t *values, uint32_t count, uint32_t step, StatsBench_Result_t *r)
+{
+    uint32_t expected = (count >= STATS_BENCH_WINDOW) ? (count - STATS_BENCH_WINDOW) / step + 1 : 0;
+    StatsBench_Window_t ref;
+
+    r->windows = windowCount;
+    r->extremesOk = 1;
+    r->pass = (windowCount == expected);
+    for (uint32_t i = 0; i < windowCount; i++) {
+        StatsBench_Reference(values, windows[i].end - STATS_BENCH_WINDOW, windows[i].end, &ref);
+        r->pass &= (windows[i].end == STATS_BENCH_WINDOW + i * step);
+        r->pass &= StatsBench_Compare(&windows[i], &ref, r);
+    }
+    r->pass &= r->extremesOk;
+}
+
+static void StatsBench_Record(const SensorStats_Acc_t *acc, uint32_t end)
+{
+    if (windowCount < STATS_BENCH_MAX_WINDOWS) {
+        StatsBench_Window_t *w = &windows[windowCount++];
+        w->end = end;
+        w->mean = (double)acc->offset + (double)acc->mean; // The accumulator's precision, not that of SensorStats_Mean()
+        w->var = (double)SensorStats_Variance(acc);
+        w->min = acc->min;
+        w->max = acc->max;
+    }
+}
+
+static void StatsBench_OnWindow(SensorStats_t *st, const SensorStats_Acc_t *window)
+{
+    (void)st;
+    StatsBench_Record(window, sampleIndex + 1);
+}
+
+static void StatsBench_Init(StatsBench_Result_t *r, const char *trace, const char *window, const char *method, uint32_t count)
+{
+    memset(r, 0, sizeof(*r));
+    snprintf(r->trace, sizeof(r->trace), "%s", trace);
+    r->window = window;
+    r->method = method;
+    r->samples = count;
+}
+
+/**
+ * @brief SensorStats with panes of STATS_BENCH_WINDOW / panes samples
+ */
+static void StatsBench_SensorStats(const int32_t *values, uint32_t count, uint8_t panes, StatsBench_Result_t *r)
+{
+    static SensorStats_t st;
+    SensorStats_Config_t config = {STATS_BENCH_WINDOW / panes, panes, 0, StatsBench_OnWindow, NULL};
+
+    windowCount = 0;
+    SensorStats_Init(&st, &config);
+    uint64_t start = StatsBench_CpuNs();
+    for (sampleIndex = 0; sampleIndex < count; sampleIndex++) {
+        SensorStats_Add(&st, values[sampleIndex]);
+    }
+    r->cpuNs = StatsBench_CpuNs() - start;
+    r->stateBytes = (uint32_t)(sizeof(st) - sizeof(st.panes) + panes * sizeof(st.panes[0]));
+    StatsBench_Check(values, count, STATS_BENCH_WINDOW / panes, r);
+}
+
+/**
+ * @brief Float ring rescanned at every window end, mean first, then variance
+ */
+static void StatsBench_Rescan(const int32_t *values, uint32_t count, uint32_t step, StatsBench_Result_t *r)
+{
+    windowCount = 0;
+    uint64_t start = StatsBench_CpuNs();
+    for (uint32_t i = 0; i < count; i++) {
+        ringFloat[i % STATS_BENCH_WINDOW] = (float)values[i];
+        if (i + 1 < STATS_BENCH_WINDOW || (i + 1 - STATS_BENCH_WINDOW) % step != 0) {
+            continue;
+        }
+        float sum = 0.0f, sq = 0.0f, lo = ringFloat[0], hi = ringFloat[0];
+        for (uint32_t k = 0; k < STATS_BENCH_WINDOW; k++) {
+            sum += ringFloat[k];
+            if (ringFloat[k] < lo) lo = ringFloat[k];
+            if (ringFloat[k] > hi) hi = ringFloat[k];
+        }
+        float mean = sum / (float)STATS_BENCH_WINDOW;
+        for (uint32_t k = 0; k < STATS_BENCH_WINDOW; k++) {
+            float d = ringFloat[k] - mean;
+            sq += d * d;
+        }
+        if (windowCount < STATS_BENCH_MAX_WINDOWS) {
+            windows[windowCount++] = (StatsBench_Window_t){i + 1, mean, sq / (float)(STATS_BENCH_WINDOW - 1),
+                                                           (int32_t)lroundf(lo), (int32_t)lroundf(hi)};
+        }
+    }
+    r->cpuNs = StatsBench_CpuNs() - start;
+    r->stateBytes = sizeof(ringFloat);
+    StatsBench_Check(values, count, step, r);
+}
+
+/**
+ * @brief Float sum and sum of squares, the leaving sample subtracted
+ * @details Keeps the samples as integers so that subtraction is exact; the
+ *          error is the cancellation of sumSq - sum^2 / n alone.
+ */
+static void StatsBench_RunningSums(const int32_t *values, uint32_t count, uint32_t step, StatsBench_Result_t *r)
+{
+    float sum = 0.0f, sumSq = 0.0f;
+
+    windowCount = 0;
+    uint64_t start = StatsBench_CpuNs();
+    for (uint32_t i = 0; i < count; i++) {
+        float x = (float)values[i];
+        sum += x;
+        sumSq += x * x;
+        if (i >= STATS_BENCH_WINDOW) {
+            float old = (float)values[i - STATS_BENCH_WINDOW]; // A ring of the window on the target
+            sum -= old;
+            sumSq -= old * old;
+        }
+        if (i + 1 < STATS_BENCH_WINDOW || (i + 1 - STATS_BENCH_WINDOW) % step != 0) {
+            continue;
+        }
+        if (windowCount < STATS_BENCH_MAX_WINDOWS) {
+            float mean = sum / (float)STATS_BENCH_WINDOW;
+            windows[windowCount++] = (StatsBench_Window_t){i + 1, mean,
+                                                           (sumSq - sum * mean) / (float)(STATS_BENCH_WINDOW - 1),
+                                                           values[i], values[i]}; // No O(1) extremes
+        }
+    }
+    r->cpuNs = StatsBench_CpuNs() - start;
+    r->stateBytes = STATS_BENCH_WINDOW * sizeof(int32_t) + 2 * sizeof(float);
+    StatsBench_Check(values, count, step, r);
+}
+
+/**
+ * @brief Check an accumulator over the whole trace against the reference
+ */
+static void StatsBench_Whole(const int32_t *values, uint32_t count, const SensorStats_Acc_t *acc, StatsBench_Result_t *r)
+{
+    StatsBench_Window_t ref, w;
+
+    StatsBench_Reference(values, 0, count, &ref);
+    w.end = count;
+    w.mean = (double)acc->offset + (double)acc->mean;
+    w.var = (double)SensorStats_Variance(acc);
+    w.min = acc->min;
+    w.max = acc->max;
+    r->windows = 1;
+    r->extremesOk = 1;
+    r->pass = (acc->count == count) & StatsBench_Compare(&w, &ref, r);
+    r->pass &= r->extremesOk;
+}
+
+/**
+ * @brief A channel without windows: total and moving average over the trace
+ */
+static void StatsBench_Total(const int32_t *values, uint32_t count, StatsBench_Result_t *total, StatsBench_Result_t *ema)
+{
+    static SensorStats_t st;
+    SensorStats_Config_t config = {0, 0, (SensorStats_Real_t)STATS_BENCH_EMA_ALPHA, NULL, NULL};
+    SensorStats_Acc_t acc;
+    double ref = values[0];
+
+    SensorStats_Init(&st, &config);
+    uint64_t start = StatsBench_CpuNs();
+    for (uint32_t i = 0; i < count; i++) {
+        SensorStats_Add(&st, values[i]);
+    }
+    total->cpuNs = ema->cpuNs = StatsBench_CpuNs() - start;
+    total->stateBytes = ema->stateBytes = (uint32_t)(sizeof(st) - sizeof(st.panes));
+    SensorStats_Total(&st, &acc);
+    StatsBench_Whole(values, count, &acc, total);
+
+    for (uint32_t i = 1; i < count; i++) {
+        ref += STATS_BENCH_EMA_ALPHA * (values[i] - ref);
+    }
+    ema->windows = 1;
+    ema->extremesOk = 1;
+    ema->maxMeanErr = fabs((double)st.emaBase + (double)st.ema - ref);
+    ema->pass = ema->maxMeanErr <= STATS_BENCH_MEAN_TOL * ((double)acc.max - acc.min + 1.0);
+}
+
+/**
+ * @brief Accumulate uneven chunks of the trace separately and merge them
+ */
+static void StatsBench_Merge(const int32_t *values, uint32_t count, StatsBench_Result_t *r)
+{
+    SensorStats_Acc_t merged, part;
+    uint32_t chunks = 0;
+
+    SensorStats_AccReset(&merged);
+    uint64_t start = StatsBench_CpuNs();
+    for (uint32_t i = 0; i < count;) {
+        seed = seed * 1664525u + 1013904223u;
+        uint32_t len = 1 + (seed >> 8) % (2 * STATS_BENCH_WINDOW);
+        SensorStats_AccReset(&part);
+        for (uint32_t k = 0; k < len && i < count; k++, i++) {
+            SensorStats_AccAdd(&part, values[i]);
+        }
+        SensorStats_AccMerge(&merged, &part);
+        chunks++;
+    }
+    r->cpuNs = StatsBench_CpuNs() - start;
+    r->stateBytes = 2 * sizeof(SensorStats_Acc_t);
+    StatsBench_Whole(values, count, &merged, r);
+    r->windows = chunks;
+}
+
+ /* ========================== Function Definitions ============================ */
+
+/**
+ * @brief Run every method and window over one trace
+ * @param name Trace name for the report
+ * @param values Samples, at most STATS_BENCH_SAMPLES
+ * @param count Number of samples
+ * @param results Filled with one result per method and window
+ * @param max Capacity of results
+ * @return uint16_t Number of results
+ */
+uint16_t StatsBench_Trace(const char *name, const int32_t *values, uint32_t count, StatsBench_Result_t *results, uint16_t max)
+{
+    uint16_t n = 0;
+
+    if (max < 9) {
+        return 0;
+    }
+    StatsBench_Init(&results[n], name, "tumbling", "sensorstats", count);
+    StatsBench_SensorStats(values, count, 1, &results[n++]);
+    StatsBench_Init(&results[n], name, "tumbling", "rescan_float", count);
+    StatsBench_Rescan(values, count, STATS_BENCH_WINDOW, &results[n++]);
+    StatsBench_Init(&results[n], name, "tumbling", "running_sums_float", count);
+    StatsBench_RunningSums(values, count, STATS_BENCH_WINDOW, &results[n++]);
+
+    StatsBench_Init(&results[n], name, "sliding", "sensorstats", count);
+    StatsBench_SensorStats(values, count, STATS_BENCH_PANES, &results[n++]);
+    StatsBench_Init(&results[n], name, "sliding", "rescan_float", count);
+    StatsBench_Rescan(values, count, STATS_BENCH_PANE, &results[n++]);
+    StatsBench_Init(&results[n], name, "sliding", "running_sums_float", count);
+    StatsBench_RunningSums(values, count, STATS_BENCH_PANE, &results[n++]);
+
+    StatsBench_Init(&results[n], name, "total", "sensorstats", count);
+    StatsBench_Init(&results[n + 1], name, "ema", "sensorstats", count);
+    StatsBench_Total(values, count, &results[n], &results[n + 1]);
+    n += 2;
+    StatsBench_Init(&results[n], name, "merge", "sensorstats", count);
+    StatsBench_Merge(values, count, &results[n++]);
+    return n;
+}
+
+/**
+ * @brief Run the synthetic traces
+ * @param results Filled with the results of every trace
+ * @param max Capacity of results
+ * @return uint16_t Number of results
+ */
+uint16_t StatsBench_Synthetic(StatsBench_Result_t *results, uint16_t max)
+{
+    const uint32_t n = STATS_BENCH_SAMPLES;
+    uint16_t count = 0;
+
+    seed = 12345;
+    for (uint32_t i = 0; i < n; i++) {
+        benchValues[i] = 2350 + (int32_t)lround(150.0 * StatsBench_Wave(i, 86400.0, 0.0)) + StatsBench_Noise(1);
+    }
+    count += StatsBench_Trace("bme280_temp_1hz", benchValues, n, &results[count], (uint16_t)(max - count));
+
+    for (uint32_t i = 0; i < n; i++) {
+        benchValues[i] = 101325 * 256 + (int32_t)lround(200.0 * 256.0 * StatsBench_Wave(i, 43200.0, 0.5)) + StatsBench_Noise(40);
+    }
+    count += StatsBench_Trace("bme280_press_1hz", benchValues, n, &results[count], (uint16_t)(max - count));
+
+    for (uint32_t i = 0; i < n; i++) {
+        benchValues[i] = 12000 + (int32_t)lround(200.0 * StatsBench_Wave(i, 36000.0, 0.0)) + StatsBench_Noise(3);
+    }
+    count += StatsBench_Trace("ads1115_slow_10hz", benchValues, n, &results[count], (uint16_t)(max - count));
+
+    for (uint32_t i = 0; i < n; i++) {
+        benchValues[i] = (int32_t)lround(16000.0 * StatsBench_Wave(i, 860.0 / 50.0, 0.0)) + StatsBench_Noise(2);
+    }
+    count += StatsBench_Trace("ads1115_sine_860sps", benchValues, n, &results[count], (uint16_t)(max - count));
+
+    for (uint32_t i = 0; i < n; i++) {
+        benchValues[i] = (1 << 30) + StatsBench_Noise(1);
+    }
+    count += StatsBench_Trace("offset_stress_2e30", benchValues, n, &results[count], (uint16_t)(max - count));
+    return count;
+}
+
+/**
+ * @brief Write results as CSV with a header line
+ */
+void StatsBench_WriteCsv(FILE *out, const StatsBench_Result_t *results, uint16_t count)
+{
+    fprintf(out, "trace,window,method,samples,windows,state_bytes,ns_per_sample,max_mean_err,max_var_rel_err,extremes,status\n");
+    for (uint16_t i = 0; i < count; i++) {
+        const StatsBench_Result_t *r = &results[i];
+        int checked = strcmp(r->method, "sensorstats") == 0;
+        fprintf(out, "%s,%s,%s,%u,%u,%u,%.1f,%.3g,%.3g,%s,%s\n", r->trace, r->window, r->method, r->samples,
+                r->windows, r->stateBytes, r->samples ? (double)r->cpuNs / r->samples : 0.0, r->maxMeanErr,
+                r->maxVarRelErr, r->extremesOk ? "exact" : "no", checked ? (r->pass ? "ok" : "FAIL") : "-");
+    }
+}
+
+/**
+ * @brief Command line entry, no arguments
+ * @return int 0, 1 if a SensorStats result is outside the tolerances, 2 on usage errors
+ */
+int StatsBench_Main(int argc, char **argv)
+{
+    static StatsBench_Result_t results[64]; // 9 per trace
+    uint16_t count;
+    int failed = 0;
+
+    if (argc > 1) {
+        fprintf(stderr, "usage: %s\n", argv[0]);
+        return 2;
+    }
+    count = StatsBench_Synthetic(results, sizeof(results) / sizeof(results[0]));
+    StatsBench_WriteCsv(stdout, results, count);
+    for (uint16_t i = 0; i < count; i++) {
+        if (strcmp(results[i].method, "sensorstats") == 0 && !results[i].pass) {
+            fprintf(stderr, "%s/%s: mean error %.3g, variance error %.3g, extremes %s\n", results[i].trace,
+                    results[i].window, results[i].maxMeanErr, results[i].maxVarRelErr,
+                    results[i].extremesOk ? "exact" : "wrong");
+            failed = 1;
+        }
+    }
+    return failed;
+}
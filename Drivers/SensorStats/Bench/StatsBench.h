@@ -0,0 +1,39 @@
+#ifndef STATS_BENCH_H
+#define STATS_BENCH_H
+#include "SensorStats.h"
+#include <stdio.h>
+
+/*------------------- Configuration ---------------------------*/
+#ifndef STATS_BENCH_SAMPLES
+#define STATS_BENCH_SAMPLES 100000 // Samples per synthetic trace
+#endif
+#ifndef STATS_BENCH_WINDOW
+#define STATS_BENCH_WINDOW 1000 // Window length in samples, tumbling and sliding
+#endif
+#ifndef STATS_BENCH_PANES
+#define STATS_BENCH_PANES 8 // Panes of the sliding window, a new window every STATS_BENCH_WINDOW / STATS_BENCH_PANES samples
+#endif
+#define STATS_BENCH_NAME_LEN 32
+
+/************************ Bench Structs ********************************/
+typedef struct {
+    char trace[STATS_BENCH_NAME_LEN];
+    const char *window;     // "tumbling", "sliding", or over the whole trace "total", "ema", "merge"
+    const char *method;     // "sensorstats", or a baseline: "rescan_float", "running_sums_float"
+    uint32_t samples;
+    uint32_t windows;       // Windows compared with the reference
+    uint32_t stateBytes;    // Memory per channel
+    uint64_t cpuNs;         // Host CPU time over the trace, informational only
+    double maxMeanErr;      // Largest error of a window mean (of the EMA in the ema row), counts
+    double maxVarRelErr;    // Largest relative error of a window variance
+    int extremesOk;         // 1 if every window min and max was exact
+    int pass;               // 1 if within the tolerances; only checked for sensorstats
+} StatsBench_Result_t;
+
+/*------------------- Function Prototypes ---------------------------*/
+uint16_t StatsBench_Trace(const char *name, const int32_t *values, uint32_t count, StatsBench_Result_t *results, uint16_t max);
+uint16_t StatsBench_Synthetic(StatsBench_Result_t *results, uint16_t max);
+void StatsBench_WriteCsv(FILE *out, const StatsBench_Result_t *results, uint16_t count);
+int StatsBench_Main(int argc, char **argv);
+
+#endif
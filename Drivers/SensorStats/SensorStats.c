@@ -0,0 +1,215 @@
+#include "SensorStats.h"
+#include <string.h>
+
+/**
+ ******************************************************************************
+ * @file    SensorStats.c
+ * @author  Yair Yamin
+ * @brief   Streaming statistics over driver readings, constant work per sample.
+ * @details Each sample updates count, min, max and Welford's running mean and
+ * sum of squared deviations; nothing is stored and nothing is rescanned.
+ *
+ * - Accumulators merge exactly (Chan et al.), so partial results from several
+ *   tasks, buffers or panes combine into one.
+ * - Windows are built from panes of paneLen samples. With one pane they are
+ *   tumbling; with n panes a window covers the last n panes and a new one is
+ *   reported every pane, at the cost of merging n accumulators then.
+ * - Samples are integers in the units of the driver (ADS1115 LSB, 0.01 degC,
+ *   1/256 Pa). Their mean and deviations are kept relative to the first
+ *   sample of each accumulator, which keeps float exact enough even for
+ *   pressure around 2.6e7 counts.
+ *
+ * Not interrupt safe: add samples to one SensorStats_t from one context.
+ ******************************************************************************
+ */
+
+/* ========================== Static Helpers ============================ */
+
+static SensorStats_Real_t SensorStats_Diff(int32_t a, int32_t b)
+{
+    return (SensorStats_Real_t)((int64_t)a - b);
+}
+
+ /* ========================== Function Definitions ============================ */
+
+/**
+ * @brief Empty an accumulator
+ */
+void SensorStats_AccReset(SensorStats_Acc_t *acc)
+{
+    memset(acc, 0, sizeof(*acc));
+}
+
+/**
+ * @brief Add one sample
+ * @param acc Accumulator
+ * @param value Sample
+ */
+void SensorStats_AccAdd(SensorStats_Acc_t *acc, int32_t value)
+{
+    SensorStats_Real_t x, delta;
+
+    if (acc->count == 0) {
+        acc->count = 1;
+        acc->min = acc->max = acc->offset = value;
+        acc->mean = 0;
+        acc->m2 = 0;
+        return;
+    }
+    acc->count++;
+    if (value < acc->min) acc->min = value;
+    if (value > acc->max) acc->max = value;
+
+    x = SensorStats_Diff(value, acc->offset);
+    delta = x - acc->mean;
+    acc->mean += delta / (SensorStats_Real_t)acc->count;
+    acc->m2 += delta * (x - acc->mean);
+}
+
+/**
+ * @brief Combine another accumulator into this one
+ * @param acc Accumulator, holds the samples of both afterwards
+ * @param other Accumulator to add, unchanged
+ * @details The result equals one accumulator fed with both sample runs, up to
+ *          rounding. acc keeps its offset.
+ */
+void SensorStats_AccMerge(SensorStats_Acc_t *acc, const SensorStats_Acc_t *other)
+{
+    SensorStats_Real_t n, delta;
+
+    if (other->count == 0) {
+        return;
+    }
+    if (acc->count == 0) {
+        *acc = *other;
+        return;
+    }
+    n = (SensorStats_Real_t)acc->count + (SensorStats_Real_t)other->count;
+    delta = SensorStats_Diff(other->offset, acc->offset) + other->mean - acc->mean;
+    acc->mean += delta * ((SensorStats_Real_t)other->count / n);
+    acc->m2 += other->m2 + delta * delta * ((SensorStats_Real_t)acc->count * (SensorStats_Real_t)other->count / n);
+    acc->count += other->count;
+    if (other->min < acc->min) acc->min = other->min;
+    if (other->max > acc->max) acc->max = other->max;
+}
+
+/**
+ * @brief Mean of the samples
+ * @return SensorStats_Real_t 0 for an empty accumulator
+ */
+SensorStats_Real_t SensorStats_Mean(const SensorStats_Acc_t *acc)
+{
+    return (SensorStats_Real_t)acc->offset + acc->mean;
+}
+
+/**
+ * @brief Sample variance, divided by count - 1
+ * @return SensorStats_Real_t 0 for fewer than two samples
+ */
+SensorStats_Real_t SensorStats_Variance(const SensorStats_Acc_t *acc)
+{
+    if (acc->count < 2) {
+        return 0;
+    }
+    return acc->m2 / (SensorStats_Real_t)(acc->count - 1);
+}
+
+/**
+ * @brief Set up a statistics channel
+ * @param st Channel
+ * @param config Windows, moving average and callback; copied
+ * @return HAL_StatusTypeDef HAL_ERROR if config asks for windows without
+ *         panes or for more than SENSORSTATS_MAX_PANES panes
+ */
+HAL_StatusTypeDef SensorStats_Init(SensorStats_t *st, const SensorStats_Config_t *config)
+{
+    if (config->paneLen != 0 && (config->panes == 0 || config->panes > SENSORSTATS_MAX_PANES)) {
+        return HAL_ERROR;
+    }
+    memset(st, 0, sizeof(*st));
+    st->config = *config;
+    return HAL_OK;
+}
+
+/**
+ * @brief Drop every sample, keep the configuration
+ */
+void SensorStats_Reset(SensorStats_t *st)
+{
+    SensorStats_Config_t config = st->config;
+    memset(st, 0, sizeof(*st));
+    st->config = config;
+}
+
+/**
+ * @brief Add one sample to the moving average and the window
+ * @param st Channel
+ * @param value Sample, in driver units
+ * @details Constant work, except at the end of a pane, which adds the pane to
+ *          the total, merges the window's panes and calls config.onWindow
+ *          once the window is full.
+ */
+void SensorStats_Add(SensorStats_t *st, int32_t value)
+{
+    SensorStats_Acc_t *pane;
+
+    if (st->samples++ == 0) {
+        st->emaBase = value;
+    }
+    if (st->config.emaAlpha != 0) {
+        st->ema += st->config.emaAlpha * (SensorStats_Diff(value, st->emaBase) - st->ema);
+    }
+    if (st->config.paneLen == 0) {
+        SensorStats_AccAdd(&st->total, value);
+        return;
+    }
+
+    pane = &st->panes[st->head];
+    SensorStats_AccAdd(pane, value);
+    if (pane->count < st->config.paneLen) {
+        return;
+    }
+    SensorStats_AccMerge(&st->total, pane);
+    if (st->filled < st->config.panes) {
+        st->filled++;
+    }
+    st->head = (uint8_t)((st->head + 1) % st->config.panes);
+    if (st->filled == st->config.panes) {
+        // Oldest pane first, so the window keeps the offset of its first sample
+        SensorStats_AccReset(&st->window);
+        for (uint8_t i = 0; i < st->config.panes; i++) {
+            SensorStats_AccMerge(&st->window, &st->panes[(st->head + i) % st->config.panes]);
+        }
+        st->windows++;
+        if (st->config.onWindow != NULL) {
+            st->config.onWindow(st, &st->window);
+        }
+    }
+    SensorStats_AccReset(&st->panes[st->head]);
+}
+
+/**
+ * @brief Statistics of every sample since init or reset
+ * @param st Channel
+ * @param total Receives the completed panes merged with the one being filled
+ */
+void SensorStats_Total(const SensorStats_t *st, SensorStats_Acc_t *total)
+{
+    *total = st->total;
+    if (st->config.paneLen != 0) {
+        SensorStats_AccMerge(total, &st->panes[st->head]);
+    }
+}
+
+/**
+ * @brief Exponential moving average of the samples
+ * @return SensorStats_Real_t Starts at the first sample; 0 before any sample
+ *         or with emaAlpha 0
+ */
+SensorStats_Real_t SensorStats_Ema(const SensorStats_t *st)
+{
+    if (st->config.emaAlpha == 0 || st->samples == 0) {
+        return 0;
+    }
+    return (SensorStats_Real_t)st->emaBase + st->ema;
+}
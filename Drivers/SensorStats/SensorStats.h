@@ -0,0 +1,73 @@
+#ifndef SENSOR_STATS_H
+#define SENSOR_STATS_H
+#include "main.h"
+
+/*------------------- Configuration ---------------------------*/
+// Arithmetic of mean, variance and EMA. float suits a Cortex-M4F; double on
+// hosts or parts with a double-precision FPU.
+#ifndef SENSORSTATS_REAL
+#define SENSORSTATS_REAL float
+#endif
+
+#ifndef SENSORSTATS_MAX_PANES
+#define SENSORSTATS_MAX_PANES 8 // Panes of a sliding window, 24 bytes each with float
+#endif
+
+/************************ Stats Structs ********************************/
+typedef SENSORSTATS_REAL SensorStats_Real_t;
+
+// Count, extremes, mean and variance of a run of integer samples. Mean and
+// squared deviations are kept relative to the first sample, so a large
+// offset (pressure in 1/256 Pa) costs no precision.
+typedef struct {
+    uint32_t count;
+    int32_t min;
+    int32_t max;
+    int32_t offset;          // First sample
+    SensorStats_Real_t mean; // Mean of value - offset
+    SensorStats_Real_t m2;   // Sum of squared deviations from the mean
+} SensorStats_Acc_t;
+
+typedef struct SensorStats_s SensorStats_t;
+
+/**
+ * @brief Called with each completed window
+ * @details Runs in the SensorStats_Add() that completed it. window is only
+ * valid during the call; the same result stays in st->window until the next one.
+ */
+typedef void (*SensorStats_WindowCallback_t)(SensorStats_t *st, const SensorStats_Acc_t *window);
+
+typedef struct {
+    uint32_t paneLen;       // Samples per pane, 0 for no windows
+    uint8_t panes;          // 1: tumbling windows of paneLen samples; n: the last n panes, advancing by paneLen
+    SensorStats_Real_t emaAlpha; // Weight of a new sample in the moving average, 0 to leave it off
+    SensorStats_WindowCallback_t onWindow; // Optional
+    void *ctx;              // For the callback
+} SensorStats_Config_t;
+
+struct SensorStats_s {
+    SensorStats_Config_t config;
+    SensorStats_Acc_t total;   // Samples of the completed panes, see SensorStats_Total()
+    SensorStats_Acc_t window;  // Last completed window, count 0 before the first
+    SensorStats_Acc_t panes[SENSORSTATS_MAX_PANES];
+    SensorStats_Real_t ema;    // Relative to emaBase
+    int32_t emaBase;           // First sample
+    uint32_t samples;          // Since init or reset
+    uint32_t windows;          // Windows completed
+    uint8_t head;              // Pane being filled
+    uint8_t filled;            // Complete panes, up to config.panes
+};
+
+/*------------------- Function Prototypes ---------------------------*/
+void SensorStats_AccReset(SensorStats_Acc_t *acc);
+void SensorStats_AccAdd(SensorStats_Acc_t *acc, int32_t value);
+void SensorStats_AccMerge(SensorStats_Acc_t *acc, const SensorStats_Acc_t *other);
+SensorStats_Real_t SensorStats_Mean(const SensorStats_Acc_t *acc);
+SensorStats_Real_t SensorStats_Variance(const SensorStats_Acc_t *acc);
+HAL_StatusTypeDef SensorStats_Init(SensorStats_t *st, const SensorStats_Config_t *config);
+void SensorStats_Reset(SensorStats_t *st);
+void SensorStats_Add(SensorStats_t *st, int32_t value);
+void SensorStats_Total(const SensorStats_t *st, SensorStats_Acc_t *total);
+SensorStats_Real_t SensorStats_Ema(const SensorStats_t *st);
+
+#endif
@@ -0,0 +1,57 @@
+#ifndef SENSOR_STATS_SENSORS_H
+#define SENSOR_STATS_SENSORS_H
+#include "SensorStats.h"
+#include "ADS1115.h"
+#include "BME280.h"
+#include "DS3231.h"
+
+// Feed the last readings held in the driver handles to statistics channels,
+// in the integer units SensorLog uses. Call right after the driver function
+// that fetched the reading, e.g. from an AcqSched onSample callback.
+
+/**
+ * @brief Add the conversion read by ADS1115_ReadConversionReg(), in LSB
+ * @details Calibrated when the handle has a calibration table.
+ */
+static inline void SensorStats_ADS1115(SensorStats_t *st, const ADS1115_Handle_t *hads1115)
+{
+    SensorStats_Add(st, ADS1115_GetSample(hads1115));
+}
+
+#ifndef BME280_COMPACT_HANDLE
+static inline int32_t SensorStats_Round(float value)
+{
+    return (int32_t)(value < 0.0f ? value - 0.5f : value + 0.5f);
+}
+#endif
+
+/**
+ * @brief Add the last BME280 readings to three channels
+ * @param st Temperature (0.01 degC), pressure (1/256 Pa) and humidity (0.01 %RH) channels
+ */
+static inline void SensorStats_BME280(SensorStats_t st[3], const BME280_Handle_t *hbme280)
+{
+#ifdef BME280_COMPACT_HANDLE
+    SensorStats_Add(&st[0], hbme280->temperature);
+    SensorStats_Add(&st[1], (int32_t)hbme280->pressure);
+    SensorStats_Add(&st[2], hbme280->humidity);
+#else
+    SensorStats_Add(&st[0], SensorStats_Round(hbme280->temperature * 100.0f));
+    SensorStats_Add(&st[1], SensorStats_Round(hbme280->pressure * 256.0f));
+    SensorStats_Add(&st[2], SensorStats_Round(hbme280->humidity * 100.0f));
+#endif
+}
+
+/**
+ * @brief Add the DS3231 temperature read by DS3231_GetTemp(), in 0.25 degC
+ */
+static inline void SensorStats_DS3231Temp(SensorStats_t *st, const DS3231_Handle_t *hrtc)
+{
+#ifdef DS3231_COMPACT_HANDLE
+    SensorStats_Add(st, hrtc->temp);
+#else
+    SensorStats_Add(st, (int32_t)(hrtc->temp * 4.0f));
+#endif
+}
+
+#endif